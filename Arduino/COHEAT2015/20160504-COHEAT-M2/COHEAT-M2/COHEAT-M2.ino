@@ -5,6 +5,12 @@
 // IF DEFINED: entire comms model switches to secure.
 //#define ENABLE_OTSECUREFRAME_ENCODING_SUPPORT
 
+// IF DEFINED: keep a CC1 poll response built ahead of time to answer polls straight from the RX path.
+//#define ENABLE_CC1_PREBUILT_POLL_RESPONSE
+
+// IF DEFINED: run the relay LED flashes in the background from timer2 rather than pausing the main loop.
+//#define ENABLE_LED_PATTERN_ENGINE
+
 #define DEBUG // Uncomment for debug output.
 
 #include <Arduino.h>
@@ -387,64 +393,115 @@ bool sendCC1Alert()
 // True if a poll response is needed.
 // Cleared upon successful send.
 static bool pollResponseNeeded;
-// Send a CC1 poll response message with this unit's house code; returns false on failure.
-bool sendCC1PollResponse()
+// Largest poll response frame as passed to sendRaw().
+#if !defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
+static const uint8_t CC1_POLL_RESPONSE_TX_BYTES = OTProtocolCC::CC1PollResponse::primary_frame_bytes+1;
+#else
+static const uint8_t CC1_POLL_RESPONSE_TX_BYTES = OTRadioLink::SecurableFrameHeader::maxSmallFrameSize;
+#endif
+// Values carried by a poll response: hc1, hc2, rh, tp, tr, al, then flags s | w<<1 | sy<<2.
+static const uint8_t CC1_POLL_RESPONSE_VALUES = 7;
+// Collect the values for a poll response with this unit's house code.
+// Uses fresh sensor readings if fresh is true, else the last values (much quicker).
+static void getCC1PollResponseValues(uint8_t *const v, const bool fresh)
   {
   // Respond to the hub with sensor data.
   // Can use read() for very freshest values at risk of some delay/cost.
-  const uint8_t hc1 = FHT8V.nvGetHC1();
-  const uint8_t hc2 = FHT8V.nvGetHC2();
+  v[0] = FHT8V.nvGetHC1();
+  v[1] = FHT8V.nvGetHC2();
 #ifdef HUMIDITY_SENSOR_SUPPORT
-  const uint8_t rh = RelHumidity.read() >> 1; // Scale from [0,100] to [0,50] for TX.
+  v[2] = (fresh ? RelHumidity.read() : RelHumidity.get()) >> 1; // Scale from [0,100] to [0,50] for TX.
 #else
-  const uint8_t rh = 0; // RH% not available.
+  v[2] = 0; // RH% not available.
 #endif
-  const uint8_t tp = (uint8_t) constrain(extDS18B20_0.read() >> 3, 0, 199); // Scale to to 1/2C [0,100[ for TX.
-  const uint8_t tr = (uint8_t) constrain(TemperatureC16.read() >> 2, 0, 199); // Scale from 1/16C to 1/4C [0,50[ for TX.
-  const uint8_t al = AmbLight.read() >> 2; // Scale from [0,255] to [1,62] for TX (allow value coercion at extremes).
+  v[3] = (uint8_t) constrain((fresh ? extDS18B20_0.read() : extDS18B20_0.get()) >> 3, 0, 199); // Scale to to 1/2C [0,100[ for TX.
+  v[4] = (uint8_t) constrain((fresh ? TemperatureC16.read() : TemperatureC16.get()) >> 2, 0, 199); // Scale from 1/16C to 1/4C [0,50[ for TX.
+  v[5] = (fresh ? AmbLight.read() : AmbLight.get()) >> 2; // Scale from [0,255] to [1,62] for TX (allow value coercion at extremes).
   const bool s = getSwitchToggleStateCO();
   const bool w = (fastDigitalRead(BUTTON_LEARN2_L) != LOW); // BUTTON_LEARN2_L high means open circuit means door/window open.
   const bool sy = !NominalRadValve.isInNormalRunState(); // Assume only non-normal FHT8V state is 'syncing'.
+  v[6] = (uint8_t)(s | (w << 1) | (sy << 2));
+  }
+// Build a CC1 poll response from the given values into buf (CC1_POLL_RESPONSE_TX_BYTES), ready for sendRaw().
+// Returns the frame length, or 0 on failure.
+static uint8_t buildCC1PollResponse(uint8_t *const buf, const uint8_t *const v)
+  {
   OTProtocolCC::CC1PollResponse r =
-      OTProtocolCC::CC1PollResponse::make(hc1, hc2, rh, tp, tr, al, s, w, sy);
-  // Send message back to hub.
-  // Hub can poll again if it does not see the response.
-  // TODO: may need to insert a delay to allow hub to be ready if use of read() above is not enough.
+      OTProtocolCC::CC1PollResponse::make(v[0], v[1], v[2], v[3], v[4], v[5], v[6] & 1, v[6] & 2, v[6] & 4);
   uint8_t txbuf[OTProtocolCC::CC1PollResponse::primary_frame_bytes+1]; // More than large enough for preamble + sync + alert message.
   const uint8_t bodylen = r.encodeSimple(txbuf, sizeof(txbuf), true);
-#if 1 && defined(DEBUG)
-  OTV0P2BASE::serialPrintlnAndFlush(F("polled"));
-#endif
 #if !defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
   // Non-secure: send raw frame as-is.
-  // Send at default power...  One going missing won't hurt that much.
-  if(!PrimaryRadio.sendRaw(txbuf, bodylen))
-    { OTV0P2BASE::serialPrintlnAndFlush(F("!TX *")); return(false); } // FAIL
-  // Note successful dispatch of response.
-  pollResponseNeeded = false;
-  return(true);
+  memcpy(buf, txbuf, bodylen);
+  return(bodylen);
 #else
   // Secure: wrap frame in encrypted layer...
   uint8_t key[16];
   if(!OTV0P2BASE::getPrimaryBuilding16ByteSecretKey(key))
-    { OTV0P2BASE::serialPrintlnAndFlush(F("!TX key")); return(false); } // FAIL
+    { OTV0P2BASE::serialPrintlnAndFlush(F("!TX key")); return(0); } // FAIL
   const OTRadioLink::SimpleSecureFrame32or0BodyTXBase::fixed32BTextSize12BNonce16BTagSimpleEnc_ptr_t e = OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleEnc_DEFAULT_STATELESS;
   uint8_t sbuf[OTRadioLink::SecurableFrameHeader::maxSmallFrameSize];
   const uint8_t sbodylen = secureTXState.generateSecureOStyleFrameForTX(sbuf, sizeof(sbuf), OTRadioLink::FTS_RESERVED_A, lenTXID, txbuf, bodylen, e, NULL, key);
-  const bool success = (0 != sbodylen) && PrimaryRadio.sendRaw(sbuf+1, sbodylen-1);
+  // DO NOT attempt to send if construction of the secure frame failed;
+  // doing so may reuse IVs and destroy the cipher security.
+  if(0 == sbodylen) { return(0); }
+  // Framed channel: do not send the leading length byte.
+  memcpy(buf, sbuf+1, sbodylen-1);
+  return(sbodylen-1);
+#endif // !defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
+  }
+
+#if defined(ENABLE_CC1_PREBUILT_POLL_RESPONSE)
+// Poll response built ahead of time, so that a poll can be answered straight from the RX path
+// rather than waiting ~0.5s (at 1MHz) to encrypt, or for the next minor cycle.
+// Each prebuilt frame is sent at most once, since a secure frame carries a fresh message counter.
+static uint8_t pollResponseFrame[CC1_POLL_RESPONSE_TX_BYTES];
+static uint8_t pollResponseFrameLen; // 0 if none ready.
+static uint8_t pollResponseValues[CC1_POLL_RESPONSE_VALUES]; // Values in pollResponseFrame.
+// Rebuild the prebuilt response if it has been used or the values it carries have changed,
+// eg after a poll/command has set the LEDs and valve, or at a new sensor reading.
+// Cheap when nothing has changed; call when there is time to handle a message.
+static void refreshCC1PollResponse()
+  {
+  uint8_t v[CC1_POLL_RESPONSE_VALUES];
+  getCC1PollResponseValues(v, false);
+  // Avoid using up a message counter (and time) unless something has changed.
+  if((0 != pollResponseFrameLen) && (0 == memcmp(v, pollResponseValues, sizeof(v)))) { return; }
+  pollResponseFrameLen = buildCC1PollResponse(pollResponseFrame, v);
+  memcpy(pollResponseValues, v, sizeof(v));
+  }
+#endif // ENABLE_CC1_PREBUILT_POLL_RESPONSE
+
+// Send a CC1 poll response message with this unit's house code; returns false on failure.
+bool sendCC1PollResponse()
+  {
+  // Send message back to hub.
+  // Hub can poll again if it does not see the response.
+  // TODO: may need to insert a delay to allow hub to be ready if use of read() above is not enough.
+#if defined(ENABLE_CC1_PREBUILT_POLL_RESPONSE)
+  // Only stale if nothing has been prebuilt since the last send.
+  if(0 == pollResponseFrameLen) { refreshCC1PollResponse(); }
+  const uint8_t len = pollResponseFrameLen;
+  const uint8_t *const txbuf = pollResponseFrame;
+  pollResponseFrameLen = 0; // Never send the same frame twice.
+#else
+  uint8_t v[CC1_POLL_RESPONSE_VALUES];
+  getCC1PollResponseValues(v, true);
+  uint8_t txbuf[CC1_POLL_RESPONSE_TX_BYTES];
+  const uint8_t len = buildCC1PollResponse(txbuf, v);
+#endif // ENABLE_CC1_PREBUILT_POLL_RESPONSE
 #if 1 && defined(DEBUG)
-  if(!success) { OTV0P2BASE::serialPrintlnAndFlush(F("!TX *")); }
+  OTV0P2BASE::serialPrintlnAndFlush(F("polled"));
+#endif
+  // Send at default power...  One going missing won't hurt that much.
+  const bool success = (0 != len) && PrimaryRadio.sendRaw(txbuf, len);
+  if(!success) { OTV0P2BASE::serialPrintlnAndFlush(F("!TX *")); } // FAIL
+#if 1 && defined(DEBUG) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
   else { OTV0P2BASE::serialPrintlnAndFlush(F("TX *")); }
 #endif
-  if(success)
-    {
-    // Note successful dispatch of response.
-    pollResponseNeeded = false;
-    return(true);
-    }
-#endif // !defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
-  // FAILED if fallen through to here.
-  return(false);
+  // Note successful dispatch of response.
+  if(success) { pollResponseNeeded = false; }
+  return(success);
   }
 #endif // ALLOW_CC1_SUPPORT_RELAY
 
@@ -459,6 +516,51 @@ static void setLEDs(const uint8_t lc)
     if(lc & 2) { LED_UI2_ON(); } else { LED_UI2_OFF(); }
     }
 
+#if defined(ENABLE_LED_PATTERN_ENGINE)
+// Background LED patterns, timed by compare match A on timer2 (the RTC, one sub-cycle tick per count),
+// so that each flash costs two very short ISR calls rather than up to ~250ms of main-loop pauses.
+// ASSUMES that nothing else uses timer2 compare match A (the library uses overflow only).
+// A pattern is a 0-terminated list of alternating on and off durations in sub-cycle ticks (~8ms), starting with on;
+// the LEDs are left off at the end.
+static const uint8_t LED_PAT_FLICKER[] PROGMEM = { 2, 0 }; // ~15ms.
+static const uint8_t LED_PAT_SINGLE[] PROGMEM = { 8, 0 }; // ~60ms.
+static const uint8_t LED_PAT_DOUBLE[] PROGMEM = { 8, 15, 8, 0 }; // ~60ms on, ~120ms off, ~60ms on.
+static uint8_t ledPatLC; // Colour for the on phases; only written with the ISR disabled.
+static const uint8_t *volatile ledPatNext; // Next duration in the running pattern.
+static volatile bool ledPatOn; // True if in an on phase.
+// Schedule the next timer2 compare match in ticks from now.
+static void ledPatSchedule(const uint8_t ticks)
+  {
+  OCR2A = TCNT2 + ticks;
+  while(ASSR & _BV(OCR2AUB)) { } // Async update must complete before any sleep.
+  }
+// Stop any running pattern, leaving the LEDs as they are.
+static void ledPatternStop() { TIMSK2 &= ~_BV(OCIE2A); }
+// Start a pattern in colour lc, replacing any running.
+static void ledPatternStart(const uint8_t *const pattern, const uint8_t lc)
+  {
+  ledPatternStop();
+  ledPatLC = lc;
+  ledPatNext = pattern + 1;
+  ledPatOn = true;
+  setLEDs(lc);
+  ledPatSchedule(pgm_read_byte(pattern));
+  TIFR2 = _BV(OCF2A); // Clear any stale match.
+  TIMSK2 |= _BV(OCIE2A);
+  }
+ISR(TIMER2_COMPA_vect)
+  {
+  const uint8_t *const p = ledPatNext;
+  const uint8_t d = pgm_read_byte(p);
+  ledPatOn = !ledPatOn;
+  if((0 == d) || !ledPatOn) { setLEDs(0); }
+  if(0 == d) { ledPatternStop(); return; }
+  if(ledPatOn) { setLEDs(ledPatLC); }
+  ledPatNext = p + 1;
+  ledPatSchedule(d);
+  }
+#endif // ENABLE_LED_PATTERN_ENGINE
+
 // Logical last-requested light colour (lc).
 static uint8_t lcCO;
 // Count down in 2s ticks until LEDs go out (derived from lt).
@@ -538,6 +640,10 @@ bool tickUICO(const uint_fast8_t sec)
     return(true);
     }
 
+#if defined(ENABLE_LED_PATTERN_ENGINE)
+  // Any flash from the last tick is long over, but make sure it cannot override what follows.
+  ledPatternStop();
+#endif
   // All LEDs off when their count-down timer is/hits zero.
   if(0 == countDownLEDSforCO) { lcCO = 0; setLEDs(0); }
   // Else force 'correct' requested light colour and deal with any 'flash' state.
@@ -549,6 +655,9 @@ bool tickUICO(const uint_fast8_t sec)
     // Do some friendly I/O polling while waiting!
     if(lfCO != 3)
       {
+#if defined(ENABLE_LED_PATTERN_ENGINE)
+      ledPatternStart((2 == lfCO) ? LED_PAT_DOUBLE : LED_PAT_SINGLE, lcCO);
+#else
       // Make this the first flash.
       mediumPause();
       setLEDs(0); // End of first flash.
@@ -563,6 +672,7 @@ bool tickUICO(const uint_fast8_t sec)
         setLEDs(0); // End of second flash.
         pollIO(); // Poll while LEDs are off.
         }
+#endif // ENABLE_LED_PATTERN_ENGINE
       }
     }
 
@@ -588,6 +698,10 @@ void setLEDsCO(const uint8_t lc, const uint8_t lt, const uint8_t lf, const bool
     lcCO = lc;
     countDownLEDSforCO = (lt >= 17) ? 255 : lt * 15; // Units are 30s, ticks are 2s; overflow is avoided.
     lfCO = lf;
+#if defined(ENABLE_LED_PATTERN_ENGINE)
+    if(3 != lf) { ledPatternStart(LED_PAT_FLICKER, lc); } // Flicker until the proper flash handler.
+    else { ledPatternStop(); setLEDs(lc); } // Set correct colour immediately.
+#else
     setLEDs(lc); // Set correct colour immediately.
     if(3 != lf)
       {
@@ -597,6 +711,7 @@ void setLEDsCO(const uint8_t lc, const uint8_t lt, const uint8_t lf, const bool
       tinyPause();
       setLEDs(0);
       }
+#endif // ENABLE_LED_PATTERN_ENGINE
     // Assume that the hub will shortly know about any pending request.
     if(fromPollAndCmd) { waitingForPollAfterBoostRequest = false; }
     }
@@ -800,8 +915,14 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("!RX bad secure header");
           setLEDsCO(c.getLC(), c.getLT(), c.getLF(), true);
           // Set radiator valve position immediately.
           NominalRadValve.set(c.getRP());
+#if defined(ENABLE_CC1_PREBUILT_POLL_RESPONSE)
+          // A prebuilt response takes only the TX time, so send it now unless right at the end of the cycle.
+          if((0 != pollResponseFrameLen) ? (OTV0P2BASE::getSubCycleTime() < nearOverrunThreshold - 1) : timeToHandleMessage())
+            { sendCC1PollResponse(); }
+#else
           // If relatively early in the cycle then send the response immediately.
           if(timeToHandleMessage()) { sendCC1PollResponse(); }
+#endif // ENABLE_CC1_PREBUILT_POLL_RESPONSE
           }
         }
       return;
@@ -1483,6 +1604,10 @@ void loop()
 #if defined(ALLOW_CC1_SUPPORT_RELAY)
     // Handle any pending poll response needed.
     if(pollResponseNeeded && timeToHandleMessage()) { sendCC1PollResponse(); continue; }
+#if defined(ENABLE_CC1_PREBUILT_POLL_RESPONSE)
+    // Have the next response ready before the hub asks.
+    if(timeToHandleMessage()) { refreshCC1PollResponse(); }
+#endif
 #endif
 
     // Normal long minimal-power sleep until wake-up interrupt.
@@ -1534,6 +1659,12 @@ void loop()
     }
 #endif
 
+#if defined(ENABLE_CC1_PREBUILT_POLL_RESPONSE)
+  // Prebuilt poll responses carry the last sensor values, so take fresh readings once a minute
+  // for the idle-time refresh to pick up.
+  if(second0) { uint8_t v[CC1_POLL_RESPONSE_VALUES]; getCC1PollResponseValues(v, true); }
+#endif
+
   // If time to do some trailing processing, CLI, etc...
   while(timeToHandleMessage())
     {
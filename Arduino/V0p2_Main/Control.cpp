@@ -25,25 +25,151 @@ Author(s) / Copyright (s): Damon Hart-Davis 2013--2017
 #if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON)
 #include <OTAESGCM.h>
 #endif
+#if defined(ENABLE_LAZY_TARGET_RECOMPUTE)
+#include <util/crc16.h>
+#endif
+#if defined(ENABLE_VOICE_POWER_GATING)
+#include <Wire.h>
+#endif
 
 #ifdef ENABLE_BOILER_HUB
 // True if boiler should be on.
 static bool isBoilerOn();
+#if defined(ENABLE_BOILER_HUB_VALVE_TABLE)
+// Number of recently-heard valves calling for heat.
+static uint8_t hubValvesCalling();
+// Mark all valve table entries unused.
+static void clearHubValves();
+#endif
+#if defined(ENABLE_BOILER_HUB_ZONES)
+// Set all zone outputs off.
+static void clearBoilerZones();
+#endif
+#if defined(ENABLE_BOILER_DEMAND_MODEL)
+// Latest aggregate demand as % of BOILER_DEMAND_FULL_PC, and boiler starts since midnight.
+static uint8_t boilerDemandLevelPC();
+static uint8_t boilerStartsToday();
+#endif
 #endif
 
+#if defined(ENABLE_SETTINGS_CACHE)
+settingsCache_t settingsCache;
+// (Re)load all cached settings from EEPROM.
+void loadSettingsCache()
+  {
+  settingsCache.minBoilerOnMinsInv = eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_MIN_BOILER_ON_MINS_INV);
+  settingsCache.statsTXLevel = eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_STATS_TX_ENABLE);
+  eeprom_read_block(settingsCache.id, (void *)V0P2BASE_EE_START_ID, V0P2BASE_EE_LEN_ID);
+  }
+#endif // ENABLE_SETTINGS_CACHE
+
+#if defined(ENABLE_RTC_WEAR_LEVELLING)
+// Quarter-hour bits as per OTV0P2BASE::persistRTC(): 7, 3, 1, 0 for quarters 0 to 3.
+static uint8_t rtcQuarterBits(const uint8_t q) { return((uint8_t)(7 >> q)); }
+void persistRTCWL()
+  {
+  uint_least16_t msm;
+  uint16_t days;
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE) { msm = OTV0P2BASE::_minutesSinceMidnightLT; days = OTV0P2BASE::_daysSince1999LT; }
+  const uint8_t hh = (uint8_t)(msm / 60);
+  const uint8_t marker = (uint8_t)(days % 31);
+  const uint8_t target = (uint8_t)((marker << 3) | rtcQuarterBits((msm % 60) / 15));
+  uint8_t *const cell = (uint8_t *)(V0P2_EE_START_RTC_LOG + hh);
+#if defined(ENABLE_EEPROM_WRITE_QUEUE)
+  const uint8_t current = eeQueuedReadByte(cell);
+  if(current == target) { return; }
+  // Quarters within the hour only clear bits (which the smart update does alone); a new hour (or day) needs erase/write.
+  eeQueueUpdateByte(EEW_RTC, cell, target);
+  if(target == (current & target)) { return; }
+  // If the clock was set back, today's later hours are now stale, so erase them.
+  for(uint8_t h = hh + 1; h < V0P2_EE_LEN_RTC_LOG; ++h)
+    {
+    uint8_t *const c = (uint8_t *)(V0P2_EE_START_RTC_LOG + h);
+    if(marker == (eeQueuedReadByte(c) >> 3)) { eeQueueUpdateByte(EEW_RTC, c, 0xff); }
+    }
+  // Write the days after the new day's first cell, so a reset in between leaves that cell looking newest.
+  // Queued writes go in order, so this holds when deferred too.
+  // Both bytes are queued whenever the days change, as eeWriteWord() below, so wear is counted the same way.
+  if(eeprom_read_word((uint16_t *)V0P2BASE_EE_START_RTC_DAY_PERSIST) != days)
+    {
+    uint8_t *const dp = (uint8_t *)V0P2BASE_EE_START_RTC_DAY_PERSIST;
+    eeQueueWrite(EEW_RTC, dp, (uint8_t)days);
+    eeQueueWrite(EEW_RTC, dp + 1, (uint8_t)(days >> 8));
+    }
+#else
+  const uint8_t current = eeprom_read_byte(cell);
+  if(current == target) { return; }
+  // Quarters within the hour only clear bits; a new hour (or day) needs erase/write.
+  if(target == (current & target)) { eeClearBits(EEW_RTC, cell, target); return; }
+  eeWriteByte(EEW_RTC, cell, target);
+  // If the clock was set back, today's later hours are now stale, so erase them.
+  for(uint8_t h = hh + 1; h < V0P2_EE_LEN_RTC_LOG; ++h)
+    {
+    uint8_t *const c = (uint8_t *)(V0P2_EE_START_RTC_LOG + h);
+    if(marker == (eeprom_read_byte(c) >> 3)) { eeEraseByte(EEW_RTC, c); }
+    }
+  // Write the days after the new day's first cell, so a reset in between leaves that cell looking newest.
+  if(eeprom_read_word((uint16_t *)V0P2BASE_EE_START_RTC_DAY_PERSIST) != days)
+    { eeWriteWord(EEW_RTC, (uint16_t *)V0P2BASE_EE_START_RTC_DAY_PERSIST, days); }
+#endif // ENABLE_EEPROM_WRITE_QUEUE
+  }
+bool restoreRTCWL()
+  {
+  const uint16_t days = eeprom_read_word((uint16_t *)V0P2BASE_EE_START_RTC_DAY_PERSIST);
+  if((uint16_t)~0U == days) { return(false); }
+  // Check the day after the persisted one first, in case a reset came before its days update.
+  for(uint8_t i = 0; i < 2; ++i)
+    {
+    const uint8_t d = 1 - i;
+    const uint8_t marker = (uint8_t)((days + d) % 31);
+    // Newest entry is the latest hour carrying that day's marker.
+    for(uint8_t hh = V0P2_EE_LEN_RTC_LOG; hh-- > 0; )
+      {
+      const uint8_t v = eeprom_read_byte((uint8_t *)(V0P2_EE_START_RTC_LOG + hh));
+      if(marker != (v >> 3)) { continue; }
+      uint8_t q = 0;
+      while((q < 4) && ((v & 7) != rtcQuarterBits(q))) { ++q; }
+      if(q >= 4) { continue; } // Invalid bit pattern.
+      // Start just over half way into the quarter, as restoreRTC() does.
+      ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+        {
+        OTV0P2BASE::_daysSince1999LT = days + d;
+        OTV0P2BASE::_minutesSinceMidnightLT = (uint_least16_t)(60 * hh + 15 * q + 8);
+        }
+      return(true);
+      }
+    }
+  // No time of day, but the day is still good.
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE) { OTV0P2BASE::_daysSince1999LT = days; }
+  return(false);
+  }
+#endif // ENABLE_RTC_WEAR_LEVELLING
+
 #ifndef getMinBoilerOnMinutes
 // Get minimum on (and off) time for pointer (minutes); zero if not in hub mode.
-uint8_t getMinBoilerOnMinutes() { return(~eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_MIN_BOILER_ON_MINS_INV)); }
+#if defined(ENABLE_SETTINGS_CACHE)
+uint8_t getMinBoilerOnMinutes() { return(~settingsCache.minBoilerOnMinsInv); }
+#else
+uint8_t getMinBoilerOnMinutes() { return(~eeQueuedReadByte((uint8_t *)V0P2BASE_EE_START_MIN_BOILER_ON_MINS_INV)); }
+#endif
 #endif
 
 #ifndef setMinBoilerOnMinutes
 // Set minimum on (and off) time for pointer (minutes); zero to disable hub mode.
 // Suggested minimum of 4 minutes for gas combi; much longer for heat pumps for example.
-void setMinBoilerOnMinutes(uint8_t mins) { OTV0P2BASE::eeprom_smart_update_byte((uint8_t *)V0P2BASE_EE_START_MIN_BOILER_ON_MINS_INV, ~(mins)); }
+void setMinBoilerOnMinutes(uint8_t mins)
+  {
+  eeQueueUpdateByte(EEW_CONFIG, (uint8_t *)V0P2BASE_EE_START_MIN_BOILER_ON_MINS_INV, ~(mins));
+#if defined(ENABLE_SETTINGS_CACHE)
+  settingsCache.minBoilerOnMinsInv = ~(mins); // Write through.
+#endif
+  }
 #endif
 
 #ifdef ENABLE_MODELLED_RAD_VALVE
+#if !defined(ENABLE_NV_STATS_RAM_SHADOW) && !defined(ENABLE_PACKED_NV_STATS)
 static OTV0P2BASE::EEPROMByHourByteStats ebhs;
+#endif
 // Create setback lockout if needed.
   typedef bool(*setbackLockout_t)();
 #if defined(ENABLE_SETBACK_LOCKOUT_COUNTDOWN) && defined(ARDUINO_ARCH_AVR)
@@ -53,6 +179,10 @@ static OTV0P2BASE::EEPROMByHourByteStats ebhs;
   static constexpr setbackLockout_t setbackLockout = NULL;
 #endif
 // Algorithm for computing target temperature.
+// NOTE: targets are whole degrees C through the library's TempControl API (and so EEPROM, CLI and stats),
+// and this class and OTRadValve::ModelledRadValveState convert them against C16 readings inside the library.
+// Moving the pipeline to C16 end to end has to be done there, not by wrapping the TempControl or cttBasic here;
+// the sketch keeps its own C/C16 conversions to compile-time constants or single shifts.
 constexpr OTRadValve::ModelledRadValveComputeTargetTempBasic<
   PARAMS,
   &valveMode,
@@ -62,17 +192,72 @@ constexpr OTRadValve::ModelledRadValveComputeTargetTempBasic<
   decltype(AmbLight),         &AmbLight,
   decltype(valveUI),          &valveUI,
   decltype(Scheduler),        &Scheduler,
+#if defined(ENABLE_NV_STATS_RAM_SHADOW) || defined(ENABLE_PACKED_NV_STATS)
+  decltype(eeStats),          &eeStats, // Share the shadow so unflushed updates are seen, and decode packed sets.
+#else
   decltype(ebhs),             &ebhs,
+#endif
   decltype(RelHumidity),      &RelHumidity,
   setbackLockout
   >
   cttBasic;
+#if defined(ENABLE_VALVE_MOVE_PLANNER) && defined(HAS_DORM1_VALVE_DRIVE)
+// Sits between the valve model and the DORM1 motor driver, holding back small corrections to save motor energy.
+// The model (NominalRadValve.get()) and so stats/call-for-heat are unaffected; only physical movement is filtered.
+//   * targets at or above the minimum really-open % are quantised to VMP_QUANTUM_PC
+//   * moves within the no-significant-flow band below that minimum are dropped
+//   * other moves smaller than VMP_DEADBAND_PC are held, the deadband doubling when
+//     the temperature is already moving the way the correction would push it
+//   * a held correction is applied after VMP_MAX_HOLD_M minutes anyway
+// Moves to fully shut or fully open, and all moves while the driver is not in normal run state, pass straight through.
+static constexpr uint8_t VMP_QUANTUM_PC = 5;
+static constexpr uint8_t VMP_DEADBAND_PC = 8;
+static constexpr uint8_t VMP_MAX_HOLD_M = 15;
+class ValveMovePlanner final : public OTRadValve::AbstractRadValve
+  {
+  private:
+    ValveDirect_t &target;
+    // Temperature at the previous set(), for the per-minute slope.
+    int16_t lastC16 = OTV0P2BASE::TemperatureC16Base::DEFAULT_INVALID_TEMP;
+    // Minutes the current correction has been held.
+    uint8_t heldM = 0;
+    // Moves held back today and in the previous whole day.
+    uint16_t savedToday = 0;
+    uint16_t savedYesterday = 0;
+
+  public:
+    ValveMovePlanner(ValveDirect_t &t) : target(t) { }
+    // Accept the model's new target, passing it to the driver only if worth moving for.
+    virtual bool set(uint8_t newValue) override;
+    // Does not drive the motor; ValveDirect.read() is polled separately.
+    virtual uint8_t read() override { return(value); }
+    virtual void signalValveFitted() override { target.signalValveFitted(); }
+    virtual bool isWaitingForValveToBeFitted() const override { return(target.isWaitingForValveToBeFitted()); }
+    virtual bool isInNormalRunState() const override { return(target.isInNormalRunState()); }
+    virtual bool isInErrorState() const override { return(target.isInErrorState()); }
+    virtual bool isControlledValveReallyOpen() const override { return(target.isControlledValveReallyOpen()); }
+    virtual uint8_t getMinPercentOpen() const override { return(target.getMinPercentOpen()); }
+    virtual void wiggle() override { target.wiggle(); }
+    // Roll the daily count over; call once a day.
+    void endOfDay() { savedYesterday = savedToday; savedToday = 0; }
+    // Moves held back in the previous whole day.
+    uint16_t getMovesSavedYesterday() const { return(savedYesterday); }
+  };
+static ValveMovePlanner valveMovePlanner(ValveDirect);
+#endif // defined(ENABLE_VALVE_MOVE_PLANNER) && defined(HAS_DORM1_VALVE_DRIVE)
+
 // Internal model of controlled radiator valve position.
+// NOTE: the anti-jitter temperature filter is held in OTRadValve::ModelledRadValveState inside the library,
+// not here. It is a 16-entry history walked once per minute, which costs a few hundred cycles.
+// The history also backs getRawDelta(n) for window-open detection, so a running-sum/EMA replacement
+// would have to be made there, and could not be done by wrapping TemperatureC16 for cttBasic.
 OTRadValve::ModelledRadValve NominalRadValve(
   &cttBasic,
   &valveMode,
   &tempControl,
-#ifdef HAS_DORM1_VALVE_DRIVE
+#if defined(ENABLE_VALVE_MOVE_PLANNER) && defined(HAS_DORM1_VALVE_DRIVE)
+  &valveMovePlanner,
+#elif defined(HAS_DORM1_VALVE_DRIVE)
   &ValveDirect,
 #else
   NULL,
@@ -88,6 +273,43 @@ OTRadValve::ModelledRadValve NominalRadValve(
     100
   #endif
   );
+
+#if defined(ENABLE_VALVE_MOVE_PLANNER) && defined(HAS_DORM1_VALVE_DRIVE)
+// Accept the model's new target, passing it to the driver only if worth moving for.
+// Called once per minute from NominalRadValve.read().
+bool ValveMovePlanner::set(const uint8_t newValue)
+  {
+  if(!isValid(newValue)) { return(false); }
+  const int16_t t = TemperatureC16.get();
+  const int16_t slope = (OTV0P2BASE::TemperatureC16Base::DEFAULT_INVALID_TEMP == lastC16) ? 0 : (t - lastC16);
+  lastC16 = t;
+  const uint8_t minOpen = NominalRadValve.getMinValvePcReallyOpen();
+  uint8_t planned = newValue;
+  if((planned >= minOpen) && (planned < 100))
+    { planned = OTV0P2BASE::fnmax(minOpen, OTV0P2BASE::fnmin((uint8_t)100, (uint8_t)(((planned + VMP_QUANTUM_PC/2) / VMP_QUANTUM_PC) * VMP_QUANTUM_PC))); }
+  const uint8_t current = value;
+  bool move = (planned != current);
+  if(!move) { heldM = 0; }
+  else if(target.isInNormalRunState() && (0 != planned) && (100 != planned))
+    {
+    const bool opening = (planned > current);
+    if((planned < minOpen) && (current < minOpen)) { move = false; } // No significant flow either way.
+    else if((planned >= minOpen) == (current >= minOpen))
+      {
+      const uint8_t delta = opening ? (planned - current) : (current - planned);
+      // Already warming when opening further, or cooling when closing: the change is partly happening anyway.
+      const bool drifting = opening ? (slope > 0) : (slope < 0);
+      const uint8_t deadband = drifting ? 2*VMP_DEADBAND_PC : VMP_DEADBAND_PC;
+      move = (delta >= deadband) || (++heldM >= VMP_MAX_HOLD_M);
+      }
+    if(!move && (savedToday < 0xffff)) { ++savedToday; }
+    }
+  if(!move) { return(true); }
+  heldM = 0;
+  value = planned;
+  return(target.set(planned));
+  }
+#endif // defined(ENABLE_VALVE_MOVE_PLANNER) && defined(HAS_DORM1_VALVE_DRIVE)
 #endif // ENABLE_MODELLED_RAD_VALVE
 
 
@@ -113,35 +335,286 @@ bool pollIO(const bool force)
     // there will usually be little time to do this
     // before getting an RX overrun or dropped frame.
     PrimaryRadio.poll();
+    chanSample();
+  #if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+    RFM23BAux.poll();
+  #endif
   #ifdef ENABLE_RADIO_SECONDARY_MODULE
-    SecondaryRadio.poll();
+    if(deferredInitDone(DI_SECONDARY_RADIO)) { SecondaryRadio.poll(); }
   #endif
     }
 #endif
   return(false);
   }
 
+#if defined(ENABLE_SECURE_STATS_TLV) && defined(ENABLE_STATS_TX)
+// Append one TLV item; returns NULL if there is no room, or if p is already NULL from an earlier failure.
+static uint8_t *tlvPut(uint8_t *p, const uint8_t *const end, const uint8_t code, const int16_t value, const bool twoBytes)
+  {
+  const uint8_t n = twoBytes ? 2 : 1;
+  if((NULL == p) || (p + 1 + n > end)) { return(NULL); }
+  *p++ = (uint8_t)((n << 6) | code);
+  if(twoBytes) { *p++ = (uint8_t)(value >> 8); }
+  *p++ = (uint8_t)value;
+  return(p);
+  }
+// Append a sensor's value if its sensitivity allows TX at privacyLevel, as SimpleStatsRotation does.
+template <class S>
+static uint8_t *tlvPutSensor(uint8_t *p, const uint8_t *const end, const uint8_t privacyLevel, const uint8_t code, const S &s, const bool twoBytes)
+  {
+  if(privacyLevel > s.sensitivity()) { return(p); }
+  return(tlvPut(p, end, code, (int16_t)s.get(), twoBytes));
+  }
+
+// Write TLV stats for this node, following the same sensor selection as the JSON stats.
+uint8_t writeStatsTLV(uint8_t *const buf, const uint8_t buflen, const uint8_t privacyLevel)
+  {
+  uint8_t *p = buf;
+  const uint8_t *const end = buf + buflen;
+  p = tlvPutSensor(p, end, privacyLevel, STLV_T_C16, TemperatureC16, true);
+#if defined(HUMIDITY_SENSOR_SUPPORT)
+  p = tlvPutSensor(p, end, privacyLevel, STLV_H_PC, RelHumidity, false);
+#endif // defined(HUMIDITY_SENSOR_SUPPORT)
+#if defined(ENABLE_OCCUPANCY_SUPPORT)
+  if(privacyLevel <= Occupancy.sensitivity()) { p = tlvPut(p, end, STLV_O, Occupancy.twoBitOccupancyValue(), false); }
+#if !defined(ENABLE_TRIMMED_BANDWIDTH)
+  p = tlvPutSensor(p, end, privacyLevel, STLV_VAC_H, Occupancy.vacHSubSensor, false);
+#endif // !defined(ENABLE_TRIMMED_BANDWIDTH)
+#endif // defined(ENABLE_OCCUPANCY_SUPPORT)
+  if(!Supply_cV.isMains()) { p = tlvPutSensor(p, end, privacyLevel, STLV_B_CV, Supply_cV, true); }
+#ifdef ENABLE_BOILER_HUB
+  p = tlvPut(p, end, STLV_B, isBoilerOn(), false);
+#endif // ENABLE_BOILER_HUB
+#ifdef ENABLE_AMBLIGHT_SENSOR
+  p = tlvPutSensor(p, end, privacyLevel, STLV_L, AmbLight, false);
+#endif // ENABLE_AMBLIGHT_SENSOR
+#if defined(ENABLE_LOCAL_TRV)
+  p = tlvPutSensor(p, end, privacyLevel, STLV_V_PC, NominalRadValve, false);
+  p = tlvPutSensor(p, end, privacyLevel, STLV_TT_C, NominalRadValve.targetTemperatureSubSensor, false);
+  p = tlvPutSensor(p, end, privacyLevel, STLV_TS_C, NominalRadValve.setbackSubSensor, false);
+#if !defined(ENABLE_TRIMMED_BANDWIDTH)
+  p = tlvPutSensor(p, end, privacyLevel, STLV_VC_PC, NominalRadValve.cumulativeMovementSubSensor, true);
+#endif // !defined(ENABLE_TRIMMED_BANDWIDTH)
+#endif // defined(ENABLE_LOCAL_TRV)
+#ifdef ENABLE_SETBACK_LOCKOUT_COUNTDOWN
+  p = tlvPut(p, end, STLV_GE, OTRadValve::getSetbackLockout(), false);
+#endif // ENABLE_SETBACK_LOCKOUT_COUNTDOWN
+  if(NULL == p) { return(0); }
+  return((uint8_t)(p - buf));
+  }
+#endif // ENABLE_SECURE_STATS_TLV
+
 #ifdef ENABLE_STATS_TX
 #if defined(ENABLE_JSON_OUTPUT)
 // Managed JSON stats.
-static OTV0P2BASE::SimpleStatsRotation<12> ss1; // Configured for maximum different stats.	// FIXME increased for voice & for setback lockout
+// Capacity is exactly the number of keys that bareStatsTX() can put in this build,
+// counted under the same conditions; keep the two in step when adding stats.
+static constexpr uint8_t SS1_KEYS =
+    1 // TemperatureC16.
+#ifdef OTV0P2BASE_ErrorReport_DEFINED
+  + 1 // Error reports.
+#endif
+#if defined(HUMIDITY_SENSOR_SUPPORT)
+  + 1 // RelHumidity.
+#endif
+#if defined(ENABLE_OCCUPANCY_SUPPORT)
+  + 1 // Two-bit occupancy.
+#if !defined(ENABLE_TRIMMED_BANDWIDTH)
+  + 1 // vac|h.
+#endif
+#endif
+  + 1 // Supply_cV.
+#ifdef ENABLE_BOILER_HUB
+  + 1 // b.
+#if defined(ENABLE_BOILER_HUB_VALVE_TABLE)
+  + 1 // bN.
+#endif
+#if defined(ENABLE_BOILER_DEMAND_MODEL)
+  + 2 // bL|%, bS.
+#endif
+#endif
+#ifdef ENABLE_AMBLIGHT_SENSOR
+  + 1 // AmbLight.
+#endif
+#ifdef ENABLE_VOICE_STATS
+  + 1 // Voice.
+#endif
+#if defined(ENABLE_LOCAL_TRV)
+  + 3 // Valve %, target and setback temperatures.
+#if !defined(ENABLE_TRIMMED_BANDWIDTH)
+  + 1 // Cumulative movement.
+#endif
+#endif
+#ifdef ENABLE_SETBACK_LOCKOUT_COUNTDOWN
+  + 1 // gE.
+#endif
+#if defined(ENABLE_LINK_STATS)
+  + 4 // rD, rE, tF, jF.
+#endif
+#if defined(ENABLE_CHANNEL_UTILISATION)
+  + 3 // cU|%, cF, cX.
+#endif
+#if defined(ENABLE_ENERGY_ACCOUNTING)
+  + 1 // I|uA.
+#endif
+#if defined(ENABLE_BATTERY_LIFE_ESTIMATE)
+  + 1 // bD|d.
+#endif
+#if defined(ENABLE_VALVE_MOVE_PLANNER) && defined(HAS_DORM1_VALVE_DRIVE) && defined(ENABLE_MODELLED_RAD_VALVE)
+  + 1 // vS.
+#endif
+#if defined(ENABLE_STACK_TAGS)
+  + 1 // sH.
+#endif
+  ;
+static OTV0P2BASE::SimpleStatsRotation<SS1_KEYS> ss1;
+
+#if defined(ENABLE_STATS_FRESHNESS)
+// Low-priority keys are scored on each pass and only the best that fit a per-frame byte budget are left in ss1,
+// so slow-changing values do not take airtime every frame yet none goes stale at the hub.
+// Score = minutes since sent * per-key priority (1..4) + 4 * |change since sent| (capped);
+// a key never sent or unsent for STATS_FRESH_MAX_AGE_M always scores highest, and one under STATS_FRESH_MIN_SCORE waits.
+// So that none starves, keys with equal scores take turns, and the first key chosen for a frame is sent
+// if it scores highest even when it alone exceeds the budget.
+static constexpr uint8_t STATS_FRESH_SLOTS = 16;
+static constexpr uint8_t STATS_FRESH_MIN_SCORE = 8;
+static constexpr uint8_t STATS_FRESH_MAX_AGE_M = 60;
+// Bytes of low-priority JSON fields per frame, after the core fields; secure frames have far less room.
+static constexpr uint8_t STATS_FRESH_BUDGET_SECURE = 12;
+static constexpr uint8_t STATS_FRESH_BUDGET_PLAIN = 32;
+typedef struct
+  {
+  OTV0P2BASE::SimpleStatsKey key; // NULL if unused.
+  int16_t sentValue; // As last left in ss1.
+  int16_t value; // As offered this pass.
+  uint16_t sentM; // Minutes since midnight when last left in ss1; 0xffff if never.
+  uint8_t prio;
+  bool offered; // Offered this pass.
+  } statsFresh_t;
+static statsFresh_t statsFresh[STATS_FRESH_SLOTS];
+// Slot from which each pass starts looking, advanced every pass, so that ties are broken round-robin.
+static uint8_t statsFreshStart;
+// Offer a low-priority key and value for this pass; decided by statsFreshCommit().
+static void statsFreshPut(const OTV0P2BASE::SimpleStatsKey key, const int value, const uint8_t prio)
+  {
+  statsFresh_t *slot = NULL;
+  for(statsFresh_t *f = statsFresh; f < statsFresh + STATS_FRESH_SLOTS; ++f)
+    {
+    if(key == f->key) { slot = f; break; }
+    if((NULL == slot) && (NULL == f->key)) { slot = f; }
+    }
+  // Table full (more keys than slots): just queue it as without scoring.
+  if(NULL == slot) { ss1.put(key, value, true); return; }
+  if(key != slot->key) { slot->key = key; slot->sentM = 0xffff; }
+  slot->value = (int16_t)value;
+  slot->prio = prio;
+  slot->offered = true;
+  }
+static uint8_t statsFreshScore(const statsFresh_t &f, const uint16_t nowM)
+  {
+  if(0xffff == f.sentM) { return(255); }
+  const uint16_t ageM = (nowM + OTV0P2BASE::MINS_PER_DAY - f.sentM) % OTV0P2BASE::MINS_PER_DAY;
+  if(ageM >= STATS_FRESH_MAX_AGE_M) { return(255); }
+  const int16_t d = f.value - f.sentValue;
+  const uint8_t change = (uint8_t)OTV0P2BASE::fnmin((d < 0) ? -d : d, 15);
+  return((uint8_t)OTV0P2BASE::fnmin((uint16_t)(ageM * f.prio + 4*change), (uint16_t)254));
+  }
+// Approximate JSON bytes for the field: "key":value,
+static uint8_t statsFreshCost(const statsFresh_t &f)
+  {
+  uint8_t n = (uint8_t)(strlen(f.key) + 4);
+  int16_t v = f.value;
+  if(v < 0) { ++n; v = -v; }
+  do { ++n; v /= 10; } while(0 != v);
+  return(n);
+  }
+// Leave in ss1 the highest-scoring offered keys that fit budget bytes, and remove the rest (including any not offered).
+static void statsFreshCommit(uint8_t budget)
+  {
+  const uint16_t nowM = OTV0P2BASE::getMinutesSinceMidnightLT();
+  statsFreshStart = (statsFreshStart + 1) % STATS_FRESH_SLOTS;
+  for(bool first = true; ; first = false)
+    {
+    statsFresh_t *best = NULL;
+    uint8_t bestScore = STATS_FRESH_MIN_SCORE - 1;
+    for(uint8_t i = 0; i < STATS_FRESH_SLOTS; ++i)
+      {
+      statsFresh_t *const f = statsFresh + ((statsFreshStart + i) % STATS_FRESH_SLOTS);
+      if(!f->offered) { continue; }
+      const uint8_t sc = statsFreshScore(*f, nowM);
+      if(sc > bestScore) { best = f; bestScore = sc; }
+      }
+    if(NULL == best) { break; }
+    best->offered = false;
+    const uint8_t cost = statsFreshCost(*best);
+    if((cost > budget) && !(first && (255 == bestScore))) { ss1.remove(best->key); continue; }
+    budget = (cost > budget) ? 0 : (budget - cost);
+    ss1.put(best->key, best->value, true);
+    best->sentValue = best->value;
+    best->sentM = nowM;
+    }
+  // Offered but not chosen, and keys no longer offered.
+  for(statsFresh_t *f = statsFresh; f < statsFresh + STATS_FRESH_SLOTS; ++f)
+    {
+    if((NULL == f->key) || (f->sentM == nowM)) { f->offered = false; continue; }
+    ss1.remove(f->key);
+    f->offered = false;
+    }
+  }
+#define ss1PutLow(key, value, prio) statsFreshPut((key), (value), (prio))
+#else
+#define ss1PutLow(key, value, prio) ss1.put((key), (value), true)
+#endif // ENABLE_STATS_FRESHNESS
+#if defined(ENABLE_STATS_KEY_SUBSCRIPTION)
+// Put sensor s only if the hub's site wants its key (a STATS_SUB_XXX bit), else drop it from the rotation.
+#define ss1PutWanted(key, s) { if(statsKeyWanted(key)) { ss1.put(s); } else { ss1.remove((s).tag()); } }
+#else
+#define ss1PutWanted(key, s) ss1.put(s)
+#define statsKeyWanted(key) (true)
+#endif // ENABLE_STATS_KEY_SUBSCRIPTION
+
+// Print JSON stats of length len (excluding the trailing '\0') as OTV0P2BASE::outputJSONStats() does,
+// and in the same single pass validate it and compute the 7-bit TX CRC,
+// as OTV0P2BASE::adjustJSONMsgForTXAndComputeCRC() would after setting the high bit on the final '}'.
+// Does not alter the buffer, so the caller must set that high bit itself before TX.
+// Returns the CRC [0,127], or 0xff (having printed just an error line) if the JSON is invalid.
+static uint8_t outputJSONStatsAndComputeTXCRC(Print *const p, const uint8_t *const json, const uint8_t len)
+  {
+  if((len < 2) || (len > OTV0P2BASE::MSG_JSON_MAX_LENGTH) || ('{' != json[0]) || ('}' != json[len-1]))
+    { p->println(F("!JSON bad")); return(0xff); }
+  uint8_t crc = '{';
+  for(uint8_t i = 1; i < len-1; ++i)
+    {
+    const uint8_t c = json[i];
+    if((c < 32) || (c > 126)) { p->println(F("!JSON bad")); return(0xff); }
+    crc = crc7Update(crc, c);
+    }
+  p->write(json, len);
+  p->println();
+  return(crc7Update(crc, '}' | 0x80));
+  }
 #endif // ENABLE_STATS_TX
+#if defined(ENABLE_TX_PENDING_QUEUE)
+// Retry a secure stats frame that failed to send, with current stats and a fresh message counter.
+static void bareStatsRetry() { bareStatsTX(); }
+#endif
 // Do bare stats transmission.
 // Output should be filtered for items appropriate
 // to current channel security and sensitivity level.
 // This may be binary or JSON format.
 //   * allowDoubleTX  allow double TX to increase chance of successful reception
 //   * doBinary  send binary form if supported, else JSON form if supported
-// Sends stats on primary radio channel 0 with possible duplicate to secondary channel.
+// Sends stats on primaryRadioChannel() with possible duplicate to secondary channel.
 // If sending encrypted then ID/counter fields (eg @ and + for JSON) are omitted
 // as assumed supplied by security layer to remote recipent.
-void bareStatsTX(const bool allowDoubleTX, const bool doBinary)
+// Returns true if a stats frame was built and queued for TX.
+bool bareStatsTX(const bool allowDoubleTX, const bool doBinary)
   {
   // Capture heavy stack usage from local allocations here.
   OTV0P2BASE::MemoryChecks::recordIfMinSP();
 
   // Note if radio/comms channel is itself framed.
-  const bool framed = !PrimaryRadio.getChannelConfig()->isUnframed;
+  const bool framed = !PrimaryRadio.getChannelConfig(primaryRadioChannel())->isUnframed;
 #if defined(ENABLE_RFM23B_FS20_RAW_PREAMBLE)
   // Add RFM23B preamble and a trailing CRC to the frame IFF channel is unframed.
   const bool RFM23BFramed = !framed;
@@ -155,7 +628,7 @@ void bareStatsTX(const bool allowDoubleTX, const bool doBinary)
   const bool doEnc = false;
 #endif
 
-  const bool neededWaking = OTV0P2BASE::powerUpSerialIfDisabled<>();
+  const PeripheralPower<PP_SERIAL> serialPower;
   
 static_assert(OTV0P2BASE::FullStatsMessageCore_MAX_BYTES_ON_WIRE <= STATS_MSG_MAX_LEN, "FullStatsMessageCore_MAX_BYTES_ON_WIRE too big");
 static_assert(OTV0P2BASE::MSG_JSON_MAX_LENGTH+1 <= STATS_MSG_MAX_LEN, "MSG_JSON_MAX_LENGTH too big"); // Allow 1 for trailing CRC.
@@ -166,8 +639,18 @@ static_assert(OTV0P2BASE::MSG_JSON_MAX_LENGTH+1 <= STATS_MSG_MAX_LEN, "MSG_JSON_
   //   * terminating 0xff
 //  uint8_t buf[STATS_MSG_START_OFFSET + max(FullStatsMessageCore_MAX_BYTES_ON_WIRE,  MSG_JSON_MAX_LENGTH+1) + 1];
   // Buffer need be no larger than leading length byte + typical 64-byte radio module TX buffer limit + optional terminator.
+  // NOTE: lifting the 64-byte limit needs FIFO threshold-interrupt streaming inside OTRFM23BLink (not in this tree),
+  // and would only help insecure JSON: secure frames carry a fixed 32-byte body whatever the radio can send.
+  // Only the JSON path uses it; the binary frame has its own small buffer.
+#if defined(ENABLE_JSON_OUTPUT)
   const uint8_t MSG_BUF_SIZE = 1 + 64 + 1;
+#if defined(ENABLE_SCRATCH_ARENA)
+  static_assert(MSG_BUF_SIZE == SCRATCH_TX_FRAME_SIZE, "scratch TX frame size mismatch");
+  uint8_t (&buf)[MSG_BUF_SIZE] = scratchRegion<SCRATCH_TX_FRAME_OFF, MSG_BUF_SIZE>();
+#else
   uint8_t buf[MSG_BUF_SIZE];
+#endif
+#endif // ENABLE_JSON_OUTPUT
 
 #if defined(ENABLE_JSON_OUTPUT)
   if(doBinary && !doEnc) // Note that binary form is not secure, so not permitted for secure systems.
@@ -177,25 +660,23 @@ static_assert(OTV0P2BASE::MSG_JSON_MAX_LENGTH+1 <= STATS_MSG_MAX_LEN, "MSG_JSON_
     // Send binary message first (insecure, FS20-piggyback format).
     // Gather core stats.
     OTV0P2BASE::FullStatsMessageCore_t content;
-    OTRadValve::populateCoreStats(&content,
-                    (localFHT8VTRVEnabled() ? &FHT8V : NULL),
-                    TemperatureC16.get(),
-                    Supply_cV.isSupplyVoltageLow(),
-                    AmbLight.get(),
-                    Occupancy.twoBitOccupancyValue());
-    const uint8_t *msg1 = OTV0P2BASE::encodeFullStatsMessageCore(buf + STATS_MSG_START_OFFSET, sizeof(buf) - STATS_MSG_START_OFFSET, OTV0P2BASE::getStatsTXLevel(), false, &content);
+    populateCoreStatsFromSensors(&content);
+    // Preamble, then the core message and its terminating 0xff.
+    uint8_t bbuf[STATS_MSG_START_OFFSET + OTV0P2BASE::FullStatsMessageCore_MAX_BYTES_ON_WIRE + 1];
+    const uint8_t *msg1 = OTV0P2BASE::encodeFullStatsMessageCore(RFM22RXPreambleAdd(bbuf), sizeof(bbuf) - STATS_MSG_START_OFFSET, getStatsTXLevelCached(), false, &content);
     if(NULL == msg1)
       {
 #if 0
 DEBUG_SERIAL_PRINTLN_FLASHSTRING("Bin gen err!");
 #endif
-      return;
+      return(false);
       }
-    // Send it!
-    RFM22RawStatsTXFFTerminated(buf, allowDoubleTX);
+    // Send it, the encoder having given the length.
+    RFM22RawStatsTX(bbuf, (uint8_t)(msg1 - bbuf), allowDoubleTX);
     // Record stats as if remote, and treat channel as secure.
     outputCoreStats(&Serial, true, &content);
     handleQueuedMessages(&Serial, false, &PrimaryRadio); // Serial must already be running!
+    return(true);
 #endif // defined(ENABLE_BINARY_STATS_TX) ...
     }
 
@@ -266,44 +747,88 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("Bin gen err!");
 #endif
     ss1.put(TemperatureC16);
 #if defined(HUMIDITY_SENSOR_SUPPORT)
-    ss1.put(RelHumidity);
+    ss1PutWanted(STATS_SUB_RH, RelHumidity);
 #endif // defined(HUMIDITY_SENSOR_SUPPORT)
 #if defined(ENABLE_OCCUPANCY_SUPPORT)
     ss1.put(Occupancy.twoBitTag(), Occupancy.twoBitOccupancyValue()); // Reduce spurious TX cf percentage.
 #if !defined(ENABLE_TRIMMED_BANDWIDTH)
-    ss1.put(Occupancy.vacHSubSensor);
+    ss1PutWanted(STATS_SUB_VACANCY, Occupancy.vacHSubSensor);
 #endif // !defined(ENABLE_TRIMMED_BANDWIDTH)
 #endif // defined(ENABLE_OCCUPANCY_SUPPORT)
     // OPTIONAL items
     // Only TX supply voltage for units apparently not mains powered, and TX with low priority as slow changing.
-    if(!Supply_cV.isMains()) { ss1.put(Supply_cV, true); } else { ss1.remove(Supply_cV.tag()); }
+    if(!Supply_cV.isMains() && statsKeyWanted(STATS_SUB_SUPPLY)) { ss1PutLow(Supply_cV.tag(), Supply_cV.get(), 1); } else { ss1.remove(Supply_cV.tag()); }
 #ifdef ENABLE_BOILER_HUB
     // Show boiler state for boiler hubs.
     ss1.put(V0p2_SENSOR_TAG_F("b"), (int) isBoilerOn());
+#if defined(ENABLE_BOILER_HUB_VALVE_TABLE)
+    // Show how many valves are calling for heat.
+    ss1PutLow(V0p2_SENSOR_TAG_F("bN"), (int) hubValvesCalling(), 4);
+#endif
+#if defined(ENABLE_BOILER_DEMAND_MODEL)
+    // Show modulating demand level and boiler starts today, to check the model against.
+    ss1PutLow(V0p2_SENSOR_TAG_F("bL|%"), (int) boilerDemandLevelPC(), 4);
+    ss1PutLow(V0p2_SENSOR_TAG_F("bS"), (int) boilerStartsToday(), 1);
+#endif
 #endif // ENABLE_BOILER_HUB
 #ifdef ENABLE_AMBLIGHT_SENSOR
-    ss1.put(AmbLight); // Always send ambient light level (assuming sensor is present).
+    ss1PutWanted(STATS_SUB_AMBLIGHT, AmbLight); // Send ambient light level (assuming sensor is present) unless unwanted.
 #endif // ENABLE_AMBLIGHT_SENSOR
 #ifdef ENABLE_VOICE_STATS
-    ss1.put(Voice);
+    ss1PutWanted(STATS_SUB_VOICE, Voice);
 #endif // ENABLE_VOICE_STATS
 #if defined(ENABLE_LOCAL_TRV)
     // Show TRV-related stats since enabled.
     ss1.put(NominalRadValve); // Show modelled value to be able to deduce call-for-heat.
-    ss1.put(NominalRadValve.targetTemperatureSubSensor);
-    ss1.put(NominalRadValve.setbackSubSensor);
+    ss1PutWanted(STATS_SUB_TARGET, NominalRadValve.targetTemperatureSubSensor);
+    ss1PutWanted(STATS_SUB_SETBACK, NominalRadValve.setbackSubSensor);
 #if !defined(ENABLE_TRIMMED_BANDWIDTH)
-    ss1.put(NominalRadValve.cumulativeMovementSubSensor);
+    ss1PutWanted(STATS_SUB_MOVEMENT, NominalRadValve.cumulativeMovementSubSensor);
 #endif // !defined(ENABLE_TRIMMED_BANDWIDTH)
 #endif // defined(ENABLE_LOCAL_TRV)
 #ifdef ENABLE_SETBACK_LOCKOUT_COUNTDOWN
     // Show state of setback lockout.
-    ss1.put(V0p2_SENSOR_TAG_F("gE"), OTRadValve::getSetbackLockout(), true);
+    ss1PutLow(V0p2_SENSOR_TAG_F("gE"), OTRadValve::getSetbackLockout(), 2);
 #endif // ENABLE_SETBACK_LOCKOUT_COUNTDOWN
+#if defined(ENABLE_LINK_STATS)
+    // Radio link health, low priority as these rarely change.
+    linkPollRXErrs();
+    ss1PutLow(V0p2_SENSOR_TAG_F("rD"), PrimaryRadio.getRXMsgsDroppedRecent(), 1);
+    ss1PutLow(V0p2_SENSOR_TAG_F("rE"), linkRXErrs, 1);
+    ss1PutLow(V0p2_SENSOR_TAG_F("tF"), linkTXFails, 1);
+    ss1PutLow(V0p2_SENSOR_TAG_F("jF"), linkJSONFails, 1);
+#endif // ENABLE_LINK_STATS
+#if defined(ENABLE_CHANNEL_UTILISATION)
+    // Channel load over the last minute; utilisation moves most so is offered more often.
+    if(0xff != chanUtilPC) { ss1PutLow(V0p2_SENSOR_TAG_F("cU|%"), chanUtilPC, 2); }
+    ss1PutLow(V0p2_SENSOR_TAG_F("cF"), chanFrames, 1);
+    ss1PutLow(V0p2_SENSOR_TAG_F("cX"), chanBadFrames, 1);
+#endif // ENABLE_CHANNEL_UTILISATION
+#if defined(ENABLE_ENERGY_ACCOUNTING)
+    // Estimated mean supply current, low priority as it changes slowly.
+    // Capped rather than wrapping negative as stats values are (16-bit) int, eg while a mains-powered radio is listening.
+    ss1PutLow(V0p2_SENSOR_TAG_F("I|uA"), (int) OTV0P2BASE::fnmin(energyMeanMicroAmps(), (uint16_t)0x7fff), 1);
+#endif // ENABLE_ENERGY_ACCOUNTING
+#if defined(ENABLE_BATTERY_LIFE_ESTIMATE)
+    // Estimated days to battery empty, low priority as it changes at most daily.
+    { const uint16_t bD = batteryDaysToEmpty();
+      if(BATTERY_DAYS_UNKNOWN != bD) { ss1PutLow(V0p2_SENSOR_TAG_F("bD|d"), (int) bD, 1); } else { ss1.remove(V0p2_SENSOR_TAG_F("bD|d")); } }
+#endif // ENABLE_BATTERY_LIFE_ESTIMATE
+#if defined(ENABLE_VALVE_MOVE_PLANNER) && defined(HAS_DORM1_VALVE_DRIVE) && defined(ENABLE_MODELLED_RAD_VALVE)
+    // Valve movements held back by the planner yesterday, low priority as it changes daily.
+    ss1PutLow(V0p2_SENSOR_TAG_F("vS"), (int) valveMovePlanner.getMovesSavedYesterday(), 1);
+#endif
+#if defined(ENABLE_STACK_TAGS)
+    // Worst tagged stack headroom, low priority as it only changes when a deeper path is first taken.
+    { const int16_t sH = stackTagsMinHeadroom(); if(sH >= 0) { ss1PutLow(V0p2_SENSOR_TAG_F("sH"), sH, 1); } }
+#endif // ENABLE_STACK_TAGS
+#if defined(ENABLE_STATS_FRESHNESS)
+    statsFreshCommit(doEnc ? STATS_FRESH_BUDGET_SECURE : STATS_FRESH_BUDGET_PLAIN);
+#endif
 #if defined(ENABLE_ALWAYS_TX_ALL_STATS)
     const uint8_t privacyLevel = OTV0P2BASE::stTXalwaysAll;
 #else
-    const uint8_t privacyLevel = OTV0P2BASE::getStatsTXLevel();
+    const uint8_t privacyLevel = getStatsTXLevelCached();
 #endif
 
     // Buffer to write JSON to before encryption.
@@ -311,7 +836,11 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("Bin gen err!");
     //    ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE - 2 leading body bytes + for trailing '}' not sent.
     const uint8_t maxSecureJSONSize = OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE - 2 + 1;
     // writeJSON() requires two further bytes including one for the trailing '\0'.
+#if defined(ENABLE_SCRATCH_ARENA)
+    uint8_t (&ptextBuf)[maxSecureJSONSize + 2] = scratchRegion<SCRATCH_TX_PTEXT_OFF, SCRATCH_TX_PTEXT_SIZE>();
+#else
     uint8_t ptextBuf[maxSecureJSONSize + 2];
+#endif
 
     // Allow for a cap on JSON TX size, eg where TX is lossy for near-maximum sizes.
     // This can only reduce the maximum size, and it should not try to make it silly small.
@@ -335,7 +864,11 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("Bin gen err!");
       {
       // Generate JSON and write to appropriate buffer:
       // direct to TX buffer if not encrypting, else to separate buffer.
-      wrote = ss1.writeJSON(bufJSON, bufJSONlen, privacyLevel, maximise); //!allowDoubleTX && randRNG8NextBoolean());
+      // NOTE: SimpleStatsRotation (OTV0P2BASE) formats the selected keys afresh each time;
+      // caching formatted fragments per key (re-formatting only changed values)
+      // would have to be done inside the library as only it knows the selection and order.
+      stackTag(STACK_TAG_TX_JSON);
+      { const CPUClockBoost boost; wrote = ss1.writeJSON(bufJSON, bufJSONlen, privacyLevel, maximise); } //!allowDoubleTX && randRNG8NextBoolean());
       if(0 == wrote)
         {
 #if 0 && defined(DEBUG)
@@ -346,6 +879,8 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("JSON gen err!");
       }
 
     // Push the JSON output to Serial.
+    // For plaintext TX the on-the-wire CRC is computed in the same pass.
+    uint8_t txCRC = 0xff;
     if(!sendingJSONFailed)
       {
  #if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
@@ -353,23 +888,29 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("JSON gen err!");
         {
         // Insert synthetic full ID/@ field for local stats, but no sequence number for now.
         Serial.print(F("{\"@\":\""));
-        for(int i = 0; i < OTV0P2BASE::OpenTRV_Node_ID_Bytes; ++i) { Serial.print(eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_ID+i), HEX); }
+        { uint8_t id[OTV0P2BASE::OpenTRV_Node_ID_Bytes];
+          for(uint8_t i = 0; i < sizeof(id); ++i) { id[i] = getNodeIDByte(i); }
+          printIDHex(&Serial, id, sizeof(id)); }
         Serial.print(F("\","));
         Serial.write(bufJSON+1, wrote-1);
         Serial.println();
         }
       else
 #endif // defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
-        { OTV0P2BASE::outputJSONStats(&Serial, true, bufJSON, bufJSONlen); } // Serial must already be running!
+        { txCRC = outputJSONStatsAndComputeTXCRC(&Serial, bufJSON, wrote); } // Serial must already be running!
       OTV0P2BASE::flushSerialSCTSensitive(); // Ensure all flushed since system clock may be messed with...
       }
 
     // Get the 'building' key for stats sending.
+#if defined(ENABLE_SCRATCH_ARENA)
+    uint8_t (&key)[16] = scratchRegion<SCRATCH_TX_KEY_OFF, SCRATCH_KEY_SIZE>();
+#else
     uint8_t key[16];
+#endif
     if(!sendingJSONFailed && doEnc)
       {
 #if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
-      if(!OTV0P2BASE::getPrimaryBuilding16ByteSecretKey(key))
+      if(!getPrimaryBuildingKey(key))
         {
         sendingJSONFailed = true;
         OTV0P2BASE::serialPrintlnAndFlush(F("!TX key")); // Know why TX failed.
@@ -379,32 +920,71 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("JSON gen err!");
 #endif // defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
       }
 
+#if defined(ENABLE_SECURE_TX_ACK)
+    // Set if the hub should acknowledge the frame, eg as it carries a valve %.
+    bool wantAck = false;
+#endif
     // If doing encryption
     // then build encrypted frame from raw JSON.
     if(!sendingJSONFailed && doEnc)
       {
 #if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
-      // Explicit-workspace version of encryption.
-      const OTRadioLink::SimpleSecureFrame32or0BodyTXBase::fixed32BTextSize12BNonce16BTagSimpleEncWithWorkspace_ptr_t eW = OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleEnc_DEFAULT_WITH_WORKSPACE;
-      constexpr uint8_t workspaceSize = OTRadioLink::SimpleSecureFrame32or0BodyTXBase::generateSecureOFrameRawForTX_total_scratch_usage_OTAESGCM_2p0;
-      uint8_t workspace[workspaceSize];
-      OTV0P2BASE::ScratchSpace sW(workspace, workspaceSize);
+      // Encryption is the longest pure-compute burst, so run it as fast as allowed.
+      const CPUClockBoost boost;
+      stackTag(STACK_TAG_TX_SECURE);
       const uint8_t txIDLen = OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES;
       // When sending on a channel with framing, do not explicitly send the frame length byte.
       const uint8_t offset = framed ? 1 : 0;
       // Assumed to be at least one free writeable byte ahead of bptr.
 #if defined(ENABLE_NOMINAL_RAD_VALVE)
-      // Get current modelled valve position.
-      const uint8_t valvePC = NominalRadValve.get();
+      // Get current modelled valve position, as advertised for call for heat.
+      const uint8_t valvePC = callForHeatValvePC();
 #else
       // Distinguished 'invalid' valve position; never mistaken for a real valve.
       const uint8_t valvePC = 0x7f;
 #endif // defined(ENABLE_NOMINAL_RAD_VALVE)
-      const uint8_t bodylen = OTRadioLink::SimpleSecureFrame32or0BodyTXV0p2::getInstance().generateSecureOFrameRawForTX(
+#if defined(ENABLE_SECURE_STATS_TLV)
+      // Send compact binary stats rather than the JSON text (which is only printed locally).
+      // The JSON is no longer needed so build the body in its buffer, sparing stack at this deepest point.
+      static_assert(sizeof(ptextBuf) >= OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE, "ptextBuf too small for TLV body");
+      uint8_t *const tlvBody = ptextBuf;
+      tlvBody[0] = (valvePC <= 100) ? valvePC : 0x7f;
+      tlvBody[1] = STATS_TLV_BODY_FLAG;
+      const uint8_t tlvLen = writeStatsTLV(tlvBody + 2, OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE - 2, privacyLevel);
+      const uint8_t tlvBodyLen = 2 + tlvLen;
+      // Send nothing rather than a silently truncated set of stats.
+      const uint8_t bodylen = (0 == tlvLen) ? 0 : secureTX().generateSecureOStyleFrameForTX(
+            realTXFrameStart - offset, sizeof(buf) - (realTXFrameStart-buf) + offset,
+            OTRadioLink::FTS_BasicSensorOrValve, txIDLen, tlvBody, tlvBodyLen,
+            secureFrameEnc, NULL, key);
+#elif defined(ENABLE_FAST_AES128)
+      // The faster AES core needs little enough stack to use the stateless version directly.
+      const uint8_t bodylen = secureTX().generateSecureOFrameRawForTX(
+            realTXFrameStart - offset, sizeof(buf) - (realTXFrameStart-buf) + offset,
+            txIDLen, valvePC, (const char *)bufJSON, secureFrameEnc, NULL, key);
+#else
+      // Explicit-workspace version of encryption.
+      const OTRadioLink::SimpleSecureFrame32or0BodyTXBase::fixed32BTextSize12BNonce16BTagSimpleEncWithWorkspace_ptr_t eW = OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleEnc_DEFAULT_WITH_WORKSPACE;
+      constexpr uint8_t workspaceSize = OTRadioLink::SimpleSecureFrame32or0BodyTXBase::generateSecureOFrameRawForTX_total_scratch_usage_OTAESGCM_2p0;
+#if defined(ENABLE_SCRATCH_ARENA)
+      OTV0P2BASE::ScratchSpace sW(scratchRegion<SCRATCH_TX_WORKSPACE_OFF, workspaceSize>(), workspaceSize);
+#else
+      uint8_t workspace[workspaceSize];
+      OTV0P2BASE::ScratchSpace sW(workspace, workspaceSize);
+#endif
+      const uint8_t bodylen = secureTX().generateSecureOFrameRawForTX(
             realTXFrameStart - offset, sizeof(buf) - (realTXFrameStart-buf) + offset,
             txIDLen, valvePC, (const char *)bufJSON, eW, sW, key);
+#endif // ENABLE_SECURE_STATS_TLV
       sendingJSONFailed = (0 == bodylen);
       wrote = bodylen - offset;
+#if defined(ENABLE_SECURE_TX_ACK)
+      // Without the length byte, the sequence number is the top nibble of the second (seq/ID length) header byte.
+      wantAck = framed && secureFrameWantsAck(valvePC, realTXFrameStart[1] >> 4) && !inHubMode();
+#endif
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME) && defined(ENABLE_NOMINAL_RAD_VALVE)
+      if(!sendingJSONFailed) { noteValvePCReported(valvePC); }
+#endif
 #else
       sendingJSONFailed = true; // Crypto support may not be available.
 #endif // defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
@@ -420,7 +1000,7 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("JSON gen err!");
       // Write out unadjusted JSON or encrypted frame on secondary radio.
 //      SecondaryRadio.queueToSend(realTXFrameStart, doEnc ? (bptr - realTXFrameStart) : wrote);
       // Assumes that framing (or not) of primary and secondary radios is the same (usually: both framed).
-      SecondaryRadio.queueToSend(realTXFrameStart, wrote);
+      secondaryTXDeferred(realTXFrameStart, wrote);
       }
 #endif // ENABLE_RADIO_SECONDARY_MODULE
 
@@ -434,12 +1014,13 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("JSON gen err!");
       // (Set high-bit on final closing brace to make it unique, and compute (non-0xff) CRC.)
       if(!doEnc)
           {
-          const uint8_t crc = OTV0P2BASE::adjustJSONMsgForTXAndComputeCRC((char *)bptr);
-          if(0xff == crc) { sendingJSONFailed = true; }
+          // The CRC was computed as the JSON was printed, before the secondary radio took an unadjusted copy.
+          if(0xff == txCRC) { sendingJSONFailed = true; }
           else
             {
+            bptr[wrote-1] |= 0x80;
             bptr += wrote;
-            *bptr++ = crc; // Add 7-bit CRC for on-the-wire check.
+            *bptr++ = txCRC; // Add 7-bit CRC for on-the-wire check.
             ++wrote;
             }
           }
@@ -455,21 +1036,310 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("JSON gen err!");
 #endif
         {
         // Send directly to the primary radio...
-        if(!PrimaryRadio.queueToSend(realTXFrameStart, wrote)) { sendingJSONFailed = true; }
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK)
+        // The double-TX decision is driven by link feedback, so honour it here too.
+        const OTRadioLink::OTRadioLink::TXpower txPower = allowDoubleTX ? OTRadioLink::OTRadioLink::TXmax : OTRadioLink::OTRadioLink::TXnormal;
+#else
+        const OTRadioLink::OTRadioLink::TXpower txPower = OTRadioLink::OTRadioLink::TXnormal;
+#endif // ENABLE_LINK_QUALITY_FEEDBACK
+#if defined(ENABLE_NOMINAL_RAD_VALVE)
+        // A valve's call for heat may use the TX duty-cycle reserve.
+        const TXDutyCritical critical(doEnc && NominalRadValve.isControlledValveReallyOpen() && (0 != callForHeatValvePC()));
+#endif
+        bool queued;
+#if defined(ENABLE_SECURE_TX_ACK)
+        // A missing ACK triggers a resend, in place of blind double TX.
+        if(wantAck) { queued = primaryRadioSendAcked(realTXFrameStart, wrote); }
+        else
+#endif
+        {
+#if defined(ENABLE_TX_PENDING_QUEUE)
+        queued = primaryRadioSendOrHold(TXC_STATS, realTXFrameStart, wrote, primaryRadioChannel(), txPower, doEnc ? bareStatsRetry : NULL);
+#else
+        ENERGY_ACCOUNT(EA_TX, queued = PrimaryRadio.queueToSend(realTXFrameStart, wrote, primaryRadioChannel(), txPower));
+#endif // ENABLE_TX_PENDING_QUEUE
+        }
+        if(!queued) { sendingJSONFailed = true; linkCountTXFail(); noteStatsTXFailed(); }
         }
       }
+    // Else count failure to generate/encode JSON.
+    else { linkCountJSONFail(); }
 
 #if 1 && defined(DEBUG)
     if(sendingJSONFailed) { DEBUG_SERIAL_PRINTLN_FLASHSTRING("!failed JSON TX"); }
 #endif
+    return(!sendingJSONFailed);
     }
 #endif // defined(ENABLE_JSON_OUTPUT)
 
 //DEBUG_SERIAL_PRINTLN_FLASHSTRING("Stats TX");
-  if(neededWaking) { OTV0P2BASE::flushSerialProductive(); OTV0P2BASE::powerDownSerial(); }
+  return(false);
   }
 #endif // defined(ENABLE_STATS_TX)
 
+#if defined(ENABLE_TX_PATH_BENCHMARK)
+// Bytes of stack painted below the benchmark's own frame, bounded by the worst headroom seen so far.
+static constexpr uint16_t BENCH_STACK_PAINT_MAX = 384;
+static constexpr uint8_t BENCH_STACK_PAINT = 0xc5;
+static constexpr uint8_t BENCH_RUNS = 8;
+// Print one "BEN name cycles stack" line: mean CPU cycles per run at F_CPU, and peak stack bytes.
+static void benchPrint(const __FlashStringHelper *const name, const unsigned long us, const uint16_t stack)
+  {
+  Serial.print(F("BEN "));
+  Serial.print(name);
+  OTV0P2BASE::Serial_print_space();
+  Serial.print((us * (F_CPU / 1000000L)) / BENCH_RUNS);
+  OTV0P2BASE::Serial_print_space();
+  Serial.println(stack);
+  OTV0P2BASE::flushSerialProductive();
+  }
+#if defined(ENABLE_HIRES_TIME)
+static inline uint32_t benchNow() { return(hiresTime()); }
+static inline unsigned long benchElapsedUs(const uint32_t start) { return(hiresElapsedUs(start, hiresTime())); }
+#else
+static inline uint32_t benchNow() { return(micros()); }
+static inline unsigned long benchElapsedUs(const uint32_t start) { return(micros() - start); }
+#endif
+// Run the statement BENCH_RUNS times, timing it and measuring peak stack below the current frame by painting.
+// A little of the depth may be interrupt frames.
+#define BENCH(name, ...) do { \
+  uint8_t *const _sp = (uint8_t *)SP; \
+  for(uint16_t _i = 1; _i <= paint; ++_i) { _sp[-(int16_t)_i] = BENCH_STACK_PAINT; } \
+  const uint32_t _t = benchNow(); \
+  for(uint8_t _r = 0; _r < BENCH_RUNS; ++_r) { __VA_ARGS__; } \
+  const unsigned long _el = benchElapsedUs(_t); \
+  uint16_t _used = paint; \
+  while((_used > 0) && (BENCH_STACK_PAINT == _sp[-(int16_t)_used])) { --_used; } \
+  benchPrint(F(name), _el, _used); \
+  } while(0)
+
+// Measure each stats TX encode path (and the matching RX check) on the target itself,
+// printing one "BEN path cycles stack" line per path available in this build.
+// Nothing is transmitted and no secure TX counter is consumed: the secure path is timed as
+// the AES-GCM encryption/decryption of one fixed-size body with a dummy key and IV.
+// The JSON path rotates the stats selection as a real TX would, without clearing changed flags.
+// Runs at the normal CPU clock (not boosted) so that results are comparable between builds.
+void benchmarkTXPaths()
+  {
+  const int16_t headroom = OTV0P2BASE::MemoryChecks::getMinSPSpaceBelowStackToEnd() - 64;
+  const uint16_t paint = (headroom <= 0) ? 0 : OTV0P2BASE::fnmin((uint16_t)headroom, BENCH_STACK_PAINT_MAX);
+  uint8_t buf[1 + 64 + 1];
+  (void) buf;
+#if defined(ENABLE_BINARY_STATS_TX) && defined(ENABLE_FS20_ENCODING_SUPPORT) && !defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
+  BENCH("bin", {
+    OTV0P2BASE::FullStatsMessageCore_t content;
+    populateCoreStatsFromSensors(&content);
+    OTV0P2BASE::encodeFullStatsMessageCore(buf, sizeof(buf), getStatsTXLevelCached(), false, &content); });
+#endif
+#if defined(ENABLE_JSON_OUTPUT) && defined(ENABLE_STATS_TX)
+  BENCH("json", {
+    const uint8_t wrote = ss1.writeJSON(buf, sizeof(buf) - 1, getStatsTXLevelCached(), false, true);
+    if(0 != wrote) { OTV0P2BASE::adjustJSONMsgForTXAndComputeCRC((char *)buf); } });
+  // The RX-side check of a plaintext JSON frame, on the frame just built with its CRC appended, passing the frame length as a receiver would.
+  {
+  const uint8_t wrote = ss1.writeJSON(buf, sizeof(buf) - 1, getStatsTXLevelCached(), false, true);
+  const uint8_t crc = (0 == wrote) ? 0xff : OTV0P2BASE::adjustJSONMsgForTXAndComputeCRC((char *)buf);
+  if(0xff != crc)
+    {
+    buf[wrote] = crc;
+    BENCH("rxjson", checkJSONRXCRC(buf, wrote + 1));
+    }
+  }
+#endif
+  // The 7-bit CRC alone over a maximum-length frame, bit by bit and as built: divide by 64 for cycles per byte.
+  memset(buf, '"', sizeof(buf));
+  BENCH("crc7bit", { uint8_t crc = 0; for(uint8_t i = 0; i < 64; ++i) { crc = OTV0P2BASE::crc7_5B_update(crc, buf[i]); } buf[0] = crc; });
+  BENCH("crc7", { uint8_t crc = 0; for(uint8_t i = 0; i < 64; ++i) { crc = crc7Update(crc, buf[i]); } buf[0] = crc; });
+#if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
+  {
+  uint8_t key[16]; memset(key, 0, sizeof(key));
+  uint8_t iv[12]; memset(iv, 0, sizeof(iv));
+  uint8_t text[32]; memset(text, 0, sizeof(text));
+  uint8_t tag[16];
+  BENCH("enc", secureFrameEnc(NULL, key, iv, buf, 8, text, text, tag));
+  BENCH("dec", secureFrameDec(NULL, key, iv, buf, 8, text, tag, text));
+  }
+#endif
+  }
+#undef BENCH
+#endif // ENABLE_TX_PATH_BENCHMARK
+
+#if defined(ENABLE_STATS_SET_UPLOAD) && defined(ENABLE_STATS_TX)
+// Next stats set to upload, and the current pass over all the sets.
+static uint8_t statsUploadSet;
+static uint8_t statsUploadPass;
+// Send the next non-empty by-hour stats set in one secure frame.
+// Separate from the stats rotation, so it does not disturb its cadence or content.
+static void statsSetUploadTX()
+  {
+  uint8_t body[STATS_SET_BODY_LEN];
+  // Skip wholly unset sets, eg for absent sensors, but look at each set at most once per call.
+  for(uint8_t tries = V0P2BASE_EE_STATS_SETS; ; )
+    {
+    body[2] = statsUploadSet;
+    body[3] = statsUploadPass;
+    bool empty = true;
+    for(uint8_t hh = 0; hh < 24; ++hh)
+      {
+      const uint8_t v = eeStats.getByHourStatRaw(statsUploadSet, hh);
+      body[4 + hh] = v;
+      if(0xff != v) { empty = false; }
+      }
+    if(++statsUploadSet >= V0P2BASE_EE_STATS_SETS) { statsUploadSet = 0; ++statsUploadPass; }
+    if(!empty) { break; }
+    if(0 == --tries) { return; }
+    }
+  body[0] = 0x7f;
+  body[1] = STATS_SET_BODY_FLAG;
+  uint8_t key[16];
+  if(!getPrimaryBuildingKey(key)) { return; }
+  // Encrypted bodies are always padded to the fixed ciphertext size.
+  uint8_t buf[27 + OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES + OTRadioLink::ENC_BODY_SMALL_FIXED_CTEXT_SIZE];
+  uint8_t fl;
+  {
+  const CPUClockBoost boost;
+  fl = secureTX().generateSecureOStyleFrameForTX(
+        buf, sizeof(buf), OTRadioLink::FTS_BasicSensorOrValve, OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES,
+        body, sizeof(body), secureFrameEnc, NULL, key);
+  }
+  // DO NOT attempt to send if the secure frame could not be built (risks IV reuse).
+  // ASSUME FRAMED CHANNEL 0, so do not send the leading length byte.
+  if(0 == fl) { return; }
+  bool queued;
+  ENERGY_ACCOUNT(EA_TX, queued = PrimaryRadio.queueToSend(buf+1, fl-1, primaryRadioChannel()));
+  if(!queued) { linkCountTXFail(); }
+  }
+#endif // ENABLE_STATS_SET_UPLOAD
+
+
+#if defined(ENABLE_FHT8V_MULTI)
+// Pick up extra valve house codes from EEPROM; unchanged codes do not force a resync.
+static void fht8vExtraLoadHC()
+  {
+  for(uint8_t i = 0; i < FHT8V_EXTRA_VALVES; ++i)
+    {
+    FHT8VExtra[i].setHC1(eeprom_read_byte((uint8_t *)(V0P2_EE_START_FHT8V_EXTRA_HC + 2*i)));
+    FHT8VExtra[i].setHC2(eeprom_read_byte((uint8_t *)(V0P2_EE_START_FHT8V_EXTRA_HC + 2*i + 1)));
+    }
+  }
+// Set the extra valves to follow the main one.
+static void fht8vExtraSet(const uint8_t valvePC)
+  {
+  fht8vExtraLoadHC();
+  for(uint8_t i = 0; i < FHT8V_EXTRA_VALVES; ++i) { if(FHT8VExtra[i].isAvailable()) { FHT8VExtra[i].set(valvePC); } }
+  }
+// Each instance keeps its own sync state and TX schedule (its gap depends on its own HC2),
+// and _Next() must only be called on an instance whose previous call asked for more slots.
+// Where two are due in the same half second, the later one sends straight after the earlier,
+// a frame time (~80ms+) late, which is well inside the half-second slot.
+static bool fht8vMore[1 + FHT8V_EXTRA_VALVES];
+static bool fht8vPollSyncAndTX(const bool first, const bool allowDoubleTX)
+  {
+  const TXDutyCritical critical;
+  bool any = false;
+  for(uint8_t i = 0; i <= FHT8V_EXTRA_VALVES; ++i)
+    {
+    OTRadValve::FHT8VRadValveBase &v = (0 == i) ? (OTRadValve::FHT8VRadValveBase &)FHT8V : (OTRadValve::FHT8VRadValveBase &)FHT8VExtra[i-1];
+    const bool enabled = (0 == i) ? localFHT8VTRVEnabled() : v.isAvailable();
+    if(first) { fht8vMore[i] = enabled && v.FHT8VPollSyncAndTX_First(allowDoubleTX); }
+    else if(fht8vMore[i]) { fht8vMore[i] = v.FHT8VPollSyncAndTX_Next(allowDoubleTX); }
+    any |= fht8vMore[i];
+    }
+  return(any);
+  }
+#define fht8vPollSyncAndTXFirst(d) fht8vPollSyncAndTX(true, (d))
+#define fht8vPollSyncAndTXNext(d) fht8vPollSyncAndTX(false, (d))
+#elif defined(ENABLE_FHT8VSIMPLE)
+static bool fht8vPollSyncAndTXFirst(const bool d) { const TXDutyCritical critical; return(localFHT8VTRVEnabled() && FHT8V.FHT8VPollSyncAndTX_First(d)); }
+static bool fht8vPollSyncAndTXNext(const bool d) { const TXDutyCritical critical; return(localFHT8VTRVEnabled() && FHT8V.FHT8VPollSyncAndTX_Next(d)); }
+#endif // ENABLE_FHT8V_MULTI
+
+#if defined(ENABLE_EVENT_BUS)
+// Change events published by sensors and the UI, each dispatched to the subscribers listed for it at compile time.
+// The subscriber table lives in flash so adding a consumer costs no RAM.
+enum busEvent_t : uint8_t { EV_OCC_POSSIBLE, EV_OCC_JUST_POSSIBLE, EV_POT_WARM, EV_POT_BAKE, EV_POT_MOVED, EV_COUNT };
+typedef void (*busHandler_t)(uint8_t arg);
+struct busSubscriber_t { busEvent_t evt; busHandler_t fn; };
+// Set by subscribers when an event may have moved the target temperature; cleared by the UI-tick recompute.
+static bool targetRecomputePending;
+static void onTargetInputEvent(uint8_t) { targetRecomputePending = true; }
+#if defined(ENABLE_OCCUPANCY_SUPPORT) && (defined(ENABLE_OCCUPANCY_DETECTION_FROM_AMBLIGHT) || defined(ENABLE_OCCUPANCY_DETECTION_FROM_VOICE))
+static void onOccPossible(uint8_t) { Occupancy.markAsPossiblyOccupied(); }
+static void onOccJustPossible(uint8_t) { Occupancy.markAsJustPossiblyOccupied(); }
+#endif
+#if defined(TEMP_POT_AVAILABLE) && defined(valveUI_DEFINED)
+static void onPotWarm(uint8_t x) { valveUI.setWarmModeFromManualUI(0 != x); }
+static void onPotBake(uint8_t x) { valveUI.setBakeModeFromManualUI(0 != x); }
+#endif
+// Called in table order for each event.
+static const busSubscriber_t busSubscribers[] PROGMEM =
+  {
+#if defined(ENABLE_OCCUPANCY_SUPPORT) && (defined(ENABLE_OCCUPANCY_DETECTION_FROM_AMBLIGHT) || defined(ENABLE_OCCUPANCY_DETECTION_FROM_VOICE))
+  { EV_OCC_POSSIBLE, onOccPossible },
+  { EV_OCC_JUST_POSSIBLE, onOccJustPossible },
+#endif
+  { EV_OCC_POSSIBLE, onTargetInputEvent },
+  { EV_OCC_JUST_POSSIBLE, onTargetInputEvent },
+#if defined(TEMP_POT_AVAILABLE) && defined(valveUI_DEFINED)
+  { EV_POT_WARM, onPotWarm },
+  { EV_POT_BAKE, onPotBake },
+#endif
+  { EV_POT_WARM, onTargetInputEvent },
+  { EV_POT_BAKE, onTargetInputEvent },
+  { EV_POT_MOVED, onTargetInputEvent },
+  };
+// Deliver evt (with optional argument) synchronously to each of its subscribers.
+static void publishEvent(const busEvent_t evt, const uint8_t arg = 0)
+  {
+  for(uint8_t i = 0; i < sizeof(busSubscribers)/sizeof(busSubscribers[0]); ++i)
+    {
+    if(evt != (busEvent_t)pgm_read_byte(&busSubscribers[i].evt)) { continue; }
+    ((busHandler_t)pgm_read_word(&busSubscribers[i].fn))(arg);
+    }
+  }
+#endif // ENABLE_EVENT_BUS
+
+#if defined(TEMP_POT_AVAILABLE)
+#if defined(ENABLE_TEMP_POT_FOLLOW)
+#ifndef TEMP_POT_FOLLOW_S
+#define TEMP_POT_FOLLOW_S 20 // Long enough to finish turning the dial.
+#endif
+// Minor cycles left to keep sampling the pot each cycle after it last moved.
+static uint8_t tempPotFollowCycles;
+#endif
+// Read the temperature pot, publishing a change of setting where there is an event bus.
+static void readTempPot()
+  {
+#if defined(ENABLE_EVENT_BUS) || defined(ENABLE_TEMP_POT_FOLLOW)
+  const uint8_t before = TempPot.get();
+  TempPot.read();
+  if(TempPot.get() != before)
+    {
+#if defined(ENABLE_EVENT_BUS)
+    publishEvent(EV_POT_MOVED);
+#endif
+#if defined(ENABLE_TEMP_POT_FOLLOW)
+    tempPotFollowCycles = TEMP_POT_FOLLOW_S / OTV0P2BASE::MAIN_TICK_S;
+#endif
+    }
+#else
+  TempPot.read();
+#endif
+  }
+#if defined(ENABLE_TEMP_POT_FOLLOW)
+// While the dial is being turned, sample it every minor cycle (time permitting) rather than once a minute.
+static void tempPotFollowTick()
+  {
+  if(0 == tempPotFollowCycles) { return; }
+  --tempPotFollowCycles;
+  if(OTV0P2BASE::getSubCycleTime() >= OTV0P2BASE::GSCT_MAX/2) { return; }
+  ENERGY_ACCOUNT(EA_SENSOR, readTempPot());
+  }
+#endif // ENABLE_TEMP_POT_FOLLOW
+#endif // TEMP_POT_AVAILABLE
+#if !defined(ENABLE_TEMP_POT_FOLLOW) || !defined(TEMP_POT_AVAILABLE)
+#define tempPotFollowTick() {}
+#endif
 
 // Wire components together, eg for occupancy sensing.
 static void wireComponentsTogether()
@@ -477,10 +1347,36 @@ static void wireComponentsTogether()
 #ifdef ENABLE_FHT8VSIMPLE
   // Set up radio with FHT8V.
   FHT8V.setRadio(&PrimaryRadio);
+#if defined(ENABLE_RADIO_DUAL_CARRIER)
+  FHT8V.setChannelTX(RADIO_OOK_CHANNEL);
+#endif
   // Load EEPROM house codes into primary FHT8V instance at start.
   FHT8V.nvLoadHC();
+#if defined(ENABLE_FHT8V_MULTI)
+  for(uint8_t i = 0; i < FHT8V_EXTRA_VALVES; ++i)
+    {
+    FHT8VExtra[i].setRadio(&PrimaryRadio);
+#if defined(ENABLE_RADIO_DUAL_CARRIER)
+    FHT8VExtra[i].setChannelTX(RADIO_OOK_CHANNEL);
+#endif
+    }
+  fht8vExtraLoadHC();
+#endif // ENABLE_FHT8V_MULTI
 #endif // ENABLE_FHT8VSIMPLE
 
+#if defined(ENABLE_EVENT_BUS)
+  // Sensors just publish; who reacts is set by busSubscribers[].
+#if defined(ENABLE_OCCUPANCY_SUPPORT) && defined(ENABLE_OCCUPANCY_DETECTION_FROM_AMBLIGHT)
+  AmbLight.setOccCallbackOpt([](bool prob){publishEvent(prob ? EV_OCC_POSSIBLE : EV_OCC_JUST_POSSIBLE);});
+#endif // ENABLE_OCCUPANCY_DETECTION_FROM_AMBLIGHT
+#if defined(ENABLE_OCCUPANCY_SUPPORT) && defined(ENABLE_OCCUPANCY_DETECTION_FROM_VOICE)
+  Voice.setPossOccCallback([]{publishEvent(EV_OCC_POSSIBLE);});
+#endif // ENABLE_OCCUPANCY_DETECTION_FROM_VOICE
+#if defined(TEMP_POT_AVAILABLE)
+  TempPot.setWFBCallbacks([](bool x){publishEvent(EV_POT_WARM, x);},
+                          [](bool x){publishEvent(EV_POT_BAKE, x);});
+#endif // TEMP_POT_AVAILABLE
+#else
 #if defined(ENABLE_OCCUPANCY_SUPPORT) && defined(ENABLE_OCCUPANCY_DETECTION_FROM_AMBLIGHT)
   AmbLight.setOccCallbackOpt([](bool prob){if(prob){Occupancy.markAsPossiblyOccupied();}else{Occupancy.markAsJustPossiblyOccupied();}});
 #endif // ENABLE_OCCUPANCY_DETECTION_FROM_AMBLIGHT
@@ -495,6 +1391,7 @@ static void wireComponentsTogether()
   TempPot.setWFBCallbacks([](bool x){valveUI.setWarmModeFromManualUI(x);},
                           [](bool x){valveUI.setBakeModeFromManualUI(x);});
 #endif // TEMP_POT_AVAILABLE
+#endif // ENABLE_EVENT_BUS
 
 #if V0p2_REV == 14
   pinMode(REGULATOR_POWERUP, OUTPUT);
@@ -506,6 +1403,76 @@ static void wireComponentsTogether()
 #endif // V0p2_REV == 14
   }
 
+#if defined(ENABLE_VOICE_POWER_GATING)
+// The REV14 voice module (and its regulator) is only powered in windows where it may tell us something new:
+// not while the room has just been confirmed occupied by other means,
+// and for only a short window every VOICE_SPARSE_PERIOD_M minutes while long vacant or at night.
+// After power-up it is given a minute to settle, then put back into low-power mode (as the library does once)
+// before its interrupt is re-armed, so that power-on glitches are not counted as detections.
+static constexpr uint8_t VOICE_SPARSE_PERIOD_M = 8; // Power of two.
+static constexpr uint8_t VOICE_NIGHT_END_H = 6; // Sparse from midnight to this hour.
+static bool voicePowered = true; // As set by wireComponentsTogether().
+static bool voiceSettled;
+// True if the voice module should be powered for the coming minute.
+static bool voicePowerWanted()
+  {
+  if(Occupancy.isLikelyRecentlyOccupied()) { return(false); }
+  if(Occupancy.longVacant() || (OTV0P2BASE::getHoursLT() < VOICE_NIGHT_END_H))
+    { return((OTV0P2BASE::getMinutesLT() & (VOICE_SPARSE_PERIOD_M-1)) < 2); } // Settle then listen.
+  return(true);
+  }
+// Call once a minute just after Voice.read(); returns true if the voice interrupt should then be armed.
+static bool voicePowerGateTick()
+  {
+  if(!voicePowerWanted())
+    {
+    if(voicePowered) { fastDigitalWrite(REGULATOR_POWERUP, LOW); voicePowered = false; }
+    voiceSettled = false;
+    return(false);
+    }
+  if(!voicePowered) { fastDigitalWrite(REGULATOR_POWERUP, HIGH); voicePowered = true; return(false); }
+  if(!voiceSettled)
+    {
+    // Module comes up in its default mode so repeat the library's set-up commands.
+    const PeripheralPower<PP_TWI> twi;
+    Wire.beginTransmission(0x09); // QM1 address.
+    Wire.write((byte)0b01000001);
+    Wire.endTransmission();
+    Wire.beginTransmission(0x09);
+    Wire.write((byte)0x04); // Set low-power mode.
+    Wire.endTransmission();
+    voiceSettled = true;
+    }
+  return(true);
+  }
+#endif // ENABLE_VOICE_POWER_GATING
+
+
+#if defined(ENABLE_BY_HOUR_STATS_AGGREGATE_CACHE)
+// Min and max over all hours of each by-hour stats set, so that frequent (eg UI-driven) callers
+// avoid a 24-byte EEPROM scan each time.
+// A set's entry is computed on first use after the cache is invalidated, so at most once per write of stats.
+static constexpr uint8_t AGG_SETS = OTV0P2BASE::NVByHourByteStatsBase::STATS_SETS_COUNT;
+static_assert(AGG_SETS <= 16, "valid mask must hold all sets");
+static uint16_t byHourAggValid; // Bit n set if set n is cached.
+static uint8_t byHourAggMin[AGG_SETS];
+static uint8_t byHourAggMax[AGG_SETS];
+void invalidateByHourStatsAggregates() { byHourAggValid = 0; }
+static void refreshByHourStatsAggregates(const uint8_t statsSet)
+  {
+  const uint16_t bit = (uint16_t)(1U << statsSet);
+  if(0 != (byHourAggValid & bit)) { return; }
+  byHourAggMin[statsSet] = eeStats.getMinByHourStat(statsSet);
+  byHourAggMax[statsSet] = eeStats.getMaxByHourStat(statsSet);
+  byHourAggValid |= bit;
+  }
+// As eeStats.getMinByHourStat() and getMaxByHourStat() for statsSet < AGG_SETS.
+static uint8_t getMinByHourStatCached(const uint8_t statsSet) { refreshByHourStatsAggregates(statsSet); return(byHourAggMin[statsSet]); }
+static uint8_t getMaxByHourStatCached(const uint8_t statsSet) { refreshByHourStatsAggregates(statsSet); return(byHourAggMax[statsSet]); }
+#else
+#define getMinByHourStatCached(statsSet) eeStats.getMinByHourStat(statsSet)
+#define getMaxByHourStatCached(statsSet) eeStats.getMaxByHourStat(statsSet)
+#endif // ENABLE_BY_HOUR_STATS_AGGREGATE_CACHE
 
 // Update sensors with historic/trailing statistics information where needed.
 // Should be called at least hourly after all stats have been updated,
@@ -517,17 +1484,314 @@ static void updateSensorsFromStats()
   // ...and prevailing bias, so may take a while to adjust.
   AmbLight.setTypMinMax(
           eeStats.getByHourStatRTC(OTV0P2BASE::NVByHourByteStatsBase::STATS_SET_AMBLIGHT_BY_HOUR_SMOOTHED),
-          eeStats.getMinByHourStat(OTV0P2BASE::NVByHourByteStatsBase::STATS_SET_AMBLIGHT_BY_HOUR_SMOOTHED),
-          eeStats.getMaxByHourStat(OTV0P2BASE::NVByHourByteStatsBase::STATS_SET_AMBLIGHT_BY_HOUR_SMOOTHED),
+          getMinByHourStatCached(OTV0P2BASE::NVByHourByteStatsBase::STATS_SET_AMBLIGHT_BY_HOUR_SMOOTHED),
+          getMaxByHourStatCached(OTV0P2BASE::NVByHourByteStatsBase::STATS_SET_AMBLIGHT_BY_HOUR_SMOOTHED),
           !tempControl.hasEcoBias());
 #endif // ENABLE_OCCUPANCY_DETECTION_FROM_AMBLIGHT
   }
 
+#if defined(ENABLE_LAZY_TARGET_RECOMPUTE) && defined(ENABLE_MODELLED_RAD_VALVE)
+// Cheap CRC over the inputs that the target temperature and updateSensorsFromStats() depend on.
+// The library sensors carry no change counters, so this stands in for them.
+// The by-hour stats only change hourly, so the hour covers them.
+static uint16_t targetInputsSignature()
+  {
+  const uint8_t in[] =
+    {
+    (uint8_t)(valveMode.inWarmMode() | (valveMode.inBakeMode() << 1) | (tempControl.hasEcoBias() << 2) |
+      (AmbLight.isRoomDark() << 3) | (Scheduler.isAnyScheduleOnWARMNow() << 4) | (RelHumidity.isRHHighWithHyst() << 5) |
+      (valveUI.veryRecentUIControlUse() << 6)),
+    tempControl.getWARMTargetC(),
+    tempControl.getFROSTTargetC(),
+    Occupancy.twoBitOccupancyValue(),
+    (uint8_t)OTV0P2BASE::fnmin(Occupancy.getVacancyH(), (uint16_t)0xff),
+    AmbLight.getDarkMinutes(),
+    (uint8_t)OTV0P2BASE::getHoursLT(),
+#ifdef ENABLE_SETBACK_LOCKOUT_COUNTDOWN
+    OTRadValve::getSetbackLockout(),
+#endif
+    };
+  uint16_t crc = 0xffff;
+  for(uint8_t i = 0; i < sizeof(in); ++i) { crc = _crc_ccitt_update(crc, in[i]); }
+  return(crc);
+  }
+// Signature as at the last UI-driven recompute.
+static uint16_t lastTargetInputsSignature;
+#endif // ENABLE_LAZY_TARGET_RECOMPUTE
+
+#if defined(ENABLE_SCHEDULE_TRANSITION_CACHE) && defined(SCHEDULER_AVAILABLE)
+// Schedule on and off times (minutes since midnight, pre-warm included), read once from EEPROM; invalid if >= 1440.
+static uint_least16_t schedTransitionM[2 * Scheduler_t::MAX_SIMPLE_SCHEDULES];
+// Next on/off time at or after the last check, or invalid if none.
+static uint_least16_t nextScheduleTransitionM;
+// First minute not yet checked for transitions; 1 more than the last minute checked.
+static uint_least16_t schedFromM;
+// True once the cache has been built, for the eco bias in schedCacheEcoBias (which affects off times).
+static bool schedCacheValid;
+static bool schedCacheEcoBias;
+void invalidateScheduleCache() { schedCacheValid = false; }
+// Find the first cached transition at or after msm, wrapping past midnight.
+static uint_least16_t findNextScheduleTransition(const uint_least16_t msm)
+  {
+  uint_least16_t best = ~0U;
+  uint_least16_t bestDist = ~0U;
+  for(uint8_t i = 0; i < sizeof(schedTransitionM)/sizeof(schedTransitionM[0]); ++i)
+    {
+    const uint_least16_t t = schedTransitionM[i];
+    if(t >= OTV0P2BASE::MINS_PER_DAY) { continue; }
+    const uint_least16_t d = (t >= msm) ? (t - msm) : (t + OTV0P2BASE::MINS_PER_DAY - msm);
+    if(d < bestDist) { bestDist = d; best = t; }
+    }
+  return(best);
+  }
+// Call once per minute in place of Scheduler.applyUserSchedule().
+// Applies every transition since the previous call, so a skipped minute does not stall the schedule until midnight.
+// Rebuilds the cache when invalidated, when the day wraps or the clock goes back, on eco bias change,
+// and while the UI is in use (eg LEARN); otherwise costs a couple of compares.
+static void applyUserScheduleCached(const uint_least16_t msm)
+  {
+  const bool eco = tempControl.hasEcoBias();
+#if defined(valveUI_DEFINED)
+  const bool uiInUse = valveUI.veryRecentUIControlUse();
+#else
+  const bool uiInUse = false;
+#endif
+  if(!schedCacheValid || (msm + 1 < schedFromM) || (eco != schedCacheEcoBias) || uiInUse)
+    {
+    for(uint8_t i = 0; i < Scheduler_t::MAX_SIMPLE_SCHEDULES; ++i)
+      {
+      schedTransitionM[2*i] = Scheduler.getSimpleScheduleOn(i);
+      schedTransitionM[2*i + 1] = Scheduler.getSimpleScheduleOff(i);
+      }
+    schedCacheEcoBias = eco;
+    schedCacheValid = true;
+    nextScheduleTransitionM = findNextScheduleTransition(msm);
+    schedFromM = msm;
+    }
+  while((nextScheduleTransitionM >= schedFromM) && (nextScheduleTransitionM <= msm))
+    {
+    const uint_least16_t t = nextScheduleTransitionM;
+    Scheduler.applyUserSchedule(&valveMode, t);
+    nextScheduleTransitionM = findNextScheduleTransition(t + 1);
+    if(nextScheduleTransitionM <= t) { break; } // Wrapped to tomorrow.
+    }
+  schedFromM = msm + 1;
+  }
+#endif // ENABLE_SCHEDULE_TRANSITION_CACHE
+
+#if defined(ENABLE_JIT_PREHEAT)
+// Rooms measured below this at the start of an hour use the 'cold' rate.
+static constexpr int16_t JIT_COLD_START_C16 = 16 << 4;
+// Bounds and safety margin on the learned lead time in minutes.
+static constexpr uint8_t JIT_MIN_LEAD_M = 6;
+static constexpr uint8_t JIT_MAX_LEAD_M = 180;
+static constexpr uint8_t JIT_MARGIN_M = 10;
+// Only learn from hours spent heating with the valve at least this open on average,
+// for at least this many minutes before reaching the WARM target.
+static constexpr uint8_t JIT_LEARN_MIN_VALVE_PC = 50;
+static constexpr uint8_t JIT_LEARN_MIN_HEAT_M = 15;
+// EEPROM rate cell for the given hour of day and starting room temperature.
+static inline uint8_t *jitRateCell(const uint8_t hour, const int16_t startC16)
+  { return((uint8_t *)V0P2_EE_START_JIT_RATES + 2*(hour >> 2) + ((startC16 < JIT_COLD_START_C16) ? 1 : 0)); }
+// Room temperature at the start of this hour, and minutes of it seen so far.
+static int16_t jitHourStartC16;
+static uint8_t jitHourMinutes;
+// Minutes of this hour spent below the WARM target (stopping once it is reached),
+// valve % summed over them, and the room temperature at the last of them.
+// Time spent holding the target would drag the learned rate towards zero.
+static uint8_t jitHourHeatM;
+static uint16_t jitHourValveSum;
+static int16_t jitHourHeatEndC16;
+static bool jitHourReached;
+// Bit per schedule set once its just-in-time start has been made, until its nominal start.
+static uint8_t jitStarted;
+// Minutes needed to warm from now to the WARM target for a start in the given hour;
+// the fixed library pre-warm until a rate has been learned.
+static uint8_t jitLeadMinutes(const uint8_t hour)
+  {
+  const int16_t nowC16 = TemperatureC16.get();
+  const uint8_t rate = eeQueuedReadByte(jitRateCell(hour, nowC16));
+  if((0xff == rate) || (0 == rate)) { return(Scheduler_t::PREWARM_MINS); }
+  const int16_t needC16 = (((int16_t)tempControl.getWARMTargetC()) << 4) - nowC16;
+  if(needC16 <= 0) { return(JIT_MIN_LEAD_M); }
+  const uint16_t lead = (uint16_t)((60U * (uint16_t)OTV0P2BASE::fnmin(needC16, (int16_t)(16*16))) / rate) + JIT_MARGIN_M;
+  return((uint8_t)OTV0P2BASE::fnmin(lead, (uint16_t)JIT_MAX_LEAD_M));
+  }
+// Call once per minute just after the user schedule has been applied,
+// with wasWarm the WARM state from just before, to move each schedule's warm-up to when it is needed.
+// A warm-up the library has just started at its fixed pre-warm is undone if it is not yet needed,
+// and one is started early (up to JIT_MAX_LEAD_M) for a slow room.
+static void jitPreheatMinute(const uint_least16_t msm, const bool wasWarm)
+  {
+  const int16_t nowC16 = TemperatureC16.get();
+  if(0 == jitHourMinutes) { jitHourStartC16 = nowC16; jitHourHeatEndC16 = nowC16; jitHourHeatM = 0; jitHourValveSum = 0; jitHourReached = false; }
+  if(!jitHourReached)
+    {
+    if(nowC16 >= (((int16_t)tempControl.getWARMTargetC()) << 4)) { jitHourReached = true; }
+    else { jitHourValveSum += NominalRadValve.get(); ++jitHourHeatM; jitHourHeatEndC16 = nowC16; }
+    }
+  if(jitHourMinutes < 255) { ++jitHourMinutes; }
+
+  static_assert(Scheduler_t::MAX_SIMPLE_SCHEDULES <= 8, "jitStarted too small");
+  for(uint8_t i = 0; i < Scheduler_t::MAX_SIMPLE_SCHEDULES; ++i)
+    {
+    const uint8_t bit = (uint8_t)(1U << i);
+    const uint_least16_t on = Scheduler.getSimpleScheduleOn(i);
+    if(on >= OTV0P2BASE::MINS_PER_DAY) { jitStarted &= ~bit; continue; }
+    const uint_least16_t startM = (on + Scheduler_t::PREWARM_MINS) % OTV0P2BASE::MINS_PER_DAY;
+    const uint_least16_t untilM = (startM >= msm) ? (startM - msm) : (startM + OTV0P2BASE::MINS_PER_DAY - msm);
+    if(0 == untilM) { jitStarted &= ~bit; continue; }
+    // Outside any lead window, eg after the schedule was moved or cleared or the clock was set past the start,
+    // so a start made earlier has been abandoned and must not block the next one.
+    if(untilM > JIT_MAX_LEAD_M) { jitStarted &= ~bit; continue; }
+    const uint8_t lead = jitLeadMinutes((uint8_t)(startM / 60));
+    if(untilM <= lead)
+      {
+      if(!(jitStarted & bit)) { jitStarted |= bit; if(!valveMode.inWarmMode()) { valveMode.setWarmModeDebounced(true); } }
+      }
+    else if((msm == on) && !wasWarm && valveMode.inWarmMode())
+      { valveMode.setWarmModeDebounced(false); }
+    }
+  }
+// Fold the hour just ending into the learned rate if it was spent warming up from below the WARM target,
+// using only the minutes until the target was reached.
+static void jitPreheatLearn()
+  {
+  const uint8_t minutes = jitHourMinutes;
+  jitHourMinutes = 0;
+  if((minutes < 45) || !valveMode.inWarmMode()) { return; }
+  const uint8_t heatM = jitHourHeatM;
+  if(heatM < JIT_LEARN_MIN_HEAT_M) { return; } // Eg started at or near the target.
+  const uint8_t avgPC = (uint8_t)(jitHourValveSum / heatM);
+  const int16_t riseC16 = jitHourHeatEndC16 - jitHourStartC16;
+  if((avgPC < JIT_LEARN_MIN_VALVE_PC) || (riseC16 <= 0)) { return; }
+  // Rise per hour per 100% open: (60/heatM) * rise * (100/avgPC).
+  const uint8_t seen = (uint8_t)OTV0P2BASE::fnmin((uint32_t)((6000UL * (uint16_t)OTV0P2BASE::fnmin(riseC16, (int16_t)254)) / jitHourValveSum), (uint32_t)254);
+  uint8_t *const cell = jitRateCell(OTV0P2BASE::getHoursLT(), jitHourStartC16);
+  const uint8_t old = eeQueuedReadByte(cell);
+  // Smooth over several hours so that one odd hour (eg a window open) does not dominate.
+  const uint8_t rate = (0xff == old) ? seen : (uint8_t)((3U*old + seen + 2) / 4);
+  if(rate != old) { eeQueueUpdateByte(EEW_CONFIG, cell, OTV0P2BASE::fnmax(rate, (uint8_t)1)); }
+  }
+#endif // ENABLE_JIT_PREHEAT
+
+#if defined(ENABLE_INEFFECTIVE_CALL_DETECT)
+// Streaming check that calls for heat warm the room (TODO-1096: a valve can hover, still shut, calling indefinitely).
+// The time from the start of a call to a rise of ICD_RISE_C16 is learned as a moving average;
+// a call with no such rise after twice that (within bounds) is flagged ineffective.
+// The valve is then wiggled once to help it reseat and the call is not advertised to the boiler for one window;
+// it is then advertised again and measured afresh, as the boiler may simply not have fired
+// (and cannot while the call is withheld), so a real demand is never locked out.
+// Any rise or the end of the call clears the flag.
+static constexpr int16_t ICD_RISE_C16 = 4; // 0.25C, well clear of sensor noise.
+static constexpr uint8_t ICD_MIN_WINDOW_M = 15;
+static constexpr uint8_t ICD_MAX_WINDOW_M = 120;
+// Learned minutes to respond, starting generous; RAM only, so relearned after a reset.
+static uint8_t icdWindowM = 60;
+// Minutes into the current measurement (or suppression) and the temperature at its start; 0 minutes when not calling.
+static uint8_t icdCallM;
+static int16_t icdStartC16;
+// True once the current call has responded.
+static bool icdResponded;
+// True while the current call is flagged ineffective and withheld from the boiler.
+static bool icdIneffective;
+// True once the current call has been flagged at all, so that its eventual response is not learned from.
+static bool icdRetried;
+uint8_t callForHeatValvePC() { return(icdIneffective ? 0 : NominalRadValve.get()); }
+// Call once per minute.
+static void ineffectiveCallMinute()
+  {
+  const int16_t t = TemperatureC16.get();
+  if(!NominalRadValve.isCallingForHeat() || TemperatureC16.isErrorValue(t))
+    { icdCallM = 0; icdResponded = false; icdIneffective = false; icdRetried = false; return; }
+  if(0 == icdCallM) { icdStartC16 = t; }
+  if(icdCallM < 255) { ++icdCallM; }
+  if(icdResponded) { return; }
+  if(t >= icdStartC16 + ICD_RISE_C16)
+    {
+    // Learn only from calls that worked first time, so a stuck valve does not stretch the window.
+    if(!icdRetried)
+      { icdWindowM = OTV0P2BASE::fnmax(ICD_MIN_WINDOW_M, OTV0P2BASE::fnmin((uint8_t)((3U*icdWindowM + icdCallM + 2) / 4), ICD_MAX_WINDOW_M)); }
+    icdResponded = true;
+    icdIneffective = false;
+    return;
+    }
+  if(icdIneffective)
+    {
+    // Withheld for a window: advertise the call again and measure afresh.
+    if(icdCallM < icdWindowM) { return; }
+    icdIneffective = false;
+    }
+  else
+    {
+    if(icdCallM < 2*icdWindowM) { return; }
+    icdIneffective = true;
+    icdRetried = true;
+#if defined(HAS_DORM1_VALVE_DRIVE)
+    if(ValveDirect.isInNormalRunState()) { ValveDirect.wiggle(); }
+#endif
+    }
+  icdCallM = 1;
+  icdStartC16 = t;
+  }
+#endif // ENABLE_INEFFECTIVE_CALL_DETECT
+
+#if defined(ENABLE_TUNE_FAST_OSC_TO_RTC_SOURCE) && defined(ENABLE_WAKEUP_32768HZ_XTAL)
+// Room temperature (C*16) at the last OSCCAL tune.
+static int16_t oscTuneTempC16;
+// Room temperature change (C*16) that prompts a fresh tune; the RC oscillator moves ~0.1%/C.
+static constexpr int16_t OSC_TUNE_TEMP_DELTA_C16 = 2 * 16;
+// Tune OSCCAL a few steps, after letting any serial output drain.
+// The measurement masks interrupts for up to ~0.1s, which would overrun the RX FIFO,
+// so any listening radio is stopped for it and then restarted on the same channel;
+// a frame in the air meanwhile is lost as if to a collision, at most about once an hour.
+static void oscTuneNow()
+  {
+#if defined(ENABLE_RADIO_RX)
+  const int8_t ch = PrimaryRadio.getListenChannel();
+  if(ch >= 0) { PrimaryRadio.listen(false); }
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+  const int8_t auxCh = RFM23BAux.getListenChannel();
+  if(auxCh >= 0) { RFM23BAux.listen(false); }
+#endif
+#endif
+  if(OTV0P2BASE::_serialIsPoweredUp()) { OTV0P2BASE::flushSerialSCTSensitive(); }
+  tuneFastOscToRTC(4);
+  oscTuneTempC16 = TemperatureC16.get();
+#if defined(ENABLE_RADIO_RX)
+  if(ch >= 0) { PrimaryRadio.listen(true, ch); }
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+  if(auxCh >= 0) { RFM23BAux.listen(true, auxCh); }
+#endif
+#endif
+  }
+// Call once per minute: retunes if the room temperature has moved enough since the last tune.
+static void oscTuneOnTemperature()
+  {
+  const int16_t t = TemperatureC16.get();
+  if(TemperatureC16.isErrorValue(t)) { return; }
+  const int16_t d = t - oscTuneTempC16;
+  if((d >= OSC_TUNE_TEMP_DELTA_C16) || (d <= -OSC_TUNE_TEMP_DELTA_C16)) { oscTuneNow(); }
+  }
+#else
+#define oscTuneOnTemperature() {}
+#endif // ENABLE_TUNE_FAST_OSC_TO_RTC_SOURCE
+
 // Run tasks needed at the end of each hour.
 // Should be run once at a fixed slot in the last minute of each hour.
 // Will be run after all stats for the current hour have been updated.
 static void endOfHourTasks()
   {
+#if defined(ENABLE_JIT_PREHEAT)
+  jitPreheatLearn();
+#endif
+#if defined(ENABLE_TUNE_FAST_OSC_TO_RTC_SOURCE) && defined(ENABLE_WAKEUP_32768HZ_XTAL)
+  // Follow slow RC drift, eg with supply voltage.
+  oscTuneNow();
+#endif
+#if defined(ENABLE_DUAL_RX_KEY)
+  previousBuildingKeyHourTick();
+#endif
   }
 
 // Run tasks needed at the end of each day (nominal midnight).
@@ -537,7 +1801,20 @@ static void endOfDayTasks()
   {
 #if defined(ENABLE_SETBACK_LOCKOUT_COUNTDOWN)
     // Count down the setback lockout if not finished...  (TODO-786, TODO-906)
+#if defined(ENABLE_EEPROM_WEAR_STATS)
+    eeWearCountDownSetbackLockout();
+#else
     OTRadValve::countDownSetbackLockout();
+#endif
+#endif
+#if defined(ENABLE_EEPROM_WEAR_STATS)
+    eeWearCheckpoint();
+#endif
+#if defined(ENABLE_BATTERY_LIFE_ESTIMATE)
+    batteryLifeDailyUpdate();
+#endif
+#if defined(ENABLE_VALVE_MOVE_PLANNER) && defined(HAS_DORM1_VALVE_DRIVE) && defined(ENABLE_MODELLED_RAD_VALVE)
+    valveMovePlanner.endOfDay();
 #endif
   }
 
@@ -553,9 +1830,225 @@ static uint_fast8_t TIME_LSD;
 // Wraps at its maximum (0xff) value.
 static uint8_t minuteCount;
 
+#if defined(ENABLE_ADAPTIVE_SENSOR_SAMPLING)
+// Minutes between room temperature (and RH) samples while quiet; a power of 2.
+static constexpr uint8_t SENSOR_QUIET_INTERVAL_M = 4;
+// Largest change (C*16) between successive samples still counted as steady.
+static constexpr int16_t SENSOR_STEADY_DELTA_C16 = 2;
+// Steady samples needed before sampling slows.
+static constexpr uint8_t SENSOR_STEADY_MIN_SAMPLES = 4;
+// Temperature at the last sample.
+static int16_t sensorLastTempC16;
+// Consecutive steady samples, saturating.
+static uint8_t sensorSteadySamples;
+// True if room temperature (and RH, if otherwise due) should be sampled this minute.
+// Every minute while anything may be changing: just after start-up, in WARM (or BAKE),
+// with the valve open or calling for heat, or while the temperature is moving;
+// otherwise, eg steady in FROST or set back and vacant, only every SENSOR_QUIET_INTERVAL_M minutes.
+// The valve model still runs every minute, and sees no change between samples.
+static bool sensorSampleDueNow()
+  {
+  if((minuteCount < 4) || (sensorSteadySamples < SENSOR_STEADY_MIN_SAMPLES)) { return(true); }
+  if(valveMode.inWarmMode() || (0 != NominalRadValve.get()) || NominalRadValve.isCallingForHeat()) { return(true); }
+  return(0 == (minuteCount & (SENSOR_QUIET_INTERVAL_M - 1)));
+  }
+// minuteCount when sensorSampleDueLatched was decided.
+static uint8_t sensorSampleDueMinute = 0xff;
+static bool sensorSampleDueLatched;
+// As sensorSampleDueNow() but decided once per minute at the first call,
+// so that a conversion started early (slot 44) is collected iff started, whatever changes before slot 54.
+static bool sensorSampleDue()
+  {
+  if(minuteCount != sensorSampleDueMinute) { sensorSampleDueLatched = sensorSampleDueNow(); sensorSampleDueMinute = minuteCount; }
+  return(sensorSampleDueLatched);
+  }
+// Note a fresh temperature sample, to track whether it is steady.
+static void sensorSampleNote()
+  {
+  const int16_t t = TemperatureC16.get();
+  const int16_t d = t - sensorLastTempC16;
+  sensorLastTempC16 = t;
+  if(TemperatureC16.isErrorValue(t) || (d > SENSOR_STEADY_DELTA_C16) || (d < -SENSOR_STEADY_DELTA_C16)) { sensorSteadySamples = 0; }
+  else if(sensorSteadySamples < 0xff) { ++sensorSteadySamples; }
+  }
+#else
+#define sensorSampleDue() (true)
+#define sensorSampleNote() {}
+#endif // ENABLE_ADAPTIVE_SENSOR_SAMPLING
+
+#if defined(ENABLE_STATS_TX) && defined(ENABLE_ADAPTIVE_STATS_TX_RATE) && !defined(ENABLE_FREQUENT_STATS_TX)
+// Normal stats TX interval in minutes: 2 for a valve (for prompt boiler response), else 4.
+#ifdef ENABLE_NOMINAL_RAD_VALVE
+static constexpr uint8_t STATS_TX_BASE_INTERVAL_M = 2;
+#else
+static constexpr uint8_t STATS_TX_BASE_INTERVAL_M = 4;
+#endif
+// Ceiling for the stretched interval; this is also the heartbeat that the hub sees.
+// Must stay below the hub's valve staleness timeout (15 minutes) so stable valves are not forgotten.
+static constexpr uint8_t STATS_TX_MAX_INTERVAL_M = 12;
+// Hysteresis bands: smaller changes than these since the last TX count as stable.
+static constexpr int16_t STATS_TX_TEMP_BAND_C16 = 8; // 0.5C.
+static constexpr uint8_t STATS_TX_VALVE_BAND_PC = 5;
+// Current interval [STATS_TX_BASE_INTERVAL_M,STATS_TX_MAX_INTERVAL_M] and minutes since last stats TX.
+static uint8_t statsTXInterval = STATS_TX_BASE_INTERVAL_M;
+static uint8_t minutesSinceStatsTX = 0xff; // Send soon after start-up.
+// Values as of last stats TX.
+static int16_t lastTXTempC16;
+static uint8_t lastTXValvePC;
+static uint8_t lastTXOcc;
+// True if any key reading has moved outside its hysteresis band since the last stats TX.
+// Note that this makes the TX timing reflect changes, eg in occupancy, which plain fixed-cadence TX avoids.
+static bool statsChangedSignificantly()
+  {
+  const int16_t dT = TemperatureC16.get() - lastTXTempC16;
+  if((dT >= STATS_TX_TEMP_BAND_C16) || (dT <= -STATS_TX_TEMP_BAND_C16)) { return(true); }
+#ifdef ENABLE_NOMINAL_RAD_VALVE
+  const uint8_t v = NominalRadValve.get();
+  if(((v > lastTXValvePC) ? (v - lastTXValvePC) : (lastTXValvePC - v)) >= STATS_TX_VALVE_BAND_PC) { return(true); }
+#endif
+  if(Occupancy.twoBitOccupancyValue() != lastTXOcc) { return(true); }
+  return(false);
+  }
+// True if stats should be sent this minute: on significant change, else when the current interval has elapsed.
+static bool statsTXDue() { return((minutesSinceStatsTX >= statsTXInterval) || statsChangedSignificantly()); }
+// Call after sending stats: resets the interval after change, else doubles it towards the ceiling.
+static void noteStatsTXSent()
+  {
+  if(statsChangedSignificantly()) { statsTXInterval = STATS_TX_BASE_INTERVAL_M; }
+  else { statsTXInterval = OTV0P2BASE::fnmin((uint8_t)(2 * statsTXInterval), STATS_TX_MAX_INTERVAL_M); }
+  minutesSinceStatsTX = 0;
+  lastTXTempC16 = TemperatureC16.get();
+#ifdef ENABLE_NOMINAL_RAD_VALVE
+  lastTXValvePC = NominalRadValve.get();
+#endif
+  lastTXOcc = Occupancy.twoBitOccupancyValue();
+  }
+#endif // ENABLE_ADAPTIVE_STATS_TX_RATE
+
+#if defined(ENABLE_JITTER_XORSHIFT_RNG)
+// Never zero, else the generator sticks there.
+static uint32_t jitterRNGState = 1;
+void seedJitterRNG()
+  {
+  uint32_t s = 0;
+  for(uint8_t i = 0; i < 4; ++i)
+    { s = (s << 8) | (uint8_t)(OTV0P2BASE::getSecureRandomByte() ^ getNodeIDByte(i) ^ getNodeIDByte(i + 4)); }
+  if(0 != s) { jitterRNGState = s; }
+  }
+// Marsaglia's 13/17/5 triple; the top byte is returned as the best mixed.
+uint8_t jitterRand8()
+  {
+  uint32_t x = jitterRNGState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  jitterRNGState = x;
+  return((uint8_t)(x >> 24));
+  }
+#endif // ENABLE_JITTER_XORSHIFT_RNG
+
+#if defined(ENABLE_STATS_TX) && defined(ENABLE_ADAPTIVE_TX_SLOT)
+bool statsTXFailed;
+// Stats TX backoff exponent [0,STATS_TX_BACKOFF_MAX]; grows on busy channel or failed TX, decays on success.
+static uint8_t statsTXBackoff;
+static constexpr uint8_t STATS_TX_BACKOFF_MAX = 3;
+static void noteStatsTXBusy() { if(statsTXBackoff < STATS_TX_BACKOFF_MAX) { ++statsTXBackoff; } }
+// Pick the stats TX slot [0,7] for this minute, or 0xff to sit this minute out.
+// Each node walks the slots from an ID-derived start with an ID-derived odd stride,
+// so nodes that collide in one minute are unlikely to do so again in the next;
+// this spreads a dense deployment more evenly than independent random picks.
+// While backing off, the slot is also randomised and whole minutes are skipped
+// with probability 1-2^-backoff, halving the offered load with each step.
+static uint8_t pickStatsTXSlot()
+  {
+  uint8_t slot = (uint8_t)(getNodeIDByte(0) + minuteCount * (getNodeIDByte(1) | 1));
+  if(0 != statsTXBackoff)
+    {
+    if(0 != (jitterRand8() & ((1 << statsTXBackoff) - 1))) { return(0xff); }
+    slot += jitterRand8();
+    }
+  return(slot & 7);
+  }
+#endif // ENABLE_ADAPTIVE_TX_SLOT
+
+#if defined(ENABLE_TIME_SYNC_BEACON)
+// Second in which the hub sends the time sync; mid-minute so that leaf and hub are taken to be in the same minute.
+static constexpr uint8_t TIME_SYNC_TX_S = 32;
+// Leaf: hub-assigned stats TX slot [0,7] (0xff if none), and minutes since the last sync (0xff if none).
+static uint8_t timeSyncSlot = 0xff;
+static uint8_t timeSyncAgeM = 0xff;
+// Leaf: seconds by which the RTC leads the hub's (negative if behind), to correct at the next minute boundary; 0 if none pending.
+static int8_t timeSyncLagS;
+// Leaf: true while holding back the start of the next minute to meet the hub's.
+static bool timeSyncHolding;
+// Sync older than this is treated as lost; synced leaves only listen for one in four of the hub's.
+static constexpr uint8_t TIME_SYNC_MAX_AGE_M = 30;
+static bool timeSyncFresh() { return(timeSyncAgeM <= TIME_SYNC_MAX_AGE_M); }
+// Hubs do not follow other hubs, and FS20 TX timing is anchored to the local RTC so FHT8V controllers are left alone.
+static bool timeSyncApplies() { return(!inHubMode() && !localFHT8VTRVEnabled()); }
+void timeSyncRX(const uint8_t hubSeconds, const uint8_t hubMinutePhase, const uint8_t slot)
+  {
+  if(!timeSyncApplies() || (hubSeconds >= TIME_CYCLE_S)) { return; }
+  const int8_t lag = (int8_t)OTV0P2BASE::getSecondsLT() - (int8_t)hubSeconds;
+  // Allow a second for RX handling.
+  timeSyncLagS = ((lag < 0) || (lag > 1)) ? lag : 0;
+  minuteCount = (uint8_t)((minuteCount & ~3) | (hubMinutePhase & 3));
+  timeSyncSlot = slot;
+  timeSyncAgeM = 0;
+  }
+// Leaf: apply any pending correction once the last slot of the minute has run,
+// by setting the RTC back so that the next minute starts with the hub's; call between loop passes.
+// The minute is only ever lengthened, so no slot is skipped or repeated:
+// a leaf that is behind waits out the rest of the hub's minute, and steps minuteCount to match.
+static void applyTimeSync()
+  {
+  if((0 == timeSyncLagS) || (TIME_LSD < TIME_CYCLE_S - OTV0P2BASE::MAIN_TICK_S)) { return; }
+  uint8_t lengthen = (timeSyncLagS > 0) ? (uint8_t)timeSyncLagS : (uint8_t)(TIME_CYCLE_S + timeSyncLagS);
+  lengthen -= lengthen % OTV0P2BASE::MAIN_TICK_S;
+  if(timeSyncLagS < 0) { ++minuteCount; }
+  timeSyncLagS = 0;
+  if(0 == lengthen) { return; }
+  const uint_fast8_t t = TIME_LSD - lengthen;
+  OTV0P2BASE::setSeconds((uint8_t)t);
+  TIME_LSD = t;
+  timeSyncHolding = true;
+  }
+// Leaf: while holding, note each new slot as passed and return true to sleep again, until the RTC wraps to the new minute.
+// Keeps the RTC watchdog fed meanwhile.
+static bool timeSyncHold(const uint_fast8_t newTLSD)
+  {
+  if(!timeSyncHolding) { return(false); }
+  if(newTLSD < TIME_LSD) { timeSyncHolding = false; return(false); }
+  TIME_LSD = newTLSD;
+#if defined(ENABLE_WATCHDOG_SLOW)
+  OTV0P2BASE::resetRTCWatchDog();
+  OTV0P2BASE::enableRTCWatchdog(true);
+#endif
+  return(true);
+  }
+// Leaf: true if the radio should listen for the coming second to catch a sync:
+// around TIME_SYNC_TX_S one minute in four while in sync, else through one whole minute in 64.
+static bool timeSyncWantsRX()
+  {
+  if(!timeSyncApplies()) { return(false); }
+  if(!timeSyncFresh()) { return(0 == (minuteCount & 63)); }
+  return((0 == (minuteCount & 3)) && (TIME_LSD + 4 >= TIME_SYNC_TX_S) && (TIME_LSD <= TIME_SYNC_TX_S + 2));
+  }
+#else
+#define timeSyncHold(newTLSD) (false)
+#endif // ENABLE_TIME_SYNC_BEACON
+
 // Mask for Port B input change interrupts.
-#define MASK_PB_BASIC 0b00000000 // Nothing.
-#if defined(PIN_RFM_NIRQ) && defined(ENABLE_RADIO_RX) // RFM23B IRQ only used for RX.
+#if defined(ENABLE_BUTTON_EVENT_QUEUE) && defined(BUTTON_LEARN_L)
+  #if (BUTTON_LEARN_L < 8) || (BUTTON_LEARN_L > 15)
+    #error BUTTON_LEARN_L expected to be on port B
+  #endif
+  #define LEARN_INT_MASK (1 << (BUTTON_LEARN_L&7))
+  #define MASK_PB_BASIC LEARN_INT_MASK // LEARN button.
+#else
+  #define MASK_PB_BASIC 0b00000000 // Nothing.
+#endif
+#if defined(PIN_RFM_NIRQ) && (defined(ENABLE_RADIO_RX) || defined(ENABLE_RFM23B_SLEEPY_TX)) // RFM23B IRQ used for RX, and to end TX naps.
   #if (PIN_RFM_NIRQ < 8) || (PIN_RFM_NIRQ > 15)
     #error PIN_RFM_NIRQ expected to be on port B
   #endif
@@ -580,7 +2073,7 @@ static uint8_t minuteCount;
 #else
   #define MASK_PD1 MASK_PD_BASIC // Just serial RX, no voice.
 #endif
-#if defined(ENABLE_SIMPLIFIED_MODE_BAKE)
+#if defined(ENABLE_SIMPLIFIED_MODE_BAKE) || defined(ENABLE_BUTTON_EVENT_QUEUE)
 #if BUTTON_MODE_L > 7
   #error BUTTON_MODE_L expected to be on port D
 #endif
@@ -590,6 +2083,85 @@ static uint8_t minuteCount;
   #define MASK_PD MASK_PD1 // No MODE button interrupt.
 #endif
 
+#if defined(ENABLE_BUTTON_EVENT_QUEUE)
+// Debounced button presses queued from the pin-change ISRs for the main loop.
+// Each edge is timestamped with the sub-cycle time and a press (falling edge) is only queued
+// if the button has been quiet for BUTTON_DEBOUNCE_SCT ticks, so contact bounce on press and release is dropped.
+// (The 8-bit timestamp wraps every 2s so very rarely a real press is taken as a bounce.)
+enum buttonEvent_t : uint8_t { BE_MODE, BE_LEARN, BE_COUNT };
+static constexpr uint8_t BUTTON_DEBOUNCE_SCT = 4; // ~32ms.
+static constexpr uint8_t BUTTON_EVENT_QUEUE_SIZE = 4; // Power of two.
+// Filled by the (non-nesting) pin-change ISRs, drained by the main loop.
+static SPSCRing<uint8_t, BUTTON_EVENT_QUEUE_SIZE> buttonEventQueue;
+// Sub-cycle time of the last edge seen on each button; only touched in (non-nesting) ISRs.
+static uint8_t buttonLastEdgeSCT[BE_COUNT];
+// Set by the main loop when presses have been taken from the queue but not yet shown to valveUI.read().
+static bool buttonUIPending;
+// Note an edge on a button from an ISR; queue it if a debounced press, dropping it if the queue is full.
+static inline void buttonEdgeFromISR(const buttonEvent_t b, const bool pressed)
+  {
+  const uint8_t now = OTV0P2BASE::getSubCycleTime();
+  const uint8_t quiet = now - buttonLastEdgeSCT[b];
+  buttonLastEdgeSCT[b] = now;
+  if(!pressed || (quiet < BUTTON_DEBOUNCE_SCT)) { return; }
+  buttonEventQueue.put(b);
+  }
+// Act on any queued presses; call from the main loop including straight after each wake from sleep.
+// Returns true if the UI should be run at the next opportunity.
+static bool pollButtonEvents()
+  {
+  uint8_t b;
+  while(buttonEventQueue.get(b))
+    {
+#if defined(ENABLE_SIMPLIFIED_MODE_BAKE)
+    // Was done direct from the ISR, undebounced.
+    if(BE_MODE == b) { valveUI.startBakeFromInt(); }
+#endif
+    buttonUIPending = true;
+    }
+  return(buttonUIPending);
+  }
+#endif // ENABLE_BUTTON_EVENT_QUEUE
+
+#if defined(ENABLE_COOP_TASKS)
+static uint8_t coopRunnable; // Bit t set while task t has more to do.
+void coopTaskStart(const coopTask_t t) { coopRunnable |= (uint8_t)(1U << t); }
+// Run one slice of task t; true if it has more to do.
+static bool coopRunSlice(const uint8_t t)
+  {
+  switch(t)
+    {
+#if defined(ENABLE_BULK_STATS_EXPORT)
+    case COOP_TASK_EXPORT: return(exportTask());
+#endif
+#if defined(ENABLE_VALVE_MOVE_LOG)
+    case COOP_TASK_VML_DUMP: return(valveMoveLogDumpTask());
+#endif
+    default: return(false);
+    }
+  }
+void coopTasksRun(const uint8_t stopBy)
+  {
+  if(0 == coopRunnable) { return; }
+  const PeripheralPower<PP_SERIAL> serialPower;
+  bool outOfTime = false;
+  while((0 != coopRunnable) && !outOfTime)
+    {
+    for(uint8_t t = 0; t < COOP_TASKS_COUNT; ++t)
+      {
+      const uint8_t bit = (uint8_t)(1U << t);
+      if(0 == (coopRunnable & bit)) { continue; }
+      OTV0P2BASE::flushSerialProductive(); // Ensure pending output is flushed before sampling current position in minor cycle.
+      if(OTV0P2BASE::getSubCycleTime() >= stopBy) { outOfTime = true; break; }
+      if(!coopRunSlice(t)) { coopRunnable &= (uint8_t)~bit; }
+      // Between slices is the natural point to keep RX latency down.
+      handleQueuedMessages(&Serial, false, &PrimaryRadio);
+      }
+    }
+  OTV0P2BASE::flushSerialSCTSensitive();
+  }
+#endif // ENABLE_COOP_TASKS
+
 void setupOpenTRV()
   {
 #if 0 && defined(DEBUG)
@@ -599,6 +2171,9 @@ void setupOpenTRV()
   // Radio not listening to start with.
   // Ignore any initial spurious RX interrupts for example.
   PrimaryRadio.listen(false);
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+  RFM23BAux.listen(false);
+#endif
 
 #if 0 && defined(DEBUG)
   DEBUG_SERIAL_PRINTLN_FLASHSTRING("PrimaryRadio.listen(false);");
@@ -612,7 +2187,7 @@ void setupOpenTRV()
     //PCMSK2 = PD; PCINT 16--24   (Serial RX and LEARN2 and MODE and Voice)
 
     PCICR =
-#if defined(MASK_PB) && (MASK_PB != 0) // If PB interrupts required.
+#if (defined(MASK_PB) && (MASK_PB != 0)) || defined(RFM23B_AUX_INT_MASK) // If PB interrupts required.
         1 | // 0x1 enables PB/PCMSK0.
 #endif
 #if defined(MASK_PC) && (MASK_PC != 0) // If PC interrupts required.
@@ -623,7 +2198,11 @@ void setupOpenTRV()
 #endif
         0;
 
-#if defined(MASK_PB) && (MASK_PB != 0) // If PB interrupts required.
+#if defined(RFM23B_AUX_INT_MASK) && defined(MASK_PB)
+    PCMSK0 = MASK_PB | RFM23B_AUX_INT_MASK;
+#elif defined(RFM23B_AUX_INT_MASK)
+    PCMSK0 = RFM23B_AUX_INT_MASK;
+#elif defined(MASK_PB) && (MASK_PB != 0) // If PB interrupts required.
     PCMSK0 = MASK_PB;
 #endif
 #if defined(MASK_PC) && (MASK_PC != 0) // If PC interrupts required.
@@ -644,12 +2223,28 @@ void setupOpenTRV()
   // Initialise sensors with stats info where needed.
   updateSensorsFromStats();
 
+#if defined(ENABLE_BOILER_HUB) && defined(ENABLE_BOILER_HUB_VALVE_TABLE)
+  // Start with no valves known.
+  clearHubValves();
+#endif
+#if defined(ENABLE_BOILER_HUB_ZONES)
+  // All zones off until called for.
+  clearBoilerZones();
+#endif
+
 #ifdef ENABLE_STATS_TX
   // Do early 'wake-up' stats transmission if possible
   // when everything else is set up and ready and allowed (TODO-636)
   // including all set-up and inter-wiring of sensors/actuators.
   if(enableTrailingStatsPayload())
     {
+#if defined(ENABLE_FAST_START_STATS)
+    // After a building-wide power cycle every unit gets here at about the same time,
+    // so wait a random 0--15s, then send a single frame packed with as many stats as fit.
+    // Any values not sent now go out with the normal stats rotation.
+    for(uint8_t i = OTV0P2BASE::getSecureRandomByte() & 0x7f; i-- > 0; ) { ::OTV0P2BASE::nap(WDTO_120MS, false); }
+    bareStatsTX(false, false);
+#else
     // Attempt to maximise chance of reception with a double TX.
     // Assume not in hub mode (yet).
     // Send all possible formats, binary first (assumed complete in one message).
@@ -666,6 +2261,7 @@ void setupOpenTRV()
       bareStatsTX(true, false);
       if(!ss1.changedValue()) { break; }
       }
+#endif // ENABLE_FAST_START_STATS
     }
 #endif
 
@@ -700,7 +2296,7 @@ void setupOpenTRV()
 
 #if !defined(ALT_MAIN_LOOP) // Do not define handlers here when alt main is in use.
 
-#if defined(MASK_PB) && (MASK_PB != 0) // If PB interrupts required.
+#if (defined(MASK_PB) && (MASK_PB != 0)) || defined(RFM23B_AUX_INT_MASK) // If PB interrupts required.
 //// Interrupt count.  Marked volatile so safe to read without a lock as is a single byte.
 //static volatile uint8_t intCountPB;
 // Previous state of port B pins to help detect changes.
@@ -708,17 +2304,46 @@ static volatile uint8_t prevStatePB;
 // Interrupt service routine for PB I/O port transition changes.
 ISR(PCINT0_vect)
   {
+#if defined(ENABLE_ISR_PROFILER)
+  const uint16_t isrStart = isrProfileStart();
+#endif
 //  ++intCountPB;
   const uint8_t pins = PINB;
   const uint8_t changes = pins ^ prevStatePB;
   prevStatePB = pins;
 
+#if defined(ENABLE_BUTTON_EVENT_QUEUE) && defined(LEARN_INT_MASK)
+  if(changes & LEARN_INT_MASK) { buttonEdgeFromISR(BE_LEARN, !(pins & LEARN_INT_MASK)); }
+#endif
+
 #if defined(RFM23B_INT_MASK)
   // RFM23B nIRQ falling edge is of interest.
   // Handler routine not required/expected to 'clear' this interrupt.
   // TODO: try to ensure that OTRFM23BLink.handleInterruptSimple() is inlineable to minimise ISR prologue/epilogue time and space.
   if((changes & RFM23B_INT_MASK) && !(pins & RFM23B_INT_MASK))
-    { PrimaryRadio.handleInterruptSimple(); }
+    {
+    stackTag(STACK_TAG_ISR);
+#if defined(ENABLE_RELAY_LATENCY_STATS)
+    const bool wasEmpty = (0 == PrimaryRadio.getRXMsgsQueued());
+#endif
+    PrimaryRadio.handleInterruptSimple();
+#if defined(ENABLE_RELAY_LATENCY_STATS)
+    if(wasEmpty && (0 != PrimaryRadio.getRXMsgsQueued())) { latencyRXQueued(); }
+#endif
+    }
+#endif
+
+#if defined(RFM23B_AUX_INT_MASK)
+  // Auxiliary RFM23B nIRQ falling edge, handled as for the primary.
+  if((changes & RFM23B_AUX_INT_MASK) && !(pins & RFM23B_AUX_INT_MASK))
+    {
+    stackTag(STACK_TAG_ISR);
+    RFM23BAux.handleInterruptSimple();
+    }
+#endif
+
+#if defined(ENABLE_ISR_PROFILER)
+  isrProfileRecord(ISR_PROFILE_PB, isrStart);
 #endif
   }
 #endif
@@ -743,11 +2368,16 @@ static volatile uint8_t prevStatePD;
 // Interrupt service routine for PD I/O port transition changes (including RX).
 ISR(PCINT2_vect)
   {
+#if defined(ENABLE_ISR_PROFILER)
+  const uint16_t isrStart = isrProfileStart();
+#endif
   const uint8_t pins = PIND;
   const uint8_t changes = pins ^ prevStatePD;
   prevStatePD = pins;
 
-#if defined(ENABLE_SIMPLIFIED_MODE_BAKE)
+#if defined(ENABLE_BUTTON_EVENT_QUEUE)
+  if(changes & MODE_INT_MASK) { buttonEdgeFromISR(BE_MODE, !(pins & MODE_INT_MASK)); }
+#elif defined(ENABLE_SIMPLIFIED_MODE_BAKE)
   // Mode button detection is on the falling edge (button pressed).
   if((changes & MODE_INT_MASK) && !(pins & MODE_INT_MASK))
     { valveUI.startBakeFromInt(); }
@@ -762,7 +2392,13 @@ ISR(PCINT2_vect)
   // Handler routine not required/expected to 'clear' this interrupt.
   // FIXME: ensure that Voice.handleInterruptSimple() is inlineable to minimise ISR prologue/epilogue time and space.
   if((changes & VOICE_INT_MASK) && (pins & VOICE_INT_MASK))
-    { Voice.handleInterruptSimple(); }
+    {
+    Voice.handleInterruptSimple();
+#if defined(ENABLE_VOICE_IRQ_RATE_LIMIT)
+    // One edge is enough to flag this window, so ignore the rest until the voice slot re-arms.
+    PCMSK2 &= ~VOICE_INT_MASK;
+#endif
+    }
 #endif // defined(ENABLE_VOICE_SENSOR)
 
   // If an interrupt arrived from the serial RX then wake up the CLI.
@@ -772,6 +2408,10 @@ ISR(PCINT2_vect)
   // TODO: ensure that resetCLIActiveTimer() is inlineable to minimise ISR prologue/epilogue time and space.
   if((changes & SERIALRX_INT_MASK) && !(pins & SERIALRX_INT_MASK))
     { OTV0P2BASE::CLI::resetCLIActiveTimer(); }
+
+#if defined(ENABLE_ISR_PROFILER)
+  isrProfileRecord(ISR_PROFILE_PD, isrStart);
+#endif
   }
 #endif
 
@@ -780,7 +2420,7 @@ ISR(PCINT2_vect)
 
 #if defined(ENABLE_BOILER_HUB)
 // Ticks until locally-controlled boiler should be turned off; boiler should be on while this is positive.
-// Ticks are of the main loop, ie 2s (almost always).
+// Ticks are of the main loop, ie OTV0P2BASE::MAIN_TICK_S (usually 2s).
 // Used in hub mode only.
 static uint16_t boilerCountdownTicks;
 // True if boiler should be on.
@@ -789,6 +2429,55 @@ static bool isBoilerOn() { return(0 != boilerCountdownTicks); }
 // Does not roll once at its maximum value (255).
 // DHD20160124: starting at zero forces at least for off time after power-up before firing up boiler (good after power-cut).
 static uint8_t boilerNoCallM;
+
+#if defined(ENABLE_BOILER_HUB_CHECKPOINT)
+// Boiler state as last checkpointed, and minutes since then (to 255), initially long ago.
+static bool boilerCheckpointOn;
+static uint8_t boilerCheckpointAgeM = 255;
+static void boilerCheckpointWrite(const bool on)
+  {
+  const uint16_t m = OTV0P2BASE::getMinutesSinceMidnightLT();
+  uint8_t *const p = (uint8_t *)V0P2_EE_START_BOILER_CHECKPOINT;
+  eeQueueUpdateByte(EEW_CONFIG, p, (uint8_t)(m >> 8));
+  eeQueueUpdateByte(EEW_CONFIG, p + 1, (uint8_t)m);
+  eeQueueUpdateByte(EEW_CONFIG, p + 2, on ? BOILER_CP_ON : BOILER_CP_OFF);
+  boilerCheckpointOn = on;
+  boilerCheckpointAgeM = 0;
+  }
+// Call at the end of each processCallsForHeat() pass: checkpoints an on/off change once the last checkpoint
+// is BOILER_CP_MIN_INTERVAL_M old, and hourly while on so that a checkpoint saying on is never more than an hour old while the boiler still is.
+static void boilerCheckpointPoll(const bool second0)
+  {
+  if(second0 && (boilerCheckpointAgeM < 255)) { ++boilerCheckpointAgeM; }
+  const bool on = isBoilerOn();
+  if((on != boilerCheckpointOn) ? (boilerCheckpointAgeM >= BOILER_CP_MIN_INTERVAL_M) : (on && (boilerCheckpointAgeM >= 60)))
+    { boilerCheckpointWrite(on); }
+  }
+void boilerCheckpointSetup(const uint8_t resetCause)
+  {
+  const uint8_t *const p = (const uint8_t *)V0P2_EE_START_BOILER_CHECKPOINT;
+  const uint8_t state = eeprom_read_byte(p + 2);
+  // Until the first write the checkpoint is taken to match the boiler (off).
+  boilerCheckpointOn = false;
+  if((0 == (resetCause & (_BV(WDRF) | _BV(BORF)))) || (0 != (resetCause & _BV(PORF)))) { return; }
+  const uint16_t then = ((uint16_t)eeprom_read_byte(p) << 8) | eeprom_read_byte(p + 1);
+  const uint8_t minOnMins = getMinBoilerOnMinutes();
+  if((then >= 1440) || (0 == minOnMins)) { return; }
+  // The restored RTC may be a little behind the checkpoint; count that as no time.
+  uint16_t ageM = (OTV0P2BASE::getMinutesSinceMidnightLT() + 1440 - then) % 1440;
+  if(ageM > 1440 - 60) { ageM = 0; }
+  if(BOILER_CP_ON == state)
+    {
+    if(ageM > 60 + minOnMins) { return; } // Stale: the boiler was not still on.
+    boilerCountdownTicks = minOnMins * (uint16_t) MAIN_TICKS_PER_MINUTE;
+    boilerNoCallM = 0;
+    boilerCheckpointOn = true; // The output follows on the first loop pass.
+    }
+  else if(BOILER_CP_OFF == state) { boilerNoCallM = (uint8_t)OTV0P2BASE::fnmin(ageM, (uint16_t)255); }
+  }
+#else
+#define boilerCheckpointPoll(second0) {}
+#endif // ENABLE_BOILER_HUB_CHECKPOINT
 // Reducing listening if quiet for a while helps reduce self-heating temperature error
 // (~2C as of 2013/12/24 at 100% RX, ~100mW heat dissipation in V0.2 REV1 box) and saves some energy.
 // Time thresholds could be affected by eco/comfort switch.
@@ -796,6 +2485,11 @@ static uint8_t boilerNoCallM;
 // IF DEFINED then give backoff threshold to minimise duty cycle.
 //#define RX_REDUCE_MAX_M 240 // Minutes quiet before considering maximally reducing RX duty cycle; ]RX_REDUCE_MIN_M--255], 30--240 typical.
 
+#if defined(ENABLE_CALL_FOR_HEAT_RING)
+// IDs of plausible calls for heat received since last polled,
+// so several in one pass are each logged and none need interrupts disabled to take.
+static SPSCRing<uint16_t, 8> receivedCallsForHeat;
+#else
 // Set true on receipt of plausible call for heat,
 // to be polled, evaluated and cleared by the main control routine.
 // Marked volatile to allow thread-safe lock-free access.
@@ -804,6 +2498,143 @@ static volatile bool receivedCallForHeat;
 // Marked volatile to allow access from an ISR,
 // but note that access may only be safe with interrupts disabled as not a byte value.
 static volatile uint16_t receivedCallForHeatID;
+#endif // ENABLE_CALL_FOR_HEAT_RING
+
+#if defined(ENABLE_BOILER_HUB_ZONES)
+#if !defined(BOILER_HUB_ZONE_OUT_PINS)
+#error BOILER_HUB_ZONE_OUT_PINS must list one spare output pin per zone, eg { 4, 7 }
+#endif
+// One output per zone (eg a zone valve or a further boiler), on while the boiler is
+// and for at least the minimum on time after a call for heat from that zone.
+static const uint8_t boilerZonePins[] = BOILER_HUB_ZONE_OUT_PINS;
+static constexpr uint8_t BOILER_HUB_ZONES = sizeof(boilerZonePins);
+static_assert((BOILER_HUB_ZONES >= 1) && (BOILER_HUB_ZONES <= 8), "1 to 8 boiler hub zones");
+// Ticks until each zone output should be turned off, as for boilerCountdownTicks.
+static uint16_t boilerZoneCountdownTicks[BOILER_HUB_ZONES];
+// Bit per zone with an accepted call for heat not yet processed.
+static uint8_t receivedZoneCalls;
+// Zone for a valve from the EEPROM map; 0 if not mapped.
+static uint8_t getBoilerZone(const uint16_t id)
+  {
+  const uint8_t *p = (const uint8_t *)V0P2_EE_START_BOILER_ZONE_MAP;
+  for(uint8_t i = 0; i < BOILER_ZONE_MAP_ENTRIES; ++i, p += 2)
+    {
+    if(eeprom_read_byte(p) != (uint8_t)(id >> 8)) { continue; }
+    const uint8_t z = eeprom_read_byte(p+1);
+    if(z < BOILER_HUB_ZONES) { return(z); }
+    }
+  return(0);
+  }
+// Set all zone outputs off, eg at start-up.
+static void clearBoilerZones()
+  {
+  for(uint8_t z = 0; z < BOILER_HUB_ZONES; ++z)
+    { boilerZoneCountdownTicks[z] = 0; pinMode(boilerZonePins[z], OUTPUT); fastDigitalWrite(boilerZonePins[z], LOW); }
+  }
+#endif // ENABLE_BOILER_HUB_ZONES
+
+#if defined(ENABLE_BOILER_HUB_VALVE_TABLE)
+// Per-valve call-for-heat table, so that calls from many valves do not overwrite one another
+// and boiler decisions can be taken on aggregate demand.
+// Entries are replaced oldest-first when the table is full.
+#ifndef BOILER_HUB_MAX_VALVES
+#define BOILER_HUB_MAX_VALVES 16 // 4 (5 with ENABLE_BOILER_DEMAND_MODEL) bytes of RAM each.
+#endif
+// Minutes after which a valve not heard from is ignored; valves normally report every few minutes.
+static constexpr uint8_t BOILER_HUB_VALVE_STALE_M = 15;
+// Sum of percent-open over recently-heard valves that counts as a call for heat
+// even if no single valve is open far enough, eg several valves partly open.
+static constexpr uint16_t BOILER_HUB_AGGREGATE_PC = 100;
+typedef struct
+  {
+  uint16_t id; // Valve ID (eg FHT8V house code); not a sentinel, as 0xffff is a valid ID.
+  uint8_t percentOpen; // Last reported percent open [0,100].
+  uint8_t ageM; // Minutes since last heard, saturating at 255; 255 also for an unused entry.
+#if defined(ENABLE_BOILER_DEMAND_MODEL)
+  uint8_t weightQ; // Demand weight in quarters.
+#endif
+  } hubValve_t;
+static hubValve_t hubValves[BOILER_HUB_MAX_VALVES];
+// Minimum percent open for an individual valve to count as calling; set from the latest threshold.
+static uint8_t hubValvePCThreshold = OTRadValve::DEFAULT_VALVE_PC_SAFER_OPEN;
+// Mark all entries unused (age 255, so ignored as stale and replaced first).
+static void clearHubValves() { memset(hubValves, 0xff, sizeof(hubValves)); }
+#if defined(ENABLE_BOILER_DEMAND_MODEL)
+// Weight in quarters for the given valve from the EEPROM table; 4 (1.0) if none.
+// Capped at 16 (4.0) so that the weighted sum over the table cannot overflow.
+static uint8_t getBoilerValveWeightQ(const uint16_t id)
+  {
+  const uint8_t *p = (const uint8_t *)V0P2_EE_START_BOILER_VALVE_WEIGHTS;
+  for(uint8_t i = 0; i < BOILER_VALVE_WEIGHT_ENTRIES; ++i, p += 3)
+    {
+    if((eeprom_read_byte(p) != (uint8_t)(id >> 8)) || (eeprom_read_byte(p+1) != (uint8_t)id)) { continue; }
+    const uint8_t w = eeprom_read_byte(p+2);
+    if(0xff != w) { return((w > 16) ? 16 : w); }
+    }
+  return(4);
+  }
+#endif // ENABLE_BOILER_DEMAND_MODEL
+// Record the latest report from a valve.
+static void recordHubValve(const uint16_t id, const uint8_t percentOpen)
+  {
+  hubValve_t *slot = hubValves;
+  for(hubValve_t *v = hubValves; v < hubValves + BOILER_HUB_MAX_VALVES; ++v)
+    {
+    if(id == v->id) { slot = v; break; }
+    if(v->ageM > slot->ageM) { slot = v; } // Oldest (unused entries are age 255) so far.
+    }
+#if defined(ENABLE_BOILER_DEMAND_MODEL)
+  if(id != slot->id) { slot->weightQ = getBoilerValveWeightQ(id); }
+#endif
+  slot->id = id;
+  slot->percentOpen = percentOpen;
+  slot->ageM = 0;
+  }
+// Age all entries by one minute.
+static void ageHubValves()
+  { for(hubValve_t *v = hubValves; v < hubValves + BOILER_HUB_MAX_VALVES; ++v) { if(v->ageM < 255) { ++v->ageM; } } }
+// Sum of percent-open over recently-heard valves.
+static uint16_t hubValvesSumPC()
+  {
+  uint16_t sum = 0;
+  for(const hubValve_t *v = hubValves; v < hubValves + BOILER_HUB_MAX_VALVES; ++v)
+    { if(v->ageM < BOILER_HUB_VALVE_STALE_M) { sum += v->percentOpen; } }
+  return(sum);
+  }
+// Number of recently-heard valves calling for heat.
+static uint8_t hubValvesCalling()
+  {
+  uint8_t n = 0;
+  for(const hubValve_t *v = hubValves; v < hubValves + BOILER_HUB_MAX_VALVES; ++v)
+    { if((v->ageM < BOILER_HUB_VALVE_STALE_M) && (v->percentOpen >= hubValvePCThreshold)) { ++n; } }
+  return(n);
+  }
+
+#if defined(ENABLE_BOILER_DEMAND_MODEL)
+// Aggregate demand model: the boiler runs on the weighted sum of recently-heard valves' % open,
+// where 100 is one average radiator fully open (or two half open, etc).
+// Starting needs noticeably more demand than keeping going,
+// and each start commits to at least getMinBoilerOnMinutes() on and then as long off,
+// so the boiler runs in fewer, longer burns.
+// Weighted demand to start the boiler, and to keep it going once started.
+static constexpr uint16_t BOILER_DEMAND_START_PC = 100;
+static constexpr uint16_t BOILER_DEMAND_HOLD_PC = 30;
+// Weighted demand reported as a 100% demand level, for a modulating boiler or heat pump.
+static constexpr uint16_t BOILER_DEMAND_FULL_PC = 400;
+static uint8_t boilerDemandPC;
+static uint8_t boilerStarts;
+static uint8_t boilerDemandLevelPC() { return(boilerDemandPC); }
+static uint8_t boilerStartsToday() { return(boilerStarts); }
+// Weighted sum of percent-open over recently-heard valves.
+static uint16_t hubValvesWeightedDemandPC()
+  {
+  uint16_t sum = 0;
+  for(const hubValve_t *v = hubValves; v < hubValves + BOILER_HUB_MAX_VALVES; ++v)
+    { if(v->ageM < BOILER_HUB_VALVE_STALE_M) { sum += (uint16_t)(((uint16_t)v->percentOpen * v->weightQ) >> 2); } }
+  return(sum);
+  }
+#endif // ENABLE_BOILER_DEMAND_MODEL
+#endif // ENABLE_BOILER_HUB_VALVE_TABLE
 
 // Raw notification of received call for heat from remote (eg FHT8V) unit.
 // This form has a 16-bit ID (eg FHT8V housecode) and percent-open value [0,100].
@@ -813,6 +2644,10 @@ static volatile uint16_t receivedCallForHeatID;
 // Does not have to be thread-/ISR- safe.
 void remoteCallForHeatRX(const uint16_t id, const uint8_t percentOpen)
   {
+#if defined(ENABLE_BOILER_HUB_VALVE_TABLE)
+  // Track every report, including explicit 0% 'not calling' ones.
+  recordHubValve(id, percentOpen);
+#endif
   // TODO: Should be filtering first by housecode
   // then by individual and tracked aggregate valve-open percentage.
   // Only individual valve levels used here; no state is retained.
@@ -862,15 +2697,53 @@ void remoteCallForHeatRX(const uint16_t id, const uint8_t percentOpen)
   const uint8_t threshold = (!considerPause && (encourageOn || isBoilerOn())) ?
       minvro : OTV0P2BASE::fnmax(minvro, (uint8_t) (OTRadValve::DEFAULT_VALVE_PC_MODERATELY_OPEN-1));
 
+#if defined(ENABLE_BOILER_HUB_VALVE_TABLE)
+  hubValvePCThreshold = threshold;
+  // Also accept if enough valves are partly open between them.
+  if((percentOpen >= threshold) || ((0 != percentOpen) && !considerPause && (hubValvesSumPC() >= BOILER_HUB_AGGREGATE_PC)))
+#else
   if(percentOpen >= threshold)
+#endif
     // && FHT8VHubAcceptedHouseCode(command.hc1, command.hc2))) // Accept if house code OK.
     {
+#if defined(ENABLE_CALL_FOR_HEAT_RING)
+    receivedCallsForHeat.put(id); // If full, the calls already queued still turn the boiler on.
+#else
     receivedCallForHeat = true; // FIXME
     receivedCallForHeatID = id;
+#endif
+#if defined(ENABLE_BOILER_HUB_ZONES)
+    receivedZoneCalls |= (uint8_t)(1 << getBoilerZone(id));
+#endif
+#if defined(ENABLE_FAST_BOILER_RESPONSE) && !defined(ENABLE_BOILER_DEMAND_MODEL)
+    // Low-latency path: if the boiler is off and has been off for at least the minimum time
+    // then turn it on now, rather than at the start of the next loop pass.
+    // The flag is still left set so that processCallsForHeat() restarts the on-time countdown as usual.
+    if(inHubMode() && !isBoilerOn())
+      {
+      const uint8_t minOnMins = getMinBoilerOnMinutes();
+      if(boilerNoCallM > min(254, minOnMins))
+        {
+        boilerCountdownTicks = minOnMins * (uint16_t) MAIN_TICKS_PER_MINUTE;
+        boilerNoCallM = 0;
+        fastDigitalWrite(OUT_HEATCALL, HIGH);
+        OTV0P2BASE::serialPrintlnAndFlush(F("RCfH1")); // Remote call for heat on.
+        }
+      }
+#endif // ENABLE_FAST_BOILER_RESPONSE
     }
   }
 #endif
 
+#if defined(ENABLE_WINDOWED_RX_POLL)
+// Nap between radio polls while the channel is idle.
+// A 64-byte FIFO holds a whole frame, so this only needs to be short enough to not miss a following frame
+// in a burst, and senders should use preambles long enough to be seen by primaryRadioChannelBusy().
+static constexpr int_fast8_t WINDOWED_RX_SLOW_NAP = WDTO_60MS;
+// Number of 15ms naps after activity before dropping back to the slow poll (~120ms).
+static constexpr uint8_t WINDOWED_RX_FAST_NAPS = 8;
+#endif // ENABLE_WINDOWED_RX_POLL
+
 
 #if defined(ENABLE_RADIO_RX)
 // Returns true if continuous background RX has been set up.
@@ -879,6 +2752,9 @@ static bool setUpContinuousRX()
   // Possible paranoia...
   // Periodically (every few hours) force radio off or at least to be not listening.
   if((30 == TIME_LSD) && (128 == minuteCount)) { PrimaryRadio.listen(false); }
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+  if((30 == TIME_LSD) && (128 == minuteCount)) { RFM23BAux.listen(false); }
+#endif
 
 #if defined(ENABLE_CONTINUOUS_RX)
   // IF IN CENTRAL HUB MODE: listen out for OpenTRV units calling for heat.
@@ -891,6 +2767,12 @@ static bool setUpContinuousRX()
   const bool needsToListen = true; // By default listen if always doing RX.
 #else
   bool needsToListen = inHubMode(); // By default assume no need to listen unless in hub mode.
+#if defined(ENABLE_TIME_SYNC_BEACON)
+  if(!needsToListen) { needsToListen = timeSyncWantsRX(); }
+#endif
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK)
+  if(!needsToListen) { needsToListen = linkQualityWantsRX(); }
+#endif
 #endif
 
 #if 0 && defined(DEBUG) && defined(ENABLE_DEFAULT_ALWAYS_RX)
@@ -910,10 +2792,24 @@ static bool setUpContinuousRX()
 #endif
 
   // Act on eavesdropping need, setting up or clearing down hooks as required.
-  PrimaryRadio.listen(needsToListen);
+#if defined(ENABLE_RADIO_DUAL_CARRIER) && !defined(ENABLE_RADIO_AUX_RX_RFM23B)
+  // Time-slice between the carriers, swapping on each pass;
+  // senders on either carrier repeat often enough that alternate 2s slots catch them.
+  static bool listenOOK;
+  listenOOK = !listenOOK;
+  PrimaryRadio.listen(needsToListen, listenOOK ? RADIO_OOK_CHANNEL : primaryRadioChannel());
+#else
+  PrimaryRadio.listen(needsToListen, primaryRadioChannel());
+#endif // ENABLE_RADIO_DUAL_CARRIER
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+  // The second receiver covers the other carrier or channel full time.
+  RFM23BAux.listen(needsToListen, auxRadioChannel());
+#endif // ENABLE_RADIO_AUX_RX_RFM23B
 
   if(needsToListen)
     {
+    // Collect any RX errors for link stats (before any debug output consumes them).
+    linkPollRXErrs();
 #if 1 && defined(DEBUG) && defined(ENABLE_RADIO_RX) && !defined(ENABLE_TRIMMED_MEMORY)
     for(uint8_t lastErr; 0 != (lastErr = PrimaryRadio.getRXErr()); )
       {
@@ -965,6 +2861,19 @@ static void processCallsForHeat(const bool second0)
 #if defined(ENABLE_BOILER_HUB)
   if(inHubMode())
     {
+#if defined(ENABLE_CALL_FOR_HEAT_RING)
+    // Log and take every call for heat received since the last pass.
+    const bool heardIt = !receivedCallsForHeat.isEmpty();
+    uint16_t hcRequest;
+    while(receivedCallsForHeat.get(hcRequest))
+      {
+      OTV0P2BASE::serialPrintAndFlush(F("CfH ")); // Call for heat from
+      OTV0P2BASE::serialPrintAndFlush((hcRequest >> 8) & 0xff);
+      OTV0P2BASE::serialPrintAndFlush(' ');
+      OTV0P2BASE::serialPrintAndFlush(hcRequest & 0xff);
+      OTV0P2BASE::serialPrintlnAndFlush();
+      }
+#else
     // Check if call-for-heat has been received, and clear the flag.
     bool _h;
     uint16_t _hID; // Only valid if _h is true.
@@ -996,10 +2905,42 @@ static void processCallsForHeat(const bool second0)
         OTV0P2BASE::serialPrintlnAndFlush();
         }
       }
+#endif // ENABLE_CALL_FOR_HEAT_RING
 
     // Record call for heat, both to start boiler-on cycle and possibly to defer need to listen again.
     // Ignore new calls for heat until minimum off/quiet period has been reached.
     // Possible optimisation: may be able to stop RX if boiler is on for local demand (can measure local temp better: less self-heating) and not collecting stats.
+#if defined(ENABLE_BOILER_DEMAND_MODEL)
+    // Decide on aggregate demand, as each call comes in and once a minute as valve reports go stale.
+    if(heardIt || second0)
+      {
+      const uint8_t minOnMins = getMinBoilerOnMinutes();
+      const uint16_t d = hubValvesWeightedDemandPC();
+      boilerDemandPC = (uint8_t)((((d > BOILER_DEMAND_FULL_PC) ? BOILER_DEMAND_FULL_PC : d) * 100U) / BOILER_DEMAND_FULL_PC);
+      if(second0 && (0 == OTV0P2BASE::getMinutesSinceMidnightLT())) { boilerStarts = 0; }
+      if(isBoilerOn() ? (d >= BOILER_DEMAND_HOLD_PC) : (d >= BOILER_DEMAND_START_PC))
+        {
+        if(!isBoilerOn())
+          {
+          // Honour the minimum off time as below (the min(254, ...) lets the boiler come on even if minOnMins == 255).
+          if(boilerNoCallM <= min(254, minOnMins)) { OTV0P2BASE::serialPrintlnAndFlush(F("RCfH-")); } // Remote call for heat ignored.
+          else
+            {
+            OTV0P2BASE::serialPrintlnAndFlush(F("RCfH1")); // Remote call for heat on.
+            if(boilerStarts < 255) { ++boilerStarts; }
+            boilerCountdownTicks = minOnMins * (uint16_t) MAIN_TICKS_PER_MINUTE;
+            boilerNoCallM = 0;
+            }
+          }
+        // Keep going for at least the minimum on time after demand was last enough.
+        else
+          {
+          boilerCountdownTicks = minOnMins * (uint16_t) MAIN_TICKS_PER_MINUTE;
+          boilerNoCallM = 0;
+          }
+        }
+      }
+#else
     if(heardIt)
       {
       const uint8_t minOnMins = getMinBoilerOnMinutes();
@@ -1020,37 +2961,501 @@ static void processCallsForHeat(const bool second0)
         }
       if(!ignoreRCfH)
         {
-        const uint16_t onTimeTicks = minOnMins * (uint16_t) (60U / OTV0P2BASE::MAIN_TICK_S);
+        const uint16_t onTimeTicks = minOnMins * (uint16_t) MAIN_TICKS_PER_MINUTE;
         // Restart count-down time (keeping boiler on) with new call for heat.
         boilerCountdownTicks = onTimeTicks;
         boilerNoCallM = 0; // No time has passed since the last call.
         }
       }
+#endif // ENABLE_BOILER_DEMAND_MODEL
+
+    // If boiler is on, then count down towards boiler off.
+    if(isBoilerOn())
+      {
+      if(0 == --boilerCountdownTicks)
+        {
+        // Boiler should now be switched off.
+//        if(OTV0P2BASE::getSubCycleTime() >= nearOverrunThreshold) { } // { tooNearOverrun = true; }
+//        else 
+          { OTV0P2BASE::serialPrintlnAndFlush(F("RCfH0")); } // Remote call for heat off
+        }
+      }
+    // Else boiler is off so count up quiet minutes until at max...
+    else if(second0 && (boilerNoCallM < 255))
+        { ++boilerNoCallM; }
+
+#if defined(ENABLE_BOILER_HUB_VALVE_TABLE)
+    if(second0) { ageHubValves(); }
+#endif
+
+    // Set BOILER_OUT as appropriate for calls for heat.
+    // Local calls for heat come via the same route (TODO-607).
+    fastDigitalWrite(OUT_HEATCALL, (isBoilerOn() ? HIGH : LOW));
+    boilerCheckpointPoll(second0);
+
+#if defined(ENABLE_BOILER_HUB_ZONES)
+    // Zones only run with the boiler, so calls ignored for its minimum off time are dropped here too.
+    const uint16_t zoneOnTimeTicks = getMinBoilerOnMinutes() * (uint16_t) MAIN_TICKS_PER_MINUTE;
+    for(uint8_t z = 0; z < BOILER_HUB_ZONES; ++z)
+      {
+      uint16_t &t = boilerZoneCountdownTicks[z];
+      if(!isBoilerOn()) { t = 0; }
+      else if(0 != (receivedZoneCalls & (1 << z))) { t = zoneOnTimeTicks; }
+      else if(0 != t) { --t; }
+      fastDigitalWrite(boilerZonePins[z], ((0 != t) ? HIGH : LOW));
+      }
+    receivedZoneCalls = 0;
+#endif // ENABLE_BOILER_HUB_ZONES
+    }
+  // Force boiler off when not in hub mode.
+  else
+    {
+    fastDigitalWrite(OUT_HEATCALL, LOW);
+#if defined(ENABLE_BOILER_HUB_ZONES)
+    for(uint8_t z = 0; z < BOILER_HUB_ZONES; ++z) { boilerZoneCountdownTicks[z] = 0; fastDigitalWrite(boilerZonePins[z], LOW); }
+#endif
+    }
+#endif // defined(ENABLE_BOILER_HUB)
+  }
+
+#if defined(ENABLE_SENSOR_PIPELINE)
+// Split-phase sensor acquisition for the coalesced sensor slot.
+// Each stage may start a conversion and return at once, and is later collected:
+// without waiting if started long enough ago, else after napping until its expected ready time.
+// Long conversions start in slot 44 (10s ahead); short ones start at the top of slot 54
+// so they run while the synchronous (ADC) stages are read.
+// Stages are collected in table order, keeping each bus powered across consecutive stages on it.
+enum sensorBus_t : uint8_t { SB_NONE, SB_ADC, SB_TWI };
+struct sensorStage_t
+  {
+  void (*start)(); // Start conversion and return at once; NULL if collect() reads synchronously.
+  void (*collect)(); // Fetch the result (without waiting once ready), or do a whole blocking read.
+  sensorBus_t bus; // Bus to keep powered for collect().
+  uint8_t convSCT; // Sub-cycle ticks from start() until the result is ready; 0 if synchronous.
+  uint8_t awakeSCT; // Worst-case sub-cycle ticks awake for start() and collect() together, excluding waiting.
+  bool runAllOnly; // Collected only when runAll.
+  };
+// Conversions no longer than this start in slot 54 itself.
+static constexpr uint8_t SENSOR_INLINE_CONV_SCT = 8;
+static void spReadSupply() { Supply_cV.read(); }
+#if defined(ENABLE_AMBLIGHT_SENSOR)
+static void spReadAmbLight()
+  {
+  // Force all UI lights off before sampling ambient light level.
+  OTV0P2BASE::LED_HEATCALL_OFF();
+#if defined(LED_UI2_EXISTS) && defined(ENABLE_UI_LED_2_IF_AVAILABLE)
+  // Turn off second UI LED if available.
+  OTV0P2BASE::LED_UI2_OFF();
+#endif
+  AmbLight.read();
+  }
+#endif
+#if (defined(DS18B20_SPLIT_CONVERSION) && defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20)) || defined(SHT21_SPLIT_CONVERSION)
+static void spStartTemp() { TemperatureC16.startConversion(); }
+#endif
+static void spReadTemp() { TemperatureC16.read(); }
+#ifdef HUMIDITY_SENSOR_SUPPORT
+static void spReadRH() { RelHumidity.read(); }
+#endif
+static constexpr sensorStage_t sensorStages[] =
+  {
+  { NULL, spReadSupply, SB_ADC, 0, 1, true },
+#if defined(ENABLE_AMBLIGHT_SENSOR)
+  { NULL, spReadAmbLight, SB_ADC, 0, 1, false },
+#endif
+#if defined(TEMP_POT_AVAILABLE)
+  { NULL, readTempPot, SB_ADC, 0, 1, false },
+#endif
+#if defined(DS18B20_SPLIT_CONVERSION) && defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20)
+  { spStartTemp, spReadTemp, SB_NONE, 48, 3, false }, // 375ms at 11 bits, started in slot 44.
+#elif defined(SHT21_SPLIT_CONVERSION)
+  { spStartTemp, spReadTemp, SB_TWI, 3, 2, false }, // 22ms at 12 bits, overlapping the ADC stages.
+#elif defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20)
+  { NULL, spReadTemp, SB_NONE, 0, 50, false }, // Library read naps through its own conversion.
+#elif !defined(SHT21_SPLIT_CONVERSION)
+  { NULL, spReadTemp, SB_TWI, 0, 5, false }, // Library read waits for its own conversion.
+#endif
+#ifdef HUMIDITY_SENSOR_SUPPORT
+  // After temperature as the same SHT21 cannot measure both at once.
+  { NULL, spReadRH, SB_TWI, 0, 2, true },
+#endif
+  };
+static constexpr uint8_t sensorStagesCount = sizeof(sensorStages) / sizeof(sensorStages[0]);
+static constexpr bool sensorStageEarly(const uint8_t i) { return((NULL != sensorStages[i].start) && (sensorStages[i].convSCT > SENSOR_INLINE_CONV_SCT)); }
+// Awake ticks of slot 44 starts from the ith stage on.
+static constexpr uint8_t sensorEarlyStartSCT(const uint8_t i = 0)
+  { return((i >= sensorStagesCount) ? 0 : ((sensorStageEarly(i) ? 1 : 0) + sensorEarlyStartSCT(i+1))); }
+// Worst-case ticks of slot 54 from the ith stage on: all awake time plus, pessimistically, every inline conversion.
+static constexpr uint8_t sensorCollectSCT(const uint8_t i = 0)
+  { return((i >= sensorStagesCount) ? 0 :
+    (sensorStages[i].awakeSCT + (((NULL != sensorStages[i].start) && !sensorStageEarly(i)) ? sensorStages[i].convSCT : 0) + sensorCollectSCT(i+1))); }
+// Sub-cycle time and TIME_LSD of each stage's last start; ready without waiting if started in another slot.
+static uint8_t sensorStartSCT[sensorStagesCount];
+static uint8_t sensorStartLSD[sensorStagesCount];
+// Power the given bus (if not already), turning off any this pipeline powered for the previous stage.
+static void sensorBusSelect(sensorBus_t &cur, bool &needed, const sensorBus_t want)
+  {
+  if(cur == want) { return; }
+  if(needed) { if(SB_ADC == cur) { OTV0P2BASE::powerDownADC(); } else if(SB_TWI == cur) { OTV0P2BASE::powerDownTWI(); } }
+  cur = want;
+  needed = (SB_ADC == want) ? OTV0P2BASE::powerUpADCIfDisabled() : ((SB_TWI == want) && OTV0P2BASE::powerUpTWIIfDisabled());
+  }
+// The stage loops run over a constexpr table, so each unrolls to direct calls with no table in RAM.
+template<uint8_t i> struct sensorPipeline_t
+  {
+  static inline void start(const bool early)
+    {
+    if((NULL != sensorStages[i].start) && (early == sensorStageEarly(i)))
+      {
+      sensorStartSCT[i] = OTV0P2BASE::getSubCycleTime();
+      sensorStartLSD[i] = TIME_LSD;
+      sensorStages[i].start();
+      }
+    sensorPipeline_t<i+1>::start(early);
+    }
+  static inline void collect(const bool runAll, sensorBus_t &cur, bool &needed)
+    {
+    if(runAll || !sensorStages[i].runAllOnly)
+      {
+      if((NULL != sensorStages[i].start) && (TIME_LSD == sensorStartLSD[i]))
+        {
+        // Sleep out any remaining conversion time with the bus off.
+        sensorBusSelect(cur, needed, SB_NONE);
+        while((uint8_t)(OTV0P2BASE::getSubCycleTime() - sensorStartSCT[i]) < sensorStages[i].convSCT)
+          { OTV0P2BASE::nap(WDTO_15MS, true); }
+        sensorStartLSD[i] = 0xff;
+        }
+      sensorBusSelect(cur, needed, sensorStages[i].bus);
+      sensorStages[i].collect();
+      }
+    sensorPipeline_t<i+1>::collect(runAll, cur, needed);
+    }
+  };
+template<> struct sensorPipeline_t<sensorStagesCount>
+  {
+  static inline void start(bool) { }
+  static inline void collect(bool, sensorBus_t &, bool &) { }
+  };
+#if defined(DS18B20_SPLIT_CONVERSION) && defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20)
+// Start the long conversions; call in slot 44.
+static void sensorPipelineStartEarly() { sensorPipeline_t<0>::start(true); }
+#endif
+// Start the short conversions, read everything and leave all buses as found; call in slot 54.
+static void sensorPipelineCollect(const bool runAll)
+  {
+  sensorPipeline_t<0>::start(false);
+  sensorBus_t cur = SB_NONE;
+  bool needed = false;
+  sensorPipeline_t<0>::collect(runAll, cur, needed);
+  sensorBusSelect(cur, needed, SB_NONE);
+  }
+#endif // ENABLE_SENSOR_PIPELINE
+
+
+// Static task table for the switch(TIME_LSD) slots in loopOpenTRV().
+// This is the single place where slot allocation is recorded for each config,
+// so that the loop can tell which seconds have no scheduled work,
+// new tasks can claim a free slot without colliding (checked at compile time),
+// and the nominal load of each config can be checked statically.
+// The switch in loopOpenTRV() remains the dispatcher as tasks share its locals;
+// keep the two in step.
+struct slotTask_t
+  {
+  uint8_t lsd; // Even second in the minute, [0,58].
+  uint8_t periodM; // Nominal period in minutes (1, 2 or 4); 0 if ad hoc, eg randomised.
+  uint8_t phaseM; // Minute within period in which it runs.
+  uint8_t budgetSCT; // Nominal worst-case sub-cycle ticks.
+  bool runAllOnly; // Skipped when conserving energy except when runAll.
+  uint8_t roles; // PROFILE_XXX roles that must all be enabled to run; 0 for any.
+  };
+static constexpr slotTask_t slotTasks[] =
+  {
+  { 0, 1, 0, 8, false, 0 }, // Minute tasks: schedule, RTC persistence, hourly/daily tasks.
+#if !defined(ENABLE_JITTER_XORSHIFT_RNG)
+  { 2, 1, 0, 1, true, 0 }, // PRNG churn.
+#endif
+#if !defined(ENABLE_COALESCED_SENSOR_READS)
+  { 4, 1, 0, 2, true, 0 }, // Supply voltage.
+#endif
+#if defined(ENABLE_STATS_TX)
+  { 6, 1, 0, 1, false, PROFILE_SENSOR }, // Pick stats TX slot.
+  // Stats TX in one of the following randomly chosen slots,
+  // with a random initial delay of up to GSCT_MAX/4.
+  { 8, 0, 0, 96, false, PROFILE_SENSOR }, { 10, 0, 0, 96, false, PROFILE_SENSOR },
+  { 12, 0, 0, 96, false, PROFILE_SENSOR }, { 14, 0, 0, 96, false, PROFILE_SENSOR },
+  { 16, 0, 0, 96, false, PROFILE_SENSOR }, { 18, 0, 0, 96, false, PROFILE_SENSOR },
+  { 20, 0, 0, 96, false, PROFILE_SENSOR }, { 22, 0, 0, 96, false, PROFILE_SENSOR },
+#endif // defined(ENABLE_STATS_TX)
+#if defined(ENABLE_STATS_SET_UPLOAD) && defined(ENABLE_STATS_TX)
+  { 24, 0, 0, 64, false, PROFILE_SENSOR }, // Stats set upload, every 16 minutes.
+#endif
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK) && defined(ENABLE_RX_ASSOC_INDEX)
+  { 26, 4, 2, 64, false, PROFILE_HUB }, // Hub link-quality broadcast.
+#endif
+#if defined(ENABLE_SECURE_RADIO_BEACON) && defined(ENABLE_SECURE_BEACON_PRECOMPUTE)
+  { 28, 1, 0, 64, false, 0 }, // Secure beacon build.
+  { 30, 1, 0, 8, false, 0 }, // Secure beacon send.
+#elif defined(ENABLE_SECURE_RADIO_BEACON)
+  { 30, 1, 0, 64, false, 0 }, // Secure beacon.
+#endif
+#if defined(ENABLE_TIME_SYNC_BEACON)
+  { 32, 1, 0, 64, false, PROFILE_HUB }, // Hub time sync.
+#endif
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME) && defined(ENABLE_NOMINAL_RAD_VALVE) && defined(ENABLE_STATS_TX)
+  { 34, 1, 0, 64, false, PROFILE_SENSOR }, // Short secure valve % frame on change.
+#endif
+#if defined(ENABLE_RADIO_SECONDARY_MODULE) && defined(ENABLE_DEFERRED_INIT)
+  { DEFERRED_INIT_RADIO_LSD, 0, 0, 1, false, 0 }, // Deferred secondary radio begin(), once after boot (overruns that once).
+#endif
+#if defined(ENABLE_SENSOR_PIPELINE)
+#if defined(DS18B20_SPLIT_CONVERSION) && defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20)
+  { 44, 1, 0, sensorEarlyStartSCT(), false, 0 }, // Start long sensor conversions.
+#endif
+#elif (defined(DS18B20_SPLIT_CONVERSION) && defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20)) || (defined(SHT21_SPLIT_CONVERSION) && defined(ENABLE_COALESCED_SENSOR_READS))
+  { 44, 1, 0, 2, false, 0 }, // Start temperature conversion(s).
+#endif
+#ifdef ENABLE_VOICE_SENSOR
+  { 46, 1, 0, 2, false, 0 }, // Voice.
+#endif
+#if defined(TEMP_POT_AVAILABLE) && !(defined(ENABLE_BATCHED_ADC_READS) && defined(ENABLE_COALESCED_SENSOR_READS))
+  { 48, 1, 0, 2, false, 0 }, // Temperature pot.
+#endif
+#if defined(ENABLE_SENSOR_PIPELINE)
+  { 54, 1, 0, sensorCollectSCT(), false, 0 }, // Sensor pipeline collection.
+#elif defined(ENABLE_COALESCED_SENSOR_READS)
+  { 54, 1, 0, 32, false, 0 }, // Supply voltage, ambient light, relative humidity and temperature.
+#else
+#if defined(SHT21_SPLIT_CONVERSION)
+  { 50, 1, 0, 14, false, 0 }, // Relative humidity (runAll only), then start temperature conversion.
+#elif defined(HUMIDITY_SENSOR_SUPPORT)
+  { 50, 1, 0, 12, true, 0 }, // Relative humidity.
+#endif
+#if defined(ENABLE_AMBLIGHT_SENSOR)
+  { 52, 1, 0, 2, false, 0 }, // Ambient light.
+#endif
+  { 54, 1, 0, 16, false, 0 }, // Temperature.
+#endif // ENABLE_COALESCED_SENSOR_READS
+  { 56, 1, 0, 16, false, 0 }, // Occupancy, valve and heat-demand computation, status.
+  { 58, 1, 0, 16, false, 0 }, // Non-volatile stats sampling.
+  };
+static constexpr uint8_t slotTasksCount = sizeof(slotTasks) / sizeof(slotTasks[0]);
+// Bit (TIME_LSD/2) for slot task i.
+static constexpr uint32_t slotTaskBit(const uint8_t i) { return(1UL << (slotTasks[i].lsd >> 1)); }
+// Mask of all slots with tasks from the ith onwards.
+static constexpr uint32_t slotTaskMask(const uint8_t i = 0)
+  { return((i >= slotTasksCount) ? 0 : (slotTaskBit(i) | slotTaskMask(i+1))); }
+// True if no two tasks from the ith onwards are in the same slot, given slots already used.
+static constexpr bool slotTasksDistinct(const uint8_t i = 0, const uint32_t used = 0)
+  { return((i >= slotTasksCount) || ((0 == (used & slotTaskBit(i))) && slotTasksDistinct(i+1, used | slotTaskBit(i)))); }
+// True if all tasks from the ith onwards are in even seconds within the minute.
+static constexpr bool slotTasksValid(const uint8_t i = 0)
+  { return((i >= slotTasksCount) || ((0 == (slotTasks[i].lsd & 1)) && (slotTasks[i].lsd < 60) && slotTasksValid(i+1))); }
+// Worst single-slot budget from the ith task onwards.
+static constexpr uint8_t slotTasksMaxSCT(const uint8_t i = 0)
+  { return((i >= slotTasksCount) ? 0 : ((slotTasks[i].budgetSCT > slotTasksMaxSCT(i+1)) ? slotTasks[i].budgetSCT : slotTasksMaxSCT(i+1))); }
+// Nominal per-minute load in sub-cycle ticks from the ith task onwards, counting ad hoc tasks once in total.
+static constexpr uint16_t slotTasksLoadSCT(const uint8_t i = 0, const bool adHocSeen = false)
+  { return((i >= slotTasksCount) ? 0 :
+    (((0 == slotTasks[i].periodM) && adHocSeen) ? 0 : slotTasks[i].budgetSCT) +
+        slotTasksLoadSCT(i+1, adHocSeen || (0 == slotTasks[i].periodM))); }
+// Bit mask of TIME_LSD/2 slots with scheduled work for this config.
+static constexpr uint32_t SLOT_BUSY_MASK = slotTaskMask();
+// Nominal per-minute load of slot tasks (sub-cycle ticks) for this config.
+static constexpr uint16_t SLOT_LOAD_SCT = slotTasksLoadSCT();
+#if defined(ENABLE_SLOT_PROFILER)
+void printSlotTaskLoad() { Serial.print('L'); OTV0P2BASE::Serial_print_space(); Serial.println(SLOT_LOAD_SCT); }
+#endif
+static_assert(slotTasksDistinct(), "slot task collision");
+static_assert(slotTasksValid(), "slots must be even seconds in the minute");
+// Leave room for UI, FHT8V and end-of-loop work in every slot.
+static_assert(slotTasksMaxSCT() <= (OTV0P2BASE::GSCT_MAX/2), "slot task budget too large");
+// True if the given TIME_LSD slot has scheduled work for this config; odd seconds never do.
+static constexpr bool slotHasTask(const uint8_t lsd) { return((0 == (lsd & 1)) && (0 != (SLOT_BUSY_MASK & (1UL << (lsd >> 1))))); }
+#if defined(ENABLE_RUNTIME_PROFILE)
+// Mask of slots with tasks needing the given role, from the ith task onwards.
+static constexpr uint32_t slotRoleMask(const uint8_t role, const uint8_t i = 0)
+  { return((i >= slotTasksCount) ? 0 : (((0 != (slotTasks[i].roles & role)) ? slotTaskBit(i) : 0) | slotRoleMask(role, i+1))); }
+uint8_t featureProfile = 0xff;
+// Bit (TIME_LSD/2) set for slots whose tasks are not run under the profile.
+static uint32_t slotsProfiledOut;
+// Relay and valve roles have no slot tasks of their own and are checked where used.
+void loadFeatureProfile()
+  {
+  featureProfile = eeprom_read_byte((uint8_t *)V0P2_EE_START_FEATURE_PROFILE);
+  slotsProfiledOut = 0;
+  if(!profileHas(PROFILE_HUB)) { slotsProfiledOut |= slotRoleMask(PROFILE_HUB); }
+  if(!profileHas(PROFILE_SENSOR)) { slotsProfiledOut |= slotRoleMask(PROFILE_SENSOR); }
+  }
+// True if the task in the given TIME_LSD slot is not run under the profile.
+static inline bool slotProfiledOut(const uint8_t lsd) { return((0 == (lsd & 1)) && (0 != (slotsProfiledOut & (1UL << (lsd >> 1))))); }
+#else
+#define slotProfiledOut(lsd) (false)
+#endif // ENABLE_RUNTIME_PROFILE
+#if defined(ENABLE_TASK_SUPERVISOR)
+// Budget of the task in TIME_LSD slot lsd, from the ith task onwards; 0 if none.
+static constexpr uint8_t slotTaskBudgetSCT(const uint8_t lsd, const uint8_t i = 0)
+  { return((i >= slotTasksCount) ? 0 : ((lsd == slotTasks[i].lsd) ? slotTasks[i].budgetSCT : slotTaskBudgetSCT(lsd, i+1))); }
+// Per-slot budgets for the supervisor, indexed by TIME_LSD/2, kept in flash.
+static const uint8_t slotBudgetsSCT[30] PROGMEM =
+  {
+  slotTaskBudgetSCT(0), slotTaskBudgetSCT(2), slotTaskBudgetSCT(4), slotTaskBudgetSCT(6), slotTaskBudgetSCT(8), slotTaskBudgetSCT(10),
+  slotTaskBudgetSCT(12), slotTaskBudgetSCT(14), slotTaskBudgetSCT(16), slotTaskBudgetSCT(18), slotTaskBudgetSCT(20), slotTaskBudgetSCT(22),
+  slotTaskBudgetSCT(24), slotTaskBudgetSCT(26), slotTaskBudgetSCT(28), slotTaskBudgetSCT(30), slotTaskBudgetSCT(32), slotTaskBudgetSCT(34),
+  slotTaskBudgetSCT(36), slotTaskBudgetSCT(38), slotTaskBudgetSCT(40), slotTaskBudgetSCT(42), slotTaskBudgetSCT(44), slotTaskBudgetSCT(46),
+  slotTaskBudgetSCT(48), slotTaskBudgetSCT(50), slotTaskBudgetSCT(52), slotTaskBudgetSCT(54), slotTaskBudgetSCT(56), slotTaskBudgetSCT(58),
+  };
+#endif // ENABLE_TASK_SUPERVISOR
+
+#if defined(ENABLE_SKIP_IDLE_SLOTS)
+// True when loopOpenTRV() may sleep straight through slots with no scheduled work.
+// Recomputed at the end of each full pass through the loop body.
+static bool canSkipIdleSlots;
+#if defined(ENABLE_SENSOR_BURST_MODE)
+// True if the TIME_LSD slot's task runs in burst mode:
+// per-minute bookkeeping (0, 56, 58) every minute, the sensor reads late in minute 0 of each 4,
+// and the stats TX slots early in minute 1 so that the frame carries those readings.
+// The slots between (24--42, eg stats set upload, beacons, time sync, short valve frames and deferred init)
+// are not batched, and keep to their own minute schedules.
+// (minuteCount has not yet been stepped on entering slot 0, which always runs.)
+static bool burstSlot(const uint_fast8_t lsd)
+  {
+  if((0 == lsd) || (lsd >= 56)) { return(true); }
+  const uint8_t minuteFrom4 = (minuteCount & 3);
+  if(lsd >= 44) { return(0 == minuteFrom4); }
+  if(lsd <= 22) { return(1 == minuteFrom4); }
+  return(true);
+  }
+#else
+#define burstSlot(lsd) (true)
+#endif // ENABLE_SENSOR_BURST_MODE
+#if defined(ENABLE_FULL_OT_UI) && defined(valveUI_DEFINED)
+// Set when the UI tick run for a skipped slot reports a change, so that the next pass acts on it.
+static bool skippedSlotUIChange;
+#endif
+// If allowed, and the new slot has no scheduled work (or none due in burst mode), note it as done and return true to sleep again.
+// Keeps the RTC watchdog fed when the loop body is skipped.
+static bool skipIdleSlot(const uint_fast8_t newTLSD)
+  {
+  if(!canSkipIdleSlots || (slotHasTask(newTLSD) && !slotProfiledOut(newTLSD) && burstSlot(newTLSD))) { return(false); }
+#if defined(BUTTON_MODE_L)
+  // Let the UI see a button being held down.
+  if(LOW == fastDigitalRead(BUTTON_MODE_L)) { return(false); }
+#endif
+#if defined(ENABLE_BUTTON_EVENT_QUEUE)
+  // Nor sleep through a queued press.
+  if(pollButtonEvents()) { return(false); }
+#endif
+#if defined(ENABLE_FULL_OT_UI) && defined(valveUI_DEFINED)
+  // Still tick the UI (LED heartbeat, UI timeouts) on the seconds that the loop body would.
+  // On a change run the body for this slot, which then skips its own tick.
+#if !defined(V0P2BASE_TWO_S_TICK_RTC_SUPPORT)
+  if(0 == (newTLSD & 1))
+#endif
+    {
+    if(0 != valveUI.read()) { skippedSlotUIChange = true; return(false); }
+    }
+#endif
+  TIME_LSD = newTLSD;
+#if defined(ENABLE_WATCHDOG_SLOW)
+  OTV0P2BASE::resetRTCWatchDog();
+  OTV0P2BASE::enableRTCWatchdog(true);
+#endif
+  return(true);
+  }
+#else
+#define skipIdleSlot(newTLSD) (false)
+#endif // ENABLE_SKIP_IDLE_SLOTS
+
+#if defined(ENABLE_ENERGY_POLICY_LADDER)
+// Graduated energy-saving levels, each implying all the savings of those before.
+//   EL_NORMAL: full-rate operation, eg while calling for heat.
+//   EL_ECO: the old conserveBattery: less-critical tasks every 4 minutes, no FHT8V double TX.
+//   EL_DEEP: low battery or long vacancy: those tasks every 8 minutes, half the stats TX, defer valve recalibration.
+//   EL_CRITICAL: nearly flat: tasks every 16 minutes, a quarter of stats TX, CLI only in second 0.
+enum energyLevel_t : uint8_t { EL_NORMAL, EL_ECO, EL_DEEP, EL_CRITICAL };
+// At or below this supply (cV) a low battery is treated as critical.
+static constexpr uint16_t EL_CRITICAL_cV = 200;
+#if defined(ENABLE_BATTERY_LIFE_ESTIMATE)
+// Estimated days to empty below which to go to EL_DEEP and EL_CRITICAL.
+static constexpr uint16_t EL_DEEP_DAYS = 60;
+static constexpr uint16_t EL_CRITICAL_DAYS = 14;
+#endif
+// Compute the level from the old conserve flag, the supply and its trend, and occupancy.
+// A critical battery overrides the wish to stay responsive while calling for heat.
+static energyLevel_t computeEnergyLevel(const bool conserveBattery, const bool batteryLow)
+  {
+#if defined(ENABLE_BATTERY_LIFE_ESTIMATE)
+  const uint16_t days = batteryDaysToEmpty(); // BATTERY_DAYS_UNKNOWN is large so never triggers these.
+  if((batteryLow && (Supply_cV.get() <= EL_CRITICAL_cV)) || (days < EL_CRITICAL_DAYS)) { return(EL_CRITICAL); }
+  if(!conserveBattery) { return(EL_NORMAL); }
+  if(batteryLow || Occupancy.longLongVacant() || (days < EL_DEEP_DAYS)) { return(EL_DEEP); }
+#else
+  if(batteryLow && (Supply_cV.get() <= EL_CRITICAL_cV)) { return(EL_CRITICAL); }
+  if(!conserveBattery) { return(EL_NORMAL); }
+  if(batteryLow || Occupancy.longLongVacant()) { return(EL_DEEP); }
+#endif
+  return(EL_ECO);
+  }
+// Mask of low minuteCount bits that must be zero for runAll-only tasks, by level above EL_NORMAL.
+static constexpr uint8_t energyLevelRunAllMask(const energyLevel_t l)
+  { return((EL_CRITICAL == l) ? 15 : ((EL_DEEP == l) ? 7 : 3)); }
+// True if stats TX is allowed this minute, thinning it at EL_DEEP and beyond.
+static constexpr bool energyLevelAllowsStatsTX(const energyLevel_t l, const uint8_t minuteCount)
+  { return((EL_CRITICAL == l) ? (0 == (minuteCount & 12)) : ((EL_DEEP == l) ? (0 == (minuteCount & 4)) : true)); }
+#endif // ENABLE_ENERGY_POLICY_LADDER
 
-    // If boiler is on, then count down towards boiler off.
-    if(isBoilerOn())
-      {
-      if(0 == --boilerCountdownTicks)
-        {
-        // Boiler should now be switched off.
-//        if(OTV0P2BASE::getSubCycleTime() >= nearOverrunThreshold) { } // { tooNearOverrun = true; }
-//        else 
-          { OTV0P2BASE::serialPrintlnAndFlush(F("RCfH0")); } // Remote call for heat off
-        }
-      }
-    // Else boiler is off so count up quiet minutes until at max...
-    else if(second0 && (boilerNoCallM < 255))
-        { ++boilerNoCallM; }
+#if defined(HAS_DORM1_VALVE_DRIVE) && defined(ENABLE_LOCAL_TRV)
+// Provide regular poll to the direct motor driver, which may run the motor for much of what is left of the cycle.
+static void pollValveDirect()
+  {
+  if(!profileHas(PROFILE_VALVE)) { return; }
+  loopCheckpoint(LOOP_PHASE_VALVE);
+#if defined(ENABLE_VALVE_MOVE_LOG)
+  const uint8_t sctValveStart = OTV0P2BASE::getSubCycleTime();
+  ENERGY_ACCOUNT(EA_MOTOR, ValveDirect.read());
+  valveMoveLogMotorTicks(OTV0P2BASE::getSubCycleTime() - sctValveStart);
+#else
+  ENERGY_ACCOUNT(EA_MOTOR, ValveDirect.read());
+#endif
+  }
+#endif
 
-    // Set BOILER_OUT as appropriate for calls for heat.
-    // Local calls for heat come via the same route (TODO-607).
-    fastDigitalWrite(OUT_HEATCALL, (isBoilerOn() ? HIGH : LOW));
+#if defined(ENABLE_VALVE_FIT_MEMORY)
+// True if the valve was fitted and calibrated before the last (field) reset.
+static bool valveFitRemembered;
+// True once the mark is known to be in EEPROM this run.
+static bool valveFitMarked;
+void valveFitMemorySetup(const uint8_t resetCause)
+  {
+  valveFitMarked = (VALVE_FITTED_MARK == eeprom_read_byte((uint8_t *)V0P2_EE_START_VALVE_FITTED));
+  valveFitRemembered = valveFitMarked && (0 != (resetCause & (_BV(WDRF) | _BV(BORF)))) && (0 == (resetCause & _BV(PORF)));
+  }
+// Track calibration success or failure in the EEPROM mark, writing only on change.
+static void valveFitMemoryPoll()
+  {
+  if(ValveDirect.isInNormalRunState())
+    {
+    if(!valveFitMarked) { eeQueueUpdateByte(EEW_CONFIG, (uint8_t *)V0P2_EE_START_VALVE_FITTED, VALVE_FITTED_MARK); valveFitMarked = true; }
+    }
+  else if(ValveDirect.isInErrorState())
+    {
+    valveFitRemembered = false;
+    if(valveFitMarked) { eeQueueUpdateByte(EEW_CONFIG, (uint8_t *)V0P2_EE_START_VALVE_FITTED, 0xff); valveFitMarked = false; }
     }
-  // Force boiler off when not in hub mode.
-  else { fastDigitalWrite(OUT_HEATCALL, LOW); }
-#endif // defined(ENABLE_BOILER_HUB)
   }
-
+#endif // ENABLE_VALVE_FIT_MEMORY
+
+#if defined(ENABLE_STATUS_REPORT_DEFERRED)
+// The status line blocks for a few hundred ms at 4800 baud, as the library prints it in one go,
+// so it is put off until after the valve poll, to just before the CLI (which it prompts),
+// if that leaves enough of the minor cycle; otherwise it goes out at the usual point on the next pass.
+static bool statusPending; // Report due this pass, not yet printed.
+static bool statusDeferred; // Report put off from the last pass.
+static constexpr uint8_t STATUS_REPORT_LATEST_SCT = OTV0P2BASE::GSCT_MAX/2;
+#define statusBlocksValve(showStatus) (false)
+#else
+#define statusBlocksValve(showStatus) (showStatus) // Skip the valve poll to leave time for the status line.
+#endif // ENABLE_STATUS_REPORT_DEFERRED
 
 // Main loop for OpenTRV radiator control.
 // Note: exiting and re-entering can take a little while, handling Arduino background tasks such as serial.
@@ -1097,6 +3502,9 @@ void loopOpenTRV()
 #else
     true; // Allow local power conservation if all other factors are right.
 #endif
+#if defined(ENABLE_ENERGY_POLICY_LADDER)
+  const energyLevel_t energyLevel = computeEnergyLevel(conserveBattery, batteryLow);
+#endif
 
   // Try if very near to end of cycle and thus causing an overrun.
   // Conversely, if not true, should have time to safely log outputs, etc.
@@ -1115,6 +3523,11 @@ void loopOpenTRV()
 #endif
 
 
+#if defined(ENABLE_TIME_SYNC_BEACON)
+  // Lock to the hub's time, if it has asked.
+  applyTimeSync();
+#endif
+
   // Sleep in low-power mode (waiting for interrupts) until seconds roll.
   // NOTE: sleep at the top of the loop to minimise timing jitter/delay from Arduino background activity after loop() returns.
   // DHD20130425: waking up from sleep and getting to start processing below this block may take >10ms.
@@ -1123,12 +3536,26 @@ void loopOpenTRV()
 #endif
 //  // Ensure that serial I/O is off while sleeping, unless listening with radio.
 //  if(!needsToListen) { powerDownSerial(); } else { powerUpSerialIfDisabled<V0P2_UART_BAUD>(); }
+#if defined(ENABLE_ENERGY_ACCOUNTING)
+  energyEndOfWork();
+#endif
+#if !defined(ENABLE_DEFERRED_SERIAL_POWERDOWN)
   // Ensure that serial I/O is off while sleeping.
   OTV0P2BASE::powerDownSerial();
+#endif // ENABLE_DEFERRED_SERIAL_POWERDOWN
   // Power down most stuff (except radio for hub RX).
   OTV0P2BASE::minimisePowerWithoutSleep();
+#if defined(ENABLE_ISR_PROFILER)
+  isrProfileTimerOn();
+#endif
+#if defined(ENABLE_WINDOWED_RX_POLL)
+  // Fast (15ms) naps left before dropping back to the slow poll rate; start each cycle fast.
+  uint8_t rxFastNaps = WINDOWED_RX_FAST_NAPS;
+#endif
   uint_fast8_t newTLSD;
-  while(TIME_LSD == (newTLSD = OTV0P2BASE::getSecondsLT()))
+  // With ENABLE_SKIP_IDLE_SLOTS, also sleep on through seconds with no scheduled work when possible,
+  // and with ENABLE_TIME_SYNC_BEACON through any seconds added to the minute to meet the hub's.
+  while((TIME_LSD == (newTLSD = OTV0P2BASE::getSecondsLT())) || timeSyncHold(newTLSD) || skipIdleSlot(newTLSD))
     {
 #ifdef ENABLE_RADIO_RX
     // Poll I/O and process message incrementally (in this otherwise idle time)
@@ -1137,8 +3564,26 @@ void loopOpenTRV()
     // or the in a previous orbit of this loop sleep or nap was terminated by an I/O interrupt.
     // May generate output to host on Serial.
     // Come back and have another go immediately until no work remaining.
+#if defined(ENABLE_WINDOWED_RX_POLL)
+    if(handleQueuedMessages(&Serial, true, &PrimaryRadio)) { rxFastNaps = WINDOWED_RX_FAST_NAPS; continue; }
+#else
     if(handleQueuedMessages(&Serial, true, &PrimaryRadio)) { continue; }
 #endif
+#endif
+
+#if defined(ENABLE_DEFERRED_SERIAL_POWERDOWN)
+    // Ensure that serial I/O is off while sleeping,
+    // idling (which keeps the USART clocked) while the TX buffer drains under interrupt.
+    // Once the buffer is empty, at most two bytes remain in the USART for powerDownSerial() to flush.
+    if(OTV0P2BASE::_serialIsPoweredUp())
+      {
+      if(Serial.availableForWrite() < SERIAL_TX_BUFFER_SIZE - 1) { OTV0P2BASE::_idleCPU(WDTO_15MS, true); continue; }
+      OTV0P2BASE::powerDownSerial();
+      }
+#endif // ENABLE_DEFERRED_SERIAL_POWERDOWN
+
+    // Start any deferred EEPROM write, napping briefly rather than sleeping long while more are queued.
+    if(eeQueueService()) { OTV0P2BASE::nap(WDTO_15MS, true); continue; }
 
 // If missing h/w interrupts for anything that needs rapid response
 // then AVOID the lowest-power long sleep.
@@ -1152,7 +3597,15 @@ void loopOpenTRV()
       // then this can only sleep for a short time between explicit poll()s,
       // though in any case allow wake on interrupt to minimise loop timing jitter
       // when the slow RTC 'end of sleep' tick arrives.
+#if defined(ENABLE_WINDOWED_RX_POLL)
+      // A whole frame fits in the RX FIFO so an idle channel can be polled much less often;
+      // a carrier (eg a sender's preamble) or a frame just handled opens a fast window to catch the rest.
+      if(primaryRadioChannelBusy()) { rxFastNaps = WINDOWED_RX_FAST_NAPS; }
+      if(0 != rxFastNaps) { --rxFastNaps; OTV0P2BASE::nap(WDTO_15MS, true); }
+      else { OTV0P2BASE::nap(WINDOWED_RX_SLOW_NAP, true); }
+#else
       OTV0P2BASE::nap(WDTO_15MS, true);
+#endif // ENABLE_WINDOWED_RX_POLL
       }
     else
       {
@@ -1161,7 +3614,19 @@ void loopOpenTRV()
       OTV0P2BASE::sleepUntilInt();
       }
 //    DEBUG_SERIAL_PRINTLN_FLASHSTRING("w"); // Wakeup.
+    // Every RTC tick wakes us, so this sees each wrap of the sub-cycle time.
+    hiresTimePoll();
+#if defined(ENABLE_BUTTON_EVENT_QUEUE)
+    // Act on a press as soon as its interrupt wakes us.
+    pollButtonEvents();
+#endif
     }
+#if defined(ENABLE_ENERGY_ACCOUNTING)
+    {
+    const uint8_t secs = (uint8_t)((newTLSD + TIME_CYCLE_S - TIME_LSD) % TIME_CYCLE_S);
+    energyWake(secs / OTV0P2BASE::MAIN_TICK_S);
+    }
+#endif // ENABLE_ENERGY_ACCOUNTING
   TIME_LSD = newTLSD;
 #if defined(ENABLE_WATCHDOG_SLOW)
   // Reset and immediately re-prime the RTC-based watchdog.
@@ -1201,6 +3666,8 @@ void loopOpenTRV()
   // START LOOP BODY
   // ===============
 
+  loopCheckpointsReset();
+
 
 //  // Warn if too near overrun before.
 //  if(tooNearOverrun) { OTV0P2BASE::serialPrintlnAndFlush(F("?near overrun")); }
@@ -1221,13 +3688,19 @@ void loopOpenTRV()
   //   * this is a hub and has to listen as much as possible
   // to conserve battery and bandwidth.
   #ifdef ENABLE_NOMINAL_RAD_VALVE
+#if defined(ENABLE_ENERGY_POLICY_LADDER)
+  const bool doubleTXForFTH8V = (EL_NORMAL == energyLevel) && !inHubMode() && (NominalRadValve.get() >= 50);
+#else
   const bool doubleTXForFTH8V = !conserveBattery && !inHubMode() && (NominalRadValve.get() >= 50);
+#endif
   #else
   const bool doubleTXForFTH8V = false;
   #endif
   // FHT8V is highest priority and runs first.
   // ---------- HALF SECOND #0 -----------
-  bool useExtraFHT8VTXSlots = localFHT8VTRVEnabled() && FHT8V.FHT8VPollSyncAndTX_First(doubleTXForFTH8V); // Time for extra TX before UI.
+  loopCheckpoint(LOOP_PHASE_FHT8V);
+  stackTag(STACK_TAG_FHT8V);
+  bool useExtraFHT8VTXSlots = fht8vPollSyncAndTXFirst(doubleTXForFTH8V); // Time for extra TX before UI.
 //  if(useExtraFHT8VTXSlots) { DEBUG_SERIAL_PRINTLN_FLASHSTRING("ES@0"); }
 #endif
 
@@ -1237,12 +3710,30 @@ void loopOpenTRV()
   // Must take ~300ms or less so as not to run over into next half second if two TXs are done.
   bool recompute = false; // Set true if an extra recompute of target temperature should be done.
 #if !defined(V0P2BASE_TWO_S_TICK_RTC_SUPPORT)
+#if defined(ENABLE_BUTTON_EVENT_QUEUE)
+  // A press gets the UI run at this tick rather than waiting for the next even second.
+  if((0 == (TIME_LSD & 1)) || pollButtonEvents())
+#else
   if(0 == (TIME_LSD & 1))
+#endif
 #endif
     {
+#if defined(ENABLE_BUTTON_EVENT_QUEUE)
+    // Anything queued so far is seen by this UI run.
+    pollButtonEvents();
+    buttonUIPending = false;
+#endif
 #if defined(ENABLE_FULL_OT_UI) && defined(valveUI_DEFINED)
     // Run the OpenTRV button/LED UI if required.
+    loopCheckpoint(LOOP_PHASE_UI);
+#if defined(ENABLE_SKIP_IDLE_SLOTS)
+    // The UI may already have been ticked for this second while deciding whether to skip it.
+    const bool uiChanged = skippedSlotUIChange || (0 != valveUI.read());
+    skippedSlotUIChange = false;
+    if(uiChanged)
+#else
     if(0 != valveUI.read()) // if(tickUI(TIME_LSD))
+#endif
       {
       showStatus = true;
       recompute = true;
@@ -1255,12 +3746,31 @@ void loopOpenTRV()
 
 
 #ifdef ENABLE_MODELLED_RAD_VALVE
+#if defined(ENABLE_EVENT_BUS)
+  // Only something published since the last recompute can need an early one;
+  // the regular per-minute valve computation picks up anything else.
+  const bool eventRecompute = targetRecomputePending;
+  targetRecomputePending = false;
+  if(recompute || eventRecompute)
+#else
   if(recompute || valveUI.veryRecentUIControlUse())
+#endif
     {
-    // Force immediate recompute of target temperature for (UI) responsiveness.
-    NominalRadValve.computeTargetTemperature();
-    // Keep dynamic adjustment of sensors up to date.
-    updateSensorsFromStats();
+#if defined(ENABLE_LAZY_TARGET_RECOMPUTE)
+    // After recent UI use only recompute if something feeding the target has changed;
+    // the regular per-minute valve computation picks up anything missed.
+    const uint16_t sig = targetInputsSignature();
+    if(recompute || (sig != lastTargetInputsSignature))
+#endif
+      {
+      // Force immediate recompute of target temperature for (UI) responsiveness.
+      NominalRadValve.computeTargetTemperature();
+      // Keep dynamic adjustment of sensors up to date.
+      updateSensorsFromStats();
+#if defined(ENABLE_LAZY_TARGET_RECOMPUTE)
+      lastTargetInputsSignature = sig;
+#endif
+      }
     }
 #endif
 
@@ -1270,7 +3780,8 @@ void loopOpenTRV()
     {
     // Time for extra TX before other actions, but don't bother if minimising power in frost mode.
     // ---------- HALF SECOND #1 -----------
-    useExtraFHT8VTXSlots = localFHT8VTRVEnabled() && FHT8V.FHT8VPollSyncAndTX_Next(doubleTXForFTH8V);
+    loopCheckpoint(LOOP_PHASE_FHT8V);
+    useExtraFHT8VTXSlots = fht8vPollSyncAndTXNext(doubleTXForFTH8V);
 //    if(useExtraFHT8VTXSlots) { DEBUG_SERIAL_PRINTLN_FLASHSTRING("ES@1"); }
     // Handling the FHT8V may have taken a little while, so process I/O a little.
     handleQueuedMessages(&Serial, true, &PrimaryRadio); // Deal with any pending I/O.
@@ -1286,18 +3797,92 @@ void loopOpenTRV()
   // Run all for first full 4-minute cycle, eg because unit may start anywhere in it.
   // Note: ensure only take ambient light reading at times when all LEDs are off (or turn them off).
   // TODO: coordinate temperature reading with time when radio and other heat-generating items are off for more accurate readings.
+#if defined(ENABLE_ENERGY_POLICY_LADDER)
+  const bool runAll = (EL_NORMAL == energyLevel) || (minute0From4ForSensors && (0 == (minuteCount & energyLevelRunAllMask(energyLevel)))) || (minuteCount < 4);
+#else
   const bool runAll = (!conserveBattery) || minute0From4ForSensors || (minuteCount < 4);
+#endif
+
+#if defined(HAS_DORM1_VALVE_DRIVE) && defined(ENABLE_LOCAL_TRV) && defined(ENABLE_EARLY_VALVE_POLL)
+  // In slots with no scheduled task poll the motor driver now, near the start of the cycle,
+  // so that it sees the same (maximum) run-time allowance each time rather than whatever the loop leaves.
+  // Busy slots keep the late poll below, after their task.
+  const bool valvePolledEarly = (!slotHasTask(TIME_LSD) || slotProfiledOut(TIME_LSD)) &&
+      (OTV0P2BASE::getSubCycleTime() < (OTV0P2BASE::GSCT_MAX/4));
+  if(valvePolledEarly) { pollValveDirect(); }
+#endif
 
+#if defined(ENABLE_SLOT_PROFILER)
+  const uint8_t sctSlotStart = OTV0P2BASE::getSubCycleTime();
+#endif
+  loopCheckpoint(LOOP_PHASE_SLOT);
+#if defined(ENABLE_TASK_SUPERVISOR)
+  supervisorArm(TIME_LSD, pgm_read_byte(&slotBudgetsSCT[TIME_LSD >> 1]));
+#endif
+#if defined(ENABLE_RUNTIME_PROFILE)
+  // Skip the task of a role not in this node's profile; 0xff matches no case.
+  switch(slotProfiledOut(TIME_LSD) ? 0xff : TIME_LSD)
+#else
   switch(TIME_LSD) // With V0P2BASE_TWO_S_TICK_RTC_SUPPORT only even seconds are available.
+#endif
     {
     case 0:
       {
       // Tasks that must be run every minute.
       ++minuteCount; // Note simple roll-over to 0 at max value.
+#if defined(ENABLE_STATS_TX) && defined(ENABLE_ADAPTIVE_STATS_TX_RATE) && !defined(ENABLE_FREQUENT_STATS_TX)
+      if(minutesSinceStatsTX < 0xff) { ++minutesSinceStatsTX; }
+#endif
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK)
+      ageLinkQualityFeedback();
+#endif
+#if defined(ENABLE_TIME_SYNC_BEACON)
+      if(timeSyncAgeM < 0xff) { ++timeSyncAgeM; }
+#endif
+#if defined(ENABLE_RX_LINK_TABLE)
+      ageRXLinkTable();
+#if defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+      // Upstream copy of the per-sender link table every 16 minutes, for placing hubs and repeaters.
+      if(0 == (minuteCount & 15)) { rxLinkTableRelay(); }
+#endif
+#endif // ENABLE_RX_LINK_TABLE
+#if defined(ENABLE_NODE_REGISTRY)
+      ageNodeRegistry();
+#endif
+#if defined(ENABLE_HUB_SUMMARY)
+#if defined(ENABLE_BOILER_HUB)
+      if(0 == (minuteCount & (HUB_SUMMARY_INTERVAL_M-1))) { hubSummaryRelay(isBoilerOn()); }
+#else
+      if(0 == (minuteCount & (HUB_SUMMARY_INTERVAL_M-1))) { hubSummaryRelay(false); }
+#endif
+#endif
       // Force to user's programmed schedule(s), if any, at the correct time.
+      {
+#if defined(ENABLE_JIT_PREHEAT)
+      const bool wasWarm = valveMode.inWarmMode();
+#endif
+#if defined(ENABLE_SCHEDULE_TRANSITION_CACHE) && defined(SCHEDULER_AVAILABLE)
+      applyUserScheduleCached(OTV0P2BASE::getMinutesSinceMidnightLT());
+#else
       Scheduler.applyUserSchedule(&valveMode, OTV0P2BASE::getMinutesSinceMidnightLT());
+#endif
+#if defined(ENABLE_JIT_PREHEAT)
+      jitPreheatMinute(OTV0P2BASE::getMinutesSinceMidnightLT(), wasWarm);
+#endif
+      }
+#if defined(ENABLE_INEFFECTIVE_CALL_DETECT)
+      ineffectiveCallMinute();
+#endif
+#if defined(ENABLE_CHANNEL_UTILISATION)
+      chanUtilMinute();
+#endif
+#if defined(ENABLE_TX_DUTY_CYCLE)
+      txDutyMinuteTick();
+#endif
       // Ensure that the RTC has been persisted promptly when necessary.
-      OTV0P2BASE::persistRTC();
+      persistRTCApp();
+      eeWearTick();
+      oscTuneOnTemperature();
       // Run hourly tasks at the end of the hour.
       if(59 == OTV0P2BASE::getMinutesLT())
           {
@@ -1309,15 +3894,35 @@ void loopOpenTRV()
       }
 
     // Churn/reseed PRNG(s) a little to improve unpredictability in use: should be lightweight.
+#if !defined(ENABLE_JITTER_XORSHIFT_RNG) // Seeded once at boot instead.
     case 2: { if(runAll) { OTV0P2BASE::seedRNG8(minuteCount ^ OTV0P2BASE::getCPUCycleCount() ^ (uint8_t)Supply_cV.get(), OTV0P2BASE::_getSubCycleTime() ^ AmbLight.get(), (uint8_t)TemperatureC16.get()); } break; }
+#endif
     // Force read of supply/battery voltage; measure and recompute status (etc) less often when already thought to be low, eg when conserving.
-    case 4: { if(runAll) { Supply_cV.read(); } break; }
+#if !defined(ENABLE_COALESCED_SENSOR_READS)
+    case 4: { if(runAll) { ENERGY_ACCOUNT(EA_SENSOR, Supply_cV.read()); } break; }
+#endif
 
 #if defined(ENABLE_STATS_TX)
     // Periodic transmission of stats if NOT driving a local valve (else stats can be piggybacked onto that).
     // Randomised somewhat between slots and also within the slot to help avoid collisions.
     static uint8_t txTick;
-    case 6: { txTick = OTV0P2BASE::randRNG8() & 7; break; } // Pick which of the 8 slots to use.
+#if defined(ENABLE_TIME_SYNC_BEACON)
+    case 6:
+      {
+      // While in sync use the slot given by the hub, so that its leaves do not collide.
+      if(timeSyncFresh() && (timeSyncSlot < 8)) { txTick = timeSyncSlot; break; }
+#if defined(ENABLE_ADAPTIVE_TX_SLOT)
+      txTick = pickStatsTXSlot();
+#else
+      txTick = jitterRand8() & 7;
+#endif // ENABLE_ADAPTIVE_TX_SLOT
+      break;
+      }
+#elif defined(ENABLE_ADAPTIVE_TX_SLOT)
+    case 6: { txTick = pickStatsTXSlot(); break; } // Pick which of the 8 slots to use, if any.
+#else
+    case 6: { txTick = jitterRand8() & 7; break; } // Pick which of the 8 slots to use.
+#endif // ENABLE_ADAPTIVE_TX_SLOT
     case 8: case 10: case 12: case 14: case 16: case 18: case 20: case 22:
       {
       // Only the slot where txTick is zero is used.
@@ -1329,7 +3934,10 @@ void loopOpenTRV()
       if(useExtraFHT8VTXSlots && localFHT8VTRVEnabled()) { break; }
 #endif
 
-#if !defined(ENABLE_FREQUENT_STATS_TX) // If ENABLE_FREQUENT_STATS_TX then send every minute regardless.
+#if defined(ENABLE_ADAPTIVE_STATS_TX_RATE) && !defined(ENABLE_FREQUENT_STATS_TX)
+      // Check every minute, but send only on significant change or when the (stretched) interval is up.
+      if(!statsTXDue()) { break; }
+#elif !defined(ENABLE_FREQUENT_STATS_TX) // If ENABLE_FREQUENT_STATS_TX then send every minute regardless.
       // Stats TX in the minute (#1) after all sensors should have been polled
       // (so that readings are fresh) and evenly between.
       // Usually send one frame every 4 minutes, 2 if this is a valve.
@@ -1344,6 +3952,11 @@ void loopOpenTRV()
 #endif
 #endif
 
+#if defined(ENABLE_ENERGY_POLICY_LADDER)
+      // Thin out stats TX further when deeply conserving energy.
+      if(!energyLevelAllowsStatsTX(energyLevel, minuteCount)) { break; }
+#endif
+
       // Abort if not allowed to send stats at all.
       // FIXME: fix this to send bare calls for heat / valve % instead from valves for secure non-FHT8V comms.
       if(!enableTrailingStatsPayload()) { break; }
@@ -1351,7 +3964,7 @@ void loopOpenTRV()
       // Sleep randomly up to ~25% of the minor cycle
       // to spread transmissions and thus help avoid collisions.
       // (Longer than 25%/0.5s could interfere with other ops such as FHT8V TXes.)
-      const uint8_t stopBy = 1 + (((OTV0P2BASE::GSCT_MAX >> 2) | 7) & OTV0P2BASE::randRNG8());
+      const uint8_t stopBy = 1 + (((OTV0P2BASE::GSCT_MAX >> 2) | 7) & jitterRand8());
       while(OTV0P2BASE::getSubCycleTime() <= stopBy)
         {
         // Handle any pending I/O while waiting.
@@ -1360,6 +3973,17 @@ void loopOpenTRV()
         OTV0P2BASE::nap(WDTO_15MS, true);
         }
 
+#if defined(ENABLE_ADAPTIVE_TX_SLOT)
+      // Listen before talk: if someone else is already on air, back off rather than collide.
+      if(primaryRadioChannelBusy()) { noteStatsTXBusy(); break; }
+#endif // ENABLE_ADAPTIVE_TX_SLOT
+
+#if defined(ENABLE_REMOTE_DIAG)
+      // Answer the hub's diagnostics request in place of this scheduled stats frame;
+      // stats sent for other reasons, eg by the CLI S command, are unaffected.
+      if(remoteDiagTXIfPending()) { break; }
+#endif
+
       // Send stats!
       // Try for double TX for extra robustness unless:
       //   * this is a speculative 'extra' TX
@@ -1370,16 +3994,82 @@ void loopOpenTRV()
       // Ie, if doesn't have a local TRV then it must send binary some of the time.
       // Any recently-changed stats value is a hint that a strong transmission might be a good idea.
 #if defined(ENABLE_BINARY_STATS_TX) && defined(ENABLE_FS20_ENCODING_SUPPORT)
-      const bool doBinary = !localFHT8VTRVEnabled() && OTV0P2BASE::randRNG8NextBoolean();
+      const bool doBinary = !localFHT8VTRVEnabled() && jitterRandBool();
 #else
       const bool doBinary = false;
 #endif
-      bareStatsTX(!batteryLow && !inHubMode() && ss1.changedValue(), doBinary);
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK)
+      // Let the hub's view of this link override the local guess, but never when battery is low or acting as hub.
+      const bool statsSent = bareStatsTX(!batteryLow && !inHubMode() && linkQualityWantsDoubleTX(ss1.changedValue()), doBinary);
+#else
+      const bool statsSent = bareStatsTX(!batteryLow && !inHubMode() && ss1.changedValue(), doBinary);
+#endif
+#if defined(ENABLE_ADAPTIVE_STATS_TX_RATE) && !defined(ENABLE_FREQUENT_STATS_TX)
+      // Only back off after a frame actually went out, so a failed TX is retried at the next due check.
+      if(statsSent) { noteStatsTXSent(); }
+#else
+      (void) statsSent;
+#endif
+#if defined(ENABLE_ADAPTIVE_TX_SLOT)
+      if(statsTXFailed) { noteStatsTXBusy(); } else if(0 != statsTXBackoff) { --statsTXBackoff; }
+      statsTXFailed = false;
+#endif // ENABLE_ADAPTIVE_TX_SLOT
       break;
       }
 #endif // defined(ENABLE_STATS_TX)
 
-#if defined(ENABLE_SECURE_RADIO_BEACON)
+#if defined(ENABLE_STATS_SET_UPLOAD) && defined(ENABLE_STATS_TX)
+    // Upload one by-hour stats set every 16 minutes, in a minute with no fixed-cadence stats TX,
+    // so a full pass over all the sets takes a few hours.
+    case 24:
+      {
+      if((2 != (minuteCount & 15)) || inHubMode() || batteryLow) { break; }
+      if(getStatsTXLevelCached() > OTV0P2BASE::stTXsecOnly) { break; }
+#if defined(ENABLE_FHT8VSIMPLE)
+      if(useExtraFHT8VTXSlots && localFHT8VTRVEnabled()) { break; }
+#endif
+      statsSetUploadTX();
+      break;
+      }
+#endif // ENABLE_STATS_SET_UPLOAD
+
+#if defined(ENABLE_SECURE_RADIO_BEACON) && defined(ENABLE_SECURE_BEACON_PRECOMPUTE)
+    // Build the next secure beacon ahead of its slot, so the crypto is out of the TX path.
+    // Each frame is built (consuming a TX message counter value) and then sent exactly once.
+    static uint8_t beaconBuf[OTRadioLink::generateSecureBeaconMaxBufSize];
+    static uint8_t beaconLen; // 0 when no frame is ready.
+    case 28:
+      {
+      if(0 != beaconLen) { break; } // Still have an unsent frame.
+      uint8_t key[16];
+      if(!getPrimaryBuildingKey(key)) { break; }
+      const OTRadioLink::SimpleSecureFrame32or0BodyTXBase::fixed32BTextSize12BNonce16BTagSimpleEnc_ptr_t e = secureFrameEnc;
+#if defined(ENABLE_TX_COUNTER_RESERVATION)
+      // Must use the same message counter as all other secure TX.
+      beaconLen = secureTX().generateSecureBeaconRawForTX(beaconBuf, sizeof(beaconBuf), OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES, e, NULL, key);
+#else
+      beaconLen = OTRadioLink::generateSecureBeaconRawForTX(beaconBuf, sizeof(beaconBuf), OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES, e, NULL, key);
+#endif
+      break;
+      }
+    // Send the prepared beacon; if none was ready (eg no key) just skip this minute.
+    case 30:
+      {
+      if(0 == beaconLen) { break; }
+      // ASSUME FRAMED CHANNEL 0: do not explicitly send the frame length byte.
+      bool success;
+      ENERGY_ACCOUNT(EA_TX, success = PrimaryRadio.sendRaw(beaconBuf+1, beaconLen-1, primaryRadioChannel()));
+      beaconLen = 0; // Never resend the same frame.
+#if 1 && defined(DEBUG)
+      DEBUG_SERIAL_PRINT_FLASHSTRING("Beacon TX... ");
+      DEBUG_SERIAL_PRINT(success);
+      DEBUG_SERIAL_PRINTLN();
+#else
+      (void)success;
+#endif
+      break;
+      }
+#elif defined(ENABLE_SECURE_RADIO_BEACON)
     // Send a small secure radio beacon "I'm alive!" message regularly if configured.
     case 30:
       {
@@ -1388,22 +4078,28 @@ void loopOpenTRV()
 #endif
       // Get the 'building' key for broadcast.
       uint8_t key[16];
-      if(!OTV0P2BASE::getPrimaryBuilding16ByteSecretKey(key))
+      if(!getPrimaryBuildingKey(key))
         {
 #if 1 && defined(DEBUG)
         DEBUG_SERIAL_PRINTLN_FLASHSTRING("!failed (no key)");
 #endif
         break;
         }
-      const OTRadioLink::SimpleSecureFrame32or0BodyTXBase::fixed32BTextSize12BNonce16BTagSimpleEnc_ptr_t e = OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleEnc_DEFAULT_STATELESS;
+      const OTRadioLink::SimpleSecureFrame32or0BodyTXBase::fixed32BTextSize12BNonce16BTagSimpleEnc_ptr_t e = secureFrameEnc;
       const uint8_t txIDLen = OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES;
       uint8_t buf[OTRadioLink::generateSecureBeaconMaxBufSize];
+#if defined(ENABLE_TX_COUNTER_RESERVATION)
+      // Must use the same message counter as all other secure TX.
+      const uint8_t bodylen = secureTX().generateSecureBeaconRawForTX(buf, sizeof(buf), txIDLen, e, NULL, key);
+#else
       const uint8_t bodylen = OTRadioLink::generateSecureBeaconRawForTX(buf, sizeof(buf), txIDLen, e, NULL, key);
+#endif
       // ASSUME FRAMED CHANNEL 0 (but could check with config isUnframed flag).
       // When sending on a channel with framing, do not explicitly send the frame length byte.
       // DO NOT attempt to send if construction of the secure frame failed;
       // doing so may reuse IVs and destroy the cipher security.
-      const bool success = (0 != bodylen) && PrimaryRadio.sendRaw(buf+1, bodylen-1);
+      bool success = false;
+      if(0 != bodylen) { ENERGY_ACCOUNT(EA_TX, success = PrimaryRadio.sendRaw(buf+1, bodylen-1, primaryRadioChannel())); }
 #if 1 && defined(DEBUG)
       DEBUG_SERIAL_PRINT(success);
       DEBUG_SERIAL_PRINTLN();
@@ -1412,6 +4108,38 @@ void loopOpenTRV()
       }
 #endif // defined(ENABLE_SECURE_RADIO_BEACON)
 
+#if defined(ENABLE_TIME_SYNC_BEACON)
+    // Hub: time sync and leaf TX slots, every minute so that a leaf searching for the hub need only listen for one.
+    case TIME_SYNC_TX_S: { timeSyncBroadcastTX(minuteFrom4); break; }
+#endif // ENABLE_TIME_SYNC_BEACON
+
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME) && defined(ENABLE_NOMINAL_RAD_VALVE) && defined(ENABLE_STATS_TX)
+    // Report a changed valve % promptly in a short secure frame rather than waiting for the next full stats.
+    // Runs after the stats TX slots, so nothing is sent if a full frame has just carried the new value.
+    case 34:
+      {
+      if(inHubMode() || !enableTrailingStatsPayload()) { break; }
+#if defined(ENABLE_FHT8VSIMPLE)
+      if(useExtraFHT8VTXSlots && localFHT8VTRVEnabled()) { break; }
+#endif
+#if defined(ENABLE_ADAPTIVE_TX_SLOT)
+      if(primaryRadioChannelBusy()) { break; } // Try again next minute.
+#endif
+      valveShortFrameTX();
+      break;
+      }
+#endif // ENABLE_SECURE_VALVE_SHORT_FRAME
+
+#if defined(ENABLE_RADIO_SECONDARY_MODULE) && defined(ENABLE_DEFERRED_INIT)
+    // Start the secondary radio (preinit()ed in setup()), once, in an otherwise idle slot.
+    case DEFERRED_INIT_RADIO_LSD: { deferredInitRun(DI_SECONDARY_RADIO); break; }
+#endif
+
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK) && defined(ENABLE_RX_ASSOC_INDEX)
+    // Hub: every 4 minutes, in a minute that leaves do not use for stats TX, tell them how well they are heard.
+    case 26: { if(2 == minuteFrom4) { linkQualityBroadcastTX(); } break; }
+#endif // ENABLE_LINK_QUALITY_FEEDBACK
+
 // SENSOR READ AND STATS
 //
 // All external sensor reads should be in the second half of the minute (>32) if possible.
@@ -1420,21 +4148,69 @@ void loopOpenTRV()
 // Also all sources of noise, self-heating, etc, may be turned off for the 'sensor read minute'
 // and thus will have diminished by this point.
 
+#if defined(ENABLE_SENSOR_PIPELINE)
+#if defined(DS18B20_SPLIT_CONVERSION) && defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20)
+    case 44: { ENERGY_ACCOUNT(EA_SENSOR, sensorPipelineStartEarly()); break; }
+#endif
+#elif defined(DS18B20_SPLIT_CONVERSION) && defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20)
+    // Start DS18B20 conversion(s) well ahead of the temperature read in slot 54,
+    // so that the read only fetches the result rather than napping through the conversion.
+    // Any other DS18B20 on the same bus (eg extDS18B20_0) converts in parallel.
+    // Only when slot 54 will read it, so a skipped minute leaves no stale result pending.
+    case 44: { if(sensorSampleDue()) { ENERGY_ACCOUNT(EA_SENSOR, TemperatureC16.startConversion()); } break; }
+#elif defined(SHT21_SPLIT_CONVERSION) && defined(ENABLE_COALESCED_SENSOR_READS)
+    // Trigger the SHT21 temperature measurement ahead of the read in slot 54,
+    // letting the conversion overlap other work and sleep rather than being waited for.
+    // Only when slot 54 will read it, so a skipped minute leaves no stale result pending.
+    // (Without coalesced reads it is triggered in slot 50, after the humidity measurement.)
+    case 44: { if(sensorSampleDue()) { ENERGY_ACCOUNT(EA_SENSOR, TemperatureC16.startConversion()); } break; }
+#endif
+
 #ifdef ENABLE_VOICE_SENSOR
     // Poll voice detection sensor at a fixed rate.
+#if defined(ENABLE_VOICE_POWER_GATING)
+    // Then power the module up or down for the coming minute, arming its interrupt only once it has settled.
+    // (Also re-arms after ENABLE_VOICE_IRQ_RATE_LIMIT has masked it.)
+    case 46:
+      {
+      Voice.read();
+      const bool arm = voicePowerGateTick();
+      ATOMIC_BLOCK (ATOMIC_RESTORESTATE) { if(arm) { PCMSK2 |= VOICE_INT_MASK; } else { PCMSK2 &= ~VOICE_INT_MASK; } }
+      break;
+      }
+#elif defined(ENABLE_VOICE_IRQ_RATE_LIMIT)
+    // Then re-arm the voice interrupt for the next window, so at most one edge is taken per minute.
+    case 46: { Voice.read(); ATOMIC_BLOCK (ATOMIC_RESTORESTATE) { PCMSK2 |= VOICE_INT_MASK; } break; }
+#else
     case 46: { Voice.read(); break; }
 #endif
+#endif
 
-#ifdef TEMP_POT_AVAILABLE
+#if defined(TEMP_POT_AVAILABLE) && !(defined(ENABLE_BATCHED_ADC_READS) && defined(ENABLE_COALESCED_SENSOR_READS))
     // Sample the user-selected WARM temperature target at a fixed rate.
     // This allows the unit to stay reasonably responsive to adjusting the temperature dial.
-    case 48: { TempPot.read(); break; }
+    case 48: { ENERGY_ACCOUNT(EA_SENSOR, readTempPot()); break; }
 #endif
 
     // Read all environmental inputs, late in the cycle.
+#if !defined(ENABLE_COALESCED_SENSOR_READS)
 #ifdef HUMIDITY_SENSOR_SUPPORT
     // Sample humidity.
-    case 50: { if(runAll) { RelHumidity.read(); } break; }
+#if defined(SHT21_SPLIT_CONVERSION)
+    // Then trigger the temperature measurement for slot 54:
+    // the SHT21 cannot measure both at once, so any humidity command would abort a pending one.
+    case 50:
+      {
+      if(sensorSampleDue())
+        {
+        if(runAll) { ENERGY_ACCOUNT(EA_SENSOR, RelHumidity.read()); }
+        ENERGY_ACCOUNT(EA_SENSOR, TemperatureC16.startConversion());
+        }
+      break;
+      }
+#else
+    case 50: { if(runAll && sensorSampleDue()) { ENERGY_ACCOUNT(EA_SENSOR, RelHumidity.read()); } break; }
+#endif
 #endif
 
 #if defined(ENABLE_AMBLIGHT_SENSOR)
@@ -1448,7 +4224,7 @@ void loopOpenTRV()
       // Turn off second UI LED if available.
       OTV0P2BASE::LED_UI2_OFF();
 #endif
-      AmbLight.read();
+      ENERGY_ACCOUNT(EA_SENSOR, AmbLight.read());
       break;
       }
 #endif
@@ -1457,7 +4233,56 @@ void loopOpenTRV()
     // Force a regular read to make stats such as rate-of-change simple and to minimise lag.
     // TODO: optimise to reduce power consumption when not calling for heat.
     // TODO: optimise to reduce self-heating jitter when in hub/listen/RX mode.
-    case 54: { TemperatureC16.read(); break; }
+    case 54: { if(sensorSampleDue()) { ENERGY_ACCOUNT(EA_SENSOR, TemperatureC16.read()); sensorSampleNote(); } break; }
+#elif defined(ENABLE_SENSOR_PIPELINE)
+    // Read all the regularly-polled sensors, overlapping short conversions with the ADC reads.
+    case 54: { ENERGY_ACCOUNT(EA_SENSOR, sensorPipelineCollect(runAll)); break; }
+#else
+    // Read all the regularly-polled sensors back-to-back,
+    // keeping the ADC and then TWI (I2C) powered across each group rather than once per sensor.
+    // Conversions are still sequential as each library read() waits for its own result.
+    case 54:
+      {
+      const uint8_t sctStart = OTV0P2BASE::getSubCycleTime();
+      const bool sampleDue = sensorSampleDue();
+      {
+      const PeripheralPower<PP_ADC> adcPower;
+      if(runAll) { Supply_cV.read(); }
+#if defined(ENABLE_AMBLIGHT_SENSOR)
+      // Force all UI lights off before sampling ambient light level.
+      OTV0P2BASE::LED_HEATCALL_OFF();
+#if defined(LED_UI2_EXISTS) && defined(ENABLE_UI_LED_2_IF_AVAILABLE)
+      // Turn off second UI LED if available.
+      OTV0P2BASE::LED_UI2_OFF();
+#endif
+      AmbLight.read();
+#endif
+#if defined(TEMP_POT_AVAILABLE) && defined(ENABLE_BATCHED_ADC_READS)
+      // Sample the user-selected WARM temperature target here rather than in its own slot.
+      readTempPot();
+#endif
+      }
+      if(sampleDue)
+      {
+#if !defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20)
+      // TMP112 or SHT21 primary temperature sensor, sharing the bus with any SHT21 humidity sensor.
+      const PeripheralPower<PP_TWI> twiPower;
+#endif
+      // Temperature first, so that any humidity command cannot abort a pending SHT21 temperature measurement.
+      TemperatureC16.read();
+#ifdef HUMIDITY_SENSOR_SUPPORT
+      if(runAll) { RelHumidity.read(); }
+#endif
+      sensorSampleNote();
+      }
+#if defined(ENABLE_ENERGY_ACCOUNTING)
+      energyCountSince(EA_SENSOR, sctStart);
+#else
+      (void) sctStart;
+#endif
+      break;
+      }
+#endif // !defined(ENABLE_COALESCED_SENSOR_READS)
 
     // Compute targets and heat demand based on environmental inputs and occupancy.
     // This should happen as soon after the latest readings as possible (temperature especially).
@@ -1479,6 +4304,7 @@ void loopOpenTRV()
       // Recompute target, valve position and call for heat, etc.
       // Should be called once per minute to work correctly.
       NominalRadValve.read();
+      valveMoveLogPoll();
 #endif
 
 #if defined(ENABLE_FHT8VSIMPLE) && defined(ENABLE_LOCAL_TRV) // Only regen when needed.
@@ -1488,7 +4314,14 @@ void loopOpenTRV()
       if(NominalRadValve.isValveMoved() ||
          (minute1From4AfterSensors && enableTrailingStatsPayload()))
         {
+#if defined(ENABLE_FHT8V_FRAME_CACHE)
+        if(localFHT8VTRVEnabled()) { fht8vSetIfChanged(NominalRadValve.get()); }
+#else
         if(localFHT8VTRVEnabled()) { FHT8V.set(NominalRadValve.get() /*, NominalRadValve.isCallingForHeat() */); }
+#endif
+#if defined(ENABLE_FHT8V_MULTI)
+        fht8vExtraSet(NominalRadValve.get());
+#endif
         }
 
 #if defined(ENABLE_BOILER_HUB)
@@ -1499,7 +4332,7 @@ void loopOpenTRV()
 #elif defined(ENABLE_NOMINAL_RAD_VALVE) && defined(ENABLE_LOCAL_TRV) // Other local valve types, simulate a remote call for heat with a fake ID.
 #if defined(ENABLE_BOILER_HUB)
       // Feed in the local valve position when calling for heat just as if over the air.
-      if(NominalRadValve.isControlledValveReallyOpen()) { remoteCallForHeatRX(~0, NominalRadValve.get()); }
+      if(NominalRadValve.isControlledValveReallyOpen()) { remoteCallForHeatRX(~0, callForHeatValvePC()); }
 #endif // defined(ENABLE_BOILER_HUB)
 #endif
 
@@ -1527,17 +4360,36 @@ void loopOpenTRV()
       // Race-free.
       const uint_least16_t msm = OTV0P2BASE::getMinutesSinceMidnightLT();
       const uint8_t mm = msm % 60;
+#if defined(ENABLE_EEPROM_WEAR_STATS)
+      uint8_t statsSnap[V0P2BASE_EE_STATS_SETS];
+      if((59 == mm) || (29 == mm)) { eeWearStatsSnapshot(uint8_t(msm / 60), statsSnap); }
+#endif
+#if defined(ENABLE_NV_STATS_RAM_SHADOW)
+      // Write the hour's coalesced updates to EEPROM in one pass after the final sample.
+      if(59 == mm) { statsU.sampleStats(true, uint8_t(msm / 60)); eeStats.flush(); }
+#else
       if(59 == mm) { statsU.sampleStats(true, uint8_t(msm / 60)); }
+#endif
       else if((statsU.maxSamplesPerHour > 1) && (29 == mm)) { statsU.sampleStats(false, uint8_t(msm / 60)); }
+      if((59 == mm) || (29 == mm)) { invalidateByHourStatsAggregates(); exportRestartIfActive(); }
+#if defined(ENABLE_EEPROM_WEAR_STATS)
+      if((59 == mm) || (29 == mm)) { eeWearStatsCount(uint8_t(msm / 60), statsSnap); }
+#endif
+      sampleHighResStats(msm);
       break;
       }
     }
+  supervisorDisarm();
+#if defined(ENABLE_SLOT_PROFILER)
+  profileSlot(TIME_LSD >> 1, sctSlotStart);
+#endif
 
 #if defined(ENABLE_FHT8VSIMPLE) && defined(V0P2BASE_TWO_S_TICK_RTC_SUPPORT)
   if(useExtraFHT8VTXSlots)
     {
     // ---------- HALF SECOND #2 -----------
-    useExtraFHT8VTXSlots = localFHT8VTRVEnabled() && FHT8V.FHT8VPollSyncAndTX_Next(doubleTXForFTH8V);
+    loopCheckpoint(LOOP_PHASE_FHT8V);
+    useExtraFHT8VTXSlots = fht8vPollSyncAndTXNext(doubleTXForFTH8V);
 //    if(useExtraFHT8VTXSlots) { DEBUG_SERIAL_PRINTLN_FLASHSTRING("ES@2"); }
     // Handling the FHT8V may have taken a little while, so process I/O a little.
     handleQueuedMessages(&Serial, true, &PrimaryRadio); // Deal with any pending I/O.
@@ -1545,13 +4397,20 @@ void loopOpenTRV()
 #endif
 
   // Generate periodic status reports.
-  if(showStatus) { serialStatusReport(); }
+#if defined(ENABLE_STATUS_REPORT_DEFERRED)
+  // Already put off once, so do not delay it again.
+  if(statusDeferred) { loopCheckpoint(LOOP_PHASE_STATUS); serialStatusReport(); statusDeferred = false; }
+  if(showStatus) { statusPending = true; }
+#else
+  if(showStatus) { loopCheckpoint(LOOP_PHASE_STATUS); serialStatusReport(); }
+#endif // ENABLE_STATUS_REPORT_DEFERRED
 
 #if defined(ENABLE_FHT8VSIMPLE) && defined(V0P2BASE_TWO_S_TICK_RTC_SUPPORT)
   if(useExtraFHT8VTXSlots)
     {
     // ---------- HALF SECOND #3 -----------
-    useExtraFHT8VTXSlots = localFHT8VTRVEnabled() && FHT8V.FHT8VPollSyncAndTX_Next(doubleTXForFTH8V);
+    loopCheckpoint(LOOP_PHASE_FHT8V);
+    useExtraFHT8VTXSlots = fht8vPollSyncAndTXNext(doubleTXForFTH8V);
 //    if(useExtraFHT8VTXSlots) { DEBUG_SERIAL_PRINTLN_FLASHSTRING("ES@3"); }
     // Handling the FHT8V may have taken a little while, so process I/O a little.
     handleQueuedMessages(&Serial, true, &PrimaryRadio); // Deal with any pending I/O.
@@ -1560,7 +4419,22 @@ void loopOpenTRV()
 
   // End-of-loop processing, that may be slow.
   // Ensure progress on queued messages ahead of slow work.  (TODO-867)
+  loopCheckpoint(LOOP_PHASE_RX);
   handleQueuedMessages(&Serial, true, &PrimaryRadio); // Deal with any pending I/O.
+  // Finish start-up work left by setup(), if time allows.
+  deferredInitTick();
+  // Track the temperature dial while it is being turned.
+  tempPotFollowTick();
+  // Push out any relay batch that has waited long enough.
+  relayBatchTick();
+  // Retry any relayed frames held while the secondary link was down.
+  relayBacklogTick();
+  // Send any held secondary radio frame, if time allows.
+  secondaryTXDeferredTick();
+  // Retry any held TX frames.
+  txPendingTick();
+  // Repeat any frame that this node has won the election for.
+  repeaterTick();
 
 #if defined(HAS_DORM1_VALVE_DRIVE) && defined(ENABLE_LOCAL_TRV)
   // Handle local direct-drive valve, eg DORM1.
@@ -1571,15 +4445,26 @@ void loopOpenTRV()
   // or where fitter simply forgets to initiate cablibration.
   if(ValveDirect.isWaitingForValveToBeFitted())
       {
+#if defined(ENABLE_VALVE_FIT_MEMORY)
+      // Still fitted from before a field reset, so recalibrate straight away.
+      if(valveFitRemembered) { ValveDirect.signalValveFitted(); }
+#endif
       // Defer automatic recovery when battery low or in dark in case crashing/restarting
       // to try to avoid disturbing/waking occupants and/or entering battery death spiral.  (TODO-1037, TODO-963)
       // The initial minuteCount value can be anywhere in the range [0,3];
       // pick threshold to give user at least a couple of minutes to fit the device
       // if they do so with the battery in place.
+#if defined(ENABLE_ENERGY_POLICY_LADDER)
+      const bool delayRecalibration = batteryLow || AmbLight.isRoomDark() || (energyLevel >= EL_DEEP);
+#else
       const bool delayRecalibration = batteryLow || AmbLight.isRoomDark();
+#endif
       if(valveUI.veryRecentUIControlUse() || (minuteCount >= (delayRecalibration ? 240 : 5)))
           { ValveDirect.signalValveFitted(); }
       }
+#if defined(ENABLE_VALVE_FIT_MEMORY)
+  else { valveFitMemoryPoll(); }
+#endif
   // Provide regular poll to motor driver.
   // May take significant time to run
   // so don't call when timing is critical
@@ -1588,11 +4473,28 @@ void loopOpenTRV()
   // so as (for example) to allow the CLI to be operable.
   // Only calling this after most other heavy-lifting work is likely done.
   // Note that FHT8V sync will take up at least the first 1s of a 2s subcycle.
-  if(!showStatus &&
+#if defined(ENABLE_EARLY_VALVE_POLL)
+  if(!valvePolledEarly && !statusBlocksValve(showStatus) &&
+#else
+  if(!statusBlocksValve(showStatus) &&
+#endif
      (OTV0P2BASE::getSubCycleTime() < ((OTV0P2BASE::GSCT_MAX/4)*3)))
-    { ValveDirect.read(); }
+    { pollValveDirect(); }
 #endif
 
+#if defined(ENABLE_STATUS_REPORT_DEFERRED)
+  // Status report held back from before the valve poll.
+  if(statusPending)
+    {
+    statusPending = false;
+    if(OTV0P2BASE::getSubCycleTime() < STATUS_REPORT_LATEST_SCT) { loopCheckpoint(LOOP_PHASE_STATUS); serialStatusReport(); }
+    else { statusDeferred = true; }
+    }
+#endif // ENABLE_STATUS_REPORT_DEFERRED
+
+  // Slices of any long-running cooperative tasks, leaving time for the CLI.
+  coopTasksRun((OTV0P2BASE::GSCT_MAX/4)*3);
+
   // Command-Line Interface (CLI) polling.
   // If a reasonable chunk of the minor cycle remains after all other work is done
   // AND the CLI is / should be active OR a status line has just been output
@@ -1600,11 +4502,21 @@ void loopOpenTRV()
   // using a timeout which should safely avoid overrun, ie missing the next basic tick,
   // and which should also allow some energy-saving sleep.
 #if 1 && defined(ENABLE_CLI)
+#if defined(ENABLE_ENERGY_POLICY_LADDER)
+  // When critical only keep the CLI open for the (already awake) start of each minute.
+  if(OTV0P2BASE::CLI::isCLIActive() && ((EL_CRITICAL != energyLevel) || second0))
+#else
   if(OTV0P2BASE::CLI::isCLIActive())
+#endif
     {
     const uint8_t stopBy = nearOverrunThreshold - 1;
+#if defined(ENABLE_SCRATCH_ARENA)
+    OTV0P2BASE::ScratchSpace s(scratchRegion<SCRATCH_CLI_OFF, BUFSIZ_pollUI>(), BUFSIZ_pollUI);
+#else
     char buf[BUFSIZ_pollUI];
     OTV0P2BASE::ScratchSpace s((uint8_t*)buf, sizeof(buf));
+#endif
+    loopCheckpoint(LOOP_PHASE_CLI);
     pollCLI(stopBy, 0 == TIME_LSD, s);
     }
 #endif
@@ -1622,19 +4534,65 @@ void loopOpenTRV()
     }
 #endif
 
+#if defined(ENABLE_SKIP_IDLE_SLOTS)
+  // Only sleep through idle slots if nothing needs attention every minor cycle,
+  // eg a hub listening, the CLI, FHT8V TX, the UI in use, or the local valve still moving.
+  canSkipIdleSlots = !inHubMode()
+#if defined(ENABLE_CLI)
+    && !OTV0P2BASE::CLI::isCLIActive()
+#endif
+#if defined(ENABLE_CONTINUOUS_RX)
+    && !needsToListen
+#endif
+#if defined(ENABLE_FHT8VSIMPLE)
+    && !localFHT8VTRVEnabled()
+#endif
+#if defined(valveUI_DEFINED)
+    && !valveUI.veryRecentUIControlUse()
+#endif
+#if defined(HAS_DORM1_VALVE_DRIVE) && defined(ENABLE_LOCAL_TRV) && defined(ENABLE_NOMINAL_RAD_VALVE)
+    && ValveDirect.isInNormalRunState() && !NominalRadValve.isValveMoved()
+#endif
+    ;
+#endif // ENABLE_SKIP_IDLE_SLOTS
+
 // Do explicit overrun detection iff RTC watchdog not enabled (should reset instead).
 #if !defined(ENABLE_WATCHDOG_SLOW) // || !defined(ENABLE_TRIMMED_MEMORY) // Could reinstate if not short memory...
   // Detect and handle (actual or near) overrun, if it happens, though it should not.
   if(TIME_LSD != OTV0P2BASE::getSecondsLT())
     {
     // Increment the overrun counter (stored inverted, so 0xff initialised => 0 overruns).
-    const uint8_t orc = 1 + ~eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_OVERRUN_COUNTER);
-    OTV0P2BASE::eeprom_smart_update_byte((uint8_t *)V0P2BASE_EE_START_OVERRUN_COUNTER, ~orc);
+    const uint8_t orc = 1 + ~eeQueuedReadByte((uint8_t *)V0P2BASE_EE_START_OVERRUN_COUNTER);
+    eeQueueUpdateByte(EEW_DIAG, (uint8_t *)V0P2BASE_EE_START_OVERRUN_COUNTER, ~orc);
+#if defined(ENABLE_OVERRUN_LOG)
+    // Record what this pass was doing for later analysis.
+    logOverrun(TIME_LSD, orc,
+#if defined(ENABLE_RADIO_RX)
+        PrimaryRadio.getRXMsgsQueued(),
+#else
+        0,
+#endif
+#if defined(ENABLE_CLI)
+        OTV0P2BASE::CLI::isCLIActive());
+#else
+        false);
+#endif
+#endif // ENABLE_OVERRUN_LOG
 #if 1 && defined(DEBUG)
     DEBUG_SERIAL_PRINTLN_FLASHSTRING("!loop overrun");
 #endif
-#if defined(ENABLE_FHT8VSIMPLE)
+#if defined(ENABLE_FHT8VSIMPLE) && defined(ENABLE_FHT8V_FAST_RESYNC)
+    // The next pass starts (now - TIME_LSD) later than it would have, so wind the TX schedules on by that.
+    const uint8_t lostHalfSeconds = 2 * ((OTV0P2BASE::getSecondsLT() + 60 - TIME_LSD) % 60);
+    FHT8V.reanchorAfterOverrun(lostHalfSeconds); // Resyncs if the loss was too big.
+#if defined(ENABLE_FHT8V_MULTI)
+    for(uint8_t i = 0; i < FHT8V_EXTRA_VALVES; ++i) { FHT8VExtra[i].reanchorAfterOverrun(lostHalfSeconds); }
+#endif
+#elif defined(ENABLE_FHT8VSIMPLE)
     FHT8V.resyncWithValve(); // Assume that sync with valve may have been lost, so re-sync.
+#if defined(ENABLE_FHT8V_MULTI)
+    for(uint8_t i = 0; i < FHT8V_EXTRA_VALVES; ++i) { FHT8VExtra[i].resyncWithValve(); }
+#endif
 #endif
     TIME_LSD = OTV0P2BASE::getSecondsLT(); // Prepare to sleep until start of next full minor cycle.
     }
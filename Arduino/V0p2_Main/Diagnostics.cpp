@@ -0,0 +1,1151 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2013--2017
+*/
+
+/*
+ On-board diagnostics and instrumentation for OpenTRV.
+ All facilities here are opt-in at compile time as they cost RAM and some CPU.
+ */
+
+#include "V0p2_Main.h"
+
+#if defined(ENABLE_ISR_PROFILER)
+#include <avr/power.h>
+#endif
+#if defined(ENABLE_ISR_PROFILER) || defined(ENABLE_STACK_TAGS) || defined(ENABLE_HIRES_TIME)
+#include <util/atomic.h>
+#endif
+
+
+#if defined(ENABLE_SLOT_PROFILER)
+// Per-slot profile record; 4 bytes each.
+// The mean is sumTicks/n, and both are halved when n would overflow
+// so that the mean gently tracks recent behaviour.
+typedef struct
+  {
+  uint8_t maxTicks; // Worst-case sub-cycle ticks seen.
+  uint8_t n; // Number of (recent) samples.
+  uint16_t sumTicks; // Sum of ticks over the n samples.
+  } profileEntry_t;
+static profileEntry_t profile[PROFILE_SLOTS];
+
+// Record one run of the given slot that started at sub-cycle time startSCT and ends now.
+void profileSlot(const uint8_t slot, const uint8_t startSCT)
+  {
+  if(slot >= PROFILE_SLOTS) { return; }
+  // Unsigned wrap limits a (rare) run across the end of the minor cycle to a sensible value.
+  const uint8_t ticks = (uint8_t)(OTV0P2BASE::getSubCycleTime() - startSCT);
+  profileEntry_t &e = profile[slot];
+  if(ticks > e.maxTicks) { e.maxTicks = ticks; }
+  if(0xff == e.n) { e.n >>= 1; e.sumTicks >>= 1; }
+  ++e.n;
+  e.sumTicks += ticks;
+  }
+
+// Clear all profile data.
+void profileReset() { memset(profile, 0, sizeof(profile)); }
+
+// Dump profile to Serial as "slot max mean n" lines for used slots, stopping at the given sub-cycle time.
+// RX and CLI slots are shown as R and C.
+void profileDump(const uint8_t stopBy)
+  {
+  for(uint8_t i = 0; i < PROFILE_SLOTS; ++i)
+    {
+    const profileEntry_t &e = profile[i];
+    if(0 == e.n) { continue; }
+    OTV0P2BASE::flushSerialProductive();
+    if(OTV0P2BASE::getSubCycleTime() >= stopBy) { Serial.println(F("...")); return; }
+    if(PROFILE_SLOT_RX == i) { Serial.print('R'); }
+    else if(PROFILE_SLOT_CLI == i) { Serial.print('C'); }
+    else { Serial.print(i << 1); } // Show as TIME_LSD.
+    OTV0P2BASE::Serial_print_space();
+    Serial.print(e.maxTicks);
+    OTV0P2BASE::Serial_print_space();
+    Serial.print(e.sumTicks / e.n);
+    OTV0P2BASE::Serial_print_space();
+    Serial.println(e.n);
+    }
+  }
+#endif // ENABLE_SLOT_PROFILER
+
+
+#if defined(ENABLE_HIRES_TIME)
+// Length of one minor cycle, ie one wrap of getSubCycleTime().
+#if defined(V0P2BASE_TWO_S_TICK_RTC_SUPPORT)
+static constexpr uint32_t HIRES_CYCLE_US = 2000000UL;
+#else
+static constexpr uint32_t HIRES_CYCLE_US = 1000000UL;
+#endif
+// Microseconds per timer 0 tick, with the Arduino core's /64 prescale.
+static constexpr uint8_t HIRES_FINE_US = (uint8_t)((64 * 1000000UL) / F_CPU);
+static uint16_t hiresCycles; // Minor cycles seen to end.
+static uint8_t hiresLastSCT; // Sub-cycle time at the last call.
+static uint8_t hiresTickT0; // Timer 0 count when the current sub-cycle tick was first seen.
+static uint8_t hiresLastFine; // Fine part last returned, to stay monotonic should timer 0 wrap within a tick.
+
+uint32_t hiresTime()
+  {
+  uint16_t cycles;
+  uint8_t sct, fine;
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+    {
+    const uint8_t t0 = OTV0P2BASE::getCPUCycleCount();
+    sct = OTV0P2BASE::getSubCycleTime();
+    if(sct != hiresLastSCT)
+      {
+      if(sct < hiresLastSCT) { ++hiresCycles; }
+      hiresLastSCT = sct;
+      hiresTickT0 = t0;
+      hiresLastFine = 0;
+      }
+    fine = (uint8_t)(t0 - hiresTickT0);
+    if(fine < hiresLastFine) { fine = hiresLastFine; }
+    hiresLastFine = fine;
+    cycles = hiresCycles;
+    }
+  return(((uint32_t)cycles << 16) | ((uint16_t)sct << 8) | fine);
+  }
+
+// Approximate microseconds from hiresTime() value start to later value end.
+uint32_t hiresElapsedUs(const uint32_t start, const uint32_t end)
+  {
+  const uint32_t ticks = (end >> 8) - (start >> 8);
+  const int16_t fineDiff = (int16_t)(uint8_t)end - (int16_t)(uint8_t)start;
+  const uint32_t us = ticks * (HIRES_CYCLE_US / 256) + ((ticks * (HIRES_CYCLE_US % 256)) >> 8);
+  if(fineDiff >= 0) { return(us + (uint16_t)fineDiff * HIRES_FINE_US); }
+  const uint16_t back = (uint16_t)(-fineDiff) * HIRES_FINE_US;
+  return((us > back) ? (us - back) : 0);
+  }
+#endif // ENABLE_HIRES_TIME
+
+
+#if defined(ENABLE_ISR_PROFILER)
+isrProfile_t isrProfiles[ISR_PROFILES];
+
+// Start timer 1 free-running at the CPU clock.
+void isrProfileSetup()
+  {
+  power_timer1_enable();
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10); // Normal mode, no prescaling.
+  }
+
+// Clear all ISR profiles.
+void isrProfileReset()
+  {
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE) { memset(isrProfiles, 0, sizeof(isrProfiles)); }
+  }
+
+// Print "ISR name max n h0 .. h7" lines to Serial.
+void isrProfileDump()
+  {
+  for(uint8_t i = 0; i < ISR_PROFILES; ++i)
+    {
+    isrProfile_t e;
+    ATOMIC_BLOCK (ATOMIC_RESTORESTATE) { e = isrProfiles[i]; }
+    Serial.print(F("ISR "));
+    Serial.print((ISR_PROFILE_PB == i) ? F("PB") : F("PD"));
+    OTV0P2BASE::Serial_print_space();
+    Serial.print(e.maxTicks);
+    OTV0P2BASE::Serial_print_space();
+    Serial.print(e.n);
+    for(uint8_t b = 0; b < ISR_PROFILE_BUCKETS; ++b)
+      {
+      OTV0P2BASE::Serial_print_space();
+      Serial.print(e.hist[b]);
+      }
+    Serial.println();
+    OTV0P2BASE::flushSerialProductive();
+    }
+  }
+#endif // ENABLE_ISR_PROFILER
+
+
+#if defined(ENABLE_RELAY_LATENCY_STATS)
+typedef struct
+  {
+  uint16_t n; // Samples, saturating.
+  uint32_t sumUs; // Total of the samples counted in n; in us so that sub-ms stages do not all count as 0.
+  uint32_t maxUs;
+  } latencyStats_t;
+static latencyStats_t latencyStats[LAT_STAGES];
+// hiresTime() when the primary RX queue last went non-empty; set by the ISR only while !latencyRXStampValid.
+static volatile uint32_t latencyRXStamp;
+static volatile bool latencyRXStampValid;
+// hiresTime() when the oldest frame still held for relay was taken, iff latencyRelayHeld.
+static uint32_t latencyRelayStamp;
+static bool latencyRelayHeld;
+
+void latencyRecord(const latencyStage_t s, const uint32_t start)
+  {
+  const uint32_t us = hiresElapsedUs(start, hiresTime());
+  latencyStats_t &e = latencyStats[s];
+  if(us > e.maxUs) { e.maxUs = us; }
+  // Stop counting once either n or the sum would overflow, so that the mean stays that of the samples counted.
+  if((e.n < 0xffff) && (us <= (0xffffffffUL - e.sumUs))) { ++e.n; e.sumUs += us; }
+  }
+
+void latencyRXQueued()
+  {
+  // Main loop owns the stamp until it has taken it.
+  if(latencyRXStampValid) { return; }
+  latencyRXStamp = hiresTime();
+  latencyRXStampValid = true;
+  }
+
+uint32_t latencyRXDecodeStart()
+  {
+  if(latencyRXStampValid)
+    {
+    latencyRecord(LAT_RX_WAIT, latencyRXStamp);
+    latencyRXStampValid = false; // Hand back to the ISR.
+    }
+  return(hiresTime());
+  }
+
+void latencyRelayTaken()
+  {
+  if(latencyRelayHeld) { return; } // Already timing an older frame.
+  latencyRelayStamp = hiresTime();
+  latencyRelayHeld = true;
+  }
+
+void latencyRelaySent(const bool anyStillHeld)
+  {
+  if(!latencyRelayHeld) { return; }
+  latencyRecord(LAT_RELAY_HOLD, latencyRelayStamp);
+  // The age of those left is not kept so time them from now.
+  latencyRelayHeld = anyStillHeld;
+  if(anyStillHeld) { latencyRelayStamp = hiresTime(); }
+  }
+
+void latencyRelayDropped(const bool anyStillHeld)
+  {
+  // As for latencyRelaySent() but without a sample; the oldest of any left is not known so time from now.
+  if(!latencyRelayHeld) { return; }
+  latencyRelayHeld = anyStillHeld;
+  if(anyStillHeld) { latencyRelayStamp = hiresTime(); }
+  }
+
+void latencyReset() { memset(latencyStats, 0, sizeof(latencyStats)); }
+
+void latencyDump()
+  {
+  for(uint8_t i = 0; i < LAT_STAGES; ++i)
+    {
+    const latencyStats_t &e = latencyStats[i];
+    Serial.print(F("LAT "));
+    Serial.print((LAT_RX_WAIT == i) ? F("rx") : ((LAT_DECODE == i) ? F("dec") : F("rly")));
+    OTV0P2BASE::Serial_print_space();
+    Serial.print(e.n);
+    OTV0P2BASE::Serial_print_space();
+    Serial.print((0 == e.n) ? 0 : (e.sumUs / e.n));
+    OTV0P2BASE::Serial_print_space();
+    Serial.println(e.maxUs);
+    OTV0P2BASE::flushSerialProductive();
+    }
+  }
+#endif // ENABLE_RELAY_LATENCY_STATS
+
+
+#if defined(ENABLE_STACK_TAGS)
+volatile uint16_t stackTagMinSP[STACK_TAGS];
+
+// Headroom below tagged min SP m, ie bytes above end of static RAM (no heap is used).
+static int16_t stackTagHeadroom(const uint16_t m)
+  {
+  extern int __heap_start;
+  return((int16_t)(m - (uint16_t)&__heap_start));
+  }
+
+// Read tag i safely against ISR update.
+static uint16_t stackTagGet(const uint8_t i)
+  {
+  uint16_t m;
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE) { m = stackTagMinSP[i]; }
+  return(m);
+  }
+
+// Lowest headroom over all tags seen, or -1 if none seen.
+int16_t stackTagsMinHeadroom()
+  {
+  int16_t result = -1;
+  for(uint8_t i = 0; i < STACK_TAGS; ++i)
+    {
+    const uint16_t m = stackTagGet(i);
+    if(0 == m) { continue; }
+    const int16_t h = stackTagHeadroom(m);
+    if((result < 0) || (h < result)) { result = h; }
+    }
+  return(result);
+  }
+
+// Print "SHT j t r c f i" headroom per tag to Serial, with - for tags not yet seen.
+void printStackTags()
+  {
+  Serial.print(F("SHT"));
+  for(uint8_t i = 0; i < STACK_TAGS; ++i)
+    {
+    OTV0P2BASE::Serial_print_space();
+    const uint16_t m = stackTagGet(i);
+    if(0 == m) { Serial.print('-'); }
+    else { Serial.print(stackTagHeadroom(m)); }
+    }
+  Serial.println();
+  }
+#endif // ENABLE_STACK_TAGS
+
+
+#if defined(ENABLE_OVERRUN_LOG)
+// Loop checkpoint state for the current pass.
+uint8_t loopPhasesRun;
+uint8_t loopLastCheckpointSCT;
+
+// Start of the EEPROM record for the given overrun count.
+static inline uint8_t *overrunRecord(const uint8_t overrunCount)
+  { return((uint8_t *)(V0P2_EE_START_OVERRUN_LOG + V0P2_EE_OVERRUN_LOG_RECORD_SIZE * (overrunCount & (V0P2_EE_OVERRUN_LOG_RECORDS-1)))); }
+
+// Write an overrun record for TIME_LSD slot lsd; overrunCount is the updated overrun counter.
+// Rotating through the ring by overrun count spreads wear and needs no separate head pointer.
+void logOverrun(const uint8_t lsd, const uint8_t overrunCount, const uint8_t rxQueued, const bool cliActive)
+  {
+  uint8_t *const r = overrunRecord(overrunCount);
+  eeQueueUpdateByte(EEW_DIAG, r, (lsd & 0x3f) | (cliActive ? 0x80 : 0));
+  eeQueueUpdateByte(EEW_DIAG, r + 1, loopPhasesRun);
+  eeQueueUpdateByte(EEW_DIAG, r + 2, loopLastCheckpointSCT);
+  eeQueueUpdateByte(EEW_DIAG, r + 3, rxQueued);
+  }
+
+// Print the overrun log to Serial, most recent first, one "lsd phases sct rxq [C]" line per record.
+void dumpOverrunLog(const uint8_t overrunCount)
+  {
+  eeQueueFlush();
+  for(uint8_t i = 0; i < V0P2_EE_OVERRUN_LOG_RECORDS; ++i)
+    {
+    const uint8_t *const r = overrunRecord(overrunCount - i);
+    const uint8_t b0 = eeprom_read_byte(r);
+    if(0xff == b0) { continue; } // Unused.
+    Serial.print(b0 & 0x3f);
+    OTV0P2BASE::Serial_print_space();
+    Serial.print(eeprom_read_byte(r + 1), HEX);
+    OTV0P2BASE::Serial_print_space();
+    Serial.print(eeprom_read_byte(r + 2));
+    OTV0P2BASE::Serial_print_space();
+    Serial.print(eeprom_read_byte(r + 3));
+    if(0 != (b0 & 0x80)) { Serial.print(F(" C")); }
+    Serial.println();
+    OTV0P2BASE::flushSerialProductive();
+    }
+  }
+
+// Erase the overrun log.
+void clearOverrunLog()
+  {
+  eeQueueFlush();
+  for(uint8_t i = 0; i < V0P2_EE_OVERRUN_LOG_RECORDS * V0P2_EE_OVERRUN_LOG_RECORD_SIZE; ++i)
+    { eeEraseByte(EEW_DIAG, (uint8_t *)(V0P2_EE_START_OVERRUN_LOG + i)); }
+  }
+#endif // ENABLE_OVERRUN_LOG
+
+
+#if defined(ENABLE_TASK_SUPERVISOR)
+static volatile uint8_t supervisedLSD;
+static volatile uint16_t supervisedTicksLeft;
+static volatile uint8_t supervisedLastSCT;
+
+void supervisorArm(const uint8_t lsd, const uint8_t budgetSCT)
+  {
+  if(0 == budgetSCT) { return; }
+  const uint16_t allowance = uint16_t(budgetSCT) * SUPERVISOR_BUDGET_SCALE;
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+    {
+    supervisedLSD = lsd;
+    supervisedTicksLeft = (allowance < SUPERVISOR_MIN_SCT) ? SUPERVISOR_MIN_SCT : allowance;
+    supervisedLastSCT = OTV0P2BASE::getSubCycleTime();
+    OCR0B = 0x80; // Half way round from the millis() overflow.
+    TIFR0 = _BV(OCF0B); // Drop any stale match.
+    TIMSK0 |= _BV(OCIE0B);
+    }
+  }
+
+void supervisorDisarm() { TIMSK0 &= ~_BV(OCIE0B); }
+
+// Runs once per timer 0 period (~16ms at 1MHz) while awake and supervising.
+// The RTC makes many ticks per sub-cycle wrap, so the difference mod 256 is the true elapsed time,
+// including any sleep since the previous interrupt provided that is under one cycle.
+ISR(TIMER0_COMPB_vect)
+  {
+  const uint8_t sct = OTV0P2BASE::getSubCycleTime();
+  const uint8_t elapsed = uint8_t(sct - supervisedLastSCT);
+  supervisedLastSCT = sct;
+  if(supervisedTicksLeft > elapsed) { supervisedTicksLeft -= elapsed; return; }
+  // Out of time: note the offender and reset.
+  // Anything the main line was doing with the EEPROM is abandoned along with the rest of its work.
+  eeprom_busy_wait();
+  eeUpdateByte(EEW_DIAG, (uint8_t *)V0P2_EE_START_SUPERVISOR_TRIP, supervisedLSD);
+  OTV0P2BASE::forceReset();
+  }
+#endif // ENABLE_TASK_SUPERVISOR
+
+
+#if defined(ENABLE_LINK_STATS)
+uint8_t linkRXErrs;
+uint8_t linkRXLastErr;
+uint8_t linkTXFails;
+uint8_t linkJSONFails;
+#if defined(ENABLE_RX_DUP_FILTER)
+uint8_t linkRXDups;
+#endif
+
+// Collect and clear pending RX errors from the primary radio.
+void linkPollRXErrs()
+  {
+  for(uint8_t e; 0 != (e = PrimaryRadio.getRXErr()); )
+    { linkRXLastErr = e; linkCount(linkRXErrs); }
+  }
+
+// Print "Link rD rF rE/last tF jF" line (with " dX" if ENABLE_RX_DUP_FILTER) to Serial.
+void printLinkStats()
+  {
+  linkPollRXErrs();
+  Serial.print(F("Link "));
+  Serial.print(PrimaryRadio.getRXMsgsDroppedRecent());
+  OTV0P2BASE::Serial_print_space();
+  Serial.print(PrimaryRadio.getRXMsgsFilteredRecent());
+  OTV0P2BASE::Serial_print_space();
+  Serial.print(linkRXErrs);
+  Serial.print('/');
+  Serial.print(linkRXLastErr);
+  OTV0P2BASE::Serial_print_space();
+  Serial.print(linkTXFails);
+  OTV0P2BASE::Serial_print_space();
+#if defined(ENABLE_RX_DUP_FILTER)
+  Serial.print(linkJSONFails);
+  OTV0P2BASE::Serial_print_space();
+  Serial.println(linkRXDups);
+#else
+  Serial.println(linkJSONFails);
+#endif
+  OTV0P2BASE::flushSerialProductive();
+  }
+#endif // ENABLE_LINK_STATS
+
+#if defined(ENABLE_CHANNEL_UTILISATION)
+// RSSI (RFM23B units, ~0.5dB steps from -120dBm) at or above which the channel is taken as busy.
+// The default is roughly -95dBm, a few dB above a quiet receiver's noise floor.
+#ifndef CHAN_BUSY_RSSI
+#define CHAN_BUSY_RSSI 50
+#endif
+uint8_t chanUtilPC = 0xff;
+uint8_t chanFrames;
+uint8_t chanBadFrames;
+// Accumulators for the current minute.
+// Samples are only taken while the CPU is awake, so this is an estimate,
+// biased slightly high as frame interrupts also wake the CPU.
+static uint16_t chanSamples;
+static uint16_t chanBusySamples;
+static uint8_t chanFramesAcc;
+static uint8_t chanBadAcc;
+// Sub-cycle tick of the last sample, so that the busy pollIO() loop samples at most once per tick.
+static uint8_t chanLastSCT = 0xff;
+
+// Sample the channel; cheap, called from pollIO() and takes at most one sample per sub-cycle tick.
+// RSSI is only meaningful while in RX, so does nothing when not listening.
+void chanSample()
+  {
+  if(PrimaryRadio.getListenChannel() < 0) { return; }
+  const uint8_t sct = OTV0P2BASE::getSubCycleTime();
+  if(sct == chanLastSCT) { return; }
+  chanLastSCT = sct;
+  if(0xffff == chanSamples) { return; }
+  ++chanSamples;
+  if(RFM23B.getRSSI() >= CHAN_BUSY_RSSI) { ++chanBusySamples; }
+  }
+
+// Both saturate at 255.
+void chanCountFrame() { if(chanFramesAcc < 255) { ++chanFramesAcc; } }
+void chanCountBad() { if(chanBadAcc < 255) { ++chanBadAcc; } }
+
+// Roll the counters over into the figures for the minute just ended.
+void chanUtilMinute()
+  {
+  chanUtilPC = (0 == chanSamples) ? 0xff : (uint8_t)((100UL * chanBusySamples) / chanSamples);
+  chanFrames = chanFramesAcc;
+  chanBadFrames = chanBadAcc;
+  chanSamples = 0;
+  chanBusySamples = 0;
+  chanFramesAcc = 0;
+  chanBadAcc = 0;
+  }
+
+// Print "Chan U% F X" line to Serial.
+void printChanUtil()
+  {
+  Serial.print(F("Chan "));
+  Serial.print(chanUtilPC);
+  Serial.print('%');
+  OTV0P2BASE::Serial_print_space();
+  Serial.print(chanFrames);
+  OTV0P2BASE::Serial_print_space();
+  Serial.println(chanBadFrames);
+  OTV0P2BASE::flushSerialProductive();
+  }
+#endif // ENABLE_CHANNEL_UTILISATION
+
+#if defined(ENABLE_TX_DUTY_CYCLE)
+void printTXDuty()
+  {
+  Serial.print(F("TXD "));
+  Serial.print(txDutyUsedMs());
+  OTV0P2BASE::Serial_print_space();
+  Serial.print(TX_DUTY_BUDGET_MS);
+  OTV0P2BASE::Serial_print_space();
+  Serial.println(txDutyRefused);
+  OTV0P2BASE::flushSerialProductive();
+  }
+#endif // ENABLE_TX_DUTY_CYCLE
+
+
+#if defined(ENABLE_HIGH_RES_STATS_RING)
+// Start of the EEPROM block for hour hh of the day with the given day number; blocks alternate by day.
+static inline uint8_t *highResStatsBlock(const uint16_t day, const uint8_t hh)
+  { return((uint8_t *)(V0P2_EE_START_HIGH_RES_STATS + V0P2_EE_HIGH_RES_STATS_BLOCK_SIZE * ((day & 1) * 24U + hh))); }
+static_assert(V0P2_EE_START_HIGH_RES_STATS + V0P2_EE_HIGH_RES_STATS_HOURS * V0P2_EE_HIGH_RES_STATS_BLOCK_SIZE <=
+    OTV0P2BASE::V0P2BASE_EE_START_NODE_ASSOCIATIONS + OTV0P2BASE::V0P2BASE_EE_NODE_ASSOCIATIONS_MAX_SETS * OTV0P2BASE::V0P2BASE_EE_NODE_ASSOCIATIONS_SET_SIZE,
+    "high-res stats beyond node association area");
+
+// Temperature as reconstructed from the current block so far, valid once a block header has been written.
+// After a restart no samples are taken until the next hour starts a fresh block.
+static int16_t highResLastC16;
+static bool highResValid;
+
+// Take a sample if due; call once per minute with the local time.
+// Samples at :04, :09, ... :59 so that the last lands with the final by-hour sample.
+// The block for the hour is erased and its header written at :04,
+// then each sample only clears bits, so each byte costs one erase every two days.
+void sampleHighResStats(const uint_least16_t msm)
+  {
+  const uint8_t mm = msm % 60;
+  if(4 != (mm % 5)) { return; }
+  uint8_t *const b = highResStatsBlock(OTV0P2BASE::getDaysSince1999LT(), uint8_t(msm / 60));
+  const int16_t t = TemperatureC16.get();
+  if(4 == mm)
+    {
+    // 0xff is reserved as 'no header'.
+    const uint8_t h = uint8_t(OTV0P2BASE::fnmin(OTV0P2BASE::fnmax(int16_t((t + 2) >> 2), int16_t(0)), int16_t(254)));
+    for(uint8_t i = 1; i <= V0P2_EE_HIGH_RES_STATS_SAMPLES; ++i) { eeQueueUpdateByte(EEW_HRS, b + i, 0xff); }
+    eeQueueUpdateByte(EEW_HRS, b, h);
+    highResLastC16 = int16_t(h) << 2;
+    highResValid = true;
+    }
+  if(!highResValid) { return; }
+  const int8_t d = int8_t(OTV0P2BASE::fnmin(OTV0P2BASE::fnmax(int16_t(t - highResLastC16), int16_t(-7)), int16_t(7)));
+  highResLastC16 += d;
+#ifdef ENABLE_NOMINAL_RAD_VALVE
+  const uint8_t v = uint8_t((NominalRadValve.get() * 6U + 50) / 100);
+#else
+  const uint8_t v = 0;
+#endif
+  const uint8_t occ = (Occupancy.twoBitOccupancyValue() >= 2) ? 1 : 0;
+  eeQueueUpdateByte(EEW_HRS, b + 1 + (mm / 5), uint8_t(d << 4) | (v << 1) | occ);
+  }
+
+// Print one block as "hh" then "C16/valve%/occ" for each 5 minutes, "-" if absent.
+static void dumpHighResStatsBlock(const uint8_t hh, const uint8_t *const b)
+  {
+  Serial.print(hh);
+  const uint8_t h = eeprom_read_byte(b);
+  if(0xff == h) { Serial.println(F(" -")); return; }
+  int16_t t = int16_t(h) << 2;
+  for(uint8_t i = 1; i <= V0P2_EE_HIGH_RES_STATS_SAMPLES; ++i)
+    {
+    OTV0P2BASE::Serial_print_space();
+    const uint8_t s = eeprom_read_byte(b + i);
+    if(0xff == s) { Serial.print('-'); continue; }
+    t += int8_t(s) >> 4;
+    Serial.print(t);
+    Serial.print('/');
+    Serial.print(((s >> 1) & 7) * 100U / 6);
+    Serial.print('/');
+    Serial.print(s & 1);
+    }
+  Serial.println();
+  }
+
+// Print the samples for hour hh of both days held, older first, one line each.
+void dumpHighResStats(const uint8_t hh)
+  {
+  if(hh >= 24) { return; }
+  eeQueueFlush();
+  // Hours not yet reached today are older in today's blocks (two days ago) than in yesterday's.
+  const uint16_t today = OTV0P2BASE::getDaysSince1999LT();
+  const bool reached = (hh <= OTV0P2BASE::getHoursLT());
+  dumpHighResStatsBlock(hh, highResStatsBlock(reached ? today - 1 : today, hh));
+  dumpHighResStatsBlock(hh, highResStatsBlock(reached ? today : today - 1, hh));
+  OTV0P2BASE::flushSerialProductive();
+  }
+#endif // ENABLE_HIGH_RES_STATS_RING
+
+
+#if defined(ENABLE_EEPROM_WEAR_STATS)
+uint16_t eeWearCounts[EEW_REGIONS];
+// Minutes since the last checkpoint (or restart).
+static uint16_t eeWearMinutes;
+// Copy of the TX restart counters as of the last tick, valid after the first.
+static uint8_t eeWearTXCtr[OTV0P2BASE::VOP2BASE_EE_LEN_PERSISTENT_MSG_RESTART_CTR];
+static bool eeWearTXCtrValid;
+
+// EEPROM total i: 0 is minutes covered, 1+r is region r.
+static inline uint32_t *eeWearTotal(const uint8_t i) { return((uint32_t *)(V0P2_EE_START_WEAR_STATS + 4 * i)); }
+static uint32_t eeWearReadTotal(const uint8_t i)
+  {
+  const uint32_t v = eeprom_read_dword(eeWearTotal(i));
+  return((0xffffffffUL == v) ? 0 : v);
+  }
+
+// Cells spread over by each region's writes, for projecting lifetime.
+// Where a region has a single hot cell (eg the overrun counter) that is used
+// so as to give the pessimistic worst-cell figure.
+static const uint16_t eeWearCells[EEW_REGIONS] PROGMEM =
+  {
+  1, // Reset counter.
+#if defined(ENABLE_RTC_WEAR_LEVELLING)
+  V0P2_EE_LEN_RTC_LOG,
+#else
+  1, // Single time-of-day cell.
+#endif
+  V0P2BASE_EE_STATS_SETS * V0P2BASE_EE_STATS_SET_SIZE,
+#if defined(ENABLE_HIGH_RES_STATS_RING)
+  24 * V0P2_EE_HIGH_RES_STATS_BLOCK_SIZE,
+#else
+  1,
+#endif
+  1, // Overrun counter.
+  1, // Boiler hub time / setback lockout.
+  OTV0P2BASE::VOP2BASE_EE_LEN_PERSISTENT_MSG_RESTART_CTR,
+  };
+
+// Snapshot the by-hour stats for hour hh.
+void eeWearStatsSnapshot(const uint8_t hh, uint8_t snap[V0P2BASE_EE_STATS_SETS])
+  {
+  for(uint8_t i = 0; i < V0P2BASE_EE_STATS_SETS; ++i)
+    { snap[i] = eeprom_read_byte((uint8_t *)(V0P2BASE_EE_STATS_START_ADDR(i) + hh)); }
+  }
+// Count the by-hour stats bytes for hour hh changed since the snapshot.
+// Packed sets are skipped as PackedByHourByteStats counts its own writes.
+void eeWearStatsCount(const uint8_t hh, const uint8_t snap[V0P2BASE_EE_STATS_SETS])
+  {
+  for(uint8_t i = 0; i < V0P2BASE_EE_STATS_SETS; ++i)
+    {
+#if defined(ENABLE_PACKED_NV_STATS)
+    if(PackedByHourByteStats::isPacked(i)) { continue; }
+#endif
+    if(snap[i] != eeprom_read_byte((uint8_t *)(V0P2BASE_EE_STATS_START_ADDR(i) + hh))) { eeWearCount(EEW_STATS); }
+    }
+  }
+
+// OTV0P2BASE::persistRTC() with counting of the time and date bytes changed.
+void eeWearPersistRTC()
+  {
+  const uint16_t d = eeprom_read_word((uint16_t *)V0P2BASE_EE_START_RTC_DAY_PERSIST);
+  const uint8_t t = eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_RTC_HHMM_PERSIST);
+  OTV0P2BASE::persistRTC();
+  const uint16_t d2 = eeprom_read_word((uint16_t *)V0P2BASE_EE_START_RTC_DAY_PERSIST);
+  if((d ^ d2) & 0xff) { eeWearCount(EEW_RTC); }
+  if((d ^ d2) >> 8) { eeWearCount(EEW_RTC); }
+  if(t != eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_RTC_HHMM_PERSIST)) { eeWearCount(EEW_RTC); }
+  }
+
+#if defined(ENABLE_SETBACK_LOCKOUT_COUNTDOWN)
+// OTRadValve::countDownSetbackLockout() with counting.
+void eeWearCountDownSetbackLockout()
+  {
+  uint8_t *const p = (uint8_t *)V0P2BASE_EE_START_SETBACK_LOCKOUT_COUNTDOWN_H_INV;
+  const uint8_t v = eeprom_read_byte(p);
+  OTRadValve::countDownSetbackLockout();
+  if(v != eeprom_read_byte(p)) { eeWearCount(EEW_CONFIG); }
+  }
+#endif
+
+// Call once a minute: notes elapsed time and picks up TX restart counter changes.
+// The restart counters change rarely (at restart and counter roll-over) so a per-minute check misses little.
+void eeWearTick()
+  {
+  if(eeWearMinutes < 0xffff) { ++eeWearMinutes; }
+  for(uint8_t i = 0; i < OTV0P2BASE::VOP2BASE_EE_LEN_PERSISTENT_MSG_RESTART_CTR; ++i)
+    {
+    const uint8_t v = eeprom_read_byte((uint8_t *)(OTV0P2BASE::VOP2BASE_EE_START_PERSISTENT_MSG_RESTART_CTR + i));
+    if(eeWearTXCtrValid && (v != eeWearTXCtr[i])) { eeWearCount(EEW_TXCTR); }
+    eeWearTXCtr[i] = v;
+    }
+  eeWearTXCtrValid = true;
+  }
+
+// Add RAM counts to the EEPROM totals and clear them; call once a day.
+// Costs a handful of byte writes a day, itself counted as EEW_DIAG.
+void eeWearCheckpoint()
+  {
+  uint8_t written = 0;
+  for(uint8_t i = 0; i <= EEW_REGIONS; ++i)
+    {
+    const uint32_t v = eeWearReadTotal(i) + ((0 == i) ? eeWearMinutes : eeWearCounts[i-1]);
+    uint8_t *const p = (uint8_t *)eeWearTotal(i);
+    for(uint8_t b = 0; b < 4; ++b) { if(OTV0P2BASE::eeprom_smart_update_byte(p + b, uint8_t(v >> (8 * b)))) { ++written; } }
+    }
+  for(uint8_t r = 0; r < EEW_REGIONS; ++r) { eeWearCounts[r] = 0; }
+  eeWearMinutes = 0;
+  eeWearCount(EEW_DIAG, written);
+  }
+
+// Print "region bytes/day years" for each region, projecting years to 100k writes per cell.
+// Regions are shown as their EEW_XXX index; years are capped at 999.
+void printEEWearStats()
+  {
+  const uint32_t minutes = eeWearReadTotal(0) + eeWearMinutes;
+  if(0 == minutes) { return; }
+  for(uint8_t r = 0; r < EEW_REGIONS; ++r)
+    {
+    const uint32_t perDay = ((eeWearReadTotal(1 + r) + eeWearCounts[r]) * 1440UL + minutes/2) / minutes;
+    const uint32_t cells = pgm_read_word(&eeWearCells[r]);
+    const uint32_t years = (0 == perDay) ? 999 : OTV0P2BASE::fnmin((100000UL * cells) / (perDay * 365), 999UL);
+    Serial.print(r);
+    OTV0P2BASE::Serial_print_space();
+    Serial.print(perDay);
+    OTV0P2BASE::Serial_print_space();
+    Serial.println(years);
+    OTV0P2BASE::flushSerialProductive();
+    }
+  }
+
+// Clear RAM and EEPROM totals.
+void clearEEWearStats()
+  {
+  for(uint8_t r = 0; r < EEW_REGIONS; ++r) { eeWearCounts[r] = 0; }
+  eeWearMinutes = 0;
+  for(uint8_t i = 0; i < V0P2_EE_LEN_WEAR_STATS; ++i)
+    { OTV0P2BASE::eeprom_smart_erase_byte((uint8_t *)(V0P2_EE_START_WEAR_STATS + i)); }
+  }
+#endif // ENABLE_EEPROM_WEAR_STATS
+
+
+#if defined(ENABLE_EEPROM_WRITE_QUEUE)
+// FIFO ring of pending updates: address in the low 10 bits, wear region above, and EEQ_WRITE at the top for a plain write.
+// Driven by polling EEPE from the main loop rather than from the EEPROM-ready interrupt,
+// as library code uses the avr-libc EEPROM routines, which an ISR could interleave with.
+struct eeQueued_t { uint16_t ar; uint8_t v; };
+static eeQueued_t eeQ[EE_WRITE_QUEUE_LEN];
+static uint8_t eeQHead; // Oldest entry.
+static uint8_t eeQCount;
+static constexpr uint16_t EEQ_ADDR_MASK = 0x3ff;
+static constexpr uint8_t EEQ_REGION_SHIFT = 10;
+static constexpr uint16_t EEQ_WRITE = 0x8000;
+static_assert(EEW_REGIONS <= 8, "wear region must fit between address and EEQ_WRITE");
+
+// Index of the queued entry for address a, or -1 if none.
+static int8_t eeQFind(const uint16_t a)
+  {
+  for(uint8_t i = 0; i < eeQCount; ++i)
+    {
+    const uint8_t j = (eeQHead + i) % EE_WRITE_QUEUE_LEN;
+    if(a == (eeQ[j].ar & EEQ_ADDR_MASK)) { return(int8_t(j)); }
+    }
+  return(-1);
+  }
+
+// Start the smart update of the oldest entry and dequeue it; the EEPROM must be idle.
+// As OTV0P2BASE::eeprom_smart_update_byte(), erases or writes only where that suffices,
+// but does not wait for completion.
+static void eeQStartOldest()
+  {
+  const eeQueued_t e = eeQ[eeQHead];
+  eeQHead = (eeQHead + 1) % EE_WRITE_QUEUE_LEN;
+  --eeQCount;
+  EEAR = e.ar & EEQ_ADDR_MASK;
+  EECR |= _BV(EERE);
+  const uint8_t current = EEDR;
+  const bool write = (0 != (e.ar & EEQ_WRITE));
+  if(!write && (current == e.v)) { return; }
+  const uint8_t mode = write ? 0 : // Erase and write, as eeprom_write_byte().
+                       (0xff == e.v) ? _BV(EEPM0) : // Erase only.
+                       ((e.v == (current & e.v)) ? _BV(EEPM1) : // Write (clear bits) only.
+                       0); // Erase and write.
+  EEDR = e.v;
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+    {
+    EECR = mode | _BV(EEMPE);
+    EECR |= _BV(EEPE); // Must be within 4 cycles of setting EEMPE.
+    }
+#if defined(ENABLE_EEPROM_WEAR_STATS)
+  eeWearCount(eeWearRegion_t((e.ar & ~EEQ_WRITE) >> EEQ_REGION_SHIFT));
+#endif
+  }
+
+void eeQueueUpdate(const uint8_t r, uint8_t *const p, const uint8_t v, const bool write)
+  {
+  const uint16_t a = (uint16_t)(uintptr_t)p;
+  const int8_t i = eeQFind(a);
+  if(i >= 0) { eeQ[i].v = v; if(write) { eeQ[i].ar |= EEQ_WRITE; } }
+  else
+    {
+    if(eeQCount >= EE_WRITE_QUEUE_LEN) { eeprom_busy_wait(); eeQStartOldest(); }
+    eeQ[(eeQHead + eeQCount++) % EE_WRITE_QUEUE_LEN] = { uint16_t(a | (uint16_t(r) << EEQ_REGION_SHIFT) | (write ? EEQ_WRITE : 0)), v };
+    }
+  if(Supply_cV.isSupplyVoltageLow()) { eeQueueFlush(); }
+  }
+
+uint8_t eeQueuedReadByte(const uint8_t *const p)
+  {
+  const int8_t i = eeQFind((uint16_t)(uintptr_t)p);
+  return((i >= 0) ? eeQ[i].v : eeprom_read_byte(p));
+  }
+
+bool eeQueueService()
+  {
+  if((0 != eeQCount) && eeprom_is_ready()) { eeQStartOldest(); }
+  return(0 != eeQCount);
+  }
+
+void eeQueueFlush()
+  {
+  while(0 != eeQCount) { eeprom_busy_wait(); eeQStartOldest(); }
+  eeprom_busy_wait();
+  }
+#endif // ENABLE_EEPROM_WRITE_QUEUE
+
+
+#if defined(ENABLE_VALVE_MOVE_LOG)
+// RAM ring of the latest events; slot is seq mod VML_RAM_EVENTS.
+static uint8_t vmlEvents[VML_RAM_EVENTS][VML_EVENT_SIZE];
+static uint8_t vmlSeq; // Sequence number of the next event.
+static uint8_t vmlCount; // Events in the RAM ring, up to VML_RAM_EVENTS.
+static uint16_t vmlTicks; // Run ticks for the latest event so far.
+// State as of the previous poll, for detecting moves and inferring their cause.
+static bool vmlPrevValid;
+static uint8_t vmlPrevPC;
+static bool vmlPrevWarm;
+static uint8_t vmlPrevSetback;
+
+static inline uint8_t *vmlLatest() { return(vmlEvents[(uint8_t)(vmlSeq - 1) & (VML_RAM_EVENTS-1)]); }
+
+#if defined(ENABLE_VALVE_MOVE_LOG_EEPROM)
+static inline uint8_t *vmlRecord(const uint8_t seq)
+  { return((uint8_t *)(V0P2_EE_START_VALVE_MOVE_LOG + (1 + VML_EVENT_SIZE) * (seq & (V0P2_EE_VALVE_MOVE_LOG_RECORDS-1)))); }
+// Continue the EEPROM sequence after a restart: the newest record is the one not followed by its successor.
+static uint8_t vmlNextSeqFromEEPROM()
+  {
+  for(uint8_t i = 0; i < V0P2_EE_VALVE_MOVE_LOG_RECORDS; ++i)
+    {
+    const uint8_t s = eeprom_read_byte(vmlRecord(i));
+    if((uint8_t)(s + 1) != eeprom_read_byte(vmlRecord(i + 1))) { return(s + 1); }
+    }
+  return(0);
+  }
+// Write the latest event (now final) to the EEPROM ring.
+static void vmlSpill()
+  {
+  const uint8_t seq = vmlSeq - 1;
+  uint8_t *const r = vmlRecord(seq);
+  const uint8_t *const e = vmlLatest();
+  eeUpdateByte(EEW_DIAG, r, seq);
+  for(uint8_t i = 0; i < VML_EVENT_SIZE; ++i) { eeUpdateByte(EEW_DIAG, r + 1 + i, e[i]); }
+  }
+#endif // ENABLE_VALVE_MOVE_LOG_EEPROM
+
+// Note any valve move from NominalRadValve.read(); call just after it once a minute.
+// UI use takes precedence, then a mode change, then a setback change; anything else is down to temperature.
+void valveMoveLogPoll()
+  {
+  const uint8_t pc = NominalRadValve.get();
+  const bool warm = valveMode.inWarmMode();
+  const uint8_t setback = NominalRadValve.setbackSubSensor.get();
+  if(!vmlPrevValid)
+    {
+#if defined(ENABLE_VALVE_MOVE_LOG_EEPROM)
+    vmlSeq = vmlNextSeqFromEEPROM();
+#endif
+    vmlPrevValid = true;
+    }
+  else if(pc != vmlPrevPC)
+    {
+#if defined(ENABLE_VALVE_MOVE_LOG_EEPROM)
+    if(0 != vmlCount) { vmlSpill(); }
+#endif
+    uint8_t reason = VML_TEMP;
+#if defined(valveUI_DEFINED)
+    if(valveUI.veryRecentUIControlUse()) { reason = VML_UI; } else
+#endif
+    if(warm != vmlPrevWarm) { reason = VML_SCHEDULE; }
+    else if(setback != vmlPrevSetback) { reason = VML_SETBACK; }
+    const uint16_t w = ((uint16_t)reason << 14) | OTV0P2BASE::getMinutesSinceMidnightLT();
+    uint8_t *const e = vmlEvents[vmlSeq++ & (VML_RAM_EVENTS-1)];
+    e[0] = (uint8_t)(w >> 8);
+    e[1] = (uint8_t)w;
+    e[2] = vmlPrevPC;
+    e[3] = pc;
+    e[4] = e[5] = 0;
+    vmlTicks = 0;
+    if(vmlCount < VML_RAM_EVENTS) { ++vmlCount; }
+    }
+  vmlPrevPC = pc;
+  vmlPrevWarm = warm;
+  vmlPrevSetback = setback;
+  }
+
+// Add motor run sub-cycle ticks to the latest event.
+void valveMoveLogMotorTicks(const uint8_t ticks)
+  {
+  if((0 == vmlCount) || (0 == ticks)) { return; }
+  vmlTicks = (vmlTicks > (uint16_t)(0xffffU - ticks)) ? 0xffff : (vmlTicks + ticks);
+  uint8_t *const e = vmlLatest();
+  e[4] = (uint8_t)(vmlTicks >> 8);
+  e[5] = (uint8_t)vmlTicks;
+  }
+
+// First event seq wanted by the current dump, and whether to filter on it at all.
+static uint8_t vmlDumpFrom;
+static bool vmlDumpFiltered;
+void valveMoveLogDumpFrom(const bool filtered, const uint8_t from) { vmlDumpFiltered = filtered; vmlDumpFrom = from; }
+
+// Send one event as a binary record, unless before the requested start (mod 256, within half the range).
+static void vmlSend(const uint8_t seq, const uint8_t *const e)
+  {
+  if(vmlDumpFiltered && ((uint8_t)(seq - vmlDumpFrom) >= 128)) { return; }
+  const uint8_t id[2] = { getNodeIDByte(0), getNodeIDByte(1) };
+  binRecStart('V', id, sizeof(id), seq);
+  binRecPut(e, VML_EVENT_SIZE);
+  binRecEnd();
+  }
+
+#if defined(ENABLE_VALVE_MOVE_LOG_EEPROM)
+// Send the EEPROM record for seq if it holds that event; false if unused.
+static bool vmlSendFromEEPROM(const uint8_t seq)
+  {
+  const uint8_t *const r = vmlRecord(seq);
+  uint8_t e[VML_EVENT_SIZE];
+  for(uint8_t j = 0; j < VML_EVENT_SIZE; ++j) { e[j] = eeprom_read_byte(r + 1 + j); }
+  if((seq != eeprom_read_byte(r)) || (0 != (e[0] & 0x38))) { return(false); } // Unused.
+  vmlSend(seq, e);
+  return(true);
+  }
+#endif
+
+// Send events as binary records to Serial, oldest first, stopping at the given sub-cycle time.
+// With the EEPROM ring its records are sent first, so recent events may appear twice with the same seq.
+void valveMoveLogDump(const uint8_t stopBy)
+  {
+#if defined(ENABLE_VALVE_MOVE_LOG_EEPROM)
+  const uint8_t next = vmlNextSeqFromEEPROM();
+  for(uint8_t i = V0P2_EE_VALVE_MOVE_LOG_RECORDS; i > 0; --i)
+    {
+    OTV0P2BASE::flushSerialProductive();
+    if(OTV0P2BASE::getSubCycleTime() >= stopBy) { return; }
+    vmlSendFromEEPROM(next - i);
+    }
+#endif
+  for(uint8_t i = vmlCount; i > 0; --i)
+    {
+    const uint8_t seq = vmlSeq - i;
+    OTV0P2BASE::flushSerialProductive();
+    if(OTV0P2BASE::getSubCycleTime() >= stopBy) { return; }
+    vmlSend(seq, vmlEvents[seq & (VML_RAM_EVENTS-1)]);
+    }
+  }
+
+#if defined(ENABLE_COOP_TASKS)
+bool valveMoveLogDumpTask()
+  {
+  static coopState_t s;
+  static uint8_t seq;
+  static uint8_t end;
+  COOP_BEGIN(s);
+#if defined(ENABLE_VALVE_MOVE_LOG_EEPROM)
+  end = vmlNextSeqFromEEPROM();
+  for(seq = end - V0P2_EE_VALVE_MOVE_LOG_RECORDS; seq != end; ++seq)
+    {
+    if(!vmlSendFromEEPROM(seq)) { continue; }
+    COOP_YIELD(s);
+    }
+#endif
+  // Events pushed out of the RAM ring while dumping are skipped.
+  end = vmlSeq;
+  for(seq = vmlSeq - vmlCount; seq != end; ++seq)
+    {
+    if((uint8_t)(vmlSeq - seq) > vmlCount) { continue; }
+    vmlSend(seq, vmlEvents[seq & (VML_RAM_EVENTS-1)]);
+    COOP_YIELD(s);
+    }
+  COOP_END(s);
+  }
+#endif // ENABLE_COOP_TASKS
+#endif // ENABLE_VALVE_MOVE_LOG
+
+
+#if defined(ENABLE_ENERGY_ACCOUNTING)
+uint32_t energyTicks[EA_CATEGORIES];
+// Total sub-cycle ticks elapsed since restart.
+static uint32_t energyTotalTicks;
+
+// Nominal extra supply current for each category in uA, over the sleep baseline.
+// Rough figures for REV7/DORM1-class boards at 1MHz CPU; calibrate against a real meter for each board.
+static const uint16_t energyNominalMicroAmps[EA_CATEGORIES] PROGMEM =
+  {
+  400, // CPU active.
+  18500, // RFM23B RX.
+  28000, // RFM23B TX at normal power.
+  100, // USART clocked.
+  300, // ADC/I2C sensor read.
+  60000, // Motor running.
+  };
+// Nominal sleep current with all peripherals off, uA.
+static constexpr uint16_t ENERGY_SLEEP_MICROAMPS = 5;
+
+// Call just before the end-of-cycle sleep.
+void energyEndOfWork()
+  {
+  const uint8_t sct = OTV0P2BASE::getSubCycleTime();
+  energyTicks[EA_CPU] += sct;
+  if(OTV0P2BASE::_serialIsPoweredUp()) { energyTicks[EA_SERIAL] += sct; }
+  }
+
+// Call on waking with the number of minor cycles slept through.
+void energyWake(const uint8_t cycles)
+  {
+  const uint32_t t = (uint32_t)cycles * (OTV0P2BASE::GSCT_MAX + 1U);
+  energyTotalTicks += t;
+  if(PrimaryRadio.getListenChannel() >= 0) { energyTicks[EA_RX] += t; }
+  }
+
+// Mean supply current estimated from the counts and nominal per-category currents, in uA.
+// Counts and total are scaled down together to keep the products within 32 bits.
+uint16_t energyMeanMicroAmps()
+  {
+  uint32_t total = energyTotalTicks;
+  if(0 == total) { return(0); }
+  uint8_t shift = 0;
+  while(total > 0xffffUL) { total >>= 1; ++shift; }
+  uint32_t uA = ENERGY_SLEEP_MICROAMPS;
+  for(uint8_t c = 0; c < EA_CATEGORIES; ++c)
+    {
+    const uint32_t t = OTV0P2BASE::fnmin(energyTicks[c] >> shift, total);
+    uA += (t * pgm_read_word(&energyNominalMicroAmps[c])) / total;
+    }
+  return((uint16_t)OTV0P2BASE::fnmin(uA, (uint32_t)0xffffU));
+  }
+
+// Print "E" then ticks for each category, total ticks and estimated mean uA, to Serial.
+// Mean uA x 0.024 is mAh/day.
+void printEnergyStats()
+  {
+  Serial.print('E');
+  for(uint8_t c = 0; c < EA_CATEGORIES; ++c) { OTV0P2BASE::Serial_print_space(); Serial.print(energyTicks[c]); }
+  OTV0P2BASE::Serial_print_space();
+  Serial.print(energyTotalTicks);
+  OTV0P2BASE::Serial_print_space();
+  Serial.println(energyMeanMicroAmps());
+  OTV0P2BASE::flushSerialProductive();
+  }
+#endif // ENABLE_ENERGY_ACCOUNTING
+
+
+#if defined(ENABLE_BATTERY_LIFE_ESTIMATE)
+// Supply voltage at each of the last few end-of-day checks, oldest first; 0 if not yet taken.
+static uint16_t batteryDailycV[BATTERY_TREND_DAYS];
+// Latest estimate in days, or BATTERY_DAYS_UNKNOWN.
+static uint16_t batteryDaysLeft = BATTERY_DAYS_UNKNOWN;
+
+// Days until the supply would reach BATTERY_EMPTY_cV at the given drop in cV over the given days.
+static uint16_t batteryDaysAtRate(const uint16_t cV, const uint16_t drop, const uint8_t overDays)
+  {
+  if(cV <= BATTERY_EMPTY_cV) { return(0); }
+  const uint32_t d = ((uint32_t)(cV - BATTERY_EMPTY_cV) * overDays) / drop;
+  return((uint16_t)OTV0P2BASE::fnmin(d, (uint32_t)BATTERY_DAYS_MAX));
+  }
+
+// Recompute the estimate; call once per day, eg from endOfDayTasks().
+// Uses the voltage trend over BATTERY_TREND_DAYS once that has visibly fallen,
+// and (with ENABLE_ENERGY_ACCOUNTING) the estimated mean current against the charge nominally left,
+// taking the more cautious of the two where both are available.
+void batteryLifeDailyUpdate()
+  {
+  const uint16_t cV = Supply_cV.get();
+  for(uint8_t i = 1; i < BATTERY_TREND_DAYS; ++i) { batteryDailycV[i-1] = batteryDailycV[i]; }
+  batteryDailycV[BATTERY_TREND_DAYS-1] = cV;
+  if(Supply_cV.isMains()) { batteryDaysLeft = BATTERY_DAYS_UNKNOWN; return; }
+  uint16_t days = BATTERY_DAYS_UNKNOWN;
+  // Voltage trend, ignoring a rise (eg from new cells) or no change yet.
+  const uint16_t oldest = batteryDailycV[0];
+  if((0 != oldest) && (oldest > cV))
+    { days = batteryDaysAtRate(cV, oldest - cV, BATTERY_TREND_DAYS-1); }
+#if defined(ENABLE_ENERGY_ACCOUNTING)
+  // Charge left, assumed to fall linearly with voltage from BATTERY_FULL_cV to BATTERY_EMPTY_cV.
+  const uint16_t uA = energyMeanMicroAmps();
+  if(0 != uA)
+    {
+    const uint16_t v = OTV0P2BASE::fnmin(cV, (uint16_t)BATTERY_FULL_cV);
+    const uint32_t mAhLeft = (v <= BATTERY_EMPTY_cV) ? 0 :
+      ((uint32_t)BATTERY_NOMINAL_mAh * (v - BATTERY_EMPTY_cV)) / (BATTERY_FULL_cV - BATTERY_EMPTY_cV);
+    // uA x 24 / 1000 is mAh per day.
+    const uint32_t d = (mAhLeft * 1000U) / ((uint32_t)uA * 24U);
+    days = OTV0P2BASE::fnmin(days, (uint16_t)OTV0P2BASE::fnmin(d, (uint32_t)BATTERY_DAYS_MAX));
+    }
+#endif
+  batteryDaysLeft = days;
+  }
+
+// Latest estimate of days until the battery is empty, or BATTERY_DAYS_UNKNOWN.
+uint16_t batteryDaysToEmpty() { return(batteryDaysLeft); }
+#endif // ENABLE_BATTERY_LIFE_ESTIMATE
+
+
+#if defined(ENABLE_REMOTE_DIAG)
+// Put a big-endian 16-bit value.
+static inline void remoteDiagPut16(uint8_t *const p, const uint16_t v) { p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v; }
+
+void remoteDiagBody(uint8_t body[REMOTE_DIAG_BODY_LEN])
+  {
+  memset(body, 0xff, REMOTE_DIAG_BODY_LEN);
+  body[0] = REMOTE_DIAG_VERSION;
+  remoteDiagPut16(body + 1, (uint16_t)OTV0P2BASE::MemoryChecks::getMinSPSpaceBelowStackToEnd());
+  const uint8_t orc = (uint8_t)~eeQueuedReadByte((uint8_t *)V0P2BASE_EE_START_OVERRUN_COUNTER);
+  body[3] = orc;
+#if defined(ENABLE_OVERRUN_LOG)
+  if(0 != orc) { body[4] = eeQueuedReadByte(overrunRecord(orc)); }
+#endif
+#if defined(ENABLE_SLOT_PROFILER)
+  uint8_t worst = 0;
+  for(uint8_t i = 0; i < PROFILE_SLOTS; ++i)
+    {
+    if((0 == profile[i].n) || (profile[i].maxTicks < worst)) { continue; }
+    worst = profile[i].maxTicks;
+    body[5] = (PROFILE_SLOT_RX == i) ? 'R' : ((PROFILE_SLOT_CLI == i) ? 'C' : (uint8_t)(i << 1));
+    body[6] = worst;
+    }
+#endif
+#if defined(ENABLE_LINK_STATS)
+  linkPollRXErrs();
+  body[7] = PrimaryRadio.getRXMsgsDroppedRecent();
+  body[8] = PrimaryRadio.getRXMsgsFilteredRecent();
+  body[9] = linkRXErrs;
+  body[10] = linkTXFails;
+  body[11] = linkJSONFails;
+#endif
+#if defined(ENABLE_ENERGY_ACCOUNTING)
+  remoteDiagPut16(body + 12, energyMeanMicroAmps());
+#endif
+  remoteDiagPut16(body + 14, Supply_cV.get());
+  }
+#endif // ENABLE_REMOTE_DIAG
@@ -23,6 +23,715 @@ Author(s) / Copyright (s): Damon Hart-Davis 2014--2017
  */
 #include "V0p2_Main.h"
 
+#if defined(ENABLE_RX_DUP_FILTER)
+#include <util/crc16.h>
+#endif
+
+#if defined(ENABLE_CRC7_TABLE) && defined(ENABLE_CRC7_TABLE_NIBBLE)
+const uint8_t crc7_5B_nibbleTable[16] PROGMEM =
+  { 0x00, 0x6e, 0xdc, 0xb2, 0xd6, 0xb8, 0x0a, 0x64, 0xc2, 0xac, 0x1e, 0x70, 0x14, 0x7a, 0xc8, 0xa6 };
+#elif defined(ENABLE_CRC7_TABLE)
+const uint8_t crc7_5B_table[256] PROGMEM =
+  {
+  0x00, 0x37, 0x6e, 0x59, 0x6b, 0x5c, 0x05, 0x32, 0x61, 0x56, 0x0f, 0x38, 0x0a, 0x3d, 0x64, 0x53,
+  0x75, 0x42, 0x1b, 0x2c, 0x1e, 0x29, 0x70, 0x47, 0x14, 0x23, 0x7a, 0x4d, 0x7f, 0x48, 0x11, 0x26,
+  0x5d, 0x6a, 0x33, 0x04, 0x36, 0x01, 0x58, 0x6f, 0x3c, 0x0b, 0x52, 0x65, 0x57, 0x60, 0x39, 0x0e,
+  0x28, 0x1f, 0x46, 0x71, 0x43, 0x74, 0x2d, 0x1a, 0x49, 0x7e, 0x27, 0x10, 0x22, 0x15, 0x4c, 0x7b,
+  0x0d, 0x3a, 0x63, 0x54, 0x66, 0x51, 0x08, 0x3f, 0x6c, 0x5b, 0x02, 0x35, 0x07, 0x30, 0x69, 0x5e,
+  0x78, 0x4f, 0x16, 0x21, 0x13, 0x24, 0x7d, 0x4a, 0x19, 0x2e, 0x77, 0x40, 0x72, 0x45, 0x1c, 0x2b,
+  0x50, 0x67, 0x3e, 0x09, 0x3b, 0x0c, 0x55, 0x62, 0x31, 0x06, 0x5f, 0x68, 0x5a, 0x6d, 0x34, 0x03,
+  0x25, 0x12, 0x4b, 0x7c, 0x4e, 0x79, 0x20, 0x17, 0x44, 0x73, 0x2a, 0x1d, 0x2f, 0x18, 0x41, 0x76,
+  0x1a, 0x2d, 0x74, 0x43, 0x71, 0x46, 0x1f, 0x28, 0x7b, 0x4c, 0x15, 0x22, 0x10, 0x27, 0x7e, 0x49,
+  0x6f, 0x58, 0x01, 0x36, 0x04, 0x33, 0x6a, 0x5d, 0x0e, 0x39, 0x60, 0x57, 0x65, 0x52, 0x0b, 0x3c,
+  0x47, 0x70, 0x29, 0x1e, 0x2c, 0x1b, 0x42, 0x75, 0x26, 0x11, 0x48, 0x7f, 0x4d, 0x7a, 0x23, 0x14,
+  0x32, 0x05, 0x5c, 0x6b, 0x59, 0x6e, 0x37, 0x00, 0x53, 0x64, 0x3d, 0x0a, 0x38, 0x0f, 0x56, 0x61,
+  0x17, 0x20, 0x79, 0x4e, 0x7c, 0x4b, 0x12, 0x25, 0x76, 0x41, 0x18, 0x2f, 0x1d, 0x2a, 0x73, 0x44,
+  0x62, 0x55, 0x0c, 0x3b, 0x09, 0x3e, 0x67, 0x50, 0x03, 0x34, 0x6d, 0x5a, 0x68, 0x5f, 0x06, 0x31,
+  0x4a, 0x7d, 0x24, 0x13, 0x21, 0x16, 0x4f, 0x78, 0x2b, 0x1c, 0x45, 0x72, 0x40, 0x77, 0x2e, 0x19,
+  0x3f, 0x08, 0x51, 0x66, 0x54, 0x63, 0x3a, 0x0d, 0x5e, 0x69, 0x30, 0x07, 0x35, 0x02, 0x5b, 0x6c
+  };
+// Length of the plaintext JSON frame at bptr including its bounding '{' and '}'|0x80 (or with ALLOW_RAW_JSON_RX raw '}' then '\0'), excluding the CRC;
+// OTV0P2BASE::checkJSONMsgRXCRC_ERR if unterminated, with a non-printable character, or with a bad CRC.
+int8_t checkJSONRXCRC(const uint8_t *const bptr, const uint8_t bufLen)
+  {
+  if('{' != *bptr) { return(OTV0P2BASE::checkJSONMsgRXCRC_ERR); }
+  uint8_t crc = '{';
+  const uint8_t ml = OTV0P2BASE::fnmin((uint8_t)OTV0P2BASE::MSG_JSON_ABS_MAX_LENGTH, bufLen);
+  const uint8_t *p = bptr + 1;
+  for(uint8_t i = 1; i < ml; ++i)
+    {
+    const uint8_t c = *p++;
+    crc = crc7Update(crc, c);
+#if defined(ALLOW_RAW_JSON_RX)
+    // As the library, accept an unmarked unprotected '}' only where explicitly allowed.
+    if(('}' == c) && ('\0' == *p)) { return((int8_t)(i+1)); }
+#endif
+    if((('}' | 0x80) == c) && ((crc == *p) || ((0 == crc) && (0x80 == *p)))) { return((int8_t)(i+1)); }
+    if((c < 32) || (c > 126)) { return(OTV0P2BASE::checkJSONMsgRXCRC_ERR); }
+    }
+  return(OTV0P2BASE::checkJSONMsgRXCRC_ERR);
+  }
+#endif // ENABLE_CRC7_TABLE
+
+#if defined(ENABLE_KEY_CACHE) && (defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON))
+// RAM copy of the primary building key, valid iff keyCacheValid.
+static uint8_t keyCache[16];
+static bool keyCacheValid;
+// Get the 16-byte primary building key into key, from the RAM copy after the first successful read.
+// An unset key is not cached, so setting one is picked up promptly even without a wipe.
+bool getPrimaryBuildingKey(uint8_t *const key)
+  {
+  if(!keyCacheValid)
+    {
+    if(!OTV0P2BASE::getPrimaryBuilding16ByteSecretKey(keyCache)) { return(false); }
+    keyCacheValid = true;
+    }
+  memcpy(key, keyCache, sizeof(keyCache));
+  return(true);
+  }
+#endif // ENABLE_KEY_CACHE
+
+#if defined(ENABLE_GHASH_TABLE) && (defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON))
+static void ghashTableWipe();
+#endif
+#if defined(ENABLE_RX_DECRYPT_SESSION)
+static void rxSessionKeyWipe();
+#endif
+#if (defined(ENABLE_KEY_CACHE) || defined(ENABLE_GHASH_TABLE) || defined(ENABLE_RX_DECRYPT_SESSION)) && (defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON))
+// Wipe the RAM copies of the key and anything derived from it.
+void wipeKeyCache()
+  {
+#if defined(ENABLE_KEY_CACHE)
+  keyCacheValid = false;
+  // Volatile writes so that the wipe cannot be optimised away.
+  volatile uint8_t *p = keyCache;
+  for(uint8_t i = sizeof(keyCache); i-- > 0; ) { *p++ = 0; }
+#endif
+#if defined(ENABLE_GHASH_TABLE)
+  ghashTableWipe();
+#endif
+#if defined(ENABLE_RX_DECRYPT_SESSION)
+  // Any open session fetches the (possibly new) key again for its next frame.
+  rxSessionKeyWipe();
+#endif
+  }
+#endif
+
+#if defined(ENABLE_DUAL_RX_KEY)
+// RAM copy of the building key in use before the last K, valid iff rxPreviousKeyHours is non-zero.
+static uint8_t rxPreviousKey[16];
+// Hours left for which rxPreviousKey is accepted for RX; 0 if none.
+static uint8_t rxPreviousKeyHours;
+void retireBuildingKey()
+  {
+  if(!getPrimaryBuildingKey(rxPreviousKey)) { return; } // Nothing to keep.
+  rxPreviousKeyHours = DUAL_RX_KEY_HOLD_H;
+  }
+void noteBuildingKeyChanged()
+  {
+  if(0 == rxPreviousKeyHours) { return; }
+  // Drop the previous key if the K did not actually change it, or cleared it.
+  uint8_t key[16];
+  const bool same = !getPrimaryBuildingKey(key) || (0 == memcmp(key, rxPreviousKey, sizeof(key)));
+  memset(key, 0, sizeof(key));
+  if(same) { wipePreviousBuildingKey(); }
+  }
+void wipePreviousBuildingKey()
+  {
+  rxPreviousKeyHours = 0;
+  // Volatile writes so that the wipe cannot be optimised away.
+  volatile uint8_t *p = rxPreviousKey;
+  for(uint8_t i = sizeof(rxPreviousKey); i-- > 0; ) { *p++ = 0; }
+  }
+void previousBuildingKeyHourTick()
+  {
+  if((0 != rxPreviousKeyHours) && (0 == --rxPreviousKeyHours)) { wipePreviousBuildingKey(); }
+  }
+#endif // ENABLE_DUAL_RX_KEY
+
+#if (defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON)) && defined(ENABLE_TX_COUNTER_RESERVATION)
+// Factory method to get singleton instance.
+SimpleSecureFrame32or0BodyTXV0p2Reserved &SimpleSecureFrame32or0BodyTXV0p2Reserved::getInstance()
+  {
+  // Create/initialise on first use, NOT statically.
+  static SimpleSecureFrame32or0BodyTXV0p2Reserved instance;
+  return(instance);
+  }
+
+// Take the next boot slot, starting a new block if need be; returns false on failure.
+// Safe against power loss at any point: the restart counter is advanced before the bitmap is erased
+// and the bitmap is only marked as belonging to it after that,
+// and a slot is never used until its bit is seen cleared in EEPROM.
+bool SimpleSecureFrame32or0BodyTXV0p2Reserved::reserveBootSlot()
+  {
+  uint8_t r[3];
+  if(!get3BytePersistentTXRestartCounter(r)) { return(false); }
+  bool sameBlock = true;
+  for(uint8_t i = 0; i < 3; ++i)
+    { if(r[i] != (uint8_t)~eeprom_read_byte((uint8_t *)V0P2_EE_START_TX_CTR_BLOCK + i)) { sameBlock = false; } }
+  // Count slots used, ie cleared bits, which must be in order from the first; anything else counts as full.
+  uint8_t k = 0;
+  for(uint8_t i = 0; sameBlock && (i < V0P2_EE_LEN_TX_CTR_BITMAP); ++i)
+    {
+    const uint8_t b = eeprom_read_byte((uint8_t *)V0P2_EE_START_TX_CTR_BITMAP + i);
+    if(0 == b) { k += 8; continue; }
+    uint8_t used = 0;
+    while((used < 8) && (0 == (b & (0x80 >> used)))) { ++used; }
+    if((uint8_t)(0xff >> used) != b) { k = TX_CTR_BOOTS_PER_BLOCK; break; } // Malformed.
+    k += used;
+    // All further bytes must be unused.
+    for(uint8_t j = i + 1; j < V0P2_EE_LEN_TX_CTR_BITMAP; ++j)
+      { if(0xff != eeprom_read_byte((uint8_t *)V0P2_EE_START_TX_CTR_BITMAP + j)) { k = TX_CTR_BOOTS_PER_BLOCK; } }
+    break;
+    }
+  if(!sameBlock || (k >= TX_CTR_BOOTS_PER_BLOCK))
+    {
+    // Start a new block.
+    if(!increment3BytePersistentTXRestartCounter()) { return(false); }
+    if(!get3BytePersistentTXRestartCounter(r)) { return(false); }
+    for(uint8_t i = 0; i < V0P2_EE_LEN_TX_CTR_BITMAP; ++i)
+      {
+      uint8_t *const p = (uint8_t *)V0P2_EE_START_TX_CTR_BITMAP + i;
+      eeEraseByte(EEW_TXCTR, p);
+      if(0xff != eeprom_read_byte(p)) { return(false); }
+      }
+    for(uint8_t i = 0; i < 3; ++i)
+      {
+      uint8_t *const p = (uint8_t *)V0P2_EE_START_TX_CTR_BLOCK + i;
+      eeUpdateByte(EEW_TXCTR, p, (uint8_t)~r[i]);
+      if((uint8_t)~r[i] != eeprom_read_byte(p)) { return(false); }
+      }
+    k = 0;
+    }
+  // Take slot k.
+  uint8_t *const p = (uint8_t *)V0P2_EE_START_TX_CTR_BITMAP + (k >> 3);
+  const uint8_t bit = 0x80 >> (k & 7);
+  eeClearBits(EEW_TXCTR, p, (uint8_t)~bit);
+  if(0 != (eeprom_read_byte(p) & bit)) { return(false); }
+  memcpy(restartCounter, r, sizeof(restartCounter));
+  // Start the count from 14 bits of entropy, leaving 16x headroom before the slot runs out.
+  // Doesn't like being called with interrupts off.
+  ephemeral[0] = k << 2;
+  ephemeral[1] = 0x3f & OTV0P2BASE::getSecureRandomByte();
+  ephemeral[2] = OTV0P2BASE::getSecureRandomByte();
+  return(true);
+  }
+
+// Fills the supplied 6-byte array with the incremented monotonically-increasing primary TX counter.
+// Returns true on success; false on failure, eg because no boot slot could be reserved.
+// Not ISR-safe.
+bool SimpleSecureFrame32or0BodyTXV0p2Reserved::incrementAndGetPrimarySecure6BytePersistentTXMessageCounter(uint8_t *const buf)
+  {
+  if(NULL == buf) { return(false); }
+  // VITAL FOR CIPHER SECURITY: take a fresh boot slot before first use after (re)boot.
+  if(!reserved)
+    {
+    if(!reserveBootSlot()) { return(false); }
+    reserved = true;
+    }
+  // Increment the 18-bit count, and if it carries into the boot index take another slot instead.
+  if((0 == ++ephemeral[2]) && (0 == ++ephemeral[1]) && (0 == (++ephemeral[0] & 3)))
+    {
+    reserved = false;
+    if(!reserveBootSlot()) { return(false); }
+    reserved = true;
+    }
+  memcpy(buf, restartCounter, 3);
+  memcpy(buf + 3, ephemeral, 3);
+  return(true);
+  }
+
+// Reset or advance the restart counter as the library does, then take a new boot slot on the next TX.
+bool resetSecureTXRestartCounterCond()
+  {
+  const bool result = OTRadioLink::SimpleSecureFrame32or0BodyTXV0p2::resetRaw3BytePersistentTXRestartCounterCond();
+  SimpleSecureFrame32or0BodyTXV0p2Reserved::getInstance().restartCounterChanged();
+  return(result);
+  }
+#endif // ENABLE_TX_COUNTER_RESERVATION
+
+#if defined(ENABLE_FAST_AES128) && (defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON))
+// Faster drop-in AES-128 block encryption core for OTAESGCM's GCM (which needs no block decryption).
+// Byte-oriented with no T-tables, so only the 256-byte S-box is needed, in Flash.
+// The key schedule is expanded on the fly one round key at a time, so only 32 bytes of stack
+// are used for state and round key rather than the default's 176-byte expanded key,
+// and the loop counters and indices are all 8-bit.
+// ShiftRows is folded into SubBytes, and xtime() has no data-dependent branch.
+// Neither re-entrant nor ISR-safe.
+static const uint8_t aesSbox[256] PROGMEM =
+  {
+  0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+  0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+  0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+  0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+  0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+  0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+  0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+  0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+  0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+  0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+  0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+  0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+  0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+  0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+  0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+  0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+  };
+static inline uint8_t aesSub(const uint8_t x) { return(pgm_read_byte(aesSbox + x)); }
+// Multiply by x (ie 2) in GF(2^8).
+static inline uint8_t aesXtime(const uint8_t x) { return((uint8_t)((x << 1) ^ ((uint8_t)-(x >> 7) & 0x1b))); }
+class OTAES128E_V0p2Fast final : public OTAESGCM::OTAES128E
+  {
+  public:
+    virtual void blockEncrypt(const uint8_t *const input, const uint8_t *const key, uint8_t *const output) override
+      {
+      // State and round key, column-major as in FIPS-197, ie s[4*column + row].
+      uint8_t s[16];
+      uint8_t k[16];
+      for(uint8_t i = 0; i < 16; ++i) { s[i] = input[i] ^ (k[i] = key[i]); }
+      uint8_t rcon = 1;
+      for(uint8_t round = 1; ; ++round)
+        {
+        // SubBytes and ShiftRows together: row r rotates left by r.
+        uint8_t t;
+        s[0] = aesSub(s[0]); s[4] = aesSub(s[4]); s[8] = aesSub(s[8]); s[12] = aesSub(s[12]);
+        t = s[1]; s[1] = aesSub(s[5]); s[5] = aesSub(s[9]); s[9] = aesSub(s[13]); s[13] = aesSub(t);
+        t = s[2]; s[2] = aesSub(s[10]); s[10] = aesSub(t);
+        t = s[6]; s[6] = aesSub(s[14]); s[14] = aesSub(t);
+        t = s[15]; s[15] = aesSub(s[11]); s[11] = aesSub(s[7]); s[7] = aesSub(s[3]); s[3] = aesSub(t);
+        // Next round key in place.
+        k[0] ^= aesSub(k[13]) ^ rcon; k[1] ^= aesSub(k[14]); k[2] ^= aesSub(k[15]); k[3] ^= aesSub(k[12]);
+        for(uint8_t i = 4; i < 16; ++i) { k[i] ^= k[i-4]; }
+        if(10 == round) { break; }
+        rcon = aesXtime(rcon);
+        // MixColumns.
+        for(uint8_t *c = s; c < s + 16; c += 4)
+          {
+          const uint8_t a0 = c[0], a1 = c[1], a2 = c[2], a3 = c[3];
+          const uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+          c[0] = a0 ^ all ^ aesXtime(a0 ^ a1);
+          c[1] = a1 ^ all ^ aesXtime(a1 ^ a2);
+          c[2] = a2 ^ all ^ aesXtime(a2 ^ a3);
+          c[3] = a3 ^ all ^ aesXtime(a3 ^ a0);
+          }
+        for(uint8_t i = 0; i < 16; ++i) { s[i] ^= k[i]; }
+        }
+      for(uint8_t i = 0; i < 16; ++i) { output[i] = s[i] ^ k[i]; }
+      // Volatile writes so that the wipe of key material cannot be optimised away.
+      volatile uint8_t *p = k;
+      for(uint8_t i = sizeof(k); i-- > 0; ) { *p++ = 0; }
+      }
+  };
+
+// As OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleEnc_DEFAULT_STATELESS() but with the faster AES core.
+bool fixed32BTextSize12BNonce16BTagSimpleEnc_FAST_STATELESS(void *const,
+    const uint8_t *const key, const uint8_t *const iv,
+    const uint8_t *const authtext, const uint8_t authtextSize,
+    const uint8_t *const plaintext,
+    uint8_t *const ciphertextOut, uint8_t *const tagOut)
+  {
+  if((NULL == key) || (NULL == iv) || (NULL == ciphertextOut) || (NULL == tagOut)) { return(false); } // ERROR
+  OTAESGCM::OTAES128GCMGeneric<OTAES128E_V0p2Fast> i;
+  return(i.gcmEncrypt(key, iv, plaintext, (NULL == plaintext) ? 0 : 32, (0 == authtextSize) ? NULL : authtext, authtextSize, ciphertextOut, tagOut));
+  }
+
+// As OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleDec_DEFAULT_STATELESS() but with the faster AES core.
+bool fixed32BTextSize12BNonce16BTagSimpleDec_FAST_STATELESS(void *const,
+    const uint8_t *const key, const uint8_t *const iv,
+    const uint8_t *const authtext, const uint8_t authtextSize,
+    const uint8_t *const ciphertext, const uint8_t *const tag,
+    uint8_t *const plaintextOut)
+  {
+  if((NULL == key) || (NULL == iv) || (NULL == tag) || (NULL == plaintextOut)) { return(false); } // ERROR
+  OTAESGCM::OTAES128GCMGeneric<OTAES128E_V0p2Fast> i;
+  return(i.gcmDecrypt(key, iv, ciphertext, (NULL == ciphertext) ? 0 : 32, (0 == authtextSize) ? NULL : authtext, authtextSize, tag, plaintextOut));
+  }
+#endif // ENABLE_FAST_AES128
+
+#if defined(ENABLE_GHASH_TABLE) && (defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON))
+// AES-GCM with table-driven GHASH, for hubs authenticating many frames under one building key.
+// Shoup's 4-bit method: with ghashM[n] = n.H (n a 4-bit value in GCM bit order)
+// each multiply by the hash subkey H takes 32 nibble lookups
+// rather than OTAESGCM's 128 bit-serial shift-and-conditional-adds.
+// The 256-byte table is computed for a key when first used with it, and kept with a copy of that key,
+// so a change of key costs one rebuild and all other (RX or TX) frames skip computing H too.
+// With ENABLE_DUAL_RX_KEY the table is never built for the previous key, whose frames take the slower generic path,
+// so senders alternating between the keys do not make it rebuild on every frame.
+static uint8_t ghashM[16][16];
+static uint8_t ghashKey[16]; // Key that ghashM is for, iff ghashKeyValid.
+static bool ghashKeyValid;
+// Reduction for the 4 bits shifted off the low end, as the top 16 bits to xor in.
+static const uint16_t ghashLast4[16] PROGMEM =
+  {
+  0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+  0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0,
+  };
+// Wipe the table and key copy.
+static void ghashTableWipe()
+  {
+  ghashKeyValid = false;
+  // Volatile writes so that the wipe cannot be optimised away.
+  volatile uint8_t *p = ghashKey;
+  for(uint8_t i = sizeof(ghashKey); i-- > 0; ) { *p++ = 0; }
+  p = &ghashM[0][0];
+  for(uint16_t i = sizeof(ghashM); i-- > 0; ) { *p++ = 0; }
+  }
+// Ensure that ghashM is for the given key, (re)computing it if not.
+static void ghashSetKey(OTAES128E_V0p2Fast &aes, const uint8_t *const key)
+  {
+  if(ghashKeyValid)
+    {
+    uint8_t diff = 0;
+    for(uint8_t i = 0; i < 16; ++i) { diff |= ghashKey[i] ^ key[i]; }
+    if(0 == diff) { return; }
+    }
+  // H = E(K, 0^128) into ghashM[8]; ghashM[4], [2], [1] are successive halvings (multiplies by x).
+  memset(ghashM, 0, sizeof(ghashM));
+  aes.blockEncrypt(ghashM[0], key, ghashM[8]);
+  for(uint8_t n = 4; n > 0; n >>= 1)
+    {
+    const uint8_t *const v = ghashM[n << 1];
+    uint8_t *const m = ghashM[n];
+    for(uint8_t i = 15; i > 0; --i) { m[i] = (uint8_t)((v[i] >> 1) | (v[i-1] << 7)); }
+    m[0] = (uint8_t)((v[0] >> 1) ^ ((uint8_t)-(v[15] & 1) & 0xe1));
+    }
+  // The rest by linearity.
+  for(uint8_t n = 2; n < 16; n <<= 1)
+    {
+    for(uint8_t j = 1; j < n; ++j)
+      { for(uint8_t i = 0; i < 16; ++i) { ghashM[n+j][i] = ghashM[n][i] ^ ghashM[j][i]; } }
+    }
+  memcpy(ghashKey, key, sizeof(ghashKey));
+  ghashKeyValid = true;
+  }
+// Fold len (<= 16) bytes of data into the GHASH accumulator y, ie y = (y ^ data).H.
+static void ghashBlock(uint8_t *const y, const uint8_t *const data, const uint8_t len)
+  {
+  for(uint8_t i = 0; i < len; ++i) { y[i] ^= data[i]; }
+  uint8_t z[16];
+  memset(z, 0, sizeof(z));
+  for(uint8_t i = 16; i-- > 0; )
+    {
+    // Low nibble then high nibble, each time shifting z along by 4 bits and reducing.
+    for(uint8_t nib = y[i], k = 2; k > 0; --k, nib >>= 4)
+      {
+      const uint16_t r = pgm_read_word(ghashLast4 + (z[15] & 0xf));
+      for(uint8_t j = 15; j > 0; --j) { z[j] = (uint8_t)((z[j] >> 4) | (z[j-1] << 4)); }
+      z[0] = (uint8_t)((z[0] >> 4) ^ (r >> 8));
+      z[1] ^= (uint8_t)r;
+      const uint8_t *const m = ghashM[nib & 0xf];
+      for(uint8_t j = 0; j < 16; ++j) { z[j] ^= m[j]; }
+      }
+    }
+  memcpy(y, z, sizeof(z));
+  }
+// AES-GCM over textLen (a multiple of 16) bytes of text and authtextSize bytes of authtext.
+// Computes the tag over the ciphertext, ie over the input when decrypting and the output when encrypting,
+// so textOut may be the same as textIn.
+// Encryption writes the tag to tagOut; decryption compares it with tagIn and only writes textOut if it matches.
+// Returns false if there is nothing to encrypt or authenticate, or if decryption fails to authenticate.
+static bool gcmTable(const bool decrypt, const uint8_t *const key, const uint8_t *const iv,
+    const uint8_t *const authtext, const uint8_t authtextSize,
+    const uint8_t *const textIn, const uint8_t textLen, uint8_t *const textOut,
+    const uint8_t *const tagIn, uint8_t *const tagOut)
+  {
+  if((0 == textLen) && (0 == authtextSize)) { return(false); }
+#if defined(ENABLE_DUAL_RX_KEY)
+  if(0 != rxPreviousKeyHours)
+    {
+    uint8_t diff = 0;
+    for(uint8_t i = 0; i < 16; ++i) { diff |= rxPreviousKey[i] ^ key[i]; }
+    if(0 == diff)
+      {
+      OTAESGCM::OTAES128GCMGeneric<OTAES128E_V0p2Fast> i;
+      if(decrypt) { return(i.gcmDecrypt(key, iv, textIn, textLen, authtext, authtextSize, tagIn, textOut)); }
+      return(i.gcmEncrypt(key, iv, textIn, textLen, authtext, authtextSize, textOut, tagOut));
+      }
+    }
+#endif // ENABLE_DUAL_RX_KEY
+  OTAES128E_V0p2Fast aes;
+  ghashSetKey(aes, key);
+  uint8_t y[16];
+  memset(y, 0, sizeof(y));
+  for(uint8_t i = 0; i < authtextSize; i += 16)
+    { ghashBlock(y, authtext + i, ((authtextSize - i) < 16) ? (authtextSize - i) : 16); }
+  if(decrypt) { for(uint8_t i = 0; i < textLen; i += 16) { ghashBlock(y, textIn + i, 16); } }
+  // Counter blocks from J0 = IV || 0^31 || 1.
+  uint8_t cb[16];
+  uint8_t ks[16];
+  memcpy(cb, iv, 12);
+  cb[12] = 0; cb[13] = 0; cb[14] = 0;
+  if(!decrypt)
+    {
+    for(uint8_t i = 0; i < textLen; i += 16)
+      {
+      cb[15] = 2 + (i >> 4);
+      aes.blockEncrypt(cb, key, ks);
+      for(uint8_t j = 0; j < 16; ++j) { textOut[i+j] = textIn[i+j] ^ ks[j]; }
+      ghashBlock(y, textOut + i, 16);
+      }
+    }
+  // Bit lengths of authtext and text, as two 64-bit big-endian values.
+  uint8_t lens[16];
+  memset(lens, 0, sizeof(lens));
+  lens[6] = authtextSize >> 5; lens[7] = (uint8_t)(authtextSize << 3);
+  lens[14] = textLen >> 5; lens[15] = (uint8_t)(textLen << 3);
+  ghashBlock(y, lens, 16);
+  cb[15] = 1;
+  aes.blockEncrypt(cb, key, ks);
+  if(!decrypt)
+    {
+    for(uint8_t j = 0; j < 16; ++j) { tagOut[j] = y[j] ^ ks[j]; }
+    return(true);
+    }
+  // Constant-time tag check.
+  uint8_t diff = 0;
+  for(uint8_t j = 0; j < 16; ++j) { diff |= tagIn[j] ^ y[j] ^ ks[j]; }
+  if(0 != diff) { return(false); }
+  for(uint8_t i = 0; i < textLen; i += 16)
+    {
+    cb[15] = 2 + (i >> 4);
+    aes.blockEncrypt(cb, key, ks);
+    for(uint8_t j = 0; j < 16; ++j) { textOut[i+j] = textIn[i+j] ^ ks[j]; }
+    }
+  return(true);
+  }
+
+// As OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleEnc_DEFAULT_STATELESS() but with table GHASH.
+bool fixed32BTextSize12BNonce16BTagSimpleEnc_TABLE(void *const,
+    const uint8_t *const key, const uint8_t *const iv,
+    const uint8_t *const authtext, const uint8_t authtextSize,
+    const uint8_t *const plaintext,
+    uint8_t *const ciphertextOut, uint8_t *const tagOut)
+  {
+  if((NULL == key) || (NULL == iv) || (NULL == ciphertextOut) || (NULL == tagOut)) { return(false); } // ERROR
+  return(gcmTable(false, key, iv, authtext, authtextSize, plaintext, (NULL == plaintext) ? 0 : 32, ciphertextOut, NULL, tagOut));
+  }
+
+// As OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleDec_DEFAULT_STATELESS() but with table GHASH.
+bool fixed32BTextSize12BNonce16BTagSimpleDec_TABLE(void *const,
+    const uint8_t *const key, const uint8_t *const iv,
+    const uint8_t *const authtext, const uint8_t authtextSize,
+    const uint8_t *const ciphertext, const uint8_t *const tag,
+    uint8_t *const plaintextOut)
+  {
+  if((NULL == key) || (NULL == iv) || (NULL == tag) || (NULL == plaintextOut)) { return(false); } // ERROR
+  return(gcmTable(true, key, iv, authtext, authtextSize, ciphertext, (NULL == ciphertext) ? 0 : 32, plaintextOut, tag, NULL));
+  }
+#endif // ENABLE_GHASH_TABLE
+
+#if defined(ENABLE_FAST_AES128) && (defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON))
+// Published AES-GCM known answer: Test Case 3 from McGrew and Viega, "The Galois/Counter Mode of Operation (GCM)",
+// also among NIST's GCM validation vectors; 128-bit key, 96-bit IV, 64 bytes of text, no authtext.
+static const uint8_t gcmKATKey[16] PROGMEM =
+  {
+  0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+  };
+static const uint8_t gcmKATIV[12] PROGMEM =
+  {
+  0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88,
+  };
+static const uint8_t gcmKATPlaintext[64] PROGMEM =
+  {
+  0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5, 0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+  0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda, 0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+  0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+  0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57, 0xba, 0x63, 0x7b, 0x39, 0x1a, 0xaf, 0xd2, 0x55,
+  };
+static const uint8_t gcmKATCiphertext[64] PROGMEM =
+  {
+  0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24, 0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+  0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0, 0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+  0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c, 0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+  0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97, 0x3d, 0x58, 0xe0, 0x91, 0x47, 0x3f, 0x59, 0x85,
+  };
+static const uint8_t gcmKATTag[16] PROGMEM =
+  {
+  0x4d, 0x5c, 0x2a, 0xf3, 0x27, 0xcd, 0x64, 0xa6, 0x2c, 0xf3, 0x5a, 0xbd, 0x2b, 0xa6, 0xfa, 0xb4,
+  };
+bool secureFrameKAT()
+  {
+  uint8_t key[16], iv[12], plain[64], cipher[64], tag[16];
+  memcpy_P(key, gcmKATKey, sizeof(key));
+  memcpy_P(iv, gcmKATIV, sizeof(iv));
+  memcpy_P(plain, gcmKATPlaintext, sizeof(plain));
+  bool ok;
+  {
+  // The fast AES core under the library's GCM.
+  OTAESGCM::OTAES128GCMGeneric<OTAES128E_V0p2Fast> i;
+  ok = i.gcmEncrypt(key, iv, plain, sizeof(plain), NULL, 0, cipher, tag) &&
+       (0 == memcmp_P(cipher, gcmKATCiphertext, sizeof(cipher))) && (0 == memcmp_P(tag, gcmKATTag, sizeof(tag)));
+  memset(plain, 0, sizeof(plain));
+  ok = ok && i.gcmDecrypt(key, iv, cipher, sizeof(cipher), NULL, 0, tag, plain) &&
+       (0 == memcmp_P(plain, gcmKATPlaintext, sizeof(plain)));
+  }
+#if defined(ENABLE_GHASH_TABLE)
+  // The table GHASH path, which builds its table for the test key; wiped afterwards.
+  memset(cipher, 0, sizeof(cipher));
+  ok = ok && gcmTable(false, key, iv, NULL, 0, plain, sizeof(plain), cipher, NULL, tag) &&
+       (0 == memcmp_P(cipher, gcmKATCiphertext, sizeof(cipher))) && (0 == memcmp_P(tag, gcmKATTag, sizeof(tag)));
+  memset(plain, 0, sizeof(plain));
+  ok = ok && gcmTable(true, key, iv, NULL, 0, cipher, sizeof(cipher), plain, tag, NULL) &&
+       (0 == memcmp_P(plain, gcmKATPlaintext, sizeof(plain)));
+  ghashTableWipe();
+#endif // ENABLE_GHASH_TABLE
+  return(ok);
+  }
+#endif // ENABLE_FAST_AES128
+
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME)
+// AES-GCM over the single-block body of a short valve frame, which the library's fixed 32-byte helpers cannot handle.
+// Encryption writes the ciphertext to textOut and the tag to tagOut;
+// decryption writes textOut and returns true only if tagIn authenticates.
+static bool valveShortFrameGCM(const bool decrypt, const uint8_t *const key, const uint8_t *const iv,
+    const uint8_t *const authtext, const uint8_t authtextSize,
+    const uint8_t *const textIn, uint8_t *const textOut,
+    const uint8_t *const tagIn, uint8_t *const tagOut)
+  {
+#if defined(ENABLE_GHASH_TABLE)
+  return(gcmTable(decrypt, key, iv, authtext, authtextSize, textIn, VALVE_SHORT_FRAME_BODY_SIZE, textOut, tagIn, tagOut));
+#else
+#if defined(ENABLE_FAST_AES128)
+  OTAESGCM::OTAES128GCMGeneric<OTAES128E_V0p2Fast> i;
+#else
+  OTAESGCM::OTAES128GCMGeneric<> i;
+#endif
+  if(decrypt) { return(i.gcmDecrypt(key, iv, textIn, VALVE_SHORT_FRAME_BODY_SIZE, authtext, authtextSize, tagIn, textOut)); }
+  return(i.gcmEncrypt(key, iv, textIn, VALVE_SHORT_FRAME_BODY_SIZE, authtext, authtextSize, textOut, tagOut));
+#endif // ENABLE_GHASH_TABLE
+  }
+
+#if defined(ENABLE_NOMINAL_RAD_VALVE)
+// Valve % last reported in a full or short frame; 0xff (never a valid valve %) until the first.
+static uint8_t valveShortFrameLastPC = 0xff;
+void noteValvePCReported(const uint8_t valvePC) { valveShortFrameLastPC = valvePC; }
+#if defined(ENABLE_TX_PENDING_QUEUE) && !defined(ENABLE_SECURE_TX_ACK)
+// Retry a short frame that failed to send, with the current valve % and a fresh message counter.
+static void valveShortFrameRetry() { valveShortFrameTX(); }
+#endif
+bool valveShortFrameTX()
+  {
+  const uint8_t valvePC = callForHeatValvePC();
+  if(valvePC == valveShortFrameLastPC) { return(false); }
+  uint8_t key[16];
+  if(!getPrimaryBuildingKey(key)) { return(false); }
+  // As the library's encodeSecureSmallFrameRaw() but with the short body:
+  // the header (authenticated but not encrypted), the encrypted body,
+  // then the trailer of the 6 message counter bytes from the IV, the 16-byte tag and the 0x80 format byte.
+  constexpr uint8_t il = OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES;
+  static_assert(il <= 6, "ID taken from the IV");
+  uint8_t buf[4 + il + VALVE_SHORT_FRAME_BODY_SIZE + SECURE_FRAME_0X80_TRAILER_BYTES];
+  uint8_t iv[12];
+  if(!secureTX().compute12ByteIDAndCounterIVForTX(iv)) { return(false); }
+  OTRadioLink::SecurableFrameHeader sfh;
+  const uint8_t hl = sfh.checkAndEncodeSmallFrameHeader(buf, sizeof(buf),
+        true, (OTRadioLink::FrameType_Secureable)FTS_VALVE_SHORT_LOCAL,
+        iv[11] & 0xf, iv, il,
+        VALVE_SHORT_FRAME_BODY_SIZE, SECURE_FRAME_0X80_TRAILER_BYTES);
+  if(0 == hl) { return(false); }
+  const uint8_t fl = sfh.fl;
+  uint8_t body[VALVE_SHORT_FRAME_BODY_SIZE];
+  memset(body, 0, sizeof(body));
+  body[0] = valvePC;
+  body[1] = 0; // No stats.
+  body[VALVE_SHORT_FRAME_BODY_SIZE - 1] = VALVE_SHORT_FRAME_BODY_SIZE - 3;
+  bool ok;
+  {
+  const CPUClockBoost boost;
+  ok = valveShortFrameGCM(false, key, iv, buf, hl, body, buf + hl, NULL, buf + fl - SECURE_FRAME_TAG_BYTES);
+  }
+  // DO NOT attempt to send if the secure frame could not be built (risks IV reuse).
+  if(!ok) { return(false); }
+  memcpy(buf + sfh.getTrailerOffset(), iv + 6, OTRadioLink::SimpleSecureFrame32or0BodyBase::fullMessageCounterBytes);
+  buf[fl] = 0x80;
+  // ASSUME FRAMED CHANNEL 0, so do not send the leading length byte.
+  // Sent only on a change in call for heat, so may use the TX duty-cycle reserve.
+  const TXDutyCritical critical;
+#if defined(ENABLE_SECURE_TX_ACK)
+  ok = primaryRadioSendAcked(buf+1, fl);
+#elif defined(ENABLE_TX_PENDING_QUEUE)
+  ok = primaryRadioSendOrHold(TXC_VALVE, buf+1, fl, primaryRadioChannel(), OTRadioLink::OTRadioLink::TXnormal, valveShortFrameRetry);
+#else
+  ENERGY_ACCOUNT(EA_TX, ok = PrimaryRadio.sendRaw(buf+1, fl, primaryRadioChannel()));
+#endif
+  if(ok) { valveShortFrameLastPC = valvePC; }
+  return(ok);
+  }
+#endif // ENABLE_NOMINAL_RAD_VALVE
+#endif // ENABLE_SECURE_VALVE_SHORT_FRAME
+
+#if (defined(ENABLE_BINARY_SERIAL_OUTPUT) && defined(ENABLE_RADIO_RX)) || defined(ENABLE_BULK_STATS_EXPORT) || defined(ENABLE_VALVE_MOVE_LOG) || (defined(ENABLE_RX_FRAME_CAPTURE) && defined(ENABLE_RADIO_RX)) || (defined(ENABLE_BINARY_STATUS_RECORD) && defined(ENABLE_SERIAL_STATUS_REPORT))
+// Compact binary output of received frames to the host, much shorter on the wire than JSON text.
+// Each record is SLIP (RFC 1055) framed, with END before and after:
+//   type, idLen, id[idLen], seq, payload..., crc
+// where crc is crc7_5B (initialised to 0x7f) over all preceding record bytes, and the types are:
+//   'O' secure frame: 8-byte sender ID, frame seq, payload is the whole decrypted body
+//   'J' raw JSON frame: no ID, seq 0, payload is the JSON text with plain '}' terminator
+//   'F' FS20/binary stats frame: 2-byte house code ID (if known), seq 0, payload is the raw frame
+//   'X' bulk stats export chunk (+EXP): 2-byte node ID prefix, chunk number, payload is 2-byte offset then data
+//   'V' valve movement event (+VML): 2-byte node ID prefix, event seq, payload is the 6-byte event
+//   'R' raw RX frame (ENABLE_RX_FRAME_CAPTURE): no ID, seq is the sub-cycle time,
+//       payload is 2-byte minutes since midnight, seconds, then the frame as queued (without length)
+//   'S' status (ENABLE_BINARY_STATUS_RECORD): 2-byte node ID prefix, rolling seq, payload is 12 fixed bytes
+//       (see serialStatusReport() in V0p2_Main.cpp)
+// util/v0p2_binary_serial_decode.py is a reference host-side decoder.
+static constexpr uint8_t SLIP_END = 0xc0;
+static constexpr uint8_t SLIP_ESC = 0xdb;
+static constexpr uint8_t SLIP_ESC_END = 0xdc;
+static constexpr uint8_t SLIP_ESC_ESC = 0xdd;
+static uint8_t binRecCRC;
+// Write one byte SLIP-escaped.
+static void binRecWriteEsc(const uint8_t b)
+  {
+  if(SLIP_END == b) { Serial.write(SLIP_ESC); Serial.write(SLIP_ESC_END); }
+  else if(SLIP_ESC == b) { Serial.write(SLIP_ESC); Serial.write(SLIP_ESC_ESC); }
+  else { Serial.write(b); }
+  }
+// Write one record byte, including it in the CRC.
+static void binRecPut(const uint8_t b) { binRecCRC = crc7Update(binRecCRC, b); binRecWriteEsc(b); }
+// Write payload bytes.
+void binRecPut(const uint8_t *const buf, const uint8_t len) { for(uint8_t i = 0; i < len; ++i) { binRecPut(buf[i]); } }
+// Start a record; id may be NULL iff idLen is 0.
+void binRecStart(const uint8_t type, const uint8_t *const id, const uint8_t idLen, const uint8_t seq)
+  {
+  Serial.write(SLIP_END);
+  binRecCRC = 0x7f;
+  binRecPut(type);
+  binRecPut(idLen);
+  binRecPut(id, idLen);
+  binRecPut(seq);
+  }
+// Finish a record.
+void binRecEnd()
+  {
+  binRecWriteEsc(binRecCRC);
+  Serial.write(SLIP_END);
+  OTV0P2BASE::flushSerialProductive();
+  }
+#if defined(ENABLE_BINARY_SERIAL_OUTPUT) && defined(ENABLE_RADIO_RX)
+// Write FS20/binary stats frame as a complete record, with the house code if known.
+static void binRecFS20(const uint8_t *const msg, const uint8_t msglen, const bool hasID, const uint8_t id0, const uint8_t id1)
+  {
+  const uint8_t id[2] = { id0, id1 };
+  binRecStart('F', id, hasID ? 2 : 0, 0);
+  binRecPut(msg, msglen);
+  binRecEnd();
+  }
+#endif // ENABLE_BINARY_SERIAL_OUTPUT
+#if defined(ENABLE_RX_FRAME_CAPTURE) && defined(ENABLE_RADIO_RX)
+// Write a raw received frame as an 'R' record, timestamped to the sub-cycle tick.
+static void binRecCaptureRX(const uint8_t *const msg, const uint8_t msglen)
+  {
+  const uint_least16_t msm = OTV0P2BASE::getMinutesSinceMidnightLT();
+  const uint8_t ts[3] = { (uint8_t)(msm >> 8), (uint8_t)msm, (uint8_t)OTV0P2BASE::getSecondsLT() };
+  binRecStart('R', NULL, 0, OTV0P2BASE::getSubCycleTime());
+  binRecPut(ts, sizeof(ts));
+  binRecPut(msg, msglen);
+  binRecEnd();
+  }
+#endif // ENABLE_RX_FRAME_CAPTURE
+#endif // ENABLE_BINARY_SERIAL_OUTPUT || ENABLE_BULK_STATS_EXPORT || ENABLE_VALVE_MOVE_LOG || ENABLE_RX_FRAME_CAPTURE
+
 #ifdef ENABLE_RADIO_SIM900
 //For EEPROM: TODO make a spec for how config should be stored in EEPROM to make changing them easy
 //- Set the first field of SIM900LinkConfig to true.
@@ -65,27 +774,414 @@ static const char SIM900_APN[] PROGMEM      = "\"mobiledata\""; // GeoSIM
 OTRadioLink::OTNullRadioLink NullRadio;
 #endif
 
-// Brings in necessary radio libs.
-#ifdef ENABLE_RADIO_RFM23B
-#if defined(ENABLE_TRIMMED_MEMORY) && !defined(ENABLE_DEFAULT_ALWAYS_RX) && !defined(ENABLE_CONTINUOUS_RX)
-static constexpr uint8_t RFM23B_RX_QUEUE_SIZE = OTV0P2BASE::fnmax(uint8_t(2), uint8_t(OTRFM23BLink::DEFAULT_RFM23B_RX_QUEUE_CAPACITY)) - 1;
+#if defined(ENABLE_RELAY_BATCHING) && defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+#ifndef RELAY_BATCH_MAX_BYTES
+#define RELAY_BATCH_MAX_BYTES 64 // Maximum single TX for OTSIM900Link.
+#endif
+// First byte of each batch send, ahead of the (len,frame...) entries, so that the server can tell
+// a batch from a single relayed frame (which starts with a secure frame length < 64 or '{') and its version.
+static constexpr uint8_t RELAY_BATCH_FORMAT_V1 = 0x81;
+#endif // ENABLE_RELAY_BATCHING
+
+#if defined(ENABLE_RELAY_BACKLOG)
+#ifndef RELAY_BACKLOG_BYTES
+#define RELAY_BACKLOG_BYTES 128
+#endif
+static constexpr uint8_t RELAY_BACKLOG_RETRY_MIN_TICKS = 4; // About the time for one SIM900 send.
+static constexpr uint8_t RELAY_BACKLOG_RETRY_MAX_TICKS = 128;
+static_assert(RELAY_BACKLOG_BYTES <= 255, "backlog too big");
+// Entries start one byte in so that a batch format byte can be put in front to send in place.
+static uint8_t relayBacklogTX[1 + RELAY_BACKLOG_BYTES];
+static uint8_t *const relayBacklog = relayBacklogTX + 1;
+static uint8_t relayBacklogLen;
+static uint8_t relayBacklogBackoff = RELAY_BACKLOG_RETRY_MIN_TICKS;
+// Main ticks to the next retry.
+static uint8_t relayBacklogWait;
+
+// Drop the first n bytes (whole entries) of the backlog.
+static void relayBacklogDrop(const uint8_t n)
+  {
+  relayBacklogLen -= n;
+  memmove(relayBacklog, relayBacklog + n, relayBacklogLen);
+  }
+
+// Make room for n more bytes, dropping the oldest entries; false if n can never fit.
+static bool relayBacklogRoom(const uint8_t n)
+  {
+  if(n > RELAY_BACKLOG_BYTES) { return(false); }
+  if(relayBacklogLen + n <= RELAY_BACKLOG_BYTES) { return(true); }
+  while(relayBacklogLen + n > RELAY_BACKLOG_BYTES) { relayBacklogDrop(1 + relayBacklog[0]); }
+  latencyRelayDropped(true); // The new frame at least is held.
+  return(true);
+  }
+
+// Send buf over the secondary radio unless refused or behind a backlog, else hold it:
+// if it is a batch (format byte then (len,frame...) entries) as its entries, else as one entry.
+static void relaySendOrHold(const uint8_t *const buf, const uint8_t buflen, const bool isBatch)
+  {
+  if((0 == relayBacklogLen) && deferredInitDone(DI_SECONDARY_RADIO) && SecondaryRadio.queueToSend(buf, buflen)) { latencyRelaySent(false); return; }
+  if(0 == relayBacklogLen) { relayBacklogBackoff = RELAY_BACKLOG_RETRY_MIN_TICKS; relayBacklogWait = relayBacklogBackoff; }
+  const uint8_t *const src = isBatch ? buf + 1 : buf;
+  const uint8_t srclen = isBatch ? (uint8_t)(buflen - 1) : buflen;
+  const uint8_t n = isBatch ? srclen : (uint8_t)(srclen + 1);
+  if(!relayBacklogRoom(n)) { latencyRelayDropped(0 != relayBacklogLen); return; }
+  if(!isBatch) { relayBacklog[relayBacklogLen++] = srclen; }
+  memcpy(relayBacklog + relayBacklogLen, src, srclen);
+  relayBacklogLen += srclen;
+  }
+
+void relayBacklogTick()
+  {
+  if(0 == relayBacklogLen) { return; }
+  if(0 != relayBacklogWait) { --relayBacklogWait; return; }
+  if(!deferredInitDone(DI_SECONDARY_RADIO)) { return; }
+#if defined(ENABLE_RELAY_BATCHING)
+  // As many whole entries as fit in one batch after its format byte.
+  uint8_t n = 0;
+  while((n < relayBacklogLen) && (n + 2 + relayBacklog[n] <= RELAY_BATCH_MAX_BYTES)) { n += 1 + relayBacklog[n]; }
+  relayBacklogTX[0] = RELAY_BATCH_FORMAT_V1;
+  const bool sent = SecondaryRadio.queueToSend(relayBacklogTX, n + 1);
 #else
-static constexpr uint8_t RFM23B_RX_QUEUE_SIZE = OTRFM23BLink::DEFAULT_RFM23B_RX_QUEUE_CAPACITY;
+  const uint8_t n = 1 + relayBacklog[0];
+  const bool sent = SecondaryRadio.queueToSend(relayBacklog + 1, n - 1);
 #endif
-#if defined(PIN_RFM_NIRQ)
-static constexpr int8_t RFM23B_IRQ_PIN = PIN_RFM_NIRQ;
+  if(sent) { relayBacklogDrop(n); latencyRelaySent(0 != relayBacklogLen); relayBacklogBackoff = RELAY_BACKLOG_RETRY_MIN_TICKS; }
+  else if(relayBacklogBackoff < RELAY_BACKLOG_RETRY_MAX_TICKS) { relayBacklogBackoff <<= 1; }
+  relayBacklogWait = relayBacklogBackoff;
+  }
+
+#if !defined(ENABLE_RELAY_BATCHING)
+void relayFrame(const uint8_t *const buf, const uint8_t buflen)
+  {
+  if(!profileHas(PROFILE_RELAY)) { return; }
+  latencyRelayTaken();
+  relaySendOrHold(buf, buflen, false);
+  }
+#endif
+#endif // ENABLE_RELAY_BACKLOG
+
+#if defined(ENABLE_RELAY_BATCHING) && defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+// Relay batching, to amortise per-datagram/session costs (eg GPRS) over several frames.
+// The batch is a RELAY_BATCH_FORMAT_V1 byte then a sequence of (len,frame...) entries that the server splits apart.
+#ifndef RELAY_BATCH_MAX_DELAY_S
+#define RELAY_BATCH_MAX_DELAY_S 60 // Maximum time a frame waits in a batch.
+#endif
+// Format byte then entries; relayBatchLen is 0 when empty, else includes the format byte.
+static uint8_t relayBatch[RELAY_BATCH_MAX_BYTES];
+static uint8_t relayBatchLen;
+// Minor cycles that the oldest frame in the batch has waited.
+static uint8_t relayBatchAge;
+static_assert(RELAY_BATCH_MAX_DELAY_S / OTV0P2BASE::MAIN_TICK_S < 255, "batch delay too long");
+
+// Send any batched frames; true if none are left.
+// If the secondary radio refuses the batch it is kept to retry (or moved to any backlog).
+static bool relayBatchFlush()
+  {
+  if(0 == relayBatchLen) { return(true); }
+#if defined(ENABLE_RELAY_BACKLOG)
+  relaySendOrHold(relayBatch, relayBatchLen, true);
 #else
-static constexpr int8_t RFM23B_IRQ_PIN = -1;
+  if(!deferredInitDone(DI_SECONDARY_RADIO) || !SecondaryRadio.queueToSend(relayBatch, relayBatchLen)) { return(false); }
+  latencyRelaySent(false);
+#endif
+  relayBatchLen = 0;
+  return(true);
+  }
+
+void relayFrame(const uint8_t *const buf, const uint8_t buflen)
+  {
+  if(!profileHas(PROFILE_RELAY)) { return; }
+  if(buflen > sizeof(relayBatch) - 2) { return; } // Can never fit.
+  if((0 != relayBatchLen) && (relayBatchLen + 1 + buflen > sizeof(relayBatch)) && !relayBatchFlush())
+    {
+    // Still refused: drop the held batch rather than the newer frame.
+    relayBatchLen = 0;
+    latencyRelayDropped(false);
+    }
+  latencyRelayTaken();
+  if(0 == relayBatchLen) { relayBatchAge = 0; relayBatch[relayBatchLen++] = RELAY_BATCH_FORMAT_V1; }
+  relayBatch[relayBatchLen++] = buflen;
+  memcpy(relayBatch + relayBatchLen, buf, buflen);
+  relayBatchLen += buflen;
+  }
+
+void relayBatchTick()
+  {
+  if(0 == relayBatchLen) { return; }
+  // Once due, retry each minor cycle until sent.
+  if(relayBatchAge < RELAY_BATCH_MAX_DELAY_S / OTV0P2BASE::MAIN_TICK_S) { ++relayBatchAge; }
+  if(relayBatchAge >= RELAY_BATCH_MAX_DELAY_S / OTV0P2BASE::MAIN_TICK_S) { relayBatchFlush(); }
+  }
+#endif // ENABLE_RELAY_BATCHING
+
+#if defined(ENABLE_SECONDARY_TX_DEFERRED)
+static uint8_t secondaryTXHeld[64];
+static uint8_t secondaryTXHeldLen;
+
+void secondaryTXDeferred(const uint8_t *const buf, const uint8_t buflen)
+  {
+  if(buflen > sizeof(secondaryTXHeld)) { return; }
+  memcpy(secondaryTXHeld, buf, buflen);
+  secondaryTXHeldLen = buflen;
+  }
+
+void secondaryTXDeferredTick()
+  {
+  if(0 == secondaryTXHeldLen) { return; }
+  if(OTV0P2BASE::getSubCycleTime() >= OTV0P2BASE::GSCT_MAX/2) { return; }
+  if(!deferredInitDone(DI_SECONDARY_RADIO)) { return; } // Keep it held.
+  SecondaryRadio.queueToSend(secondaryTXHeld, secondaryTXHeldLen);
+  secondaryTXHeldLen = 0;
+  }
+#endif // ENABLE_SECONDARY_TX_DEFERRED
+
+#if defined(ENABLE_LORA_UPLINK_PACKER)
+// LoRaWAN (EU868) uplink packing, to amortise the ~13 bytes of LoRaWAN framing and the
+// long preamble over several frames, and to stay within the 1% sub-band duty cycle.
+// OTRN2483Link reports neither the ADR data rate nor the channel used,
+// so airtime is estimated at the slowest rate ADR may pick,
+// and credit is kept for the g1 sub-band (868.0--868.6MHz) holding the three default channels.
+#ifndef LORA_UPLINK_SF
+#define LORA_UPLINK_SF 11 // Spreading factor of DR1, the slowest rate allowed to ADR.
 #endif
-#if defined(ENABLE_RADIO_RX)
-static constexpr bool RFM23B_allowRX = true;
+#ifndef LORA_UPLINK_MAX_BYTES // Maximum application payload at that data rate.
+#if LORA_UPLINK_SF >= 10
+#define LORA_UPLINK_MAX_BYTES 51 // DR0--DR2.
+#elif LORA_UPLINK_SF == 9
+#define LORA_UPLINK_MAX_BYTES 115 // DR3.
 #else
-static constexpr bool RFM23B_allowRX = false;
+#define LORA_UPLINK_MAX_BYTES 222 // DR4--DR5.
+#endif
+#endif
+// Largest frame sent on its own when too big to pack, eg a full secure 'O' frame at DR0--DR2;
+// ADR will often have picked a faster rate that allows it, else the module refuses it.
+static constexpr uint8_t LORA_UPLINK_SOLO_MAX_BYTES = 64;
+#ifndef LORA_UPLINK_MAX_DELAY_S
+#define LORA_UPLINK_MAX_DELAY_S 300 // Maximum time a frame waits for a full uplink.
+#endif
+static_assert(LORA_UPLINK_MAX_DELAY_S / OTV0P2BASE::MAIN_TICK_S < 255, "uplink delay too long");
+// Airtime credit (ms) earned per main tick at a 1% duty cycle, and its cap of one hour's allowance.
+static constexpr uint16_t LORA_CREDIT_PER_TICK_MS = (1000U * OTV0P2BASE::MAIN_TICK_S) / 100;
+static constexpr uint16_t LORA_CREDIT_MAX_MS = 36000U;
+static uint8_t loraUplink[LORA_UPLINK_MAX_BYTES];
+static uint8_t loraUplinkLen;
+// One (len,frame...) uplink too big to pack, sent ahead of loraUplink; a newer one replaces it.
+static uint8_t loraSolo[1 + LORA_UPLINK_SOLO_MAX_BYTES];
+static uint8_t loraSoloLen;
+// Minor cycles that the oldest frame in the uplink has waited.
+static uint8_t loraUplinkAge;
+// True once a frame has not fitted alongside those held.
+static bool loraUplinkFull;
+static uint16_t loraCreditMs;
+
+// Estimated airtime (ms) of an uplink with n bytes of application payload.
+// Explicit header, CRC, 4/5 coding, 125kHz, 8 preamble symbols,
+// and low data rate optimisation at SF11 and SF12.
+static uint16_t loraAirtimeMs(const uint8_t n)
+  {
+  const uint8_t sf = LORA_UPLINK_SF;
+  const uint8_t de = (sf >= 11) ? 1 : 0;
+  const int16_t num = 8 * (int16_t)(n + 13) - 4 * sf + 44;
+  const uint8_t den = 4 * (sf - 2*de);
+  const uint16_t symbols = 8 + ((num > 0) ? ((num + den - 1) / den) * 5 : 0);
+  // 12.25 further preamble symbols; each symbol is 2^SF * 8us.
+  return((uint16_t)((((uint32_t)(4*symbols + 49)) << sf) / 500));
+  }
+
+void loraUplinkPut(const uint8_t *const buf, const uint8_t buflen)
+  {
+  if(buflen > sizeof(loraUplink) - 1)
+    {
+    if(buflen > LORA_UPLINK_SOLO_MAX_BYTES) { latencyRelayDropped((0 != loraUplinkLen) || (0 != loraSoloLen)); return; } // Can never fit.
+    // Too big to pack, so send it on its own at the next chance.
+    if(0 != loraSoloLen) { latencyRelayDropped(true); } // Replaced unsent.
+    loraSolo[0] = buflen;
+    memcpy(loraSolo + 1, buf, buflen);
+    loraSoloLen = 1 + buflen;
+    return;
+    }
+  while(loraUplinkLen + 1 + buflen > sizeof(loraUplink))
+    {
+    // Send when next possible; meanwhile the newest stats are worth more than the oldest.
+    loraUplinkFull = true;
+    const uint8_t n = 1 + loraUplink[0];
+    loraUplinkLen -= n;
+    memmove(loraUplink, loraUplink + n, loraUplinkLen);
+    loraUplinkAge = 0; // The oldest frame timed from is gone; the uplink is sent as full anyway.
+    latencyRelayDropped(true); // This frame at least is held.
+    }
+  if(0 == loraUplinkLen) { loraUplinkAge = 0; }
+  loraUplink[loraUplinkLen++] = buflen;
+  memcpy(loraUplink + loraUplinkLen, buf, buflen);
+  loraUplinkLen += buflen;
+  }
+
+void loraUplinkTick()
+  {
+  loraCreditMs = OTV0P2BASE::fnmin((uint16_t)(loraCreditMs + LORA_CREDIT_PER_TICK_MS), LORA_CREDIT_MAX_MS);
+  if(0 != loraSoloLen)
+    {
+    const uint16_t airtime = loraAirtimeMs(loraSoloLen);
+    if(loraCreditMs < airtime) { return; }
+    if(OTV0P2BASE::getSubCycleTime() >= OTV0P2BASE::GSCT_MAX/2) { return; }
+    if(!deferredInitDone(DI_SECONDARY_RADIO)) { return; }
+    // A refusal (eg too long for the current data rate) drops it rather than blocking packed uplinks.
+    if(SecondaryRadio.queueToSend(loraSolo, loraSoloLen)) { loraCreditMs -= airtime; latencyRelaySent(0 != loraUplinkLen); }
+    else { latencyRelayDropped(0 != loraUplinkLen); }
+    loraSoloLen = 0;
+    return; // At most one uplink per minor cycle.
+    }
+  if(0 == loraUplinkLen) { return; }
+  if(loraUplinkAge < 255) { ++loraUplinkAge; }
+  if(!loraUplinkFull && (loraUplinkAge < LORA_UPLINK_MAX_DELAY_S / OTV0P2BASE::MAIN_TICK_S)) { return; }
+  const uint16_t airtime = loraAirtimeMs(loraUplinkLen);
+  if(loraCreditMs < airtime) { return; } // Defer until the sub-band allows.
+  // OTRN2483Link blocks until the module responds.
+  if(OTV0P2BASE::getSubCycleTime() >= OTV0P2BASE::GSCT_MAX/2) { return; }
+  if(!deferredInitDone(DI_SECONDARY_RADIO)) { return; }
+  // If refused keep the uplink and its credit to retry next minor cycle.
+  if(!SecondaryRadio.queueToSend(loraUplink, loraUplinkLen)) { return; }
+  latencyRelaySent(false);
+  loraCreditMs -= airtime;
+  loraUplinkLen = 0;
+  loraUplinkFull = false;
+  }
+#endif // ENABLE_LORA_UPLINK_PACKER
+
+// Brings in necessary radio libs.
+#ifdef ENABLE_RADIO_RFM23B
+RFM23B_t RFM23B;
+#if defined(ENABLE_RFM23B_SLEEPY_TX)
+static uint8_t rfm23bSPIXfer(const uint8_t b) { SPDR = b; while(!(SPSR & _BV(SPIF))) { } return(SPDR); }
+uint8_t RFM23BSleepyTX::readReg(const uint8_t addr)
+  {
+  fastDigitalWrite(OTV0P2BASE::V0p2_PIN_SPI_nSS, LOW);
+  rfm23bSPIXfer(addr & 0x7f);
+  const uint8_t v = rfm23bSPIXfer(0);
+  fastDigitalWrite(OTV0P2BASE::V0p2_PIN_SPI_nSS, HIGH);
+  return(v);
+  }
+void RFM23BSleepyTX::writeReg(const uint8_t addr, const uint8_t val)
+  {
+  fastDigitalWrite(OTV0P2BASE::V0p2_PIN_SPI_nSS, LOW);
+  rfm23bSPIXfer(addr | 0x80);
+  rfm23bSPIXfer(val);
+  fastDigitalWrite(OTV0P2BASE::V0p2_PIN_SPI_nSS, HIGH);
+  }
+void RFM23BSleepyTX::standbyAndClear()
+  {
+  writeReg(REG_OP_CTRL1, 0);
+  writeReg(REG_OP_CTRL2, 3); // FFCLRRX | FFCLRTX
+  writeReg(REG_OP_CTRL2, 0); // Needs both writes to clear.
+  writeReg(REG_INT_ENABLE1, 0);
+  writeReg(REG_INT_ENABLE2, 0);
+  readReg(REG_INT_STATUS1);
+  readReg(REG_INT_STATUS2);
+  }
+bool RFM23BSleepyTX::napTXFIFO()
+  {
+  bool neededEnable;
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+    {
+    neededEnable = OTV0P2BASE::t_powerUpSPIIfDisabled<OTV0P2BASE::V0p2_PIN_SPI_nSS, OTV0P2BASE::DEFAULT_RUN_SPI_SLOW>();
+    // Interrupt on packet sent only, so nIRQ falls just once, at the end of the frame.
+    writeReg(REG_INT_ENABLE1, 4);
+    writeReg(REG_INT_ENABLE2, 0);
+    readReg(REG_INT_STATUS1);
+    readReg(REG_INT_STATUS2);
+    txSent = false;
+    txWaiting = true;
+    writeReg(REG_OP_CTRL1, 9); // TXON | XTON
+    }
+  // Nap through the airtime; any interrupt (including nIRQ) ends a nap early.
+  // The status register is still the authority, eg if the interrupt is not wired.
+  bool result = false;
+  for(uint8_t i = MAX_TX_NAPS; i-- > 0; )
+    {
+    if(!txSent) { OTV0P2BASE::nap(WDTO_15MS, true); }
+    if(readReg(REG_INT_STATUS1) & 4) { result = true; break; } // Packet sent!
+    }
+  txWaiting = false;
+  // Disable the packet-sent interrupt again, eg in case of timeout.
+  writeReg(REG_INT_ENABLE1, 0);
+  if(neededEnable) { OTV0P2BASE::t_powerDownSPI<OTV0P2BASE::V0p2_PIN_SPI_nSS, OTV0P2BASE::V0p2_PIN_SPI_SCK, OTV0P2BASE::V0p2_PIN_SPI_MOSI, OTV0P2BASE::V0p2_PIN_SPI_MISO, OTV0P2BASE::DEFAULT_RUN_SPI_SLOW>(); }
+  return(result);
+  }
+// As the library sendRaw(), but napping through the airtime.
+bool RFM23BSleepyTX::sendRaw(const uint8_t *const buf, const uint8_t buflen, const int8_t channel, const TXpower power, const bool /*listenAfter*/)
+  {
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+    {
+    const bool neededEnable = OTV0P2BASE::t_powerUpSPIIfDisabled<OTV0P2BASE::V0p2_PIN_SPI_nSS, OTV0P2BASE::DEFAULT_RUN_SPI_SLOW>();
+    standbyAndClear();
+    if(neededEnable) { OTV0P2BASE::t_powerDownSPI<OTV0P2BASE::V0p2_PIN_SPI_nSS, OTV0P2BASE::V0p2_PIN_SPI_SCK, OTV0P2BASE::V0p2_PIN_SPI_MOSI, OTV0P2BASE::V0p2_PIN_SPI_MISO, OTV0P2BASE::DEFAULT_RUN_SPI_SLOW>(); }
+    }
+  _setChannel(channel);
+  _queueFrameInTXFIFO(buf, buflen);
+  const bool neededEnable = OTV0P2BASE::t_powerUpSPIIfDisabled<OTV0P2BASE::V0p2_PIN_SPI_nSS, OTV0P2BASE::DEFAULT_RUN_SPI_SLOW>();
+  if(readReg(REG_30_DATA_ACCESS_CONTROL) & RFM23B_ENPACTX) { writeReg(REG_3E_PACKET_LENGTH, buflen); }
+  if(neededEnable) { OTV0P2BASE::t_powerDownSPI<OTV0P2BASE::V0p2_PIN_SPI_nSS, OTV0P2BASE::V0p2_PIN_SPI_SCK, OTV0P2BASE::V0p2_PIN_SPI_MOSI, OTV0P2BASE::V0p2_PIN_SPI_MISO, OTV0P2BASE::DEFAULT_RUN_SPI_SLOW>(); }
+  bool result = napTXFIFO();
+  // For maximum 'power' resend the frame (still in the TX FIFO) after a short nap.
+  if(power >= TXmax)
+    {
+    OTV0P2BASE::nap(WDTO_15MS);
+    if(!napTXFIFO()) { result = false; }
+    }
+  // Revert to RX mode if listening, else go to standby to save energy.
+  _dolisten();
+  return(result);
+  }
+#endif // ENABLE_RFM23B_SLEEPY_TX
+#if defined(ENABLE_TX_DUTY_CYCLE)
+// Airtime (ms) charged in each 10-minute slot of the rolling hour; txDutySlot is the current one.
+static uint16_t txDutySlotMs[TX_DUTY_SLOTS];
+static uint8_t txDutySlot;
+uint8_t txDutyRefused;
+uint8_t txDutyCriticalDepth;
+// Airtime (ms, rounded up) of one copy of a frame of buflen bytes on channel.
+static uint16_t txAirtimeMs(const uint8_t buflen, const int8_t channel)
+  {
+#if !defined(ENABLE_FAST_FRAMED_CARRIER_SUPPORT)
+  // Channel 0 is FS20/FHT8V OOK at 5kbps, ie 5 bits per ms; the encoded frame already includes its preamble.
+  if(0 == channel) { return((uint16_t)((8U * buflen + 4) / 5)); }
 #endif
-OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, RFM23B_IRQ_PIN, RFM23B_RX_QUEUE_SIZE, RFM23B_allowRX> RFM23B;
+  // GFSK at 57.6kbps, ~139us per byte, plus preamble and sync (and any hardware header and CRC).
+  return((uint16_t)((((uint16_t)buflen + 10) * 139U + 999) / 1000));
+  }
+uint16_t txDutyUsedMs()
+  {
+  uint16_t used = 0;
+  for(uint8_t i = 0; i < TX_DUTY_SLOTS; ++i) { used += txDutySlotMs[i]; }
+  return(used);
+  }
+bool txDutyAdmit(const uint8_t buflen, const int8_t channel, OTRadioLink::OTRadioLink::TXpower &power)
+  {
+  const uint16_t one = txAirtimeMs(buflen, channel);
+  const uint16_t used = txDutyUsedMs();
+  const uint16_t limit = (0 != txDutyCriticalDepth) ? TX_DUTY_BUDGET_MS : (TX_DUTY_BUDGET_MS - TX_DUTY_RESERVE_MS);
+  if(used + one > limit) { if(txDutyRefused < 255) { ++txDutyRefused; } return(false); }
+  // In the last eighth of what this frame may use send only one copy.
+  if((power >= OTRadioLink::OTRadioLink::TXmax) && (used + 2*one > limit - TX_DUTY_BUDGET_MS/8))
+    { power = OTRadioLink::OTRadioLink::TXnormal; }
+  txDutySlotMs[txDutySlot] += (power >= OTRadioLink::OTRadioLink::TXmax) ? 2*one : one;
+  return(true);
+  }
+void txDutyMinuteTick()
+  {
+  if(0 != (OTV0P2BASE::getMinutesLT() % 10)) { return; }
+  txDutySlot = (uint8_t)((txDutySlot + 1) % TX_DUTY_SLOTS);
+  txDutySlotMs[txDutySlot] = 0;
+  }
+#endif // ENABLE_TX_DUTY_CYCLE
 #endif // ENABLE_RADIO_RFM23B
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+RFM23BAux_t RFM23BAux;
+#endif // ENABLE_RADIO_AUX_RX_RFM23B
 #ifdef ENABLE_RADIO_SIM900
 //OTSIM900Link::OTSIM900Link SIM900(REGULATOR_POWERUP, RADIO_POWER_PIN, SOFTSERIAL_RX_PIN, SOFTSERIAL_TX_PIN);
+// NOTE: the driver already keeps the PDP context and UDP socket up between sends (IDLE -> WAIT_FOR_UDP -> SENDING -> IDLE),
+// so the attach/setup cost is paid once per power-up; reconnect backoff and keep-alive checks belong in that state machine.
 OTSIM900Link::OTSIM900Link<8, 5, RADIO_POWER_PIN, OTV0P2BASE::getSecondsLT> SIM900; // (REGULATOR_POWERUP, RADIO_POWER_PIN);
 #endif
 #ifdef ENABLE_RADIO_RN2483
@@ -93,7 +1189,9 @@ OTRN2483Link::OTRN2483Link RN2483(RADIO_POWER_PIN, SOFTSERIAL_RX_PIN, SOFTSERIAL
 #endif // ENABLE_RADIO_RN2483
 
 // Assigns radio to PrimaryRadio alias
-#if defined(ENABLE_RADIO_PRIMARY_RFM23B)
+#if defined(ENABLE_RADIO_PRIMARY_RFM23B) && defined(ENABLE_DEVIRTUALISED_RADIO)
+// PrimaryRadio is RFM23B itself.
+#elif defined(ENABLE_RADIO_PRIMARY_RFM23B)
 OTRadioLink::OTRadioLink &PrimaryRadio = RFM23B;
 #elif defined(RADIO_PRIMARY_SIM900)
 OTRadioLink::OTRadioLink &PrimaryRadio = SIM900;
@@ -114,13 +1212,93 @@ OTRadioLink::OTRadioLink &SecondaryRadio = NullRadio;
 #endif // RADIO_SECONDARY_RFM23B
 #endif // ENABLE_RADIO_SECONDARY_MODULE
 
-// RFM22 is apparently SPI mode 0 for Arduino library pov.
+#if defined(ENABLE_ADAPTIVE_TX_SLOT) || defined(ENABLE_WINDOWED_RX_POLL) || defined(ENABLE_TX_PENDING_QUEUE)
+// RSSI (RFM23B units, 0.5dB steps, ~16 at -120dBm) above which the channel is taken to be busy.
+// ~-80dBm: well above the usual noise floor but below a nearby node's TX.
+static constexpr uint8_t TX_LBT_RSSI_BUSY = 96;
+bool primaryRadioChannelBusy()
+  {
+#if defined(ENABLE_RADIO_PRIMARY_RFM23B) && defined(ENABLE_RADIO_RX)
+  // RSSI is only valid in RX mode (rxon, bit 2 of OP_CTRL1), ie when listening continuously.
+  if(0 == (RFM23B.getMode() & 4)) { return(false); }
+  return(RFM23B.getRSSI() > TX_LBT_RSSI_BUSY);
+#else
+  return(false); // Cannot listen, so cannot tell.
+#endif
+  }
+#endif
 
-#if defined(ENABLE_RFM23B_FS20_RAW_PREAMBLE)
-// Send the underlying stats binary/text 'whitened' message.
-// This must be terminated with an 0xff (which is not sent),
-// and no longer than STATS_MSG_MAX_LEN bytes long in total (excluding the terminating 0xff).
-// This must not contain any 0xff and should not contain long runs of 0x00 bytes.
+#if defined(ENABLE_TX_PENDING_QUEUE)
+// Held frames, one per class; 0 length means none held.
+static uint8_t txPendingBuf[TXC_COUNT][TX_PENDING_MAX_FRAME];
+static uint8_t txPendingLen[TXC_COUNT];
+static int8_t txPendingChannel[TXC_COUNT];
+static uint8_t txPendingPower[TXC_COUNT];
+static uint8_t txPendingTries[TXC_COUNT];
+// Held secure frames, to be rebuilt rather than resent; NULL means none held.
+static txRebuild_t txPendingRebuild[TXC_COUNT];
+
+bool primaryRadioSendOrHold(const txClass_t c, const uint8_t *const buf, const uint8_t buflen, const int8_t channel, const OTRadioLink::OTRadioLink::TXpower power, const txRebuild_t rebuild)
+  {
+  bool queued;
+  ENERGY_ACCOUNT(EA_TX, queued = PrimaryRadio.queueToSend(buf, buflen, channel, power));
+  txPendingLen[c] = 0;
+  txPendingRebuild[c] = NULL;
+  if(queued) { return(true); }
+  if(NULL != rebuild)
+    {
+    txPendingRebuild[c] = rebuild;
+    txPendingTries[c] = 0;
+    return(false);
+    }
+  if(buflen > TX_PENDING_MAX_FRAME) { return(false); }
+  memcpy(txPendingBuf[c], buf, buflen);
+  txPendingLen[c] = buflen;
+  txPendingChannel[c] = channel;
+  txPendingPower[c] = (uint8_t)power;
+  txPendingTries[c] = 0;
+  return(false);
+  }
+
+void txPendingTick()
+  {
+  for(uint8_t c = 0; c < TXC_COUNT; ++c)
+    {
+    const uint8_t len = txPendingLen[c];
+    const txRebuild_t rebuild = txPendingRebuild[c];
+    if((0 == len) && (NULL == rebuild)) { continue; }
+    // Leave the channel to whoever is using it; this does not count as a try.
+    if(primaryRadioChannelBusy()) { return; }
+    if(NULL != rebuild)
+      {
+      // Encryption is slow, so only start it with at least half the minor cycle left.
+      if(OTV0P2BASE::getSubCycleTime() >= OTV0P2BASE::GSCT_MAX/2) { return; }
+      const uint8_t tries = txPendingTries[c] + 1;
+      // The rebuild sends or holds the fresh frame, and counts any failure itself.
+      txPendingRebuild[c] = NULL;
+      rebuild();
+      if(NULL != txPendingRebuild[c])
+        {
+        if(tries >= TX_PENDING_MAX_TRIES) { txPendingRebuild[c] = NULL; }
+        else { txPendingTries[c] = tries; }
+        }
+      continue;
+      }
+    bool queued;
+    ENERGY_ACCOUNT(EA_TX, queued = PrimaryRadio.queueToSend(txPendingBuf[c], len, txPendingChannel[c], (OTRadioLink::OTRadioLink::TXpower)txPendingPower[c]));
+    if(queued || (++txPendingTries[c] >= TX_PENDING_MAX_TRIES)) { txPendingLen[c] = 0; }
+    if(!queued) { linkCountTXFail(); }
+    }
+  }
+#endif // ENABLE_TX_PENDING_QUEUE
+
+// RFM22 is apparently SPI mode 0 for Arduino library pov.
+
+#if defined(ENABLE_RFM23B_FS20_RAW_PREAMBLE)
+// Send the underlying stats binary/text 'whitened' message.
+// This must be terminated with an 0xff (which is not sent),
+// and no longer than STATS_MSG_MAX_LEN bytes long in total (excluding the terminating 0xff).
+// This must not contain any 0xff and should not contain long runs of 0x00 bytes.
 // The message to be sent must be written at an offset of STATS_MSG_START_OFFSET from the start of the buffer.
 // This routine will alter the content of the buffer for transmission,
 // and the buffer should not be re-used as is.
@@ -131,14 +1309,34 @@ OTRadioLink::OTRadioLink &SecondaryRadio = NullRadio;
 void RFM22RawStatsTXFFTerminated(uint8_t * const buf, const bool doubleTX, bool RFM23BFramed)
   {
   if(RFM23BFramed) RFM22RXPreambleAdd(buf);     // Only needed for RFM23B. This should be made more clear when refactoring
-  const uint8_t buflen = OTRadioLink::frameLenFFTerminated(buf);
+  RFM22RawStatsTX(buf, OTRadioLink::frameLenFFTerminated(buf), doubleTX);
+  }
+
+// Send the first buflen bytes of buf, including any preamble, as RFM22RawStatsTXFFTerminated().
+void RFM22RawStatsTX(uint8_t * const buf, const uint8_t buflen, const bool doubleTX)
+  {
 #if 0 && defined(DEBUG)
     DEBUG_SERIAL_PRINT_FLASHSTRING("buflen=");
     DEBUG_SERIAL_PRINT(buflen);
     DEBUG_SERIAL_PRINTLN();
 #endif // DEBUG
-  if(!PrimaryRadio.queueToSend(buf, buflen, 0, (doubleTX ? OTRadioLink::OTRadioLink::TXmax : OTRadioLink::OTRadioLink::TXnormal)))
+#if defined(ENABLE_RADIO_DUAL_CARRIER)
+  // Raw FS20-style frames are only meaningful on the OOK carrier.
+  const int8_t channel = RADIO_OOK_CHANNEL;
+#else
+  const int8_t channel = primaryRadioChannel();
+#endif
+  const OTRadioLink::OTRadioLink::TXpower power = doubleTX ? OTRadioLink::OTRadioLink::TXmax : OTRadioLink::OTRadioLink::TXnormal;
+  bool queued;
+#if defined(ENABLE_TX_PENDING_QUEUE)
+  queued = primaryRadioSendOrHold(TXC_STATS, buf, buflen, channel, power);
+#else
+  ENERGY_ACCOUNT(EA_TX, queued = PrimaryRadio.queueToSend(buf, buflen, channel, power));
+#endif
+  if(!queued)
     {
+    linkCountTXFail();
+    noteStatsTXFailed();
 #if 0 && defined(DEBUG)
     DEBUG_SERIAL_PRINTLN_FLASHSTRING("!TX failed");
 #endif
@@ -149,6 +1347,80 @@ void RFM22RawStatsTXFFTerminated(uint8_t * const buf, const bool doubleTX, bool
 
 
 #if defined(ENABLE_RADIO_RX) && defined(ENABLE_FHT8VSIMPLE_RX) // (defined(ENABLE_BOILER_HUB) || defined(ENABLE_STATS_RX)) && defined(ENABLE_FS20_NATIVE_AND_BINARY_STATS_RX) // Listen for calls for heat from remote valves...
+#if defined(ENABLE_FHT8V_TABLE_DECODE)
+// Drop-in for FHT8VRadValveBase::FHT8VDecodeBitStream(), with identical results.
+// Each encoded bit is a run of 2-bit pairs, 11 00 for 0 and 11 10 00 for 1,
+// so a small state machine over pairs decodes the stream; this steps it a nibble (two pairs) at a time
+// from a 48-byte Flash table instead of making a call and several mask/pointer updates per pair.
+// A nibble can complete at most one encoded bit.
+// Entry for [state][nibble]: b1..0 next state, b2 bit completed, b3 its value,
+// b4 completed at the second pair (else the first), b5 first pair invalid, b6 second pair invalid.
+// States are 0: expecting leading 11, 1: after 11, 2: after 11 10.
+static const uint8_t fht8vDecodeNibble[3][16] PROGMEM =
+  {
+  { 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x14, 0x40, 0x02, 0x40 },
+  { 0x44, 0x44, 0x44, 0x05, 0x20, 0x20, 0x20, 0x20, 0x1c, 0x40, 0x40, 0x40, 0x20, 0x20, 0x20, 0x20 },
+  { 0x4c, 0x4c, 0x4c, 0x0d, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20 },
+  };
+static uint8_t const *fht8vDecodeBitStreamTable(uint8_t const *const bitStream, uint8_t const *const lastByte, OTRadValve::FHT8VRadValveBase::fht8v_msg_t *const command)
+  {
+  // Bytes hc1, hc2, address, command, extension, checksum, each with trailing parity.
+  uint8_t bytes[6];
+  uint8_t nBytes = 0;
+  uint16_t acc = 0; // Bits of the current byte plus parity, MSB first.
+  uint8_t nBits = 0;
+  bool started = false; // True once the leading encoded 1 has been seen.
+  uint8_t state = 0;
+  for(uint8_t const *b = bitStream; b <= lastByte; ++b)
+    {
+    for(uint8_t lowNibble = 0; lowNibble < 2; ++lowNibble)
+      {
+      const uint8_t e = pgm_read_byte(&fht8vDecodeNibble[state][lowNibble ? (*b & 0xf) : (*b >> 4)]);
+      if(e & 0x20) { return(NULL); }
+      if(e & 0x4)
+        {
+        const uint8_t bit = (e >> 3) & 1;
+        if(!started) { started = (0 != bit); }
+        else if(6 == nBytes)
+          {
+          // Trailing encoded 0 ends the frame: stop here, whatever follows.
+          if(0 != bit) { return(NULL); }
+#ifdef OTV0P2BASE_FHT8V_ADR_USED
+          command->address = bytes[2];
+#endif
+          command->hc1 = bytes[0];
+          command->hc2 = bytes[1];
+          command->command = bytes[3];
+          command->extension = bytes[4];
+          const uint8_t checksum = 0xc + bytes[0] + bytes[1] + bytes[2] + bytes[3] + bytes[4];
+          if(checksum != bytes[5]) { return(NULL); }
+          // As the original, return one byte beyond that holding the next unread pair.
+          return(b + ((lowNibble && (e & 0x10)) ? 2 : 1));
+          }
+        else
+          {
+          acc = (acc << 1) | bit;
+          if(9 == ++nBits)
+            {
+            const uint8_t v = (uint8_t)(acc >> 1);
+            uint8_t parity = v;
+            parity ^= parity >> 4; parity ^= parity >> 2; parity ^= parity >> 1;
+            if((parity & 1) != (acc & 1)) { return(NULL); }
+            bytes[nBytes++] = v;
+            acc = 0; nBits = 0;
+            }
+          }
+        }
+      if(e & 0x40) { return(NULL); }
+      state = e & 3;
+      }
+    }
+  return(NULL); // Ran off the end.
+  }
+#define FHT8VDecodeBitStreamFast(bs, lb, cmd) fht8vDecodeBitStreamTable((bs), (lb), (cmd))
+#else
+#define FHT8VDecodeBitStreamFast(bs, lb, cmd) OTRadValve::FHT8VRadValveBase::FHT8VDecodeBitStream((bs), (lb), (cmd))
+#endif // ENABLE_FHT8V_TABLE_DECODE
 // Handle FS20/FHT8V traffic including binary stats.
 // Returns true on success, false otherwise.
 static bool decodeAndHandleFTp2_FS20_native(Print *p, const bool secure, const uint8_t * const msg, const uint8_t msglen)
@@ -156,7 +1428,7 @@ static bool decodeAndHandleFTp2_FS20_native(Print *p, const bool secure, const u
   // Decode the FS20/FHT8V command into the buffer/struct.
   OTRadValve::FHT8VRadValveBase::fht8v_msg_t command;
   uint8_t const *lastByte = msg+msglen-1;
-  uint8_t const *trailer = OTRadValve::FHT8VRadValveBase::FHT8VDecodeBitStream(msg, lastByte, &command);
+  uint8_t const *trailer = FHT8VDecodeBitStreamFast(msg, lastByte, &command);
 
 #if defined(ENABLE_BOILER_HUB)
   // Potentially accept as call for heat only if command is 0x26 (38).
@@ -165,80 +1437,1065 @@ static bool decodeAndHandleFTp2_FS20_native(Print *p, const bool secure, const u
   // and for the housecode being accepted.
   if(0x26 == command.command)
     {
-    const uint16_t compoundHC = (((uint16_t)command.hc1) << 8) | command.hc2;
-#if 0 && defined(DEBUG)
-    p->print("FS20 RX 0x26 "); // Just notes that a 'valve %' FS20 command has been overheard.
-    p->print(command.hc1); p->print(' ');
-    p->println(command.hc2);
-#endif
-    const uint8_t percentOpen = OTRadValve::FHT8VRadValveUtil::convert255ScaleToPercent(command.extension);
-    remoteCallForHeatRX(compoundHC, percentOpen);
+    const uint16_t compoundHC = (((uint16_t)command.hc1) << 8) | command.hc2;
+#if 0 && defined(DEBUG)
+    p->print("FS20 RX 0x26 "); // Just notes that a 'valve %' FS20 command has been overheard.
+    p->print(command.hc1); p->print(' ');
+    p->println(command.hc2);
+#endif
+    const uint8_t percentOpen = OTRadValve::FHT8VRadValveUtil::convert255ScaleToPercent(command.extension);
+    remoteCallForHeatRX(compoundHC, percentOpen);
+    }
+#endif
+
+  if(NULL != trailer)
+    {
+#if 0 && defined(DEBUG)
+p->print("FS20 msg HC "); p->print(command.hc1); p->print(' '); p->println(command.hc2);
+#endif
+#if defined(ENABLE_STATS_RX) // Only look for the trailer if supported.
+    // If whole FHT8V frame was OK then check if there is a valid stats trailer.
+
+    // Check for 'core' stats trailer.
+    if(OTV0P2BASE::MESSAGING_FULL_STATS_FLAGS_HEADER_MSBS == (trailer[0] & OTV0P2BASE::MESSAGING_FULL_STATS_FLAGS_HEADER_MASK))
+      {
+      OTV0P2BASE::FullStatsMessageCore_t content;
+      const uint8_t *tail = decodeFullStatsMessageCore(trailer, lastByte-trailer+1, OTV0P2BASE::stTXalwaysAll, false, &content);
+      if(NULL != tail)
+        {
+        // Received trailing stats frame!
+
+        // If ID is present then make sure it matches that implied by the FHT8V frame (else reject this trailer)
+        // else file it in from the FHT8C frame.
+        bool allGood = true;
+        if(content.containsID)
+          {
+          if((content.id0 != command.hc1) || (content.id1 != command.hc2))
+            { allGood = false; }
+          }
+        else
+          {
+          content.id0 = command.hc1;
+          content.id1 = command.hc2;
+          content.containsID = true;
+          }
+
+#if 0 && defined(DEBUG)
+/*if(allGood)*/ { p->println("FS20 ts"); }
+#endif
+        // If frame looks good then capture it.
+#if defined(ENABLE_BINARY_SERIAL_OUTPUT)
+        if(allGood) { binRecFS20(msg, msglen, true, content.id0, content.id1); }
+#else
+        if(allGood) { outputCoreStats(p, false, &content); }
+#endif
+//            else { setLastRXErr(FHT8VRXErr_BAD_RX_SUBFRAME); }
+        // TODO: record error with mismatched ID.
+        }
+      }
+#if defined(ENABLE_MINIMAL_STATS_TXRX)
+    // Check for minimal stats trailer.
+    else if((trailer + MESSAGING_TRAILING_MINIMAL_STATS_PAYLOAD_BYTES <= lastByte) && // Enough space for minimum-stats trailer.
+       (MESSAGING_TRAILING_MINIMAL_STATS_HEADER_MSBS == (trailer[0] & MESSAGING_TRAILING_MINIMAL_STATS_HEADER_MASK)))
+      {
+      if(verifyHeaderAndCRCForTrailingMinimalStatsPayload(trailer)) // Valid header and CRC.
+        {
+#if 0 && defined(DEBUG)
+        p->println("FS20 tsm"); // Just notes that a 'valve %' FS20 command has been overheard.
+#endif
+        trailingMinimalStatsPayload_t payload;
+        extractTrailingMinimalStatsPayload(trailer, &payload);
+        }
+      }
+#endif
+#endif // defined(ENABLE_STATS_RX)
+    }
+  return(true);
+  }
+#endif
+
+#if defined(ENABLE_SECURE_STATS_TLV)
+// JSON keys for STLV_XXX codes, indexed by code.
+static const char stlvKey1[] PROGMEM = "T|C16";
+static const char stlvKey2[] PROGMEM = "H|%";
+static const char stlvKey3[] PROGMEM = "L";
+static const char stlvKey4[] PROGMEM = "O";
+static const char stlvKey5[] PROGMEM = "vac|h";
+static const char stlvKey6[] PROGMEM = "B|cV";
+static const char stlvKey7[] PROGMEM = "v|%";
+static const char stlvKey8[] PROGMEM = "tT|C";
+static const char stlvKey9[] PROGMEM = "tS|C";
+static const char stlvKey10[] PROGMEM = "vC|%";
+static const char stlvKey11[] PROGMEM = "b";
+static const char stlvKey12[] PROGMEM = "gE";
+static const char *const stlvKeys[STLV_MAX_CODE] PROGMEM =
+  { stlvKey1, stlvKey2, stlvKey3, stlvKey4, stlvKey5, stlvKey6, stlvKey7, stlvKey8, stlvKey9, stlvKey10, stlvKey11, stlvKey12 };
+
+// Print TLV stats to p as one line of JSON, with synthetic "@" ID and "+" seq fields.
+// Stops at the first malformed item; unknown codes are skipped.
+void printStatsTLVAsJSON(Print *const p, const uint8_t *const id, const uint8_t idLen, const uint8_t seq, const uint8_t *const tlv, const uint8_t len)
+  {
+  p->print(F("{\"@\":\""));
+  printIDHex(p, id, idLen);
+  p->print(F("\",\"+\":"));
+  p->print(seq);
+  for(uint8_t i = 0; i < len; )
+    {
+    const uint8_t tag = tlv[i++];
+    const uint8_t n = tag >> 6;
+    const uint8_t code = tag & 0x3f;
+    if((0 == n) || (n > 2) || (i + n > len)) { break; } // Malformed.
+    const int16_t value = (2 == n) ? (int16_t)((tlv[i] << 8) | tlv[i+1]) : (int16_t)tlv[i];
+    i += n;
+    if((STLV_NONE == code) || (code > STLV_MAX_CODE)) { continue; } // Unknown.
+    p->print(F(",\""));
+    p->print((const __FlashStringHelper *)pgm_read_word(&stlvKeys[code-1]));
+    p->print(F("\":"));
+    p->print(value);
+    }
+  p->println('}');
+  }
+#endif // ENABLE_SECURE_STATS_TLV
+
+#if defined(ENABLE_STATS_SET_UPLOAD) && defined(ENABLE_RADIO_RX)
+// Print an uploaded stats set to p as one line of JSON, with synthetic "@" ID (idLen bytes) and "+" seq fields,
+// as "sS" set number, "sP" pass and "sV" array of 24 hourly values, null where unset.
+void printStatsSetAsJSON(Print *const p, const uint8_t *const id, const uint8_t idLen, const uint8_t seq, const uint8_t *const body)
+  {
+  p->print(F("{\"@\":\""));
+  printIDHex(p, id, idLen);
+  p->print(F("\",\"+\":"));
+  p->print(seq);
+  p->print(F(",\"sS\":"));
+  p->print(body[2]);
+  p->print(F(",\"sP\":"));
+  p->print(body[3]);
+  p->print(F(",\"sV\":["));
+  for(uint8_t hh = 0; hh < 24; ++hh)
+    {
+    if(0 != hh) { p->print(','); }
+    const uint8_t v = body[4 + hh];
+    if(0xff == v) { p->print(F("null")); } else { p->print(v); }
+    }
+  p->println(F("]}"));
+  }
+#endif // ENABLE_STATS_SET_UPLOAD
+
+#if defined(ENABLE_RADIO_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) // && defined(ENABLE_FAST_FRAMED_CARRIER_SUPPORT)
+// AES-GCM decryption/authentication used for all secure RX, and its state (always NULL).
+// secureFrameDec (see V0p2_Main.h) is selected at build time;
+// with ENABLE_GHASH_TABLE it keeps the GHASH table for the last key between frames itself,
+// otherwise the expanded key and GHASH subkey are recomputed for every frame.
+#if defined(ENABLE_STACK_TAGS)
+// Usual decryption, noting stack depth at the deepest point of the app-visible RX path.
+static bool stackTaggedRXDecrypt(void *const state, const uint8_t *const key, const uint8_t *const iv,
+    const uint8_t *const authtext, const uint8_t authtextSize, const uint8_t *const ciphertext, const uint8_t *const tag,
+    uint8_t *const plaintextOut)
+  {
+  stackTag(STACK_TAG_RX_SECURE);
+  return(secureFrameDec(state, key, iv, authtext, authtextSize, ciphertext, tag, plaintextOut));
+  }
+static constexpr OTRadioLink::SimpleSecureFrame32or0BodyRXBase::fixed32BTextSize12BNonce16BTagSimpleDec_ptr_t rxDecrypt =
+    stackTaggedRXDecrypt;
+#else
+static constexpr OTRadioLink::SimpleSecureFrame32or0BodyRXBase::fixed32BTextSize12BNonce16BTagSimpleDec_ptr_t rxDecrypt =
+    secureFrameDec;
+#endif // ENABLE_STACK_TAGS
+static void *const rxDecryptState = NULL;
+
+#if defined(ENABLE_RX_ISR_ASSOC_FILTER)
+// Two-hash Bloom filter over the first two bytes of each associated node ID.
+// With up to 8 associations at most 16 of 256 bits are set,
+// so well under 1% of frames from strangers with 2+ ID bytes get through.
+// The first hash is just the first ID byte so that 1-byte prefixes can be checked too.
+static volatile uint8_t rxAssocBloom[32];
+static inline uint8_t rxAssocBloomH2(const uint8_t b0, const uint8_t b1) { return((uint8_t)(b1 ^ (b0 << 3) ^ (b0 >> 5) ^ 0xa5)); }
+static inline bool rxAssocBloomGet(const uint8_t h) { return(0 != (rxAssocBloom[h >> 3] & (1 << (h & 7)))); }
+
+bool rxAssocMayMatch(const volatile uint8_t *const prefix, const uint8_t il)
+  {
+  const uint8_t b0 = prefix[0];
+  if(!rxAssocBloomGet(b0)) { return(false); }
+  return((il < 2) || rxAssocBloomGet(rxAssocBloomH2(b0, prefix[1])));
+  }
+#endif // ENABLE_RX_ISR_ASSOC_FILTER
+
+// Print len node ID bytes to p as hex.
+void printIDHex(Print *const p, const uint8_t *const id, const uint8_t len)
+  {
+#if defined(ENABLE_FIXED_HEX_IDS)
+  char buf[2 * OTV0P2BASE::OpenTRV_Node_ID_Bytes];
+  const uint8_t n = (len > OTV0P2BASE::OpenTRV_Node_ID_Bytes) ? OTV0P2BASE::OpenTRV_Node_ID_Bytes : len;
+  p->write((const uint8_t *)buf, putIDHex(buf, id, n));
+#else
+  for(uint8_t i = 0; i < len; ++i) { p->print(id[i], HEX); }
+#endif
+  }
+
+#if defined(ENABLE_RX_ASSOC_INDEX)
+// RAM index of node associations, so that frames from unknown senders
+// and replays can be rejected in constant time
+// before the linear EEPROM association scan and AES in the library decode.
+// The library still performs its own full checks on frames that pass.
+// Open-addressed on the first ID byte, which every secure frame carries,
+// with entries inserted in association order so the first prefix match found
+// is the same one that the library's getNextMatchingNodeID(0, ...) finds.
+static constexpr uint8_t RX_ASSOC_INDEX_SLOTS = 16; // Power of 2 > MAX_NODE_ASSOCIATIONS.
+static_assert(RX_ASSOC_INDEX_SLOTS > OTV0P2BASE::MAX_NODE_ASSOCIATIONS, "index must have a free slot");
+static_assert(0 == (RX_ASSOC_INDEX_SLOTS & (RX_ASSOC_INDEX_SLOTS-1)), "index size must be power of 2");
+typedef struct
+  {
+  bool used;
+  uint8_t id[OTV0P2BASE::OpenTRV_Node_ID_Bytes];
+  uint8_t lastCounter[OTRadioLink::SimpleSecureFrame32or0BodyBase::fullMessageCounterBytes]; // Last authenticated.
+#if defined(ENABLE_DUAL_RX_KEY)
+  bool previousKey; // True if the last frame authenticated was under the previous building key.
+#endif
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK)
+  uint8_t rxOK; // Frames authenticated since last link-quality broadcast; saturating.
+  uint8_t rxMissed; // Counter values skipped since last link-quality broadcast; saturating.
+#endif
+#if defined(ENABLE_FIXED_HEX_IDS)
+  uint8_t assocN; // Index of the association, and of its ID in rxAssocIDHex[].
+#endif
+#if defined(ENABLE_RX_LINK_TABLE)
+  uint16_t rssiQ8; // EWMA of RSSI (RFM23B units, 0.5dB steps, ~dBm*2+240) * 256; 0 until the first sample.
+  uint16_t lossQ8; // EWMA of the % of counter values skipped, ie frames lost, * 256.
+  uint8_t heardM; // Minutes since the last authenticated frame, saturating; 0xff if not heard since rebuild.
+#endif
+  } rxAssocEntry_t;
+static rxAssocEntry_t rxAssocIndex[RX_ASSOC_INDEX_SLOTS];
+#if defined(ENABLE_FIXED_HEX_IDS)
+// Each association's ID as printed, by association index, so output of a sender's ID is a straight copy.
+static char rxAssocIDHex[OTV0P2BASE::MAX_NODE_ASSOCIATIONS][2 * OTV0P2BASE::OpenTRV_Node_ID_Bytes];
+#endif
+
+// Find the first associated node whose ID starts with the il-byte prefix; NULL if none.
+static rxAssocEntry_t *findRXAssoc(const uint8_t *const prefix, const uint8_t il)
+  {
+  if(0 == il) { return(NULL); }
+  for(uint8_t h = prefix[0] & (RX_ASSOC_INDEX_SLOTS-1); rxAssocIndex[h].used; h = (h + 1) & (RX_ASSOC_INDEX_SLOTS-1))
+    { if(0 == memcmp(rxAssocIndex[h].id, prefix, il)) { return(rxAssocIndex + h); } }
+  return(NULL);
+  }
+#endif // ENABLE_RX_ASSOC_INDEX
+
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK)
+#if defined(ENABLE_RX_ASSOC_INDEX)
+static constexpr uint8_t LINK_QUALITY_MAX_ENTRIES = OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE / 3;
+void linkQualityBroadcastTX()
+  {
+  if(!inHubMode()) { return; }
+  uint8_t body[3 * LINK_QUALITY_MAX_ENTRIES];
+  uint8_t bl = 0;
+  for(uint8_t h = 0; h < RX_ASSOC_INDEX_SLOTS; ++h)
+    {
+    rxAssocEntry_t &e = rxAssocIndex[h];
+    if(!e.used || (0 == e.rxOK)) { continue; } // Nothing heard, so nothing useful to say.
+    if(bl + 3 > sizeof(body)) { break; }
+    body[bl++] = e.id[0];
+    body[bl++] = e.id[1];
+    body[bl++] = (uint8_t)((100U * e.rxMissed) / (e.rxOK + e.rxMissed));
+    // Start a new window, but keep 'first frame' detection off for this node.
+    e.rxOK = 1;
+    e.rxMissed = 0;
+    }
+  if(0 == bl) { return; }
+  uint8_t key[16];
+  if(!getPrimaryBuildingKey(key)) { return; }
+  // Encrypted bodies are always padded to the fixed ciphertext size.
+  uint8_t buf[27 + OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES + OTRadioLink::ENC_BODY_SMALL_FIXED_CTEXT_SIZE];
+  uint8_t fl;
+  {
+  const CPUClockBoost boost;
+  fl = secureTX().generateSecureOStyleFrameForTX(
+        buf, sizeof(buf), (OTRadioLink::FrameType_Secureable)FTS_LINK_QUALITY_LOCAL, OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES,
+        body, bl, secureFrameEnc, NULL, key);
+  }
+  // DO NOT attempt to send if the secure frame could not be built (risks IV reuse).
+  // ASSUME FRAMED CHANNEL 0, so do not send the leading length byte.
+  if(0 != fl) { ENERGY_ACCOUNT(EA_TX, PrimaryRadio.sendRaw(buf+1, fl-1, primaryRadioChannel())); }
+  }
+#endif // ENABLE_RX_ASSOC_INDEX
+
+// Leaf: last loss % reported for this node by the hub, and its age in minutes (0xff if none or stale).
+static uint8_t linkFeedbackLossPC;
+static uint8_t linkFeedbackAgeM = 0xff;
+// Leaf: RTC minute (mod 4) and seconds at which the last feedback arrived; the hub sends once every 4 minutes.
+static uint8_t linkFeedbackMinute;
+static uint8_t linkFeedbackSeconds;
+// Feedback older than this is ignored; a few of the hub's broadcasts may be missed.
+static constexpr uint8_t LINK_FEEDBACK_MAX_AGE_M = 20;
+// Loss at or above which double TX is worthwhile, and below which one copy is enough.
+static constexpr uint8_t LINK_FEEDBACK_DOUBLE_TX_LOSS_PC = 10;
+static constexpr uint8_t LINK_FEEDBACK_SINGLE_TX_LOSS_PC = 2;
+void ageLinkQualityFeedback() { if(linkFeedbackAgeM < 0xff) { ++linkFeedbackAgeM; } }
+bool linkQualityWantsRX()
+  {
+  if(inHubMode()) { return(false); }
+  const uint16_t m = OTV0P2BASE::getMinutesSinceMidnightLT();
+  if(linkFeedbackAgeM > LINK_FEEDBACK_MAX_AGE_M) { return((m & 63) < 4); }
+  if(linkFeedbackAgeM < LINK_FEEDBACK_MAX_AGE_M/2) { return(false); }
+  // The local RTC drifts little from the hub's over a few minutes.
+  const uint8_t s = OTV0P2BASE::getSecondsLT();
+  return(((m & 3) == linkFeedbackMinute) && (s + 4 >= linkFeedbackSeconds) && (s <= linkFeedbackSeconds + 2));
+  }
+bool linkQualityWantsDoubleTX(const bool dflt)
+  {
+  if(linkFeedbackAgeM > LINK_FEEDBACK_MAX_AGE_M) { return(dflt); }
+  if(linkFeedbackLossPC >= LINK_FEEDBACK_DOUBLE_TX_LOSS_PC) { return(true); }
+  if(linkFeedbackLossPC < LINK_FEEDBACK_SINGLE_TX_LOSS_PC) { return(false); }
+  return(dflt);
+  }
+// Pick out this node's entry, if any, from an authenticated link-quality body.
+static void handleLinkQualityFeedback(const uint8_t *const body, const uint8_t bl)
+  {
+  for(uint8_t i = 0; i + 3 <= bl; i += 3)
+    {
+    if((body[i] != getNodeIDByte(0)) || (body[i+1] != getNodeIDByte(1))) { continue; }
+    linkFeedbackLossPC = body[i+2];
+    linkFeedbackAgeM = 0;
+    linkFeedbackMinute = (uint8_t)(OTV0P2BASE::getMinutesSinceMidnightLT() & 3);
+    linkFeedbackSeconds = OTV0P2BASE::getSecondsLT();
+    return;
+    }
+  }
+#endif // ENABLE_LINK_QUALITY_FEEDBACK
+
+#if defined(ENABLE_TIME_SYNC_BEACON)
+static constexpr uint8_t TIME_SYNC_MAX_ENTRIES = (OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE - 2) / 3;
+void timeSyncBroadcastTX(const uint8_t minutePhase)
+  {
+  if(!inHubMode()) { return; }
+  uint8_t body[2 + 3 * TIME_SYNC_MAX_ENTRIES];
+  uint8_t bl = 2;
+  // Slots are given out in association order, so up to 8 leaves never share one.
+  const uint8_t n = OTV0P2BASE::countNodeAssociations();
+  for(uint8_t i = 0; (i < n) && (bl + 3 <= sizeof(body)); ++i)
+    {
+    uint8_t id[OTV0P2BASE::OpenTRV_Node_ID_Bytes];
+    if(!OTV0P2BASE::getNodeAssociation(i, id)) { continue; }
+    body[bl++] = id[0];
+    body[bl++] = id[1];
+    body[bl++] = i & 7;
+    }
+  uint8_t key[16];
+  if(!getPrimaryBuildingKey(key)) { return; }
+  // Encrypted bodies are always padded to the fixed ciphertext size.
+  uint8_t buf[27 + OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES + OTRadioLink::ENC_BODY_SMALL_FIXED_CTEXT_SIZE];
+  uint8_t fl;
+  {
+  const CPUClockBoost boost;
+  body[0] = OTV0P2BASE::getSecondsLT();
+  body[1] = minutePhase & 3;
+  fl = secureTX().generateSecureOStyleFrameForTX(
+        buf, sizeof(buf), (OTRadioLink::FrameType_Secureable)FTS_TIME_SYNC_LOCAL, OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES,
+        body, bl, secureFrameEnc, NULL, key);
+  }
+  // DO NOT attempt to send if the secure frame could not be built (risks IV reuse).
+  // ASSUME FRAMED CHANNEL 0, so do not send the leading length byte.
+  if(0 != fl) { ENERGY_ACCOUNT(EA_TX, PrimaryRadio.sendRaw(buf+1, fl-1, primaryRadioChannel())); }
+  }
+
+// Pick out this node's slot, if any, from an authenticated time-sync body.
+static void handleTimeSync(const uint8_t *const body, const uint8_t bl)
+  {
+  if(bl < 2) { return; }
+  uint8_t slot = 0xff;
+  for(uint8_t i = 2; i + 3 <= bl; i += 3)
+    {
+    if((body[i] != getNodeIDByte(0)) || (body[i+1] != getNodeIDByte(1))) { continue; }
+    slot = body[i+2];
+    break;
+    }
+  timeSyncRX(body[0], body[1], slot);
+  }
+#endif // ENABLE_TIME_SYNC_BEACON
+
+#if defined(ENABLE_SECURE_TX_ACK)
+// Sub-cycle ticks (~8ms) that a leaf listens for an ACK: time for the hub to authenticate, encrypt and send.
+static constexpr uint8_t TX_ACK_WINDOW_SCT = 24;
+// Resends of an unacknowledged frame.
+static constexpr uint8_t TX_ACK_RETRIES = 1;
+// Leaf: tag prefix of the frame awaiting an ACK, and whether it has been seen.
+static uint8_t txAckAwaitedTag[TX_ACK_TAG_BYTES];
+static bool txAckSeen;
+
+bool primaryRadioSendAcked(const uint8_t *const frame, const uint8_t len)
+  {
+  if(len < SECURE_FRAME_0X80_TRAILER_BYTES) { return(false); }
+  // With no hub associated no ACK can be authenticated, so fall back to blind double TX rather than always resending.
+  if(0 == OTV0P2BASE::countNodeAssociations())
+    {
+    bool queued;
+    ENERGY_ACCOUNT(EA_TX, queued = PrimaryRadio.queueToSend(frame, len, primaryRadioChannel(), OTRadioLink::OTRadioLink::TXmax));
+    return(queued);
+    }
+  memcpy(txAckAwaitedTag, secureFrameTag(frame, len), TX_ACK_TAG_BYTES);
+  const int8_t oldListenChannel = PrimaryRadio.getListenChannel();
+  bool sent = false;
+  txAckSeen = false;
+  for(uint8_t i = 0; i <= TX_ACK_RETRIES; ++i)
+    {
+    bool queued;
+    ENERGY_ACCOUNT(EA_TX, queued = PrimaryRadio.queueToSend(frame, len, primaryRadioChannel()));
+    if(!queued) { break; }
+    sent = true;
+    PrimaryRadio.listen(true, primaryRadioChannel());
+    const uint8_t start = OTV0P2BASE::getSubCycleTime();
+    while(!txAckSeen && ((uint8_t)(OTV0P2BASE::getSubCycleTime() - start) < TX_ACK_WINDOW_SCT))
+      { if(!handleQueuedMessages(&Serial, true, &PrimaryRadio)) { OTV0P2BASE::nap(WDTO_15MS, true); } }
+    if(txAckSeen) { break; }
+    }
+  PrimaryRadio.listen(oldListenChannel >= 0, (oldListenChannel >= 0) ? oldListenChannel : 0);
+  // Make sure that a late ACK cannot match.
+  txAckAwaitedTag[0] = ~txAckAwaitedTag[0];
+  return(sent);
+  }
+
+#if defined(ENABLE_REMOTE_DIAG)
+bool remoteDiagPending;
+// Hub: node to request diagnostics from, while remoteDiagTargetSet.
+static uint8_t remoteDiagTarget[OTV0P2BASE::OpenTRV_Node_ID_Bytes];
+static bool remoteDiagTargetSet;
+
+bool remoteDiagRequest(const uint8_t n)
+  {
+  if(n >= V0P2BASE_EE_NODE_ASSOCIATIONS_MAX_SETS) { return(false); }
+  const uint8_t *const id = (const uint8_t *)(V0P2BASE_EE_START_NODE_ASSOCIATIONS + (uint16_t)n * V0P2BASE_EE_NODE_ASSOCIATIONS_SET_SIZE);
+  if(0xff == eeprom_read_byte(id)) { return(false); }
+  eeprom_read_block(remoteDiagTarget, id, sizeof(remoteDiagTarget));
+  remoteDiagTargetSet = true;
+  return(true);
+  }
+
+// Leaf: send the diagnostics frame requested by the hub.
+static void remoteDiagTX()
+  {
+  remoteDiagPending = false;
+  uint8_t body[REMOTE_DIAG_BODY_LEN];
+  remoteDiagBody(body);
+  uint8_t key[16];
+  if(!getPrimaryBuildingKey(key)) { return; }
+  // Encrypted bodies are always padded to the fixed ciphertext size.
+  uint8_t buf[27 + OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES + OTRadioLink::ENC_BODY_SMALL_FIXED_CTEXT_SIZE];
+  uint8_t fl;
+  {
+  const CPUClockBoost boost;
+  fl = secureTX().generateSecureOStyleFrameForTX(
+        buf, sizeof(buf), (OTRadioLink::FrameType_Secureable)FTS_DIAG_LOCAL, OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES,
+        body, sizeof(body), secureFrameEnc, NULL, key);
+  }
+  // DO NOT attempt to send if the secure frame could not be built (risks IV reuse).
+  // ASSUME FRAMED CHANNEL 0, so do not send the leading length byte.
+  if(0 != fl) { ENERGY_ACCOUNT(EA_TX, PrimaryRadio.queueToSend(buf+1, fl-1, primaryRadioChannel())); }
+  }
+
+bool remoteDiagTXIfPending()
+  {
+  if(!remoteDiagPending) { return(false); }
+  remoteDiagTX();
+  return(true);
+  }
+
+// Hub: stop requesting a leaf's diagnostics once they arrive, and relay or print them.
+static void handleRemoteDiag(const uint8_t *const msg, const uint8_t msglen,
+    const uint8_t *const id, const uint8_t seq, const uint8_t *const body, const uint8_t bl)
+  {
+  if(!inHubMode() || (bl < REMOTE_DIAG_BODY_LEN)) { return; }
+  if(0 == memcmp(id, remoteDiagTarget, sizeof(remoteDiagTarget))) { remoteDiagTargetSet = false; }
+#if defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+  (void) seq; (void) body;
+  relayFrame(msg, msglen); // Not one of the leaf frames that a hub summary replaces.
+#else
+  (void) msg; (void) msglen;
+  Serial.print(F("{\"@\":\""));
+  printIDHex(&Serial, id, OTV0P2BASE::OpenTRV_Node_ID_Bytes);
+  Serial.print(F("\",\"+\":"));
+  Serial.print(seq);
+  Serial.print(F(",\"dg\":\""));
+  for(uint8_t i = 0; i < REMOTE_DIAG_BODY_LEN; ++i)
+    {
+    if(body[i] < 16) { Serial.print('0'); }
+    Serial.print(body[i], HEX);
+    }
+  Serial.println(F("\"}"));
+  OTV0P2BASE::flushSerialProductive();
+#endif // ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY
+  }
+#endif // ENABLE_REMOTE_DIAG
+
+#if defined(ENABLE_STATS_KEY_SUBSCRIPTION)
+void statsSubscriptionSet(const uint8_t keys)
+  { eeQueueUpdateByte(EEW_CONFIG, (uint8_t *)V0P2_EE_START_STATS_SUBSCRIPTION, keys); }
+bool statsKeyWanted(const uint8_t key)
+  { return(0 != (eeQueuedReadByte((const uint8_t *)V0P2_EE_START_STATS_SUBSCRIPTION) & key)); }
+#endif // ENABLE_STATS_KEY_SUBSCRIPTION
+
+// Leaf: note an authenticated ACK and pick up the hub's time.
+static void handleHubAck(const uint8_t *const body, const uint8_t bl)
+  {
+  if((bl < TX_ACK_TAG_BYTES + 2) || (0 != memcmp(body, txAckAwaitedTag, TX_ACK_TAG_BYTES))) { return; }
+  txAckSeen = true;
+#if defined(ENABLE_REMOTE_DIAG)
+  if((bl > TX_ACK_TAG_BYTES + 2) && (0 != (body[TX_ACK_TAG_BYTES + 2] & REMOTE_DIAG_REQ))) { remoteDiagPending = true; }
+#endif
+#if defined(ENABLE_STATS_KEY_SUBSCRIPTION)
+  // Only written when it changes, so ACKs cost no EEPROM wear.
+  if(bl > TX_ACK_TAG_BYTES + 3) { statsSubscriptionSet(body[TX_ACK_TAG_BYTES + 3]); }
+#endif
+  const uint_least16_t m = ((uint_least16_t)body[TX_ACK_TAG_BYTES] << 8) | body[TX_ACK_TAG_BYTES + 1];
+  if((m < 24*60) && (m != OTV0P2BASE::getMinutesSinceMidnightLT()))
+    { OTV0P2BASE::setHoursMinutesLT((uint8_t)(m / 60), (uint8_t)(m % 60)); }
+  }
+
+// Hub: acknowledge an authenticated frame with the 0x80 trailer, reusing the RX key.
+static void hubAckTX(const uint8_t *const msg, const uint8_t msglen, const uint8_t *const key, const uint8_t *const senderNodeID)
+  {
+  if(!inHubMode() || (msglen < SECURE_FRAME_0X80_TRAILER_BYTES)) { return; }
+#if defined(ENABLE_STATS_KEY_SUBSCRIPTION)
+  // The request byte is always present ahead of the subscription.
+  uint8_t body[TX_ACK_TAG_BYTES + 4];
+  body[TX_ACK_TAG_BYTES + 3] = eeprom_read_byte((uint8_t *)V0P2_EE_START_STATS_SUBSCRIPTION);
+#elif defined(ENABLE_REMOTE_DIAG)
+  uint8_t body[TX_ACK_TAG_BYTES + 3];
+#else
+  (void) senderNodeID;
+  uint8_t body[TX_ACK_TAG_BYTES + 2];
+#endif
+#if defined(ENABLE_REMOTE_DIAG)
+  body[TX_ACK_TAG_BYTES + 2] = (remoteDiagTargetSet && (0 == memcmp(senderNodeID, remoteDiagTarget, sizeof(remoteDiagTarget)))) ? REMOTE_DIAG_REQ : 0;
+#elif defined(ENABLE_STATS_KEY_SUBSCRIPTION)
+  (void) senderNodeID;
+  body[TX_ACK_TAG_BYTES + 2] = 0;
+#endif
+  memcpy(body, secureFrameTag(msg, msglen), TX_ACK_TAG_BYTES);
+  const uint_least16_t m = OTV0P2BASE::getMinutesSinceMidnightLT();
+  body[TX_ACK_TAG_BYTES] = (uint8_t)(m >> 8);
+  body[TX_ACK_TAG_BYTES + 1] = (uint8_t)m;
+  // Encrypted bodies are always padded to the fixed ciphertext size.
+  uint8_t buf[27 + OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES + OTRadioLink::ENC_BODY_SMALL_FIXED_CTEXT_SIZE];
+  uint8_t fl;
+  {
+  const CPUClockBoost boost;
+  fl = secureTX().generateSecureOStyleFrameForTX(
+        buf, sizeof(buf), (OTRadioLink::FrameType_Secureable)FTS_ACK_LOCAL, OTRadioLink::ENC_BODY_DEFAULT_ID_BYTES,
+        body, sizeof(body), secureFrameEnc, NULL, key);
+  }
+  // DO NOT attempt to send if the secure frame could not be built (risks IV reuse).
+  // ASSUME FRAMED CHANNEL 0, so do not send the leading length byte.
+  if(0 != fl) { ENERGY_ACCOUNT(EA_TX, PrimaryRadio.sendRaw(buf+1, fl-1, primaryRadioChannel())); }
+  }
+#endif // ENABLE_SECURE_TX_ACK
+
+#if defined(ENABLE_RX_LINK_TABLE)
+#if defined(ENABLE_RADIO_PRIMARY_RFM23B)
+// RSSI sampled by the RX ISR for recently queued frames, keyed by their RX queue buffer address.
+// The RFM23B does not latch RSSI at sync detect, so it is sampled as the frame is unloaded,
+// before the radio is restarted; this is at the very end of the frame so may read a little low.
+// More slots than the RX queue can hold ensures that any frame still queued has its entry.
+static constexpr uint8_t RX_RSSI_SLOTS = 8;
+static_assert(RX_RSSI_SLOTS > RFM23B_RX_QUEUE_SIZE, "RSSI must outlive queued frames");
+static_assert(0 == (RX_RSSI_SLOTS & (RX_RSSI_SLOTS-1)), "RSSI slots must be power of 2");
+static const volatile uint8_t *volatile rxRSSIBuf[RX_RSSI_SLOTS];
+static volatile uint8_t rxRSSIVal[RX_RSSI_SLOTS];
+static volatile uint8_t rxRSSINext;
+void rxNoteRSSIISR(const volatile uint8_t *const buf)
+  {
+  const uint8_t i = rxRSSINext;
+  rxRSSIBuf[i] = buf;
+  rxRSSIVal[i] = RFM23B.getRSSI();
+  rxRSSINext = (i + 1) & (RX_RSSI_SLOTS-1);
+  }
+// RSSI of the queued frame at buf, or 0 if not known (eg a replayed frame or one from another queue).
+static uint8_t rxRSSIFor(const uint8_t *const buf)
+  {
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+    {
+    // Newest first, in case an old entry names the same buffer.
+    uint8_t i = rxRSSINext;
+    for(uint8_t n = RX_RSSI_SLOTS; n-- > 0; )
+      {
+      i = (i - 1) & (RX_RSSI_SLOTS-1);
+      if(buf == rxRSSIBuf[i]) { return(rxRSSIVal[i]); }
+      }
+    }
+  return(0);
+  }
+#else
+#define rxRSSIFor(buf) ((uint8_t)0)
+#endif // ENABLE_RADIO_PRIMARY_RFM23B
+
+// Fold an authenticated frame into the sender's link entry.
+// gap is the number of counter values skipped since the previous frame, and rssi is 0 if unknown.
+static void noteRXLink(rxAssocEntry_t &e, const uint8_t gap, const uint8_t rssi)
+  {
+  if(0 != rssi) { e.rssiQ8 = (0 == e.rssiQ8) ? (uint16_t)((uint16_t)rssi << 8) : (uint16_t)(e.rssiQ8 - (e.rssiQ8 >> 2) + (rssi << 6)); }
+  // Ignore the first frame seen and any big jump (eg reboot), and weight later ones by 1/8.
+  if((0xff != e.heardM) && (gap < 64))
+    {
+    const uint8_t lossPC = (uint8_t)((100U * gap) / (gap + 1U));
+    e.lossQ8 = (uint16_t)(e.lossQ8 - (e.lossQ8 >> 3) + (lossPC << 5));
+    }
+  e.heardM = 0;
+  }
+
+void ageRXLinkTable()
+  {
+  for(uint8_t h = 0; h < RX_ASSOC_INDEX_SLOTS; ++h)
+    { if(rxAssocIndex[h].heardM < 0xfe) { ++rxAssocIndex[h].heardM; } }
+  }
+
+// Longest rxLinkJSON() output, excluding the terminating '\0'.
+static constexpr uint8_t RX_LINK_JSON_MAX = 55;
+static uint8_t rxLinkPutDec(char *const buf, uint8_t n, const uint8_t v)
+  {
+  if(v >= 100) { buf[n++] = '0' + (v / 100); }
+  if(v >= 10) { buf[n++] = '0' + ((v / 10) % 10); }
+  buf[n++] = '0' + (v % 10);
+  return(n);
+  }
+static uint8_t rxLinkPutP(char *const buf, const uint8_t n, const char *const s)
+  {
+  strcpy_P(buf + n, s);
+  return(n + strlen_P(s));
+  }
+// Write {"@":"<ID>","rS":<RSSI>,"rL|%":<loss %>,"rA|m":<minutes since heard>} for e into buf
+// (at least RX_LINK_JSON_MAX+1 bytes), with the ID as elsewhere in hub output; returns the length.
+static uint8_t rxLinkJSON(char *const buf, const rxAssocEntry_t &e)
+  {
+  uint8_t n = rxLinkPutP(buf, 0, PSTR("{\"@\":\""));
+#if defined(ENABLE_FIXED_HEX_IDS)
+  memcpy(buf + n, rxAssocIDHex[e.assocN], sizeof(rxAssocIDHex[0]));
+  n += sizeof(rxAssocIDHex[0]);
+#else
+  for(uint8_t i = 0; i < sizeof(e.id); ++i)
+    {
+    // As Serial.print(b, HEX), ie with no leading zero.
+    const uint8_t hi = e.id[i] >> 4, lo = e.id[i] & 0xf;
+    if(0 != hi) { buf[n++] = (hi < 10) ? ('0' + hi) : ('A' - 10 + hi); }
+    buf[n++] = (lo < 10) ? ('0' + lo) : ('A' - 10 + lo);
+    }
+#endif
+  n = rxLinkPutP(buf, n, PSTR("\",\"rS\":"));
+  n = rxLinkPutDec(buf, n, (uint8_t)(e.rssiQ8 >> 8));
+  n = rxLinkPutP(buf, n, PSTR(",\"rL|%\":"));
+  n = rxLinkPutDec(buf, n, (uint8_t)(e.lossQ8 >> 8));
+  n = rxLinkPutP(buf, n, PSTR(",\"rA|m\":"));
+  n = rxLinkPutDec(buf, n, e.heardM);
+  buf[n++] = '}';
+  buf[n] = '\0';
+  return(n);
+  }
+
+void rxLinkTableDump()
+  {
+  char buf[RX_LINK_JSON_MAX + 1];
+  for(uint8_t h = 0; h < RX_ASSOC_INDEX_SLOTS; ++h)
+    {
+    if(!rxAssocIndex[h].used) { continue; }
+    rxLinkJSON(buf, rxAssocIndex[h]);
+    OTV0P2BASE::serialPrintlnAndFlush(buf);
+    }
+  }
+
+#if defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+void rxLinkTableRelay()
+  {
+  char buf[RX_LINK_JSON_MAX + 1];
+  for(uint8_t h = 0; h < RX_ASSOC_INDEX_SLOTS; ++h)
+    {
+    // Nodes never heard have nothing to say.
+    if(!rxAssocIndex[h].used || (0xff == rxAssocIndex[h].heardM)) { continue; }
+    relayFrame((const uint8_t *)buf, rxLinkJSON(buf, rxAssocIndex[h]));
+    }
+  }
+#endif // ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY
+#endif // ENABLE_RX_LINK_TABLE
+
+#if defined(ENABLE_RX_ASSOC_INDEX) || defined(ENABLE_RX_ISR_ASSOC_FILTER)
+void rebuildRXAssocIndex()
+  {
+#if defined(ENABLE_RX_ASSOC_INDEX)
+  memset(rxAssocIndex, 0, sizeof(rxAssocIndex));
+  OTRadioLink::SimpleSecureFrame32or0BodyRXV0p2 &r = OTRadioLink::SimpleSecureFrame32or0BodyRXV0p2::getInstance();
+#endif
+#if defined(ENABLE_RX_ISR_ASSOC_FILTER)
+  uint8_t bloom[sizeof(rxAssocBloom)];
+  memset(bloom, 0, sizeof(bloom));
+#endif
+  const uint8_t n = OTV0P2BASE::countNodeAssociations();
+  for(uint8_t i = 0; i < n; ++i)
+    {
+    uint8_t id[OTV0P2BASE::OpenTRV_Node_ID_Bytes];
+    if(!OTV0P2BASE::getNodeAssociation(i, id)) { continue; }
+#if defined(ENABLE_RX_ISR_ASSOC_FILTER)
+    bloom[id[0] >> 3] |= (uint8_t)(1 << (id[0] & 7));
+    const uint8_t h2 = rxAssocBloomH2(id[0], id[1]);
+    bloom[h2 >> 3] |= (uint8_t)(1 << (h2 & 7));
+#endif
+#if defined(ENABLE_RX_ASSOC_INDEX)
+    uint8_t h = id[0] & (RX_ASSOC_INDEX_SLOTS-1);
+    while(rxAssocIndex[h].used) { h = (h + 1) & (RX_ASSOC_INDEX_SLOTS-1); }
+    rxAssocEntry_t &e = rxAssocIndex[h];
+    memcpy(e.id, id, sizeof(e.id));
+#if defined(ENABLE_FIXED_HEX_IDS)
+    e.assocN = i;
+    putIDHex(rxAssocIDHex[i], id, sizeof(id));
+#endif
+    // If the counter cannot be read leave it as zero, so the library makes the decision.
+    if(!r.getLastRXMessageCounter(id, e.lastCounter)) { memset(e.lastCounter, 0, sizeof(e.lastCounter)); }
+#if defined(ENABLE_RX_LINK_TABLE)
+    e.heardM = 0xff;
+#endif
+    e.used = true;
+#endif
+    }
+#if defined(ENABLE_RX_ISR_ASSOC_FILTER)
+  // Swap in the new filter atomically with respect to the RX ISR.
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+    { for(uint8_t i = 0; i < sizeof(bloom); ++i) { rxAssocBloom[i] = bloom[i]; } }
+#endif
+  }
+#endif // ENABLE_RX_ASSOC_INDEX || ENABLE_RX_ISR_ASSOC_FILTER
+
+#if defined(ENABLE_RX_DECRYPT_SESSION)
+// Secure RX decryption session.
+// While one is open the building key is fetched at most once, for the first secure frame,
+// and used for all further frames; on close it and anything derived from it (eg the GHASH table) are wiped.
+// So a whole RX batch pays for one key fetch (and one GHASH table build),
+// and the secrets are only live in RAM for that bounded window.
+// The key shares the scratch arena RX key region if there is one, as that is otherwise dead between frames.
+static constexpr uint8_t RX_SESSION_KEY_NONE = 0; // Not yet fetched in this session.
+static constexpr uint8_t RX_SESSION_KEY_OK = 1;
+static constexpr uint8_t RX_SESSION_KEY_MISSING = 2; // No key set; do not retry in this session.
+static uint8_t rxSessionKeyState;
+#if defined(ENABLE_SCRATCH_ARENA)
+static inline uint8_t (&rxSessionKey())[16] { return(scratchRegion<SCRATCH_RX_KEY_OFF, SCRATCH_KEY_SIZE>()); }
+#else
+static uint8_t rxSessionKeyBuf[16];
+static inline uint8_t (&rxSessionKey())[16] { return(rxSessionKeyBuf); }
+#endif
+// Wipe the session's key and return it to the not-yet-fetched state.
+static void rxSessionKeyWipe()
+  {
+  if(RX_SESSION_KEY_NONE == rxSessionKeyState) { return; } // Nothing to wipe.
+  rxSessionKeyState = RX_SESSION_KEY_NONE;
+  // Volatile writes so that the wipe cannot be optimised away.
+  volatile uint8_t *p = rxSessionKey();
+  for(uint8_t i = 16; i-- > 0; ) { *p++ = 0; }
+#if defined(ENABLE_GHASH_TABLE)
+  ghashTableWipe();
+#endif
+  }
+class RXDecryptSession final
+  {
+  public:
+    RXDecryptSession() { }
+    ~RXDecryptSession() { rxSessionKeyWipe(); }
+    RXDecryptSession(const RXDecryptSession &) = delete;
+    RXDecryptSession &operator=(const RXDecryptSession &) = delete;
+  };
+#endif // ENABLE_RX_DECRYPT_SESSION
+
+// Cheap structural checks of a secure frame, as the library makes only just before decrypting:
+// the 0x80-style trailer (SECURE_FRAME_0X80_TRAILER_BYTES) within the buffer, an empty or fixed-size encrypted body
+// (or the single-block body of a short valve frame),
+// and the header sequence number matching the 4 lsbs of the message counter at the start of the trailer.
+// buf is the whole frame including the leading length byte, of buflen bytes.
+static bool rxSecureFramePrecheck(const OTRadioLink::SecurableFrameHeader &sfh, const uint8_t *const buf, const uint8_t buflen)
+  {
+  const uint8_t fl = sfh.fl;
+  if(fl >= buflen) { return(false); }
+  if(SECURE_FRAME_0X80_TRAILER_BYTES != sfh.getTl()) { return(false); }
+  if(0x80 != buf[fl]) { return(false); }
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME)
+  const bool valveShortBody = ((FTS_VALVE_SHORT_LOCAL | 0x80) == sfh.fType) && (VALVE_SHORT_FRAME_BODY_SIZE == sfh.bl);
+#else
+  const bool valveShortBody = false;
+#endif
+  if((0 != sfh.bl) && (OTRadioLink::ENC_BODY_SMALL_FIXED_CTEXT_SIZE != sfh.bl) && !valveShortBody) { return(false); }
+  if(sfh.getSeq() != (buf[sfh.getTrailerOffset() + OTRadioLink::SimpleSecureFrame32or0BodyBase::fullMessageCounterBytes - 1] & 0xf)) { return(false); }
+  return(true);
+  }
+
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME)
+// As SimpleSecureFrame32or0BodyRXV0p2::decodeSecureSmallFrameSafely() but for a short valve frame, which the library rejects.
+// Looks up the sender, checks the message counter, authenticates and decrypts, and updates the counter if successful.
+// buf is the whole frame including the leading length byte, already checked by rxSecureFramePrecheck().
+// Writes the unpadded body to bodyOut (at least VALVE_SHORT_FRAME_BODY_SIZE bytes) and the full sender ID to senderNodeID.
+static bool decodeValveShortFrame(const OTRadioLink::SecurableFrameHeader &sfh, const uint8_t *const buf, const uint8_t *const key,
+    uint8_t *const bodyOut, uint8_t &bodyOutSize, uint8_t *const senderNodeID)
+  {
+  if(VALVE_SHORT_FRAME_BODY_SIZE != sfh.bl) { return(false); }
+  if(OTV0P2BASE::getNextMatchingNodeID(0, sfh.id, sfh.getIl(), senderNodeID) < 0) { return(false); }
+  OTRadioLink::SimpleSecureFrame32or0BodyRXV0p2 &rx = OTRadioLink::SimpleSecureFrame32or0BodyRXV0p2::getInstance();
+  const uint8_t *const counter = buf + sfh.getTrailerOffset();
+  if(!rx.validateRXMessageCount(senderNodeID, counter)) { return(false); }
+  uint8_t iv[12];
+  memcpy(iv, senderNodeID, 6);
+  memcpy(iv + 6, counter, OTRadioLink::SimpleSecureFrame32or0BodyBase::fullMessageCounterBytes);
+  if(!valveShortFrameGCM(true, key, iv, buf, sfh.getHl(), buf + sfh.getBodyOffset(), bodyOut, buf + sfh.fl - SECURE_FRAME_TAG_BYTES, NULL)) { return(false); }
+  const uint8_t paddingZeros = bodyOut[VALVE_SHORT_FRAME_BODY_SIZE - 1];
+  if(paddingZeros > VALVE_SHORT_FRAME_BODY_SIZE - 1) { return(false); }
+  bodyOutSize = VALVE_SHORT_FRAME_BODY_SIZE - 1 - paddingZeros;
+  return(rx.updateRXMessageCountAfterAuthentication(senderNodeID, counter));
+  }
+#endif // ENABLE_SECURE_VALVE_SHORT_FRAME
+
+#if defined(ENABLE_RELAY_JSON_FILTER)
+// Keys passed upstream from received JSON stats, each optionally renamed to something shorter
+// that the upstream server maps back; all other keys are dropped.
+// Edit to suit the server: out NULL keeps the key as sent.
+typedef struct { const char *key; const char *out; } jsonKeyRule_t;
+static const char jkAt[] PROGMEM = "@";
+static const char jkSeq[] PROGMEM = "+";
+static const char jkTemp[] PROGMEM = "T|C16";
+static const char jkRH[] PROGMEM = "H|%";
+static const char jkOcc[] PROGMEM = "O";
+static const char jkLight[] PROGMEM = "L";
+static const char jkValve[] PROGMEM = "v|%";
+static const char jkTarget[] PROGMEM = "tT|C";
+static const char jkSetback[] PROGMEM = "tS|C";
+static const char jkSupply[] PROGMEM = "B|cV";
+static const char jkVac[] PROGMEM = "vac|h";
+static const char jkVacOut[] PROGMEM = "vh";
+static const char jkErr[] PROGMEM = "err";
+static const jsonKeyRule_t jsonKeyRules[] PROGMEM =
+  {
+  { jkAt, NULL }, { jkSeq, NULL }, { jkTemp, NULL }, { jkRH, NULL }, { jkOcc, NULL }, { jkLight, NULL },
+  { jkValve, NULL }, { jkTarget, NULL }, { jkSetback, NULL }, { jkSupply, NULL }, { jkVac, jkVacOut }, { jkErr, NULL },
+  };
+// Output name (in flash) for key k of length kl, or NULL if not allowed.
+static const char *jsonKeyOut(const uint8_t *const k, const uint8_t kl)
+  {
+  for(uint8_t r = 0; r < sizeof(jsonKeyRules)/sizeof(jsonKeyRules[0]); ++r)
+    {
+    const char *const key = (const char *)pgm_read_word(&jsonKeyRules[r].key);
+    if((kl != strlen_P(key)) || (0 != strncmp_P((const char *)k, key, kl))) { continue; }
+    const char *const out = (const char *)pgm_read_word(&jsonKeyRules[r].out);
+    return((NULL != out) ? out : key);
+    }
+  return(NULL);
+  }
+// Filter and rewrite in place the flat JSON fields in buf[0,len), ie "key":value pairs separated by commas
+// with no enclosing braces, in one pass; returns the new length.
+// Renamed keys are never longer, so output never overtakes input and no second copy is needed.
+// Stops (keeping what has been written) at anything malformed.
+static uint8_t filterJSONFields(uint8_t *const buf, const uint8_t len)
+  {
+  uint8_t o = 0;
+  uint8_t i = 0;
+  while(i < len)
+    {
+    if('"' != buf[i]) { break; }
+    const uint8_t ks = ++i;
+    while((i < len) && ('"' != buf[i])) { ++i; }
+    const uint8_t kl = i - ks;
+    if((++i >= len) || (':' != buf[i])) { break; }
+    const uint8_t vs = ++i;
+    bool quoted = false;
+    while((i < len) && (quoted || (',' != buf[i]))) { if('"' == buf[i]) { quoted = !quoted; } ++i; }
+    const uint8_t vl = i - vs;
+    ++i; // Past the comma, if any.
+    const char *const out = jsonKeyOut(buf + ks, kl);
+    if(NULL == out) { continue; }
+    if(0 != o) { buf[o++] = ','; }
+    buf[o++] = '"';
+    for(const char *p = out; '\0' != pgm_read_byte(p); ++p) { buf[o++] = pgm_read_byte(p); }
+    buf[o++] = '"';
+    buf[o++] = ':';
+    for(uint8_t j = 0; j < vl; ++j) { buf[o++] = buf[vs + j]; }
     }
-#endif
+  return(o);
+  }
+#endif // ENABLE_RELAY_JSON_FILTER
 
-  if(NULL != trailer)
-    {
-#if 0 && defined(DEBUG)
-p->print("FS20 msg HC "); p->print(command.hc1); p->print(' '); p->println(command.hc2);
+// Print the full ID of an authenticated sender to Serial, from its cached string where there is one.
+static inline void printSenderIDHex(const uint8_t *const id)
+  {
+#if defined(ENABLE_FIXED_HEX_IDS) && defined(ENABLE_RX_ASSOC_INDEX)
+  const rxAssocEntry_t *const e = findRXAssoc(id, OTV0P2BASE::OpenTRV_Node_ID_Bytes);
+  if(NULL != e) { Serial.write((const uint8_t *)rxAssocIDHex[e->assocN], sizeof(rxAssocIDHex[0])); return; }
 #endif
-#if defined(ENABLE_STATS_RX) // Only look for the trailer if supported.
-    // If whole FHT8V frame was OK then check if there is a valid stats trailer.
+  printIDHex(&Serial, id, OTV0P2BASE::OpenTRV_Node_ID_Bytes);
+  }
 
-    // Check for 'core' stats trailer.
-    if(OTV0P2BASE::MESSAGING_FULL_STATS_FLAGS_HEADER_MSBS == (trailer[0] & OTV0P2BASE::MESSAGING_FULL_STATS_FLAGS_HEADER_MASK))
-      {
-      OTV0P2BASE::FullStatsMessageCore_t content;
-      const uint8_t *tail = decodeFullStatsMessageCore(trailer, lastByte-trailer+1, OTV0P2BASE::stTXalwaysAll, false, &content);
-      if(NULL != tail)
-        {
-        // Received trailing stats frame!
+#if defined(ENABLE_NODE_REGISTRY)
+// Latest core values reported by each recently heard secure sender.
+// When full the sender heard longest ago is replaced.
+static constexpr uint8_t NODE_REGISTRY_SLOTS = 8;
+static constexpr int16_t NODE_REG_NO_TEMP = (int16_t)0x8000;
+struct nodeRegEntry_t
+  {
+  uint8_t id[OTV0P2BASE::OpenTRV_Node_ID_Bytes];
+  int16_t tempC16; // NODE_REG_NO_TEMP if not reported.
+  uint16_t supplycV; // 0 if not reported.
+  uint8_t valvePC; // 0xff if not reported.
+  uint8_t occ; // 0xff if not reported.
+  uint8_t seq; // Of the latest frame.
+  uint8_t heardM; // Minutes since last heard, saturating at 0xfe; 0xff if slot unused.
+  };
+static nodeRegEntry_t nodeRegistry[NODE_REGISTRY_SLOTS];
+static bool nodeRegistryInit;
 
-        // If ID is present then make sure it matches that implied by the FHT8V frame (else reject this trailer)
-        // else file it in from the FHT8C frame.
-        bool allGood = true;
-        if(content.containsID)
-          {
-          if((content.id0 != command.hc1) || (content.id1 != command.hc2))
-            { allGood = false; }
-          }
-        else
-          {
-          content.id0 = command.hc1;
-          content.id1 = command.hc2;
-          content.containsID = true;
-          }
+void ageNodeRegistry()
+  {
+  for(uint8_t i = 0; i < NODE_REGISTRY_SLOTS; ++i)
+    { if(nodeRegistry[i].heardM < 0xfe) { ++nodeRegistry[i].heardM; } }
+  }
 
-#if 0 && defined(DEBUG)
-/*if(allGood)*/ { p->println("FS20 ts"); }
+// Find the entry for id, else claim the empty or least recently heard slot for it.
+static nodeRegEntry_t &nodeRegistryFor(const uint8_t *const id)
+  {
+  if(!nodeRegistryInit)
+    {
+    for(uint8_t i = 0; i < NODE_REGISTRY_SLOTS; ++i) { nodeRegistry[i].heardM = 0xff; }
+    nodeRegistryInit = true;
+    }
+  uint8_t oldest = 0;
+  for(uint8_t i = 0; i < NODE_REGISTRY_SLOTS; ++i)
+    {
+    nodeRegEntry_t &e = nodeRegistry[i];
+    if((0xff != e.heardM) && (0 == memcmp(e.id, id, sizeof(e.id)))) { return(e); }
+    if(e.heardM >= nodeRegistry[oldest].heardM) { oldest = i; }
+    }
+  nodeRegEntry_t &e = nodeRegistry[oldest];
+  memcpy(e.id, id, sizeof(e.id));
+  e.tempC16 = NODE_REG_NO_TEMP;
+  e.supplycV = 0;
+  e.valvePC = 0xff;
+  e.occ = 0xff;
+  return(e);
+  }
+
+// Integer value of field "key": (key in Flash) in the JSON text buf[0..len-1]; false if absent.
+static bool nodeRegJSONInt(const uint8_t *const buf, const uint8_t len, const char *const key, int16_t &out)
+  {
+  const uint8_t kl = strlen_P(key);
+  for(uint8_t i = 0; i + kl + 3 < len; ++i)
+    {
+    if(('"' != buf[i]) || ('"' != buf[i+kl+1]) || (':' != buf[i+kl+2]) || (0 != memcmp_P(buf+i+1, key, kl))) { continue; }
+    uint8_t j = i + kl + 3;
+    const bool neg = ('-' == buf[j]);
+    if(neg) { ++j; }
+    if((j >= len) || (buf[j] < '0') || (buf[j] > '9')) { return(false); }
+    int16_t v = 0;
+    while((j < len) && (buf[j] >= '0') && (buf[j] <= '9')) { v = (int16_t)(10*v + (buf[j++] - '0')); }
+    out = neg ? (int16_t)-v : v;
+    return(true);
+    }
+  return(false);
+  }
+
+// Fold the decrypted body of a secure 'O' frame from id into the registry,
+// taking the leading valve % and any JSON or TLV stats; call before the body is altered.
+static void nodeRegistryNoteO(const uint8_t *const id, const uint8_t seq, const uint8_t *const body, const uint8_t bl)
+  {
+  nodeRegEntry_t &e = nodeRegistryFor(id);
+  e.seq = seq;
+  e.heardM = 0;
+  if(body[0] <= 100) { e.valvePC = body[0]; }
+#if defined(ENABLE_STATS_SET_UPLOAD)
+  if(0 != (body[1] & STATS_SET_BODY_FLAG)) { return; }
 #endif
-        // If frame looks good then capture it.
-        if(allGood) { outputCoreStats(p, false, &content); }
-//            else { setLastRXErr(FHT8VRXErr_BAD_RX_SUBFRAME); }
-        // TODO: record error with mismatched ID.
-        }
-      }
-#if defined(ENABLE_MINIMAL_STATS_TXRX)
-    // Check for minimal stats trailer.
-    else if((trailer + MESSAGING_TRAILING_MINIMAL_STATS_PAYLOAD_BYTES <= lastByte) && // Enough space for minimum-stats trailer.
-       (MESSAGING_TRAILING_MINIMAL_STATS_HEADER_MSBS == (trailer[0] & MESSAGING_TRAILING_MINIMAL_STATS_HEADER_MASK)))
+#if defined(ENABLE_SECURE_STATS_TLV)
+  if(0 != (body[1] & STATS_TLV_BODY_FLAG))
+    {
+    for(uint8_t i = 2; i < bl; )
       {
-      if(verifyHeaderAndCRCForTrailingMinimalStatsPayload(trailer)) // Valid header and CRC.
+      const uint8_t tag = body[i++];
+      const uint8_t n = tag >> 6;
+      if((0 == n) || (n > 2) || (i + n > bl)) { break; } // Malformed.
+      const int16_t value = (2 == n) ? (int16_t)((body[i] << 8) | body[i+1]) : (int16_t)body[i];
+      i += n;
+      switch(tag & 0x3f)
         {
-#if 0 && defined(DEBUG)
-        p->println("FS20 tsm"); // Just notes that a 'valve %' FS20 command has been overheard.
-#endif
-        trailingMinimalStatsPayload_t payload;
-        extractTrailingMinimalStatsPayload(trailer, &payload);
+        case STLV_T_C16: e.tempC16 = value; break;
+        case STLV_B_CV: e.supplycV = (uint16_t)value; break;
+        case STLV_O: e.occ = (uint8_t)value; break;
+        case STLV_V_PC: e.valvePC = (uint8_t)value; break;
+        default: break;
         }
       }
-#endif
-#endif // defined(ENABLE_STATS_RX)
+    return;
+    }
+#endif // ENABLE_SECURE_STATS_TLV
+  if((0 != (body[1] & 0x10)) && (bl > 3) && ('{' == body[2]))
+    {
+    int16_t v;
+    if(nodeRegJSONInt(body + 2, bl - 2, PSTR("T|C16"), v)) { e.tempC16 = v; }
+    if(nodeRegJSONInt(body + 2, bl - 2, PSTR("B|cV"), v)) { e.supplycV = (uint16_t)v; }
+    if(nodeRegJSONInt(body + 2, bl - 2, PSTR("O"), v)) { e.occ = (uint8_t)v; }
+    if(nodeRegJSONInt(body + 2, bl - 2, PSTR("v|%"), v)) { e.valvePC = (uint8_t)v; }
     }
-  return(true);
   }
-#endif
 
-#if defined(ENABLE_RADIO_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) // && defined(ENABLE_FAST_FRAMED_CARRIER_SUPPORT)
+// As {"@":"<ID>","+":<seq>,"T|C16":<temp>,"v|%":<valve>,"B|cV":<supply>,"O":<occ>,"rA|m":<minutes since heard>},
+// omitting values never reported.
+void nodeRegistryDump()
+  {
+  if(!nodeRegistryInit) { return; }
+  for(uint8_t i = 0; i < NODE_REGISTRY_SLOTS; ++i)
+    {
+    const nodeRegEntry_t &e = nodeRegistry[i];
+    if(0xff == e.heardM) { continue; }
+    Serial.print(F("{\"@\":\""));
+    printSenderIDHex(e.id);
+    Serial.print(F("\",\"+\":"));
+    Serial.print(e.seq);
+    if(NODE_REG_NO_TEMP != e.tempC16) { Serial.print(F(",\"T|C16\":")); Serial.print(e.tempC16); }
+    if(0xff != e.valvePC) { Serial.print(F(",\"v|%\":")); Serial.print(e.valvePC); }
+    if(0 != e.supplycV) { Serial.print(F(",\"B|cV\":")); Serial.print(e.supplycV); }
+    if(0xff != e.occ) { Serial.print(F(",\"O\":")); Serial.print(e.occ); }
+    Serial.print(F(",\"rA|m\":"));
+    Serial.print(e.heardM);
+    Serial.println('}');
+    OTV0P2BASE::flushSerialProductive();
+    }
+  }
+
+#if defined(ENABLE_HUB_SUMMARY)
+// Supply at or below this is flagged low, as OTV0P2BASE::SupplyVoltageCentiVolts::isSupplyVoltageLow().
+static constexpr uint16_t HUB_SUMMARY_BATTERY_LOW_CV = 210;
+static constexpr uint8_t HUB_SUMMARY_NODE_BYTES = 6;
+void hubSummaryRelay(const bool boilerOn)
+  {
+  uint8_t buf[2 + HUB_SUMMARY_NODE_BYTES*NODE_REGISTRY_SLOTS];
+  buf[0] = HUB_SUMMARY_FRAME_TYPE;
+  buf[1] = boilerOn ? 1 : 0;
+  uint8_t n = 2;
+  if(nodeRegistryInit)
+    {
+    for(uint8_t i = 0; i < NODE_REGISTRY_SLOTS; ++i)
+      {
+      const nodeRegEntry_t &e = nodeRegistry[i];
+      if(e.heardM > HUB_SUMMARY_MAX_AGE_M) { continue; } // Also skips unused slots.
+      buf[n++] = e.id[0];
+      buf[n++] = e.id[1];
+      buf[n++] = (uint8_t)(e.tempC16 >> 8);
+      buf[n++] = (uint8_t)e.tempC16;
+      buf[n++] = e.valvePC;
+      buf[n++] = (uint8_t)(((e.heardM > 63) ? 63 : e.heardM) << 2) |
+                 (((0xff != e.valvePC) && (e.valvePC >= OTRadValve::DEFAULT_VALVE_PC_MODERATELY_OPEN)) ? 1 : 0) |
+                 (((0 != e.supplycV) && (e.supplycV <= HUB_SUMMARY_BATTERY_LOW_CV)) ? 2 : 0);
+      }
+    }
+  relayFrame(buf, n);
+  }
+#endif // ENABLE_HUB_SUMMARY
+#endif // ENABLE_NODE_REGISTRY
+
+// Useful brief network diagnostics: a couple of bytes of the claimed ID of rejected frames.
+// Warnings rather than errors because there may legitimately be multiple disjoint networks.
+static void printRXAuthReject(const OTRadioLink::SecurableFrameHeader &sfh)
+  {
+  OTV0P2BASE::serialPrintAndFlush(F("?RX auth")); // Missing association, stale counter or failed auth.
+  if(sfh.getIl() > 0) { OTV0P2BASE::serialPrintAndFlush(' '); OTV0P2BASE::serialPrintAndFlush(sfh.id[0], HEX); }
+  if(sfh.getIl() > 1) { OTV0P2BASE::serialPrintAndFlush(' '); OTV0P2BASE::serialPrintAndFlush(sfh.id[1], HEX); }
+  OTV0P2BASE::serialPrintlnAndFlush();
+  }
+
 // Handle FS20/FHT8V traffic including binary stats.
 // Returns true on successful frame type match, false if no suitable frame was found/decoded and another parser should be tried.
 static bool decodeAndHandleOTSecureableFrame(Print *p, const bool secure, const uint8_t * const msg)
@@ -260,7 +2517,11 @@ if(!isOK) { DEBUG_SERIAL_PRINTLN_FLASHSTRING("!RX bad secure header"); }
 
   // Buffer for receiving secure frame body.
   // (Non-secure frame bodies should be read directly from the frame buffer.)
+#if defined(ENABLE_SCRATCH_ARENA)
+  uint8_t (&secBodyBuf)[OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE] = scratchRegion<SCRATCH_RX_BODY_OFF, SCRATCH_RX_BODY_SIZE>();
+#else
   uint8_t secBodyBuf[OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE];
+#endif
   uint8_t decryptedBodyOutSize = 0;
 
   // Validate integrity of frame (CRC for non-secure, auth for secure).
@@ -282,17 +2543,55 @@ if(!isOK) { DEBUG_SERIAL_PRINTLN_FLASHSTRING("!RX bad secure header"); }
   // Only allow secure frames by default.
   if(!secureFrame) { isOK = false; }
 #endif
+  // Cheap pre-authentication checks, in order of cost, so that malformed, foreign and stale frames
+  // are rejected before any key fetch or AES work:
+  // header sanity (above), trailer format and body length, then (with the RAM index) association and counter.
+#if defined(ENABLE_RX_ASSOC_INDEX)
+  rxAssocEntry_t *assoc = NULL;
+  // Assumes the counter is at the start of the trailer as for the 0x80 type, as does the library.
+  const uint8_t *const rxCounter = msg - 1 + sfh.getTrailerOffset();
+#endif
+  if(secureFrame && isOK)
+    {
+    if(!rxSecureFramePrecheck(sfh, msg-1, msglen+1)) { isOK = false; }
+#if defined(ENABLE_RX_ASSOC_INDEX)
+    else if((NULL == (assoc = findRXAssoc(sfh.id, sfh.getIl()))) ||
+            (OTRadioLink::SimpleSecureFrame32or0BodyBase::msgcountercmp(rxCounter, assoc->lastCounter) <= 0))
+      { isOK = false; }
+#endif
+#if 1 // && defined(DEBUG)
+    if(!isOK) { printRXAuthReject(sfh); }
+#endif
+    }
   // Validate (authenticate) and decrypt body of secure frames.
+#if defined(ENABLE_RX_DECRYPT_SESSION)
+  uint8_t (&key)[16] = rxSessionKey();
+  if(secureFrame && isOK)
+    {
+    // Get the 'building' key once per session.
+    if(RX_SESSION_KEY_NONE == rxSessionKeyState)
+      {
+      rxSessionKeyState = getPrimaryBuildingKey(key) ? RX_SESSION_KEY_OK : RX_SESSION_KEY_MISSING;
+      if(RX_SESSION_KEY_MISSING == rxSessionKeyState) { OTV0P2BASE::serialPrintlnAndFlush(F("!RX key")); }
+      }
+    if(RX_SESSION_KEY_OK != rxSessionKeyState) { isOK = false; }
+    }
+#else
+#if defined(ENABLE_SCRATCH_ARENA)
+  uint8_t (&key)[16] = scratchRegion<SCRATCH_RX_KEY_OFF, SCRATCH_KEY_SIZE>();
+#else
   uint8_t key[16];
+#endif
   if(secureFrame && isOK)
     {
     // Get the 'building' key.
-    if(!OTV0P2BASE::getPrimaryBuilding16ByteSecretKey(key))
+    if(!getPrimaryBuildingKey(key))
       {
       isOK = false;
       OTV0P2BASE::serialPrintlnAndFlush(F("!RX key"));
       }
     }
+#endif // ENABLE_RX_DECRYPT_SESSION
   uint8_t senderNodeID[OTV0P2BASE::OpenTRV_Node_ID_Bytes];
   if(secureFrame && isOK)
     {
@@ -300,25 +2599,74 @@ if(!isOK) { DEBUG_SERIAL_PRINTLN_FLASHSTRING("!RX bad secure header"); }
     // validate RX message counter,
     // authenticate and decrypt,
     // update RX message counter.
+    {
+    const CPUClockBoost boost;
+#if defined(ENABLE_DUAL_RX_KEY)
+    // While a previous key is held, start with the key that last authenticated this sender
+    // (or the current key if not known) and only fall back to the other if that fails,
+    // so each sender costs one decrypt once it is known which key it is on.
+#if defined(ENABLE_RX_ASSOC_INDEX)
+    bool usePrevious = (0 != rxPreviousKeyHours) && assoc->previousKey;
+#else
+    bool usePrevious = false;
+#endif
+    for(uint8_t tries = (0 != rxPreviousKeyHours) ? 2 : 1; tries-- > 0; usePrevious = !usePrevious)
+    {
+    const uint8_t *const k = usePrevious ? rxPreviousKey : key;
+#else
+    const uint8_t *const k = key;
+#endif // ENABLE_DUAL_RX_KEY
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME)
+    if((FTS_VALVE_SHORT_LOCAL | 0x80) == firstByte)
+      { isOK = decodeValveShortFrame(sfh, msg-1, k, secBodyBuf, decryptedBodyOutSize, senderNodeID); }
+    else
+#endif
     isOK = (0 != OTRadioLink::SimpleSecureFrame32or0BodyRXV0p2::getInstance().decodeSecureSmallFrameSafely(&sfh, msg-1, msglen+1,
-                                            OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleDec_DEFAULT_STATELESS,
-                                            NULL, key,
+                                            rxDecrypt,
+                                            rxDecryptState, k,
                                             secBodyBuf, sizeof(secBodyBuf), decryptedBodyOutSize,
                                             senderNodeID,
                                             true));
-#if 1 // && defined(DEBUG)
-    if(!isOK)
+#if defined(ENABLE_DUAL_RX_KEY)
+    if(isOK)
+      {
+#if defined(ENABLE_RX_ASSOC_INDEX)
+      assoc->previousKey = usePrevious;
+#endif
+      break;
+      }
+    }
+#endif // ENABLE_DUAL_RX_KEY
+    }
+#if defined(ENABLE_RX_ASSOC_INDEX)
+    // Track the newly-authenticated counter.
+    if(isOK)
       {
-      // Useful brief network diagnostics: a couple of bytes of the claimed ID of rejected frames.
-      // Warnings rather than errors because there may legitimately be multiple disjoint networks.
-      OTV0P2BASE::serialPrintAndFlush(F("?RX auth")); // Missing association or failed auth.
-      if(sfh.getIl() > 0) { OTV0P2BASE::serialPrintAndFlush(' '); OTV0P2BASE::serialPrintAndFlush(sfh.id[0], HEX); }
-      if(sfh.getIl() > 1) { OTV0P2BASE::serialPrintAndFlush(' '); OTV0P2BASE::serialPrintAndFlush(sfh.id[1], HEX); }
-      OTV0P2BASE::serialPrintlnAndFlush();
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK) || defined(ENABLE_RX_LINK_TABLE)
+      // Counter values skipped, ie lost frames.
+      const uint8_t lsb = OTRadioLink::SimpleSecureFrame32or0BodyBase::fullMessageCounterBytes - 1;
+      const uint8_t gap = (uint8_t)(rxCounter[lsb] - assoc->lastCounter[lsb] - 1);
+#endif
+#if defined(ENABLE_RX_LINK_TABLE)
+      noteRXLink(*assoc, gap, rxRSSIFor(msg));
+#endif
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK)
+      // Count skipped counter values as lost frames, ignoring the first frame seen and any big jump (eg reboot).
+      const bool first = (0 == assoc->rxOK) && (0 == assoc->rxMissed);
+      if(!first && (gap < 64)) { assoc->rxMissed = (uint8_t)OTV0P2BASE::fnmin(255, assoc->rxMissed + gap); }
+      if(assoc->rxOK < 255) { ++assoc->rxOK; }
+#endif
+      memcpy(assoc->lastCounter, rxCounter, sizeof(assoc->lastCounter));
       }
+#endif // ENABLE_RX_ASSOC_INDEX
+#if 1 // && defined(DEBUG)
+    if(!isOK) { printRXAuthReject(sfh); }
 #endif
     }
 
+  // A well-formed secure frame that failed a check (eg decrypt/auth) is consumed here as a bad frame
+  // rather than offered to the other parsers.
+  if(!isOK && secureFrame) { chanCountBad(); return(true); }
   if(!isOK) { return(false); } // Stop if not OK.
 
   // If frame still OK to process then switch on frame type.
@@ -362,6 +2710,80 @@ DEBUG_SERIAL_PRINTLN();
       }
 #endif // defined(ENABLE_SECURE_RADIO_BEACON)
 
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK)
+    // Hub's per-node link quality summary.
+    case FTS_LINK_QUALITY_LOCAL | 0x80:
+      {
+      handleLinkQualityFeedback(secBodyBuf, decryptedBodyOutSize);
+      return(true);
+      }
+#endif // ENABLE_LINK_QUALITY_FEEDBACK
+
+#if defined(ENABLE_TIME_SYNC_BEACON)
+    // Hub's time sync and TX slot assignments.
+    case FTS_TIME_SYNC_LOCAL | 0x80:
+      {
+      handleTimeSync(secBodyBuf, decryptedBodyOutSize);
+      return(true);
+      }
+#endif // ENABLE_TIME_SYNC_BEACON
+
+#if defined(ENABLE_SECURE_TX_ACK)
+    // Hub's acknowledgement of a frame from this leaf.
+    case FTS_ACK_LOCAL | 0x80:
+      {
+      handleHubAck(secBodyBuf, decryptedBodyOutSize);
+      return(true);
+      }
+#endif // ENABLE_SECURE_TX_ACK
+
+#if defined(ENABLE_REMOTE_DIAG)
+    // Leaf's diagnostics, as requested by this hub.
+    case FTS_DIAG_LOCAL | 0x80:
+      {
+      handleRemoteDiag(msg, msglen, senderNodeID, sfh.getSeq(), secBodyBuf, decryptedBodyOutSize);
+      return(true);
+      }
+#endif // ENABLE_REMOTE_DIAG
+
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME)
+    // Valve % update between full stats, as an 'O' frame without stats.
+    case FTS_VALVE_SHORT_LOCAL | 0x80:
+      {
+      if(decryptedBodyOutSize < 2) { break; }
+      const uint8_t percentOpen = secBodyBuf[0];
+#if defined(ENABLE_NODE_REGISTRY)
+      nodeRegistryNoteO(senderNodeID, sfh.getSeq(), secBodyBuf, decryptedBodyOutSize);
+#endif
+#if defined(ENABLE_SECURE_TX_ACK)
+      if(percentOpen <= 100) { hubAckTX(msg, msglen, key, senderNodeID); }
+#endif
+#ifdef ENABLE_BOILER_HUB
+      if(percentOpen <= 100) { remoteCallForHeatRX(0, percentOpen); } // todo call for heat valve id not passed in.
+#endif
+#if !defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+#if defined(ENABLE_BINARY_SERIAL_OUTPUT)
+      binRecStart('O', senderNodeID, OTV0P2BASE::OpenTRV_Node_ID_Bytes, sfh.getSeq());
+      binRecPut(secBodyBuf, 2);
+      binRecEnd();
+#else
+      if(percentOpen <= 100)
+        {
+        Serial.print(F("{\"@\":\""));
+        printSenderIDHex(senderNodeID);
+        Serial.print(F("\",\"+\":"));
+        Serial.print(sfh.getSeq());
+        Serial.print(F(",\"v|%\":"));
+        Serial.print(percentOpen);
+        Serial.println('}');
+        }
+#endif // ENABLE_BINARY_SERIAL_OUTPUT
+      OTV0P2BASE::flushSerialProductive();
+#endif // !ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY
+      return(true);
+      }
+#endif // ENABLE_SECURE_VALVE_SHORT_FRAME
+
     case 'O' | 0x80: // Basic OpenTRV secure frame...
       {
 #if 0 && defined(DEBUG)
@@ -374,6 +2796,13 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("!RX O short"); // "O' frame too short.
 #endif
         break;
         }
+#if defined(ENABLE_NODE_REGISTRY)
+      nodeRegistryNoteO(senderNodeID, sfh.getSeq(), secBodyBuf, decryptedBodyOutSize);
+#endif
+#if defined(ENABLE_SECURE_TX_ACK)
+      // Acknowledge valve reports (and with subscription occasional frames from other senders) at once, while the sender is still listening.
+      if(secureFrameWantsAck(secBodyBuf[0], sfh.getSeq())) { hubAckTX(msg, msglen, key, senderNodeID); }
+#endif
 #ifdef ENABLE_BOILER_HUB
       // If acting as a boiler hub
       // then extract the valve %age and pass to boiler controller
@@ -382,22 +2811,64 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("!RX O short"); // "O' frame too short.
       const uint8_t percentOpen = secBodyBuf[0];
       if(percentOpen <= 100) { remoteCallForHeatRX(0, percentOpen); } // todo call for heat valve id not passed in.
 #endif
-      // If the frame contains JSON stats
+      // If the frame contains JSON (or TLV) stats
       // then forward entire secure frame as-is across the secondary radio relay link,
       // else print directly to console/Serial.
+#if defined(ENABLE_STATS_SET_UPLOAD)
+      if((0 != (secBodyBuf[1] & STATS_SET_BODY_FLAG)) && (STATS_SET_BODY_LEN == decryptedBodyOutSize))
+        {
+#if defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+        relayLeafFrame(msg, msglen);
+#elif defined(ENABLE_BINARY_SERIAL_OUTPUT)
+        binRecStart('O', senderNodeID, OTV0P2BASE::OpenTRV_Node_ID_Bytes, sfh.getSeq());
+        binRecPut(secBodyBuf, decryptedBodyOutSize);
+        binRecEnd();
+#else
+        printStatsSetAsJSON(&Serial, senderNodeID, OTV0P2BASE::OpenTRV_Node_ID_Bytes, sfh.getSeq(), secBodyBuf);
+        OTV0P2BASE::flushSerialProductive();
+#endif
+        }
+      else
+#endif // ENABLE_STATS_SET_UPLOAD
+#if defined(ENABLE_SECURE_STATS_TLV)
+      if((0 != (secBodyBuf[1] & STATS_TLV_BODY_FLAG)) && (decryptedBodyOutSize > 2))
+        {
+#if defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+        relayLeafFrame(msg, msglen);
+#elif defined(ENABLE_BINARY_SERIAL_OUTPUT)
+        binRecStart('O', senderNodeID, OTV0P2BASE::OpenTRV_Node_ID_Bytes, sfh.getSeq());
+        binRecPut(secBodyBuf, decryptedBodyOutSize);
+        binRecEnd();
+#else
+        printStatsTLVAsJSON(&Serial, senderNodeID, OTV0P2BASE::OpenTRV_Node_ID_Bytes, sfh.getSeq(), secBodyBuf + 2, decryptedBodyOutSize - 2);
+        OTV0P2BASE::flushSerialProductive();
+#endif
+        }
+      else
+#endif // ENABLE_SECURE_STATS_TLV
       if((0 != (secBodyBuf[1] & 0x10)) && (decryptedBodyOutSize > 3) && ('{' == secBodyBuf[2]))
         {
 #ifdef ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY
-        SecondaryRadio.queueToSend(msg, msglen); 
+        relayLeafFrame(msg, msglen);
 #else // Don't write to console/Serial also if relayed.
+#if defined(ENABLE_BINARY_SERIAL_OUTPUT)
+        binRecStart('O', senderNodeID, OTV0P2BASE::OpenTRV_Node_ID_Bytes, sfh.getSeq());
+        binRecPut(secBodyBuf, decryptedBodyOutSize);
+        binRecEnd();
+#else
         // Write out the JSON message, inserting synthetic ID/@ and seq/+.
         Serial.print(F("{\"@\":\""));
-        for(int i = 0; i < OTV0P2BASE::OpenTRV_Node_ID_Bytes; ++i) { Serial.print(senderNodeID[i], HEX); }
+        printSenderIDHex(senderNodeID);
         Serial.print(F("\",\"+\":"));
         Serial.print(sfh.getSeq());
-        Serial.print(',');
-        Serial.write(secBodyBuf + 3, decryptedBodyOutSize - 3);
+#if defined(ENABLE_RELAY_JSON_FILTER)
+        const uint8_t fl = filterJSONFields(secBodyBuf + 3, decryptedBodyOutSize - 3);
+#else
+        const uint8_t fl = decryptedBodyOutSize - 3;
+#endif
+        if(0 != fl) { Serial.print(','); Serial.write(secBodyBuf + 3, fl); }
         Serial.println('}');
+#endif // ENABLE_BINARY_SERIAL_OUTPUT
 //        OTV0P2BASE::outputJSONStats(&Serial, secure, msg, msglen);
         // Attempt to ensure that trailing characters are pushed out fully.
         OTV0P2BASE::flushSerialProductive();
@@ -433,7 +2904,7 @@ static void decodeAndHandleRawRXedMessage(Print *p, const bool secure, const uin
   OTRadioLink::printRXMsg(p, msg-1, msglen+1); // Print len+frame.
 #endif
 
-  if(msglen < 2) { return; } // Too short to be useful, so ignore.
+  if(msglen < 2) { chanCountBad(); return; } // Too short to be useful, so ignore.
 
    // Length-first OpenTRV secureable-frame format...
 #if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) // && defined(ENABLE_FAST_FRAMED_CARRIER_SUPPORT)
@@ -472,7 +2943,11 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("Stats IDx");
            DEBUG_SERIAL_PRINTLN();
 #endif
 //           recordCoreStats(false, &content);
+#if defined(ENABLE_BINARY_SERIAL_OUTPUT)
+           binRecFS20(msg, msglen, true, content.id0, content.id1);
+#else
            OTV0P2BASE::outputCoreStats(&Serial, secure, &content);
+#endif
            }
          }
       return;
@@ -490,29 +2965,46 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("Stats IDx");
 #if defined(ENABLE_STATS_RX) && defined(ENABLE_FS20_ENCODING_SUPPORT)
     case OTRadioLink::FTp2_JSONRaw:
       {
-      if(-1 != OTV0P2BASE::checkJSONMsgRXCRC(msg, msglen))
+      // Length including the bounding '{' and '}'|0x80, excluding the CRC.
+      const int8_t jsonLen = checkJSONRXCRC(msg, msglen);
+      if(OTV0P2BASE::checkJSONMsgRXCRC_ERR != jsonLen)
         {
 #ifdef ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY
-        // Initial pass for Brent.
-        // Strip trailing high bit and CRC.  Not very nice, but it'll have to do.
-        uint8_t buf[OTV0P2BASE::MSG_JSON_ABS_MAX_LENGTH + 1];
-        uint8_t buflen = 0;
-        while(buflen < sizeof(buf))
-          {
-          const uint8_t b = msg[buflen];
-          if(('}' | 0x80) == b) { buf[buflen++] = '}'; break; } // End of JSON found.
-          buf[buflen++] = b;
-          }
+        // Copy out of the read-only RX queue entry, stripping the trailing high bit and dropping the CRC.
+        // Not zero-copy: fixing up the terminator (and filtering) in place would mean writing through
+        // peekRXMsg()'s read-only view of a buffer shared with the ISR, so this is one bulk copy
+        // of the length that the CRC check already found, rather than a second byte-by-byte scan.
+        uint8_t frame[OTV0P2BASE::MSG_JSON_ABS_MAX_LENGTH];
+        memcpy(frame, msg, (uint8_t)jsonLen);
+        frame[jsonLen - 1] = '}';
         // FIXME should only relay authenticated (and encrypted) traffic.
         // Relay stats frame over secondary radio.
-        SecondaryRadio.queueToSend(buf, buflen); 
+#if defined(ENABLE_RELAY_JSON_FILTER)
+        // Trim the fields in the copy between the braces.
+        {
+        uint8_t *const body = frame + 1;
+        const uint8_t fl = filterJSONFields(body, (uint8_t)(jsonLen - 2));
+        body[fl] = '}';
+        relayFrame(frame, fl + 2);
+        }
+#else
+        relayFrame(frame, (uint8_t)jsonLen);
+#endif
 #else // Don't write to console/Serial also if relayed.
+#if defined(ENABLE_BINARY_SERIAL_OUTPUT)
+        binRecStart('J', NULL, 0, 0);
+        binRecPut(msg, (uint8_t)(jsonLen - 1));
+        binRecPut('}');
+        binRecEnd();
+#else
         // Write out the JSON message.
         OTV0P2BASE::outputJSONStats(&Serial, secure, msg, msglen);
         // Attempt to ensure that trailing characters are pushed out fully.
         OTV0P2BASE::flushSerialProductive();
+#endif // ENABLE_BINARY_SERIAL_OUTPUT
 #endif // ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY
         }
+      else { chanCountBad(); }
       return;
       }
 #endif
@@ -520,6 +3012,7 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("Stats IDx");
 #endif // ENABLE_FS20_ENCODING_SUPPORT
 
   // Unparseable frame: drop it; possibly log it as an error.
+  chanCountBad();
 #if 0 && defined(DEBUG) && !defined(ENABLE_TRIMMED_MEMORY)
   p->print(F("!RX bad msg, len+prefix: ")); OTRadioLink::printRXMsg(p, msg-1, min(msglen+1, 8));
 #endif
@@ -528,6 +3021,172 @@ DEBUG_SERIAL_PRINTLN_FLASHSTRING("Stats IDx");
 #endif // ENABLE_RADIO_RX
 
 #ifdef ENABLE_RADIO_RX
+#if defined(ENABLE_RX_PRIORITY_QUEUE) && defined(ENABLE_BOILER_HUB)
+// Small queue for control frames from the primary radio, emptied ahead of its main RX queue.
+// Guaranteed to hold one max-size frame, or several trimmed FS20 ones.
+static OTRadioLink::ISRRXQueueVarLenMsg<64, 1> rxPriorityQueue;
+
+bool rxPriorityDivertISR(const volatile uint8_t *const buf, const uint8_t buflen)
+  {
+  if(0 == buflen) { return(false); }
+  const uint8_t fType = buf[0];
+  // Call-for-heat/valve frames only: FS20/FHT8V and secure (or permitted insecure) 'O' frames.
+  if(!((OTRadioLink::FTp2_FS20_native == fType) ||
+       (((uint8_t)OTRadioLink::FTS_BasicSensorOrValve | OTRadioLink::SECUREABLE_FRAME_TYPE_SEC_FLAG) == fType)
+#if defined(ENABLE_OTSECUREFRAME_INSECURE_RX_PERMITTED)
+       || ((uint8_t)OTRadioLink::FTS_BasicSensorOrValve == fType)
+#endif
+      )) { return(false); }
+  volatile uint8_t *const q = rxPriorityQueue._getRXBufForInbound();
+  if(NULL == q) { return(false); } // Full: leave in main queue.
+  for(uint8_t i = 0; i < buflen; ++i) { q[i] = buf[i]; }
+  rxPriorityQueue._loadedBuf(buflen);
+  return(true);
+  }
+#endif // ENABLE_RX_PRIORITY_QUEUE
+
+// Peek at the next RX frame to handle from the given radio, setting priority if from the priority queue.
+static inline const volatile uint8_t *peekRX(OTRadioLink::OTRadioLink *const rl, bool &priority)
+  {
+#if defined(ENABLE_RX_PRIORITY_QUEUE) && defined(ENABLE_BOILER_HUB)
+  if(&PrimaryRadio == rl)
+    {
+    const volatile uint8_t *const pp = rxPriorityQueue.peekRXMsg();
+    if(NULL != pp) { priority = true; return(pp); }
+    }
+#endif // ENABLE_RX_PRIORITY_QUEUE
+  priority = false;
+  return(rl->peekRXMsg());
+  }
+
+// Remove the frame returned by peekRX().
+static inline void removeRX(OTRadioLink::OTRadioLink *const rl, const bool priority)
+  {
+#if defined(ENABLE_RX_PRIORITY_QUEUE) && defined(ENABLE_BOILER_HUB)
+  if(priority) { rxPriorityQueue.removeRXMsg(); return; }
+#endif // ENABLE_RX_PRIORITY_QUEUE
+  rl->removeRXMsg();
+  }
+
+#if defined(ENABLE_RX_DUP_FILTER)
+// Recently-seen frames, by CRC-16 over length and content, so that repeat copies (eg from TXmax double TX)
+// can be dropped before any decoding, authentication or output.
+// Entries expire after RX_DUP_WINDOW_S so that a frame legitimately repeated later (eg an unchanged FS20 command) is still handled.
+// A CRC collision between different frames within the window would lose one of them, but is very unlikely.
+// Ages are taken from a local-time count of 2s ticks that runs on across midnight (exact for ~36h),
+// and every expired entry is cleared at each check, so a stale entry cannot alias a later frame.
+static constexpr uint8_t RX_DUP_SLOTS = 8; // Power of 2; 4 bytes of RAM each.
+static constexpr uint8_t RX_DUP_WINDOW_S = 4;
+static_assert(0 == (RX_DUP_SLOTS & (RX_DUP_SLOTS-1)), "RX dup slots must be power of 2");
+typedef struct
+  {
+  uint16_t hash; // 0 if unused.
+  uint16_t tick; // rxDupTick() when first seen.
+  } rxDupEntry_t;
+static rxDupEntry_t rxDupCache[RX_DUP_SLOTS];
+static uint8_t rxDupNext; // Oldest entry, replaced next.
+// Local time in 2s ticks, modulo 2^16.
+static uint16_t rxDupTick()
+  {
+  const uint16_t m = OTV0P2BASE::getMinutesSinceMidnightLT();
+  return((uint16_t)(OTV0P2BASE::getDaysSince1999LT() * (uint16_t)(1440U*30U) + m*30U + (OTV0P2BASE::getSecondsLT() >> 1)));
+  }
+// True if this frame (with its length byte at msg[-1]) was seen in the last RX_DUP_WINDOW_S seconds, else remember it.
+static bool rxIsDuplicate(const uint8_t *const msg)
+  {
+  const uint8_t msglen = msg[-1];
+#if defined(ENABLE_SECURE_TX_ACK)
+  // A leaf resends an unchanged valve report when the ACK is lost, and that copy must be ACKed again.
+  if((('O' | 0x80) == msg[0])
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME)
+     || ((FTS_VALVE_SHORT_LOCAL | 0x80) == msg[0])
+#endif
+    ) { return(false); }
+#endif // ENABLE_SECURE_TX_ACK
+  uint16_t hash = 0xffff;
+  for(int i = -1; i < msglen; ++i) { hash = _crc_ccitt_update(hash, msg[i]); }
+  if(0 == hash) { hash = 1; }
+  const uint16_t now = rxDupTick();
+  bool dup = false;
+  for(uint8_t i = 0; i < RX_DUP_SLOTS; ++i)
+    {
+    rxDupEntry_t &e = rxDupCache[i];
+    if(0 == e.hash) { continue; }
+    if((uint16_t)(now - e.tick) >= RX_DUP_WINDOW_S/2) { e.hash = 0; continue; } // Expired.
+    if(hash == e.hash) { dup = true; }
+    }
+  if(dup) { return(true); }
+  rxDupEntry_t &e = rxDupCache[rxDupNext];
+  e.hash = hash;
+  e.tick = now;
+  rxDupNext = (rxDupNext + 1) & (RX_DUP_SLOTS-1);
+  return(false);
+  }
+#endif // ENABLE_RX_DUP_FILTER
+
+#if defined(ENABLE_RX_REPEATER)
+static constexpr uint8_t REPEATER_SEEN_SLOTS = 8; // Power of 2; REPEATER_TAG_BYTES of RAM each.
+static constexpr uint8_t REPEATER_TAG_BYTES = 4;
+static_assert(0 == (REPEATER_SEEN_SLOTS & (REPEATER_SEEN_SLOTS-1)), "repeater slots must be power of 2");
+// Leading tag bytes of the frames most recently considered.
+static uint8_t repeaterSeen[REPEATER_SEEN_SLOTS][REPEATER_TAG_BYTES];
+static uint8_t repeaterSeenNext;
+// Frame awaiting its turn, from its type byte, and its length (0 if none).
+static uint8_t repeaterBuf[64];
+static uint8_t repeaterLen;
+// Main ticks left before repeaterBuf is sent.
+static uint8_t repeaterWait;
+
+void repeaterRX(const uint8_t *const msg)
+  {
+  if(inHubMode()) { return; }
+  const uint8_t msglen = msg[-1];
+  if((msglen > sizeof(repeaterBuf)) || (msglen < SECURE_FRAME_0X80_TRAILER_BYTES)) { return; }
+  const uint8_t type = msg[0];
+  if((('O' | 0x80) != type)
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME)
+     && ((FTS_VALVE_SHORT_LOCAL | 0x80) != type)
+#endif
+    ) { return; }
+  OTRadioLink::SecurableFrameHeader sfh;
+  if((0 == sfh.checkAndDecodeSmallFrameHeader(msg-1, msglen+1)) || !sfh.isSecure()) { return; }
+  const uint8_t *const tag = secureFrameTag(msg, msglen);
+  for(uint8_t i = 0; i < REPEATER_SEEN_SLOTS; ++i)
+    {
+    if(0 != memcmp(tag, repeaterSeen[i], REPEATER_TAG_BYTES)) { continue; }
+#if !defined(ENABLE_SECURE_TX_ACK)
+    // Another repeater got there first.
+    // (With ACKs the second copy may instead be the sender's own resend, so keep going.)
+    if((0 != repeaterLen) && (0 == memcmp(tag, secureFrameTag(repeaterBuf, repeaterLen), REPEATER_TAG_BYTES))) { repeaterLen = 0; }
+#endif
+    return;
+    }
+  memcpy(repeaterSeen[repeaterSeenNext], tag, REPEATER_TAG_BYTES);
+  repeaterSeenNext = (repeaterSeenNext + 1) & (REPEATER_SEEN_SLOTS-1);
+  // Only for senders that this node is set up to serve.
+  if(OTV0P2BASE::getNextMatchingNodeID(0, sfh.id, sfh.getIl(), NULL) < 0) { return; }
+#if defined(ENABLE_RX_LINK_TABLE) && defined(ENABLE_RADIO_PRIMARY_RFM23B)
+  const uint8_t rssi = rxRSSIFor(msg);
+#else
+  const uint8_t rssi = 0;
+#endif
+  if((0 != rssi) && (rssi < REPEATER_MIN_RSSI)) { return; }
+  // A frame still pending is displaced: it has had its chance.
+  memcpy(repeaterBuf, msg, msglen);
+  repeaterLen = msglen;
+  const uint8_t tier = (rssi >= 2*REPEATER_MIN_RSSI) ? 0 : 1;
+  repeaterWait = (uint8_t)(2*tier + (getNodeIDByte(0) & 1));
+  }
+
+void repeaterTick()
+  {
+  if(0 == repeaterLen) { return; }
+  if(0 != repeaterWait) { --repeaterWait; return; }
+  ENERGY_ACCOUNT(EA_TX, PrimaryRadio.sendRaw(repeaterBuf, repeaterLen, primaryRadioChannel()));
+  repeaterLen = 0;
+  }
+#endif // ENABLE_RX_REPEATER
+
 // Incrementally process I/O and queued messages, including from the radio link.
 // This may mean printing them to Serial (which the passed Print object usually is),
 // or adjusting system parameters,
@@ -558,20 +3217,71 @@ bool handleQueuedMessages(Print *p, bool wakeSerialIfNeeded, OTRadioLink::OTRadi
   rl->poll();
 
   bool neededWaking = false; // Set true once this routine wakes Serial.
+#if defined(ENABLE_RX_DECRYPT_SESSION)
+  // One key fetch for the whole batch, wiped on return.
+  const RXDecryptSession session;
+#endif
   const volatile uint8_t *pb;
-  if(NULL != (pb = rl->peekRXMsg()))
+  bool priority;
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+  // Then take frames from the auxiliary receiver through the same path,
+  // where the duplicate filter drops any copy already heard by the primary.
+  for(uint8_t link = 0; link < 2; ++link)
+    {
+    if(0 != link)
+      {
+      if(OTV0P2BASE::getSubCycleTime() >= ((OTV0P2BASE::GSCT_MAX/4)*3)) { break; }
+      rl = &RFM23BAux;
+      rl->poll();
+      }
+#endif // ENABLE_RADIO_AUX_RX_RFM23B
+#if defined(ENABLE_RX_BATCH_DRAIN)
+  // Drain as much of the RX queue as the tick budget and cut-off allow,
+  // waking Serial (at most) once for the whole batch.
+  // The budget is only checked between frames so may be exceeded by one decode.
+  while(NULL != (pb = peekRX(rl, priority)))
+#else
+  if(NULL != (pb = peekRX(rl, priority)))
+#endif // ENABLE_RX_BATCH_DRAIN
     {
     if(!neededWaking && wakeSerialIfNeeded && OTV0P2BASE::powerUpSerialIfDisabled<V0P2_UART_BAUD>()) { neededWaking = true; } // FIXME
+#if defined(ENABLE_RX_FRAME_CAPTURE)
+    binRecCaptureRX((const uint8_t *)pb, pb[-1]);
+#endif
+    repeaterRX((const uint8_t *)pb);
+#if defined(ENABLE_RX_DUP_FILTER)
+    // Drop a repeat copy of a recent frame without decoding it.
+    if(rxIsDuplicate((const uint8_t *)pb)) { linkCountRXDup(); } else
+#endif
     // Don't currently regard anything arriving over the air as 'secure'.
     // FIXME: shouldn't have to cast away volatile to process the message content.
+    {
+    chanCountFrame();
+#if defined(ENABLE_RELAY_LATENCY_STATS)
+    const uint32_t decodeStart = (rl == &PrimaryRadio) ? latencyRXDecodeStart() : hiresTime();
+#endif
     decodeAndHandleRawRXedMessage(p, false, (const uint8_t *)pb);
-    rl->removeRXMsg();
+#if defined(ENABLE_RELAY_LATENCY_STATS)
+    latencyRecord(LAT_DECODE, decodeStart);
+#endif
+    }
+    removeRX(rl, priority);
     // Note that some work has been done.
     workDone = true;
+#if defined(ENABLE_RX_BATCH_DRAIN)
+    const uint8_t sctNow = OTV0P2BASE::getSubCycleTime();
+    if((sctNow >= ((OTV0P2BASE::GSCT_MAX/4)*3)) ||
+       ((uint8_t)(sctNow - sctStart) >= RX_BATCH_DRAIN_BUDGET_SCT)) { break; }
+    // Pick up anything that arrived while decoding.
+    rl->poll();
+#endif // ENABLE_RX_BATCH_DRAIN
     }
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+    }
+#endif // ENABLE_RADIO_AUX_RX_RFM23B
 
   // Turn off serial at end, if this routine woke it.
-  if(neededWaking) { OTV0P2BASE::flushSerialProductive(); OTV0P2BASE::powerDownSerial(); }
+  if(neededWaking) { releaseSerial(); }
 
 #if 0 && defined(DEBUG)
   const uint8_t sctEnd = OTV0P2BASE::getSubCycleTime();
@@ -583,7 +3293,53 @@ bool handleQueuedMessages(Print *p, bool wakeSerialIfNeeded, OTRadioLink::OTRadi
     }
 #endif
 
+#if defined(ENABLE_SLOT_PROFILER)
+  profileSlot(PROFILE_SLOT_RX, sctStart);
+#endif
+
   return(workDone);
   }
+
+#if defined(ENABLE_RX_FRAME_CAPTURE)
+// Read one SLIP-framed 'R' record (as captured) from Serial and decode its frame as if just received.
+// Gives up if the record is incomplete before the sub-cycle time reaches stopBy,
+// or if it is malformed or fails its CRC; returns true iff a frame was decoded.
+bool replayRXFrame(const uint8_t stopBy)
+  {
+  // type, idLen (0), seq, 3 timestamp bytes, frame, crc.
+  uint8_t rec[6 + 64 + 1];
+  uint8_t len = 0;
+  bool started = false;
+  bool esc = false;
+  for( ; ; )
+    {
+    if(OTV0P2BASE::getSubCycleTime() >= stopBy) { return(false); }
+    const int c = Serial.read();
+    if(c < 0) { continue; }
+    if(SLIP_END == c)
+      {
+      if(started && (0 != len)) { break; }
+      started = true; len = 0; esc = false;
+      continue;
+      }
+    if(!started) { continue; }
+    if(len >= sizeof(rec)) { return(false); }
+    if(esc) { rec[len++] = (SLIP_ESC_END == c) ? SLIP_END : ((SLIP_ESC_ESC == c) ? SLIP_ESC : c); esc = false; }
+    else if(SLIP_ESC == c) { esc = true; }
+    else { rec[len++] = c; }
+    }
+  if((len < 6 + 2 + 1) || ('R' != rec[0]) || (0 != rec[1])) { return(false); }
+  uint8_t crc = 0x7f;
+  for(uint8_t i = 0; i < len - 1; ++i) { crc = crc7Update(crc, rec[i]); }
+  if(crc != rec[len-1]) { return(false); }
+  // Overwrite the last timestamp byte with the frame length, as the RX queue would present it.
+  rec[5] = len - 7;
+#if defined(ENABLE_RX_DECRYPT_SESSION)
+  const RXDecryptSession session;
+#endif
+  decodeAndHandleRawRXedMessage(&Serial, false, rec + 6);
+  return(true);
+  }
+#endif // ENABLE_RX_FRAME_CAPTURE
 #endif // ENABLE_RADIO_RX
 
@@ -23,6 +23,10 @@ Author(s) / Copyright (s): Damon Hart-Davis 2013--2017
 
 #include "V0p2_Main.h"
 
+#if defined(ENABLE_BULK_STATS_EXPORT)
+#include <util/crc16.h>
+#endif
+
 #if defined(valveUI_DEFINED)
 // Valve physical UI controller.
 valveUI_t valveUI(
@@ -52,6 +56,108 @@ valveUI_t valveUI(
 
 
 #ifdef ENABLE_EXTENDED_CLI
+// Margin in sub-cycle ticks to leave at the end of the minor cycle after extended CLI output.
+static constexpr uint8_t CLI_EXT_PRINT_OH_SCT = ((uint8_t)(OTV0P2BASE::GSCT_MAX/8));
+
+#if defined(ENABLE_BULK_STATS_EXPORT)
+// Bulk export blob, version 1, big-endian where multi-byte:
+//   [0] format version (1)
+//   [1..8] node ID
+//   [9..10] reset count (V0P2BASE_EE_START_RESET_COUNT, COUNT2)
+//   [11] raw (inverted) overrun counter
+//   [12..19] persistent TX message restart counters (primary and alternate)
+//   [20] number of stats sets S
+//   [21..] S sets of 24 by-hour bytes, as read through eeStats
+//   then CRC-16/CCITT (as avr-libc _crc_ccitt_update(), initialised to 0xffff) of all preceding bytes.
+// Sent as SLIP 'X' records (see Messaging.cpp) of up to EXPORT_CHUNK_BYTES each,
+// as many as fit before the deadline in each minor cycle;
+// util/v0p2_binary_serial_decode.py reassembles and checks them.
+// Each record carries its own offset and CRC so a damaged one is dropped alone.
+// Stats sampled part-way through restart the export at offset 0 (exportRestartIfActive()),
+// so the blob never mixes values from before and after a sample; the host discards the partial blob.
+static constexpr uint8_t EXPORT_HEADER_BYTES = 21;
+static constexpr uint8_t EXPORT_SETS = OTV0P2BASE::NVByHourByteStatsBase::STATS_SETS_COUNT;
+static constexpr uint16_t EXPORT_BODY_BYTES = EXPORT_HEADER_BYTES + 24U * EXPORT_SETS;
+static constexpr uint8_t EXPORT_CHUNK_BYTES = 16;
+// 1 + offset of next blob byte to send if an export is in progress, else 0.
+static uint16_t exportResume;
+static uint16_t exportCRC;
+// Get blob byte i < EXPORT_BODY_BYTES.
+static uint8_t exportByte(const uint16_t i)
+  {
+  if(0 == i) { return(1); }
+  if(i < 9) { return(getNodeIDByte(i - 1)); }
+  if(i < 11) { return(eeprom_read_byte((uint8_t *)(V0P2BASE_EE_START_RESET_COUNT + (i - 9)))); }
+  if(11 == i) { return(eeQueuedReadByte((uint8_t *)V0P2BASE_EE_START_OVERRUN_COUNTER)); }
+  if(i < 20) { return(eeprom_read_byte((uint8_t *)(OTV0P2BASE::VOP2BASE_EE_START_PERSISTENT_MSG_RESTART_CTR + (i - 12)))); }
+  if(20 == i) { return(EXPORT_SETS); }
+  const uint16_t j = i - EXPORT_HEADER_BYTES;
+  return(eeStats.getByHourStatRaw((uint8_t)(j / 24), (uint8_t)(j % 24)));
+  }
+void exportRestartIfActive() { if(0 != exportResume) { exportResume = 1; exportCRC = 0xffff; } }
+// Send the next export chunk; exportResume must be non-zero.
+static void exportOneChunk()
+  {
+  const uint8_t id[2] = { getNodeIDByte(0), getNodeIDByte(1) };
+  const uint16_t offset = exportResume - 1;
+  uint8_t chunk[2 + EXPORT_CHUNK_BYTES];
+  chunk[0] = (uint8_t)(offset >> 8);
+  chunk[1] = (uint8_t)offset;
+  uint8_t len = 2;
+  uint16_t i = offset;
+  for( ; (len < sizeof(chunk)) && (i < EXPORT_BODY_BYTES + 2); ++i)
+    {
+    uint8_t b;
+    if(i < EXPORT_BODY_BYTES) { b = exportByte(i); exportCRC = _crc_ccitt_update(exportCRC, b); }
+    else { b = (i == EXPORT_BODY_BYTES) ? (uint8_t)(exportCRC >> 8) : (uint8_t)exportCRC; }
+    chunk[len++] = b;
+    }
+  binRecStart('X', id, sizeof(id), (uint8_t)(offset / EXPORT_CHUNK_BYTES));
+  binRecPut(chunk, len);
+  binRecEnd();
+  exportResume = (i < EXPORT_BODY_BYTES + 2) ? (i + 1) : 0;
+  }
+#if defined(ENABLE_COOP_TASKS)
+bool exportTask()
+  {
+  static coopState_t s;
+  COOP_BEGIN(s);
+  while(0 != exportResume)
+    {
+    exportOneChunk();
+    COOP_YIELD(s);
+    }
+  COOP_END(s);
+  }
+#else
+// Send export chunks until done or stopBy sub-cycle time.
+static void exportChunks(const uint8_t stopBy)
+  {
+  while(0 != exportResume)
+    {
+    OTV0P2BASE::flushSerialProductive(); // Ensure pending output is flushed before sampling current position in minor cycle.
+    if(OTV0P2BASE::getSubCycleTime() >= stopBy) { return; }
+    exportOneChunk();
+    }
+  }
+#endif // ENABLE_COOP_TASKS
+#endif // ENABLE_BULK_STATS_EXPORT
+
+#if defined(ENABLE_REMOTE_DIAG) || defined(ENABLE_RUNTIME_PROFILE) || defined(ENABLE_VALVE_MOVE_LOG)
+// Parse p as a decimal number 0--max, allowing trailing spaces only; false if malformed or out of range.
+static bool parseCLIUint8(const char *p, const uint8_t max, uint8_t &out)
+  {
+  uint16_t v = 0;
+  const char *const start = p;
+  for( ; ('0' <= *p) && (*p <= '9'); ++p) { if((v = 10*v + (*p - '0')) > max) { return(false); } }
+  if(start == p) { return(false); }
+  while(' ' == *p) { ++p; }
+  if('\0' != *p) { return(false); }
+  out = (uint8_t)v;
+  return(true);
+  }
+#endif
+
 // Handle CLI extension commands.
 // Commands of form:
 //   +EXT .....
@@ -61,6 +167,184 @@ valveUI_t valveUI(
 // eg with strtok_t().
 static bool extCLIHandler(Print *const p, char *const buf, const uint8_t n)
   {
+  stackTag(STACK_TAG_CLI);
+#if defined(ENABLE_SLOT_PROFILER)
+  // Slot profile dump: +PRF, or clear with +PRF Z
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("PRF"), 3)))
+    {
+    if((n >= 6) && ('Z' == buf[5])) { profileReset(); }
+    else { printSlotTaskLoad(); profileDump(OTV0P2BASE::GSCT_MAX - CLI_EXT_PRINT_OH_SCT); }
+    return(true);
+    }
+#endif // ENABLE_SLOT_PROFILER
+#if defined(ENABLE_OVERRUN_LOG)
+  // Overrun log dump, most recent first: +OVR, or clear with +OVR Z
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("OVR"), 3)))
+    {
+    if((n >= 6) && ('Z' == buf[5])) { clearOverrunLog(); }
+    else { dumpOverrunLog((~eeQueuedReadByte((uint8_t *)V0P2BASE_EE_START_OVERRUN_COUNTER)) & 0xff); }
+    return(true);
+    }
+#endif // ENABLE_OVERRUN_LOG
+#if defined(ENABLE_BULK_STATS_EXPORT)
+  // Bulk binary export of stats, IDs and counters, spread over as many minor cycles as needed: +EXP
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("EXP"), 3)))
+    {
+    exportResume = 1;
+    exportCRC = 0xffff;
+#if defined(ENABLE_COOP_TASKS)
+    coopTaskStart(COOP_TASK_EXPORT);
+#else
+    exportChunks(OTV0P2BASE::GSCT_MAX - CLI_EXT_PRINT_OH_SCT);
+#endif
+    return(true);
+    }
+#endif // ENABLE_BULK_STATS_EXPORT
+#if defined(ENABLE_HIGH_RES_STATS_RING)
+  // 5-minute stats for one hour of day, for the last two days: +HRS hh
+  if((n >= 6) && (0 == strncmp_P(buf+1, PSTR("HRS"), 3)))
+    {
+    dumpHighResStats((uint8_t) atoi(buf+5));
+    return(true);
+    }
+#endif // ENABLE_HIGH_RES_STATS_RING
+#if defined(ENABLE_EEPROM_WEAR_STATS)
+  // EEPROM write rates and projected lifetime by region: +EEW, or clear with +EEW Z
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("EEW"), 3)))
+    {
+    if((n >= 6) && ('Z' == buf[5])) { clearEEWearStats(); }
+    else { printEEWearStats(); }
+    return(true);
+    }
+#endif // ENABLE_EEPROM_WEAR_STATS
+#if defined(ENABLE_VALVE_MOVE_LOG)
+  // Valve movement events as binary records: +VML, or from event seq s on with +VML s
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("VML"), 3)))
+    {
+    uint8_t from = 0;
+    const bool filtered = (n >= 6);
+    if(filtered && !parseCLIUint8(buf+5, 255, from)) { OTV0P2BASE::CLI::InvalidIgnored(); return(false); }
+    valveMoveLogDumpFrom(filtered, from);
+#if defined(ENABLE_COOP_TASKS)
+    coopTaskStart(COOP_TASK_VML_DUMP);
+#else
+    valveMoveLogDump(OTV0P2BASE::GSCT_MAX - CLI_EXT_PRINT_OH_SCT);
+#endif
+    return(true);
+    }
+#endif // ENABLE_VALVE_MOVE_LOG
+#if defined(ENABLE_ENERGY_ACCOUNTING)
+  // Awake ticks by category and estimated mean current: +NRG
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("NRG"), 3)))
+    {
+    printEnergyStats();
+    return(true);
+    }
+#endif // ENABLE_ENERGY_ACCOUNTING
+#if defined(ENABLE_TX_PATH_BENCHMARK)
+  // Cycles and stack per stats encode/decode path: +BEN
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("BEN"), 3)))
+    {
+    benchmarkTXPaths();
+    return(true);
+    }
+#endif // ENABLE_TX_PATH_BENCHMARK
+#if defined(ENABLE_ISR_PROFILER)
+  // ISR duration profile dump: +ISR, or clear with +ISR Z
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("ISR"), 3)))
+    {
+    if((n >= 6) && ('Z' == buf[5])) { isrProfileReset(); }
+    else { isrProfileDump(); }
+    return(true);
+    }
+#endif // ENABLE_ISR_PROFILER
+#if defined(ENABLE_RELAY_LATENCY_STATS)
+  // RX-to-relay latency by stage: +LAT, or clear with +LAT Z
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("LAT"), 3)))
+    {
+    if((n >= 6) && ('Z' == buf[5])) { latencyReset(); }
+    else { latencyDump(); }
+    return(true);
+    }
+#endif // ENABLE_RELAY_LATENCY_STATS
+#if defined(ENABLE_RX_FRAME_CAPTURE) && defined(ENABLE_RADIO_RX)
+  // Replay one captured frame, sent as a binary 'R' record straight after the command: +RXI
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("RXI"), 3)))
+    {
+    if(!replayRXFrame(OTV0P2BASE::GSCT_MAX - CLI_EXT_PRINT_OH_SCT)) { OTV0P2BASE::serialPrintlnAndFlush(F("!RXI")); }
+    return(true);
+    }
+#endif // ENABLE_RX_FRAME_CAPTURE
+#if defined(ENABLE_RUNTIME_PROFILE)
+  // Feature profile: +PFL shows the active and stored masks, +PFL n stores n for the next boot.
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("PFL"), 3)))
+    {
+    if(n >= 6)
+      {
+      uint8_t mask;
+      if(!parseCLIUint8(buf+5, 255, mask) || ((0xff != mask) && (0 != (mask & ~PROFILE_ALL_ROLES)))) { OTV0P2BASE::CLI::InvalidIgnored(); return(false); }
+      eeUpdateByte(EEW_CONFIG, (uint8_t *)V0P2_EE_START_FEATURE_PROFILE, mask);
+      }
+    Serial.print(featureProfile);
+    OTV0P2BASE::Serial_print_space();
+    Serial.println(eeprom_read_byte((uint8_t *)V0P2_EE_START_FEATURE_PROFILE));
+    return(true);
+    }
+#endif // ENABLE_RUNTIME_PROFILE
+#if defined(ENABLE_RX_LINK_TABLE)
+  // Per-sender RSSI, loss and last heard, one JSON line per associated node: +LNK
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("LNK"), 3)))
+    {
+    rxLinkTableDump();
+    return(true);
+    }
+#endif // ENABLE_RX_LINK_TABLE
+#if defined(ENABLE_REMOTE_DIAG)
+  // Request diagnostics via its next ACKs from an associated node,
+  // by association slot N (a single digit, from 0) or by node ID or a prefix of at least 2 bytes in hex: +DGQ N or +DGQ hhhh...
+  if((n >= 6) && (0 == strncmp_P(buf+1, PSTR("DGQ"), 3)))
+    {
+    uint8_t al = 0;
+    while(('\0' != buf[5 + al]) && (' ' != buf[5 + al])) { ++al; }
+    int8_t slot = -1;
+    if(1 == al)
+      {
+      uint8_t s;
+      if(parseCLIUint8(buf+5, V0P2BASE_EE_NODE_ASSOCIATIONS_MAX_SETS - 1, s)) { slot = (int8_t)s; }
+      }
+    else if((al >= 4) && (0 == (al & 1)) && (al <= 2*OTV0P2BASE::OpenTRV_Node_ID_Bytes))
+      {
+      uint8_t prefix[OTV0P2BASE::OpenTRV_Node_ID_Bytes];
+      bool ok = true;
+      for(uint8_t i = 0; ok && (i < al/2); ++i)
+        {
+        const int b = OTV0P2BASE::parseHexByte(buf + 5 + 2*i);
+        if(-1 == b) { ok = false; } else { prefix[i] = (uint8_t) b; }
+        }
+      if(ok) { slot = OTV0P2BASE::getNextMatchingNodeID(0, prefix, al/2, NULL); }
+      }
+    if((slot < 0) || !remoteDiagRequest((uint8_t)slot)) { OTV0P2BASE::CLI::InvalidIgnored(); return(false); }
+    return(true);
+    }
+#endif // ENABLE_REMOTE_DIAG
+#if defined(ENABLE_STATS_KEY_SUBSCRIPTION)
+  // Set the site's wanted optional stats keys as a STATS_SUB_XXX bitmap, eg 255 for all: +SUB N
+  if((n >= 6) && (0 == strncmp_P(buf+1, PSTR("SUB"), 3)))
+    {
+    const int keys = atoi(buf+5);
+    if((keys < 0) || (keys > 255)) { return(false); }
+    statsSubscriptionSet((uint8_t) keys);
+    return(true);
+    }
+#endif // ENABLE_STATS_KEY_SUBSCRIPTION
+#if defined(ENABLE_NODE_REGISTRY)
+  // Latest values heard from each secure sender, one JSON line per node: +NOD
+  if((n >= 4) && (0 == strncmp_P(buf+1, PSTR("NOD"), 3)))
+    {
+    nodeRegistryDump();
+    return(true);
+    }
+#endif // ENABLE_NODE_REGISTRY
   return(false); // FAILED if not otherwise handled.
   }
 #endif 
@@ -73,414 +357,749 @@ static constexpr uint8_t SYNTAX_COL_WIDTH = 10; // Width of 'syntax' column; str
 static constexpr uint8_t CLI_PRINT_OH_SCT = ((uint8_t)(OTV0P2BASE::GSCT_MAX/4));
 // Deadline in minor cycle by which to stop printing description.
 static constexpr uint8_t STOP_PRINTING_DESCRIPTION_AT = ((uint8_t)(OTV0P2BASE::GSCT_MAX-CLI_PRINT_OH_SCT));
-// Efficiently print a single line given the syntax element and the description, both non-null.
-// NOTE: will skip the description if getting close to the end of the time deadline, in order to avoid overrun.
-static void printCLILine(const uint8_t deadline, __FlashStringHelper const *syntax, __FlashStringHelper const *description)
+// Position in help output that may be spread over several minor cycles.
+// Whole lines are printed or deferred, never truncated.
+struct CLIOutputCursor_t
   {
-  Serial.print(syntax);
-  OTV0P2BASE::flushSerialProductive(); // Ensure all pending output is flushed before sampling current position in minor cycle.
-  if(OTV0P2BASE::getSubCycleTime() >= deadline) { Serial.println(); return; }
-  for(int8_t padding = SYNTAX_COL_WIDTH - strlen_P((const char *)syntax); --padding >= 0; ) { OTV0P2BASE::Serial_print_space(); }
-  Serial.println(description);
-  }
-// Efficiently print a single line given a single-char syntax element and the description, both non-null.
-// NOTE: will skip the description if getting close to the end of the time deadline to avoid overrun.
-static void printCLILine(const uint8_t deadline, const char syntax, __FlashStringHelper const *description)
+  const uint8_t deadline; // Sub-cycle time by which to stop printing this cycle.
+  const uint8_t skip; // Lines already printed in earlier minor cycles.
+  uint8_t line; // Lines counted so far.
+  bool stopped; // Set true once out of time this cycle.
+  };
+// 1 + lines already printed when help output is to be resumed next minor cycle, else 0.
+static uint8_t cliHelpResume;
+// Count the next line and return true iff it should be printed now.
+// Once the deadline is reached stops and notes where to resume.
+static bool nextCLILine(CLIOutputCursor_t &c)
   {
-  Serial.print(syntax);
+  if(c.stopped) { return(false); }
+  if(c.line++ < c.skip) { return(false); }
   OTV0P2BASE::flushSerialProductive(); // Ensure all pending output is flushed before sampling current position in minor cycle.
-  if(OTV0P2BASE::getSubCycleTime() >= deadline) { Serial.println(); return; }
-  for(int8_t padding = SYNTAX_COL_WIDTH - 1; --padding >= 0; ) { OTV0P2BASE::Serial_print_space(); }
-  Serial.println(description);
+  if(OTV0P2BASE::getSubCycleTime() >= c.deadline) { c.stopped = true; cliHelpResume = c.line; return(false); }
+  return(true);
   }
-#endif // defined(ENABLE_CLI_HELP) && !defined(ENABLE_TRIMMED_MEMORY)
-
-// Dump some brief CLI usage instructions to serial TX, which must be up and running.
-// If this gets too big there is a risk of overrunning and missing the next tick...
-static void dumpCLIUsage(const uint8_t stopBy)
-  {
-#ifndef _CLI_HELP_
-  OTV0P2BASE::CLI::InvalidIgnored(); // Minimal placeholder.
-#else
-  const uint8_t deadline = OTV0P2BASE::fnmin((uint8_t)(stopBy - OTV0P2BASE::fnmin(stopBy,CLI_PRINT_OH_SCT)), STOP_PRINTING_DESCRIPTION_AT);
-  Serial.println();
-  //Serial.println(F("CLI usage:"));
-  printCLILine(deadline, '?', F("this help"));
-  
+// Help text as one flash string of NUL-terminated syntax, description pairs, ending with an empty syntax.
+// An empty description prints the syntax alone, eg as a separator.
+// Each string is a separate literal so that a following digit is never taken as part of an octal escape.
+static const char cliHelpText[] PROGMEM =
+  "?" "\0" "this help" "\0"
   // Core CLI features first... (E, [H], I, S V)
-  printCLILine(deadline, 'E', F("Exit CLI"));
+  "E" "\0" "Exit CLI" "\0"
 #if defined(ENABLE_FHT8VSIMPLE) && defined(ENABLE_LOCAL_TRV)
-  printCLILine(deadline, F("H H1 H2"), F("set FHT8V House codes 1&2"));
-  printCLILine(deadline, 'H', F("clear House codes"));
+  "H H1 H2" "\0" "set FHT8V House codes 1&2" "\0"
+  "H" "\0" "clear House codes" "\0"
+#endif
+  "I *" "\0" "create new ID" "\0"
+#if defined(ENABLE_DUAL_RX_KEY)
+  "K P" "\0" "drop Previous key now" "\0"
 #endif
-  printCLILine(deadline, F("I *"), F("create new ID"));
-  printCLILine(deadline, 'S', F("show Status"));
-  printCLILine(deadline, 'V', F("sys Version"));
+  "S" "\0" "show Status" "\0"
+  "V" "\0" "sys Version" "\0"
 #ifdef ENABLE_GENERIC_PARAM_CLI_ACCESS
-  printCLILine(deadline, F("G N [M]"), F("Show [set] generic param N [to M]")); // *******
+  "G N [M]" "\0" "Show [set] generic param N [to M]" "\0"
 #endif
-
 #ifdef ENABLE_FULL_OT_CLI
   // Optional CLI features...
-  Serial.println(F("-"));
+  "-" "\0" "" "\0"
+#if defined(ENABLE_BULK_NODE_ASSOC)
+  "B S ID.. CC" "\0" "Bulk load assoc IDs from slot S" "\0"
+  "B N" "\0" "keep first N assoc IDs" "\0"
+#endif
 #if defined(ENABLE_BOILER_HUB) || defined(ENABLE_STATS_RX)
-  printCLILine(deadline, F("C M"), F("Central hub >=M mins on, 0 off"));
+  "C M" "\0" "Central hub >=M mins on, 0 off" "\0"
 #endif
-  printCLILine(deadline, F("D N"), F("Dump stats set N"));
-  printCLILine(deadline, 'F', F("Frost"));
+  "D N" "\0" "Dump stats set N" "\0"
+  "F" "\0" "Frost" "\0"
 #if defined(ENABLE_SETTABLE_TARGET_TEMPERATURES) && !defined(TEMP_POT_AVAILABLE)
-  printCLILine(deadline, F("F CC"), F("set Frost/setback temp CC"));
+  "F CC" "\0" "set Frost/setback temp CC" "\0"
 #endif
-
-  //printCLILine(deadline, 'L', F("Learn to warm every 24h from now, clear if in frost mode, schedule 0"));
 #if defined(SCHEDULER_AVAILABLE)
-  printCLILine(deadline, F("L S"), F("Learn daily warm now, clear if in frost mode, schedule S"));
-  //printCLILine(deadline, F("P HH MM"), F("Program: warm daily starting at HH MM schedule 0"));
-  printCLILine(deadline, F("P HH MM S"), F("Program: warm daily starting at HH MM schedule S"));
+  "L S" "\0" "Learn daily warm now, clear if in frost mode, schedule S" "\0"
+  "P HH MM S" "\0" "Program: warm daily starting at HH MM schedule S" "\0"
 #endif
-  printCLILine(deadline, F("O PP"), F("min % for valve to be Open"));
+  "O PP" "\0" "min % for valve to be Open" "\0"
 #if defined(ENABLE_NOMINAL_RAD_VALVE)
-  printCLILine(deadline, 'O', F("reset Open %"));
+  "O" "\0" "reset Open %" "\0"
 #endif
-  printCLILine(deadline, 'Q', F("Quick Heat"));
-//  printCLILine(deadline, F("R N"), F("dump Raw stats set N"));
-
-  printCLILine(deadline, F("T HH MM"), F("set 24h Time"));
-  printCLILine(deadline, 'W', F("Warm"));
+  "Q" "\0" "Quick Heat" "\0"
+  "T HH MM" "\0" "set 24h Time" "\0"
+  "W" "\0" "Warm" "\0"
 #if defined(ENABLE_SETTABLE_TARGET_TEMPERATURES) && !defined(TEMP_POT_AVAILABLE)
-  printCLILine(deadline, F("W CC"), F("set Warm temp CC"));
+  "W CC" "\0" "set Warm temp CC" "\0"
 #endif
 #if !defined(ENABLE_ALWAYS_TX_ALL_STATS)
-  printCLILine(deadline, 'X', F("Xmit security level; 0 always, 255 never"));
+  "X" "\0" "Xmit security level; 0 always, 255 never" "\0"
 #endif
-  printCLILine(deadline, 'Z', F("Zap stats"));
+  "Z" "\0" "Zap stats" "\0"
 #endif // ENABLE_FULL_OT_CLI
+  ; // Implicit final NUL is the empty terminating syntax.
+#endif // defined(ENABLE_CLI_HELP) && !defined(ENABLE_TRIMMED_MEMORY)
+
+// Dump some brief CLI usage instructions to serial TX, which must be up and running.
+// Output not completed by the deadline is resumed from the next pollCLI() call.
+static void dumpCLIUsage(const uint8_t stopBy)
+  {
+#ifndef _CLI_HELP_
+  OTV0P2BASE::CLI::InvalidIgnored(); // Minimal placeholder.
+#else
+  const uint8_t deadline = OTV0P2BASE::fnmin((uint8_t)(stopBy - OTV0P2BASE::fnmin(stopBy,CLI_PRINT_OH_SCT)), STOP_PRINTING_DESCRIPTION_AT);
+  const uint8_t skip = (0 == cliHelpResume) ? 0 : (cliHelpResume - 1);
+  cliHelpResume = 0;
+  CLIOutputCursor_t c = { deadline, skip, 0, false };
+  if(0 == skip) { Serial.println(); }
+  for(const char *p = cliHelpText; 0 != pgm_read_byte(p); )
+    {
+    const char *const syntax = p;
+    const uint8_t syntaxLen = strlen_P(syntax);
+    const char *const description = syntax + syntaxLen + 1;
+    p = description + strlen_P(description) + 1;
+    if(!nextCLILine(c)) { if(c.stopped) { return; } else { continue; } } // Stopped means more to come.
+    Serial.print((const __FlashStringHelper *)syntax);
+    if(0 == pgm_read_byte(description)) { Serial.println(); continue; }
+    for(int8_t padding = SYNTAX_COL_WIDTH - syntaxLen; --padding >= 0; ) { OTV0P2BASE::Serial_print_space(); }
+    Serial.println((const __FlashStringHelper *)description);
+    }
 #endif // ENABLE_CLI_HELP
   Serial.println();
   }
 
-//#if defined(ENABLE_EXTENDED_CLI) || defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
-//static const uint8_t MAXIMUM_CLI_RESPONSE_CHARS = 1 + OTV0P2BASE::CLI::MAX_TYPICAL_CLI_BUFFER;
-//#else
-//static const uint8_t MAXIMUM_CLI_RESPONSE_CHARS = 1 + OTV0P2BASE::CLI::MIN_TYPICAL_CLI_BUFFER;
-//#endif
-// Used to poll user side for CLI input until specified sub-cycle time.
-// Commands should be sent terminated by CR *or* LF; both may prevent 'E' (exit) from working properly.
-// A period of less than (say) 500ms will be difficult for direct human response on a raw terminal.
-// A period of less than (say) 100ms is not recommended to avoid possibility of overrun on long interactions.
-// Times itself out after at least a minute or two of inactivity. 
-// NOT RENTRANT (eg uses static state for speed and code space).
-void pollCLI(const uint8_t maxSCT, const bool startOfMinute, const OTV0P2BASE::ScratchSpace &s)
+// Parsed CLI command line, passed to each command handler.
+static constexpr uint8_t CLI_MAX_INT_ARGS = 3;
+struct CLIArgs_t
   {
-  // Perform any once-per-minute operations.
-  if(startOfMinute)
-    { OTV0P2BASE::CLI::countDownCLI(); }
-
-  const bool neededWaking = OTV0P2BASE::powerUpSerialIfDisabled<V0P2_UART_BAUD>();
-
-  // Wait for input command line from the user (received characters may already have been queued)...
-  // Read a line up to a terminating CR, either on its own or as part of CRLF.
-  // (Note that command content and timing may be useful to fold into PRNG entropy pool.)
-  // A static buffer generates better code but permanently consumes previous SRAM.
-  const uint8_t n = OTV0P2BASE::CLI::promptAndReadCommandLine(maxSCT, s, [](){pollIO();});
-  char *buf = (char *)s.buf;
-//  const uint8_t bufsize = s.bufsize;
-
-  if(n > 0)
+  uint8_t maxSCT; // Sub-cycle time by which the CLI poll should finish.
+  uint8_t count; // Number of leading integer arguments parsed into v[].
+  int v[CLI_MAX_INT_ARGS];
+  };
+// Shared tokenizer: parse up to CLI_MAX_INT_ARGS space-separated integers (as atoi())
+// from the command line after the command letter and its following separator.
+// Does not alter the buffer, so (library) handlers can still parse it in their own way.
+static void parseCLIArgs(const char *const buf, const uint8_t n, CLIArgs_t &a)
+  {
+  a.count = 0;
+  if(n < 3) { return; } // Minimum 3 character sequence needed for an argument, eg "C 0".
+  for(const char *p = buf + 2; ; )
     {
-    // Got plausible input so keep the CLI awake a little longer.
-    OTV0P2BASE::CLI::resetCLIActiveTimer();
+    while(' ' == *p) { ++p; }
+    if(('\0' == *p) || (a.count >= CLI_MAX_INT_ARGS)) { return; }
+    a.v[a.count++] = atoi(p);
+    while(('\0' != *p) && (' ' != *p)) { ++p; }
+    }
+  }
 
-    // Process the input received, with action based on the first char...
-    bool showStatus = true; // Default to showing status.
-    switch(buf[0])
-      {
-      // Explicit request for help, or unrecognised first character.
-      // Avoid showing status as may already be rather a lot of output.
-      default: case '?': { dumpCLIUsage(maxSCT); showStatus = false; break; }
+// CLI command handler for the whole line buf of length n.
+// Returns true to show status afterwards, false to show just an ack.
+typedef bool (*CLIHandler_t)(char *buf, uint8_t n, const CLIArgs_t &a);
 
-      // Exit/deactivate CLI immediately.
-      // This should be followed by JUST CR ('\r') OR LF ('\n')
-      // else the second will wake the CLI up again.
-      case 'E': { OTV0P2BASE::CLI::makeCLIInactive(); break; }
+// Explicit request for help, or unrecognised first character.
+// Avoid showing status as may already be rather a lot of output.
+static bool cliHelp(char *, uint8_t, const CLIArgs_t &a) { dumpCLIUsage(a.maxSCT); return(false); }
+
+// Exit/deactivate CLI immediately.
+// This should be followed by JUST CR ('\r') OR LF ('\n')
+// else the second will wake the CLI up again.
+static bool cliExit(char *, uint8_t, const CLIArgs_t &) { OTV0P2BASE::CLI::makeCLIInactive(); return(true); }
 
 #if defined(ENABLE_FHT8VSIMPLE) && (defined(ENABLE_LOCAL_TRV) || defined(ENABLE_SLAVE_TRV))
-      // H [nn nn]
-      // Set (non-volatile) HC1 and HC2 for single/primary FHT8V wireless valve under control.
-      // Missing values will clear the code entirely (and disable use of the valve).
-      case 'H': { showStatus = OTRadValve::FHT8VRadValveBase::SetHouseCode(&FHT8V).doCommand(buf, n); break; }
+// H [nn nn]
+// Set (non-volatile) HC1 and HC2 for single/primary FHT8V wireless valve under control.
+// Missing values will clear the code entirely (and disable use of the valve).
+static bool cliHouseCode(char *buf, uint8_t n, const CLIArgs_t &) { return(OTRadValve::FHT8VRadValveBase::SetHouseCode(&FHT8V).doCommand(buf, n)); }
 #endif
 
 #if defined(ENABLE_GENERIC_PARAM_CLI_ACCESS)
-      // Show/set generic parameter values (eg "G N [M]").
-      case 'G': { showStatus = OTV0P2BASE::CLI::GenericParam().doCommand(buf, n); break; }
+// Show/set generic parameter values (eg "G N [M]").
+static bool cliGenericParam(char *buf, uint8_t n, const CLIArgs_t &) { return(OTV0P2BASE::CLI::GenericParam().doCommand(buf, n)); }
 #endif
 
-      // Reset or display ID.
+// Reset or display ID.
 #ifdef ENABLE_ID_SET_FROM_CLI
-      case 'I': { showStatus = OTV0P2BASE::CLI::NodeIDWithSet().doCommand(buf, n); break; }
+static bool cliID(char *buf, uint8_t n, const CLIArgs_t &) { return(OTV0P2BASE::CLI::NodeIDWithSet().doCommand(buf, n)); }
 #else
-      case 'I': { showStatus = OTV0P2BASE::CLI::NodeID().doCommand(buf, n); break; }
+static bool cliID(char *buf, uint8_t n, const CLIArgs_t &) { return(OTV0P2BASE::CLI::NodeID().doCommand(buf, n)); }
 #endif
 
-      // Status line stats print and TX.
-      case 'S':
-        {
+// Status line stats print and TX.
+// Note that status is by default printed after processing input line.
+static bool cliStatus(char *, uint8_t, const CLIArgs_t &)
+  {
 #if !defined(ENABLE_WATCHDOG_SLOW)
-        Serial.print(F("Resets/overruns: "));
+  Serial.print(F("Resets/overruns: "));
 #else
-        Serial.print(F("Resets: "));
+  Serial.print(F("Resets: "));
 #endif // !defined(ENABLE_WATCHDOG_SLOW) 
-        const uint8_t resetCount = eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_RESET_COUNT);
-        Serial.print(resetCount);
+  const uint8_t resetCount = eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_RESET_COUNT);
+  Serial.print(resetCount);
 #if !defined(ENABLE_WATCHDOG_SLOW)
-        Serial.print(' ');
-        const uint8_t overrunCount = (~eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_OVERRUN_COUNTER)) & 0xff;
-        Serial.print(overrunCount);
+  Serial.print(' ');
+  const uint8_t overrunCount = (~eeQueuedReadByte((uint8_t *)V0P2BASE_EE_START_OVERRUN_COUNTER)) & 0xff;
+  Serial.print(overrunCount);
 #endif // !defined(ENABLE_WATCHDOG_SLOW)
-        Serial.println();
-        // Show stack headroom.
-        OTV0P2BASE::serialPrintAndFlush(F("SH ")); OTV0P2BASE::serialPrintAndFlush(OTV0P2BASE::MemoryChecks::getMinSPSpaceBelowStackToEnd()); OTV0P2BASE::serialPrintlnAndFlush();
+  Serial.println();
+  // Show stack headroom.
+  OTV0P2BASE::serialPrintAndFlush(F("SH ")); OTV0P2BASE::serialPrintAndFlush(OTV0P2BASE::MemoryChecks::getMinSPSpaceBelowStackToEnd()); OTV0P2BASE::serialPrintlnAndFlush();
+#if defined(ENABLE_STACK_TAGS)
+  // Show stack headroom by code path.
+  printStackTags();
+#endif
+#if defined(ENABLE_LINK_STATS)
+  // Show radio link health counters.
+  printLinkStats();
+#endif
+#if defined(ENABLE_CHANNEL_UTILISATION)
+  // Show channel airtime use.
+  printChanUtil();
+#endif
+#if defined(ENABLE_TX_DUTY_CYCLE)
+  // Show own TX airtime over the last hour against the duty-cycle budget.
+  printTXDuty();
+#endif
 #if defined(ENABLE_STATS_TX)
-        // Default light-weight print and TX of stats.
-        bareStatsTX();
+  // Default light-weight print and TX of stats.
+  bareStatsTX();
 #endif
-        break; // Note that status is by default printed after processing input line.
-        }
+  return(true);
+  }
 
 #if !defined(ENABLE_TRIMMED_MEMORY)
-      // Version information printed as one line to serial, machine- and human- parseable.
-      case 'V':
-        {
-        V0p2Base_serialPrintlnBuildVersion();
+// Version information printed as one line to serial, machine- and human- parseable.
+static bool cliVersion(char *, uint8_t, const CLIArgs_t &)
+  {
+  V0p2Base_serialPrintlnBuildVersion();
 #if defined(DEBUG) && defined(ENABLE_EXTENDED_CLI) // && !defined(ENABLE_TRIMMED_MEMORY)
-        // Allow for much longer input commands for extended CLI.
-        Serial.print(F("Ext CLI max chars: ")); Serial.println(MAXIMUM_CLI_RESPONSE_CHARS);
+  // Allow for much longer input commands for extended CLI.
+  Serial.print(F("Ext CLI max chars: ")); Serial.println(MAXIMUM_CLI_RESPONSE_CHARS);
 #endif
-        break;
-        }
+  return(true);
+  }
 #endif // !defined(ENABLE_TRIMMED_MEMORY)
 
 #ifdef ENABLE_EXTENDED_CLI
-      // Handle CLI extension commands.
-      // Command of form:
-      //   +EXT .....
-      // where EXT is the name of the extension, usually 3 letters.
-      //
-      // It is acceptable for extCLIHandler() to alter the buffer passed,
-      // eg with strtok_t().
-      case '+':
-        {
-        const bool success = extCLIHandler(&Serial, buf, n);
-        Serial.println(success ? F("OK") : F("FAILED"));
-        break;
-        }
+// Handle CLI extension commands.
+// Command of form:
+//   +EXT .....
+// where EXT is the name of the extension, usually 3 letters.
+//
+// It is acceptable for extCLIHandler() to alter the buffer passed,
+// eg with strtok_t().
+static bool cliExtended(char *buf, uint8_t n, const CLIArgs_t &)
+  {
+  const bool success = extCLIHandler(&Serial, buf, n);
+  Serial.println(success ? F("OK") : F("FAILED"));
+  return(true);
+  }
 #endif 
 
 #ifdef ENABLE_FULL_OT_CLI // *******  NON-CORE CLI FEATURES
 
 #if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) && (defined(ENABLE_BOILER_HUB) || defined(ENABLE_STATS_RX)) && defined(ENABLE_RADIO_RX)
-      // Set new node association (nodes to accept frames from).
-      // Only needed if able to RX and/or some sort of hub.
-      case 'A': { showStatus = OTV0P2BASE::CLI::SetNodeAssoc().doCommand(buf, n); break; }
+#if defined(ENABLE_TX_COUNTER_RESERVATION)
+// A and B write association set 0, which holds the reserved TX counter block.
+#error ENABLE_TX_COUNTER_RESERVATION cannot be used with the A and B association commands
+#endif
+// Set new node association (nodes to accept frames from).
+// Only needed if able to RX and/or some sort of hub.
+static bool cliNodeAssoc(char *buf, uint8_t n, const CLIArgs_t &) { return(OTV0P2BASE::CLI::SetNodeAssoc().doCommand(buf, n)); }
+#if defined(ENABLE_BULK_NODE_ASSOC)
+// B S ID1 [ID2 ...] CC
+// Bulk-load associations: write the given 16-hex-digit node IDs into slots S, S+1, ...
+// CC is the hex CRC-7 (crc7Update() from 0x7f) over S and the ID bytes; the whole line is rejected on mismatch.
+// S may be at most the current count so that the table stays contiguous.
+// B N
+// Truncate the table to N associations, eg after loading all of them.
+// An ID already in its slot is not rewritten (nor its RX counters reset),
+// and new IDs are written only where bytes differ, so reloading the same list costs nearly no EEPROM wear.
+// Replies with a one-line summary rather than the status report.
+static constexpr uint8_t BULK_ASSOC_ID_CHARS = 2 * OTV0P2BASE::OpenTRV_Node_ID_Bytes;
+static constexpr uint8_t BULK_ASSOC_MAX_PER_LINE = (MAXIMUM_CLI_RESPONSE_CHARS - 7) / (BULK_ASSOC_ID_CHARS + 1);
+static bool cliBulkNodeAssoc(char *buf, uint8_t, const CLIArgs_t &a)
+  {
+  const uint8_t count = OTV0P2BASE::countNodeAssociations();
+  if((0 == a.count) || (a.v[0] < 0) || (a.v[0] > count)) { OTV0P2BASE::CLI::InvalidIgnored(); return(false); }
+  const uint8_t start = (uint8_t) a.v[0];
+  // Collect the IDs after the start index; a final 2-digit token is the check byte.
+  uint8_t ids[BULK_ASSOC_MAX_PER_LINE][OTV0P2BASE::OpenTRV_Node_ID_Bytes];
+  uint8_t nIDs = 0;
+  int check = -1;
+  char *last;
+  strtok_r(buf + 2, " ", &last);
+  for(char *tok; NULL != (tok = strtok_r(NULL, " ", &last)); )
+    {
+    if(-1 != check) { OTV0P2BASE::CLI::InvalidIgnored(); return(false); } // Nothing may follow the check byte.
+    const uint8_t len = strlen(tok);
+    if(2 == len)
+      {
+      check = OTV0P2BASE::parseHexByte(tok);
+      if(-1 == check) { OTV0P2BASE::CLI::InvalidIgnored(); return(false); }
+      continue;
+      }
+    if((BULK_ASSOC_ID_CHARS != len) || (nIDs >= BULK_ASSOC_MAX_PER_LINE)) { OTV0P2BASE::CLI::InvalidIgnored(); return(false); }
+    for(uint8_t i = 0; i < OTV0P2BASE::OpenTRV_Node_ID_Bytes; ++i)
+      {
+      const int b = OTV0P2BASE::parseHexByte(tok + 2*i);
+      if((-1 == b) || ((0 == i) && (0xff == b))) { OTV0P2BASE::CLI::InvalidIgnored(); return(false); } // 0xff would mark an empty slot.
+      ids[nIDs][i] = (uint8_t) b;
+      }
+    ++nIDs;
+    }
+  if(-1 == check)
+    {
+    if(0 != nIDs) { OTV0P2BASE::CLI::InvalidIgnored(); return(false); } // IDs need a check byte.
+    // Truncate: the first 0xff ID byte ends the table.
+    if(start < V0P2BASE_EE_NODE_ASSOCIATIONS_MAX_SETS)
+      { eeEraseByte(EEW_CONFIG, (uint8_t *)(V0P2BASE_EE_START_NODE_ASSOCIATIONS + start*(uint16_t)V0P2BASE_EE_NODE_ASSOCIATIONS_SET_SIZE)); }
+    Serial.print(F("Assoc count ")); Serial.println(OTV0P2BASE::countNodeAssociations());
+    return(false);
+    }
+  uint8_t crc = crc7Update(0x7f, start);
+  for(uint8_t j = 0; j < nIDs; ++j) { for(uint8_t i = 0; i < OTV0P2BASE::OpenTRV_Node_ID_Bytes; ++i) { crc = crc7Update(crc, ids[j][i]); } }
+  if((crc != check) || (start + nIDs > V0P2BASE_EE_NODE_ASSOCIATIONS_MAX_SETS)) { OTV0P2BASE::CLI::InvalidIgnored(); return(false); }
+  // Single pass over the target slots.
+  // Written directly rather than queued since the library count and lookups below read the EEPROM.
+  uint8_t same = 0;
+  for(uint8_t j = 0; j < nIDs; ++j)
+    {
+    uint8_t *p = (uint8_t *)(V0P2BASE_EE_START_NODE_ASSOCIATIONS + (start + j)*(uint16_t)V0P2BASE_EE_NODE_ASSOCIATIONS_SET_SIZE);
+    uint8_t current[OTV0P2BASE::OpenTRV_Node_ID_Bytes];
+    eeprom_read_block(current, p, OTV0P2BASE::OpenTRV_Node_ID_Bytes);
+    if(0 == memcmp(current, ids[j], OTV0P2BASE::OpenTRV_Node_ID_Bytes)) { ++same; continue; }
+    // As addNodeAssociation(): a new ID starts with erased counters.
+    for(uint8_t i = 0; i < V0P2BASE_EE_NODE_ASSOCIATIONS_SET_SIZE; ++i, ++p)
+      {
+      if(i < V0P2BASE_EE_NODE_ASSOCIATIONS_8B_ID_LENGTH) { eeUpdateByte(EEW_CONFIG, p, ids[j][i]); }
+      else { eeEraseByte(EEW_CONFIG, p); }
+      }
+    }
+  Serial.print(F("Assoc ")); Serial.print(start); Serial.print('+'); Serial.print(nIDs);
+  Serial.print(F(" same ")); Serial.print(same);
+  Serial.print(F(" count ")); Serial.println(OTV0P2BASE::countNodeAssociations());
+  return(false);
+  }
+#endif // ENABLE_BULK_NODE_ASSOC
 #endif // ENABLE_OTSECUREFRAME_ENCODING_SUPPORT
 
 #if defined(ENABLE_RADIO_RX) && (defined(ENABLE_BOILER_HUB) || defined(ENABLE_STATS_RX)) && !defined(ENABLE_DEFAULT_ALWAYS_RX)
-      // C M
-      // Set central-hub boiler minimum on (and off) time; 0 to disable.
-      case 'C':
-        {
-        char *last; // Used by strtok_r().
-        char *tok1;
-        // Minimum 3 character sequence makes sense and is safe to tokenise, eg "C 0".
-        if((n >= 3) && (NULL != (tok1 = strtok_r(buf+2, " ", &last))))
-          {
-          const uint8_t m = (uint8_t) atoi(tok1);
-          setMinBoilerOnMinutes(m);
-          }
-        break;
-        }
+// C M
+// Set central-hub boiler minimum on (and off) time; 0 to disable.
+static bool cliCentralHub(char *, uint8_t, const CLIArgs_t &a)
+  {
+  if(a.count >= 1) { setMinBoilerOnMinutes((uint8_t) a.v[0]); }
+  return(true);
+  }
 #endif
 
-//      // Raw stats: R N
-//      // Avoid showing status afterwards as may already be rather a lot of output.
-//      case 'R':
-//        {
-//        char *last; // Used by strtok_r().
-//        char *tok1;
-//        // Minimum 3 character sequence makes sense and is safe to tokenise, eg "R 0".
-//        if((n >= 3) && (NULL != (tok1 = strtok_r(buf+2, " ", &last))))
-//          {
-//          const uint8_t setN = (uint8_t) atoi(tok1);
-//          for(uint8_t hh = 0; hh < 24; ++hh)
-//            { Serial.print(getByHourStat(setN, hh)); OTV0P2BASE::Serial_print_space(); }
-//          Serial.println();
-//          }
-//        break;
-//        }
-
 #if !defined(ENABLE_TRIMMED_MEMORY)
-      // Dump (human-friendly) stats: D N
-      case 'D': { showStatus = OTV0P2BASE::CLI::DumpStats().doCommand(buf, n); break; }
+// Dump (human-friendly) stats: D N
+#if defined(ENABLE_PACKED_NV_STATS)
+// The library dump reads EEPROM bytes directly, so the packed sets are decoded here.
+static bool cliDumpStats(char *buf, uint8_t n, const CLIArgs_t &a)
+  {
+  if((a.count < 1) || (a.v[0] < OTV0P2BASE::NVByHourByteStatsBase::STATS_SET_OCCPC_BY_HOUR) || (a.v[0] > OTV0P2BASE::NVByHourByteStatsBase::STATS_SET_RHPC_BY_HOUR_SMOOTHED))
+    { return(OTV0P2BASE::CLI::DumpStats().doCommand(buf, n)); }
+  const uint8_t setN = (uint8_t)a.v[0];
+  const uint8_t thisHH = OTV0P2BASE::getHoursLT();
+  Serial.print(setN);
+  for(uint8_t hh = 0; hh < 24; ++hh)
+    {
+    Serial.print(' ');
+    const uint8_t v = eeStats.getByHourStatRaw(setN, hh);
+    if(OTV0P2BASE::STATS_UNSET_BYTE == v) { Serial.print('-'); } else { Serial.print(v); }
+    if(hh == thisHH) { Serial.print('<'); }
+    }
+  Serial.println();
+  return(false);
+  }
+#else
+static bool cliDumpStats(char *buf, uint8_t n, const CLIArgs_t &) { return(OTV0P2BASE::CLI::DumpStats().doCommand(buf, n)); }
+#endif // ENABLE_PACKED_NV_STATS
 #endif
 
 #if defined(ENABLE_LOCAL_TRV)
-      // Switch to FROST mode OR set FROST/setback temperature (even with temp pot available).
-      // With F! force to frost and holiday (long-vacant) mode.  Useful for testing and for remote CLI use.
-      case 'F':
-        {
+// Switch to FROST mode OR set FROST/setback temperature (even with temp pot available).
+// With F! force to frost and holiday (long-vacant) mode.  Useful for testing and for remote CLI use.
+static bool cliFrost(char *buf, uint8_t n, const CLIArgs_t &a)
+  {
 #if defined(ENABLE_OCCUPANCY_SUPPORT) && !defined(ENABLE_TRIMMED_MEMORY)
-        if((n == 2) && ('!' == buf[1]))
-          {
-          Serial.println(F("hols"));
-          Occupancy.setHolidayMode();
-          }
+  if((n == 2) && ('!' == buf[1]))
+    {
+    Serial.println(F("hols"));
+    Occupancy.setHolidayMode();
+    }
+#else
+  (void) buf; (void) n;
 #endif
 #if defined(ENABLE_SETTABLE_TARGET_TEMPERATURES) && !defined(TEMP_POT_AVAILABLE)
-        char *last; // Used by strtok_r().
-        char *tok1;
-        if((n >= 3) && (NULL != (tok1 = strtok_r(buf+2, " ", &last))))
-          {
-          const uint8_t tempC = (uint8_t) atoi(tok1);
-          if(!tempControl.setFROSTTargetC(tempC)) { OTV0P2BASE::CLI::InvalidIgnored(); }
-          }
-        else
-#endif
-          { valveMode.setWarmModeDebounced(false); } // No parameter supplied; switch to FROST mode.
-        break;
-        }
+  if(a.count >= 1)
+    {
+    if(!tempControl.setFROSTTargetC((uint8_t) a.v[0])) { OTV0P2BASE::CLI::InvalidIgnored(); }
+    }
+  else
+#else
+  (void) a;
+#endif
+    { valveMode.setWarmModeDebounced(false); } // No parameter supplied; switch to FROST mode.
+  return(true);
+  }
 #endif // defined(ENABLE_LOCAL_TRV)
  
 #if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
-      // Set secret key.
-      /**
-       * @note  The OTRadioLink::SimpleSecureFrame32or0BodyTXV0p2::resetRaw3BytePersistentTXRestartCounterCond
-       *        function pointer MUST be passed here to ensure safe handling of the key and the Tx message
-       *        counter.
-       */
-      case 'K': { showStatus = OTV0P2BASE::CLI::SetSecretKey(OTRadioLink::SimpleSecureFrame32or0BodyTXV0p2::resetRaw3BytePersistentTXRestartCounterCond).doCommand(buf, n); break; }
+// Set secret key.
+/**
+ * @note  The resetSecureTXRestartCounterCond (ie OTRadioLink::SimpleSecureFrame32or0BodyTXV0p2::resetRaw3BytePersistentTXRestartCounterCond)
+ *        function pointer MUST be passed here to ensure safe handling of the key and the Tx message
+ *        counter.
+ */
+static bool cliSecretKey(char *buf, uint8_t n, const CLIArgs_t &)
+  {
+#if defined(ENABLE_DUAL_RX_KEY)
+  // K P: stop accepting the previous key now, eg once every node has been re-keyed.
+  if((n >= 3) && ('P' == buf[2])) { wipePreviousBuildingKey(); return(false); }
+  retireBuildingKey();
+#endif
+  const bool showStatus = OTV0P2BASE::CLI::SetSecretKey(resetSecureTXRestartCounterCond).doCommand(buf, n);
+  wipeKeyCache();
+#if defined(ENABLE_DUAL_RX_KEY)
+  noteBuildingKeyChanged();
+#endif
+#if defined(ENABLE_RADIO_BUILDING_SYNC)
+  // Follow the new (or cleared) key at once, so a hub being commissioned hears its building straight away.
+  applyBuildingSyncWord();
+#endif
+  return(showStatus);
+  }
 #endif // ENABLE_OTSECUREFRAME_ENCODING_SUPPORT
 
-// FIXME
-//#ifdef ENABLE_LEARN_BUTTON
-//      // Learn current settings, just as if primary/specified LEARN button had been pressed.
-//      case 'L':
-//        {
-//        int s = 0;
-////#if MAX_SIMPLE_SCHEDULES > 1
-//        char *last; // Used by strtok_r().
-//        char *tok1;
-//        // Minimum 3 character sequence makes sense and is safe to tokenise, eg "L 0".
-//        if((n >= 3) && (NULL != (tok1 = strtok_r(buf+2, " ", &last))))
-//          {
-//          s = atoi(tok1);
-//          }
-////#endif
-//        valveUI.handleLEARN((uint8_t) s); break;
-//        break;
-//        }
-//#endif // ENABLE_LEARN_BUTTON
-
 #if defined(ENABLE_NOMINAL_RAD_VALVE) && !defined(ENABLE_TRIMMED_MEMORY)
-      // Set/clear min-valve-open-% threshold override.
-      case 'O':
-        {
-        uint8_t minPcOpen = 0; // Will clear override and use default threshold.
-        char *last; // Used by strtok_r().
-        char *tok1;
-        if((n > 1) && (NULL != (tok1 = strtok_r(buf+2, " ", &last))))
-          { minPcOpen = (uint8_t) atoi(tok1); }
-        NominalRadValve.setMinValvePcReallyOpen(minPcOpen);
-        break;
-        }
+// Set/clear min-valve-open-% threshold override.
+// With no value will clear override and use default threshold.
+static bool cliMinOpen(char *, uint8_t, const CLIArgs_t &a)
+  {
+  NominalRadValve.setMinValvePcReallyOpen((a.count >= 1) ? (uint8_t) a.v[0] : 0);
+  return(true);
+  }
 #endif
 
 #ifdef ENABLE_LEARN_BUTTON
-      // Program simple schedule HH MM [N].
-      case 'P':
-        {
-        char *last; // Used by strtok_r().
-        char *tok1;
-        // Minimum 5 character sequence makes sense and is safe to tokenise, eg "P 1 2".
-        if((n >= 5) && (NULL != (tok1 = strtok_r(buf+2, " ", &last))))
-          {
-          char *tok2 = strtok_r(NULL, " ", &last);
-          if(NULL != tok2)
-            {
-            const int hh = atoi(tok1);
-            const int mm = atoi(tok2);
-            int s = 0;
-//#if MAX_SIMPLE_SCHEDULES > 1         
-            char *tok3 = strtok_r(NULL, " ", &last);
-            if(NULL != tok3)
-              {
-              s = atoi(tok3);
-              }
-//#endif
-            // Does not fully validate user inputs (eg for -ve values), but cannot set impossible values.
-            if(!Scheduler.setSimpleSchedule((uint_least16_t) ((60 * hh) + mm), (uint8_t)s)) { OTV0P2BASE::CLI::InvalidIgnored(); }
-            }
-          }
-        break;
-        }
+// Program simple schedule HH MM [N].
+static bool cliProgram(char *, uint8_t n, const CLIArgs_t &a)
+  {
+  // Minimum 5 character sequence makes sense, eg "P 1 2".
+  if((n >= 5) && (a.count >= 2))
+    {
+    const int s = (a.count >= 3) ? a.v[2] : 0;
+    // Does not fully validate user inputs (eg for -ve values), but cannot set impossible values.
+    if(!Scheduler.setSimpleSchedule((uint_least16_t) ((60 * a.v[0]) + a.v[1]), (uint8_t)s)) { OTV0P2BASE::CLI::InvalidIgnored(); }
+    invalidateScheduleCache();
+    }
+  return(true);
+  }
 #endif // ENABLE_LEARN_BUTTON
 
 #if defined(ENABLE_LOCAL_TRV) && !defined(ENABLE_TRIMMED_MEMORY)
-      // Switch to (or restart) BAKE (Quick Heat) mode: Q
-      // We can live without this if very short of memory.
-      case 'Q': { valveMode.startBake(); break; }
+// Switch to (or restart) BAKE (Quick Heat) mode: Q
+// We can live without this if very short of memory.
+static bool cliQuickHeat(char *, uint8_t, const CLIArgs_t &) { valveMode.startBake(); return(true); }
 #endif
 
 #if !defined(ENABLE_TRIMMED_MEMORY)
-      // Time set T HH MM.
-      case 'T': { showStatus = OTV0P2BASE::CLI::SetTime().doCommand(buf, n); break; }
+// Time set T HH MM.
+static bool cliSetTime(char *buf, uint8_t n, const CLIArgs_t &)
+  {
+  const bool showStatus = OTV0P2BASE::CLI::SetTime().doCommand(buf, n);
+  invalidateScheduleCache();
+  return(showStatus);
+  }
 #endif // !defined(ENABLE_TRIMMED_MEMORY)
 
 #if defined(ENABLE_LOCAL_TRV)
-      // Switch to WARM (not BAKE) mode OR set WARM temperature.
-      case 'W':
-        {
+// Switch to WARM (not BAKE) mode OR set WARM temperature.
+static bool cliWarm(char *, uint8_t, const CLIArgs_t &a)
+  {
 #if defined(ENABLE_SETTABLE_TARGET_TEMPERATURES) && !defined(TEMP_POT_AVAILABLE)
-        char *last; // Used by strtok_r().
-        char *tok1;
-        if((n >= 3) && (NULL != (tok1 = strtok_r(buf+2, " ", &last))))
-          {
-          const uint8_t tempC = (uint8_t) atoi(tok1);
-          if(!tempControl.setWARMTargetC(tempC)) { OTV0P2BASE::CLI::InvalidIgnored(); }
-          }
-        else
-#endif
-          {
-          valveMode.cancelBakeDebounced(); // Ensure BAKE mode not entered.
-          valveMode.setWarmModeDebounced(true); // No parameter supplied; switch to WARM mode.
-          }
-        break;
-        }
+  if(a.count >= 1)
+    {
+    if(!tempControl.setWARMTargetC((uint8_t) a.v[0])) { OTV0P2BASE::CLI::InvalidIgnored(); }
+    }
+  else
+#else
+  (void) a;
+#endif
+    {
+    valveMode.cancelBakeDebounced(); // Ensure BAKE mode not entered.
+    valveMode.setWarmModeDebounced(true); // No parameter supplied; switch to WARM mode.
+    }
+  return(true);
+  }
 #endif // defined(ENABLE_LOCAL_TRV)
 
 #if !defined(ENABLE_ALWAYS_TX_ALL_STATS)
-      // TX security/privacy level: X NN
-      // Avoid showing status afterwards as may already be rather a lot of output.
-      case 'X': { showStatus = OTV0P2BASE::CLI::SetTXPrivacy().doCommand(buf, n); break; }
+// TX security/privacy level: X NN
+// Avoid showing status afterwards as may already be rather a lot of output.
+static bool cliTXPrivacy(char *buf, uint8_t n, const CLIArgs_t &) { return(OTV0P2BASE::CLI::SetTXPrivacy().doCommand(buf, n)); }
 #endif
 
 #if defined(ENABLE_LOCAL_TRV)
-      // Zap/erase learned statistics.
-      case 'Z': { showStatus = OTV0P2BASE::CLI::ZapStats().doCommand(buf, n); break; }
+// Zap/erase learned statistics.
+static bool cliZapStats(char *buf, uint8_t n, const CLIArgs_t &) { return(OTV0P2BASE::CLI::ZapStats().doCommand(buf, n)); }
 #endif // defined(ENABLE_LOCAL_TRV)
 
 #endif // ENABLE_FULL_OT_CLI // NON-CORE FEATURES
+
+// CLI command table, by first character of the line; unlisted characters (and '?') show help.
+// New commands need only a handler and an entry here (and a line in cliHelpText).
+struct CLICommand_t
+  {
+  char letter;
+  CLIHandler_t handler;
+  };
+static const CLICommand_t cliCommands[] PROGMEM =
+  {
+  { 'E', cliExit },
+#if defined(ENABLE_FHT8VSIMPLE) && (defined(ENABLE_LOCAL_TRV) || defined(ENABLE_SLAVE_TRV))
+  { 'H', cliHouseCode },
+#endif
+#if defined(ENABLE_GENERIC_PARAM_CLI_ACCESS)
+  { 'G', cliGenericParam },
+#endif
+  { 'I', cliID },
+  { 'S', cliStatus },
+#if !defined(ENABLE_TRIMMED_MEMORY)
+  { 'V', cliVersion },
+#endif
+#ifdef ENABLE_EXTENDED_CLI
+  { '+', cliExtended },
+#endif
+#ifdef ENABLE_FULL_OT_CLI
+#if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) && (defined(ENABLE_BOILER_HUB) || defined(ENABLE_STATS_RX)) && defined(ENABLE_RADIO_RX)
+  { 'A', cliNodeAssoc },
+#if defined(ENABLE_BULK_NODE_ASSOC)
+  { 'B', cliBulkNodeAssoc },
+#endif
+#endif
+#if defined(ENABLE_RADIO_RX) && (defined(ENABLE_BOILER_HUB) || defined(ENABLE_STATS_RX)) && !defined(ENABLE_DEFAULT_ALWAYS_RX)
+  { 'C', cliCentralHub },
+#endif
+#if !defined(ENABLE_TRIMMED_MEMORY)
+  { 'D', cliDumpStats },
+#endif
+#if defined(ENABLE_LOCAL_TRV)
+  { 'F', cliFrost },
+#endif
+#if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
+  { 'K', cliSecretKey },
+#endif
+#if defined(ENABLE_NOMINAL_RAD_VALVE) && !defined(ENABLE_TRIMMED_MEMORY)
+  { 'O', cliMinOpen },
+#endif
+#ifdef ENABLE_LEARN_BUTTON
+  { 'P', cliProgram },
+#endif
+#if defined(ENABLE_LOCAL_TRV) && !defined(ENABLE_TRIMMED_MEMORY)
+  { 'Q', cliQuickHeat },
+#endif
+#if !defined(ENABLE_TRIMMED_MEMORY)
+  { 'T', cliSetTime },
+#endif
+#if defined(ENABLE_LOCAL_TRV)
+  { 'W', cliWarm },
+#endif
+#if !defined(ENABLE_ALWAYS_TX_ALL_STATS)
+  { 'X', cliTXPrivacy },
+#endif
+#if defined(ENABLE_LOCAL_TRV)
+  { 'Z', cliZapStats },
+#endif
+#endif // ENABLE_FULL_OT_CLI
+  };
+
+// Find the handler for the given command letter, else the help handler.
+static CLIHandler_t findCLIHandler(const char letter)
+  {
+  for(uint8_t i = 0; i < sizeof(cliCommands)/sizeof(cliCommands[0]); ++i)
+    {
+    if(letter == (char) pgm_read_byte(&cliCommands[i].letter))
+      { return((CLIHandler_t) pgm_read_word(&cliCommands[i].handler)); }
+    }
+  return(cliHelp);
+  }
+
+//#if defined(ENABLE_EXTENDED_CLI) || defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
+//static const uint8_t MAXIMUM_CLI_RESPONSE_CHARS = 1 + OTV0P2BASE::CLI::MAX_TYPICAL_CLI_BUFFER;
+//#else
+//static const uint8_t MAXIMUM_CLI_RESPONSE_CHARS = 1 + OTV0P2BASE::CLI::MIN_TYPICAL_CLI_BUFFER;
+//#endif
+#if defined(ENABLE_CLI_IDLE_READ)
+// Prompt and read a command line like OTV0P2BASE::CLI::promptAndReadCommandLine(), but idle between characters.
+// The core HardwareSerial RX interrupt owns USART_RX_vect and queues incoming characters,
+// and wakes the CPU from idle sleep, so nothing is lost while the CPU is stopped;
+// the line is only handed on at CR/LF or when the buffer is full.
+// I/O is still polled on each wakeup (RX char, timer or watchdog backstop) to service the radio.
+// Returns number of characters read (not including terminating CR or LF); 0 on timeout or failure.
+static uint8_t idleReadCommandLine(const uint8_t maxSCT, const OTV0P2BASE::ScratchSpace &s)
+  {
+  char *const buf = (char *)s.buf;
+  const uint8_t bufsize = s.bufsize;
+  if((NULL == buf) || (bufsize < 2)) { return(0); }
+  // Keep the same margin as the library reader so as not to overrun the slot.
+  const uint8_t targetMaxSCT = (maxSCT <= OTV0P2BASE::CLI::MIN_CLI_POLL_SCT) ? ((uint8_t) 0) : ((uint8_t) (maxSCT - 1 - OTV0P2BASE::CLI::MIN_CLI_POLL_SCT));
+  if(OTV0P2BASE::getSubCycleTime() >= targetMaxSCT) { return(0); }
+  // Purge stray input (eg trailing LF) then prompt, as the library does.
+  while(Serial.available() > 0) { Serial.read(); }
+  Serial.println();
+  Serial.print((char) OTV0P2BASE::SERLINE_START_CHAR_CLI);
+  OTV0P2BASE::flushSerialSCTSensitive();
+  uint8_t n = 0;
+  while(n < bufsize - 1)
+    {
+    if(Serial.available() > 0)
+      {
+      int ic = Serial.read();
+      if(('\r' == ic) || ('\n' == ic)) { break; }
+      if((ic < 32) || (ic > 126)) { continue; } // Drop non-printable characters.
+      // Leading (command) char must be a letter, '?' or '+', forced to upper case.
+      if(0 == n)
+        {
+        ic = toupper(ic);
+        if(('+' != ic) && ('?' != ic) && ((ic < 'A') || (ic > 'Z'))) { continue; }
+        }
+      buf[n++] = (char) ic;
+      Serial.print((char) ic); // Echo.
+      continue;
+      }
+    // Abandon any partial line at the time limit.
+    const uint8_t sct = OTV0P2BASE::getSubCycleTime();
+    if(sct >= maxSCT) { n = 0; break; }
+    // Nothing queued: let any echo drain then stop the CPU until the next interrupt,
+    // unless too close to the deadline to risk a full watchdog backstop period.
+    if(sct < targetMaxSCT) { OTV0P2BASE::_idleCPU(WDTO_15MS, true); }
+    pollIO();
+    }
+  if(n > 0)
+    {
+    buf[n] = '\0';
+    Serial.println(); // ACK user's end-of-line.
+    }
+  return(n);
+  }
+#endif // ENABLE_CLI_IDLE_READ
+
+// Process one command line, with action based on the first char.
+// Returns true to show status afterwards, as from the handler.
+static bool runCLICommand(char *const buf, const uint8_t n, const uint8_t maxSCT)
+  {
+  CLIArgs_t args;
+  args.maxSCT = maxSCT;
+  parseCLIArgs(buf, n, args);
+  // Handlers mostly return true, to show status.
+  const bool showStatus = findCLIHandler(buf[0])(buf, n, args);
+
+  // Any command may have changed settings in EEPROM directly, so refresh the RAM copy.
+  loadSettingsCache();
+  // Likewise node associations.
+  rebuildRXAssocIndex();
+  // Likewise stats aggregates, eg after a zap.
+  invalidateByHourStatsAggregates();
+  return(showStatus);
+  }
+
+// Used to poll user side for CLI input until specified sub-cycle time.
+// Commands should be sent terminated by CR *or* LF; both may prevent 'E' (exit) from working properly.
+// A period of less than (say) 500ms will be difficult for direct human response on a raw terminal.
+// A period of less than (say) 100ms is not recommended to avoid possibility of overrun on long interactions.
+// Times itself out after at least a minute or two of inactivity. 
+// NOT RENTRANT (eg uses static state for speed and code space).
+void pollCLI(const uint8_t maxSCT, const bool startOfMinute, const OTV0P2BASE::ScratchSpace &s)
+  {
+#if defined(ENABLE_SLOT_PROFILER)
+  const uint8_t sctStart = OTV0P2BASE::getSubCycleTime();
+#endif
+
+  // Perform any once-per-minute operations.
+  if(startOfMinute)
+    { OTV0P2BASE::CLI::countDownCLI(); }
+
+  const PeripheralPower<PP_SERIAL> serialPower;
+
+  // Wait for input command line from the user (received characters may already have been queued)...
+  // Read a line up to a terminating CR, either on its own or as part of CRLF.
+  // (Note that command content and timing may be useful to fold into PRNG entropy pool.)
+  // A static buffer generates better code but permanently consumes previous SRAM.
+  // Continue any help output cut short in an earlier minor cycle instead of prompting again.
+#if defined(_CLI_HELP_)
+  const bool resumeHelp = (0 != cliHelpResume);
+#else
+  constexpr bool resumeHelp = false;
+#endif
+  // Likewise continue any bulk export in progress (unless run as a cooperative task).
+#if defined(ENABLE_BULK_STATS_EXPORT) && !defined(ENABLE_COOP_TASKS)
+  const bool resumeExport = (0 != exportResume);
+#else
+  constexpr bool resumeExport = false;
+#endif
+  const uint8_t n = (resumeHelp || resumeExport) ? 0 :
+#if defined(ENABLE_CLI_IDLE_READ)
+    idleReadCommandLine(maxSCT, s);
+#else
+    OTV0P2BASE::CLI::promptAndReadCommandLine(maxSCT, s, [](){pollIO();});
+#endif
+  char *buf = (char *)s.buf;
+//  const uint8_t bufsize = s.bufsize;
+
+  if(n > 0)
+    {
+    // Got plausible input so keep the CLI awake a little longer.
+    OTV0P2BASE::CLI::resetCLIActiveTimer();
+    stackTag(STACK_TAG_CLI);
+
+#if defined(ENABLE_CLI_BATCH)
+    // Run each ';'-separated command in turn, eg "T 12 34;P 3;H 1;S" for scripted commissioning.
+    // Commands not started by the deadline are dropped and counted in a "!BAT" line.
+    bool showStatus = false;
+    uint8_t dropped = 0;
+    for(char *cmd = buf; ; )
+      {
+      while(' ' == *cmd) { ++cmd; }
+      char *const end = strchr(cmd, ';');
+      if(NULL != end) { *end = '\0'; }
+      const uint8_t cn = (uint8_t) strlen(cmd);
+      if(0 != cn)
+        {
+        if(OTV0P2BASE::getSubCycleTime() >= (maxSCT - OTV0P2BASE::fnmin(maxSCT, CLI_EXT_PRINT_OH_SCT))) { ++dropped; }
+        // Only the first letter on the line has been forced to upper case by the reader.
+        else { cmd[0] = (char) toupper(cmd[0]); if(runCLICommand(cmd, cn, maxSCT)) { showStatus = true; } }
+        }
+      if(NULL == end) { break; }
+      cmd = end + 1;
       }
+    if(0 != dropped) { Serial.print(F("!BAT ")); Serial.println(dropped); }
+#else
+    const bool showStatus = runCLICommand(buf, n, maxSCT);
+#endif // ENABLE_CLI_BATCH
 
     // Almost always show status line afterwards as feedback of command received and new state.
+    // With ENABLE_CLI_BATCH this is once for the whole line, shown if any command asked for it.
     if(showStatus) { serialStatusReport(); }
     // Else show ack of command received.
     else { Serial.println(F("OK")); }
     }
+  else if(resumeHelp)
+    {
+    OTV0P2BASE::CLI::resetCLIActiveTimer();
+    dumpCLIUsage(maxSCT);
+    }
+#if defined(ENABLE_BULK_STATS_EXPORT) && !defined(ENABLE_COOP_TASKS)
+  else if(resumeExport)
+    {
+    OTV0P2BASE::CLI::resetCLIActiveTimer();
+    exportChunks(maxSCT - OTV0P2BASE::fnmin(maxSCT, CLI_EXT_PRINT_OH_SCT));
+    }
+#endif
   else { Serial.println(); } // Terminate empty/partial CLI input line after timeout.
 
   // Force any pending output before return / possible UART power-down.
   OTV0P2BASE::flushSerialSCTSensitive();
 
-  if(neededWaking) { OTV0P2BASE::powerDownSerial(); }
+#if defined(ENABLE_SLOT_PROFILER)
+  profileSlot(PROFILE_SLOT_CLI, sctStart);
+#endif
   }
@@ -38,12 +38,31 @@ Author(s) / Copyright (s): Damon Hart-Davis 2013--2017
 
 #include "V0p2_Main.h"
 
+#if defined(SHT21_SPLIT_CONVERSION)
+#include <Wire.h> // Arduino I2C library.
+#endif
+#if defined(DS18B20_ROM_CACHE)
+#include <util/crc16.h>
+#endif
+#if defined(ENABLE_RADIO_BUILDING_SYNC)
+#include <util/atomic.h>
+#endif
+
 // Indicate that the system is broken in an obvious way (distress flashing the main LED).
 // DOES NOT RETURN.
 // Tries to turn off most stuff safely that will benefit from doing so, but nothing too complex.
 // Tries not to use lots of energy so as to keep distress beacon running for a while.
 void panic()
   {
+  // Complete any deferred EEPROM writes while still safe to.
+  eeQueueFlush();
+#if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON)
+  // Don't leave secrets lying around in RAM.
+  wipeKeyCache();
+#endif
+#if defined(ENABLE_DUAL_RX_KEY)
+  wipePreviousBuildingKey();
+#endif
 #ifdef ENABLE_RADIO_PRIMARY_MODULE
   // Reset radio and go into low-power mode.
   PrimaryRadio.panicShutdown();
@@ -77,6 +96,44 @@ void panic(const __FlashStringHelper *s)
   panic();
   }
 
+#if defined(ENABLE_CPU_CLOCK_BOOST)
+CPUClockBoost::CPUClockBoost() : boosted(false)
+  {
+  // Only boost from the normal clock, and only with the supply known to be good enough.
+  if(((clock_div_t)OTV0P2BASE::DEFAULT_CPU_PRESCALE) != clock_prescale_get()) { return; }
+  if(Supply_cV.isSupplyVoltageLow() || (Supply_cV.get() < CPU_CLOCK_BOOST_MIN_cV)) { return; }
+  // The UART baud rate is derived from the CPU clock so let any pending output go first.
+  if(OTV0P2BASE::_serialIsPoweredUp()) { OTV0P2BASE::flushSerialSCTSensitive(); }
+  clock_prescale_set(clock_div_1);
+  boosted = true;
+  }
+
+CPUClockBoost::~CPUClockBoost()
+  { if(boosted) { clock_prescale_set((clock_div_t)OTV0P2BASE::DEFAULT_CPU_PRESCALE); } }
+#endif // ENABLE_CPU_CLOCK_BOOST
+
+#if defined(ENABLE_PERIPHERAL_POWER_REFS)
+// Outstanding holds per peripheral.
+static uint8_t peripheralHolds[PP_COUNT];
+// Bit per peripheral powered up by its first hold, and so to be powered down by its last release.
+static uint8_t peripheralsPoweredByHold;
+
+void peripheralHold(const peripheral_t p)
+  {
+  if(0 != peripheralHolds[p]++) { return; }
+  if(peripheralPowerUpIfDisabled(p)) { peripheralsPoweredByHold |= (uint8_t)(1U << p); }
+  }
+
+void peripheralRelease(const peripheral_t p)
+  {
+  if((0 == peripheralHolds[p]) || (0 != --peripheralHolds[p])) { return; }
+  const uint8_t bit = (uint8_t)(1U << p);
+  if(0 == (peripheralsPoweredByHold & bit)) { return; }
+  peripheralsPoweredByHold &= (uint8_t)~bit;
+  peripheralPowerDown(p);
+  }
+#endif // ENABLE_PERIPHERAL_POWER_REFS
+
 // Signal position in basic POST sequence as a small positive integer, or zero for done/none.
 // Simple count of position in ON flashes.
 // LED is assumed to be ON upon entry, and is left ON at exit.
@@ -86,10 +143,28 @@ void panic(const __FlashStringHelper *s)
 //   * Each of the 5 main sections of Power On Self Test is 1 second LED on, 0.5 second off, n short flashes separated by 0.25s off, then 0.5s off, then 1s on.
 //     The value of n is 1, 2, 3, 4, 5.
 //   * The LED should then go off except for optional faint flickers as the radio is being driven if set up to do so.
+#if defined(ENABLE_POST_ENTROPY) && defined(ENABLE_WAKEUP_32768HZ_XTAL)
+// Spend approximately the given POST delay (up to ~1s) gathering entropy, sleeping off any remainder.
+// Relies on the RTC xtal, which has been checked before the first POST delay.
+static void postDelayGatheringEntropy(const uint16_t ms)
+  {
+  const uint8_t ticks = (uint8_t)(ms / OTV0P2BASE::SUBCYCLE_TICK_MS_RD);
+  const uint8_t start = OTV0P2BASE::getSubCycleTime();
+  uint8_t elapsed;
+  // Each pass takes up to about two sub-cycle ticks, mainly waiting on RTC tick edges.
+  while((elapsed = (uint8_t)(OTV0P2BASE::getSubCycleTime() - start)) + 2 < ticks)
+    { OTV0P2BASE::addEntropyToPool(OTV0P2BASE::clockJitterRTC() ^ OTV0P2BASE::noisyADCRead(), 2); }
+  if(elapsed < ticks) { OTV0P2BASE::sleepLowPowerMs((ticks - elapsed) * OTV0P2BASE::SUBCYCLE_TICK_MS_RD); }
+  }
+#define POST_DELAY_MS(ms) postDelayGatheringEntropy(ms)
+#else
+#define POST_DELAY_MS(ms) OTV0P2BASE::sleepLowPowerMs(ms)
+#endif // ENABLE_POST_ENTROPY
+
 #define PP_OFF_MS 250
 static void posPOST(const uint8_t position, const __FlashStringHelper *s = NULL)
   {
-  OTV0P2BASE::sleepLowPowerMs(1000);
+  POST_DELAY_MS(1000);
 #if 0 && defined(DEBUG)
   DEBUG_SERIAL_PRINT_FLASHSTRING("posPOST: "); // Can only be used once serial is set up.
   DEBUG_SERIAL_PRINT(position);
@@ -108,19 +183,19 @@ static void posPOST(const uint8_t position, const __FlashStringHelper *s = NULL)
   // Skip much of lightshow if '0'/end/none position.
   if(position > 0)
     {
-    OTV0P2BASE::sleepLowPowerMs(2*PP_OFF_MS); // TODO: use this time to gather entropy.
+    POST_DELAY_MS(2*PP_OFF_MS);
     for(int i = position; --i >= 0; )
       {
       OTV0P2BASE::LED_HEATCALL_ON();
       OTV0P2BASE::nap(WDTO_15MS);
       OTV0P2BASE::LED_HEATCALL_OFF();
-      OTV0P2BASE::sleepLowPowerMs(PP_OFF_MS); // TODO: use this time to gather entropy.
+      POST_DELAY_MS(PP_OFF_MS);
       }
     }
 
-  OTV0P2BASE::sleepLowPowerMs(PP_OFF_MS); // TODO: use this time to gather entropy.
+  POST_DELAY_MS(PP_OFF_MS);
   OTV0P2BASE::LED_HEATCALL_ON();
-  OTV0P2BASE::sleepLowPowerMs(1000); // TODO: use this time to gather entropy.
+  POST_DELAY_MS(1000);
   }
 
 
@@ -129,14 +204,126 @@ static void posPOST(const uint8_t position, const __FlashStringHelper *s = NULL)
 // OTRadioChannelConfig(const void *_config, bool _isFull, bool _isRX, bool _isTX, bool _isAuth = false, bool _isEnc = false, bool _isUnframed = false)
 #if defined(ENABLE_FAST_FRAMED_CARRIER_SUPPORT)
 #define RADIO_CONFIG_NAME "GFSK"
+#if defined(ENABLE_RADIO_GFSK_HW_PACKET)
+// Extra byte sent as RFM23B transmit header 3 and required on receive; pick one per building.
+#ifndef RFM23B_GFSK_HEADER_CODE
+#define RFM23B_GFSK_HEADER_CODE 0x5a
+#endif
+// The full GFSK set is loaded once at start-up as base state (RFM23BBaseConfig),
+// then channel 0 turns on the packet handler's CRC-16 (IBM, over header and data) and one checked header byte.
+// The library already runs GFSK in variable-length packet mode and enables only the valid-packet interrupt,
+// so the MCU is then not woken for frames that fail the CRC or carry another header.
+// Over the air each frame gains 3 bytes (header and CRC), stripped by the radio on receive.
+static const OTRFM23BLink::OTRFM23BLinkBase::RFM23_Reg_Values_t GFSKHWPacketRegValues =
+  {
+  { 0x30, 0x8d }, // Data Access Control: packet RX & TX, CRC on, CRC-16 IBM.
+  { 0x32, 0x08 }, // Header Control 1: check header 3, no broadcast.
+  { 0x33, 0x12 }, // Header Control 2: 1 header byte (3), variable length, 2 sync bytes.
+  { 0x3a, RFM23B_GFSK_HEADER_CODE }, // Transmit Header 3.
+  { 0x3f, RFM23B_GFSK_HEADER_CODE }, // Check Header 3.
+  { 0x43, 0xff }, // Header Enable 3: all bits compared.
+#if defined(ENABLE_RADIO_MULTI_CHANNEL)
+  { 0x76, 0x6a }, { 0x77, 0x40 }, // Back to the 868.5MHz carrier from another channel.
+#endif
+  { 0xff, 0xff }
+  };
+static const OTRadioLink::OTRadioChannelConfig RFM23BBaseConfig(OTRFM23BLink::StandardRegSettingsGFSK57600, true);
+#endif // ENABLE_RADIO_GFSK_HW_PACKET
+#if defined(ENABLE_RADIO_MULTI_CHANNEL)
+static_assert((RADIO_MULTI_CHANNELS >= 2) && (RADIO_MULTI_CHANNELS <= 3), "RADIO_MULTI_CHANNELS must be 2 or 3");
+// Extra GFSK channels: partial configs applied over channel 0, moving only the nominal carrier (0x76/0x77).
+// With band select 0x73 (868MHz high band) fc = (f/20MHz - 43) * 64000; all stay in the 1% duty-cycle sub-band.
+// 868.3MHz.
+static const OTRFM23BLink::OTRFM23BLinkBase::RFM23_Reg_Values_t GFSKChannel1RegValues = { { 0x76, 0x67 }, { 0x77, 0xc0 }, { 0xff, 0xff } };
+// 868.1MHz.
+static const OTRFM23BLink::OTRFM23BLinkBase::RFM23_Reg_Values_t GFSKChannel2RegValues = { { 0x76, 0x65 }, { 0x77, 0x40 }, { 0xff, 0xff } };
+// Nodes talking on fast GFSK channel 0 (868.5MHz) or one of the extra channels.
+static constexpr uint8_t nPrimaryRadioChannels = RADIO_MULTI_CHANNELS;
+static const OTRadioLink::OTRadioChannelConfig RFM23BConfigs[nPrimaryRadioChannels] =
+  {
+#if defined(ENABLE_RADIO_GFSK_HW_PACKET)
+  // GFSK channel 0 packet handler (and carrier) over the base config, RX/TX, not in itself secure.
+  OTRadioLink::OTRadioChannelConfig(GFSKHWPacketRegValues, false),
+#else
+  // GFSK channel 0 full config, RX/TX, not in itself secure.
+  OTRadioLink::OTRadioChannelConfig(OTRFM23BLink::StandardRegSettingsGFSK57600, true),
+#endif
+  // GFSK channel 1 partial config, RX/TX, not in itself secure.
+  OTRadioLink::OTRadioChannelConfig(GFSKChannel1RegValues, false),
+#if RADIO_MULTI_CHANNELS > 2
+  // GFSK channel 2 partial config, RX/TX, not in itself secure.
+  OTRadioLink::OTRadioChannelConfig(GFSKChannel2RegValues, false),
+#endif
+  };
+int8_t primaryRadioChannel()
+  {
+  const uint8_t c = eeprom_read_byte((uint8_t *)V0P2_EE_START_RADIO_CHANNEL);
+  if(c < nPrimaryRadioChannels) { return((int8_t)c); }
+  if(V0P2_RADIO_CHANNEL_BY_ID == c) { return((int8_t)(eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_ID) % nPrimaryRadioChannels)); }
+  return(0);
+  }
+#else
 // Nodes talking on fast GFSK channel 0.
 static constexpr uint8_t nPrimaryRadioChannels = 1;
 static const OTRadioLink::OTRadioChannelConfig RFM23BConfigs[nPrimaryRadioChannels] =
   {
+#if defined(ENABLE_RADIO_GFSK_HW_PACKET)
+  // GFSK channel 0 packet handler over the base config, RX/TX, not in itself secure.
+  OTRadioLink::OTRadioChannelConfig(GFSKHWPacketRegValues, false),
+#else
   // GFSK channel 0 full config, RX/TX, not in itself secure.
   OTRadioLink::OTRadioChannelConfig(OTRFM23BLink::StandardRegSettingsGFSK57600, true),
+#endif
   };
+#endif // ENABLE_RADIO_MULTI_CHANNEL
 #else // !defined(ENABLE_FAST_FRAMED_CARRIER_SUPPORT)
+#if defined(ENABLE_RADIO_DUAL_CARRIER)
+#define RADIO_CONFIG_NAME "OOK+GFSK"
+// FHT8V commands on slow OOK, everything else on fast GFSK.
+// The OOK config is partial, so the full GFSK set is always loaded first as base state (RFM23BBaseConfig):
+// the OOK channel is then the same registers over the same base at start-up as after each switch back from GFSK.
+static constexpr uint8_t nPrimaryRadioChannels = 2;
+static const OTRadioLink::OTRadioChannelConfig RFM23BBaseConfig(OTRFM23BLink::StandardRegSettingsGFSK57600, true);
+#if defined(ENABLE_RADIO_CONFIG_DELTAS)
+// Hubs switch carrier every listen period, and each reload is 76 (GFSK) or 38 (OOK) single-register SPI writes.
+// So over the GFSK base state each switch writes only the 29 registers where FHT8V_RFM23_Reg_Values and StandardRegSettingsGFSK57600 differ,
+// in ascending address order; the two tables below must cover the same registers.
+// Derived from the OTRFM23BLink tables: regenerate if either changes.
+static const OTRFM23BLink::OTRFM23BLinkBase::RFM23_Reg_Values_t OOKOverGFSKRegValues =
+  {
+  { 0x1c, 0xc1 }, { 0x1d, 0x40 }, { 0x20, 0x96 }, { 0x21, 0 }, { 0x22, 0xda }, { 0x23, 0x74 }, { 0x24, 0 }, { 0x25, 0xdc },
+  { 0x2a, 0x24 }, { 0x2c, 0x28 }, { 0x2d, 0xfa }, { 0x2e, 0x29 },
+  { 0x30, 0 }, { 0x33, 6 }, { 0x34, 8 }, { 0x35, 0x10 }, { 0x36, 0xaa }, { 0x37, 0xcc }, { 0x38, 0xcc }, { 0x39, 0xcc },
+  { 0x6e, 40 }, { 0x6f, 245 }, { 0x70, 0x20 }, { 0x71, 0x21 }, { 0x72, 0x20 }, { 0x76, 100 }, { 0x77, 0 },
+  { 0x79, 35 }, { 0x7a, 1 },
+  { 0xff, 0xff }
+  };
+static const OTRFM23BLink::OTRFM23BLinkBase::RFM23_Reg_Values_t GFSKOverOOKRegValues =
+  {
+  { 0x1c, 6 }, { 0x1d, 0x44 }, { 0x20, 0x45 }, { 0x21, 1 }, { 0x22, 0xd7 }, { 0x23, 0xdc }, { 0x24, 0x07 }, { 0x25, 0x6e },
+  { 0x2a, 0x28 }, { 0x2c, 0x40 }, { 0x2d, 0x0a }, { 0x2e, 0x2d },
+  { 0x30, 0x88 }, { 0x33, 2 }, { 0x34, 0x0a }, { 0x35, 0x2a }, { 0x36, 0x2d }, { 0x37, 0xd4 }, { 0x38, 0 }, { 0x39, 0 },
+  { 0x6e, 0x0e }, { 0x6f, 0xbf }, { 0x70, 0x0c }, { 0x71, 0x23 }, { 0x72, 0x2e }, { 0x76, 0x6a }, { 0x77, 0x40 },
+  { 0x79, 0 }, { 0x7a, 0 },
+  { 0xff, 0xff }
+  };
+static const OTRadioLink::OTRadioChannelConfig RFM23BConfigs[nPrimaryRadioChannels] =
+  {
+  // FS20/FHT8V compatible channel 0 delta over GFSK; RX/TX, not secure, unframed.
+  OTRadioLink::OTRadioChannelConfig(OOKOverGFSKRegValues, false, true, true, false, false, true),
+  // GFSK channel 1 delta over OOK, RX/TX, not in itself secure.
+  OTRadioLink::OTRadioChannelConfig(GFSKOverOOKRegValues, false),
+  };
+#else
+static const OTRadioLink::OTRadioChannelConfig RFM23BConfigs[nPrimaryRadioChannels] =
+  {
+  // FS20/FHT8V compatible channel 0 partial/minimal register config; RX/TX, not secure, unframed.
+  OTRadioLink::OTRadioChannelConfig(OTRFM23BLink::FHT8V_RFM23_Reg_Values, false, true, true, false, false, true),
+  // GFSK channel 1 full config, RX/TX, not in itself secure.
+  OTRadioLink::OTRadioChannelConfig(OTRFM23BLink::StandardRegSettingsGFSK57600, true),
+  };
+#endif // ENABLE_RADIO_CONFIG_DELTAS
+#else
 #define RADIO_CONFIG_NAME "OOK"
 // Nodes talking (including to to FHT8V) on slow OOK.
 static constexpr uint8_t nPrimaryRadioChannels = 1;
@@ -145,6 +332,7 @@ static const OTRadioLink::OTRadioChannelConfig RFM23BConfigs[nPrimaryRadioChanne
   // FS20/FHT8V compatible channel 0 partial/minimal single-channel register config; RX/TX, not secure, unframed.
   OTRadioLink::OTRadioChannelConfig(OTRFM23BLink::FHT8V_RFM23_Reg_Values, false, true, true, false, false, true)
   };
+#endif // ENABLE_RADIO_DUAL_CARRIER
 #endif
 #endif // ENABLE_RADIO_PRIMARY_RFM23B
 
@@ -156,6 +344,26 @@ static const OTRadioLink::OTRadioChannelConfig SecondaryRadioConfig(NULL, true);
 #endif // ENABLE_RADIO_SECONDARY_SIM900
 
 
+#if defined(ENABLE_RX_ISR_ASSOC_FILTER) && defined(ENABLE_RADIO_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
+// Returns false for a secure frame whose claimed sender ID prefix cannot be an association,
+// so that traffic from neighbouring systems does not take RX queue slots or GCM attempts.
+// Anything else, including malformed headers, is left for the full decoder.
+static inline bool acceptSecureRXISR(const volatile uint8_t *const buf, const uint8_t buflen)
+  {
+  // Need type, seq/il and at least one ID byte.
+  if(buflen < 3) { return(true); }
+  const uint8_t fType = buf[0];
+  if(0 == (OTRadioLink::SECUREABLE_FRAME_TYPE_SEC_FLAG & fType)) { return(true); }
+#if defined(ENABLE_FS20_ENCODING_SUPPORT)
+  if(OTRadioLink::FTp2_FS20_native == fType) { return(true); }
+#endif
+  const uint8_t il = buf[1] & 0xf;
+  if((0 == il) || (buflen < 2 + il)) { return(true); }
+  return(rxAssocMayMatch(buf + 2, il));
+  }
+#define ENABLE_RX_ISR_ASSOC_FILTER_ACTIVE
+#endif // ENABLE_RX_ISR_ASSOC_FILTER
+
 #if defined(ENABLE_STATS_RX) && defined(ENABLE_FS20_ENCODING_SUPPORT)
 
 // If in stats or boiler hub mode, and with an FS20 OOK carrier, then apply a trailing-zeros RX filter.
@@ -173,6 +381,9 @@ static bool FilterRXISR(const volatile uint8_t *buf, volatile uint8_t &buflen)
   {
   const uint8_t initialBuflen = buflen;
   if(initialBuflen < 1) { return(true); } // Accept everything, even empty message with no type byte.
+#if defined(ENABLE_RX_ISR_ASSOC_FILTER_ACTIVE)
+  if(!acceptSecureRXISR(buf, initialBuflen)) { return(false); }
+#endif
   // Fall through for message types not handled specifically.
   switch(buf[0])
     {
@@ -202,6 +413,10 @@ static bool FilterRXISR(const volatile uint8_t *buf, volatile uint8_t &buflen)
   return(true); // Accept all messages.
   #endif
   }
+#elif defined(ENABLE_RX_ISR_ASSOC_FILTER_ACTIVE)
+// Only drop secure frames from strangers.
+static bool FilterRXISR(const volatile uint8_t *buf, volatile uint8_t &buflen)
+  { return(acceptSecureRXISR(buf, buflen)); }
 #elif defined(CONFIG_TRAILING_ZEROS_FILTER_RX)
 // Useful general heuristic to improve queueing, etc.
 #define FilterRXISR (OTRadioLink::frameFilterTrailingZeros)
@@ -211,14 +426,330 @@ static bool FilterRXISR(const volatile uint8_t *buf, volatile uint8_t &buflen)
 #define FilterRXISR NULL
 #endif
 
+#if defined(ENABLE_RX_PRIORITY_QUEUE) && defined(ENABLE_BOILER_HUB) && defined(ENABLE_RADIO_RX)
+// Apply any normal filtering then divert control frames to the priority queue.
+// Diverted frames show up in the radio's filtered-frame count.
+static bool FilterRXISRWithPriority(const volatile uint8_t *buf, volatile uint8_t &buflen)
+  {
+#if !defined(NO_RX_FILTER)
+  if(!FilterRXISR(buf, buflen)) { return(false); }
+#endif
+  return(!rxPriorityDivertISR(buf, buflen));
+  }
+#undef NO_RX_FILTER
+#define PrimaryRadioFilterRXISR FilterRXISRWithPriority
+#else
+#define PrimaryRadioFilterRXISR FilterRXISR
+#endif // ENABLE_RX_PRIORITY_QUEUE
+
+#if defined(ENABLE_RX_LINK_TABLE) && defined(ENABLE_RADIO_PRIMARY_RFM23B)
+// Apply any other filtering then note the RSSI of each frame that will be queued.
+static bool FilterRXISRWithRSSI(const volatile uint8_t *buf, volatile uint8_t &buflen)
+  {
+#if !defined(NO_RX_FILTER)
+  if(!PrimaryRadioFilterRXISR(buf, buflen)) { return(false); }
+#endif
+  rxNoteRSSIISR(buf);
+  return(true);
+  }
+#undef NO_RX_FILTER
+#undef PrimaryRadioFilterRXISR
+#define PrimaryRadioFilterRXISR FilterRXISRWithRSSI
+#endif // ENABLE_RX_LINK_TABLE
+
+#if defined(ENABLE_RADIO_BUILDING_SYNC)
+// Write the two sync word bytes (registers 0x36, 0x37) of the RFM23B selected by nSS in one SPI burst.
+// Not done through the library's register tables as those are fixed in flash.
+template <uint8_t nSS>
+static void rfm23bWriteSync(const uint8_t s3, const uint8_t s2)
+  {
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+    {
+    const bool neededEnable = OTV0P2BASE::t_powerUpSPIIfDisabled<nSS, OTV0P2BASE::DEFAULT_RUN_SPI_SLOW>();
+    fastDigitalWrite(nSS, LOW);
+    const uint8_t b[3] = { 0x36 | 0x80, s3, s2 }; // Burst write from Sync Word 3.
+    for(uint8_t i = 0; i < sizeof(b); ++i) { SPDR = b[i]; while(!(SPSR & _BV(SPIF))) { } }
+    fastDigitalWrite(nSS, HIGH);
+    if(neededEnable) { OTV0P2BASE::t_powerDownSPI<nSS, OTV0P2BASE::V0p2_PIN_SPI_SCK, OTV0P2BASE::V0p2_PIN_SPI_MOSI, OTV0P2BASE::V0p2_PIN_SPI_MISO, OTV0P2BASE::DEFAULT_RUN_SPI_SLOW>(); }
+    }
+  }
+// Program the building sync word into the GFSK radio(s); see ENABLE_RADIO_BUILDING_SYNC.
+// The two bytes are the start of the building key's AES encryption of a fixed block,
+// so they reveal nothing useful about the key; without a key the standard 0x2d 0xd4 is restored.
+// Bytes that look like preamble (or a stuck line) are avoided as they weaken sync detection.
+void applyBuildingSyncWord()
+  {
+  uint8_t s3 = 0x2d, s2 = 0xd4;
+  uint8_t key[16];
+  if(getPrimaryBuildingKey(key))
+    {
+    static const char label[16] PROGMEM = "OpenTRV sync v1";
+    uint8_t in[16], out[16];
+    memcpy_P(in, label, sizeof(in));
+    OTAESGCM::OTAES128E_AVR aes;
+    aes.blockEncrypt(in, key, out);
+    s3 = out[0];
+    s2 = out[1];
+    if((0x00 == s3) || (0xff == s3) || (0x55 == s3) || (0xaa == s3)) { s3 ^= 0x2d; }
+    if((0x00 == s2) || (0xff == s2) || (0x55 == s2) || (0xaa == s2)) { s2 ^= 0xd4; }
+    memset(out, 0, sizeof(out));
+    }
+  memset(key, 0, sizeof(key));
+  rfm23bWriteSync<OTV0P2BASE::V0p2_PIN_SPI_nSS>(s3, s2);
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+  rfm23bWriteSync<RFM23B_AUX_nSS_PIN>(s3, s2);
+#endif
+  }
+#endif // ENABLE_RADIO_BUILDING_SYNC
+
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+// Initialise the auxiliary receiver with the primary's channel configs, not listening yet.
+// Only the plain filter is applied: the RSSI notes and priority diversion are for the primary's frames.
+static bool auxRadioBegin()
+  {
+  RFM23BAux.preinit(NULL);
+#if defined(ENABLE_RADIO_DUAL_CARRIER) || defined(ENABLE_RADIO_GFSK_HW_PACKET)
+  if(!RFM23BAux.configure(1, &RFM23BBaseConfig) || !RFM23BAux.begin()) { return(false); }
+#endif
+  if(!RFM23BAux.configure(nPrimaryRadioChannels, RFM23BConfigs) || !RFM23BAux.begin()) { return(false); }
+  RFM23BAux.setFilterRXISR(FilterRXISR);
+  return(true);
+  }
+#endif // ENABLE_RADIO_AUX_RX_RFM23B
+
+#if defined(ENABLE_FAST_BOOT)
+// True if this boot should skip the POST light show; set at the start of setup().
+static bool fastBoot;
+#endif
+
+#ifdef ENABLE_RADIO_SECONDARY_MODULE
+// Drive the secondary radio's power control and pins to a defined low-power state; quick, so always done in setup().
+static void secondaryRadioPreinit()
+  {
+#ifdef ENABLE_RADIO_SIM900
+  // Turn power on for SIM900 with PFET for secondary power control.
+  fastDigitalWrite(A3, 0);
+  pinMode(A3, OUTPUT);
+#endif // ENABLE_RADIO_SIM900
+  // Initialise the radio, if configured, ASAP because it can suck a lot of power until properly initialised.
+  SecondaryRadio.preinit(NULL);
+  }
+// Start the secondary radio after secondaryRadioPreinit(); false if it is not correctly connected.
+// Can take seconds (eg SIM900 or RN2483).
+static bool secondaryRadioStart()
+  {
+#if 0 && defined(DEBUG) && !defined(ENABLE_TRIMMED_MEMORY)
+  DEBUG_SERIAL_PRINTLN_FLASHSTRING("R2");
+#endif
+  // Assume no RX nor filtering on secondary radio.
+  return(SecondaryRadio.configure(1, &SecondaryRadioConfig) && SecondaryRadio.begin());
+  }
+// As secondaryRadioStart() but panic if the radio is not connected.
+static void secondaryRadioBegin() { if(!secondaryRadioStart()) { panic(F("r2")); } }
+#endif // ENABLE_RADIO_SECONDARY_MODULE
+
+#if defined(ENABLE_FAST_SELF_TEST)
+// Failure bits reported by fastSelfTest(); 0 is a pass.
+enum fastSelfTestFail_t : uint8_t { FST_XTAL = 1, FST_R1 = 2, FST_R2 = 4, FST_BUTTON = 8, FST_TEMP = 16, FST_R3 = 32, FST_AES = 64 };
+// Production-line POST: run every check without the light show or stopping at the first fault,
+// overlapping the slow ones, then report all results as one JSON line and panic on any failure.
+// The 32768Hz xtal start-up (up to ~3s) and any split temperature conversion run
+// while the radios are initialised and the buttons checked, and are collected last.
+static void fastSelfTest()
+  {
+  uint8_t fail = 0;
+  const uint8_t sct0 = OTV0P2BASE::getSubCycleTime();
+#if defined(SHT21_SPLIT_CONVERSION) || (defined(DS18B20_SPLIT_CONVERSION) && defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20))
+  TemperatureC16.startConversion();
+#endif
+
+#ifdef ENABLE_RADIO_PRIMARY_RFM23B
+  PrimaryRadio.preinit(NULL);
+#if defined(ENABLE_RADIO_DUAL_CARRIER) || defined(ENABLE_RADIO_GFSK_HW_PACKET)
+  if(!PrimaryRadio.configure(1, &RFM23BBaseConfig) || !PrimaryRadio.begin()) { fail |= FST_R1; }
+#endif
+  if(!PrimaryRadio.configure(nPrimaryRadioChannels, RFM23BConfigs) || !PrimaryRadio.begin()) { fail |= FST_R1; }
+#ifndef NO_RX_FILTER
+  PrimaryRadio.setFilterRXISR(PrimaryRadioFilterRXISR);
+#endif // NO_RX_FILTER
+#endif // ENABLE_RADIO_PRIMARY_RFM23B
+
+#ifdef ENABLE_RADIO_SECONDARY_MODULE
+  secondaryRadioPreinit();
+  if(!secondaryRadioStart()) { fail |= FST_R2; }
+#endif // ENABLE_RADIO_SECONDARY_MODULE
+
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+  if(!auxRadioBegin()) { fail |= FST_R3; }
+#endif // ENABLE_RADIO_AUX_RX_RFM23B
+#if defined(ENABLE_RADIO_BUILDING_SYNC)
+  // Over the configs just loaded into the GFSK radio(s).
+  applyBuildingSyncWord();
+#endif
+
+#if ((V0p2_REV >= 1) && (V0p2_REV <= 4)) || ((V0p2_REV >= 7) && (V0p2_REV <= 8))
+  if((fastDigitalRead(BUTTON_MODE_L) == LOW)
+#if defined(BUTTON_LEARN_L)
+     || (fastDigitalRead(BUTTON_LEARN_L) == LOW)
+#endif
+#if defined(BUTTON_LEARN2_L)
+     || (fastDigitalRead(BUTTON_LEARN2_L) == LOW)
+#endif
+    )
+    { fail |= FST_BUTTON; }
+#endif // Select user-facing boards.
+
+#if defined(ENABLE_FAST_AES128) && (defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON))
+  if(!secureFrameKAT()) { fail |= FST_AES; }
+#endif
+
+  // Collect the temperature (any split conversion should long since be complete) and supply.
+  const int16_t tempC16 = TemperatureC16.read();
+  if(TemperatureC16.isErrorValue(tempC16)) { fail |= FST_TEMP; }
+  const uint16_t cV = Supply_cV.read();
+
+#if defined(ENABLE_WAKEUP_32768HZ_XTAL)
+  // As OTV0P2BASE::HWTEST::check32768HzOsc() but counting from the start of the test,
+  // so time already spent above counts towards the xtal start-up allowance.
+  for(uint8_t i = 255; ; )
+    {
+    const uint8_t sct = OTV0P2BASE::getSubCycleTime();
+    OTV0P2BASE::addEntropyToPool(sct, 0);
+    if((sct != sct0) && (sct != (uint8_t)(sct0+1))) { break; }
+    if(0 == --i) { fail |= FST_XTAL; break; }
+    OTV0P2BASE::nap(WDTO_15MS);
+    }
+#if defined(ENABLE_TUNE_FAST_OSC_TO_RTC_SOURCE)
+  // Tune the fast clock to the xtal as the normal POST does, before any more serial output.
+  if(0 == (fail & FST_XTAL))
+    {
+    if(OTV0P2BASE::_serialIsPoweredUp()) { OTV0P2BASE::flushSerialSCTSensitive(); }
+    tuneFastOscToRTC(64); // Run untuned rather than fail.
+    }
+#endif // ENABLE_TUNE_FAST_OSC_TO_RTC_SOURCE
+#endif // defined(ENABLE_WAKEUP_32768HZ_XTAL)
+
+  Serial.print(F("{\"POST\":"));
+  Serial.print(fail);
+  Serial.print(F(",\"T|C16\":"));
+  Serial.print(tempC16);
+  Serial.print(F(",\"B|cV\":"));
+  Serial.print(cV);
+  Serial.println('}');
+  OTV0P2BASE::flushSerialSCTSensitive();
+  if(0 != fail) { panic(F("POST")); }
+  }
+#endif // ENABLE_FAST_SELF_TEST
+
+#if defined(ENABLE_DEFERRED_INIT)
+uint8_t deferredInitPending;
+
+// Print the boot status line and CLI prompt.
+static void bootStatusReport()
+  {
+#if defined(ENABLE_CLI) && defined(ENABLE_CLI_HELP) && !defined(ENABLE_TRIMMED_MEMORY)
+  // Help user get to CLI.
+  OTV0P2BASE::serialPrintlnAndFlush(F("At CLI > prompt enter ? for help"));
+#endif
+#if !defined(ENABLE_TRIMMED_MEMORY)
+  // Report initial status.
+  serialStatusReport();
+#endif
+  }
+
+void deferredInitRun(const uint8_t what)
+  {
+  const uint8_t todo = deferredInitPending & what;
+  deferredInitPending &= ~what;
+#ifdef ENABLE_RADIO_SECONDARY_MODULE
+  if(0 != (todo & DI_SECONDARY_RADIO)) { secondaryRadioBegin(); }
+#endif
+  if(0 != (todo & DI_STATUS_REPORT)) { bootStatusReport(); }
+  }
+
+void deferredInitTick()
+  {
+  // The secondary radio is left to its own slot.
+  const uint8_t pending = deferredInitPending & ~DI_SECONDARY_RADIO;
+  if(0 == pending) { return; }
+  if(OTV0P2BASE::getSubCycleTime() >= OTV0P2BASE::GSCT_MAX/2) { return; }
+  // Lowest bit first, one per minor cycle.
+  deferredInitRun((uint8_t)(pending & -pending));
+  }
+#endif // ENABLE_DEFERRED_INIT
+
+#if defined(ENABLE_TUNE_FAST_OSC_TO_RTC_SOURCE) && defined(ENABLE_WAKEUP_32768HZ_XTAL)
+// Timer 0 (F_CPU/64) counts over two Timer 2 (32768Hz/256) ticks at nominal 1MHz; ~0.4% per count.
+static constexpr uint16_t OSC_TUNE_TARGET = (uint16_t)((F_CPU / 64) * 2 / 128);
+static constexpr uint8_t OSC_TUNE_TOLERANCE = 1;
+// Count Timer 0 ticks between the next edge of Timer 2 and two edges later.
+// Each tick's delay is taken mod 256 so that a fast RC oscillator does not wrap the count.
+static uint16_t measureFastOsc()
+  {
+  uint16_t count = 0;
+  ATOMIC_BLOCK (ATOMIC_RESTORESTATE)
+    {
+    uint8_t t = TCNT2;
+    while(t == TCNT2) { }
+    uint8_t c = TCNT0;
+    for(uint8_t i = 2; i-- > 0; )
+      {
+      t = TCNT2;
+      while(t == TCNT2) { }
+      const uint8_t c1 = TCNT0;
+      count += (uint8_t)(c1 - c);
+      c = c1;
+      }
+    }
+  return(count);
+  }
+// Step OSCCAL towards nominal; Timer 0 must be powered.
+static bool tuneFastOscToRTCSteps(uint8_t maxSteps)
+  {
+  for( ; ; )
+    {
+    const uint16_t m = measureFastOsc();
+    const uint8_t cal = OSCCAL;
+    if(m > OSC_TUNE_TARGET + OSC_TUNE_TOLERANCE)
+      {
+      // Too fast: step down, but not across the boundary between OSCCAL's two overlapping ranges.
+      if((0 == (cal & 0x7f)) || (0 == maxSteps)) { return(false); }
+      OSCCAL = cal - 1;
+      }
+    else if(m < OSC_TUNE_TARGET - OSC_TUNE_TOLERANCE)
+      {
+      if((0x7f == (cal & 0x7f)) || (0 == maxSteps)) { return(false); }
+      OSCCAL = cal + 1;
+      }
+    else { return(true); }
+    --maxSteps;
+    }
+  }
+bool tuneFastOscToRTC(uint8_t maxSteps)
+  {
+  // Timer 0 may have been powered down to save energy; it must be counting to measure against.
+  const bool t0WasOff = (0 != (PRR & _BV(PRTIM0)));
+  if(t0WasOff) { power_timer0_enable(); }
+  const bool ok = tuneFastOscToRTCSteps(maxSteps);
+  if(t0WasOff) { power_timer0_disable(); }
+  return(ok);
+  }
+#endif // ENABLE_TUNE_FAST_OSC_TO_RTC_SOURCE
+
 void optionalPOST()
   {
+#if defined(ENABLE_FAST_SELF_TEST)
+  fastSelfTest();
+  return;
+#endif
   // Have 32678Hz clock at least running before going any further.
 #if defined(ENABLE_WAKEUP_32768HZ_XTAL)
 #ifdef ENABLE_TUNE_FAST_OSC_TO_RTC_SOURCE
   // Check that the slow clock is running reasonably OK, and tune the fast one to it.
-  //if(!::OTV0P2BASE::HWTEST::calibrateInternalOscWithExtOsc()) { panic(F("Xtal")); } // Async clock not running or can't tune.
-    if(!::OTV0P2BASE::HWTEST::check32768HzOsc()) { panic(F("xtal")); } // Async clock not running correctly.
+  if(!::OTV0P2BASE::HWTEST::check32768HzOsc()) { panic(F("xtal")); } // Async clock not running correctly.
+  // Flush so that no character is on the wire as OSCCAL changes.
+  if(OTV0P2BASE::_serialIsPoweredUp()) { OTV0P2BASE::flushSerialSCTSensitive(); }
+  tuneFastOscToRTC(64); // Run untuned rather than panic if it does not converge.
 #else
   // Just check that the slow clock is running reasonably OK.
   if(!::OTV0P2BASE::HWTEST::check32768HzOsc()) { panic(F("xtal")); } // Async clock not running correctly.
@@ -228,6 +759,23 @@ void optionalPOST()
   DEBUG_SERIAL_PRINTLN_FLASHSTRING("(No xtal.)");
 #endif // defined(ENABLE_WAKEUP_32768HZ_XTAL)
 
+#if defined(ENABLE_FAST_AES128) && (defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON))
+  // Never send or accept secure frames with a broken cipher.
+  if(!secureFrameKAT()) { panic(F("AES")); }
+#endif
+
+#if defined(ENABLE_FAST_BOOT)
+  if(fastBoot)
+    {
+    // Brief settle for the xtal, churning the PRNG with its phase against the CPU clock meanwhile.
+    for(uint8_t i = 8; i > 0; --i)
+      {
+      OTV0P2BASE::nap(WDTO_15MS);
+      OTV0P2BASE::seedRNG8(OTV0P2BASE::getCPUCycleCount(), OTV0P2BASE::_getSubCycleTime(), i);
+      }
+    }
+  else
+#endif // ENABLE_FAST_BOOT
   // Signal that xtal is running AND give it time to settle.
   posPOST(0 /*, F("about to test radio module") */);
 
@@ -243,6 +791,10 @@ void optionalPOST()
   // Print out some info on the radio config.
   DEBUG_SERIAL_PRINT_FLASHSTRING("R1 #chan=");
   DEBUG_SERIAL_PRINT(nPrimaryRadioChannels);
+  #if defined(ENABLE_RADIO_MULTI_CHANNEL)
+  DEBUG_SERIAL_PRINT_FLASHSTRING(" ch=");
+  DEBUG_SERIAL_PRINT(primaryRadioChannel());
+  #endif
   #if defined(ENABLE_CONTINUOUS_RX)
   DEBUG_SERIAL_PRINT_FLASHSTRING(" contRX"); // Show that continuous RX is enabled (eg battery draining for non-hub nodes).
   #endif
@@ -250,29 +802,35 @@ void optionalPOST()
   DEBUG_SERIAL_PRINTLN_FLASHSTRING(RADIO_CONFIG_NAME);
 #endif
   // Check that the radio is correctly connected; panic if not...
+#if defined(ENABLE_RADIO_DUAL_CARRIER) || defined(ENABLE_RADIO_GFSK_HW_PACKET)
+  // Lay down the base state that the channel deltas assume.
+  if(!PrimaryRadio.configure(1, &RFM23BBaseConfig) || !PrimaryRadio.begin()) { panic(F("r1")); }
+#endif
   if(!PrimaryRadio.configure(nPrimaryRadioChannels, RFM23BConfigs) || !PrimaryRadio.begin()) { panic(F("r1")); }
   // Apply filtering, if any, while we're having fun...
 #ifndef NO_RX_FILTER
-  PrimaryRadio.setFilterRXISR(FilterRXISR);
+  PrimaryRadio.setFilterRXISR(PrimaryRadioFilterRXISR);
 #endif // NO_RX_FILTER
 #endif // ENABLE_RADIO_PRIMARY_RFM23B
 
-#ifdef ENABLE_RADIO_SECONDARY_MODULE
-#ifdef ENABLE_RADIO_SIM900
-  // Turn power on for SIM900 with PFET for secondary power control.
-  fastDigitalWrite(A3, 0);
-  pinMode(A3, OUTPUT);
-#endif // ENABLE_RADIO_SIM900
-  // Initialise the radio, if configured, ASAP because it can suck a lot of power until properly initialised.
-  SecondaryRadio.preinit(NULL);
-#if 0 && defined(DEBUG) && !defined(ENABLE_TRIMMED_MEMORY)
-  DEBUG_SERIAL_PRINTLN_FLASHSTRING("R2");
-#endif
-  // Check that the radio is correctly connected; panic if not...
-  if(!SecondaryRadio.configure(1, &SecondaryRadioConfig) || !SecondaryRadio.begin()) { panic(F("r2")); }
-  // Assume no RX nor filtering on secondary radio.
+#if defined(ENABLE_RADIO_SECONDARY_MODULE)
+  secondaryRadioPreinit();
+#if defined(ENABLE_DEFERRED_INIT)
+  // The slow begin() is left to its own slot in the loop; until then sends are refused.
+  deferredInitPending |= DI_SECONDARY_RADIO;
+#else
+  secondaryRadioBegin();
+#endif // ENABLE_DEFERRED_INIT
 #endif // ENABLE_RADIO_SECONDARY_MODULE
 
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+  if(!auxRadioBegin()) { panic(F("r3")); }
+#endif // ENABLE_RADIO_AUX_RX_RFM23B
+#if defined(ENABLE_RADIO_BUILDING_SYNC)
+  // Over the configs just loaded into the GFSK radio(s).
+  applyBuildingSyncWord();
+#endif
+
 //  posPOST(1, F("Radio OK, checking buttons/sensors and xtal"));
 
 // Buttons should not be activated DURING boot for user-facing boards; an activated button implies a fault.
@@ -301,6 +859,12 @@ void optionalPOST()
   }
 
 
+#if defined(ENABLE_SCRATCH_ARENA)
+// Shared static scratch arena for the big transient TX, RX and CLI buffers; see scratchRegion().
+uint8_t scratchArena[SCRATCH_ARENA_SIZE];
+#endif
+
+
 /////// SENSORS
 
 // Sensor for supply (eg battery) voltage in millivolts.
@@ -318,9 +882,141 @@ AmbientLight AmbLight;
 OTV0P2BASE::MinimalOneWire<> MinOW_DEFAULT;
 #endif
 
+#if defined(DS18B20_SPLIT_CONVERSION)
+// DS18B20 commands and family code, as used by the base class.
+static const uint8_t DS18B20_CMD_START_CONVO = 0x44;
+static const uint8_t DS18B20_CMD_READ_SCRATCH = 0xbe;
+static const uint8_t DS18B20_FAMILY_ID = 0x28;
+
+// Start conversion on all DS18B20s on the bus and return at once.
+// The first call also initialises the sensor(s), which involves a bus search.
+void TemperatureC16_DS18B20_Split::startConversion()
+  {
+  if(0 == getSensorCount()) { return; }
+#if defined(DS18B20_ROM_CACHE)
+  if(romCount >= 0xfe) { loadROMs(0xfe == romCount); } // Load at first use, or resync after a failed collect.
+#endif
+  bus.reset();
+  bus.skip();
+  bus.write(DS18B20_CMD_START_CONVO); // Start conversion without parasite power.
+  pending = true;
+  }
+
+// Collect the result of the last startConversion() without waiting, else read as the base class.
+int16_t TemperatureC16_DS18B20_Split::read()
+  {
+  if(!pending) { return(TemperatureC16_DS18B20::read()); }
+  if(1 != collectMultiple(&value, 1)) { value = DEFAULT_INVALID_TEMP; }
+  return(value);
+  }
+
+#if defined(DS18B20_ROM_CACHE)
+// Dallas/Maxim OneWire CRC8 of n bytes; 0 over a whole ROM ID or scratchpad if intact.
+static uint8_t ds18b20CRC(const uint8_t *const b, const uint8_t n)
+  {
+  uint8_t crc = 0;
+  for(uint8_t i = 0; i < n; ++i) { crc = _crc_ibutton_update(crc, b[i]); }
+  return(crc);
+  }
+// True if n bytes are all 0 (bus held low, which passes the CRC) or all 0xff (nothing answering).
+static bool ds18b20Blank(const uint8_t *const b, const uint8_t n)
+  {
+  uint8_t anyOnes = 0, allOnes = 0xff;
+  for(uint8_t i = 0; i < n; ++i) { anyOnes |= b[i]; allOnes &= b[i]; }
+  return((0 == anyOnes) || (0xff == allOnes));
+  }
+
+// Load the ROM table from EEPROM, or rediscover and store it if empty or invalid.
+// Discovery is a full bus search so is only done at first use or after a failure.
+void TemperatureC16_DS18B20_Split::loadROMs(const bool rediscover)
+  {
+  uint8_t address[8];
+  romCount = 0;
+  if(!rediscover)
+    {
+    while(romCount < V0P2_EE_DS18B20_ROMS)
+      {
+      eeprom_read_block(address, (const void *)(V0P2_EE_START_DS18B20_ROMS + 8*romCount), 8);
+      if((DS18B20_FAMILY_ID != address[0]) || (0 != ds18b20CRC(address, 8))) { break; }
+      ++romCount;
+      }
+    if(0 != romCount) { return; }
+    }
+  bus.reset_search();
+  while((romCount < V0P2_EE_DS18B20_ROMS) && bus.search(address))
+    {
+    if((DS18B20_FAMILY_ID != address[0]) || (0 != ds18b20CRC(address, 8))) { continue; }
+    uint8_t *const p = (uint8_t *)(V0P2_EE_START_DS18B20_ROMS + 8*romCount);
+    for(uint8_t i = 0; i < 8; ++i) { eeUpdateByte(EEW_CONFIG, p + i, address[i]); }
+    ++romCount;
+    }
+  bus.reset_search(); // Be kind to any other OW search user.
+  // Mark the rest of the table unused.
+  for(uint8_t r = romCount; r < V0P2_EE_DS18B20_ROMS; ++r)
+    { eeEraseByte(EEW_CONFIG, (uint8_t *)(V0P2_EE_START_DS18B20_ROMS + 8*r)); }
+  }
+
+// As readMultiple() but collecting the results of the last startConversion() without waiting.
+// The conversion is assumed long complete, so the scratchpad is read straight away.
+// Sensors are addressed directly from the ROM table rather than by searching the bus;
+// a missing sensor, or a blank scratchpad or bad scratchpad CRC, forces rediscovery at the next startConversion().
+uint8_t TemperatureC16_DS18B20_Split::collectMultiple(int16_t *const values, const uint8_t count, uint8_t index)
+  {
+  pending = false;
+  if(romCount >= 0xfe) { return(0); }
+  uint8_t sensor = 0;
+  uint8_t buf[9];
+  for(uint8_t r = index; (r < romCount) && (sensor < count); ++r)
+    {
+    eeprom_read_block(buf, (const void *)(V0P2_EE_START_DS18B20_ROMS + 8*r), 8);
+    const bool present = bus.reset();
+    bus.select(buf);
+    bus.write(DS18B20_CMD_READ_SCRATCH);
+    for(uint8_t i = 0; i < 9; ++i) { buf[i] = bus.read(); }
+    // Terminate read and let DS18B20 go back to sleep.
+    bus.reset();
+    if(!present || ds18b20Blank(buf, 9) || (0 != ds18b20CRC(buf, 9))) { romCount = 0xfe; break; } // Resync on next start.
+    values[sensor++] = (int16_t)((buf[1] << 8) | buf[0]);
+    }
+  return(sensor);
+  }
+#else
+// As readMultiple() but collecting the results of the last startConversion() without waiting.
+// The conversion is assumed long complete, so the scratchpad is read straight away.
+uint8_t TemperatureC16_DS18B20_Split::collectMultiple(int16_t *const values, const uint8_t count, uint8_t index)
+  {
+  pending = false;
+  if(0 == getSensorCount()) { return(0); }
+  uint8_t sensor = 0;
+  uint8_t address[8];
+  bus.reset_search();
+  while((sensor < count) && bus.search(address))
+    {
+    if(DS18B20_FAMILY_ID != address[0]) { continue; }
+    if(index > 0) { --index; continue; }
+    // Fetch temperature (first two bytes of the scratchpad, no CRC check).
+    bus.reset();
+    bus.select(address);
+    bus.write(DS18B20_CMD_READ_SCRATCH);
+    const uint8_t d0 = bus.read();
+    const uint8_t d1 = bus.read();
+    // Terminate read and let DS18B20 go back to sleep.
+    bus.reset();
+    values[sensor++] = (int16_t)((d1 << 8) | d0);
+    }
+  bus.reset_search(); // Be kind to any other OW search user.
+  return(sensor);
+  }
+#endif // defined(DS18B20_ROM_CACHE)
+#endif // defined(DS18B20_SPLIT_CONVERSION)
+
 #if defined(SENSOR_EXTERNAL_DS18B20_ENABLE_0) // Enable sensor zero.
+#if defined(DS18B20_SPLIT_CONVERSION)
+TemperatureC16_DS18B20_Split extDS18B20_0(MinOW_DEFAULT, 0);
+#else
 OTV0P2BASE::TemperatureC16_DS18B20 extDS18B20_0(MinOW_DEFAULT, 0);
 #endif
+#endif
 
 #if defined(ENABLE_PRIMARY_TEMP_SENSOR_SHT21)
 // Singleton implementation/instance.
@@ -331,12 +1027,65 @@ OTV0P2BASE::DummyHumiditySensorSHT21 RelHumidity;
 
 // Ambient/room temperature sensor, usually on main board.
 #if defined(ENABLE_PRIMARY_TEMP_SENSOR_SHT21)
+#if defined(SHT21_SPLIT_CONVERSION)
+static const uint8_t SHT21_I2C_ADDR = 0x40;
+static const uint8_t SHT21_I2C_CMD_TEMP_NOHOLD = 0xf3;
+
+// Trigger a no-hold-master temperature measurement and return at once.
+// The SHT21 does not need the bus during the conversion, so TWI can be powered down meanwhile.
+// The first call reads once as the base class to initialise the device.
+void RoomTemperatureC16_SHT21_Split::startConversion()
+  {
+  if(DEFAULT_INVALID_TEMP == value) { RoomTemperatureC16_SHT21::read(); }
+  const PeripheralPower<PP_TWI> twiPower;
+  Wire.beginTransmission(SHT21_I2C_ADDR);
+  Wire.write((byte) SHT21_I2C_CMD_TEMP_NOHOLD);
+  pending = (0 == Wire.endTransmission());
+  }
+
+// Fetch the result of the last startConversion() without waiting, else read as the base class.
+// The SHT21 NACKs the read while still measuring, in which case a blocking read is done instead.
+// A result flagged as humidity (status bit 1), eg from an intervening RH command, is also read again.
+int16_t RoomTemperatureC16_SHT21_Split::read()
+  {
+  if(!pending) { return(RoomTemperatureC16_SHT21::read()); }
+  pending = false;
+  bool ready;
+  uint16_t rawTemp = 0;
+    {
+    const PeripheralPower<PP_TWI> twiPower;
+    ready = (3 == Wire.requestFrom(SHT21_I2C_ADDR, 3U));
+    if(ready)
+      {
+      rawTemp = (Wire.read() << 8);
+      const uint8_t lsb = Wire.read();
+      ready = (0 == (lsb & 2)); // Status bit 1 is set for a humidity result.
+      rawTemp |= (lsb & 0xfc); // Clear status ls bits.
+      }
+    }
+  if(!ready) { return(RoomTemperatureC16_SHT21::read()); }
+
+  // As the base class: nominally C = -46.85 + ((175.72*raw) / (1L << 16)).
+  const int16_t c16 = -750 + ((5623L * rawTemp) >> 17);
+  // Capture entropy if (transformed) value has changed.
+  if((uint8_t)c16 != (uint8_t)value) { OTV0P2BASE::addEntropyToPool((uint8_t)rawTemp, 0); } // Claim zero entropy as may be forced by Eve.
+  value = c16;
+  return(c16);
+  }
+
+RoomTemperatureC16_SHT21_Split TemperatureC16; // SHT21 impl.
+#else
 OTV0P2BASE::RoomTemperatureC16_SHT21 TemperatureC16; // SHT21 impl.
+#endif
 #elif defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20)
 #if defined(ENABLE_MINIMAL_ONEWIRE_SUPPORT)
 // DSB18B20 temperature impl, with slightly reduced precision to improve speed.
+#if defined(DS18B20_SPLIT_CONVERSION)
+TemperatureC16_DS18B20_Split TemperatureC16(MinOW_DEFAULT, OTV0P2BASE::TemperatureC16_DS18B20::MAX_PRECISION - 1);
+#else
 OTV0P2BASE::TemperatureC16_DS18B20 TemperatureC16(MinOW_DEFAULT, OTV0P2BASE::TemperatureC16_DS18B20::MAX_PRECISION - 1);
 #endif
+#endif
 #else // Don't use TMP112 if SHT21 or DS18B20 are selected.
 OTV0P2BASE::RoomTemperatureC16_TMP112 TemperatureC16;
 #endif
@@ -363,12 +1112,7 @@ ValveDirect_t ValveDirect([](){return((!valveUI.veryRecentUIControlUse()) && Amb
 uint8_t *appendStatsToTXBufferWithFF(uint8_t *bptr, const uint8_t bufSize)
 {
   OTV0P2BASE::FullStatsMessageCore_t trailer;
-  OTRadValve::populateCoreStats(&trailer,
-                    (localFHT8VTRVEnabled() ? &FHT8V : NULL),
-                    TemperatureC16.get(),
-                    Supply_cV.isSupplyVoltageLow(),
-                    AmbLight.get(),
-                    Occupancy.twoBitOccupancyValue());
+  populateCoreStatsFromSensors(&trailer);
   // Ensure that no ID is encoded in the message sent on the air since it would be a repeat from the FHT8V frame.
   trailer.containsID = false;
 
@@ -385,7 +1129,7 @@ uint8_t *appendStatsToTXBufferWithFF(uint8_t *bptr, const uint8_t bufSize)
 #endif
   {
     // Assume enough space in buffer for largest possible stats message.
-    bptr = OTV0P2BASE::encodeFullStatsMessageCore(bptr, bufSize, OTV0P2BASE::getStatsTXLevel(), false, &trailer);
+    bptr = OTV0P2BASE::encodeFullStatsMessageCore(bptr, bufSize, getStatsTXLevelCached(), false, &trailer);
   }
   return (bptr);
 }
@@ -395,13 +1139,142 @@ uint8_t *appendStatsToTXBufferWithFF(uint8_t *bptr, const uint8_t bufSize)
 #endif // ENABLE_FHT8VSIMPLE
 
 #ifdef ENABLE_FHT8VSIMPLE
-OTRadValve::FHT8VRadValve<_FHT8V_MAX_EXTRA_TRAILER_BYTES, OTRadValve::FHT8VRadValveBase::RFM23_PREAMBLE_BYTES, OTRadValve::FHT8VRadValveBase::RFM23_PREAMBLE_BYTE> FHT8V(appendStatsToTXBufferWithFF);
+FHT8V_t FHT8V(appendStatsToTXBufferWithFF);
+#if defined(ENABLE_FHT8V_MULTI)
+FHT8VExtra_t FHT8VExtra[FHT8V_EXTRA_VALVES] =
+  {
+  NULL,
+#if FHT8V_EXTRA_VALVES > 1
+  NULL,
+#endif
+#if FHT8V_EXTRA_VALVES > 2
+  NULL,
+#endif
+  };
+#endif // ENABLE_FHT8V_MULTI
+#if defined(ENABLE_FHT8V_FRAME_CACHE)
+// Inputs to the last frame built; the FS20 bit-stream encoding dominates the cost, not the trailer.
+// The sync sequence overwrites the TX buffer, so a frame built while not synced is never reused.
+static uint8_t fht8vLastPC = 0xff;
+static uint8_t fht8vLastHC1, fht8vLastHC2;
+static bool fht8vLastBuiltSynced;
+#if defined(ENABLE_STATS_TX)
+static uint8_t fht8vLastTrailer[_FHT8V_MAX_EXTRA_TRAILER_BYTES];
+static uint8_t fht8vLastTrailerLen;
+#endif
+bool fht8vSetIfChanged(const uint8_t valvePC)
+  {
+  bool same = fht8vLastBuiltSynced && FHT8V.isInNormalRunState() && (valvePC == fht8vLastPC) &&
+              (FHT8V.getHC1() == fht8vLastHC1) && (FHT8V.getHC2() == fht8vLastHC2);
+#if defined(ENABLE_STATS_TX)
+  uint8_t trailer[_FHT8V_MAX_EXTRA_TRAILER_BYTES];
+  const uint8_t *const end = appendStatsToTXBufferWithFF(trailer, sizeof(trailer));
+  const uint8_t tl = (NULL == end) ? 0 : (uint8_t)(end - trailer);
+  same = same && (tl == fht8vLastTrailerLen) && (0 == memcmp(trailer, fht8vLastTrailer, tl));
+  memcpy(fht8vLastTrailer, trailer, tl);
+  fht8vLastTrailerLen = tl;
+#endif
+  if(same) { return(false); }
+  FHT8V.set(valvePC);
+  fht8vLastPC = valvePC;
+  fht8vLastHC1 = FHT8V.getHC1();
+  fht8vLastHC2 = FHT8V.getHC2();
+  fht8vLastBuiltSynced = FHT8V.isInNormalRunState();
+  return(true);
+  }
+#endif // ENABLE_FHT8V_FRAME_CACHE
 #endif // ENABLE_FHT8VSIMPLE
 
 ////////////////////////// CONTROL
 
+#if defined(ENABLE_PACKED_NV_STATS)
+uint8_t PackedByHourByteStats::getByHourStatRaw(const uint8_t statsSet, const uint8_t hh) const
+  {
+  if(!isPacked(statsSet) || (hh > 23)) { return(ee.getByHourStatRaw(statsSet, hh)); }
+  const uint8_t b = eeprom_read_byte((uint8_t *)(V0P2BASE_EE_STATS_START_ADDR(statsSet & ~1) + hh));
+  const uint8_t code = (statsSet & 1) ? (b & 0xf) : (b >> 4);
+  if(0xf == code) { return(OTV0P2BASE::STATS_UNSET_BYTE); }
+  return((uint8_t)((code * 100U + 7) / 14));
+  }
+uint8_t PackedByHourByteStats::encode(const uint8_t value)
+  {
+  if(OTV0P2BASE::STATS_UNSET_BYTE == value) { return(0xf); }
+  // Round down or up to a neighbouring code with probability in proportion to the remainder.
+  const uint16_t scaled = OTV0P2BASE::fnmin((uint8_t)100, value) * 14U;
+  uint8_t code = (uint8_t)(scaled / 100);
+  if((scaled % 100) > (OTV0P2BASE::randRNG8() % 100)) { ++code; }
+  return(code);
+  }
+void PackedByHourByteStats::setByHourStatRaw(const uint8_t statsSet, const uint8_t hh, const uint8_t value)
+  {
+  if(!isPacked(statsSet) || (hh > 23)) { ee.setByHourStatRaw(statsSet, hh, value); return; }
+  const uint8_t code = encode(value);
+  uint8_t *const p = (uint8_t *)(V0P2BASE_EE_STATS_START_ADDR(statsSet & ~1) + hh);
+  const uint8_t b = eeprom_read_byte(p);
+  eeUpdateByte(EEW_STATS, p, (statsSet & 1) ? ((b & 0xf0) | code) : ((b & 0xf) | (code << 4)));
+  }
+void PackedByHourByteStats::migrate()
+  {
+  if(FORMAT_PACKED == eeprom_read_byte((uint8_t *)V0P2_EE_START_STATS_FORMAT)) { return; }
+  // Read both sets in byte format, from their own areas, before overwriting the 'last' byte with both codes.
+  for(uint8_t s = STATS_SET_OCCPC_BY_HOUR; s <= STATS_SET_RHPC_BY_HOUR; s += 2)
+    {
+    for(uint8_t hh = 0; hh < 24; ++hh)
+      {
+      const uint8_t last = ee.getByHourStatRaw(s, hh);
+      const uint8_t smoothed = ee.getByHourStatRaw(s + 1, hh);
+      eeUpdateByte(EEW_STATS, (uint8_t *)(V0P2BASE_EE_STATS_START_ADDR(s) + hh), (encode(last) << 4) | encode(smoothed));
+      }
+    }
+  eeUpdateByte(EEW_STATS, (uint8_t *)V0P2_EE_START_STATS_FORMAT, FORMAT_PACKED);
+  }
+#endif // ENABLE_PACKED_NV_STATS
+
+#if defined(ENABLE_NV_STATS_RAM_SHADOW)
+void ShadowedByHourByteStats::flushColumn(const uint8_t c)
+  {
+  if(0 == dirty[c]) { return; }
+  for(uint8_t i = 0; i < SETS; ++i)
+    { if(0 != (dirty[c] & (1U << i))) { ee.setByHourStatRaw(i, hours[c], values[c][i]); } }
+  dirty[c] = 0;
+  }
+uint8_t ShadowedByHourByteStats::load(const uint8_t hh)
+  {
+  const uint8_t c = newest ^ 1;
+  flushColumn(c);
+  for(uint8_t i = 0; i < SETS; ++i) { values[c][i] = ee.getByHourStatRaw(i, hh); }
+  hours[c] = hh;
+  newest = c;
+  return(c);
+  }
+bool ShadowedByHourByteStats::zapStats(const uint16_t maxBytesToErase)
+  {
+  // Drop the shadow (including unflushed values) so it cannot resurrect erased stats.
+  hours[0] = hours[1] = NO_HOUR;
+  dirty[0] = dirty[1] = 0;
+  return(ee.zapStats(maxBytesToErase));
+  }
+uint8_t ShadowedByHourByteStats::getByHourStatRaw(const uint8_t statsSet, const uint8_t hh) const
+  {
+  const int8_t c = (statsSet < SETS) ? column(hh) : -1;
+  if(c < 0) { return(ee.getByHourStatRaw(statsSet, hh)); }
+  return(values[c][statsSet]);
+  }
+void ShadowedByHourByteStats::setByHourStatRaw(const uint8_t statsSet, const uint8_t hh, const uint8_t value)
+  {
+  if((statsSet >= SETS) || (hh > 23)) { ee.setByHourStatRaw(statsSet, hh, value); return; }
+  int8_t c = column(hh);
+  if(c < 0) { c = load(hh); }
+  if(value == values[c][statsSet]) { return; }
+  values[c][statsSet] = value;
+  dirty[c] |= (uint16_t)(1U << statsSet);
+  }
+// Singleton non-volatile stats store instance.
+ShadowedByHourByteStats eeStats;
+#else
 // Singleton non-volatile stats store instance.
-OTV0P2BASE::EEPROMByHourByteStats eeStats;
+NVStatsStore_t eeStats;
+#endif // ENABLE_NV_STATS_RAM_SHADOW
 
 // Stats updater singleton.
 StatsU_t statsU;
@@ -423,8 +1296,108 @@ OccupancyTracker Occupancy;
 // Mechanism to generate '=' stats line, if enabled.
 #if defined(ENABLE_SERIAL_STATUS_REPORT)
 StatsLine_t statsLine;
+#if defined(ENABLE_BINARY_STATUS_RECORD)
+// As the '=' line, but as a fixed-width CRC-protected 'S' record of about 20 bytes on the wire rather than ~60+ (or JSON),
+// if selected in EEPROM; all multi-byte values are big-endian, and 0xff marks an absent sensor:
+//   flags: b0 WARM, b1 BAKE, b2 eco bias, b3 room dark, b4 schedule on, b5 supply low
+//   valve %, temperature C*16 (2, signed), target C, minutes since midnight (2),
+//   ambient light, RH %, occupancy (0 unknown to 3 likely), supply cV (2)
+void serialStatusReport()
+  {
+  if(V0P2_STATUS_FORMAT_BINARY != eeprom_read_byte((uint8_t *)V0P2_EE_START_STATUS_FORMAT))
+    { statsLine.serialStatusReport(); return; }
+  static uint8_t seq;
+  uint8_t id[2];
+  eeprom_read_block(id, (void *)V0P2BASE_EE_START_ID, sizeof(id));
+  const int16_t t = TemperatureC16.get();
+  const uint16_t msm = OTV0P2BASE::getMinutesSinceMidnightLT();
+  const uint16_t cV = Supply_cV.get();
+  const uint8_t r[12] =
+    {
+    (uint8_t)(valveMode.inWarmMode() | (valveMode.inBakeMode() << 1) | (tempControl.hasEcoBias() << 2) |
+#ifdef ENABLE_AMBLIGHT_SENSOR
+      (AmbLight.isRoomDark() << 3) |
+#endif
+      (Scheduler.isAnyScheduleOnWARMNow() << 4) | (Supply_cV.isSupplyVoltageLow() << 5)),
+#if defined(ENABLE_NOMINAL_RAD_VALVE)
+    NominalRadValve.get(),
+#else
+    0xff,
+#endif
+    (uint8_t)(t >> 8), (uint8_t)t,
+#if defined(ENABLE_MODELLED_RAD_VALVE)
+    NominalRadValve.targetTemperatureSubSensor.get(),
+#else
+    0xff,
+#endif
+    (uint8_t)(msm >> 8), (uint8_t)msm,
+#ifdef ENABLE_AMBLIGHT_SENSOR
+    AmbLight.get(),
+#else
+    0xff,
+#endif
+#if defined(HUMIDITY_SENSOR_SUPPORT)
+    RelHumidity.get(),
+#else
+    0xff,
+#endif
+#ifdef ENABLE_OCCUPANCY_SUPPORT
+    Occupancy.twoBitOccupancyValue(),
+#else
+    0xff,
+#endif
+    (uint8_t)(cV >> 8), (uint8_t)cV,
+    };
+  binRecStart('S', id, sizeof(id), seq++);
+  binRecPut(r, sizeof(r));
+  binRecEnd();
+  }
+#endif // ENABLE_BINARY_STATUS_RECORD
 #endif // defined(ENABLE_SERIAL_STATUS_REPORT)
 
+#if defined(V0P2_SINGLETONS_RAM_CEILING)
+// Static RAM (bytes) taken by the main singletons defined in this file,
+// checked against the per-config ceiling that V0p2_primary_CONFIGs_size_budget_tests.sh
+// sets from V0p2_CONFIG_budgets.txt; its per-symbol report shows where the rest goes.
+static constexpr size_t singletonsRAM = sizeof(Supply_cV)
+#ifdef TEMP_POT_AVAILABLE
+  + sizeof(TempPot)
+#endif
+#ifdef ENABLE_AMBLIGHT_SENSOR
+  + sizeof(AmbLight)
+#endif
+#if defined(ENABLE_MINIMAL_ONEWIRE_SUPPORT)
+  + sizeof(MinOW_DEFAULT)
+#endif
+#if defined(SENSOR_EXTERNAL_DS18B20_ENABLE_0)
+  + sizeof(extDS18B20_0)
+#endif
+  + sizeof(RelHumidity)
+  + sizeof(TemperatureC16)
+#ifdef ENABLE_VOICE_SENSOR
+  + sizeof(Voice)
+#endif
+#ifdef HAS_DORM1_VALVE_DRIVE
+  + sizeof(ValveDirect)
+#endif
+#ifdef ENABLE_FHT8VSIMPLE
+  + sizeof(FHT8V)
+#endif
+  + sizeof(eeStats)
+  + sizeof(statsU)
+  + sizeof(Scheduler)
+  + sizeof(valveMode)
+  + sizeof(tempControl)
+#ifdef ENABLE_OCCUPANCY_SUPPORT
+  + sizeof(Occupancy)
+#endif
+#if defined(ENABLE_SERIAL_STATUS_REPORT)
+  + sizeof(statsLine)
+#endif
+  ;
+static_assert(singletonsRAM <= V0P2_SINGLETONS_RAM_CEILING, "main singletons over this config's RAM ceiling");
+#endif // V0P2_SINGLETONS_RAM_CEILING
+
 //========================================
 // SETUP
 //========================================
@@ -433,8 +1406,23 @@ StatsLine_t statsLine;
 // Does some limited board self-test and will panic() if anything is obviously broken.
 void setup()
   {
+#if defined(ENABLE_FAST_BOOT) || defined(ENABLE_VALVE_FIT_MEMORY)
+  // Capture and clear the reset cause; WDRF left set would keep the watchdog forced on.
+  const uint8_t resetCause = MCUSR;
+  MCUSR = 0;
+#endif
+
   // Set appropriate low-power states, interrupts, etc, ASAP.
   OTV0P2BASE::powerSetup();
+  // Roles to run in this deployment.
+  loadFeatureProfile();
+#if defined(ENABLE_PACKED_NV_STATS)
+  // Convert any stats left in byte format by older firmware before first use.
+  eeStats.migrate();
+#endif
+#if defined(ENABLE_ISR_PROFILER)
+  isrProfileSetup();
+#endif
 
 //#if defined(ENABLE_MIN_ENERGY_BOOT)
 //  nap(WDTO_120MS); // Sleep to let power supply recover a little.
@@ -442,6 +1430,11 @@ void setup()
 
   // IO setup for safety, and to avoid pins floating.
   OTV0P2BASE::IOSetup();
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+  // Deselect the auxiliary RFM23B before the primary radio's SPI set-up, so that only one radio answers on the bus.
+  fastDigitalWrite(RFM23B_AUX_nSS_PIN, HIGH);
+  pinMode(RFM23B_AUX_nSS_PIN, OUTPUT);
+#endif
 
 //#if defined(ENABLE_MIN_ENERGY_BOOT)
 //  nap(WDTO_120MS); // Sleep to let power supply recover a little.
@@ -449,7 +1442,7 @@ void setup()
 
 #if !defined(ENABLE_MIN_ENERGY_BOOT)
   // Restore previous RTC state if available.
-  OTV0P2BASE::restoreRTC();
+  restoreRTCApp();
 #endif
 
 #if !defined(ENABLE_MIN_ENERGY_BOOT)
@@ -466,8 +1459,38 @@ void setup()
 
 #if !defined(ENABLE_MIN_ENERGY_BOOT)
   // Count resets to detect unexpected crashes/restarts.
+  // Wraps from 0xfe to 0, so the erased value 0xff only ever means 'never booted'.
   const uint8_t oldResetCount = eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_RESET_COUNT);
-  eeprom_write_byte((uint8_t *)V0P2BASE_EE_START_RESET_COUNT, 1 + oldResetCount);
+  eeWriteByte(EEW_BOOT, (uint8_t *)V0P2BASE_EE_START_RESET_COUNT, (0xfe == oldResetCount) ? 0 : (uint8_t)(1 + oldResetCount));
+#endif
+
+#if defined(ENABLE_TASK_SUPERVISOR) && !defined(ENABLE_MIN_ENERGY_BOOT)
+  // Report the slot of the last supervisor reset, then clear it so it is reported only once.
+  const uint8_t svTrip = eeprom_read_byte((uint8_t *)V0P2_EE_START_SUPERVISOR_TRIP);
+  if(0xff != svTrip)
+    {
+    OTV0P2BASE::serialPrintAndFlush(F("!SV ")); OTV0P2BASE::serialPrintAndFlush(svTrip); OTV0P2BASE::serialPrintlnAndFlush();
+    eeEraseByte(EEW_BOOT, (uint8_t *)V0P2_EE_START_SUPERVISOR_TRIP);
+    }
+#endif
+
+#if defined(ENABLE_FAST_BOOT)
+  // Only skip the light show for a watchdog or brown-out reset (ie in the field, not at power-on or by hand)
+  // and where this unit has booted before, ie the reset count is not still erased.
+  // A bootloader that clears MCUSR itself leaves this zero, and so always gives the normal boot.
+#if defined(ENABLE_MIN_ENERGY_BOOT)
+  const uint8_t oldResetCount = eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_RESET_COUNT);
+#endif
+  fastBoot = (0 != (resetCause & (_BV(WDRF) | _BV(BORF)))) && (0 == (resetCause & _BV(PORF))) && (0xff != oldResetCount);
+#if !defined(ENABLE_MIN_ENERGY_BOOT)
+  if(fastBoot) { OTV0P2BASE::serialPrintlnAndFlush(F("fast boot")); }
+#endif
+#endif // ENABLE_FAST_BOOT
+#if defined(ENABLE_VALVE_FIT_MEMORY)
+  valveFitMemorySetup(resetCause);
+#endif
+#if defined(ENABLE_BOILER_HUB_CHECKPOINT)
+  boilerCheckpointSetup(resetCause);
 #endif
 
 #if defined(DEBUG) && !defined(ENABLE_MIN_ENERGY_BOOT)
@@ -495,6 +1518,9 @@ void setup()
 #endif
 #endif
 
+  // Load hot settings from EEPROM before anything uses them.
+  loadSettingsCache();
+
   optionalPOST();
 
   // Collect full set of environmental values before entering loop() in normal mode.
@@ -570,10 +1596,19 @@ void setup()
     if(!OTV0P2BASE::ensureIDCreated(true)) // Force reset.
       { panic(F("ID")); }
     }
+  // Pick up any newly-created ID.
+  loadSettingsCache();
+  // Start this node's own scheduling PRNG stream.
+  seedJitterRNG();
+  // Index node associations for secure RX.
+  rebuildRXAssocIndex();
 
   // Initialised: turn main/heatcall UI LED off.
   OTV0P2BASE::LED_HEATCALL_OFF();
 
+#if defined(ENABLE_DEFERRED_INIT)
+  deferredInitPending |= DI_STATUS_REPORT;
+#else
 #if defined(ENABLE_CLI) && defined(ENABLE_CLI_HELP) && !defined(ENABLE_TRIMMED_MEMORY)
   // Help user get to CLI.
   OTV0P2BASE::serialPrintlnAndFlush(F("At CLI > prompt enter ? for help"));
@@ -583,6 +1618,7 @@ void setup()
   // Report initial status.
   serialStatusReport();
 #endif
+#endif // ENABLE_DEFERRED_INIT
   // Do OpenTRV-specific (late) setup.
   setupOpenTRV();
   }
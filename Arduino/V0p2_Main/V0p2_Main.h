@@ -30,6 +30,128 @@ Author(s) / Copyright (s): Damon Hart-Davis 2013--2017
 // GLOBAL flags that alter system build and behaviour.
 //#define DEBUG // If defined, do extra checks and serial logging.  Will take more code space and power.
 //#define EST_CPU_DUTYCYCLE // If defined, estimate CPU duty cycle and thus base power consumption.
+//#define ENABLE_RX_BATCH_DRAIN // If defined, handleQueuedMessages() drains multiple queued RX frames per call within a tick budget.
+//#define ENABLE_SKIP_IDLE_SLOTS // If defined, leaf nodes sleep straight through loop slots with no scheduled work when nothing else is pending.
+//#define ENABLE_FAST_BOILER_RESPONSE // If defined, a boiler hub drives OUT_HEATCALL as soon as a valid call for heat is decoded.
+//#define ENABLE_SETTINGS_CACHE // If defined, keep hot EEPROM-backed settings (hub mode, TX level, ID) cached in RAM.
+//#define ENABLE_KEY_CACHE // If defined, keep the primary building key cached in RAM for secure TX/RX.
+//#define ENABLE_RX_ASSOC_INDEX // If defined, keep a RAM hash index of associated node IDs and RX counters to reject unknown/replayed secure frames early.
+//#define ENABLE_RX_ISR_ASSOC_FILTER // If defined, drop secure frames whose sender ID prefix cannot match an association in the RX ISR.
+//#define ENABLE_BOILER_HUB_VALVE_TABLE // If defined, a boiler hub tracks each calling valve and can act on aggregate demand.
+//#define ENABLE_LINK_STATS // If defined, report RX drop/error and TX/JSON failure counters in stats and the S command.
+//#define ENABLE_RELAY_BATCHING // If defined, a relay packs several length-prefixed relayed frames into each secondary radio send.
+//#define ENABLE_RX_PRIORITY_QUEUE // If defined, a boiler hub queues valve/call-for-heat frames separately, ahead of bulk stats.
+//#define ENABLE_BINARY_SERIAL_OUTPUT // If defined, hubs write received frames to Serial as SLIP-framed binary records (see util/v0p2_binary_serial_decode.py) rather than JSON text.
+//#define ENABLE_DEFERRED_SERIAL_POWERDOWN // If defined, let the interrupt-driven serial TX buffer drain during end-of-cycle idle sleep rather than spinning in flushes.
+//#define ENABLE_SECURE_STATS_TLV // If defined, send compact binary TLV stats in secure 'O' frames instead of JSON, and decode them on hubs.
+//#define ENABLE_CLI_BATCH // If defined, one CLI line may hold several ';'-separated commands, run in turn with a single status line or ack at the end.
+//#define ENABLE_SENSOR_BURST_MODE // If defined, sensor-only leaves run the loop body only for per-minute bookkeeping and one sensor-read-and-stats-TX burst every 4 minutes, sleeping through every other tick.
+//#define ENABLE_TX_DUTY_CYCLE // If defined, the RFM23B driver counts its airtime over a rolling hour against a 1% budget, dropping the double-TX copy near the limit and refusing frames at it.
+//#define ENABLE_RELAY_LATENCY_STATS // If defined, hubs time each received frame from radio interrupt to decode, the decode itself, and relayed frames until the secondary radio takes them; see +LAT.
+//#define ENABLE_VOICE_POWER_GATING // If defined, the REV14 voice module is powered only when occupancy and time of day make it useful, with settling time before its detections count.
+//#define ENABLE_DUAL_RX_KEY // If defined, hubs keep accepting secure frames under the previous building key for a while after K, trying first the key each sender last used.
+//#define ENABLE_CALL_FOR_HEAT_RING // If defined, a boiler hub queues each received call for heat in a lock-free ring so that several in one pass are all logged and none is overwritten.
+//#define ENABLE_STATS_KEY_SUBSCRIPTION // If defined, a hub also ACKs sequence-0 secure frames so each sender gets a periodic bitmap (+SUB) of the optional stats keys its site wants, and leaves keep it in EEPROM and drop the rest from their stats rotation.
+//#define ENABLE_BOILER_HUB_CHECKPOINT // If defined, a boiler hub checkpoints boiler on/off to EEPROM and resumes it at once after a watchdog or brown-out reset.
+//#define ENABLE_TUNE_FAST_OSC_TO_RTC_SOURCE // If defined, tune OSCCAL to the 32768Hz crystal at boot, hourly and on a room temperature change, so a hub may run V0P2_UART_BAUD at 9600.
+//#define ENABLE_ADAPTIVE_SENSOR_SAMPLING // If defined, sample room temperature and RH only every few minutes while the valve is shut, not in WARM/BAKE, and the temperature is steady.
+//#define ENABLE_RFM23B_SLEEPY_TX // If defined, the RFM23B driver sleeps the CPU through each frame's airtime until the packet-sent interrupt, rather than spinning.
+//#define ENABLE_TEMP_POT_FOLLOW // If defined, once the temperature pot is seen to move it is sampled every minor cycle for TEMP_POT_FOLLOW_S, so the dial responds at once while being turned.
+//#define ENABLE_DEFERRED_INIT // If defined, setup() leaves the secondary radio begin() to its own idle slot and the boot status report to the first spare minor-cycle time, so the control loop starts sooner.
+//#define ENABLE_REMOTE_DIAG // If defined, a hub can request (+DGQ slot or ID prefix) a compact secure diagnostics frame from a leaf via its ACKs, which the leaf sends in place of its next scheduled stats frame.
+//#define ENABLE_PACKED_NV_STATS // If defined, keep occupancy and RH % by-hour stats (last and smoothed) as nibbles, two sets per EEPROM set, freeing two sets' EEPROM.
+//#define ENABLE_LORA_UPLINK_PACKER // If defined, local and relayed frames for the RN2483 LoRaWAN secondary radio are packed into full uplinks sent within the EU868 duty cycle.
+//#define ENABLE_VOICE_IRQ_RATE_LIMIT // If defined, the voice sensor interrupt is masked after its first edge each minute, bounding ISR load in noisy rooms.
+//#define ENABLE_RADIO_BUILDING_SYNC // If defined, GFSK radios use a sync word derived from the building key, so other buildings' frames are never received (not with ENABLE_DUAL_RX_KEY).
+//#define ENABLE_CHANNEL_UTILISATION // If defined, hubs measure primary channel busy time and undecodable frames per minute, for stats and the S command.
+//#define ENABLE_BULK_NODE_ASSOC // If defined, the CLI B command loads several checksummed node associations per line in one pass with a summary reply.
+//#define ENABLE_RADIO_GFSK_HW_PACKET // If defined, GFSK frames carry a building header byte and RFM23B hardware CRC-16 so the radio interrupts only for matching, intact packets; all nodes in a building must agree.
+//#define ENABLE_CRC7_TABLE // If defined, compute the 7-bit JSON/record CRC from a 256-byte PROGMEM table (with ENABLE_CRC7_TABLE_NIBBLE a 16-byte one) rather than bit by bit.
+//#define ENABLE_STATS_FRESHNESS // If defined, low-priority JSON stats are offered each frame by a score of age, change and per-key priority and filled to a byte budget, rather than all queued.
+//#define ENABLE_INEFFECTIVE_CALL_DETECT // If defined, a valve whose call for heat brings no temperature rise within a learned window nudges its valve and withholds the call from the boiler for a while before trying again.
+//#define ENABLE_RADIO_AUX_RX_RFM23B // If defined, a hub also receives on a second RFM23B (board pins RFM23B_AUX_nSS_PIN/RFM23B_AUX_IRQ_PIN) on another channel or carrier, merged into the same RX pipeline.
+//#define ENABLE_OCCUPANCY_CACHE // If defined, cache the occupancy tracker's vacancy hours and long-vacant flags at each minute update rather than recomputing them on every call.
+//#define ENABLE_HUB_SUMMARY // If defined, relay hubs send one compact summary frame of the node registry and boiler state upstream every HUB_SUMMARY_INTERVAL_M minutes.
+//#define ENABLE_HUB_SUMMARY_ONLY // If defined, with ENABLE_HUB_SUMMARY secure leaf stats frames are not also relayed individually.
+//#define ENABLE_JIT_PREHEAT // If defined, learn per-time-of-day room warm-up rates and start scheduled WARM periods just in time rather than a fixed pre-warm ahead.
+//#define ENABLE_FAST_SELF_TEST // If defined, POST runs all hardware checks overlapped and without the light show, reporting them as one JSON line (for production test).
+//#define ENABLE_CLI_IDLE_READ // If defined, the CLI sleeps the CPU between received characters (woken by the UART RX interrupt) instead of spinning while waiting for a command line.
+//#define ENABLE_RELAY_BACKLOG // If defined, relayed frames refused by the secondary radio (eg GSM link down) are held in RAM and retried with exponential backoff.
+//#define ENABLE_RX_REPEATER // If defined, always-listening non-hub nodes re-send secure valve/stats frames from associated senders for hubs out of their range.
+//#define ENABLE_NODE_REGISTRY // If defined, hubs keep the latest temperature, valve %, supply and occupancy from each secure sender in RAM, for +NOD.
+//#define ENABLE_VALVE_FIT_MEMORY // If defined, a local direct-drive valve that had calibrated recalibrates at once after a watchdog or brown-out reset rather than waiting to be signalled fitted.
+//#define ENABLE_RADIO_CONFIG_DELTAS // If defined, the dual-carrier RFM23B channels load only the registers that differ between OOK and GFSK when switching.
+//#define ENABLE_PERIPHERAL_POWER_REFS // If defined, PeripheralPower<> holds are reference counted so nested users share one power-up and the last out powers down.
+//#define ENABLE_DEVIRTUALISED_RADIO // If defined, an RFM23B primary radio is used directly rather than through an OTRadioLink reference, so calls bind statically; see the platformio *_Size envs.
+//#define ENABLE_RUNTIME_PROFILE // If defined, an EEPROM profile byte (+PFL) selects at boot which built-in roles (hub, sensor, relay, valve) run.
+//#define ENABLE_JITTER_XORSHIFT_RNG // If defined, TX slot and jitter choices use a per-node xorshift32 stream seeded once per boot rather than the per-minute re-seeded 8-bit PRNG.
+//#define ENABLE_TASK_SUPERVISOR // If defined, reset (noting the slot in EEPROM) when a slot task runs far over its declared budget.
+//#define ENABLE_EEPROM_WRITE_QUEUE // If defined, defer non-urgent EEPROM updates (overrun log, RTC persistence, settings, high-res stats) to idle time.
+//#define ENABLE_RELAY_JSON_FILTER // If defined, received JSON stats sent upstream (Serial or insecure relay) keep only allowlisted keys, some renamed shorter, rewritten in place.
+//#define ENABLE_FIXED_HEX_IDS // If defined, print node IDs as fixed-width (2 digits per byte) lower-case hex, from a per-sender cached string on hubs with ENABLE_RX_ASSOC_INDEX.
+//#define ENABLE_SENSOR_PIPELINE // If defined, read the regular sensors as split-phase start/collect stages, overlapping conversions with ADC reads, with slot budgets computed from the stage table.
+//#define ENABLE_HIRES_TIME // If defined, provide hiresTime(), a cheap 32-bit monotonic timestamp from the RTC sub-cycle and timer 0 counts, for instrumentation such as +BEN.
+//#define ENABLE_COOP_TASKS // If defined, long dumps (+EXP, +VML) run as stackless cooperative tasks in slices at the end of each minor cycle, with queued I/O handled between slices.
+//#define ENABLE_EVENT_BUS // If defined, sensors publish occupancy/pot change events to subscribers listed in flash, and the UI-tick target recompute runs only on such events.
+//#define ENABLE_BOILER_HUB_ZONES // If defined, a boiler hub also drives one output per zone (pins in BOILER_HUB_ZONE_OUT_PINS), zone picked by valve ID high byte.
+//#define ENABLE_BOILER_DEMAND_MODEL // If defined with ENABLE_BOILER_HUB_VALVE_TABLE, a boiler hub runs from weighted aggregate valve demand with start/hold hysteresis.
+//#define ENABLE_RX_DUP_FILTER // If defined, drop repeat copies of a received frame (eg from double TX) seen within a few seconds, before decoding.
+//#define ENABLE_TIME_SYNC_BEACON // If defined, hubs broadcast their RTC phase and per-leaf stats TX slots each minute and associated leaves lock to them.
+//#define ENABLE_BUTTON_EVENT_QUEUE // If defined, debounced MODE/LEARN presses are queued from pin-change interrupts and acted on at the next wake.
+//#define ENABLE_STATUS_REPORT_DEFERRED // If defined, print the periodic status line after the valve poll (time permitting) so the valve is not skipped for it.
+//#define ENABLE_BINARY_STATUS_RECORD // If defined, the '=' status line can be sent as a compact binary record instead (G 8 1 to select).
+//#define ENABLE_FHT8V_FAST_RESYNC // If defined, after a short loop overrun shift the FHT8V TX schedule to match rather than fully resyncing.
+//#define ENABLE_FHT8V_TABLE_DECODE // If defined, decode received FHT8V/FS20 bitstreams a nibble at a time from a small Flash table.
+//#define ENABLE_FHT8V_MULTI // If defined, drive FHT8V_EXTRA_VALVES more FHT8Vs (house codes set with G 2 .. G n in pairs) at the same % as the main one.
+//#define ENABLE_FHT8V_FRAME_CACHE // If defined, the periodic FHT8V TX frame rebuild is skipped when valve %, house codes and stats trailer are unchanged.
+//#define ENABLE_SECURE_TX_ACK // If defined, hubs acknowledge secure frames carrying a valve %, and leaves (with the hub's ID in their node associations) listen briefly after TX and resend once only if no ACK arrives, instead of blind double TX.
+//#define ENABLE_SECONDARY_TX_DEFERRED // If defined, stats for the secondary radio (eg slow blocking RN2483 LoRa) are held and sent from the end of a minor cycle with time to spare.
+//#define ENABLE_TX_PENDING_QUEUE // If defined, a stats or valve frame that fails to send is held and retried on later cycles, a newer frame of the same class replacing it.
+//#define ENABLE_RADIO_DUAL_CARRIER // If defined, OOK (FHT8V) builds add a GFSK channel for all framed/secure traffic, keeping OOK for FHT8V commands and FS20 stats, and hubs alternate listening between them.
+//#define ENABLE_RADIO_MULTI_CHANNEL // If defined, GFSK builds carry RADIO_MULTI_CHANNELS primary radio channels and each node uses the one set by G 1 (0..n-1, or 254 to pick by node ID).
+//#define ENABLE_RX_LINK_TABLE // If defined, hubs keep per-sender RSSI, last heard and loss estimates in the RX association index, for +LNK and the relay.
+//#define ENABLE_SECURE_VALVE_SHORT_FRAME // If defined, valves report a changed valve % between full stats in a short secure frame with a 16-byte body, and hubs accept it.
+//#define ENABLE_TX_COUNTER_RESERVATION // If defined, each secure TX restart counter value reserves a block of boots, so a boot costs one EEPROM bit clear.
+//#define ENABLE_RX_DECRYPT_SESSION // If defined, each handleQueuedMessages() call (batch, with ENABLE_RX_BATCH_DRAIN) fetches the key once for all secure frames and wipes it afterwards.
+//#define ENABLE_GHASH_TABLE // If defined, hubs keep a 256-byte per-key GHASH table in RAM for much faster secure frame authentication.
+//#define ENABLE_FAST_AES128 // If defined, use a faster, smaller-stack byte-oriented AES-128 core for all secure frame encryption/decryption.
+//#define ENABLE_SCRATCH_ARENA // If defined, put the big transient TX, RX and CLI buffers in one static arena rather than on the stack.
+//#define ENABLE_STACK_TAGS // If defined, record min stack pointer at named points on each heavy code path; shown by S and as stats key sH.
+//#define ENABLE_ISR_PROFILER // If defined, time the pin-change ISRs (incl radio RX FIFO read and filter) with timer 1; see +ISR.
+//#define ENABLE_RX_FRAME_CAPTURE // If defined, hubs write each raw received frame to Serial as a timestamped binary 'R' record, and +RXI replays one (see util/v0p2_rx_replay.py).
+//#define ENABLE_TX_PATH_BENCHMARK // If defined, time and stack-measure the stats encode/decode paths on the target; see +BEN.
+//#define ENABLE_VALVE_MOVE_PLANNER // If defined, hold back small DORM1 valve corrections (quantised, slope-aware deadband) and send the moves saved per day in stats as "vS".
+//#define ENABLE_EARLY_VALVE_POLL // If defined, poll the direct motor driver early in slots with no scheduled task so that motor run-time allowance does not depend on loop load.
+//#define ENABLE_DS18B20_ROM_CACHE // If defined, with ENABLE_DS18B20_SPLIT_CONVERSION discover DS18B20 ROM IDs once, keep them in EEPROM and address sensors directly rather than searching on each read.
+//#define ENABLE_BATCHED_ADC_READS // If defined, with ENABLE_COALESCED_SENSOR_READS also sample the temperature pot within the shared ADC power-up.
+//#define ENABLE_SHT21_SPLIT_CONVERSION // If defined, trigger the SHT21 temperature measurement (no-hold-master) in an earlier slot and fetch it in the temperature slot.
+//#define ENABLE_DS18B20_SPLIT_CONVERSION // If defined, start DS18B20 conversions in an earlier slot and collect the results in the temperature slot without waiting.
+//#define ENABLE_SCHEDULE_TRANSITION_CACHE // If defined, keep the next schedule on/off time in RAM and only apply the schedule when it is reached.
+//#define ENABLE_LAZY_TARGET_RECOMPUTE // If defined, skip the extra UI-driven target temperature recompute while none of its inputs has changed.
+//#define ENABLE_ENERGY_POLICY_LADDER // If defined, replace the single conserve-battery flag with normal/eco/deep/critical levels driven by supply and occupancy.
+//#define ENABLE_POST_ENTROPY // If defined, spend the POST light-show delays feeding clock jitter and ADC noise to the entropy pool.
+//#define ENABLE_FAST_BOOT // If defined, after a watchdog or brown-out reset of a previously-booted unit skip the POST light show to resume control quickly.
+//#define ENABLE_COALESCED_SENSOR_READS // If defined, read supply, light, humidity and temperature back-to-back in one slot with one ADC and one TWI power-up.
+//#define ENABLE_WINDOWED_RX_POLL // If defined, with ENABLE_CONTINUOUS_RX and no RFM23B nIRQ line, poll the radio slowly until a carrier or frame is seen, then fast for a short window.
+//#define ENABLE_CPU_CLOCK_BOOST // If defined, run the CPU at the full 8MHz RC clock for crypto and JSON bursts when the supply allows, instead of 1MHz.
+//#define ENABLE_BATTERY_LIFE_ESTIMATE // If defined, estimate days until the battery is empty from the supply voltage trend (and ENABLE_ENERGY_ACCOUNTING) and send it in stats as "bD|d".
+//#define ENABLE_ENERGY_ACCOUNTING // If defined, count awake ticks for CPU, radio RX/TX, serial, sensors and motor, and estimate mean current; see +NRG.
+//#define ENABLE_STATS_SET_UPLOAD // If defined, leaves slowly upload whole by-hour stats sets in secure frames, and hubs print them.
+//#define ENABLE_VALVE_MOVE_LOG // If defined, keep a small ring of valve movement events with inferred reason and motor run time; see +VML.
+//#define ENABLE_VALVE_MOVE_LOG_EEPROM // If defined with ENABLE_VALVE_MOVE_LOG, also keep valve movement events in EEPROM across restarts.
+//#define ENABLE_EEPROM_WEAR_STATS // If defined, count EEPROM writes per region, checkpoint them daily and project cell lifetime; see +EEW.
+//#define ENABLE_HIGH_RES_STATS_RING // If defined, keep 5-minute temperature/valve/occupancy samples for the last 48h in EEPROM; see +HRS.
+//#define ENABLE_BY_HOUR_STATS_AGGREGATE_CACHE // If defined, cache per-set min/max of by-hour stats in RAM until stats are next written.
+//#define ENABLE_BULK_STATS_EXPORT // If defined, +EXP streams all by-hour stats sets, ID and counters as CRC-protected binary records.
+//#define ENABLE_RTC_WEAR_LEVELLING // If defined, persist the RTC time of day to a 24-cell EEPROM ring rather than one cell.
+//#define ENABLE_NV_STATS_RAM_SHADOW // If defined, keep the current and previous hour of by-hour stats in RAM and write EEPROM once an hour.
+//#define ENABLE_SECURE_BEACON_PRECOMPUTE // If defined with ENABLE_SECURE_RADIO_BEACON, build the next beacon frame in an earlier slot so the beacon slot only sends.
+//#define ENABLE_FAST_START_STATS // If defined, send one stats frame after a random delay at boot rather than a burst, so mass restarts do not collide.
+//#define ENABLE_LINK_QUALITY_FEEDBACK // If defined, hubs (with ENABLE_RX_ASSOC_INDEX) broadcast per-node loss and leaves (with ENABLE_CONTINUOUS_RX, and the hub associated) listen for it to pick single/double TX.
+//#define ENABLE_ADAPTIVE_STATS_TX_RATE // If defined, stretch the stats TX interval while readings are stable and send promptly on significant change.
+//#define ENABLE_ADAPTIVE_TX_SLOT // If defined, pick stats TX slots from the node ID, listen before talk where possible, and back off after failed/busy TX.
+//#define ENABLE_OVERRUN_LOG // If defined, keep a small EEPROM ring of loop overrun records; see +OVR.
+//#define ENABLE_SLOT_PROFILER // If defined, profile sub-cycle ticks used by each loop slot, RX handling and CLI; see +PRF.
 
 #ifndef BAUD
 // Ensure that OpenTRV 'standard' UART speed is set unless explicitly overridden.
@@ -65,6 +187,222 @@ Author(s) / Copyright (s): Damon Hart-Davis 2013--2017
 // --------------------------------------------
 // Fixups to apply after loading the target config.
 #include <OTV0p2_valve_ENABLE_fixups.h>
+// Burst mode is for sensor-only leaves, and sleeps through the slots it skips.
+#if defined(ENABLE_SENSOR_BURST_MODE) && (defined(ENABLE_LOCAL_TRV) || defined(ENABLE_BOILER_HUB) || defined(ENABLE_CONTINUOUS_RX))
+#undef ENABLE_SENSOR_BURST_MODE
+#endif
+#if defined(ENABLE_SENSOR_BURST_MODE)
+#if !defined(ENABLE_SKIP_IDLE_SLOTS)
+#define ENABLE_SKIP_IDLE_SLOTS
+#endif
+#if !defined(ENABLE_COALESCED_SENSOR_READS)
+#define ENABLE_COALESCED_SENSOR_READS
+#endif
+#if !defined(ENABLE_BATCHED_ADC_READS)
+#define ENABLE_BATCHED_ADC_READS
+#endif
+#endif // ENABLE_SENSOR_BURST_MODE
+// The duty-cycle meter is in the RFM23B driver.
+#if defined(ENABLE_TX_DUTY_CYCLE) && !defined(ENABLE_RADIO_PRIMARY_RFM23B)
+#undef ENABLE_TX_DUTY_CYCLE
+#endif
+// Latency stats are of received frames, timed with hiresTime().
+#if defined(ENABLE_RELAY_LATENCY_STATS) && !defined(ENABLE_RADIO_RX)
+#undef ENABLE_RELAY_LATENCY_STATS
+#endif
+#if defined(ENABLE_RELAY_LATENCY_STATS) && !defined(ENABLE_HIRES_TIME)
+#define ENABLE_HIRES_TIME
+#endif
+// Voice power gating switches the REV14 sensor regulator.
+#if defined(ENABLE_VOICE_POWER_GATING) && (!defined(ENABLE_VOICE_SENSOR) || (V0p2_REV != 14))
+#undef ENABLE_VOICE_POWER_GATING
+#endif
+// The previous key is only of use to decode secure frames.
+#if defined(ENABLE_DUAL_RX_KEY) && !defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
+#undef ENABLE_DUAL_RX_KEY
+#endif
+// Only a boiler hub takes calls for heat.
+#if defined(ENABLE_CALL_FOR_HEAT_RING) && !defined(ENABLE_BOILER_HUB)
+#undef ENABLE_CALL_FOR_HEAT_RING
+#endif
+// The boiler hub checkpoint is of the local boiler on/off state.
+#if defined(ENABLE_BOILER_HUB_CHECKPOINT) && !defined(ENABLE_BOILER_HUB)
+#undef ENABLE_BOILER_HUB_CHECKPOINT
+#endif
+// Adaptive sampling follows the local valve model and replaces only the simple and batched sensor slots.
+#if defined(ENABLE_ADAPTIVE_SENSOR_SAMPLING) && (!defined(ENABLE_NOMINAL_RAD_VALVE) || defined(ENABLE_SENSOR_PIPELINE))
+#undef ENABLE_ADAPTIVE_SENSOR_SAMPLING
+#endif
+// The LoRa uplink packer is for the RN2483 and does its own batching, holding and deferral.
+#if defined(ENABLE_LORA_UPLINK_PACKER) && !defined(ENABLE_RADIO_SECONDARY_RN2483)
+#undef ENABLE_LORA_UPLINK_PACKER
+#endif
+#if defined(ENABLE_LORA_UPLINK_PACKER)
+#undef ENABLE_RELAY_BATCHING
+#undef ENABLE_RELAY_BACKLOG
+#undef ENABLE_SECONDARY_TX_DEFERRED
+#endif
+// Voice interrupt rate limiting only applies with the voice sensor.
+#if defined(ENABLE_VOICE_IRQ_RATE_LIMIT) && !defined(ENABLE_VOICE_SENSOR)
+#undef ENABLE_VOICE_IRQ_RATE_LIMIT
+#endif
+// The airtime meter reads RSSI from an RFM23B primary radio on a receiving hub.
+#if defined(ENABLE_CHANNEL_UTILISATION) && !(defined(ENABLE_RADIO_PRIMARY_RFM23B) && defined(ENABLE_RADIO_RX) && (defined(ENABLE_BOILER_HUB) || defined(ENABLE_STATS_RX)))
+#undef ENABLE_CHANNEL_UTILISATION
+#endif
+// The hardware packet options are applied over the GFSK config only.
+#if defined(ENABLE_RADIO_GFSK_HW_PACKET) && !(defined(ENABLE_RADIO_PRIMARY_RFM23B) && defined(ENABLE_FAST_FRAMED_CARRIER_SUPPORT))
+#undef ENABLE_RADIO_GFSK_HW_PACKET
+#endif
+// The building sync word needs the key, and a GFSK config that never reloads the sync registers after start-up.
+#if defined(ENABLE_RADIO_BUILDING_SYNC) && !(defined(ENABLE_RADIO_GFSK_HW_PACKET) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT))
+#undef ENABLE_RADIO_BUILDING_SYNC
+#endif
+// The radio has one sync word, so it cannot hear nodes on both the old and new key
+// while the previous key is held; dual-key re-keying wins.
+#if defined(ENABLE_RADIO_BUILDING_SYNC) && defined(ENABLE_DUAL_RX_KEY)
+#undef ENABLE_RADIO_BUILDING_SYNC
+#endif
+// Ineffective-call detection watches the local modelled valve.
+#if defined(ENABLE_INEFFECTIVE_CALL_DETECT) && !defined(ENABLE_NOMINAL_RAD_VALVE)
+#undef ENABLE_INEFFECTIVE_CALL_DETECT
+#endif
+// The auxiliary receiver needs its own select pin and an RX build on the primary RFM23B;
+// copies heard by both radios are dropped by the duplicate filter.
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B) && !(defined(RFM23B_AUX_nSS_PIN) && defined(ENABLE_RADIO_RX) && defined(ENABLE_RADIO_PRIMARY_RFM23B))
+#undef ENABLE_RADIO_AUX_RX_RFM23B
+#endif
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B) && !defined(ENABLE_RX_DUP_FILTER)
+#define ENABLE_RX_DUP_FILTER
+#endif
+// Just-in-time pre-heat adjusts the schedule for a locally-modelled valve.
+#if defined(ENABLE_JIT_PREHEAT) && !(defined(ENABLE_SINGLETON_SCHEDULE) && defined(ENABLE_NOMINAL_RAD_VALVE))
+#undef ENABLE_JIT_PREHEAT
+#endif
+// The backlog is of frames relayed over the secondary radio.
+#if defined(ENABLE_RELAY_BACKLOG) && !defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+#undef ENABLE_RELAY_BACKLOG
+#endif
+// A repeater must be listening all the time to hear what it repeats.
+#if defined(ENABLE_RX_REPEATER) && !(defined(ENABLE_RADIO_RX) && defined(ENABLE_CONTINUOUS_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT))
+#undef ENABLE_RX_REPEATER
+#endif
+// The node registry is fed from the secure RX path.
+#if defined(ENABLE_NODE_REGISTRY) && !(defined(ENABLE_RADIO_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT))
+#undef ENABLE_NODE_REGISTRY
+#endif
+// The occupancy cache wraps the real (not dummy) tracker.
+#if defined(ENABLE_OCCUPANCY_CACHE) && !defined(ENABLE_OCCUPANCY_SUPPORT)
+#undef ENABLE_OCCUPANCY_CACHE
+#endif
+// The hub summary is built from the node registry and sent over the relay.
+#if defined(ENABLE_HUB_SUMMARY) && !(defined(ENABLE_NODE_REGISTRY) && defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY))
+#undef ENABLE_HUB_SUMMARY
+#endif
+#if defined(ENABLE_HUB_SUMMARY_ONLY) && !defined(ENABLE_HUB_SUMMARY)
+#undef ENABLE_HUB_SUMMARY_ONLY
+#endif
+// Fit memory is for the local direct-drive valve only.
+#if defined(ENABLE_VALVE_FIT_MEMORY) && !(defined(ENABLE_V1_DIRECT_MOTOR_DRIVE) && defined(ENABLE_LOCAL_TRV))
+#undef ENABLE_VALVE_FIT_MEMORY
+#endif
+// The JSON filter lives with the secure RX code.
+#if defined(ENABLE_RELAY_JSON_FILTER) && !(defined(ENABLE_RADIO_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT))
+#undef ENABLE_RELAY_JSON_FILTER
+#endif
+// The sensor pipeline replaces the coalesced sensor slot, pot included.
+#if defined(ENABLE_SENSOR_PIPELINE)
+#if !defined(ENABLE_COALESCED_SENSOR_READS)
+#define ENABLE_COALESCED_SENSOR_READS
+#endif
+#if !defined(ENABLE_BATCHED_ADC_READS)
+#define ENABLE_BATCHED_ADC_READS
+#endif
+#endif // ENABLE_SENSOR_PIPELINE
+// Zone outputs follow the boiler hub.
+#if defined(ENABLE_BOILER_HUB_ZONES) && !defined(ENABLE_BOILER_HUB)
+#undef ENABLE_BOILER_HUB_ZONES
+#endif
+// The demand model works from the per-valve table.
+#if defined(ENABLE_BOILER_DEMAND_MODEL) && !(defined(ENABLE_BOILER_HUB) && defined(ENABLE_BOILER_HUB_VALVE_TABLE))
+#undef ENABLE_BOILER_DEMAND_MODEL
+#endif
+// The time sync is a secure frame that leaves must be able to listen for.
+#if defined(ENABLE_TIME_SYNC_BEACON) && !(defined(ENABLE_RADIO_RX) && defined(ENABLE_CONTINUOUS_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT))
+#undef ENABLE_TIME_SYNC_BEACON
+#endif
+// Button events only feed the local valve UI.
+#if defined(ENABLE_BUTTON_EVENT_QUEUE) && (!defined(ENABLE_LOCAL_TRV) || defined(NO_UI_SUPPORT) || !defined(BUTTON_MODE_L))
+#undef ENABLE_BUTTON_EVENT_QUEUE
+#endif
+// Extra FHT8Vs need the main FHT8V support.
+#if defined(ENABLE_FHT8V_MULTI) && !defined(ENABLE_FHT8VSIMPLE)
+#undef ENABLE_FHT8V_MULTI
+#endif
+// ACKs are secure frames, and both ends must be able to receive.
+#if defined(ENABLE_SECURE_TX_ACK) && !(defined(ENABLE_RADIO_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT))
+#undef ENABLE_SECURE_TX_ACK
+#endif
+// Remote diagnostics requests ride on the hub's ACKs, when the leaf is listening.
+#if defined(ENABLE_REMOTE_DIAG) && !defined(ENABLE_SECURE_TX_ACK)
+#undef ENABLE_REMOTE_DIAG
+#endif
+// Stats key subscriptions also ride on the hub's ACKs.
+#if defined(ENABLE_STATS_KEY_SUBSCRIPTION) && !defined(ENABLE_SECURE_TX_ACK)
+#undef ENABLE_STATS_KEY_SUBSCRIPTION
+#endif
+// Deferred secondary TX needs a secondary radio.
+#if defined(ENABLE_SECONDARY_TX_DEFERRED) && !defined(ENABLE_RADIO_SECONDARY_MODULE)
+#undef ENABLE_SECONDARY_TX_DEFERRED
+#endif
+// The dual-carrier config pairs the OOK FHT8V channel with GFSK on the RFM23B.
+#if defined(ENABLE_RADIO_DUAL_CARRIER) && !(defined(ENABLE_RADIO_PRIMARY_RFM23B) && defined(ENABLE_FHT8VSIMPLE) && !defined(ENABLE_FAST_FRAMED_CARRIER_SUPPORT))
+#undef ENABLE_RADIO_DUAL_CARRIER
+#endif
+// The carrier-switch deltas are computed between the dual-carrier pair only.
+#if defined(ENABLE_RADIO_CONFIG_DELTAS) && !defined(ENABLE_RADIO_DUAL_CARRIER)
+#undef ENABLE_RADIO_CONFIG_DELTAS
+#endif
+// Extra channels are only defined for the GFSK RFM23B config.
+#if defined(ENABLE_RADIO_MULTI_CHANNEL) && !(defined(ENABLE_RADIO_PRIMARY_RFM23B) && defined(ENABLE_FAST_FRAMED_CARRIER_SUPPORT))
+#undef ENABLE_RADIO_MULTI_CHANNEL
+#endif
+// The per-sender link table lives in the RX association index.
+#if defined(ENABLE_RX_LINK_TABLE) && !(defined(ENABLE_RX_ASSOC_INDEX) && defined(ENABLE_RADIO_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT))
+#undef ENABLE_RX_LINK_TABLE
+#endif
+// On-board diagnostics are reported through the extended CLI so ensure that it is present.
+#if (defined(ENABLE_SLOT_PROFILER) || defined(ENABLE_OVERRUN_LOG) || defined(ENABLE_BULK_STATS_EXPORT) || defined(ENABLE_HIGH_RES_STATS_RING) || defined(ENABLE_EEPROM_WEAR_STATS) || defined(ENABLE_VALVE_MOVE_LOG) || defined(ENABLE_ENERGY_ACCOUNTING) || defined(ENABLE_TX_PATH_BENCHMARK) || defined(ENABLE_RX_FRAME_CAPTURE) || defined(ENABLE_ISR_PROFILER) || defined(ENABLE_RX_LINK_TABLE) || defined(ENABLE_RUNTIME_PROFILE) || defined(ENABLE_NODE_REGISTRY) || defined(ENABLE_REMOTE_DIAG) || defined(ENABLE_STATS_KEY_SUBSCRIPTION) || defined(ENABLE_RELAY_LATENCY_STATS)) && !defined(ENABLE_EXTENDED_CLI)
+#define ENABLE_EXTENDED_CLI
+#endif
+// Link-quality feedback needs secure RX, with leaves able to turn on the receiver to hear it;
+// only hubs also need the RX association index (which tracks per-node counters) to send it.
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK) && !(defined(ENABLE_RADIO_RX) && defined(ENABLE_CONTINUOUS_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT))
+#undef ENABLE_LINK_QUALITY_FEEDBACK
+#endif
+// The RX decryption session only applies to secure RX.
+#if defined(ENABLE_RX_DECRYPT_SESSION) && !(defined(ENABLE_RADIO_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT))
+#undef ENABLE_RX_DECRYPT_SESSION
+#endif
+// The GHASH table is only worth its RAM on nodes receiving secure frames (ie hubs), and is built around the fast AES core.
+#if defined(ENABLE_GHASH_TABLE) && !defined(ENABLE_RADIO_RX)
+#undef ENABLE_GHASH_TABLE
+#endif
+#if defined(ENABLE_GHASH_TABLE) && !defined(ENABLE_FAST_AES128)
+#define ENABLE_FAST_AES128
+#endif
+// The short valve frame is secure-only.
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME) && !defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
+#undef ENABLE_SECURE_VALVE_SHORT_FRAME
+#endif
+// Stats set upload rides in secure frames.
+#if defined(ENABLE_STATS_SET_UPLOAD) && !defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
+#undef ENABLE_STATS_SET_UPLOAD
+#endif
+// The valve movement log watches the local modelled valve.
+#if defined(ENABLE_VALVE_MOVE_LOG) && !defined(ENABLE_NOMINAL_RAD_VALVE)
+#undef ENABLE_VALVE_MOVE_LOG
+#endif
 
 #include <OTV0p2_Board_IO_Config.h> // I/O pin allocation and setup: include ahead of I/O module headers.
 
@@ -97,17 +435,597 @@ void panic(const __FlashStringHelper *s);
 // NOTE: implementation may not be in power-management module.
 bool pollIO(bool force = false);
 
+// The minor cycle (main loop tick) is set by the library RTC: OTV0P2BASE::MAIN_TICK_S seconds,
+// 2 with V0P2BASE_TWO_S_TICK_RTC_SUPPORT (the default, fewer wakeups for battery leaves) else 1 (lower latency for hubs).
+// Slots are keyed on seconds (TIME_LSD) and everything counted in ticks here is derived from MAIN_TICK_S,
+// so the sketch builds correctly for either; only even-second slots run with the 2s tick.
+static_assert(0 == (60 % OTV0P2BASE::MAIN_TICK_S), "minor cycle must divide the minute");
+static constexpr uint8_t MAIN_TICKS_PER_MINUTE = 60 / OTV0P2BASE::MAIN_TICK_S;
+
+// Application-private EEPROM, in the space left free by OTV0P2BASE
+// after the raw-inspectable area and before the TX restart counters.
+// Blocks are allocated one after another from the library constants so that they cannot overlap
+// each other or library-owned bytes, whichever features are enabled; the compiler checks the fit.
+// Only ever append to the end, so that data already on deployed units stays where it is.
+static constexpr intptr_t V0P2_EE_START_APP_PRIVATE = OTV0P2BASE::V0P2BASE_EE_END_RAW_INSPECTABLE + 1;
+// Overrun log (ENABLE_OVERRUN_LOG).
+static constexpr intptr_t V0P2_EE_START_OVERRUN_LOG = V0P2_EE_START_APP_PRIVATE;
+static constexpr uint8_t V0P2_EE_OVERRUN_LOG_RECORD_SIZE = 4;
+static constexpr uint8_t V0P2_EE_OVERRUN_LOG_RECORDS = 4; // Power of two.
+// RTC log (ENABLE_RTC_WEAR_LEVELLING).
+static constexpr intptr_t V0P2_EE_START_RTC_LOG = V0P2_EE_START_OVERRUN_LOG + V0P2_EE_OVERRUN_LOG_RECORD_SIZE * V0P2_EE_OVERRUN_LOG_RECORDS;
+static constexpr uint8_t V0P2_EE_LEN_RTC_LOG = 24; // One cell per hour.
+// Valve-fitted mark (ENABLE_VALVE_FIT_MEMORY).
+static constexpr intptr_t V0P2_EE_START_VALVE_FITTED = V0P2_EE_START_RTC_LOG + V0P2_EE_LEN_RTC_LOG;
+// Just-in-time pre-heat learned rates (ENABLE_JIT_PREHEAT).
+static constexpr intptr_t V0P2_EE_START_JIT_RATES = V0P2_EE_START_VALVE_FITTED + 1;
+static constexpr uint8_t V0P2_EE_JIT_RATES_SIZE = 12;
+// Run-time feature profile (ENABLE_RUNTIME_PROFILE).
+static constexpr intptr_t V0P2_EE_START_FEATURE_PROFILE = V0P2_EE_START_JIT_RATES + V0P2_EE_JIT_RATES_SIZE;
+// Stats storage format mark (ENABLE_PACKED_NV_STATS); 0xff (erased) means the original byte format.
+static constexpr intptr_t V0P2_EE_START_STATS_FORMAT = V0P2_EE_START_FEATURE_PROFILE + 1;
+// First byte after the application-private blocks.
+static constexpr intptr_t V0P2_EE_END_APP_PRIVATE = V0P2_EE_START_STATS_FORMAT + 1;
+static_assert(V0P2_EE_START_APP_PRIVATE > OTV0P2BASE::V0P2BASE_EE_END_RAW_INSPECTABLE, "app EEPROM overlaps raw-inspectable area");
+static_assert(V0P2_EE_END_APP_PRIVATE <= OTV0P2BASE::VOP2BASE_EE_START_PERSISTENT_MSG_RESTART_CTR, "app EEPROM overlaps TX restart counters");
+static_assert(V0P2_EE_START_FEATURE_PROFILE != V0P2BASE_EE_START_RTC_RESERVED, "feature profile must not share the library's RTC byte");
+
+// Application-private bytes at the top of the OTV0P2BASE radio config area, which the library reserves but does not use,
+// allocated downwards from V0P2BASE_EE_END_RADIO.
+// Boiler hub checkpoint (ENABLE_BOILER_HUB_CHECKPOINT), 3 bytes.
+static constexpr intptr_t V0P2_EE_START_BOILER_CHECKPOINT = OTV0P2BASE::V0P2BASE_EE_END_RADIO - 2;
+// Stats key subscription bitmap (ENABLE_STATS_KEY_SUBSCRIPTION).
+static constexpr intptr_t V0P2_EE_START_STATS_SUBSCRIPTION = V0P2_EE_START_BOILER_CHECKPOINT - 1;
+// Lowest byte claimed from the radio config area.
+static constexpr intptr_t V0P2_EE_START_RADIO_APP = V0P2_EE_START_STATS_SUBSCRIPTION;
+static_assert(V0P2_EE_START_RADIO_APP > OTV0P2BASE::V0P2BASE_EE_START_RADIO, "app bytes must leave the start of the radio config area to the library");
+static_assert(V0P2_EE_START_RADIO_APP >= V0P2_EE_END_APP_PRIVATE, "radio config area bytes overlap app-private EEPROM");
+
+// Roles of a node, as selected by the feature profile and tagged on slot tasks.
+static constexpr uint8_t PROFILE_HUB = 1; // Boiler/stats hub listening and hub broadcasts.
+static constexpr uint8_t PROFILE_SENSOR = 2; // Periodic stats TX.
+static constexpr uint8_t PROFILE_RELAY = 4; // Relay over the secondary radio.
+static constexpr uint8_t PROFILE_VALVE = 8; // Local valve drive.
+#if defined(ENABLE_RUNTIME_PROFILE)
+// Run-time feature profile, so that one image per board can be deployed in several roles.
+// A mask of the PROFILE_XXX roles (of those built in) to run, read once at boot;
+// erased 0xff runs everything built in, as without the profile.
+// Disabled roles' slot tasks are skipped (and slept through with ENABLE_SKIP_IDLE_SLOTS).
+// Kept in its own app-private EEPROM byte (V0P2_EE_START_FEATURE_PROFILE); set with +PFL, applied at next boot.
+// Any mask of the PROFILE_XXX bits, or 255.
+static constexpr uint8_t PROFILE_ALL_ROLES = PROFILE_HUB | PROFILE_SENSOR | PROFILE_RELAY | PROFILE_VALVE;
+extern uint8_t featureProfile;
+// True if all the given roles are enabled.
+inline bool profileHas(const uint8_t roles) { return(roles == (featureProfile & roles)); }
+// Load the profile and derive the active slot tasks; call once early in setup().
+void loadFeatureProfile();
+#else
+#define profileHas(roles) (true)
+#define loadFeatureProfile() {}
+#endif // ENABLE_RUNTIME_PROFILE
+
 
 ////// MESSAGING
 
+// 7-bit (0x5B) CRC update as OTV0P2BASE::crc7_5B_update(), used for plaintext JSON frames and binary records.
+// The table forms give identical results: the full table costs 256 bytes of flash for one lookup per byte,
+// the nibble table 16 bytes for two; see +BEN (ENABLE_TX_PATH_BENCHMARK) for cycles per byte.
+#if defined(ENABLE_CRC7_TABLE) && defined(ENABLE_CRC7_TABLE_NIBBLE)
+// Register left-aligned in 8 bits: entry n is top nibble n shifted through 4 steps of polynomial 0x37<<1.
+extern const uint8_t crc7_5B_nibbleTable[16] PROGMEM;
+inline uint8_t crc7Update(const uint8_t crc, const uint8_t datum)
+  {
+  uint8_t r = (uint8_t)(crc << 1) ^ datum;
+  r = (uint8_t)(r << 4) ^ pgm_read_byte(crc7_5B_nibbleTable + (r >> 4));
+  r = (uint8_t)(r << 4) ^ pgm_read_byte(crc7_5B_nibbleTable + (r >> 4));
+  return(r >> 1);
+  }
+#elif defined(ENABLE_CRC7_TABLE)
+// Entry i is crc7_5B_update(0, i); the CRC and datum combine as (crc << 1) ^ datum.
+extern const uint8_t crc7_5B_table[256] PROGMEM;
+inline uint8_t crc7Update(const uint8_t crc, const uint8_t datum)
+  { return(pgm_read_byte(crc7_5B_table + (uint8_t)((uint8_t)(crc << 1) ^ datum))); }
+#else
+#define crc7Update(crc, datum) OTV0P2BASE::crc7_5B_update((crc), (datum))
+#endif // ENABLE_CRC7_TABLE
+#if defined(ENABLE_CRC7_TABLE)
+// As OTV0P2BASE::checkJSONMsgRXCRC() but with crc7Update().
+int8_t checkJSONRXCRC(const uint8_t *bptr, uint8_t bufLen);
+#else
+#define checkJSONRXCRC(bptr, bufLen) OTV0P2BASE::checkJSONMsgRXCRC((bptr), (bufLen))
+#endif // ENABLE_CRC7_TABLE
+
+#ifdef ENABLE_RADIO_RFM23B
+// The RX queue size is the guaranteed number of max-size frames;
+// OTRFM23BLink already packs length-prefixed frames into one byte ring (ISRRXQueueVarLenMsg)
+// so several times as many short frames fit during bursts,
+// provided that the frame length is right when queued:
+// packet-handler mode reports the true length, and FilterRXISR() trims OOK/FS20 frames.
+#if defined(ENABLE_TRIMMED_MEMORY) && !defined(ENABLE_DEFAULT_ALWAYS_RX) && !defined(ENABLE_CONTINUOUS_RX)
+static constexpr uint8_t RFM23B_RX_QUEUE_SIZE = OTV0P2BASE::fnmax(uint8_t(2), uint8_t(OTRFM23BLink::DEFAULT_RFM23B_RX_QUEUE_CAPACITY)) - 1;
+#else
+static constexpr uint8_t RFM23B_RX_QUEUE_SIZE = OTRFM23BLink::DEFAULT_RFM23B_RX_QUEUE_CAPACITY;
+#endif
+#if defined(PIN_RFM_NIRQ)
+static constexpr int8_t RFM23B_IRQ_PIN = PIN_RFM_NIRQ;
+#else
+static constexpr int8_t RFM23B_IRQ_PIN = -1;
+#endif
+#if defined(ENABLE_RADIO_RX)
+static constexpr bool RFM23B_allowRX = true;
+#else
+static constexpr bool RFM23B_allowRX = false;
+#endif
+#if !defined(ENABLE_RFM23B_SLEEPY_TX)
+typedef OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, RFM23B_IRQ_PIN, RFM23B_RX_QUEUE_SIZE, RFM23B_allowRX> RFM23BUnmetered_t;
+#else
+typedef OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, RFM23B_IRQ_PIN, RFM23B_RX_QUEUE_SIZE, RFM23B_allowRX> RFM23BBase_t;
+// RFM23B whose sendRaw() naps the CPU through each frame's airtime rather than spinning at 1MHz,
+// woken early by the packet-sent interrupt on nIRQ if wired, else checking status each 15ms nap.
+// Otherwise sends exactly as the library does, including the second copy for TXmax.
+// Registers are accessed directly over SPI as the library's accessors are private to its concrete class.
+class RFM23BSleepyTX : public RFM23BBase_t
+  {
+  private:
+    // True while a TX is waiting for the packet-sent interrupt, which the ISR then only notes.
+    volatile bool txWaiting = false;
+    volatile bool txSent = false;
+    // Upper bound on one frame's airtime in 15ms naps, as the library's MAX_TX_ms.
+    static constexpr uint8_t MAX_TX_NAPS = (MAX_TX_ms + 14) / 15;
+    // Single register access, SPI already up.
+    static uint8_t readReg(uint8_t addr);
+    static void writeReg(uint8_t addr, uint8_t val);
+    // Standby with FIFOs, interrupt enables and pending interrupts cleared.
+    static void standbyAndClear();
+    // Transmit the TX FIFO contents, napping until sent; true if the RFM23B reported the packet sent.
+    bool napTXFIFO();
+  public:
+    virtual bool handleInterruptSimple() override
+      {
+      if(txWaiting) { txSent = true; return(true); }
+      return(RFM23BBase_t::handleInterruptSimple());
+      }
+    virtual bool sendRaw(const uint8_t *buf, uint8_t buflen, int8_t channel = 0, TXpower power = TXnormal, bool listenAfter = false) override;
+  };
+typedef RFM23BSleepyTX RFM23BUnmetered_t;
+#endif // !defined(ENABLE_RFM23B_SLEEPY_TX)
+#if defined(ENABLE_TX_DUTY_CYCLE)
+// Regulatory TX duty-cycle accounting (typically 1% in the 868.0--868.6MHz sub-band) over a rolling hour
+// of TX_DUTY_SLOTS 10-minute slots, from each frame's length and channel bit rate.
+// As the budget nears, double TX (TXmax) is cut to one copy, the repeat being the lowest-value airtime;
+// a frame that would exceed it is refused, as callers already handle (counted, retried or resent later).
+// The last TX_DUTY_RESERVE_MS is kept for critical frames, sent within a TXDutyCritical scope,
+// so that stats, relays and beacons are refused first and valves are still driven.
+#ifndef TX_DUTY_BUDGET_MS
+#define TX_DUTY_BUDGET_MS 36000U // Per hour: 1%.
+#endif
+static constexpr uint16_t TX_DUTY_RESERVE_MS = TX_DUTY_BUDGET_MS / 8;
+static constexpr uint8_t TX_DUTY_SLOTS = 6;
+// Non-zero while TX may use the reserve.
+extern uint8_t txDutyCriticalDepth;
+// While in scope, and if active, TX (eg FHT8V valve commands and a valve's call for heat) may use the reserve.
+class TXDutyCritical final
+  {
+  private:
+    const bool active;
+  public:
+    explicit TXDutyCritical(const bool a = true) : active(a) { if(active) { ++txDutyCriticalDepth; } }
+    ~TXDutyCritical() { if(active) { --txDutyCriticalDepth; } }
+    TXDutyCritical(const TXDutyCritical &) = delete;
+    TXDutyCritical &operator=(const TXDutyCritical &) = delete;
+  };
+// Check a TX of buflen bytes on channel against the budget, possibly reducing power to TXnormal,
+// and charge its airtime; false if it must not be sent.
+bool txDutyAdmit(uint8_t buflen, int8_t channel, OTRadioLink::OTRadioLink::TXpower &power);
+// TX airtime (ms) charged in the last hour, and frames refused since boot (saturating).
+uint16_t txDutyUsedMs();
+extern uint8_t txDutyRefused;
+// Call once per minute.
+void txDutyMinuteTick();
+// Print "TXD usedMs budgetMs refused" line to Serial.
+void printTXDuty();
+// RFM23B driver with every TX (including queueToSend()) metered against the duty-cycle budget.
+template<class Base> class RFM23BDutyCycled final : public Base
+  {
+  public:
+    virtual bool sendRaw(const uint8_t *buf, uint8_t buflen, int8_t channel = 0, OTRadioLink::OTRadioLink::TXpower power = OTRadioLink::OTRadioLink::TXnormal, bool listenAfter = false) override
+      {
+      if(!txDutyAdmit(buflen, channel, power)) { return(false); }
+      return(Base::sendRaw(buf, buflen, channel, power, listenAfter));
+      }
+  };
+typedef RFM23BDutyCycled<RFM23BUnmetered_t> RFM23B_t;
+#else
+typedef RFM23BUnmetered_t RFM23B_t;
+#endif // ENABLE_TX_DUTY_CYCLE
+extern RFM23B_t RFM23B;
+#endif // ENABLE_RADIO_RFM23B
+#if !(defined(ENABLE_RADIO_RFM23B) && defined(ENABLE_TX_DUTY_CYCLE))
+// No-op stand-in so that call sites need no conditionals.
+class TXDutyCritical final { public: explicit TXDutyCritical(bool = true) { } };
+#endif
+
 #ifdef ENABLE_RADIO_PRIMARY_MODULE
+#if defined(ENABLE_DEVIRTUALISED_RADIO) && defined(ENABLE_RADIO_PRIMARY_RFM23B)
+// Name the concrete object rather than go through a base-class reference,
+// so that the compiler can bind PrimaryRadio calls statically (and inline them with LTO).
+#define PrimaryRadio RFM23B
+#else
 extern OTRadioLink::OTRadioLink &PrimaryRadio;
+#endif
 #endif // ENABLE_RADIO_PRIMARY_MODULE
 
+#if defined(ENABLE_RADIO_MULTI_CHANNEL)
+// Number of primary radio channels, all within the 868.0--868.6MHz sub-band; 2 or 3.
+#ifndef RADIO_MULTI_CHANNELS
+#define RADIO_MULTI_CHANNELS 3
+#endif
+// Channel selection, stored in the raw inspectable EEPROM area so it can be set with G 1 n.
+// 0..RADIO_MULTI_CHANNELS-1 fixes the channel, V0P2_RADIO_CHANNEL_BY_ID picks one from the node ID,
+// anything else (eg erased 0xff) is channel 0 as for single-channel builds.
+// Hubs hear only their own channel, so deploy one hub per channel in use.
+static constexpr intptr_t V0P2_EE_START_RADIO_CHANNEL = OTV0P2BASE::V0P2BASE_EE_START_RAW_INSPECTABLE + 1;
+static constexpr uint8_t V0P2_RADIO_CHANNEL_BY_ID = 254;
+// Primary radio channel for all TX and RX; read from EEPROM each call so G 1 takes effect at once.
+int8_t primaryRadioChannel();
+#elif defined(ENABLE_RADIO_DUAL_CARRIER)
+// Channel 0 is OOK, used for FHT8V commands and raw FS20-style stats;
+// all other (framed) traffic goes on the GFSK channel.
+static constexpr int8_t RADIO_OOK_CHANNEL = 0;
+inline int8_t primaryRadioChannel() { return(1); }
+#else
+inline int8_t primaryRadioChannel() { return(0); }
+#endif // ENABLE_RADIO_MULTI_CHANNEL
+
+#if defined(ENABLE_RADIO_AUX_RX_RFM23B)
+// Second, RX-only RFM23B sharing the SPI bus, with the same channel configs as the primary.
+// Polled from pollIO(); its nIRQ need not be wired (RFM23B_AUX_IRQ_PIN -1),
+// else it must be on port B (digital 8--13) with the primary's, and is handled in the same pin change ISR.
+// Its nSS is driven high at the very start of setup() so that it never answers on the bus meanwhile.
+#if !defined(RFM23B_AUX_IRQ_PIN)
+#define RFM23B_AUX_IRQ_PIN -1
+#endif
+#if RFM23B_AUX_IRQ_PIN >= 0
+#if (RFM23B_AUX_IRQ_PIN < 8) || (RFM23B_AUX_IRQ_PIN > 13)
+#error RFM23B_AUX_IRQ_PIN must be on port B (8--13), or -1 to poll
+#endif
+#define RFM23B_AUX_INT_MASK (1 << (RFM23B_AUX_IRQ_PIN - 8)) // PB/PCMSK0 bit.
+#endif
+typedef OTRFM23BLink::OTRFM23BLink<RFM23B_AUX_nSS_PIN, RFM23B_AUX_IRQ_PIN, RFM23B_RX_QUEUE_SIZE, true> RFM23BAux_t;
+extern RFM23BAux_t RFM23BAux;
+// Channel the auxiliary receiver listens on, unless fixed with RFM23B_AUX_CHANNEL:
+// the OOK carrier for dual-carrier builds (so the primary can stay on GFSK),
+// the next channel up for multi-channel builds (so one hub covers two),
+// else the primary's own channel for receive diversity.
+#if defined(RFM23B_AUX_CHANNEL)
+inline int8_t auxRadioChannel() { return(RFM23B_AUX_CHANNEL); }
+#elif defined(ENABLE_RADIO_MULTI_CHANNEL)
+inline int8_t auxRadioChannel() { return((primaryRadioChannel() + 1) % RADIO_MULTI_CHANNELS); }
+#elif defined(ENABLE_RADIO_DUAL_CARRIER)
+inline int8_t auxRadioChannel() { return(RADIO_OOK_CHANNEL); }
+#else
+inline int8_t auxRadioChannel() { return(0); }
+#endif
+#endif // ENABLE_RADIO_AUX_RX_RFM23B
+
+#if defined(ENABLE_TUNE_FAST_OSC_TO_RTC_SOURCE) && defined(ENABLE_WAKEUP_32768HZ_XTAL)
+// Measure the internal RC oscillator against the 32768Hz crystal and nudge OSCCAL one step towards nominal
+// up to maxSteps times, stopping once within about 0.4%; returns true if then within tolerance.
+// Blocks interrupts for ~16ms per step, so call from a quiet slot and not while the radio is listening;
+// not while CPUClockBoost is active. Powers Timer 0 for the measurement if need be.
+bool tuneFastOscToRTC(uint8_t maxSteps);
+#endif
+
+#if defined(ENABLE_DEFERRED_INIT)
+// Bits for start-up work that setup() leaves for later.
+// The secondary radio is still preinit()ed and its power pins set in setup(), as it can draw a lot until then;
+// only its slow begin() (seconds for a SIM900 or RN2483) is deferred, to DEFERRED_INIT_RADIO_LSD,
+// and until it is done the secondary radio is treated as refusing sends (held or dropped as for a full driver queue).
+static constexpr uint8_t DI_SECONDARY_RADIO = 1; // Secondary radio begin.
+static constexpr uint8_t DI_STATUS_REPORT = 2; // Boot status line and CLI prompt.
+// Otherwise idle slot for the deferred secondary radio begin(), so that its once-only overrun disturbs nothing else.
+static constexpr uint8_t DEFERRED_INIT_RADIO_LSD = 36;
+// Bits still to be done.
+extern uint8_t deferredInitPending;
+// Do the given pending initialisation now.
+void deferredInitRun(uint8_t what);
+inline bool deferredInitDone(const uint8_t what) { return(0 == (deferredInitPending & what)); }
+// Call once per minor cycle after time-critical work;
+// does the next pending initialisation, other than DI_SECONDARY_RADIO, if at least half the cycle remains.
+void deferredInitTick();
+#else
+#define deferredInitDone(what) (true)
+#define deferredInitTick() {}
+#endif // ENABLE_DEFERRED_INIT
+
+#if defined(ENABLE_RELAY_LATENCY_STATS)
+// Where time goes between a frame arriving and it being handed on, timed with hiresTime():
+//   LAT_RX_WAIT     primary radio interrupt queueing the first frame of a burst, to its decode starting
+//   LAT_DECODE      decodeAndHandleRawRXedMessage() for each frame
+//   LAT_RELAY_HOLD  the oldest relayed frame waiting (eg batched, backlogged or duty-cycle held) until the secondary radio takes it
+enum latencyStage_t : uint8_t { LAT_RX_WAIT, LAT_DECODE, LAT_RELAY_HOLD, LAT_STAGES };
+// Record a latency for stage s from hiresTime() value start to now.
+void latencyRecord(latencyStage_t s, uint32_t start);
+// From the primary radio ISR when its RX queue goes from empty to non-empty.
+void latencyRXQueued();
+// At the start of decoding a frame from the primary radio; records any RX wait and returns hiresTime().
+uint32_t latencyRXDecodeStart();
+// When a frame is handed to relayFrame(), and when the secondary radio accepts held frames
+// (with anyStillHeld true if some are still waiting).
+void latencyRelayTaken();
+void latencyRelaySent(bool anyStillHeld);
+// When held frames are dropped unsent, eg for lack of room or a refused send, so are not timed.
+void latencyRelayDropped(bool anyStillHeld);
+// Print "LAT stage n meanUs maxUs" lines to Serial: +LAT, or clear with +LAT Z.
+void latencyDump();
+void latencyReset();
+#else
+#define latencyRelayTaken() {}
+#define latencyRelaySent(anyStillHeld) {}
+#define latencyRelayDropped(anyStillHeld) {}
+#endif // ENABLE_RELAY_LATENCY_STATS
+
 #ifdef ENABLE_RADIO_SECONDARY_MODULE
 extern OTRadioLink::OTRadioLink &SecondaryRadio;
+#if defined(ENABLE_LORA_UPLINK_PACKER)
+// Queue a local or relayed frame for the next LoRaWAN uplink.
+// Frames are packed as (len,frame...) entries, as for relay batching (without its format byte), into one uplink
+// of up to LORA_UPLINK_MAX_BYTES (the payload limit at LORA_UPLINK_SF, the slowest rate that ADR may pick);
+// when the duty cycle holds uplinks back the oldest entries make room for new ones.
+// A frame too big to pack is sent as the only entry of its own uplink, ahead of the packed one;
+// a newer such frame replaces one not yet sent.
+void loraUplinkPut(const uint8_t *buf, uint8_t buflen);
+// Call once per minor cycle after time-critical work.
+// Sends the uplink once it is full or its oldest frame has waited LORA_UPLINK_MAX_DELAY_S,
+// if the sub-band's duty-cycle credit covers its airtime and at least half the cycle remains;
+// credit is spent and the uplink cleared only once the radio accepts it.
+void loraUplinkTick();
+#endif // ENABLE_LORA_UPLINK_PACKER
+#if defined(ENABLE_LORA_UPLINK_PACKER) && defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+inline void relayFrame(const uint8_t *buf, uint8_t buflen) { if(profileHas(PROFILE_RELAY)) { latencyRelayTaken(); loraUplinkPut(buf, buflen); } }
+#define relayBatchTick() {}
+#elif defined(ENABLE_RELAY_BATCHING) && defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+// Queue a frame to be relayed over the secondary radio.
+// Frames are packed as (len,frame...) after a format/version byte (0x81) into one send of up to RELAY_BATCH_MAX_BYTES,
+// flushed when the next frame would not fit or after RELAY_BATCH_MAX_DELAY_S.
+// A refused batch is kept and retried each minor cycle, and only dropped if still refused when the next frame needs room.
+void relayFrame(const uint8_t *buf, uint8_t buflen);
+// Call once per minor cycle to flush a batch that has waited too long.
+void relayBatchTick();
+#elif defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY) && defined(ENABLE_RELAY_BACKLOG)
+// Relay a frame over the secondary radio, or hold it in the backlog.
+void relayFrame(const uint8_t *buf, uint8_t buflen);
+#define relayBatchTick() {}
+#elif defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+inline void relayFrame(const uint8_t *buf, uint8_t buflen) { if(profileHas(PROFILE_RELAY)) { latencyRelayTaken(); if(deferredInitDone(DI_SECONDARY_RADIO) && SecondaryRadio.queueToSend(buf, buflen)) { latencyRelaySent(false); } else { latencyRelayDropped(false); } } }
+#define relayBatchTick() {}
+#else
+#define relayBatchTick() {}
+#endif // ENABLE_RELAY_BATCHING
+#if defined(ENABLE_RELAY_BACKLOG)
+// Sends that the secondary radio refuses (its driver queue stays full while the link is down)
+// are kept, oldest dropped first, in a RELAY_BACKLOG_BYTES RAM backlog of (len,frame...) entries,
+// and so is any later send until the backlog has drained, to keep frames in order.
+// Retries back off exponentially from RELAY_BACKLOG_RETRY_MIN_TICKS to RELAY_BACKLOG_RETRY_MAX_TICKS main ticks.
+// With ENABLE_RELAY_BATCHING catch-up packs as many held entries as fit into each batch.
+// Call once per minor cycle.
+void relayBacklogTick();
+#else
+#define relayBacklogTick() {}
+#endif // ENABLE_RELAY_BACKLOG
+#if defined(ENABLE_HUB_SUMMARY_ONLY)
+// Leaf stats are carried by the hub summary instead.
+#define relayLeafFrame(buf, buflen) {}
+#else
+#define relayLeafFrame(buf, buflen) relayFrame((buf), (buflen))
+#endif // ENABLE_HUB_SUMMARY_ONLY
+#if defined(ENABLE_LORA_UPLINK_PACKER)
+inline void secondaryTXDeferred(const uint8_t *buf, uint8_t buflen) { loraUplinkPut(buf, buflen); }
+#define secondaryTXDeferredTick() loraUplinkTick()
+#elif defined(ENABLE_SECONDARY_TX_DEFERRED)
+// Hold a copy of a frame for the secondary radio, replacing any frame still held.
+// Drivers such as OTRN2483Link block on the module's response over software serial,
+// so the send is moved out of bareStatsTX() to the end of the minor cycle.
+void secondaryTXDeferred(const uint8_t *buf, uint8_t buflen);
+// Call once per minor cycle after time-critical work;
+// sends any held frame if at least half the cycle remains, else waits for the next.
+void secondaryTXDeferredTick();
+#else
+inline void secondaryTXDeferred(const uint8_t *buf, uint8_t buflen) { if(deferredInitDone(DI_SECONDARY_RADIO)) { SecondaryRadio.queueToSend(buf, buflen); } }
+#define secondaryTXDeferredTick() {}
+#endif // ENABLE_SECONDARY_TX_DEFERRED
+#else
+#define relayBatchTick() {}
+#define secondaryTXDeferredTick() {}
 #endif // RADIO_SECONDARY_MODULE_TYPE
 
+#if (defined(ENABLE_BINARY_SERIAL_OUTPUT) && defined(ENABLE_RADIO_RX)) || defined(ENABLE_BULK_STATS_EXPORT) || defined(ENABLE_VALVE_MOVE_LOG) || (defined(ENABLE_RX_FRAME_CAPTURE) && defined(ENABLE_RADIO_RX)) || (defined(ENABLE_BINARY_STATUS_RECORD) && defined(ENABLE_SERIAL_STATUS_REPORT))
+// SLIP-framed binary records to Serial (see Messaging.cpp for the format).
+// Start a record; id may be NULL iff idLen is 0.
+void binRecStart(uint8_t type, const uint8_t *id, uint8_t idLen, uint8_t seq);
+// Write payload bytes.
+void binRecPut(const uint8_t *buf, uint8_t len);
+// Finish a record.
+void binRecEnd();
+#endif
+
+#if defined(ENABLE_BULK_STATS_EXPORT)
+// Restart any +EXP export in progress from offset 0 so that the blob is one consistent snapshot;
+// call after by-hour stats are sampled.
+void exportRestartIfActive();
+#else
+#define exportRestartIfActive() {}
+#endif // ENABLE_BULK_STATS_EXPORT
+
+// Windowed RX polling only helps where the radio cannot wake the CPU itself.
+#if defined(ENABLE_WINDOWED_RX_POLL) && (!defined(ENABLE_CONTINUOUS_RX) || defined(PIN_RFM_NIRQ))
+#undef ENABLE_WINDOWED_RX_POLL
+#endif
+#if defined(ENABLE_ADAPTIVE_TX_SLOT) || defined(ENABLE_WINDOWED_RX_POLL) || defined(ENABLE_TX_PENDING_QUEUE)
+// True if the primary radio can hear a signal above TX_LBT_RSSI_BUSY, ie the channel seems busy.
+// Only meaningful for an RFM23B primary radio in RX mode; else always false.
+bool primaryRadioChannelBusy();
+#endif
+
+#if defined(ENABLE_TX_PENDING_QUEUE)
+// Classes of primary radio TX that can be held for retry.
+// At most one frame of each class is held: a newer one always supersedes it.
+enum txClass_t : uint8_t
+  {
+  TXC_STATS,
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME)
+  TXC_VALVE,
+#endif
+  TXC_COUNT
+  };
+// Largest frame that can be held; the RFM23B FIFO size.
+static constexpr uint8_t TX_PENDING_MAX_FRAME = 64;
+// Retries of a held frame before it is dropped as stale.
+static constexpr uint8_t TX_PENDING_MAX_TRIES = 4;
+// Rebuilds a held secure frame and sends it with primaryRadioSendOrHold() as before.
+typedef void (*txRebuild_t)();
+// Send buf on the primary radio now; if that fails then hold a copy for retry in place of any held frame of class c.
+// Any held frame of class c is dropped on success too, since it is now out of date.
+// A secure frame cannot be held as sent: once any later secure frame has gone out
+// its message counter is stale and the receiver rejects it as a replay.
+// So for a secure frame pass rebuild, and only that is held, to make the frame afresh with a new counter on retry.
+// Returns true if sent now.
+bool primaryRadioSendOrHold(txClass_t c, const uint8_t *buf, uint8_t buflen, int8_t channel,
+                            OTRadioLink::OTRadioLink::TXpower power = OTRadioLink::OTRadioLink::TXnormal,
+                            txRebuild_t rebuild = NULL);
+// Call once per minor cycle to retry held frames when the channel is not seen to be busy.
+void txPendingTick();
+#else
+#define txPendingTick() {}
+#endif // ENABLE_TX_PENDING_QUEUE
+
+#if defined(ENABLE_RX_REPEATER)
+// When not in hub mode, secure 'O' (and short valve) frames heard from associated senders
+// are sent again unchanged on the primary channel for any hub that missed them.
+// The whole header is authenticated and a full 'O' frame fills the radio FIFO, so there is no hop count on air:
+// instead each repeater sends a given frame (by tag) at most once, and stands down if it hears another copy first,
+// so the copies are bounded by the number of repeaters, and hubs reject replays by message counter anyway.
+// Election: the repeater hearing the sender best waits least (0--3 main ticks, staggered by node ID),
+// and frames heard with RSSI below REPEATER_MIN_RSSI are left to others (RSSI is known with ENABLE_RX_LINK_TABLE).
+static constexpr uint8_t REPEATER_MIN_RSSI = 64;
+// Consider a queued frame (length at msg[-1]) for repeating; call for each frame as it is taken from the RX queue.
+void repeaterRX(const uint8_t *msg);
+// Call once per main tick to send a frame whose election wait has run out.
+void repeaterTick();
+#else
+#define repeaterRX(msg) {}
+#define repeaterTick() {}
+#endif // ENABLE_RX_REPEATER
+
+#if defined(ENABLE_LINK_QUALITY_FEEDBACK)
+// Local-use secure frame type for the hub's per-node link quality summary.
+// Body is up to LINK_QUALITY_MAX_ENTRIES of (ID byte 0, ID byte 1, loss %).
+static constexpr uint8_t FTS_LINK_QUALITY_LOCAL = 0x10;
+#if defined(ENABLE_RX_ASSOC_INDEX)
+// Hub: broadcast loss % seen from each associated node since the last broadcast, if in hub mode.
+void linkQualityBroadcastTX();
+#endif
+// Leaf: call once per minute to age the last feedback received from the hub.
+void ageLinkQualityFeedback();
+// Leaf: true if the radio should listen for the coming second to catch the hub's feedback:
+// around when the last arrived once that is half way to stale, else through four whole minutes in 64.
+bool linkQualityWantsRX();
+// Leaf: choose double TX from the hub's feedback if fresh, else return dflt.
+bool linkQualityWantsDoubleTX(bool dflt);
+#endif // ENABLE_LINK_QUALITY_FEEDBACK
+
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME)
+// Local-use secure frame type for a valve % update with a single-AES-block encrypted body,
+// 16 bytes shorter on air than an 'O' frame with its fixed 32-byte body.
+// Plaintext is as for an 'O' frame without stats (valve %, flags) then zeros and a final count of those zeros.
+static constexpr uint8_t FTS_VALVE_SHORT_LOCAL = 0x11;
+static constexpr uint8_t VALVE_SHORT_FRAME_BODY_SIZE = 16;
+#endif // ENABLE_SECURE_VALVE_SHORT_FRAME
+
+#if defined(ENABLE_SECURE_TX_ACK)
+// Local-use secure frame type for a hub's acknowledgement of a frame carrying a valve %.
+// Body is the first TX_ACK_TAG_BYTES of the acknowledged frame's authentication tag,
+// then the hub's local time as minutes since midnight, big-endian, which the leaf adopts if it differs.
+// The leaf needs the hub's ID in its node associations (eg set with the A CLI command) to authenticate the ACK;
+// a leaf with no associations at all sends with blind double TX instead of waiting for ACKs it cannot check.
+static constexpr uint8_t FTS_ACK_LOCAL = 0x12;
+static constexpr uint8_t TX_ACK_TAG_BYTES = 4;
+// Leaf: send a secure frame with the 0x80 trailer (frame excludes the length byte) on the primary radio,
+// listen briefly for the hub's ACK, and resend it unchanged if none arrives; with no node associations, blind double TX.
+// Returns true if the frame was sent at least once, acknowledged or not.
+bool primaryRadioSendAcked(const uint8_t *frame, uint8_t len);
+#if defined(ENABLE_STATS_KEY_SUBSCRIPTION)
+// True if a secure stats frame with the given lead (valve %) byte and 4-bit sequence number is acknowledged:
+// valve reports, and from any sender the frame with sequence number 0 (one in 16, every hour or few at stats rates)
+// so that sensor-only leaves refresh the subscription without listening after every frame.
+#define secureFrameWantsAck(valvePC, seq) (((valvePC) <= 100) || (0 == (seq)))
+#else
+// True if a secure stats frame with the given lead (valve %) byte and sequence number is acknowledged: valve reports only.
+#define secureFrameWantsAck(valvePC, seq) ((valvePC) <= 100)
+#endif // ENABLE_STATS_KEY_SUBSCRIPTION
+#endif // ENABLE_SECURE_TX_ACK
+
+#if defined(ENABLE_REMOTE_DIAG)
+// Local-use secure frame type for a leaf's diagnostics, sent once per request from the hub.
+// The hub asks by setting REMOTE_DIAG_REQ in a byte appended to its ACKs to that leaf,
+// until the leaf's diagnostics arrive; the hub prints them as {"@":ID,"+":seq,"dg":"hex body"}.
+// Body, with 0xff (0xffff) for anything not built in:
+//   [0] REMOTE_DIAG_VERSION
+//   [1,2] minimum stack headroom seen (bytes, big-endian signed, as SH)
+//   [3] overrun count
+//   [4] TIME_LSD of the latest overrun log record, b7 set if the CLI was active
+//   [5] slot with the worst run time (TIME_LSD, or 'R' or 'C' as +PRF), [6] its worst sub-cycle ticks
+//   [7] RX dropped, [8] RX filtered, [9] RX errors, [10] TX failures, [11] JSON failures (as Link)
+//   [12,13] estimated mean supply current (uA, big-endian, as E)
+//   [14,15] supply voltage (cV, big-endian)
+static constexpr uint8_t FTS_DIAG_LOCAL = 0x14;
+static constexpr uint8_t REMOTE_DIAG_REQ = 0x01;
+static constexpr uint8_t REMOTE_DIAG_VERSION = 1;
+static constexpr uint8_t REMOTE_DIAG_BODY_LEN = 16;
+// Hub: request diagnostics from the node in association slot n; false if there is none.
+bool remoteDiagRequest(uint8_t n);
+// Leaf: set when the hub has requested diagnostics, until they are sent.
+extern bool remoteDiagPending;
+// Leaf: fill in the diagnostics body.
+void remoteDiagBody(uint8_t body[REMOTE_DIAG_BODY_LEN]);
+// Leaf: if diagnostics were requested then send them and return true, else return false.
+bool remoteDiagTXIfPending();
+#endif // ENABLE_REMOTE_DIAG
+
+#if defined(ENABLE_STATS_KEY_SUBSCRIPTION)
+// Optional stats keys that a site may not want, one bit each in the subscription bitmap;
+// temperature, occupancy, valve %, boiler and error keys are always sent.
+static constexpr uint8_t STATS_SUB_RH = 0x01; // H|%
+static constexpr uint8_t STATS_SUB_VACANCY = 0x02; // vac|h
+static constexpr uint8_t STATS_SUB_AMBLIGHT = 0x04; // L
+static constexpr uint8_t STATS_SUB_VOICE = 0x08; // av
+static constexpr uint8_t STATS_SUB_TARGET = 0x10; // tT|C
+static constexpr uint8_t STATS_SUB_SETBACK = 0x20; // tS|C
+static constexpr uint8_t STATS_SUB_MOVEMENT = 0x40; // vC|%
+static constexpr uint8_t STATS_SUB_SUPPLY = 0x80; // B|cV
+// The site's bitmap is kept in EEPROM (with the other application bytes in the radio config area),
+// erased (0xff) for all keys.
+// A hub's is set with +SUB and sent as a byte appended to every ACK after the diagnostics request byte;
+// with subscription built in the hub also acknowledges one frame in 16 from non-valve senders (see secureFrameWantsAck()),
+// and those leaves listen for an ACK after just those frames, so sensor-only leaves learn it too.
+// A leaf keeps the bitmap from the latest ACK, so it survives a reset.
+// Set the site's bitmap.
+void statsSubscriptionSet(uint8_t keys);
+// True if the site wants the given STATS_SUB_XXX key.
+bool statsKeyWanted(uint8_t key);
+#endif // ENABLE_STATS_KEY_SUBSCRIPTION
+
+#if defined(ENABLE_TIME_SYNC_BEACON)
+// Local-use secure frame type for the hub's time-sync beacon.
+// Body is the hub's seconds within the minute and minute phase (0--3) as sent,
+// then up to TIME_SYNC_MAX_ENTRIES of (ID byte 0, ID byte 1, stats TX slot 0--7), one per associated node.
+static constexpr uint8_t FTS_TIME_SYNC_LOCAL = 0x13;
+// Hub: broadcast the time sync with the given minute phase, if in hub mode.
+void timeSyncBroadcastTX(uint8_t minutePhase);
+// Leaf: adopt the hub's seconds and minute phase, and this node's stats TX slot (0xff if none), from an authenticated sync.
+void timeSyncRX(uint8_t hubSeconds, uint8_t hubMinutePhase, uint8_t slot);
+#endif // ENABLE_TIME_SYNC_BEACON
+
 #ifdef ENABLE_RADIO_SIM900
 //For EEPROM:
 //- Set the first field of SIM900LinkConfig to true.
@@ -117,6 +1035,213 @@ extern OTRadioLink::OTRadioLink &SecondaryRadio;
 extern const OTSIM900Link::OTSIM900LinkConfig_t SIM900Config;
 #endif // ENABLE_RADIO_SIM900
 
+#if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON)
+#if defined(ENABLE_KEY_CACHE)
+// Get the 16-byte primary building key into key, as OTV0P2BASE::getPrimaryBuilding16ByteSecretKey(),
+// from a RAM copy after the first successful read from EEPROM.
+// Returns false if no key is set.
+bool getPrimaryBuildingKey(uint8_t *key);
+#else
+inline bool getPrimaryBuildingKey(uint8_t *key) { return(OTV0P2BASE::getPrimaryBuilding16ByteSecretKey(key)); }
+#endif // ENABLE_KEY_CACHE
+#if defined(ENABLE_KEY_CACHE) || defined(ENABLE_GHASH_TABLE) || defined(ENABLE_RX_DECRYPT_SESSION)
+// Wipe the RAM copies of the key and anything derived from it (eg the GHASH table, an RX session's key);
+// must be called whenever the key is changed, and on panic.
+void wipeKeyCache();
+#else
+#define wipeKeyCache() {}
+#endif
+#if defined(ENABLE_DUAL_RX_KEY)
+// Hours for which the building key replaced by K is still accepted for RX, so that nodes can be re-keyed one at a time;
+// "K P" drops it sooner, once all are done.
+static constexpr uint8_t DUAL_RX_KEY_HOLD_H = 72;
+// Keep a RAM copy of the current key (if any) as the previous key; call just before K changes it.
+void retireBuildingKey();
+// Call just after K; drops the previous key if K left the key unchanged or cleared it.
+void noteBuildingKeyChanged();
+// Wipe the previous key now, eg on panic or from the CLI.
+void wipePreviousBuildingKey();
+// Call hourly; wipes the previous key after DUAL_RX_KEY_HOLD_H hours.
+void previousBuildingKeyHourTick();
+#endif // ENABLE_DUAL_RX_KEY
+#if defined(ENABLE_RADIO_BUILDING_SYNC)
+// Program the GFSK radio(s) with the sync word derived from the current building key, or the standard one if none;
+// call after the radios are configured and whenever the key changes.
+// Nodes only hear each other once all have the same key.
+void applyBuildingSyncWord();
+#endif
+
+// The 0x80-style trailer of a secure small frame: the full message counter, the authentication tag, then the 0x80 format byte.
+static constexpr uint8_t SECURE_FRAME_TAG_BYTES = 16;
+static constexpr uint8_t SECURE_FRAME_0X80_TRAILER_BYTES = OTRadioLink::SimpleSecureFrame32or0BodyBase::fullMessageCounterBytes + SECURE_FRAME_TAG_BYTES + 1;
+// Authentication tag of a secure frame of len bytes ending with the 0x80 trailer.
+inline const uint8_t *secureFrameTag(const uint8_t *const frame, const uint8_t len) { return(frame + len - (SECURE_FRAME_TAG_BYTES + 1)); }
+
+// AES-GCM functions used for all secure frame TX and RX, stateless (state argument NULL).
+#if defined(ENABLE_GHASH_TABLE)
+// As the OTAESGCM DEFAULT_STATELESS versions but with table GHASH and the fast AES-128 core; see Messaging.cpp.
+// Not re-entrant, as the table is shared.
+bool fixed32BTextSize12BNonce16BTagSimpleEnc_TABLE(void *state,
+    const uint8_t *key, const uint8_t *iv,
+    const uint8_t *authtext, uint8_t authtextSize,
+    const uint8_t *plaintext,
+    uint8_t *ciphertextOut, uint8_t *tagOut);
+bool fixed32BTextSize12BNonce16BTagSimpleDec_TABLE(void *state,
+    const uint8_t *key, const uint8_t *iv,
+    const uint8_t *authtext, uint8_t authtextSize,
+    const uint8_t *ciphertext, const uint8_t *tag,
+    uint8_t *plaintextOut);
+static constexpr OTRadioLink::SimpleSecureFrame32or0BodyTXBase::fixed32BTextSize12BNonce16BTagSimpleEnc_ptr_t secureFrameEnc =
+    fixed32BTextSize12BNonce16BTagSimpleEnc_TABLE;
+static constexpr OTRadioLink::SimpleSecureFrame32or0BodyRXBase::fixed32BTextSize12BNonce16BTagSimpleDec_ptr_t secureFrameDec =
+    fixed32BTextSize12BNonce16BTagSimpleDec_TABLE;
+#elif defined(ENABLE_FAST_AES128)
+// As the OTAESGCM DEFAULT_STATELESS versions but with a faster app-side AES-128 core; see Messaging.cpp.
+bool fixed32BTextSize12BNonce16BTagSimpleEnc_FAST_STATELESS(void *state,
+    const uint8_t *key, const uint8_t *iv,
+    const uint8_t *authtext, uint8_t authtextSize,
+    const uint8_t *plaintext,
+    uint8_t *ciphertextOut, uint8_t *tagOut);
+bool fixed32BTextSize12BNonce16BTagSimpleDec_FAST_STATELESS(void *state,
+    const uint8_t *key, const uint8_t *iv,
+    const uint8_t *authtext, uint8_t authtextSize,
+    const uint8_t *ciphertext, const uint8_t *tag,
+    uint8_t *plaintextOut);
+static constexpr OTRadioLink::SimpleSecureFrame32or0BodyTXBase::fixed32BTextSize12BNonce16BTagSimpleEnc_ptr_t secureFrameEnc =
+    fixed32BTextSize12BNonce16BTagSimpleEnc_FAST_STATELESS;
+static constexpr OTRadioLink::SimpleSecureFrame32or0BodyRXBase::fixed32BTextSize12BNonce16BTagSimpleDec_ptr_t secureFrameDec =
+    fixed32BTextSize12BNonce16BTagSimpleDec_FAST_STATELESS;
+#else
+static constexpr OTRadioLink::SimpleSecureFrame32or0BodyTXBase::fixed32BTextSize12BNonce16BTagSimpleEnc_ptr_t secureFrameEnc =
+    OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleEnc_DEFAULT_STATELESS;
+static constexpr OTRadioLink::SimpleSecureFrame32or0BodyRXBase::fixed32BTextSize12BNonce16BTagSimpleDec_ptr_t secureFrameDec =
+    OTAESGCM::fixed32BTextSize12BNonce16BTagSimpleDec_DEFAULT_STATELESS;
+#endif // ENABLE_FAST_AES128
+#if defined(ENABLE_FAST_AES128) && (defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON))
+// Check the app-side AES-GCM (fast core, and table GHASH if enabled) against a published vector; true if all match.
+// Called from the POST; uses ~170 bytes of stack.
+bool secureFrameKAT();
+#endif
+#endif
+
+#if (defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON)) && defined(ENABLE_TX_COUNTER_RESERVATION)
+// Secure TX with fewer EEPROM writes per boot.
+// The library advances the 3-byte persistent restart counter (primary and alternate copies with CRCs)
+// on the first TX after every boot.
+// Here each restart counter value instead reserves a block of TX_CTR_BOOTS_PER_BLOCK boots,
+// and each boot takes the next one by clearing one bit (with no erase) of a small bitmap in EEPROM,
+// so that the restart counter is advanced and the bitmap erased only once per block.
+// The 6-byte message counter is then the restart counter, the 6-bit boot index within the block,
+// then an 18-bit count in RAM started from 14 bits of entropy;
+// if that count would run out a further boot slot is taken.
+// So the counter still never repeats and increases monotonically as receivers expect.
+// The bitmap is for the restart counter value stored (inverted) alongside it,
+// so any other change of the restart counter (eg by the K command or older firmware) starts a new block.
+// Lives in the first EEPROM node association set, so is not available on nodes that keep associations:
+// hubs, and leaves that authenticate frames from a hub or peer (link quality, ACKs, time sync, diagnostics, repeating).
+#if defined(ENABLE_RADIO_RX) && (defined(ENABLE_BOILER_HUB) || defined(ENABLE_STATS_RX) || \
+    defined(ENABLE_LINK_QUALITY_FEEDBACK) || defined(ENABLE_SECURE_TX_ACK) || defined(ENABLE_TIME_SYNC_BEACON) || \
+    defined(ENABLE_REMOTE_DIAG) || defined(ENABLE_RX_REPEATER))
+#error ENABLE_TX_COUNTER_RESERVATION would overwrite node associations
+#endif
+#if defined(ENABLE_HIGH_RES_STATS_RING)
+#error ENABLE_TX_COUNTER_RESERVATION would overlap the high-res stats ring
+#endif
+static constexpr intptr_t V0P2_EE_START_TX_CTR_BLOCK = OTV0P2BASE::V0P2BASE_EE_START_NODE_ASSOCIATIONS; // 3 bytes, inverted.
+static constexpr intptr_t V0P2_EE_START_TX_CTR_BITMAP = V0P2_EE_START_TX_CTR_BLOCK + 3;
+static constexpr uint8_t V0P2_EE_LEN_TX_CTR_BITMAP = 8;
+static constexpr uint8_t TX_CTR_BOOTS_PER_BLOCK = 8 * V0P2_EE_LEN_TX_CTR_BITMAP;
+class SimpleSecureFrame32or0BodyTXV0p2Reserved final : public OTRadioLink::SimpleSecureFrame32or0BodyTXV0p2
+  {
+  private:
+    bool reserved; // True once a boot slot has been taken and restartCounter and ephemeral are valid.
+    uint8_t restartCounter[3];
+    uint8_t ephemeral[3]; // Boot index << 2 in the top 6 bits, then the 18-bit count.
+    SimpleSecureFrame32or0BodyTXV0p2Reserved() : reserved(false) { }
+    // Take the next boot slot, starting a new block if need be; returns false on failure.
+    bool reserveBootSlot();
+  public:
+    // Factory method to get singleton instance.
+    static SimpleSecureFrame32or0BodyTXV0p2Reserved &getInstance();
+    virtual bool incrementAndGetPrimarySecure6BytePersistentTXMessageCounter(uint8_t *buf) override;
+    // Forget the current boot slot, eg after the restart counter has been reset, so that the next TX takes a new one.
+    void restartCounterChanged() { reserved = false; }
+  };
+inline OTRadioLink::SimpleSecureFrame32or0BodyTXV0p2 &secureTX() { return(SimpleSecureFrame32or0BodyTXV0p2Reserved::getInstance()); }
+// As OTRadioLink::SimpleSecureFrame32or0BodyTXV0p2::resetRaw3BytePersistentTXRestartCounterCond(), eg for the K command.
+bool resetSecureTXRestartCounterCond();
+#elif defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) || defined(ENABLE_SECURE_RADIO_BEACON)
+// Secure TX frame generation and primary message counter.
+inline OTRadioLink::SimpleSecureFrame32or0BodyTXV0p2 &secureTX() { return(OTRadioLink::SimpleSecureFrame32or0BodyTXV0p2::getInstance()); }
+inline bool resetSecureTXRestartCounterCond() { return(OTRadioLink::SimpleSecureFrame32or0BodyTXV0p2::resetRaw3BytePersistentTXRestartCounterCond()); }
+#endif // ENABLE_TX_COUNTER_RESERVATION
+
+// Print len node ID bytes to p as hex, eg for the "@" field of JSON output.
+// With ENABLE_FIXED_HEX_IDS as two lower-case digits per byte in a single write,
+// else as Print::print(b, HEX) per byte, ie upper case with no leading zero (so possibly ambiguous).
+void printIDHex(Print *p, const uint8_t *id, uint8_t len);
+#if defined(ENABLE_FIXED_HEX_IDS)
+// Write len ID bytes to buf as 2*len lower-case hex digits, unterminated; returns the number of chars written.
+inline uint8_t putIDHex(char *const buf, const uint8_t *const id, const uint8_t len)
+  {
+  for(uint8_t i = 0; i < len; ++i) { OTV0P2BASE::hexDigits(id[i], buf + 2*i); }
+  return(2 * len);
+  }
+#endif // ENABLE_FIXED_HEX_IDS
+
+#if (defined(ENABLE_RX_ASSOC_INDEX) || defined(ENABLE_RX_ISR_ASSOC_FILTER)) && defined(ENABLE_RADIO_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
+// Rebuild the RAM index/filter of node associations and their last RX message counters from EEPROM.
+// Must be called at start-up and whenever the associations may have been changed.
+void rebuildRXAssocIndex();
+#else
+#define rebuildRXAssocIndex() {}
+#endif // ENABLE_RX_ASSOC_INDEX || ENABLE_RX_ISR_ASSOC_FILTER
+#if defined(ENABLE_RX_ISR_ASSOC_FILTER) && defined(ENABLE_RADIO_RX) && defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT)
+// True if a node ID starting with the il-byte (il > 0) prefix may be associated; false if definitely not.
+// Safe to call from an ISR.
+bool rxAssocMayMatch(const volatile uint8_t *prefix, uint8_t il);
+#endif // ENABLE_RX_ISR_ASSOC_FILTER
+#if defined(ENABLE_RX_LINK_TABLE)
+// Hub: call once per minute to age the last-heard times in the per-sender link table.
+void ageRXLinkTable();
+// Print the per-sender link table to Serial, one JSON object per associated node.
+void rxLinkTableDump();
+#if defined(ENABLE_RADIO_SECONDARY_MODULE_AS_RELAY)
+// Send the per-sender link table over the secondary radio relay, as for rxLinkTableDump().
+void rxLinkTableRelay();
+#endif
+#if defined(ENABLE_RADIO_PRIMARY_RFM23B)
+// Note the RSSI for the frame about to be queued at buf.
+// Call only from the primary radio's RX ISR filter, ie while the radio is still in RX.
+void rxNoteRSSIISR(const volatile uint8_t *buf);
+#endif
+#endif // ENABLE_RX_LINK_TABLE
+#if defined(ENABLE_NODE_REGISTRY)
+// Hub: call once per minute to age the last-heard times in the node registry.
+void ageNodeRegistry();
+// Print the latest values from each sender in the node registry to Serial, one JSON object per node.
+void nodeRegistryDump();
+#if defined(ENABLE_HUB_SUMMARY)
+// Minutes between hub summary frames; a power of two no more than 128
+// so that the spacing stays even across the wrap of the 8-bit minute counter.
+#ifndef HUB_SUMMARY_INTERVAL_M
+#define HUB_SUMMARY_INTERVAL_M 1
+#endif
+static_assert((HUB_SUMMARY_INTERVAL_M > 0) && (0 == (256 % HUB_SUMMARY_INTERVAL_M)), "HUB_SUMMARY_INTERVAL_M must divide 256");
+// Nodes not heard for longer than this many minutes are left out of the summary.
+#ifndef HUB_SUMMARY_MAX_AGE_M
+#define HUB_SUMMARY_MAX_AGE_M 60
+#endif
+// Leading byte of the summary frame, distinct from relayed secure frames and '{' JSON.
+static constexpr uint8_t HUB_SUMMARY_FRAME_TYPE = 'S';
+// Relay one summary frame: HUB_SUMMARY_FRAME_TYPE, flags (bit 0 boiler on),
+// then 6 bytes for each node heard in the last HUB_SUMMARY_MAX_AGE_M minutes:
+// first two ID bytes, temperature C/16 (big-endian, 0x8000 if unknown), valve % (0xff if unknown),
+// and (minutes since heard, max 63) << 2 | battery low << 1 | valve calling for heat.
+void hubSummaryRelay(bool boilerOn);
+#endif // ENABLE_HUB_SUMMARY
+#endif // ENABLE_NODE_REGISTRY
+
 static constexpr uint8_t RFM22_PREAMBLE_BYTE = 0xaa; // Preamble byte for RFM22/23 reception.
 static constexpr uint8_t RFM22_PREAMBLE_MIN_BYTES = 4; // Minimum number of preamble bytes for reception.
 static constexpr uint8_t RFM22_PREAMBLE_BYTES = 5; // Recommended number of preamble bytes for reliable reception.
@@ -138,6 +1263,9 @@ static constexpr uint8_t STATS_MSG_START_OFFSET = (RFM22_PREAMBLE_BYTES + RFM22_
 static constexpr uint8_t STATS_MSG_MAX_LEN = (64 - STATS_MSG_START_OFFSET);
 #if defined(ENABLE_RFM23B_FS20_RAW_PREAMBLE)
 void RFM22RawStatsTXFFTerminated(uint8_t *buf, bool doubleTX, bool RFM23BFramed = true);
+// As RFM22RawStatsTXFFTerminated() but for a frame of known length (including preamble),
+// so needing no terminator and no scan for it.
+void RFM22RawStatsTX(uint8_t *buf, uint8_t buflen, bool doubleTX);
 #endif
 #if defined(ENABLE_RFM23B_FS20_RAW_PREAMBLE)
 // Adds the STATS_MSG_START_OFFSET preamble to enable reception by a remote RFM22B/RFM23B.
@@ -155,13 +1283,68 @@ inline uint8_t *RFM22RXPreambleAdd(uint8_t *buf)
   }
 #endif
 
+#if defined(ENABLE_SETTINGS_CACHE)
+// RAM copy of hot EEPROM-backed settings, to avoid EEPROM reads on fast paths.
+// Loaded in setup() and reloaded after every CLI command, since library CLI handlers (eg I, X, G)
+// write EEPROM directly; setters in this application write through.
+struct settingsCache_t
+  {
+  uint8_t minBoilerOnMinsInv; // As at V0P2BASE_EE_START_MIN_BOILER_ON_MINS_INV.
+  uint8_t statsTXLevel; // As at V0P2BASE_EE_START_STATS_TX_ENABLE.
+  uint8_t id[V0P2BASE_EE_LEN_ID]; // As at V0P2BASE_EE_START_ID.
+  };
+extern settingsCache_t settingsCache;
+// (Re)load all cached settings from EEPROM.
+void loadSettingsCache();
+// Get the stats TX level, as OTV0P2BASE::getStatsTXLevel().
+inline OTV0P2BASE::stats_TX_level getStatsTXLevelCached() { return((OTV0P2BASE::stats_TX_level)settingsCache.statsTXLevel); }
+// Get byte i of the node ID.
+inline uint8_t getNodeIDByte(const uint8_t i) { return(settingsCache.id[i]); }
+#else
+#define loadSettingsCache() {}
+inline OTV0P2BASE::stats_TX_level getStatsTXLevelCached() { return(OTV0P2BASE::getStatsTXLevel()); }
+inline uint8_t getNodeIDByte(const uint8_t i) { return(eeprom_read_byte((uint8_t *)V0P2BASE_EE_START_ID + i)); }
+#endif // ENABLE_SETTINGS_CACHE
+
+#if defined(ENABLE_JITTER_XORSHIFT_RNG)
+// Non-secure PRNG for TX slot choice and timing jitter: xorshift32,
+// seeded once per boot from the secure entropy pool mixed with the node ID so each node has its own stream.
+// Call seedJitterRNG() once the ID exists.
+void seedJitterRNG();
+uint8_t jitterRand8();
+#define jitterRandBool() (0 != (jitterRand8() & 0x80))
+#else
+#define seedJitterRNG() {}
+#define jitterRand8() OTV0P2BASE::randRNG8()
+#define jitterRandBool() OTV0P2BASE::randRNG8NextBoolean()
+#endif // ENABLE_JITTER_XORSHIFT_RNG
+
+#if defined(ENABLE_RTC_WEAR_LEVELLING)
+// Wear-levelled replacements for OTV0P2BASE::persistRTC() and restoreRTC().
+// Time of day is kept in one EEPROM cell per hour, so each cell sees one erase per day
+// (plus bit clears for the quarter hours) instead of one cell taking 24 erases per day.
+// Each cell holds (day marker << 3) | quarter bits as per the library encoding;
+// the day marker is days-since-1999 mod 31 so that an erased (0xff) cell is never valid.
+// The days count itself stays at V0P2BASE_EE_START_RTC_DAY_PERSIST, written once a day.
+// Lives in the application-private EEPROM after the overrun log.
+void persistRTCWL();
+bool restoreRTCWL();
+#define persistRTCApp() persistRTCWL()
+#define restoreRTCApp() restoreRTCWL()
+#elif defined(ENABLE_EEPROM_WEAR_STATS)
+#define persistRTCApp() eeWearPersistRTC()
+#define restoreRTCApp() OTV0P2BASE::restoreRTC()
+#else
+#define persistRTCApp() OTV0P2BASE::persistRTC()
+#define restoreRTCApp() OTV0P2BASE::restoreRTC()
+#endif // ENABLE_RTC_WEAR_LEVELLING
+
 // Returns true if an unencrypted trailing static payload and similar (eg bare stats transmission) is permitted.
 // True if the TX_ENABLE value is no higher than stTXmostUnsec.
 // Some filtering may be required even if this is true.
 #if defined(ENABLE_STATS_TX)
 #if !defined(ENABLE_ALWAYS_TX_ALL_STATS)
-// TODO: allow cacheing in RAM for speed.
-inline bool enableTrailingStatsPayload() { return(OTV0P2BASE::getStatsTXLevel() <= OTV0P2BASE::stTXmostUnsec); }
+inline bool enableTrailingStatsPayload() { return(getStatsTXLevelCached() <= OTV0P2BASE::stTXmostUnsec); }
 #else
 #define enableTrailingStatsPayload() (true) // Always allow at least some stats to be TXed.
 #endif // !defined(ENABLE_ALWAYS_TX_ALL_STATS)
@@ -182,7 +1365,32 @@ inline bool enableTrailingStatsPayload() { return(OTV0P2BASE::getStatsTXLevel()
 // which may mean deferring work at certain times
 // such as the end of minor cycle.
 // The Print object pointer must not be NULL.
+// With ENABLE_RX_BATCH_DRAIN, keeps decoding until the RX queue is empty
+// or RX_BATCH_DRAIN_BUDGET_SCT ticks have been used, waking Serial only once.
 bool handleQueuedMessages(Print *p, bool wakeSerialIfNeeded, OTRadioLink::OTRadioLink *rl);
+#if defined(ENABLE_RX_PRIORITY_QUEUE) && defined(ENABLE_BOILER_HUB)
+// Called from the primary radio RX filter ISR with an accepted frame.
+// Copies control-relevant frames (FS20/FHT8V and 'O' valve frames) to a small high-priority queue
+// that handleQueuedMessages() empties first, and returns true if it did so,
+// in which case the frame should not also go in the main queue.
+// Falls back to the main queue (returning false) if the priority queue is full.
+bool rxPriorityDivertISR(const volatile uint8_t *buf, uint8_t buflen);
+#endif // ENABLE_RX_PRIORITY_QUEUE
+#if defined(ENABLE_RX_BATCH_DRAIN)
+// Sub-cycle tick budget for one batch drain; ~0.25s, eg several plain frames or one secure frame.
+static constexpr uint8_t RX_BATCH_DRAIN_BUDGET_SCT = OTV0P2BASE::GSCT_MAX/8;
+#endif // ENABLE_RX_BATCH_DRAIN
+#if defined(ENABLE_RX_FRAME_CAPTURE)
+// Read one 'R' record (as captured) from Serial and decode its frame as if just received.
+// Gives up at sub-cycle time stopBy; returns true iff a frame was decoded.
+// Replayed secure frames get no special treatment: each must still carry an RX message counter
+// above the one held for its sender (in EEPROM, and in RAM with ENABLE_RX_ASSOC_INDEX) or it is rejected
+// with "?RX auth", and one that authenticates advances (and persists) that sender's counter.
+// So a capture replays only once into a hub, and only if that hub has not already seen later frames
+// from the same senders (so not the capturing hub itself unless its associations are cleared and re-added);
+// a live sender's next frame then still gets through, its counter being later than any captured.
+bool replayRXFrame(uint8_t stopBy);
+#endif // ENABLE_RX_FRAME_CAPTURE
 #else
 #define handleQueuedMessages(p, wakeSerialIfNeeded, rl) (false)
 #endif
@@ -190,11 +1398,147 @@ bool handleQueuedMessages(Print *p, bool wakeSerialIfNeeded, OTRadioLink::OTRadi
 
 /////// CONTROL (EARLY, NOT DEPENDENT ON OTHER SENSORS)
 
+// Finish with Serial after powering it up with powerUpSerialIfDisabled().
+// HardwareSerial TX is already buffered and drained by the USART UDRE interrupt,
+// so with ENABLE_DEFERRED_SERIAL_POWERDOWN this leaves output to drain
+// while the end-of-cycle sleep idles the CPU, and powers Serial down there,
+// else flushes and powers down immediately.
+#if defined(ENABLE_DEFERRED_SERIAL_POWERDOWN)
+#define releaseSerial() {}
+#else
+#define releaseSerial() { OTV0P2BASE::flushSerialProductive(); OTV0P2BASE::powerDownSerial(); }
+#endif // ENABLE_DEFERRED_SERIAL_POWERDOWN
+
+// On-chip peripherals with OTV0P2BASE::powerUpXXXIfDisabled() / powerDownXXX() pairs.
+enum peripheral_t : uint8_t { PP_SERIAL, PP_SPI, PP_TWI, PP_ADC, PP_COUNT };
+// Power up p if not already, returning true if it needed it.
+inline bool peripheralPowerUpIfDisabled(const peripheral_t p)
+  {
+  switch(p)
+    {
+    case PP_SERIAL: return(OTV0P2BASE::powerUpSerialIfDisabled<V0P2_UART_BAUD>());
+    case PP_SPI: return(OTV0P2BASE::powerUpSPIIfDisabled());
+    case PP_TWI: return(OTV0P2BASE::powerUpTWIIfDisabled());
+    case PP_ADC: return(OTV0P2BASE::powerUpADCIfDisabled());
+    default: return(false);
+    }
+  }
+// Power down p; Serial is finished with as by releaseSerial().
+inline void peripheralPowerDown(const peripheral_t p)
+  {
+  switch(p)
+    {
+    case PP_SERIAL: releaseSerial(); break;
+    case PP_SPI: OTV0P2BASE::powerDownSPI(); break;
+    case PP_TWI: OTV0P2BASE::powerDownTWI(); break;
+    case PP_ADC: OTV0P2BASE::powerDownADC(); break;
+    default: break;
+    }
+  }
+#if defined(ENABLE_PERIPHERAL_POWER_REFS)
+// Take and drop a counted hold on p.
+// The first hold powers p up if needed and the last release powers it down again
+// only if the first hold did, so anything powered up outside the holds is left alone.
+void peripheralHold(peripheral_t p);
+void peripheralRelease(peripheral_t p);
+// Keeps peripheral P powered while in scope.
+// Nested and overlapping instances share the one power-up (and any settle delay).
+template<peripheral_t P> class PeripheralPower final
+  {
+  public:
+    PeripheralPower() { peripheralHold(P); }
+    ~PeripheralPower() { peripheralRelease(P); }
+    PeripheralPower(const PeripheralPower &) = delete;
+    PeripheralPower &operator=(const PeripheralPower &) = delete;
+  };
+#else
+// Stand-in with the old powerUpXXXIfDisabled() / neededWaking semantics so that call sites need no conditionals.
+template<peripheral_t P> class PeripheralPower final
+  {
+  private:
+    const bool neededWaking;
+  public:
+    PeripheralPower() : neededWaking(peripheralPowerUpIfDisabled(P)) { }
+    ~PeripheralPower() { if(neededWaking) { peripheralPowerDown(P); } }
+    PeripheralPower(const PeripheralPower &) = delete;
+    PeripheralPower &operator=(const PeripheralPower &) = delete;
+  };
+#endif // ENABLE_PERIPHERAL_POWER_REFS
+
+// Lock-free single-producer single-consumer ring of N (a power of two, at most 128) values of T,
+// eg for events from an ISR or the RX path to the main loop.
+// Holds up to N-1 values; put() when full drops the new value and returns false.
+// Each 8-bit index is written by only one side and single-byte loads/stores are atomic on AVR,
+// and an entry is written before the head index is moved past it,
+// so neither side needs interrupts disabled even if T is wider than a byte.
+template<typename T, uint8_t N> class SPSCRing final
+  {
+  static_assert((0 != N) && (0 == (N & (N - 1))) && (N <= 128), "N must be a power of two <= 128");
+  private:
+    volatile T buf[N];
+    volatile uint8_t head; // Written only by the producer.
+    volatile uint8_t tail; // Written only by the consumer.
+  public:
+    // Producer side.
+    bool put(const T v)
+      {
+      const uint8_t h = head;
+      const uint8_t next = (h + 1) & (N - 1);
+      if(next == tail) { return(false); }
+      buf[h] = v;
+      head = next;
+      return(true);
+      }
+    // Consumer side.
+    bool isEmpty() const { return(head == tail); }
+    // Take the oldest value into v; false if none.
+    bool get(T &v)
+      {
+      const uint8_t t = tail;
+      if(t == head) { return(false); }
+      v = buf[t];
+      tail = (t + 1) & (N - 1);
+      return(true);
+      }
+  };
+
 // Radiator valve mode (FROST, WARM, BAKE).
 extern OTRadValve::ValveMode valveMode;
 
 // IF DEFINED: support for general timed and multi-input occupancy detection / use.
-#ifdef ENABLE_OCCUPANCY_SUPPORT
+#if defined(ENABLE_OCCUPANCY_CACHE)
+// Occupancy tracker whose vacancy-derived values are computed once per read() (ie per minute)
+// and on setHolidayMode(), so that per-pass calls such as longVacant() are plain field reads.
+// Any mark of occupancy since (including via a base-class pointer, eg from the UI)
+// shows up at once as the room becoming likely occupied, which zeroes vacancy as the library does.
+class CachedOccupancyTracker final : public OTV0P2BASE::PseudoSensorOccupancyTracker
+  {
+  private:
+    uint8_t vacancyHCached;
+    bool longVacantCached;
+    bool longLongVacantCached;
+    // True if likely occupied when the cache was filled.
+    bool occupiedWhenCached;
+    void refresh()
+      {
+      const uint16_t h = PseudoSensorOccupancyTracker::getVacancyH();
+      vacancyHCached = (uint8_t)((h > 255) ? 255 : h);
+      longVacantCached = PseudoSensorOccupancyTracker::longVacant();
+      longLongVacantCached = PseudoSensorOccupancyTracker::longLongVacant();
+      occupiedWhenCached = isLikelyOccupied();
+      }
+    bool markedSinceCached() { return(!occupiedWhenCached && isLikelyOccupied()); }
+
+  public:
+    CachedOccupancyTracker() : vacancyHCached(0), longVacantCached(false), longLongVacantCached(false), occupiedWhenCached(false) { }
+    virtual uint8_t read() override { const uint8_t v = PseudoSensorOccupancyTracker::read(); refresh(); return(v); }
+    void setHolidayMode() { PseudoSensorOccupancyTracker::setHolidayMode(); refresh(); }
+    uint16_t getVacancyH() { return(markedSinceCached() ? 0 : vacancyHCached); }
+    bool longVacant() { return(longVacantCached && !markedSinceCached()); }
+    bool longLongVacant() { return(longLongVacantCached && !markedSinceCached()); }
+  };
+typedef CachedOccupancyTracker OccupancyTracker;
+#elif defined(ENABLE_OCCUPANCY_SUPPORT)
 typedef OTV0P2BASE::PseudoSensorOccupancyTracker OccupancyTracker;
 #else
 // Placeholder class with dummy static status methods to reduce code complexity.
@@ -247,19 +1591,110 @@ extern AmbientLight AmbLight;
 extern OTV0P2BASE::MinimalOneWire<> MinOW_DEFAULT_OWDQ;
 #endif
 
+#if defined(ENABLE_DS18B20_SPLIT_CONVERSION) && defined(ENABLE_MINIMAL_ONEWIRE_SUPPORT) && (defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20) || defined(ENABLE_EXTERNAL_TEMP_SENSOR_DS18B20))
+#define DS18B20_SPLIT_CONVERSION
+#if defined(ENABLE_DS18B20_ROM_CACHE)
+#define DS18B20_ROM_CACHE
+// Table of DS18B20 ROM IDs in bus search order, 8 bytes each, first byte 0xff if unused.
+// Each entry carries its own Dallas CRC, so a corrupt or erased table is rediscovered.
+// Rediscovered at boot if invalid and whenever a cached sensor fails to answer with a good scratchpad CRC.
+// Lives in the last node association set, so is not available on nodes that keep associations.
+#if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) && defined(ENABLE_RADIO_RX) && (defined(ENABLE_BOILER_HUB) || defined(ENABLE_STATS_RX))
+#error ENABLE_DS18B20_ROM_CACHE would overwrite node associations
+#endif
+#if defined(ENABLE_HIGH_RES_STATS_RING)
+#error ENABLE_DS18B20_ROM_CACHE would overlap the high-res stats ring
+#endif
+static constexpr intptr_t V0P2_EE_START_DS18B20_ROMS = OTV0P2BASE::V0P2BASE_EE_START_NODE_ASSOCIATIONS +
+    (OTV0P2BASE::V0P2BASE_EE_NODE_ASSOCIATIONS_MAX_SETS - 1) * OTV0P2BASE::V0P2BASE_EE_NODE_ASSOCIATIONS_SET_SIZE;
+static constexpr uint8_t V0P2_EE_DS18B20_ROMS = 4;
+#endif
+// DS18B20 whose conversion can be started well ahead of read(),
+// so that read() only fetches the scratchpad rather than napping through the conversion.
+// A skip-ROM convert starts every DS18B20 on the bus at once, so several convert in parallel.
+// Without a preceding startConversion() read() behaves as the base class, blocking until done.
+class TemperatureC16_DS18B20_Split : public OTV0P2BASE::TemperatureC16_DS18B20
+  {
+  private:
+    // Bus shared with the base class (whose reference is private).
+    OTV0P2BASE::MinimalOneWireBase &bus;
+    // True once a conversion has been started and not yet collected.
+    bool pending;
+#if defined(DS18B20_ROM_CACHE)
+    // Number of valid ROM IDs in the EEPROM table; 0xff until loaded, 0xfe if a resync is needed.
+    uint8_t romCount;
+    // Load the ROM table from EEPROM, or rediscover and store it if empty or invalid.
+    void loadROMs(bool rediscover);
+#endif
+
+  public:
+    TemperatureC16_DS18B20_Split(OTV0P2BASE::MinimalOneWireBase &ow, uint8_t _precision = DEFAULT_PRECISION)
+      : TemperatureC16_DS18B20(ow, _precision), bus(ow), pending(false)
+#if defined(DS18B20_ROM_CACHE)
+        , romCount(0xff)
+#endif
+      { }
+
+    // Start conversion on all DS18B20s on the bus and return at once.
+    // Must be called at least one conversion time (750ms at 12 bits) before read().
+    void startConversion();
+
+    // Collect the result of the last startConversion() without waiting, else read as the base class.
+    virtual int16_t read();
+
+    // As readMultiple() but collecting the results of the last startConversion() without waiting.
+    uint8_t collectMultiple(int16_t *values, uint8_t count, uint8_t index = 0);
+  };
+#endif
+
 // Cannot have internal and external use of same DS18B20 at same time...
 #if defined(ENABLE_EXTERNAL_TEMP_SENSOR_DS18B20) && !defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20) && defined(ENABLE_MINIMAL_ONEWIRE_SUPPORT)
 #define SENSOR_EXTERNAL_DS18B20_ENABLE_0 // Enable sensor zero.
+#if defined(DS18B20_SPLIT_CONVERSION)
+extern TemperatureC16_DS18B20_Split extDS18B20_0;
+#else
 extern OTV0P2BASE::TemperatureC16_DS18B20 extDS18B20_0;
 #endif
+#endif
+
+#if defined(ENABLE_SHT21_SPLIT_CONVERSION) && defined(ENABLE_PRIMARY_TEMP_SENSOR_SHT21)
+#define SHT21_SPLIT_CONVERSION
+// SHT21 temperature whose measurement can be triggered (no-hold-master) well ahead of read(),
+// so that read() only fetches the result rather than napping with TWI powered through the conversion.
+// Without a preceding startConversion() (or if the result is not ready) read() behaves as the base class.
+// Humidity is left to the base class: its 8-bit conversion is ~4ms and it keeps private hysteresis state.
+class RoomTemperatureC16_SHT21_Split : public OTV0P2BASE::RoomTemperatureC16_SHT21
+  {
+  private:
+    // True once a measurement has been triggered and not yet fetched.
+    bool pending;
+
+  public:
+    RoomTemperatureC16_SHT21_Split() : pending(false) { }
+
+    // Trigger a no-hold-master temperature measurement and return at once.
+    // Must be called at least one conversion time (22ms at 12 bits) before read(),
+    // and with no humidity measurement in between, as that replaces the pending one.
+    void startConversion();
+
+    // Fetch the result of the last startConversion() without waiting, else read as the base class.
+    virtual int16_t read();
+  };
+#endif
 
 // Ambient/room temperature sensor, usually on main board.
-#if defined(ENABLE_PRIMARY_TEMP_SENSOR_SHT21)
+#if defined(SHT21_SPLIT_CONVERSION)
+extern RoomTemperatureC16_SHT21_Split TemperatureC16; // SHT21 impl.
+#elif defined(ENABLE_PRIMARY_TEMP_SENSOR_SHT21)
 extern OTV0P2BASE::RoomTemperatureC16_SHT21 TemperatureC16; // SHT21 impl.
 #elif defined(ENABLE_PRIMARY_TEMP_SENSOR_DS18B20)
   #if defined(ENABLE_MINIMAL_ONEWIRE_SUPPORT)
   // DSB18B20 temperature impl, with slightly reduced precision to improve speed.
+  #if defined(DS18B20_SPLIT_CONVERSION)
+  extern TemperatureC16_DS18B20_Split TemperatureC16;
+  #else
   extern OTV0P2BASE::TemperatureC16_DS18B20 TemperatureC16;
+  #endif
   #endif // defined(ENABLE_MINIMAL_ONEWIRE_SUPPORT)
 #else // Don't use TMP112 if SHT21 or DS18B20 have been selected.
 extern OTV0P2BASE::RoomTemperatureC16_TMP112 TemperatureC16;
@@ -283,6 +1718,10 @@ extern OTV0P2BASE::DummyHumiditySensorSHT21 RelHumidity;
 #endif
 
 #ifdef ENABLE_VOICE_SENSOR
+// NOTE: the QM1 module does its own audio processing and only signals detections by interrupt.
+// Acoustic band-energy occupancy features (eg with 3rdParty/avrfft at FFT_N=64, ~6kB tables less at 64 points)
+// would need a board with an analogue microphone on a spare ADC input, which no current V0p2 REV has,
+// and ffft.S built into the sketch with FFT_N set in ffft.h, since the IDE does not build 3rdParty/.
 extern OTV0P2BASE::VoiceDetectionQM1 Voice;
 #endif
 
@@ -332,11 +1771,30 @@ void setMinBoilerOnMinutes(uint8_t mins);
 #define setMinBoilerOnMinutes(mins) {} // Do nothing.
 #endif
 
+#if defined(ENABLE_BOILER_HUB_CHECKPOINT)
+// Boiler hub state checkpoint, in the otherwise unused top of the OTV0P2BASE radio config area:
+//   [0] local minutes since midnight of the checkpoint, high byte
+//   [1] low byte
+//   [2] BOILER_CP_ON if the boiler was on, BOILER_CP_OFF if off; anything else (eg erased 0xff) for none
+// Written via the EEPROM write queue as the boiler turns on or off, but no more than once every BOILER_CP_MIN_INTERVAL_M minutes,
+// and hourly while it stays on; so each byte is rewritten at most 48 times a day, ~5 years to 100k writes for a hub that cycles a lot.
+// A change within the interval is checkpointed when it ends, so after a reset the boiler may briefly repeat its previous state.
+// After a watchdog or brown-out reset (not power-on, after which the time off is unknown)
+// a boiler that was on within the last hour comes straight back on for the minimum on time,
+// and one that was off is credited with the time since towards its minimum off time.
+// Allocated with the other application bytes in the radio config area.
+static constexpr uint8_t BOILER_CP_OFF = 0;
+static constexpr uint8_t BOILER_CP_ON = 1;
+static constexpr uint8_t BOILER_CP_MIN_INTERVAL_M = 30;
+// Call once early in setup(), after the RTC is restored, with the captured MCUSR reset cause.
+void boilerCheckpointSetup(uint8_t resetCause);
+#endif // ENABLE_BOILER_HUB_CHECKPOINT
+
 #if defined(ENABLE_DEFAULT_ALWAYS_RX)
 // True: always in central hub/listen mode.
-#define inHubMode() (true)
+#define inHubMode() profileHas(PROFILE_HUB)
 // True: always in stats hub/listen mode.
-#define inStatsHubMode() (true)
+#define inStatsHubMode() profileHas(PROFILE_HUB)
 #elif !defined(ENABLE_RADIO_RX)
 // No RX/listening allowed, so never in hub mode.
 // False: never in central hub/listen mode.
@@ -345,9 +1803,9 @@ void setMinBoilerOnMinutes(uint8_t mins);
 #define inStatsHubMode() (false)
 #else
 // True if in central hub/listen mode (possibly with local radiator also).
-#define inHubMode() (0 != getMinBoilerOnMinutes())
+#define inHubMode() (profileHas(PROFILE_HUB) && (0 != getMinBoilerOnMinutes()))
 // True if in stats hub/listen mode (minimum timeout).
-#define inStatsHubMode() (1 == getMinBoilerOnMinutes())
+#define inStatsHubMode() (profileHas(PROFILE_HUB) && (1 == getMinBoilerOnMinutes()))
 #endif // defined(ENABLE_DEFAULT_ALWAYS_RX)
 
 // Period in minutes for simple learned on-time; strictly positive (and less than 256).
@@ -378,6 +1836,12 @@ typedef OTRadValve::SimpleValveSchedule
 typedef OTRadValve::NULLValveSchedule Scheduler_t;
 #endif // defined(ENABLE_SINGLETON_SCHEDULE)
 extern Scheduler_t Scheduler;
+#if defined(ENABLE_SCHEDULE_TRANSITION_CACHE) && defined(SCHEDULER_AVAILABLE)
+// Force the cached schedule transition times to be rebuilt, eg after a schedule or clock change.
+void invalidateScheduleCache();
+#else
+#define invalidateScheduleCache() {}
+#endif
 
 #if defined(ENABLE_LOCAL_TRV)
 #define ENABLE_MODELLED_RAD_VALVE
@@ -390,21 +1854,180 @@ extern OTRadValve::ModelledRadValve NominalRadValve;
 #define NominalRadValve FHT8V
 #endif
 
+#if defined(ENABLE_SECURE_VALVE_SHORT_FRAME) && defined(ENABLE_NOMINAL_RAD_VALVE)
+// Note the valve % just sent in a full stats frame, so that it is not repeated in a short frame.
+void noteValvePCReported(uint8_t valvePC);
+// Send the modelled valve % in a short secure frame iff it has changed since last reported; true if sent.
+bool valveShortFrameTX();
+#endif
+
 
 /////// STATS
 
+#if defined(ENABLE_SECURE_STATS_TLV)
+// Compact binary alternative to JSON stats after the two leading bytes of a secure 'O' frame body,
+// flagged by STATS_TLV_BODY_FLAG in body byte 1 (cf 0x10 for JSON).
+// Each item is a tag byte (value length [1,2] in bits 7--6, STLV_XXX code in bits 5--0)
+// followed by the value, big-endian: 2-byte values are signed, 1-byte values are unsigned.
+// Eg temperature takes 3 bytes rather than about 12 as JSON.
+// Decoders skip unknown codes using the length.
+static constexpr uint8_t STATS_TLV_BODY_FLAG = 0x20;
+enum statsTLVCode_t : uint8_t
+  {
+  STLV_NONE = 0, // Reserved.
+  STLV_T_C16, // "T|C16" temperature, C/16.
+  STLV_H_PC, // "H|%" relative humidity.
+  STLV_L, // "L" ambient light.
+  STLV_O, // "O" two-bit occupancy.
+  STLV_VAC_H, // "vac|h" hours vacancy.
+  STLV_B_CV, // "B|cV" supply voltage, centivolts.
+  STLV_V_PC, // "v|%" valve open.
+  STLV_TT_C, // "tT|C" target temperature.
+  STLV_TS_C, // "tS|C" setback.
+  STLV_VC_PC, // "vC|%" cumulative valve movement.
+  STLV_B, // "b" boiler on.
+  STLV_GE, // "gE" setback lockout.
+  STLV_MAX_CODE = STLV_GE
+  };
+// Write TLV stats for this node into buf (at most buflen bytes) honouring privacyLevel as for JSON stats.
+// Returns the number of bytes written, or 0 if nothing is allowed at privacyLevel or any allowed item did not fit.
+uint8_t writeStatsTLV(uint8_t *buf, uint8_t buflen, uint8_t privacyLevel);
+// Print TLV stats to p as one line of JSON, with synthetic "@" ID (idLen bytes) and "+" seq fields.
+void printStatsTLVAsJSON(Print *p, const uint8_t *id, uint8_t idLen, uint8_t seq, const uint8_t *tlv, uint8_t len);
+#endif // ENABLE_SECURE_STATS_TLV
+
+#if defined(ENABLE_STATS_SET_UPLOAD)
+// Background upload of the by-hour stats sets, for analysis off the node, one set per secure 'O' frame.
+// Body, flagged by STATS_SET_BODY_FLAG in byte 1:
+//   [0] 0x7f (no valve %, so hubs ignore it for call for heat)
+//   [1] STATS_SET_BODY_FLAG
+//   [2] stats set number [0,V0P2BASE_EE_STATS_SETS-1]
+//   [3] upload pass number, incremented (mod 256) after each complete pass over the sets
+//   [4..27] the set's raw values for hours 0 to 23, 0xff where unset
+// A whole set fits within the padded fixed-size encrypted body, so needs no reassembly.
+static constexpr uint8_t STATS_SET_BODY_FLAG = 0x40;
+static constexpr uint8_t STATS_SET_BODY_LEN = 4 + 24;
+#if defined(ENABLE_RADIO_RX)
+// Print an uploaded stats set to p as one line of JSON, with synthetic "@" ID (idLen bytes) and "+" seq fields.
+void printStatsSetAsJSON(Print *p, const uint8_t *id, uint8_t idLen, uint8_t seq, const uint8_t *body);
+#endif
+#endif // ENABLE_STATS_SET_UPLOAD
+
+#if defined(ENABLE_PACKED_NV_STATS)
+// EEPROM by-hour stats with the [0,100] % sets held as 4-bit codes,
+// the smoothed set in the low nibble of the 'last' set's byte for the same hour:
+//   * occupancy % (STATS_SET_OCCPC_BY_HOUR and _SMOOTHED)
+//   * relative humidity % (STATS_SET_RHPC_BY_HOUR and _SMOOTHED)
+// Codes 0--14 span 0--100% in ~7% steps, and 15 is unset, so an erased byte is both sets unset.
+// Encoding rounds up or down at random in proportion, so smoothed values still track small changes.
+// The EEPROM of the smoothed sets (V0P2_EE_START_PACKED_STATS_FREE*) is left unused.
+// All other sets are stored as bytes as usual.
+// Byte-format data already in EEPROM is folded into nibbles once by migrate().
+class PackedByHourByteStats final : public OTV0P2BASE::NVByHourByteStatsBase
+  {
+  private:
+    OTV0P2BASE::EEPROMByHourByteStats ee;
+    // Encode a [0,100] value (or STATS_UNSET_BYTE) as a 4-bit code.
+    static uint8_t encode(uint8_t value);
+  public:
+    // True if statsSet is held in a nibble; writes to these are counted here as EEW_STATS wear.
+    static bool isPacked(const uint8_t statsSet)
+      { return((statsSet >= STATS_SET_OCCPC_BY_HOUR) && (statsSet <= STATS_SET_RHPC_BY_HOUR_SMOOTHED)); }
+    // Value in V0P2_EE_START_STATS_FORMAT once the sets are held as nibbles.
+    static constexpr uint8_t FORMAT_PACKED = 1;
+    // Fold byte-format OCCPC/RHPC data into nibbles if not already done; call once at boot before any stats access.
+    void migrate();
+    virtual bool zapStats(uint16_t maxBytesToErase = 0) override { return(ee.zapStats(maxBytesToErase)); }
+    virtual uint8_t getByHourStatRaw(uint8_t statsSet, uint8_t hh) const override;
+    virtual void setByHourStatRaw(uint8_t statsSet, uint8_t hh, uint8_t value) override;
+  };
+static constexpr intptr_t V0P2_EE_START_PACKED_STATS_FREE1 = V0P2BASE_EE_STATS_START_ADDR(V0P2BASE_EE_STATS_SET_OCCPC_BY_HOUR_SMOOTHED);
+static constexpr intptr_t V0P2_EE_START_PACKED_STATS_FREE2 = V0P2BASE_EE_STATS_START_ADDR(V0P2BASE_EE_STATS_SET_RHPC_BY_HOUR_SMOOTHED);
+// Each packed pair must be a 'last' set at an even number with its smoothed set next, contiguous for isPacked().
+static_assert(0 == (V0P2BASE_EE_STATS_SET_OCCPC_BY_HOUR & 1), "OCCPC last set must be even");
+static_assert(V0P2BASE_EE_STATS_SET_OCCPC_BY_HOUR_SMOOTHED == V0P2BASE_EE_STATS_SET_OCCPC_BY_HOUR + 1, "OCCPC sets must pair");
+static_assert(V0P2BASE_EE_STATS_SET_RHPC_BY_HOUR == V0P2BASE_EE_STATS_SET_OCCPC_BY_HOUR_SMOOTHED + 1, "RHPC sets must follow OCCPC");
+static_assert(V0P2BASE_EE_STATS_SET_RHPC_BY_HOUR_SMOOTHED == V0P2BASE_EE_STATS_SET_RHPC_BY_HOUR + 1, "RHPC sets must pair");
+typedef PackedByHourByteStats NVStatsStore_t;
+#else
+typedef OTV0P2BASE::EEPROMByHourByteStats NVStatsStore_t;
+#endif // ENABLE_PACKED_NV_STATS
+
+#if defined(ENABLE_NV_STATS_RAM_SHADOW)
+// EEPROM by-hour stats with a RAM shadow of two hours (usually current and previous) for all stats sets.
+// Reads of shadowed hours come from RAM; writes go to RAM and are marked dirty,
+// and only reach EEPROM in flush(), or when a column is recycled for another hour.
+// Repeated updates within an hour (eg partial then full samples) thus cost one EEPROM write,
+// but up to an hour of updates may be lost on a reset.
+class ShadowedByHourByteStats final : public OTV0P2BASE::NVByHourByteStatsBase
+  {
+  private:
+    static constexpr uint8_t SETS = STATS_SETS_COUNT;
+    static_assert(SETS <= 16, "dirty mask must hold all sets");
+    static constexpr uint8_t NO_HOUR = 0xff;
+    // Underlying store.
+    NVStatsStore_t ee;
+    // Hour held in each column, or NO_HOUR.
+    uint8_t hours[2] = { NO_HOUR, NO_HOUR };
+    uint8_t values[2][SETS];
+    uint16_t dirty[2] = { 0, 0 }; // Bit n set if set n needs writing.
+    uint8_t newest = 0; // Most recently loaded column.
+    // Column holding hour hh, or -1.
+    int8_t column(const uint8_t hh) const { return((hh == hours[0]) ? 0 : ((hh == hours[1]) ? 1 : -1)); }
+    // Write back any dirty values in column c.
+    void flushColumn(uint8_t c);
+    // Load hour hh into the older column, writing that back first; returns the column.
+    uint8_t load(uint8_t hh);
+  public:
+    virtual bool zapStats(uint16_t maxBytesToErase = 0) override;
+    virtual uint8_t getByHourStatRaw(uint8_t statsSet, uint8_t hh) const override;
+    virtual void setByHourStatRaw(uint8_t statsSet, uint8_t hh, uint8_t value) override;
+    // Write all dirty values to EEPROM; call once an hour after the final sample.
+    void flush() { flushColumn(0); flushColumn(1); }
+#if defined(ENABLE_PACKED_NV_STATS)
+    // Migrate the underlying store; call before anything is shadowed.
+    void migrate() { ee.migrate(); }
+#endif
+  };
 // Singleton non-volatile stats store instance.
-extern OTV0P2BASE::EEPROMByHourByteStats eeStats;
+extern ShadowedByHourByteStats eeStats;
+#else
+// Singleton non-volatile stats store instance.
+extern NVStatsStore_t eeStats;
+#endif // ENABLE_NV_STATS_RAM_SHADOW
+
+// Sensor registry for this config, used to build the stats updater and '=' status line below.
+// Each V0P2_SENSOR_XXX(base_t) expands to the 'type, address' template arguments for that sensor,
+// or to a base_t NULL placeholder if it is absent so that the template drops its code at compile time;
+// base_t is whatever placeholder type the consuming template accepts.
+#define V0P2_SENSOR_PRESENT(s) decltype(s), &(s)
+#define V0P2_SENSOR_ABSENT(base_t) base_t, static_cast<base_t *>(NULL)
+#if defined(ENABLE_OCCUPANCY_SUPPORT)
+#define V0P2_SENSOR_OCCUPANCY(base_t) V0P2_SENSOR_PRESENT(Occupancy)
+#else
+#define V0P2_SENSOR_OCCUPANCY(base_t) V0P2_SENSOR_ABSENT(base_t)
+#endif
+#if defined(ENABLE_AMBLIGHT_SENSOR)
+#define V0P2_SENSOR_AMBLIGHT(base_t) V0P2_SENSOR_PRESENT(AmbLight)
+#else
+#define V0P2_SENSOR_AMBLIGHT(base_t) V0P2_SENSOR_ABSENT(base_t)
+#endif
+#if defined(HUMIDITY_SENSOR_SUPPORT)
+#define V0P2_SENSOR_RH(base_t) V0P2_SENSOR_PRESENT(RelHumidity)
+#else
+#define V0P2_SENSOR_RH(base_t) V0P2_SENSOR_ABSENT(base_t)
+#endif
+#if defined(ENABLE_LOCAL_TRV)
+#define V0P2_SENSOR_VALVE(base_t) V0P2_SENSOR_PRESENT(NominalRadValve)
+#else
+#define V0P2_SENSOR_VALVE(base_t) V0P2_SENSOR_ABSENT(base_t)
+#endif
 
 // Singleton stats-updater object.
 typedef 
     OTV0P2BASE::ByHourSimpleStatsUpdaterSampleStats <
       decltype(eeStats), &eeStats,
-#if defined(ENABLE_OCCUPANCY_SUPPORT)
-      decltype(Occupancy), &Occupancy,
-#else
-      OTV0P2BASE::SimpleTSUint8Sensor, static_cast<OTV0P2BASE::SimpleTSUint8Sensor*>(NULL), // Save code space when no occupancy tracking.
-#endif
+      V0P2_SENSOR_OCCUPANCY(OTV0P2BASE::SimpleTSUint8Sensor), // Save code space when no occupancy tracking.
       decltype(AmbLight), &AmbLight,
       decltype(TemperatureC16), &TemperatureC16,
       decltype(RelHumidity), &RelHumidity,
@@ -412,32 +2035,23 @@ typedef
       > StatsU_t;
 extern StatsU_t statsU;
 
+#if defined(ENABLE_BY_HOUR_STATS_AGGREGATE_CACHE)
+// Forget cached by-hour stats aggregates; call after anything that may write stats (sampling, CLI zap).
+void invalidateByHourStatsAggregates();
+#else
+#define invalidateByHourStatsAggregates() {}
+#endif // ENABLE_BY_HOUR_STATS_AGGREGATE_CACHE
+
 
 // Mechanism to generate '=' stats line, if enabled.
 #if defined(ENABLE_SERIAL_STATUS_REPORT)
 typedef OTV0P2BASE::SystemStatsLine<
       decltype(valveMode), &valveMode,
-#if defined(ENABLE_LOCAL_TRV)
-      decltype(NominalRadValve), &NominalRadValve,
-#else
-      OTRadValve::AbstractRadValve, (OTRadValve::AbstractRadValve *)NULL,
-#endif // defined(ENABLE_LOCAL_TRV)
+      V0P2_SENSOR_VALVE(OTRadValve::AbstractRadValve),
       decltype(TemperatureC16), &TemperatureC16,
-#if defined(HUMIDITY_SENSOR_SUPPORT)
-      decltype(RelHumidity), &RelHumidity,
-#else
-      OTV0P2BASE::HumiditySensorBase, (OTV0P2BASE::HumiditySensorBase *)NULL,
-#endif // defined(HUMIDITY_SENSOR_SUPPORT)
-#ifdef ENABLE_AMBLIGHT_SENSOR
-      decltype(AmbLight), &AmbLight,
-#else
-      OTV0P2BASE::SensorAmbientLight, (OTV0P2BASE::SensorAmbientLight *)NULL,
-#endif
-#ifdef ENABLE_OCCUPANCY_SUPPORT
-      decltype(Occupancy), &Occupancy,
-#else
-      OTV0P2BASE::PseudoSensorOccupancyTracker, (OTV0P2BASE::PseudoSensorOccupancyTracker*)NULL,
-#endif
+      V0P2_SENSOR_RH(OTV0P2BASE::HumiditySensorBase),
+      V0P2_SENSOR_AMBLIGHT(OTV0P2BASE::SensorAmbientLight),
+      V0P2_SENSOR_OCCUPANCY(OTV0P2BASE::PseudoSensorOccupancyTracker),
       decltype(Scheduler), &Scheduler,
 #if defined(ENABLE_JSON_OUTPUT) && !defined(ENABLE_TRIMMED_MEMORY)
       true // Enable JSON stats.
@@ -446,9 +2060,18 @@ typedef OTV0P2BASE::SystemStatsLine<
 #endif
       > StatsLine_t;
 extern StatsLine_t statsLine;
+#if defined(ENABLE_BINARY_STATUS_RECORD)
+// Status output format, in the raw inspectable EEPROM area so selectable at run time with G;
+// V0P2_STATUS_FORMAT_BINARY sends an 'S' binary record, anything else (eg erased 0xff) the usual text line.
+static constexpr intptr_t V0P2_EE_START_STATUS_FORMAT = OTV0P2BASE::V0P2BASE_EE_START_RAW_INSPECTABLE + 8;
+static constexpr uint8_t V0P2_STATUS_FORMAT_BINARY = 1;
+// Send a status report on the serial connection, as a text line or binary record as selected.
+void serialStatusReport();
+#else
 // Send a short 1-line CRLF-terminated status report on the serial connection (at 'standard' baud).
 // Should be similar to PICAXE V0.1 output to allow the same parser to handle either.
 inline void serialStatusReport() { statsLine.serialStatusReport(); }
+#endif // ENABLE_BINARY_STATUS_RECORD
 #else
 #define serialStatusReport() { }
 #endif // defined(ENABLE_SERIAL_STATUS_REPORT)
@@ -462,7 +2085,15 @@ inline void serialStatusReport() { statsLine.serialStatusReport(); }
 // Sends stats on primary radio channel 0 with possible duplicate to secondary channel.
 // If sending encrypted then ID/counter fields (eg @ and + for JSON) are omitted
 // as assumed supplied by security layer to remote recipent.
-void bareStatsTX(bool allowDoubleTX = false, bool doBinary = false);
+// Returns true if a stats frame was built and queued for TX.
+bool bareStatsTX(bool allowDoubleTX = false, bool doBinary = false);
+#if defined(ENABLE_ADAPTIVE_TX_SLOT)
+// Set true by bareStatsTX() if the stats frame could not be queued for TX; cleared by the caller.
+extern bool statsTXFailed;
+#define noteStatsTXFailed() { statsTXFailed = true; }
+#else
+#define noteStatsTXFailed() {}
+#endif // ENABLE_ADAPTIVE_TX_SLOT
 
 #ifdef ENABLE_BOILER_HUB
 // Raw notification of received call for heat from remote (eg FHT8V) unit.
@@ -472,6 +2103,22 @@ void bareStatsTX(bool allowDoubleTX = false, bool doBinary = false);
 // This is not filtered, and can be delivered at any time from RX data, from a non-ISR thread.
 // Does not have to be thread-/ISR- safe.
 void remoteCallForHeatRX(uint16_t id, uint8_t percentOpen);
+#if defined(ENABLE_BOILER_HUB_ZONES)
+// Zone map, in the raw inspectable EEPROM area so set with G:
+// BOILER_ZONE_MAP_ENTRIES of (valve ID high byte, zone), eg FHT8V house code 1 chosen per zone.
+// Valves not mapped (or mapped to a zone beyond the last) are in zone 0.
+static constexpr intptr_t V0P2_EE_START_BOILER_ZONE_MAP = OTV0P2BASE::V0P2BASE_EE_START_RAW_INSPECTABLE + 21;
+static constexpr uint8_t BOILER_ZONE_MAP_ENTRIES = 5;
+static_assert(V0P2_EE_START_BOILER_ZONE_MAP + 2*BOILER_ZONE_MAP_ENTRIES - 1 <= OTV0P2BASE::V0P2BASE_EE_END_RAW_INSPECTABLE, "zone map must fit raw area");
+#endif // ENABLE_BOILER_HUB_ZONES
+#if defined(ENABLE_BOILER_DEMAND_MODEL)
+// Per-valve demand weights (eg by radiator size), in the raw inspectable EEPROM area so set with G:
+// BOILER_VALVE_WEIGHT_ENTRIES of (ID high byte, ID low byte, weight in quarters, eg 4 for 1.0).
+// Valves without an entry, or with an erased (0xff) weight, get weight 1.0; weights are capped at 4.0.
+static constexpr intptr_t V0P2_EE_START_BOILER_VALVE_WEIGHTS = OTV0P2BASE::V0P2BASE_EE_START_RAW_INSPECTABLE + 9;
+static constexpr uint8_t BOILER_VALVE_WEIGHT_ENTRIES = 4;
+static_assert(V0P2_EE_START_BOILER_VALVE_WEIGHTS + 3*BOILER_VALVE_WEIGHT_ENTRIES - 1 <= OTV0P2BASE::V0P2BASE_EE_END_RAW_INSPECTABLE, "weights must fit raw area");
+#endif // ENABLE_BOILER_DEMAND_MODEL
 #endif
 
 ////// UI
@@ -505,6 +2152,529 @@ static constexpr uint8_t BUFSIZ_pollUI = 1 + MAXIMUM_CLI_RESPONSE_CHARS;
 // NOT RE-ENTRANT (eg uses static state for speed and code space).
 void pollCLI(uint8_t maxSCT, bool startOfMinute, const OTV0P2BASE::ScratchSpace &s);
 
+#if defined(ENABLE_SCRATCH_ARENA)
+// Shared static scratch arena for the largest transient buffers,
+// so that their RAM use is fixed at link time rather than adding to peak stack.
+// The paths do nest: the CLI can run stats TX (S) and RX decode (+RXI),
+// and bareStatsTX() handles queued RX after encrypting but while its frame is still live.
+// So only the TX plaintext/key/AES workspace, dead by then, is shared with RX:
+//   [ CLI line | TX frame | TX JSON/plaintext, key, workspace ]
+//                         |            [ RX body, key ]       ]
+static constexpr uint8_t SCRATCH_TX_FRAME_SIZE = 1 + 64 + 1; // Length byte + radio TX buffer + terminator.
+// JSON for the 'O' frame body less 2 leading bytes plus '}' not sent, and 2 for writeJSON().
+static constexpr uint8_t SCRATCH_TX_PTEXT_SIZE = OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE - 2 + 1 + 2;
+static constexpr uint8_t SCRATCH_KEY_SIZE = 16;
+#if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) && !defined(ENABLE_SECURE_STATS_TLV) && !defined(ENABLE_FAST_AES128)
+static constexpr uint8_t SCRATCH_TX_WORKSPACE_SIZE = OTRadioLink::SimpleSecureFrame32or0BodyTXBase::generateSecureOFrameRawForTX_total_scratch_usage_OTAESGCM_2p0;
+#else
+static constexpr uint8_t SCRATCH_TX_WORKSPACE_SIZE = 0;
+#endif
+static constexpr uint8_t SCRATCH_RX_BODY_SIZE = OTRadioLink::ENC_BODY_SMALL_FIXED_PTEXT_MAX_SIZE;
+static constexpr size_t SCRATCH_CLI_OFF = 0;
+static constexpr size_t SCRATCH_TX_FRAME_OFF = SCRATCH_CLI_OFF + BUFSIZ_pollUI;
+static constexpr size_t SCRATCH_TX_PTEXT_OFF = SCRATCH_TX_FRAME_OFF + SCRATCH_TX_FRAME_SIZE;
+static constexpr size_t SCRATCH_TX_KEY_OFF = SCRATCH_TX_PTEXT_OFF + SCRATCH_TX_PTEXT_SIZE;
+static constexpr size_t SCRATCH_TX_WORKSPACE_OFF = SCRATCH_TX_KEY_OFF + SCRATCH_KEY_SIZE;
+static constexpr size_t SCRATCH_RX_BODY_OFF = SCRATCH_TX_PTEXT_OFF;
+static constexpr size_t SCRATCH_RX_KEY_OFF = SCRATCH_RX_BODY_OFF + SCRATCH_RX_BODY_SIZE;
+static constexpr size_t SCRATCH_TX_END = SCRATCH_TX_WORKSPACE_OFF + SCRATCH_TX_WORKSPACE_SIZE;
+static constexpr size_t SCRATCH_RX_END = SCRATCH_RX_KEY_OFF + SCRATCH_KEY_SIZE;
+static constexpr size_t SCRATCH_ARENA_SIZE = (SCRATCH_TX_END > SCRATCH_RX_END) ? SCRATCH_TX_END : SCRATCH_RX_END;
+extern uint8_t scratchArena[SCRATCH_ARENA_SIZE];
+// Region of N bytes at offset OFF, as an array reference so that sizeof() still works where used.
+// Bounds are checked at compile time.
+template<size_t OFF, size_t N> inline uint8_t (&scratchRegion())[N]
+  {
+  static_assert(OFF + N <= SCRATCH_ARENA_SIZE, "scratch region overflows arena");
+  return(*reinterpret_cast<uint8_t (*)[N]>(scratchArena + OFF));
+  }
+#endif // ENABLE_SCRATCH_ARENA
+
+
+////// DIAGNOSTICS
+
+#if defined(ENABLE_SLOT_PROFILER)
+// Minor-cycle slot profiler.
+// Records sub-cycle ticks used by each loopOpenTRV() TIME_LSD slot (indexed by TIME_LSD/2),
+// and by each handleQueuedMessages() and pollCLI() call.
+static constexpr uint8_t PROFILE_SLOTS_LSD = 30; // One per even second in the minute.
+static constexpr uint8_t PROFILE_SLOT_RX = PROFILE_SLOTS_LSD; // handleQueuedMessages().
+static constexpr uint8_t PROFILE_SLOT_CLI = PROFILE_SLOTS_LSD + 1; // pollCLI().
+static constexpr uint8_t PROFILE_SLOTS = PROFILE_SLOTS_LSD + 2;
+// Record one run of the given slot that started at sub-cycle time startSCT and ends now.
+// Not ISR-safe.
+void profileSlot(uint8_t slot, uint8_t startSCT);
+// Clear all profile data.
+void profileReset();
+// Dump profile to Serial as "slot max mean n" lines for used slots, stopping at the given sub-cycle time.
+void profileDump(uint8_t stopBy);
+// Print the nominal per-minute load of this config's slot task table as "L sct", to compare with the profile.
+void printSlotTaskLoad();
+#endif // ENABLE_SLOT_PROFILER
+
+#if defined(ENABLE_OVERRUN_LOG)
+// Loop overrun forensics.
+// Each pass through the loopOpenTRV() body notes the phases it starts and the sub-cycle time of the latest,
+// and on overrun a 4-byte record is written to a small EEPROM ring indexed by the overrun count:
+//   [0] TIME_LSD of the overrunning slot, with bit 7 set if the CLI was active
+//   [1] bit mask of LOOP_PHASE_XXX phases started
+//   [2] sub-cycle time at the last checkpoint
+//   [3] RX queue depth at overrun
+// Erased (0xff) records are unused.
+// Not written with ENABLE_WATCHDOG_SLOW, which forces a reset on overrun instead.
+// Lives at the start of the application-private EEPROM.
+static constexpr uint8_t LOOP_PHASE_UI = 1; // UI / button handling.
+static constexpr uint8_t LOOP_PHASE_FHT8V = 2; // FHT8V TX in any half second.
+static constexpr uint8_t LOOP_PHASE_SLOT = 4; // switch(TIME_LSD) slot task.
+static constexpr uint8_t LOOP_PHASE_STATUS = 8; // Serial status report.
+static constexpr uint8_t LOOP_PHASE_RX = 16; // End-of-loop queued message handling.
+static constexpr uint8_t LOOP_PHASE_VALVE = 32; // Direct valve motor poll.
+static constexpr uint8_t LOOP_PHASE_CLI = 64; // CLI poll.
+extern uint8_t loopPhasesRun;
+extern uint8_t loopLastCheckpointSCT;
+// Note the start of a loop phase; cheap.
+inline void loopCheckpoint(const uint8_t phase) { loopPhasesRun |= phase; loopLastCheckpointSCT = OTV0P2BASE::getSubCycleTime(); }
+// Clear checkpoints at the start of each loop body.
+inline void loopCheckpointsReset() { loopPhasesRun = 0; loopLastCheckpointSCT = 0; }
+// Write an overrun record for TIME_LSD slot lsd; overrunCount is the updated overrun counter.
+void logOverrun(uint8_t lsd, uint8_t overrunCount, uint8_t rxQueued, bool cliActive);
+// Print the overrun log to Serial, most recent first.
+void dumpOverrunLog(uint8_t overrunCount);
+// Erase the overrun log.
+void clearOverrunLog();
+#else
+#define loopCheckpoint(phase) {}
+#define loopCheckpointsReset() {}
+#endif // ENABLE_OVERRUN_LOG
+
+#if defined(ENABLE_TASK_SUPERVISOR)
+// Per-slot-task hang detection, so a task stuck in one slot (eg in a driver or OneWire read)
+// is caught within its own budget rather than only by the whole-cycle RTC watchdog.
+// While a slot task runs, the timer 0 compare B interrupt (free in the Arduino core,
+// and only enabled while supervising) counts down its allowance in sub-cycle ticks;
+// if that runs out, the slot's TIME_LSD is written to EEPROM and the CPU reset.
+// The allowance is SUPERVISOR_BUDGET_SCALE times its nominal budget, and at least SUPERVISOR_MIN_SCT.
+// Time asleep (when timer 0 stops) is counted at the next interrupt after waking.
+// The trip record lives in the last byte of the raw-inspectable area; 0xff (erased) for none.
+// It is reported as "!SV slot" at the next boot and then erased.
+static constexpr intptr_t V0P2_EE_START_SUPERVISOR_TRIP = OTV0P2BASE::V0P2BASE_EE_START_RAW_INSPECTABLE + 31;
+static_assert(V0P2_EE_START_SUPERVISOR_TRIP <= OTV0P2BASE::V0P2BASE_EE_END_RAW_INSPECTABLE, "trip record must fit raw area");
+static constexpr uint8_t SUPERVISOR_BUDGET_SCALE = 4;
+static constexpr uint8_t SUPERVISOR_MIN_SCT = 32;
+// Start supervising slot task lsd with nominal budget budgetSCT; does nothing if budgetSCT is 0 (no task).
+void supervisorArm(uint8_t lsd, uint8_t budgetSCT);
+// Stop supervising; call when the slot task finishes.
+void supervisorDisarm();
+#else
+#define supervisorArm(lsd, budgetSCT) {}
+#define supervisorDisarm() {}
+#endif // ENABLE_TASK_SUPERVISOR
+
+#if defined(ENABLE_HIRES_TIME)
+// Monotonic (non-decreasing) instrumentation timestamp, callable from ISRs:
+//   bits 31..16 minor cycles counted since start (so wraps after about 36h at 2s per cycle)
+//   bits 15..8  getSubCycleTime()
+//   bits 7..0   getCPUCycleCount() (timer 0) ticks since this sub-cycle tick was first seen, saturating.
+// The RTC part runs on through sleep; the timer 0 part stops in sleep but only ever refines a sub-cycle tick.
+// So an interval within one sub-cycle tick is good to one timer 0 tick (64 CPU cycles),
+// and a longer one to within about one sub-cycle tick.
+// Timer 0 runs 8x fast under CPUClockBoost, so within-tick parts of boosted intervals read high.
+// Minor cycles are counted by spotting the sub-cycle time wrapping,
+// so hiresTimePoll() (or hiresTime()) must be called at least once each minor cycle, as the main loop does on each wake.
+uint32_t hiresTime();
+inline void hiresTimePoll() { (void) hiresTime(); }
+// Approximate microseconds from hiresTime() value start to later value end.
+uint32_t hiresElapsedUs(uint32_t start, uint32_t end);
+#else
+#define hiresTimePoll() {}
+#endif // ENABLE_HIRES_TIME
+
+#if defined(ENABLE_ISR_PROFILER)
+// Worst-case ISR duration instrumentation.
+// Timer 1 (otherwise powered down) free-runs at the CPU clock, ie 1 tick per us at the usual 1MHz,
+// powered back up by isrProfileTimerOn() after each OTV0P2BASE::minimisePowerWithoutSleep(),
+// and each instrumented ISR records the ticks from entry to exit into its max and a histogram
+// with bucket 0 < 32 ticks, each later bucket double the last, and the last open-ended.
+// Wake-up from sleep before the ISR starts and the ISR prologue/epilogue are not included.
+// All counters saturate; durations over 65535 ticks wrap and will be under-reported.
+static constexpr uint8_t ISR_PROFILE_PB = 0; // PCINT0: radio nIRQ (RX FIFO read and FilterRXISR()).
+static constexpr uint8_t ISR_PROFILE_PD = 1; // PCINT2: mode button, voice, serial RX wake.
+static constexpr uint8_t ISR_PROFILES = 2;
+static constexpr uint8_t ISR_PROFILE_BUCKETS = 8;
+typedef struct
+  {
+  uint16_t maxTicks; // Worst case seen.
+  uint16_t n; // Number of calls.
+  uint16_t hist[ISR_PROFILE_BUCKETS];
+  } isrProfile_t;
+extern isrProfile_t isrProfiles[ISR_PROFILES];
+// Start timer 1; call after powerSetup().
+void isrProfileSetup();
+// Keep timer 1 powered (and so counting) after OTV0P2BASE::minimisePowerWithoutSleep() turns it off.
+inline void isrProfileTimerOn() { power_timer1_enable(); }
+// Read start time at ISR entry.
+inline uint16_t isrProfileStart() { return(TCNT1); }
+// Record ISR profile slot i which started at timer 1 count start; call only from that ISR, at exit.
+inline void isrProfileRecord(const uint8_t i, const uint16_t start)
+  {
+  const uint16_t ticks = TCNT1 - start;
+  isrProfile_t &e = isrProfiles[i];
+  if(ticks > e.maxTicks) { e.maxTicks = ticks; }
+  if(0xffff != e.n) { ++e.n; }
+  uint8_t b = 0;
+  for(uint16_t t = ticks >> 5; (0 != t) && (b < ISR_PROFILE_BUCKETS-1); t >>= 1) { ++b; }
+  if(0xffff != e.hist[b]) { ++e.hist[b]; }
+  }
+// Clear all ISR profiles.
+void isrProfileReset();
+// Print "ISR name max n h0 .. h7" lines to Serial.
+void isrProfileDump();
+#endif // ENABLE_ISR_PROFILER
+
+#if defined(ENABLE_STACK_TAGS)
+// Tagged stack high-water marks.
+// As for MemoryChecks::recordIfMinSP() the SP is only sampled where tagged,
+// so each mark shows the depth of the app frames on that path down to the tag
+// (for crypto, down to entry to the AES-GCM routine itself) but not any library calls below it.
+static constexpr uint8_t STACK_TAG_TX_JSON = 0; // Stats JSON generation.
+static constexpr uint8_t STACK_TAG_TX_SECURE = 1; // Secure frame encryption for TX.
+static constexpr uint8_t STACK_TAG_RX_SECURE = 2; // Secure frame decryption on RX.
+static constexpr uint8_t STACK_TAG_CLI = 3; // CLI command handling.
+static constexpr uint8_t STACK_TAG_FHT8V = 4; // FHT8V encode and TX.
+static constexpr uint8_t STACK_TAG_ISR = 5; // Radio pin-change ISR.
+static constexpr uint8_t STACK_TAGS = 6;
+// Min SP seen per tag, 0 if not yet seen.
+// STACK_TAG_ISR is written from the ISR; the rest only from the main loop.
+extern volatile uint16_t stackTagMinSP[STACK_TAGS];
+// Note the current SP against the given tag; cheap.
+inline void stackTag(const uint8_t tag)
+  {
+  const uint16_t sp = SP;
+  const uint16_t m = stackTagMinSP[tag];
+  if((0 == m) || (sp < m)) { stackTagMinSP[tag] = sp; }
+  }
+// Lowest headroom (bytes between SP and end of static RAM) over all tags seen, or -1 if none seen.
+int16_t stackTagsMinHeadroom();
+// Print "SHT j t r c f i" headroom per tag to Serial, with - for tags not yet seen.
+void printStackTags();
+#else
+#define stackTag(tag) {}
+#endif // ENABLE_STACK_TAGS
+
+#if defined(ENABLE_LINK_STATS)
+// Radio link health counters, all saturating at 255, cleared only by restart.
+// RX drops and filtered frames are read directly from the primary radio's (wrapping) counters.
+extern uint8_t linkRXErrs; // RX errors reported by getRXErr().
+extern uint8_t linkRXLastErr; // Last non-zero getRXErr() value.
+extern uint8_t linkTXFails; // queueToSend() failures.
+extern uint8_t linkJSONFails; // JSON stats generation/encoding failures.
+#if defined(ENABLE_RX_DUP_FILTER)
+extern uint8_t linkRXDups; // Duplicate RX frames dropped undecoded.
+#endif
+// Bump a saturating counter.
+inline void linkCount(uint8_t &c) { if(c < 255) { ++c; } }
+// Collect and clear pending RX errors from the primary radio.
+void linkPollRXErrs();
+// Print "Link rD rF rE/last tF jF" line (with " dX" if ENABLE_RX_DUP_FILTER) to Serial.
+void printLinkStats();
+#define linkCountTXFail() linkCount(linkTXFails)
+#define linkCountJSONFail() linkCount(linkJSONFails)
+#define linkCountRXDup() linkCount(linkRXDups)
+#else
+#define linkPollRXErrs() {}
+#define linkCountTXFail() {}
+#define linkCountJSONFail() {}
+#define linkCountRXDup() {}
+#endif // ENABLE_LINK_STATS
+
+#if defined(ENABLE_CHANNEL_UTILISATION)
+// Primary channel airtime meter for hubs.
+// pollIO() samples RSSI while listening; a sample at or above CHAN_BUSY_RSSI counts as busy.
+// Figures are for the previous whole minute; 0xff for utilisation if there were no samples.
+extern uint8_t chanUtilPC; // Busy samples as % of samples.
+extern uint8_t chanFrames; // Frames handed to the decoder.
+extern uint8_t chanBadFrames; // Of which could not be decoded (bad CRC, unknown type, failed auth).
+// Sample the channel; cheap, called from pollIO(); takes at most one sample per sub-cycle tick.
+void chanSample();
+// Note a frame handed to the decoder, and one that could not be decoded.
+void chanCountFrame();
+void chanCountBad();
+// Roll the counters over into the figures above; call once per minute.
+void chanUtilMinute();
+// Print "Chan U% F X" line to Serial.
+void printChanUtil();
+#else
+#define chanSample() {}
+#define chanCountFrame() {}
+#define chanCountBad() {}
+#endif // ENABLE_CHANNEL_UTILISATION
+
+#if defined(ENABLE_HIGH_RES_STATS_RING)
+// High-resolution (5-minute) stats for control-loop tuning, separate from the by-hour stats sets.
+// One 13-byte block per hour for each of two days, alternating by day number, so the ring holds the last 48h:
+//   [0] temperature at :04 in 1/4C, unsigned, clamped to [0,63.75]C
+//   [1..12] one sample per 5 minutes (at :04, :09, ... :59), each:
+//     b7-4 signed temperature delta in 1/16C from the previous (reconstructed) value, saturating at +/-7
+//     b3-1 valve level 0 (closed) to 6 (fully open), 7 never used so that an erased (0xff) sample is absent
+//     b0 set if likely occupied
+// Lives in the EEPROM node association area, so is not available on nodes that keep associations.
+#if defined(ENABLE_OTSECUREFRAME_ENCODING_SUPPORT) && defined(ENABLE_RADIO_RX) && (defined(ENABLE_BOILER_HUB) || defined(ENABLE_STATS_RX))
+#error ENABLE_HIGH_RES_STATS_RING would overwrite node associations
+#endif
+static constexpr intptr_t V0P2_EE_START_HIGH_RES_STATS = OTV0P2BASE::V0P2BASE_EE_START_NODE_ASSOCIATIONS_WORK_START;
+static constexpr uint8_t V0P2_EE_HIGH_RES_STATS_BLOCK_SIZE = 13;
+static constexpr uint8_t V0P2_EE_HIGH_RES_STATS_SAMPLES = 12; // Per block/hour.
+static constexpr uint8_t V0P2_EE_HIGH_RES_STATS_HOURS = 48; // Blocks in the ring.
+// Take a sample if due; call once per minute with the local time.
+void sampleHighResStats(uint_least16_t msm);
+// Print the samples for hour hh of the last two days to Serial, older first, each line as "hh" then "C16/valve%/occ" for each 5 minutes, "-" if absent.
+void dumpHighResStats(uint8_t hh);
+#else
+#define sampleHighResStats(msm) {}
+#endif // ENABLE_HIGH_RES_STATS_RING
+
+#if defined(ENABLE_EEPROM_WEAR_STATS)
+// EEPROM write accounting by region, to spot wear-heavy configs before deployment.
+// Counts bytes actually written (erased and/or programmed), not calls.
+// App writes go through the eeXXX() wrappers below; writes made inside the libraries
+// (stats sampling, library RTC persistence, TX restart counters, setback lockout)
+// are counted by comparing the affected bytes before and after, or (TX counters) once per minute.
+// Counts since the last checkpoint are in RAM and are lost on reset.
+enum eeWearRegion_t : uint8_t
+  {
+  EEW_BOOT, // Reset counter.
+  EEW_RTC, // Persisted time and date.
+  EEW_STATS, // By-hour stats sets.
+  EEW_HRS, // High-resolution stats ring.
+  EEW_DIAG, // Overrun counter/log and these wear stats.
+  EEW_CONFIG, // Settings changed in operation, eg boiler hub time and setback lockout.
+  EEW_TXCTR, // Secure TX restart counters.
+  EEW_REGIONS
+  };
+// Cumulative totals, checkpointed once a day as EEW_REGIONS+1 uint32_t values:
+// minutes covered, then bytes written per region, all 0xffffffff when cleared.
+// Lives in EEPROM left free by OTV0P2BASE after the stats sets and before the node associations.
+static constexpr intptr_t V0P2_EE_START_WEAR_STATS = V0P2BASE_EE_END_STATS + 1;
+static constexpr uint8_t V0P2_EE_LEN_WEAR_STATS = 4 * (EEW_REGIONS + 1);
+static_assert(V0P2_EE_START_WEAR_STATS + V0P2_EE_LEN_WEAR_STATS <= OTV0P2BASE::V0P2BASE_EE_START_NODE_ASSOCIATIONS_WORK_START, "wear stats overlap node associations");
+extern uint16_t eeWearCounts[EEW_REGIONS];
+inline void eeWearCount(const eeWearRegion_t r, const uint8_t n = 1) { if(eeWearCounts[r] <= (uint16_t)(0xffffU - n)) { eeWearCounts[r] += n; } }
+// As the OTV0P2BASE::eeprom_smart_XXX() and AVR eeprom_XXX() routines, counting writes against region r.
+inline bool eeUpdateByte(const eeWearRegion_t r, uint8_t *const p, const uint8_t v)
+  { const bool w = OTV0P2BASE::eeprom_smart_update_byte(p, v); if(w) { eeWearCount(r); } return(w); }
+inline bool eeEraseByte(const eeWearRegion_t r, uint8_t *const p)
+  { const bool w = OTV0P2BASE::eeprom_smart_erase_byte(p); if(w) { eeWearCount(r); } return(w); }
+inline bool eeClearBits(const eeWearRegion_t r, uint8_t *const p, const uint8_t mask)
+  { const bool w = OTV0P2BASE::eeprom_smart_clear_bits(p, mask); if(w) { eeWearCount(r); } return(w); }
+inline void eeWriteByte(const eeWearRegion_t r, uint8_t *const p, const uint8_t v) { eeprom_write_byte(p, v); eeWearCount(r); }
+inline void eeWriteWord(const eeWearRegion_t r, uint16_t *const p, const uint16_t v) { eeprom_write_word(p, v); eeWearCount(r, 2); }
+// Snapshot the by-hour stats for hour hh, then after sampling count the bytes changed.
+void eeWearStatsSnapshot(uint8_t hh, uint8_t snap[V0P2BASE_EE_STATS_SETS]);
+void eeWearStatsCount(uint8_t hh, const uint8_t snap[V0P2BASE_EE_STATS_SETS]);
+// OTV0P2BASE::persistRTC() with counting.
+void eeWearPersistRTC();
+// OTRadValve::countDownSetbackLockout() with counting.
+void eeWearCountDownSetbackLockout();
+// Call once a minute: notes elapsed time and picks up TX restart counter changes.
+void eeWearTick();
+// Add RAM counts to the EEPROM totals and clear them; call once a day.
+void eeWearCheckpoint();
+// Print "region bytes/day years" for each region, projecting years to 100k writes per cell.
+void printEEWearStats();
+// Clear RAM and EEPROM totals.
+void clearEEWearStats();
+#else
+#define eeUpdateByte(r, p, v) OTV0P2BASE::eeprom_smart_update_byte((p), (v))
+#define eeEraseByte(r, p) OTV0P2BASE::eeprom_smart_erase_byte(p)
+#define eeClearBits(r, p, mask) OTV0P2BASE::eeprom_smart_clear_bits((p), (mask))
+#define eeWriteByte(r, p, v) eeprom_write_byte((p), (v))
+#define eeWriteWord(r, p, v) eeprom_write_word((p), (v))
+#define eeWearTick() {}
+#endif // ENABLE_EEPROM_WEAR_STATS
+
+#if defined(ENABLE_EEPROM_WRITE_QUEUE)
+// Non-urgent EEPROM byte updates held in RAM and started one at a time from idle time,
+// so that each ~3.4ms erase/write runs in the background rather than stalling time-critical code.
+// A later update of a queued address replaces its value; order is otherwise kept.
+// r is the wear region as for eeUpdateByte(); each write is counted against it when started,
+// exactly as the direct eeUpdateByte() or eeWriteByte() would count it, so attribution does not depend on the queue.
+static constexpr uint8_t EE_WRITE_QUEUE_LEN = 16;
+// As eeUpdateByte() (or eeWriteByte() if write) but deferred; writes the oldest entry now if full,
+// and everything now if the supply is low (when a reset may be near).
+void eeQueueUpdate(uint8_t r, uint8_t *p, uint8_t v, bool write = false);
+#if defined(ENABLE_EEPROM_WEAR_STATS)
+#define eeQueueUpdateByte(r, p, v) eeQueueUpdate((r), (p), (v))
+#define eeQueueWrite(r, p, v) eeQueueUpdate((r), (p), (v), true)
+#else
+#define eeQueueUpdateByte(r, p, v) eeQueueUpdate(0, (p), (v))
+#define eeQueueWrite(r, p, v) eeQueueUpdate(0, (p), (v), true)
+#endif
+// As eeprom_read_byte() but sees any queued value.
+uint8_t eeQueuedReadByte(const uint8_t *p);
+// Start the next queued write if the EEPROM is idle, never waiting; true while any remain queued.
+bool eeQueueService();
+// Complete all queued writes, waiting as needed; call before panic, reset or likely power loss,
+// and before reading back queued areas directly.
+void eeQueueFlush();
+#else
+#define eeQueueUpdateByte(r, p, v) eeUpdateByte((r), (p), (v))
+#define eeQueuedReadByte(p) eeprom_read_byte(p)
+#define eeQueueService() (false)
+#define eeQueueFlush() {}
+#endif // ENABLE_EEPROM_WRITE_QUEUE
+
+#if defined(ENABLE_COOP_TASKS)
+// Stackless cooperative tasks (protothreads) for long operations, run a slice at a time late in each minor cycle.
+// A task function resumes from its last COOP_YIELD() and returns true while it has more to do.
+// Only the resume point survives a yield, so anything else carried across one must be static;
+// no initialised local may be in scope at a yield, nor may a yield be inside a switch().
+typedef uint16_t coopState_t; // Resume point; 0 to start from the top.
+#define COOP_BEGIN(s) switch(s) { case 0:
+#define COOP_YIELD(s) do { (s) = __LINE__; return(true); case __LINE__:; } while(0)
+#define COOP_END(s) } (s) = 0; return(false)
+enum coopTask_t : uint8_t
+  {
+#if defined(ENABLE_BULK_STATS_EXPORT)
+  COOP_TASK_EXPORT,
+#endif
+#if defined(ENABLE_VALVE_MOVE_LOG)
+  COOP_TASK_VML_DUMP,
+#endif
+  COOP_TASKS_COUNT
+  };
+static_assert(COOP_TASKS_COUNT <= 8, "runnable mask must hold all tasks");
+// Mark a task as runnable; it runs from wherever it last yielded (the top if it finished).
+void coopTaskStart(coopTask_t t);
+// Run slices of runnable tasks round-robin until none is left or the sub-cycle time reaches stopBy.
+// Handles queued I/O between slices.
+void coopTasksRun(uint8_t stopBy);
+#if defined(ENABLE_BULK_STATS_EXPORT)
+// COOP_TASK_EXPORT: sends one +EXP chunk per slice.
+bool exportTask();
+#endif
+#else
+#define coopTasksRun(stopBy) {}
+#endif // ENABLE_COOP_TASKS
+
+#if defined(ENABLE_VALVE_MOVE_LOG)
+// Valve movement events, to see where valve travel and battery energy go (TODO-1096).
+// Each event is 6 bytes:
+//   [0..1] big-endian: b15-14 reason (VML_XXX), b10-0 local minutes since midnight
+//   [2] valve % before, [3] valve % after
+//   [4..5] big-endian sub-cycle ticks spent in ValveDirect.read() until the next event, saturating; 0 without direct drive
+// The reason is inferred from what changed in the same minute as the move.
+// The latest events are kept in RAM; with ENABLE_VALVE_MOVE_LOG_EEPROM each, once its run ticks are final,
+// is also written with its (mod 256) sequence number to an EEPROM ring that survives restarts.
+// +VML dumps them as SLIP binary 'V' records: 2-byte node ID prefix, event seq, then the event;
+// +VML s sends only events from seq s on, so a host can resume a dump cut short at the end of a minor cycle.
+static constexpr uint8_t VML_UI = 0; // Local manual UI use.
+static constexpr uint8_t VML_SCHEDULE = 1; // WARM/FROST mode change without UI, eg by schedule.
+static constexpr uint8_t VML_SETBACK = 2; // Setback (eg on vacancy or dark) changed.
+static constexpr uint8_t VML_TEMP = 3; // Temperature error alone.
+static constexpr uint8_t VML_EVENT_SIZE = 6;
+static constexpr uint8_t VML_RAM_EVENTS = 8; // Power of two.
+#if defined(ENABLE_VALVE_MOVE_LOG_EEPROM)
+// Lives in EEPROM left free by OTV0P2BASE after the stats sets (and any wear stats) and before the node associations.
+#if defined(ENABLE_EEPROM_WEAR_STATS)
+static constexpr intptr_t V0P2_EE_START_VALVE_MOVE_LOG = V0P2_EE_START_WEAR_STATS + V0P2_EE_LEN_WEAR_STATS;
+#else
+static constexpr intptr_t V0P2_EE_START_VALVE_MOVE_LOG = V0P2BASE_EE_END_STATS + 1;
+#endif
+static constexpr uint8_t V0P2_EE_VALVE_MOVE_LOG_RECORDS = 8; // Power of two; each is seq then event.
+static_assert(V0P2_EE_START_VALVE_MOVE_LOG + V0P2_EE_VALVE_MOVE_LOG_RECORDS * (1 + VML_EVENT_SIZE) <= OTV0P2BASE::V0P2BASE_EE_START_NODE_ASSOCIATIONS_WORK_START, "valve move log overlaps node associations");
+#endif
+// Note any valve move from NominalRadValve.read(); call just after it once a minute.
+void valveMoveLogPoll();
+// Add motor run sub-cycle ticks to the latest event.
+void valveMoveLogMotorTicks(uint8_t ticks);
+// Limit the next dump to events with seq from onwards (mod 256) if filtered, eg to resume one cut short.
+void valveMoveLogDumpFrom(bool filtered, uint8_t from);
+// Send events as binary records to Serial, oldest first, stopping at the given sub-cycle time.
+void valveMoveLogDump(uint8_t stopBy);
+#if defined(ENABLE_COOP_TASKS)
+// COOP_TASK_VML_DUMP: as valveMoveLogDump() sending one record per slice, so never cut short.
+bool valveMoveLogDumpTask();
+#endif
+#else
+#define valveMoveLogPoll() {}
+#endif // ENABLE_VALVE_MOVE_LOG
+
+#if defined(ENABLE_ENERGY_ACCOUNTING)
+// Awake time by peripheral since restart, in sub-cycle ticks (GSCT_MAX+1 per minor cycle), for battery-life estimates.
+// Measured spans are rounded to whole ticks, so very short operations may count as zero.
+//   EA_CPU: each loop pass from wake to the end-of-cycle sleep, including short naps within it
+//   EA_RX: whole minor cycles with the primary radio listening at wake
+//   EA_TX: primary radio sends made by this app (not FHT8V TX inside the library)
+//   EA_SERIAL: loop passes that end with Serial still powered
+//   EA_SENSOR: explicit ADC/I2C/1-wire sensor reads
+//   EA_MOTOR: ValveDirect.read(), which drives the motor when needed
+enum energyCategory_t : uint8_t { EA_CPU, EA_RX, EA_TX, EA_SERIAL, EA_SENSOR, EA_MOTOR, EA_CATEGORIES };
+extern uint32_t energyTicks[EA_CATEGORIES];
+// Add the ticks since startSCT in the current minor cycle to category c.
+inline void energyCountSince(const energyCategory_t c, const uint8_t startSCT)
+  { energyTicks[c] += (uint8_t)(OTV0P2BASE::getSubCycleTime() - startSCT); }
+// Run the statement(s), counting the ticks taken against category c.
+#define ENERGY_ACCOUNT(c, ...) do { const uint8_t _eaStart = OTV0P2BASE::getSubCycleTime(); __VA_ARGS__; energyCountSince((c), _eaStart); } while(0)
+// Call just before the end-of-cycle sleep.
+void energyEndOfWork();
+// Call on waking with the number of minor cycles slept through.
+void energyWake(uint8_t cycles);
+// Mean supply current estimated from the counts and nominal per-category currents, in uA.
+uint16_t energyMeanMicroAmps();
+// Print "E" then ticks for each category, total ticks and estimated mean uA, to Serial.
+void printEnergyStats();
+#else
+#define ENERGY_ACCOUNT(c, ...) do { __VA_ARGS__; } while(0)
+#endif // ENABLE_ENERGY_ACCOUNTING
+
+#if defined(ENABLE_BATTERY_LIFE_ESTIMATE)
+// Nominal 2xAA alkaline supply: fresh, effectively empty for the board, and usable capacity.
+static constexpr uint16_t BATTERY_FULL_cV = 300;
+static constexpr uint16_t BATTERY_EMPTY_cV = 200;
+static constexpr uint16_t BATTERY_NOMINAL_mAh = 2000;
+// Days of end-of-day supply readings kept for the trend.
+static constexpr uint8_t BATTERY_TREND_DAYS = 8;
+// Estimates are capped here; above this the value is not informative.
+static constexpr uint16_t BATTERY_DAYS_MAX = 3650;
+static constexpr uint16_t BATTERY_DAYS_UNKNOWN = 0xffff;
+// Recompute the estimate; call once per day, eg from endOfDayTasks().
+void batteryLifeDailyUpdate();
+// Latest estimate of days until the battery is empty, or BATTERY_DAYS_UNKNOWN (eg on mains or too early to tell).
+uint16_t batteryDaysToEmpty();
+#endif // ENABLE_BATTERY_LIFE_ESTIMATE
+
+#if defined(ENABLE_TX_PATH_BENCHMARK)
+// Print "BEN path cycles stack" for each stats encode/decode path in this build; nothing is sent.
+void benchmarkTXPaths();
+#endif
+
+// Clock boost only applies to the 8MHz RC clock prescaled to 1MHz.
+#if defined(ENABLE_CPU_CLOCK_BOOST) && (F_CPU != 1000000L)
+#undef ENABLE_CPU_CLOCK_BOOST
+#endif
+#if defined(ENABLE_CPU_CLOCK_BOOST)
+// Minimum supply for the ATmega328P to run safely at 8MHz (about 2.4V), with some margin.
+static constexpr uint16_t CPU_CLOCK_BOOST_MIN_cV = 260;
+// While in scope (and if the supply allows) runs the CPU unprescaled, restoring the normal clock on exit.
+// For short pure-compute bursts only: Serial is flushed first and must not be used in scope,
+// and delay loops, millis() and UART/SPI rates timed from the CPU clock all run 8x fast meanwhile.
+// getSubCycleTime() is from the separate RTC crystal and so is unaffected.
+// Nested use is harmless: only the outermost instance changes the clock.
+class CPUClockBoost final
+  {
+  private:
+    bool boosted;
+  public:
+    CPUClockBoost();
+    ~CPUClockBoost();
+    CPUClockBoost(const CPUClockBoost &) = delete;
+    CPUClockBoost &operator=(const CPUClockBoost &) = delete;
+  };
+#else
+// No-op stand-in so that call sites need no conditionals.
+class CPUClockBoost final { public: CPUClockBoost() { } };
+#endif // ENABLE_CPU_CLOCK_BOOST
+
 
 ////////////////////////// Actuators
 
@@ -528,15 +2698,112 @@ typedef OTRadValve::ValveMotorDirectV1<OTRadValve::ValveMotorDirectV1HardwareDri
 extern ValveDirect_t ValveDirect;
 #endif
 
+#if defined(ENABLE_VALVE_FIT_MEMORY)
+// VALVE_FITTED_MARK once ValveDirect has calibrated on a fitted valve, else erased (0xff).
+// After a watchdog or brown-out reset (not power-on, as for a battery change or refit) with the mark set
+// the valve is signalled fitted as soon as the pin is withdrawn, so control resumes in seconds not minutes.
+// The library keeps its calibration private and so recalibrates anyway;
+// a calibration failure clears the mark to restore the normal wait for fitting.
+// Lives in the application-private EEPROM after the RTC log.
+static constexpr uint8_t VALVE_FITTED_MARK = 0xa5;
+// Call once early in setup() with the captured MCUSR reset cause.
+void valveFitMemorySetup(uint8_t resetCause);
+#endif // ENABLE_VALVE_FIT_MEMORY
+
+#if defined(ENABLE_JIT_PREHEAT)
+// Learned warm-up rates for just-in-time pre-heat, following the valve-fitted mark.
+// One byte per (4-hour block of the day, cold or mild room at the start) pair:
+// the rise in C/16 per hour seen while heating, scaled to the valve fully open; erased (0xff) until learned.
+// The starting room temperature stands in for the outside temperature, which a valve cannot see.
+// Lives in the application-private EEPROM after the valve-fitted mark.
+#endif // ENABLE_JIT_PREHEAT
+
+#if defined(ENABLE_NOMINAL_RAD_VALVE)
+#if defined(ENABLE_INEFFECTIVE_CALL_DETECT)
+// Valve % to advertise as this valve's call for heat (secure frame lead byte, local boiler):
+// 0 while the current call is withheld after producing no temperature rise, else NominalRadValve.get().
+// Stats still carry the real valve position.
+uint8_t callForHeatValvePC();
+#else
+#define callForHeatValvePC() (NominalRadValve.get())
+#endif // ENABLE_INEFFECTIVE_CALL_DETECT
+#endif // ENABLE_NOMINAL_RAD_VALVE
+
 // Singleton FHT8V valve instance (to control remote FHT8V valve by radio).
 #ifdef ENABLE_FHT8VSIMPLE
 static const uint8_t _FHT8V_MAX_EXTRA_TRAILER_BYTES = (1 + max(OTV0P2BASE::MESSAGING_TRAILING_MINIMAL_STATS_PAYLOAD_BYTES, OTV0P2BASE::FullStatsMessageCore_MAX_BYTES_ON_WIRE));
-extern OTRadValve::FHT8VRadValve<_FHT8V_MAX_EXTRA_TRAILER_BYTES, OTRadValve::FHT8VRadValveBase::RFM23_PREAMBLE_BYTES, OTRadValve::FHT8VRadValveBase::RFM23_PREAMBLE_BYTE> FHT8V;
+typedef OTRadValve::FHT8VRadValve<_FHT8V_MAX_EXTRA_TRAILER_BYTES, OTRadValve::FHT8VRadValveBase::RFM23_PREAMBLE_BYTES, OTRadValve::FHT8VRadValveBase::RFM23_PREAMBLE_BYTE> FHT8VBase_t;
+#if defined(ENABLE_FHT8V_FAST_RESYNC)
+// Longest overrun (in half seconds) that the TX schedule is shifted over rather than resynced; strictly positive.
+// The loss is only known to whole seconds from the RTC, and anything longer suggests a more serious upset.
+#ifndef FHT8V_REANCHOR_MAX_HALF_SECONDS
+#define FHT8V_REANCHOR_MAX_HALF_SECONDS 8
+#endif
+// FHT8V driver that can keep its place in the valve's TX schedule across a loop overrun.
+// The valve expects a TX every FHT8VTXGapHalfSeconds() and does not care that this end missed some polls,
+// so the count-down to the next TX is wound on by the time lost (skipping any missed TX),
+// avoiding the multi-minute resync during which the valve gets no commands.
+template <class FHT8V_base_t>
+class FHT8VRadValveReanchorable final : public FHT8V_base_t
+  {
+  public:
+    FHT8VRadValveReanchorable(OTRadValve::FHT8VRadValveBase::appendToTXBufferFF_t *trailerFnPtr) : FHT8V_base_t(trailerFnPtr) { }
+    // Call after an overrun in which lostHalfSeconds of poll calls were missed.
+    // Falls back to a full resync if not in sync or if too much time was lost; returns true if re-anchored.
+    bool reanchorAfterOverrun(const uint8_t lostHalfSeconds)
+      {
+      if(!this->syncedWithFHT8V || (0 == lostHalfSeconds) || (lostHalfSeconds > FHT8V_REANCHOR_MAX_HALF_SECONDS))
+        { this->resyncWithValve(); return(false); }
+      uint16_t toGo = this->halfSecondsToNextFHT8VTX;
+      // A TX due in the lost time was missed; aim for the next one at the valve's usual interval.
+      while(toGo <= lostHalfSeconds) { toGo += this->FHT8VTXGapHalfSeconds(this->getHC2()); }
+      this->halfSecondsToNextFHT8VTX = (uint8_t)(toGo - lostHalfSeconds);
+      return(true);
+      }
+  };
+typedef FHT8VRadValveReanchorable<FHT8VBase_t> FHT8V_t;
+#else
+typedef FHT8VBase_t FHT8V_t;
+#endif // ENABLE_FHT8V_FAST_RESYNC
+extern FHT8V_t FHT8V;
+#if defined(ENABLE_FHT8V_MULTI)
+// Extra FHT8Vs in the same room, following the main valve, [1,3].
+#ifndef FHT8V_EXTRA_VALVES
+#define FHT8V_EXTRA_VALVES 1
+#endif
+static_assert((FHT8V_EXTRA_VALVES >= 1) && (FHT8V_EXTRA_VALVES <= 3), "FHT8V_EXTRA_VALVES must be 1 to 3");
+// House codes (HC1, HC2) of each extra valve, in the raw inspectable EEPROM area so settable with G; 0xff if unused.
+static constexpr intptr_t V0P2_EE_START_FHT8V_EXTRA_HC = OTV0P2BASE::V0P2BASE_EE_START_RAW_INSPECTABLE + 2;
+// Extra valves have no stats trailer, so need only room for the terminator.
+typedef OTRadValve::FHT8VRadValve<1, OTRadValve::FHT8VRadValveBase::RFM23_PREAMBLE_BYTES, OTRadValve::FHT8VRadValveBase::RFM23_PREAMBLE_BYTE> FHT8VExtraBase_t;
+#if defined(ENABLE_FHT8V_FAST_RESYNC)
+typedef FHT8VRadValveReanchorable<FHT8VExtraBase_t> FHT8VExtra_t;
+#else
+typedef FHT8VExtraBase_t FHT8VExtra_t;
+#endif
+extern FHT8VExtra_t FHT8VExtra[FHT8V_EXTRA_VALVES];
+#endif // ENABLE_FHT8V_MULTI
+#if defined(ENABLE_FHT8V_FRAME_CACHE)
+// As FHT8V.set(valvePC), but does not rebuild the FS20-encoded TX frame
+// if it would be identical to the last one built while in sync with the valve.
+// Returns true if the frame was rebuilt.
+bool fht8vSetIfChanged(uint8_t valvePC);
+#endif // ENABLE_FHT8V_FRAME_CACHE
 #if defined(ENABLE_LOCAL_TRV) || defined(ENABLE_SLAVE_TRV)
-inline bool localFHT8VTRVEnabled() { return(FHT8V.isAvailable()); }
+inline bool localFHT8VTRVEnabled() { return(profileHas(PROFILE_VALVE) && FHT8V.isAvailable()); }
 #else
 #define localFHT8VTRVEnabled() (false) // Local FHT8V TRV disabled.
 #endif
+// Gather the core (binary/FS20 trailer) stats from this config's sensors.
+inline void populateCoreStatsFromSensors(OTV0P2BASE::FullStatsMessageCore_t *const content)
+  {
+  OTRadValve::populateCoreStats(content,
+                    (localFHT8VTRVEnabled() ? &FHT8V : NULL),
+                    TemperatureC16.get(),
+                    Supply_cV.isSupplyVoltageLow(),
+                    AmbLight.get(),
+                    Occupancy.twoBitOccupancyValue());
+  }
 #endif // ENABLE_FHT8VSIMPLE
 
 
@@ -0,0 +1,194 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2017
+*/
+
+/*
+  V0p2PowerModes
+
+  Current-profile benchmark for V0p2 boards: holds the board in each power state that V0p2_Main uses
+  for a fixed window, using the same OTV0P2BASE/OTRadioLink/OTRadValve calls, so that a current probe
+  (or a scope across a series resistor) can measure the mean current of each state.
+
+  Each window is preceded by N short sync pulses on SYNC (N = mode number + 1) and a line on the serial port:
+    M<n> <name>
+  then serial is powered down (except for the serial mode) for BENCH_WINDOW_S seconds.
+  The cycle repeats forever; discard the first cycle while supplies settle.
+
+  Modes:
+    0 sleep   sleepUntilInt(), woken only by the timer 2 RTC tick
+    1 nap     nap(WDTO_15MS) polling, as while waiting for slots
+    2 rx      sleepUntilInt() with the RFM23B listening
+    3 tx      back-to-back RFM23B sendRaw() of a 64-byte frame at normal power
+    4 serial  UART powered at V0P2_UART_BAUD with the CPU polling for input, as the CLI
+    5 adc     continuous supply-voltage (ADC) reads
+    6 i2c     continuous room temperature (TWI) reads
+    7 motor   direct valve motor driven back and forth between end stops (REV7 only)
+
+  Pick the board with the CONFIG_ line below, as in V0p2_Generic_Config.h.
+  Record the measured uA per mode per board revision alongside the energy accounting model
+  (ENABLE_ENERGY_ACCOUNTING) in V0p2_Main.
+ */
+
+#define CONFIG_DORM1 // REV7 all-in-one valve.
+//#define CONFIG_REV11_RFM23BTEST // REV11 as plain sensor/relay board, no motor.
+
+#include <OTV0p2_valve_ENABLE_defaults.h>
+#include <OTV0p2_CONFIG_REV7.h>
+#include <OTV0p2_CONFIG_REV11.h>
+#include <OTV0p2_valve_ENABLE_fixups.h>
+#include <OTV0p2_Board_IO_Config.h>
+
+#include <Arduino.h>
+#include <OTV0p2Base.h>
+#include <OTRadValve.h>
+#include <OTRadioLink.h>
+#include <OTRFM23BLink.h>
+
+// Length of each measurement window.
+#ifndef BENCH_WINDOW_S
+#define BENCH_WINDOW_S 10
+#endif
+// Sync pulses go out on the heat-call LED unless the rig has a spare pin wired to the probe trigger.
+#if defined(BENCH_SYNC_PIN)
+#define SYNC_ON() { fastDigitalWrite(BENCH_SYNC_PIN, HIGH); }
+#define SYNC_OFF() { fastDigitalWrite(BENCH_SYNC_PIN, LOW); }
+#else
+#define SYNC_ON() LED_HEATCALL_ON()
+#define SYNC_OFF() LED_HEATCALL_OFF()
+#endif
+
+static const OTRadioLink::OTRadioChannelConfig RFM23BConfig(OTRFM23BLink::StandardRegSettingsGFSK57600, true);
+static OTRFM23BLink::OTRFM23BLink<OTV0P2BASE::V0p2_PIN_SPI_nSS, PIN_RFM_NIRQ, 1, true> RFM23B;
+
+static OTV0P2BASE::SupplyVoltageCentiVolts Supply_cV;
+#if defined(ENABLE_PRIMARY_TEMP_SENSOR_SHT21)
+static OTV0P2BASE::RoomTemperatureC16_SHT21 TemperatureC16;
+#else
+static OTV0P2BASE::RoomTemperatureC16_TMP112 TemperatureC16;
+#endif
+
+#if defined(ENABLE_V1_DIRECT_MOTOR_DRIVE)
+static OTRadValve::ValveMotorDirectV1HardwareDriver<MOTOR_DRIVE_ML, MOTOR_DRIVE_MR, MOTOR_DRIVE_MI_AIN, MOTOR_DRIVE_MC_AIN, OTRadValve::MOTOR_DRIVE_NSLEEP_UNUSED> motorDriver;
+// Notes only that an end stop has been hit, so the next run can reverse.
+class EndStopCallback final : public OTRadValve::HardwareMotorDriverInterfaceCallbackHandler
+  {
+  public:
+    bool hit;
+    EndStopCallback() : hit(false) { }
+    virtual void signalHittingEndStop(bool) override { hit = true; }
+    virtual void signalShaftEncoderMarkStart(bool) override { }
+    virtual void signalRunSCTTick(bool) override { }
+  };
+static EndStopCallback endStop;
+#endif // ENABLE_V1_DIRECT_MOTOR_DRIVE
+
+static const char modeNames[] PROGMEM = "sleep\0nap\0rx\0tx\0serial\0adc\0i2c\0motor";
+static constexpr uint8_t MODES = 8;
+
+// Seconds elapsed on the RTC since the window started; the RTC counts seconds within the minute.
+static uint8_t windowStartS;
+static uint8_t windowElapsedS()
+  {
+  const uint8_t s = OTV0P2BASE::getSecondsLT();
+  return((s >= windowStartS) ? (s - windowStartS) : (s + 60 - windowStartS));
+  }
+
+// Announce mode m on serial and with m+1 sync pulses, then start its window.
+static void startWindow(const uint8_t m)
+  {
+  const char *p = modeNames;
+  for(uint8_t i = 0; i < m; ++i) { p += strlen_P(p) + 1; }
+  OTV0P2BASE::serialPrintAndFlush('M');
+  OTV0P2BASE::serialPrintAndFlush((int) m);
+  OTV0P2BASE::serialPrintAndFlush(' ');
+  OTV0P2BASE::serialPrintlnAndFlush((const __FlashStringHelper *)p);
+  for(uint8_t i = 0; i <= m; ++i)
+    {
+    SYNC_ON();
+    OTV0P2BASE::nap(WDTO_15MS);
+    SYNC_OFF();
+    OTV0P2BASE::nap(WDTO_60MS);
+    }
+  windowStartS = OTV0P2BASE::getSecondsLT();
+  }
+
+void setup()
+  {
+  OTV0P2BASE::powerSetup();
+  OTV0P2BASE::IOSetup();
+#if defined(BENCH_SYNC_PIN)
+  pinMode(BENCH_SYNC_PIN, OUTPUT);
+#endif
+  OTV0P2BASE::serialPrintlnAndFlush(F("\r\nV0p2PowerModes"));
+  RFM23B.preinit(NULL);
+  if(!RFM23B.configure(1, &RFM23BConfig) || !RFM23B.begin()) { OTV0P2BASE::serialPrintlnAndFlush(F("!r1")); }
+  }
+
+void loop()
+  {
+  static uint8_t mode;
+  startWindow(mode);
+  switch(mode)
+    {
+    case 0:
+      while(windowElapsedS() < BENCH_WINDOW_S) { OTV0P2BASE::sleepUntilInt(); }
+      break;
+    case 1:
+      while(windowElapsedS() < BENCH_WINDOW_S) { OTV0P2BASE::nap(WDTO_15MS); }
+      break;
+    case 2:
+      RFM23B.listen(true);
+      while(windowElapsedS() < BENCH_WINDOW_S) { OTV0P2BASE::sleepUntilInt(); RFM23B.poll(); }
+      RFM23B.listen(false);
+      break;
+    case 3:
+      {
+      uint8_t frame[64];
+      memset(frame, 0xaa, sizeof(frame));
+      while(windowElapsedS() < BENCH_WINDOW_S) { RFM23B.sendRaw(frame, sizeof(frame)); }
+      break;
+      }
+    case 4:
+      {
+      const bool neededWaking = OTV0P2BASE::powerUpSerialIfDisabled<V0P2_UART_BAUD>();
+      while(windowElapsedS() < BENCH_WINDOW_S) { if(Serial.available() > 0) { Serial.read(); } }
+      if(neededWaking) { OTV0P2BASE::powerDownSerial(); }
+      break;
+      }
+    case 5:
+      while(windowElapsedS() < BENCH_WINDOW_S) { Supply_cV.read(); }
+      break;
+    case 6:
+      while(windowElapsedS() < BENCH_WINDOW_S) { TemperatureC16.read(); }
+      break;
+    case 7:
+#if defined(ENABLE_V1_DIRECT_MOTOR_DRIVE)
+      {
+      bool opening = true;
+      while(windowElapsedS() < BENCH_WINDOW_S)
+        {
+        endStop.hit = false;
+        motorDriver.motorRun(0xff, opening ? OTRadValve::HardwareMotorDriverInterface::motorDriveOpening : OTRadValve::HardwareMotorDriverInterface::motorDriveClosing, endStop);
+        if(endStop.hit) { opening = !opening; }
+        }
+      motorDriver.motorRun(0, OTRadValve::HardwareMotorDriverInterface::motorOff, endStop);
+      }
+#endif // ENABLE_V1_DIRECT_MOTOR_DRIVE
+      break;
+    }
+  if(++mode >= MODES) { mode = 0; }
+  }
@@ -0,0 +1,147 @@
+#!/bin/sh
+#
+# Check flash and static RAM use of all primary configurations of V0p2_Main against budgets.
+#
+# Copies V0p2_Main to a temporary working area,
+# adjusts its generic config header to build all primary configs in turn,
+# and measures each ELF image with avr-size.
+# Budgets are in V0p2_CONFIG_budgets.txt, one "CONFIG_XXX flash ram [singletons]" line per config,
+# with a "default" line used for any config not listed.
+#   * flash is .text + .data (bytes of program memory)
+#   * ram is .data + .bss (bytes of SRAM before any heap or stack)
+#   * singletons, if given, is passed to the build as V0P2_SINGLETONS_RAM_CEILING,
+#     which V0p2_Main.cpp static_asserts against the RAM of its main singletons
+# Stack depth and loop cycles can only be measured on a running unit
+# (the "SH" line in the 'S' status output and, with ENABLE_TX_PATH_BENCHMARK, +BEN).
+#
+# Prints "SIZE config flash ram" for each config,
+# then "RAM config bytes symbol" for each static RAM symbol of at least $RAMREPORTMIN bytes, largest first,
+# to show which globals (eg eeStats, ss1, radio queues, FHT8V buffers) to trim.
+# Shows all failures before exiting (no -e flag)
+
+echo Check flash/RAM budgets of primary configs of main Arduino projects.
+
+# Target Arduino board to build for.
+BUILD_TARGET=opentrv:avr:opentrv_v0p2
+
+# Name of generic config header which should #define one CONFIG_...
+GENERICCONFIGHEADER=V0p2_Generic_Config.h
+
+# Name of main sketch.
+SKETCHNAME=V0p2_Main
+
+# Relative path to V0p2_Main sketch.
+MAIN=Arduino/$SKETCHNAME
+
+# Budgets file.
+BUDGETS=$PWD/V0p2_CONFIG_budgets.txt
+
+# avr-size, by default as shipped with the Arduino IDE if not on the path.
+if [ -z "$AVRSIZE" ]; then
+    if which avr-size > /dev/null 2>&1; then
+        AVRSIZE=avr-size
+    else
+        AVRSIZE=/usr/local/share/arduino/hardware/tools/avr/bin/avr-size
+    fi
+fi
+# avr-nm likewise.
+if [ -z "$AVRNM" ]; then
+    if which avr-nm > /dev/null 2>&1; then
+        AVRNM=avr-nm
+    else
+        AVRNM=/usr/local/share/arduino/hardware/tools/avr/bin/avr-nm
+    fi
+fi
+
+# Smallest symbol (bytes) to list in the RAM report.
+if [ -z "$RAMREPORTMIN" ]; then
+    RAMREPORTMIN=16
+fi
+
+# Target copy of main sketch to update.
+# MUST NEVER BE EMPTY!
+WORKINGDIR=$PWD/tmp-budget-area
+
+if [ -e $WORKINGDIR ]; then
+    echo Temporary working copy directory $WORKINGDIR exists, aborting.
+    exit 99
+fi
+if [ ! -f $BUDGETS ]; then
+    echo Missing $BUDGETS
+    exit 99
+fi
+
+# Create the temporary directory.
+mkdir -p $WORKINGDIR
+
+# Copy the main sketch to the working area.
+cp -rp $PWD/$MAIN $WORKINGDIR
+
+TARGETINO=$WORKINGDIR/$SKETCHNAME/$SKETCHNAME.ino
+if [ ! -f $TARGETINO ]; then
+    echo Missing $TARGETINO
+    exit 99
+fi
+
+# Set status non-zero if a compilation fails or a budget is exceeded.
+STATUS=0
+
+# Fetch all primary configs.
+CONFIGS="`./V0p2_list_primary_CONFIGs.sh`"
+if [ "X" = "X$CONFIGS" ]; then
+    echo No primary configs found, aborting.
+    exit 99
+fi
+
+for config in $CONFIGS;
+do
+    echo @@@@@@ Sizing config $config
+    BUILDDIR=$WORKINGDIR/build-$config
+    mkdir -p $BUILDDIR
+    # Config-specific budget, else the default.
+    BUDGET="`awk -v c=$config '$1 == c { print $2, $3, $4; exit; }' $BUDGETS`"
+    if [ "X" = "X$BUDGET" ]; then
+        BUDGET="`awk '$1 == "default" { print $2, $3, $4; exit; }' $BUDGETS`"
+    fi
+    MAXFLASH=`echo $BUDGET | awk '{ print $1; }'`
+    MAXRAM=`echo $BUDGET | awk '{ print $2; }'`
+    MAXSINGLETONS=`echo $BUDGET | awk '{ print $3; }'`
+    # Overwrite generic config header with single #define for this config.
+    echo "#define $config" > $WORKINGDIR/$SKETCHNAME/$GENERICCONFIGHEADER
+    if [ "X" != "X$MAXSINGLETONS" ]; then
+        echo "#define V0P2_SINGLETONS_RAM_CEILING $MAXSINGLETONS" >> $WORKINGDIR/$SKETCHNAME/$GENERICCONFIGHEADER
+    fi
+    if ! arduino --verify --board $BUILD_TARGET --pref build.path=$BUILDDIR $TARGETINO; then
+        echo FAILED $config
+        STATUS=2
+        continue
+    fi
+    ELF=$BUILDDIR/$SKETCHNAME.ino.elf
+    # Berkeley format: text data bss dec hex filename.
+    SIZES="`$AVRSIZE $ELF | awk 'NR == 2 { print $1 + $2, $2 + $3; }'`"
+    if [ "X" = "X$SIZES" ]; then
+        echo FAILED to size $config
+        STATUS=2
+        continue
+    fi
+    FLASH=`echo $SIZES | awk '{ print $1; }'`
+    RAM=`echo $SIZES | awk '{ print $2; }'`
+    echo SIZE $config $FLASH $RAM
+    # Static RAM by symbol (.data and .bss are types d/D and b/B), largest first.
+    $AVRNM -C -S --size-sort -r -t d $ELF | \
+        awk -v c=$config -v m=$RAMREPORTMIN '$3 ~ /^[bBdD]$/ && $2 + 0 >= m { $1 = ""; s = $2 + 0; $2 = ""; $3 = ""; sub(/^ +/, ""); print "RAM", c, s, $0; }'
+    if [ $FLASH -gt $MAXFLASH ]; then
+        echo OVER BUDGET $config flash $FLASH \> $MAXFLASH
+        STATUS=3
+    fi
+    if [ $RAM -gt $MAXRAM ]; then
+        echo OVER BUDGET $config ram $RAM \> $MAXRAM
+        STATUS=3
+    fi
+done
+
+# Tidy up: delete the working directory.
+rm -rf $WORKINGDIR
+
+echo Final status: $STATUS
+exit $STATUS
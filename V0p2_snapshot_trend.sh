@@ -0,0 +1,103 @@
+#!/bin/sh
+#
+# Build selected historical snapshots and the current V0p2_Main and print their sizes, oldest first.
+#
+# Arguments are sketch directories relative to Arduino/snapshots/ or Arduino/COHEAT2015/
+# (eg 20150208-r4191-V0p2-Arduino-revised-control-loop-for-jittery-temps-TODO-482/V0p2_Main),
+# each built with its own checked-in config; V0p2_Main itself is always built last.
+# Set CONFIG to build V0p2_Main with that CONFIG_XXX instead of its default.
+#   * flash is .text + .data (bytes of program memory)
+#   * ram is .data + .bss (bytes of SRAM before any heap or stack), which bounds stack headroom
+# Prints "TREND name flash ram" for each build.
+#
+# Loop cycles, stack peak, valve movement and TX count need a running unit:
+# capture a day's serial output from each build on the same rig
+# and compare them with util/v0p2_trend.py.
+# Shows all failures before exiting (no -e flag)
+
+echo Size trend of V0p2 snapshots against current V0p2_Main.
+
+# Target Arduino board to build for.
+if [ -z "$BUILD_TARGET" ]; then
+    BUILD_TARGET=opentrv:avr:opentrv_v0p2
+fi
+
+# avr-size, by default as shipped with the Arduino IDE if not on the path.
+if [ -z "$AVRSIZE" ]; then
+    if which avr-size > /dev/null 2>&1; then
+        AVRSIZE=avr-size
+    else
+        AVRSIZE=/usr/local/share/arduino/hardware/tools/avr/bin/avr-size
+    fi
+fi
+
+# Target copies of sketches to build.
+# MUST NEVER BE EMPTY!
+WORKINGDIR=$PWD/tmp-trend-area
+
+if [ -e $WORKINGDIR ]; then
+    echo Temporary working copy directory $WORKINGDIR exists, aborting.
+    exit 99
+fi
+mkdir -p $WORKINGDIR
+
+# Set status non-zero if a build fails.
+STATUS=0
+
+# Build and size one sketch directory, labelled $2.
+sizeSketch() {
+    SRC=$1
+    LABEL=$2
+    SKETCHNAME="`basename $SRC`"
+    COPY=$WORKINGDIR/$LABEL
+    mkdir -p $COPY
+    cp -rp $SRC $COPY
+    INO=$COPY/$SKETCHNAME/$SKETCHNAME.ino
+    if [ ! -f $INO ]; then
+        echo Missing $INO
+        STATUS=2
+        return
+    fi
+    if [ "X$LABEL" = "XV0p2_Main" -a "X" != "X$CONFIG" ]; then
+        echo "#define $CONFIG" > $COPY/$SKETCHNAME/V0p2_Generic_Config.h
+    fi
+    BUILDDIR=$COPY/build
+    mkdir -p $BUILDDIR
+    echo @@@@@@ Building $LABEL
+    if ! arduino --verify --board $BUILD_TARGET --pref build.path=$BUILDDIR $INO; then
+        echo FAILED $LABEL
+        STATUS=2
+        return
+    fi
+    # Berkeley format: text data bss dec hex filename.
+    SIZES="`$AVRSIZE $BUILDDIR/$SKETCHNAME.ino.elf | awk 'NR == 2 { print $1 + $2, $2 + $3; }'`"
+    if [ "X" = "X$SIZES" ]; then
+        echo FAILED to size $LABEL
+        STATUS=2
+        return
+    fi
+    echo TREND $LABEL $SIZES
+}
+
+# Snapshot directory names start with their date, so sort gives oldest first.
+for s in `for a in "$@"; do echo $a; done | sort`;
+do
+    if [ -d Arduino/snapshots/$s ]; then
+        SRC=Arduino/snapshots/$s
+    elif [ -d Arduino/COHEAT2015/$s ]; then
+        SRC=Arduino/COHEAT2015/$s
+    else
+        echo No such snapshot $s
+        STATUS=2
+        continue
+    fi
+    # Label by the snapshot's dated top-level directory.
+    sizeSketch $SRC "`echo $s | cut -d/ -f1`"
+done
+sizeSketch Arduino/V0p2_Main V0p2_Main
+
+# Tidy up: delete the working directory.
+rm -rf $WORKINGDIR
+
+echo Final status: $STATUS
+exit $STATUS
@@ -0,0 +1,265 @@
+#!/usr/bin/env python3
+#
+# The OpenTRV project licenses this file to you
+# under the Apache Licence, Version 2.0 (the "Licence");
+# you may not use this file except in compliance
+# with the Licence. You may obtain a copy of the Licence at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the Licence is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied. See the Licence for the
+# specific language governing permissions and limitations
+# under the Licence.
+#
+# Author(s) / Copyright (s): Damon Hart-Davis 2017
+
+"""Reference decoder for V0p2 hub ENABLE_BINARY_SERIAL_OUTPUT records.
+
+Reads the raw serial byte stream (from a file, or stdin if none given)
+and prints one line per valid record, as JSON where the record carries JSON,
+in the same form that a text-mode hub would have printed.
+Text output interleaved with records (eg status lines) is passed through.
+
+Secure 'O' frame bodies may carry JSON or (ENABLE_SECURE_STATS_TLV) binary TLV stats,
+or (ENABLE_STATS_SET_UPLOAD) one whole by-hour stats set.
+
+ENABLE_BULK_STATS_EXPORT 'X' chunks (from +EXP) are reassembled;
+once complete and CRC-checked the blob is printed as one line of hex prefixed "EXP".
+
+ENABLE_VALVE_MOVE_LOG 'V' events (from +VML) are printed one per line as
+"VML id seq hh:mm reason from% to% ticks".
+
+ENABLE_RX_FRAME_CAPTURE 'R' raw received frames are printed one per line as
+"RX hh:mm:ss sct hex"; v0p2_rx_replay.py can send a capture back to a hub.
+
+ENABLE_BINARY_STATUS_RECORD 'S' status records (in place of '=' lines) are printed
+one per line as JSON with the same fields.
+
+Record (SLIP framed, END before and after):
+    type, idLen, id[idLen], seq, payload..., crc7_5B
+
+Usage: v0p2_binary_serial_decode.py [capture-file]
+  eg: stty -F /dev/ttyUSB0 4800 raw && v0p2_binary_serial_decode.py /dev/ttyUSB0
+"""
+
+import sys
+
+SLIP_END = 0xc0
+SLIP_ESC = 0xdb
+SLIP_ESC_END = 0xdc
+SLIP_ESC_ESC = 0xdd
+
+
+def crc7_5B_update(crc, datum):
+    """As OTV0P2BASE::crc7_5B_update()."""
+    i = 0x80
+    while i:
+        bit = (crc & 0x40) != 0
+        if datum & i:
+            bit = not bit
+        crc = (crc << 1) & 0xff
+        if bit:
+            crc ^= 0x37
+        i >>= 1
+    return crc & 0x7f
+
+
+# ENABLE_SECURE_STATS_TLV body flag and keys by code, as in V0p2_Main.h.
+STATS_TLV_BODY_FLAG = 0x20
+STATS_SET_BODY_FLAG = 0x40
+STATS_SET_BODY_LEN = 28
+STLV_KEYS = [None, "T|C16", "H|%", "L", "O", "vac|h", "B|cV", "v|%", "tT|C", "tS|C", "vC|%", "b", "gE"]
+
+
+def crc_ccitt_update(crc, data):
+    """As avr-libc _crc_ccitt_update()."""
+    data ^= crc & 0xff
+    data = (data ^ (data << 4)) & 0xff
+    return (((data << 8) | (crc >> 8)) ^ (data >> 4) ^ (data << 3)) & 0xffff
+
+
+# Bulk export blob being reassembled from 'X' records, as offset -> bytes.
+export_parts = {}
+
+
+def decode_export_chunk(id_hex, payload):
+    """Collect one 'X' chunk; return a line once the blob is complete, else None."""
+    if len(payload) < 2:
+        return None
+    offset = (payload[0] << 8) | payload[1]
+    # Offset 0 starts a new blob, including when the node restarts an export whose stats changed part-way.
+    if offset == 0:
+        export_parts.clear()
+    export_parts[offset] = payload[2:]
+    blob = bytearray()
+    while len(blob) in export_parts:
+        part = export_parts[len(blob)]
+        if not part:
+            break
+        blob += part
+    if len(blob) < 21:
+        return None
+    body_len = 21 + 24 * blob[20]
+    if len(blob) < body_len + 2:
+        return None
+    crc = 0xffff
+    for b in blob[:body_len]:
+        crc = crc_ccitt_update(crc, b)
+    export_parts.clear()
+    if crc != ((blob[body_len] << 8) | blob[body_len + 1]):
+        return 'EXP %s bad CRC' % id_hex
+    return 'EXP %s %s' % (id_hex, blob[:body_len].hex())
+
+
+# ENABLE_VALVE_MOVE_LOG reasons by code, as VML_XXX in V0p2_Main.h.
+VML_REASONS = ["ui", "schedule", "setback", "temp"]
+
+
+def decode_valve_move(id_hex, seq, payload):
+    """Return a line for one 'V' valve movement event, or None if malformed."""
+    if len(payload) != 6:
+        return None
+    w = (payload[0] << 8) | payload[1]
+    msm = w & 0x7ff
+    ticks = (payload[4] << 8) | payload[5]
+    return 'VML %s %d %02d:%02d %s %d %d %d' % (
+        id_hex, seq, msm // 60, msm % 60, VML_REASONS[w >> 14], payload[2], payload[3], ticks)
+
+
+def decode_rx_frame(seq, payload):
+    """Return a line for one 'R' raw received frame, or None if malformed."""
+    if len(payload) < 4:
+        return None
+    msm = (payload[0] << 8) | payload[1]
+    return 'RX %02d:%02d:%02d %d %s' % (msm // 60, msm % 60, payload[2], seq, payload[3:].hex())
+
+
+def decode_status(id_hex, seq, payload):
+    """Return a JSON line for one 'S' status record, or None if malformed; absent values are omitted."""
+    if len(payload) != 12:
+        return None
+    flags = payload[0]
+    t = int.from_bytes(payload[2:4], 'big', signed=True)
+    msm = (payload[5] << 8) | payload[6]
+    out = '{"@":"%s","S":%d,"m":"%s","T|C16":%d,"t":"%02d:%02d"' % (
+        id_hex, seq, 'B' if flags & 2 else 'W' if flags & 1 else 'F', t, msm // 60, msm % 60)
+    for key, v in (("v|%", payload[1]), ("tT|C", payload[4]), ("L", payload[7]), ("H|%", payload[8]), ("O", payload[9])):
+        if v != 0xff:
+            out += ',"%s":%d' % (key, v)
+    out += ',"B|cV":%d,"e":%d,"d":%d,"s":%d,"lo":%d}' % (
+        (payload[10] << 8) | payload[11], (flags >> 2) & 1, (flags >> 3) & 1, (flags >> 4) & 1, (flags >> 5) & 1)
+    return out
+
+
+def decode_tlv(tlv):
+    """Return TLV stats as ',"key":value' JSON fragments; unknown codes are skipped."""
+    out = ''
+    i = 0
+    while i < len(tlv):
+        tag = tlv[i]
+        i += 1
+        n, code = tag >> 6, tag & 0x3f
+        if n == 0 or n > 2 or i + n > len(tlv):
+            break  # Malformed.
+        if n == 2:
+            value = int.from_bytes(tlv[i:i + 2], 'big', signed=True)
+        else:
+            value = tlv[i]
+        i += n
+        if 0 < code < len(STLV_KEYS):
+            out += ',"%s":%d' % (STLV_KEYS[code], value)
+    return out
+
+
+def decode_record(rec):
+    """Return a printable line for one unescaped record, or None if invalid."""
+    if len(rec) < 4:
+        return None
+    crc = 0x7f
+    for b in rec[:-1]:
+        crc = crc7_5B_update(crc, b)
+    if crc != rec[-1]:
+        return None
+    rtype, idlen = rec[0], rec[1]
+    if len(rec) < 4 + idlen:
+        return None
+    nodeid = rec[2:2 + idlen]
+    seq = rec[2 + idlen]
+    payload = rec[3 + idlen:-1]
+    id_hex = ''.join('%X' % b for b in nodeid)  # As Serial.print(b, HEX).
+    if rtype == ord('O'):
+        # Decrypted body: valve %, flags, then JSON without closing brace, TLV stats, a stats set, or nothing.
+        if len(payload) == STATS_SET_BODY_LEN and (payload[1] & STATS_SET_BODY_FLAG):
+            values = ','.join('null' if v == 0xff else str(v) for v in payload[4:])
+            return '{"@":"%s","+":%d,"sS":%d,"sP":%d,"sV":[%s]}' % (id_hex, seq, payload[2], payload[3], values)
+        if len(payload) == 2:
+            # Valve % only, eg from a short valve frame (ENABLE_SECURE_VALVE_SHORT_FRAME).
+            if payload[0] > 100:
+                return None
+            return '{"@":"%s","+":%d,"v|%%":%d}' % (id_hex, seq, payload[0])
+        if len(payload) > 2 and (payload[1] & STATS_TLV_BODY_FLAG):
+            return '{"@":"%s","+":%d%s}' % (id_hex, seq, decode_tlv(payload[2:]))
+        if len(payload) < 3 or payload[2] != ord('{'):
+            return None
+        return '{"@":"%s","+":%d,%s}' % (id_hex, seq, payload[3:].decode('ascii', 'replace'))
+    if rtype == ord('J'):
+        return payload.decode('ascii', 'replace')
+    if rtype == ord('X'):
+        return decode_export_chunk(id_hex, payload)
+    if rtype == ord('V'):
+        return decode_valve_move(id_hex, seq, payload)
+    if rtype == ord('R'):
+        return decode_rx_frame(seq, payload)
+    if rtype == ord('S'):
+        return decode_status(id_hex, seq, payload)
+    if rtype == ord('F'):
+        return 'F %s %s' % (id_hex or '-', payload.hex())
+    return None
+
+
+def main(argv):
+    src = open(argv[1], 'rb') if len(argv) > 1 else sys.stdin.buffer
+    inrec = False
+    esc = False
+    rec = bytearray()
+    text = bytearray()
+    while True:
+        chunk = src.read(1)
+        if not chunk:
+            break
+        b = chunk[0]
+        if b == SLIP_END:
+            if inrec and rec:
+                line = decode_record(bytes(rec))
+                if line is not None:
+                    print(line, flush=True)
+                inrec = False
+            else:
+                inrec = True
+            rec = bytearray()
+            esc = False
+            continue
+        if not inrec:
+            # Pass through ordinary text lines.
+            if b == ord('\n'):
+                sys.stdout.write(text.decode('ascii', 'replace').rstrip('\r') + '\n')
+                sys.stdout.flush()
+                text = bytearray()
+            else:
+                text.append(b)
+            continue
+        if esc:
+            rec.append(SLIP_END if b == SLIP_ESC_END else SLIP_ESC if b == SLIP_ESC_ESC else b)
+            esc = False
+        elif b == SLIP_ESC:
+            esc = True
+        else:
+            rec.append(b)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
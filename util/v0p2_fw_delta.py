@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+#
+# The OpenTRV project licenses this file to you
+# under the Apache Licence, Version 2.0 (the "Licence");
+# you may not use this file except in compliance
+# with the Licence. You may obtain a copy of the Licence at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the Licence is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied. See the Licence for the
+# specific language governing permissions and limitations
+# under the Licence.
+#
+# Author(s) / Copyright (s): Damon Hart-Davis 2017
+
+"""Compute a compact delta between two V0p2 firmware images and chunk it for radio.
+
+Reads the running and target images (Intel HEX, as built by the Arduino IDE
+or PlatformIO), encodes the target as a delta against the running image,
+checks that the delta reproduces the target exactly, and splits it into
+fixed-size chunks sized to fit a secure frame body.
+Reports image, delta and chunk sizes and the estimated airtime per node, and
+optionally writes the chunks one per line as hex for a hub to stream.
+
+Delta format, a sequence of ops:
+  0x00..0x7f n   literal: the next n+1 bytes are copied into the target
+  0x80..0xff n   copy: (n & 0x7f) + 4 bytes from the running image at the
+                 big-endian 16-bit address that follows
+Chunk 0 is a header: target length, target CRC-16/CCITT (as avr-libc
+_crc_ccitt_update(), initial 0xffff), delta length, chunk count, each 16-bit
+big-endian; each later chunk is its 16-bit big-endian index then up to
+CHUNK_DATA bytes of delta.
+
+The node side (receiving, staging and applying under a bootloader) is not
+part of this tree: REV7/DORM1 boards have no external storage and a
+production image leaves no room for a second copy in the 32kB of flash.
+
+Usage: v0p2_fw_delta.py running.hex target.hex [chunks-out]
+"""
+
+import sys
+
+CHUNK_DATA = 28  # Delta bytes per chunk; with the 2-byte index fills a 30-byte body.
+FRAME_OVERHEAD = 34  # Approx on-air bytes per secure frame beyond the body (preamble, sync, header, IV, tag).
+BITRATE = 49260  # bps: GFSK primary radio config.
+MIN_COPY = 4
+MAX_COPY = 0x7f + MIN_COPY
+MAX_LITERAL = 0x80
+
+
+def read_hex(path):
+    """Return the flat image (0xff-filled gaps) from an Intel HEX file."""
+    mem = {}
+    base = 0
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith(':'):
+                continue
+            rec = bytes.fromhex(line[1:])
+            if (sum(rec) & 0xff) != 0:
+                raise ValueError('%s: bad checksum: %s' % (path, line))
+            n, addr, rtype = rec[0], (rec[1] << 8) | rec[2], rec[3]
+            data = rec[4:4 + n]
+            if rtype == 0:
+                for i, b in enumerate(data):
+                    mem[base + addr + i] = b
+            elif rtype == 1:
+                break
+            elif rtype == 2:
+                base = ((data[0] << 8) | data[1]) << 4
+            elif rtype == 4:
+                base = ((data[0] << 8) | data[1]) << 16
+    if not mem:
+        return b''
+    return bytes(mem.get(i, 0xff) for i in range(max(mem) + 1))
+
+
+def crc_ccitt(data):
+    """CRC-16/CCITT as avr-libc _crc_ccitt_update(), initial 0xffff."""
+    crc = 0xffff
+    for b in data:
+        b ^= crc & 0xff
+        b = (b ^ (b << 4)) & 0xff
+        crc = (((b << 8) | (crc >> 8)) ^ (b >> 4) ^ (b << 3)) & 0xffff
+    return crc
+
+
+def encode(old, new):
+    """Greedy delta of new against old, preferring copies from the same or last-used offset."""
+    index = {}
+    for i in range(len(old) - MIN_COPY + 1):
+        index.setdefault(old[i:i + MIN_COPY], []).append(i)
+    out = bytearray()
+    lit = bytearray()
+
+    def flush_literal():
+        while lit:
+            run = lit[:MAX_LITERAL]
+            out.append(len(run) - 1)
+            out.extend(run)
+            del lit[:len(run)]
+
+    def match_len(src, dst):
+        n = 0
+        while (n < MAX_COPY) and (dst + n < len(new)) and (src + n < len(old)) and (old[src + n] == new[dst + n]):
+            n += 1
+        return n
+
+    shift = 0  # Offset of the last copy: code after an edit usually just moves.
+    i = 0
+    while i < len(new):
+        best_src, best_n = 0, 0
+        candidates = index.get(new[i:i + MIN_COPY], [])
+        for src in [i - shift] + candidates[:64]:
+            if 0 <= src < len(old):
+                n = match_len(src, i)
+                if n > best_n:
+                    best_src, best_n = src, n
+        if best_n >= MIN_COPY:
+            flush_literal()
+            out.append(0x80 | (best_n - MIN_COPY))
+            out.extend(((best_src >> 8) & 0xff, best_src & 0xff))
+            shift = i - best_src
+            i += best_n
+        else:
+            lit.append(new[i])
+            i += 1
+    flush_literal()
+    return bytes(out)
+
+
+def apply(old, delta):
+    """Rebuild the target from old and delta, as a node would."""
+    out = bytearray()
+    i = 0
+    while i < len(delta):
+        op = delta[i]
+        if op < 0x80:
+            out.extend(delta[i + 1:i + 2 + op])
+            i += 2 + op
+        else:
+            src = (delta[i + 1] << 8) | delta[i + 2]
+            out.extend(old[src:src + (op & 0x7f) + MIN_COPY])
+            i += 3
+    return bytes(out)
+
+
+def chunk(new, delta):
+    """Return the header chunk followed by the indexed delta chunks."""
+    body = [delta[i:i + CHUNK_DATA] for i in range(0, len(delta), CHUNK_DATA)]
+    count = len(body) + 1
+
+    def be16(v):
+        return bytes(((v >> 8) & 0xff, v & 0xff))
+    chunks = [be16(len(new)) + be16(crc_ccitt(new)) + be16(len(delta)) + be16(count)]
+    chunks += [be16(i + 1) + c for i, c in enumerate(body)]
+    return chunks
+
+
+def main(argv):
+    if len(argv) not in (3, 4):
+        sys.stderr.write(__doc__)
+        return 2
+    old = read_hex(argv[1])
+    new = read_hex(argv[2])
+    delta = encode(old, new)
+    if apply(old, delta) != new:
+        sys.stderr.write('internal error: delta does not reproduce target\n')
+        return 1
+    chunks = chunk(new, delta)
+    onair = sum(len(c) + FRAME_OVERHEAD for c in chunks)
+    print('running %d bytes, target %d bytes (CRC %04x)' % (len(old), len(new), crc_ccitt(new)))
+    print('delta %d bytes (%.1f%% of target), %d chunks' % (len(delta), 100.0 * len(delta) / max(1, len(new)), len(chunks)))
+    print('airtime ~%.1fs per node (%d bytes on air)' % (onair * 8.0 / BITRATE, onair))
+    if len(argv) == 4:
+        with open(argv[3], 'w') as f:
+            for c in chunks:
+                f.write(c.hex() + '\n')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
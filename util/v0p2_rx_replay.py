@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+#
+# The OpenTRV project licenses this file to you
+# under the Apache Licence, Version 2.0 (the "Licence");
+# you may not use this file except in compliance
+# with the Licence. You may obtain a copy of the Licence at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the Licence is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied. See the Licence for the
+# specific language governing permissions and limitations
+# under the Licence.
+#
+# Author(s) / Copyright (s): Damon Hart-Davis 2017
+
+"""Replay ENABLE_RX_FRAME_CAPTURE 'R' records into a V0p2 hub via +RXI.
+
+Extracts the raw received frames from a serial capture (as made by a hub
+built with ENABLE_RX_FRAME_CAPTURE) and sends each back to a hub on the
+given port, one +RXI command per frame, at the original spacing divided by
+the speed factor (0 for back-to-back).
+Reports frames sent, elapsed time, throughput and the number of frames
+that the hub rejected ("!" lines, eg "!RXI" for a bad or late record).
+
+The hub's own output (decoded frames, JSON, etc) is echoed so that it can be
+compared with the original capture's output for correctness.
+
+Secure frames are subject to the hub's usual replay protection: a frame is
+rejected ("?RX auth") unless its message counter is above the one the hub
+holds for that sender, and each frame accepted advances that counter in the
+hub's EEPROM. So a capture can be replayed only once into a given hub, and
+not into the hub that captured it (or any other that heard those senders
+later) until its stored counters are reset, eg by clearing and re-adding
+its associations.
+Non-secure frames are not affected.
+
+Usage: v0p2_rx_replay.py capture-file port [speed]
+  eg: v0p2_rx_replay.py rx.cap /dev/ttyUSB0 10
+Needs pyserial.
+"""
+
+import sys
+import time
+
+import serial
+
+SLIP_END = 0xc0
+SLIP_ESC = 0xdb
+SLIP_ESC_END = 0xdc
+SLIP_ESC_ESC = 0xdd
+
+BAUD = 4800
+
+
+def extract_records(data):
+    """Return (time_s, raw SLIP record bytes) for each 'R' record in a capture."""
+    out = []
+    i = 0
+    while True:
+        start = data.find(bytes([SLIP_END]), i)
+        if start < 0:
+            break
+        end = data.find(bytes([SLIP_END]), start + 1)
+        if end < 0:
+            break
+        raw = data[start + 1:end]
+        i = end + 1
+        rec = raw.replace(bytes([SLIP_ESC, SLIP_ESC_END]), bytes([SLIP_END])).replace(
+            bytes([SLIP_ESC, SLIP_ESC_ESC]), bytes([SLIP_ESC]))
+        if len(rec) < 9 or rec[0] != ord('R') or rec[1] != 0:
+            i = end  # Perhaps the END starting the next record.
+            continue
+        msm = (rec[3] << 8) | rec[4]
+        t = msm * 60 + rec[5] + rec[2] / 256.0 * 2  # Sub-cycle ticks span 2s.
+        out.append((t, bytes([SLIP_END]) + raw + bytes([SLIP_END])))
+    return out
+
+
+def read_until_prompt(port, timeout=3.0):
+    """Read and echo hub output until the CLI prompt; return the lines seen."""
+    lines = []
+    buf = bytearray()
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        b = port.read(1)
+        if not b:
+            continue
+        if b == b'>':
+            break
+        if b == b'\n':
+            line = buf.decode('ascii', 'replace').rstrip('\r')
+            print(line, flush=True)
+            lines.append(line)
+            buf = bytearray()
+        else:
+            buf += b
+    return lines
+
+
+def main(argv):
+    if len(argv) < 3:
+        sys.stderr.write(__doc__)
+        return 1
+    speed = float(argv[3]) if len(argv) > 3 else 1.0
+    records = extract_records(open(argv[1], 'rb').read())
+    port = serial.Serial(argv[2], BAUD, timeout=0.05)
+    errors = 0
+    began = time.time()
+    first = records[0][0] if records else 0
+    for t, raw in records:
+        if speed > 0:
+            delay = (t - first) / speed - (time.time() - began)
+            if delay > 0:
+                time.sleep(delay)
+        port.write(b'\r')  # Wake the CLI.
+        read_until_prompt(port)
+        port.write(b'+RXI\r')
+        time.sleep(0.05)
+        port.write(raw)
+        errors += sum(1 for line in read_until_prompt(port) if line.startswith('!'))
+    elapsed = time.time() - began
+    print('REPLAY frames %d secs %.1f fps %.2f errors %d' % (
+        len(records), elapsed, len(records) / elapsed if elapsed else 0, errors))
+    return 0 if not errors else 2
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,344 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2017
+*/
+
+/*
+  Host-side incremental decoder for V0p2 serial output (header only, portable C++11).
+
+  Handles, interleaved on one stream:
+    * '=' status lines (mode, valve % and temperature picked out where present)
+    * JSON stats lines {"@":"id","+":seq,...} (id and seq picked out)
+    * CfH hc1 hc2 and RCfH1 / RCfH0 / RCfH- call-for-heat markers
+    * any other text line
+    * SLIP-framed binary records (ENABLE_BINARY_SERIAL_OUTPUT and friends, see Messaging.cpp),
+      CRC-checked, with 'S' status records decoded into the same fields as '=' lines.
+
+  Feed bytes as they arrive, in chunks of any size; each complete record is passed to a callback.
+  Text lines that lie wholly within one chunk are handed back as spans into the caller's buffer;
+  only lines split across chunks, and binary records (which must be unescaped), are copied,
+  into a fixed buffer in the decoder, so there is no allocation and per-stream state is ~300 bytes.
+  Use one Decoder per stream to multiplex many hubs.
+
+  Records are only valid for the duration of the callback.
+
+  See v0p2_stream_decode_main.cpp for a CLI tool, v0p2_stream_decode_test.cpp for tests,
+  and v0p2_binary_serial_decode.py for the reference decoding of binary payloads.
+*/
+
+#ifndef V0P2_STREAM_DECODE_H
+#define V0P2_STREAM_DECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace V0p2StreamDecode
+{
+
+// Kind of record decoded.
+enum RecordKind : uint8_t
+  {
+  RK_TEXT,   // Any other text line.
+  RK_STATUS, // '=' status line, or binary 'S' status record.
+  RK_JSON,   // JSON stats line.
+  RK_CFH,    // CfH hc1 hc2: call for heat heard from a valve.
+  RK_RCFH,   // RCfH1/RCfH0/RCfH-: boiler on/off/ignored.
+  RK_BINARY, // Any other valid binary record.
+  };
+
+// Non-owning view of bytes.
+struct Span
+  {
+  const char *p;
+  size_t n;
+  bool empty() const { return(0 == n); }
+  bool equals(const char *s) const { return((strlen(s) == n) && (0 == memcmp(p, s, n))); }
+  };
+
+// One decoded record; spans are valid only during the callback.
+struct Record
+  {
+  RecordKind kind;
+  // The whole text line without CR/LF, or the unescaped binary record without its CRC.
+  Span raw;
+
+  // RK_STATUS: mode 'F', 'W' or 'B' (0 if unknown), valve % (-1 if absent), temperature C*16 (valid iff hasTemp).
+  char mode;
+  int16_t valvePC;
+  bool hasTemp;
+  int16_t tempC16;
+
+  // RK_JSON: the "@" id (empty if absent) and "+" seq (-1 if absent).
+  // RK_BINARY / binary RK_STATUS: the record's id (in hex, as the text forms) and seq.
+  Span id;
+  int16_t seq;
+
+  // RK_CFH: house codes.
+  uint8_t hc1, hc2;
+  // RK_RCFH: '1', '0' or '-'.
+  char rcfh;
+
+  // Binary records only: type byte and payload.
+  uint8_t binType;
+  const uint8_t *payload;
+  uint8_t payloadLen;
+  };
+
+// Counters, eg for gateway health monitoring.
+struct Stats
+  {
+  uint32_t records;
+  uint32_t badCRC;     // Binary records rejected.
+  uint32_t overlong;   // Lines or records too long for the buffer, discarded.
+  };
+
+// As OTV0P2BASE::crc7_5B_update().
+inline uint8_t crc7_5B_update(uint8_t crc, const uint8_t datum)
+  {
+  for(uint8_t i = 0x80; i != 0; i >>= 1)
+    {
+    bool bit = (0 != (crc & 0x40));
+    if(0 != (datum & i)) { bit = !bit; }
+    crc <<= 1;
+    if(bit) { crc ^= 0x37; }
+    }
+  return(crc & 0x7f);
+  }
+
+class Decoder final
+  {
+  public:
+    // Longest line or record kept; longer ones are counted and dropped.
+    static const size_t MAX_RECORD = 255;
+
+    Decoder() { reset(); }
+    void reset() { n = 0; inBin = false; esc = false; discarding = false; memset(&stats, 0, sizeof(stats)); }
+    const Stats &getStats() const { return(stats); }
+
+    // Feed the next chunk of the stream; calls onRecord(const Record &) for each record completed.
+    template <class F>
+    void feed(const uint8_t *const data, const size_t len, F &&onRecord)
+      {
+      size_t lineStart = 0; // Start of any text line begun in this chunk (when n == 0).
+      for(size_t i = 0; i < len; ++i)
+        {
+        const uint8_t b = data[i];
+        if(SLIP_END == b)
+          {
+          if(inBin && (n > 0)) { finishBinary(onRecord); inBin = false; }
+          else
+            {
+            // Any partial text line is abandoned; the sketch ends lines before records.
+            inBin = true;
+            }
+          n = 0; esc = false; discarding = false;
+          lineStart = i + 1;
+          continue;
+          }
+        if(inBin)
+          {
+          if(esc) { esc = false; put((SLIP_ESC_END == b) ? SLIP_END : (SLIP_ESC_ESC == b) ? SLIP_ESC : b); }
+          else if(SLIP_ESC == b) { esc = true; }
+          else { put(b); }
+          continue;
+          }
+        if('\n' == b)
+          {
+          if(discarding) { discarding = false; }
+          else if(0 == n)
+            {
+            // Zero-copy: the line is wholly within this chunk.
+            finishText((const char *)data + lineStart, i - lineStart, onRecord);
+            }
+          else
+            {
+            // Completes a line started in an earlier chunk.
+            for(size_t j = lineStart; j < i; ++j) { put(data[j]); }
+            if(!discarding) { finishText((const char *)buf, n, onRecord); }
+            discarding = false;
+            }
+          n = 0;
+          lineStart = i + 1;
+          }
+        }
+      // Keep any partial text line for the next chunk.
+      if(!inBin)
+        {
+        for(size_t j = lineStart; j < len; ++j) { put(data[j]); }
+        }
+      }
+
+  private:
+    static const uint8_t SLIP_END = 0xc0;
+    static const uint8_t SLIP_ESC = 0xdb;
+    static const uint8_t SLIP_ESC_END = 0xdc;
+    static const uint8_t SLIP_ESC_ESC = 0xdd;
+
+    uint8_t buf[MAX_RECORD];
+    size_t n;
+    bool inBin;
+    bool esc;
+    bool discarding;
+    char idHex[2 * 16 + 1];
+    Stats stats;
+
+    void put(const uint8_t b)
+      {
+      if(discarding) { return; }
+      if(n >= sizeof(buf)) { discarding = true; ++stats.overlong; return; }
+      buf[n++] = b;
+      }
+
+    static void clear(Record &r, const RecordKind kind, const char *const p, const size_t len)
+      {
+      memset(&r, 0, sizeof(r));
+      r.kind = kind;
+      r.raw.p = p; r.raw.n = len;
+      r.valvePC = -1;
+      r.seq = -1;
+      }
+
+    // Parse an unsigned decimal at p, advancing it; returns -1 if none.
+    static long parseUnsigned(const char *&p, const char *const end)
+      {
+      if((p >= end) || (*p < '0') || (*p > '9')) { return(-1); }
+      long v = 0;
+      while((p < end) && (*p >= '0') && (*p <= '9') && (v < 100000)) { v = (10 * v) + (*p++ - '0'); }
+      return(v);
+      }
+
+    // Value of the hex digit h (either case), or -1 if not one.
+    static int hexDigit(const char h)
+      {
+      if((h >= '0') && (h <= '9')) { return(h - '0'); }
+      if((h >= 'A') && (h <= 'F')) { return(h - 'A' + 10); }
+      if((h >= 'a') && (h <= 'f')) { return(h - 'a' + 10); }
+      return(-1);
+      }
+
+    // Find the value following "key": in a JSON line, or NULL.
+    static const char *findJSONValue(const char *const p, const char *const end, const char *const key)
+      {
+      const size_t kl = strlen(key);
+      for(const char *q = p; q + kl + 3 <= end; ++q)
+        {
+        if(('"' == q[0]) && (0 == memcmp(q + 1, key, kl)) && ('"' == q[kl + 1]) && (':' == q[kl + 2])) { return(q + kl + 3); }
+        }
+      return(NULL);
+      }
+
+    template <class F>
+    void finishText(const char *const p, size_t len, F &onRecord)
+      {
+      if((len > 0) && ('\r' == p[len - 1])) { --len; }
+      if(0 == len) { return; }
+      const char *const end = p + len;
+      Record r;
+      clear(r, RK_TEXT, p, len);
+      if('=' == p[0])
+        {
+        // eg "=F0%@18CB;..."
+        r.kind = RK_STATUS;
+        const char *q = p + 1;
+        if((q < end) && (('F' == *q) || ('W' == *q) || ('B' == *q))) { r.mode = *q++; }
+        const long v = parseUnsigned(q, end);
+        if((v >= 0) && (q < end) && ('%' == *q)) { r.valvePC = (int16_t)v; ++q; }
+        if((q < end) && ('@' == *q))
+          {
+          ++q;
+          const long c = parseUnsigned(q, end);
+          if((c >= 0) && (q < end) && ('C' == *q))
+            {
+            ++q;
+            // The sixteenths are one hex digit, eg "@18CB" is 18 + 11/16 C.
+            const int f = (q < end) ? hexDigit(*q) : -1;
+            if(f >= 0) { r.hasTemp = true; r.tempC16 = (int16_t)((c << 4) | f); }
+            }
+          }
+        }
+      else if('{' == p[0])
+        {
+        r.kind = RK_JSON;
+        const char *q = findJSONValue(p, end, "@");
+        if((NULL != q) && (q < end) && ('"' == *q))
+          {
+          const char *const idEnd = (const char *)memchr(q + 1, '"', end - (q + 1));
+          if(NULL != idEnd) { r.id.p = q + 1; r.id.n = idEnd - (q + 1); }
+          }
+        q = findJSONValue(p, end, "+");
+        if(NULL != q) { const long s = parseUnsigned(q, end); if(s >= 0) { r.seq = (int16_t)s; } }
+        }
+      else if((len > 4) && (0 == memcmp(p, "CfH ", 4)))
+        {
+        const char *q = p + 4;
+        const long h1 = parseUnsigned(q, end);
+        if((q < end) && (' ' == *q)) { ++q; }
+        const long h2 = parseUnsigned(q, end);
+        if((h1 >= 0) && (h1 <= 0xff) && (h2 >= 0) && (h2 <= 0xff))
+          { r.kind = RK_CFH; r.hc1 = (uint8_t)h1; r.hc2 = (uint8_t)h2; }
+        }
+      else if((5 == len) && (0 == memcmp(p, "RCfH", 4)) && (('1' == p[4]) || ('0' == p[4]) || ('-' == p[4])))
+        { r.kind = RK_RCFH; r.rcfh = p[4]; }
+      ++stats.records;
+      onRecord(r);
+      }
+
+    template <class F>
+    void finishBinary(F &onRecord)
+      {
+      if(discarding) { return; }
+      // type, idLen, id[idLen], seq, payload..., crc
+      if(n < 4) { ++stats.badCRC; return; }
+      uint8_t crc = 0x7f;
+      for(size_t i = 0; i < n - 1; ++i) { crc = crc7_5B_update(crc, buf[i]); }
+      const uint8_t idLen = buf[1];
+      if((crc != buf[n - 1]) || (n < (size_t)4 + idLen) || (idLen > 16)) { ++stats.badCRC; return; }
+      Record r;
+      clear(r, RK_BINARY, (const char *)buf, n - 1);
+      r.binType = buf[0];
+      // As Serial.print(b, HEX), ie with no leading zero, to match the text forms.
+      static const char hex[] = "0123456789ABCDEF";
+      size_t h = 0;
+      for(uint8_t i = 0; i < idLen; ++i)
+        {
+        const uint8_t b = buf[2 + i];
+        if(b >= 16) { idHex[h++] = hex[b >> 4]; }
+        idHex[h++] = hex[b & 0xf];
+        }
+      idHex[h] = '\0';
+      r.id.p = idHex; r.id.n = h;
+      r.seq = buf[2 + idLen];
+      r.payload = buf + 3 + idLen;
+      r.payloadLen = (uint8_t)(n - 4 - idLen);
+      if(('S' == r.binType) && (12 == r.payloadLen))
+        {
+        // As serialStatusReport() in V0p2_Main.cpp.
+        r.kind = RK_STATUS;
+        const uint8_t f = r.payload[0];
+        r.mode = (f & 2) ? 'B' : (f & 1) ? 'W' : 'F';
+        if(0xff != r.payload[1]) { r.valvePC = r.payload[1]; }
+        r.hasTemp = true;
+        r.tempC16 = (int16_t)((r.payload[2] << 8) | r.payload[3]);
+        }
+      ++stats.records;
+      onRecord(r);
+      }
+  };
+
+}
+
+#endif // V0P2_STREAM_DECODE_H
@@ -0,0 +1,130 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2017
+*/
+
+/*
+  CLI for v0p2_stream_decode.h: decodes V0p2 serial output from one or more hubs at once.
+
+  Build (POSIX):
+    g++ -std=c++11 -O2 -Wall -o v0p2_stream_decode v0p2_stream_decode_main.cpp
+
+  Usage: v0p2_stream_decode [input ...]
+    with each input a capture file or an already-configured serial device
+    (eg stty -F /dev/ttyUSB0 4800 raw), or stdin if none given.
+
+  Prints one tab-separated line per record: input index, kind, then kind-specific fields:
+    STATUS mode valve% tempC16 id seq   (absent values as -)
+    JSON   id seq line
+    CFH    hc1 hc2
+    RCFH   1|0|-
+    BIN    type id seq payload-hex
+    TEXT   line
+  and on exit per-input counts of records, bad CRCs and overlong records to stderr.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "v0p2_stream_decode.h"
+
+using namespace V0p2StreamDecode;
+
+static const int MAX_INPUTS = 64;
+
+static void printSpan(const Span &s) { fwrite(s.p, 1, s.n, stdout); }
+static void printSpanOrDash(const Span &s) { if(s.empty()) { putchar('-'); } else { printSpan(s); } }
+
+static void printRecord(const int input, const Record &r)
+  {
+  printf("%d\t", input);
+  switch(r.kind)
+    {
+    case RK_STATUS:
+      printf("STATUS\t%c\t", r.mode ? r.mode : '-');
+      if(r.valvePC >= 0) { printf("%d", r.valvePC); } else { putchar('-'); }
+      putchar('\t');
+      if(r.hasTemp) { printf("%d", r.tempC16); } else { putchar('-'); }
+      putchar('\t');
+      printSpanOrDash(r.id);
+      putchar('\t');
+      if(r.seq >= 0) { printf("%d", r.seq); } else { putchar('-'); }
+      break;
+    case RK_JSON:
+      fputs("JSON\t", stdout);
+      printSpanOrDash(r.id);
+      putchar('\t');
+      if(r.seq >= 0) { printf("%d", r.seq); } else { putchar('-'); }
+      putchar('\t');
+      printSpan(r.raw);
+      break;
+    case RK_CFH: printf("CFH\t%u\t%u", r.hc1, r.hc2); break;
+    case RK_RCFH: printf("RCFH\t%c", r.rcfh); break;
+    case RK_BINARY:
+      printf("BIN\t%c\t", ((r.binType >= 0x20) && (r.binType < 0x7f)) ? r.binType : '?');
+      printSpanOrDash(r.id);
+      printf("\t%d\t", r.seq);
+      for(uint8_t i = 0; i < r.payloadLen; ++i) { printf("%02x", r.payload[i]); }
+      break;
+    default: fputs("TEXT\t", stdout); printSpan(r.raw); break;
+    }
+  putchar('\n');
+  }
+
+int main(const int argc, char *argv[])
+  {
+  const int nInputs = (argc > 1) ? (argc - 1) : 1;
+  if(nInputs > MAX_INPUTS) { fprintf(stderr, "too many inputs (max %d)\n", MAX_INPUTS); return(2); }
+  static Decoder decoders[MAX_INPUTS];
+  struct pollfd fds[MAX_INPUTS];
+  for(int i = 0; i < nInputs; ++i)
+    {
+    fds[i].fd = (argc > 1) ? open(argv[i + 1], O_RDONLY | O_NOCTTY) : STDIN_FILENO;
+    if(fds[i].fd < 0) { perror(argv[i + 1]); return(1); }
+    fds[i].events = POLLIN;
+    }
+  int stillOpen = nInputs;
+  uint8_t buf[4096];
+  while(stillOpen > 0)
+    {
+    if(poll(fds, nInputs, -1) < 0) { if(EINTR == errno) { continue; } perror("poll"); return(1); }
+    for(int i = 0; i < nInputs; ++i)
+      {
+      if(0 == (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) { continue; }
+      const ssize_t got = read(fds[i].fd, buf, sizeof(buf));
+      if(got <= 0)
+        {
+        if((got < 0) && ((EINTR == errno) || (EAGAIN == errno))) { continue; }
+        close(fds[i].fd);
+        fds[i].fd = -1; // Ignored by poll() from now on.
+        --stillOpen;
+        continue;
+        }
+      decoders[i].feed(buf, (size_t)got, [i](const Record &r) { printRecord(i, r); });
+      }
+    fflush(stdout);
+    }
+  for(int i = 0; i < nInputs; ++i)
+    {
+    const Stats &s = decoders[i].getStats();
+    fprintf(stderr, "%d: %lu records, %lu bad CRC, %lu overlong\n", i,
+        (unsigned long)s.records, (unsigned long)s.badCRC, (unsigned long)s.overlong);
+    }
+  return(0);
+  }
@@ -0,0 +1,166 @@
+/*
+The OpenTRV project licenses this file to you
+under the Apache Licence, Version 2.0 (the "Licence");
+you may not use this file except in compliance
+with the Licence. You may obtain a copy of the Licence at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing,
+software distributed under the Licence is distributed on an
+"AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+KIND, either express or implied. See the Licence for the
+specific language governing permissions and limitations
+under the Licence.
+
+Author(s) / Copyright (s): Damon Hart-Davis 2017
+*/
+
+/*
+  Tests for v0p2_stream_decode.h against lines as printed by the sketch.
+
+  Build and run (POSIX):
+    g++ -std=c++11 -O2 -Wall -o v0p2_stream_decode_test v0p2_stream_decode_test.cpp && ./v0p2_stream_decode_test
+
+  Exits non-zero after printing the first failed check.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "v0p2_stream_decode.h"
+
+using namespace V0p2StreamDecode;
+
+#define CHECK(c) do { if(!(c)) { fprintf(stderr, "%s:%d: FAILED: %s\n", __FILE__, __LINE__, #c); exit(1); } } while(0)
+
+// Decode the text s (one or more lines), keeping a copy of the last record.
+static Record lastRecord;
+static int recordCount;
+static void decode(const char *const s)
+  {
+  Decoder d;
+  recordCount = 0;
+  d.feed((const uint8_t *)s, strlen(s), [](const Record &r) { lastRecord = r; ++recordCount; });
+  }
+
+// SLIP-frame the binary record rec (without CRC) into out, appending the CRC as the sketch does; returns the length.
+static size_t slipRecord(const uint8_t *const rec, const size_t len, uint8_t *const out)
+  {
+  size_t o = 0;
+  uint8_t crc = 0x7f;
+  out[o++] = 0xc0;
+  for(size_t i = 0; i <= len; ++i)
+    {
+    const uint8_t b = (i < len) ? rec[i] : crc;
+    if(i < len) { crc = crc7_5B_update(crc, b); }
+    if(0xc0 == b) { out[o++] = 0xdb; out[o++] = 0xdc; }
+    else if(0xdb == b) { out[o++] = 0xdb; out[o++] = 0xdd; }
+    else { out[o++] = b; }
+    }
+  out[o++] = 0xc0;
+  return(o);
+  }
+
+int main()
+  {
+  // Status line from a REV7 valve: WARM, valve 0% open, 19 + 10/16 C (the sixteenths in hex).
+  decode("=W0%@19CA;T10 2 W255 0 F255 0 W255 0 F255 0;S6 6 16 e;HC1 1\r\n");
+  CHECK(1 == recordCount);
+  CHECK(RK_STATUS == lastRecord.kind);
+  CHECK('W' == lastRecord.mode);
+  CHECK(0 == lastRecord.valvePC);
+  CHECK(lastRecord.hasTemp);
+  CHECK((19*16 + 10) == lastRecord.tempC16);
+
+  // FROST with the valve part open and a whole number of degrees.
+  decode("=F35%@18C0;X0;T0 0 W255 0 F255 0 W255 0 F255 0;S7 7 18\n");
+  CHECK(RK_STATUS == lastRecord.kind);
+  CHECK('F' == lastRecord.mode);
+  CHECK(35 == lastRecord.valvePC);
+  CHECK((18*16) == lastRecord.tempC16);
+
+  // A non-hex fraction is not taken as a temperature.
+  decode("=F0%@18CZ;\n");
+  CHECK(RK_STATUS == lastRecord.kind);
+  CHECK(!lastRecord.hasTemp);
+
+  // JSON stats line, split across chunks.
+  {
+  Decoder d;
+  recordCount = 0;
+  const char *const a = "{\"@\":\"f9b2\",\"+\":3,";
+  const char *const b = "\"T|C16\":319,\"L\":42}\n";
+  d.feed((const uint8_t *)a, strlen(a), [](const Record &r) { lastRecord = r; ++recordCount; });
+  CHECK(0 == recordCount);
+  d.feed((const uint8_t *)b, strlen(b), [](const Record &r) { lastRecord = r; ++recordCount; });
+  CHECK(1 == recordCount);
+  CHECK(RK_JSON == lastRecord.kind);
+  CHECK(lastRecord.id.equals("f9b2"));
+  CHECK(3 == lastRecord.seq);
+  }
+
+  // Call for heat heard from a valve, and the boiler hub's on/off/ignored markers.
+  decode("CfH 12 34\r\n");
+  CHECK(RK_CFH == lastRecord.kind);
+  CHECK((12 == lastRecord.hc1) && (34 == lastRecord.hc2));
+  decode("RCfH1\nRCfH-\n");
+  CHECK(2 == recordCount);
+  CHECK(RK_RCFH == lastRecord.kind);
+  CHECK('-' == lastRecord.rcfh);
+  decode("RCfH2\n");
+  CHECK(RK_TEXT == lastRecord.kind);
+
+  // Binary 'S' status record between text lines, with bytes needing SLIP escapes: BAKE, valve 100%, 19 + 4/16 C.
+  {
+  const uint8_t rec[] = { 'S', 2, 0xc0, 0x0b, 7, 2, 100, 0x01, 0x34, 0xdb, 0, 0, 0, 0, 0, 0, 0 };
+  uint8_t stream[64];
+  size_t n = 0;
+  memcpy(stream, "X\n", 2); n += 2;
+  n += slipRecord(rec, sizeof(rec), stream + n);
+  memcpy(stream + n, "Y\n", 2); n += 2;
+  Decoder d;
+  recordCount = 0;
+  // Fed a byte at a time, so nothing relies on chunk boundaries.
+  for(size_t i = 0; i < n; ++i) { d.feed(stream + i, 1, [](const Record &r) { if(RK_TEXT != r.kind) { lastRecord = r; } ++recordCount; }); }
+  CHECK(3 == recordCount);
+  CHECK(RK_STATUS == lastRecord.kind);
+  CHECK('S' == lastRecord.binType);
+  CHECK(lastRecord.id.equals("C0B"));
+  CHECK(7 == lastRecord.seq);
+  CHECK('B' == lastRecord.mode);
+  CHECK(100 == lastRecord.valvePC);
+  CHECK(lastRecord.hasTemp && ((19*16 + 4) == lastRecord.tempC16));
+  CHECK(0 == d.getStats().badCRC);
+
+  // The same record with a corrupt CRC is counted and dropped.
+  n = slipRecord(rec, sizeof(rec), stream);
+  stream[n - 2] ^= 1;
+  recordCount = 0;
+  d.feed(stream, n, [](const Record &) { ++recordCount; });
+  CHECK(0 == recordCount);
+  CHECK(1 == d.getStats().badCRC);
+  }
+
+  // An overlong line is counted and dropped, and the stream carries on with the next line.
+  {
+  char line[Decoder::MAX_RECORD + 20];
+  memset(line, 'x', sizeof(line) - 1);
+  line[sizeof(line) - 2] = '\n';
+  line[sizeof(line) - 1] = '\0';
+  Decoder d;
+  recordCount = 0;
+  // Split so that the line cannot be passed back zero-copy.
+  d.feed((const uint8_t *)line, 10, [](const Record &) { ++recordCount; });
+  d.feed((const uint8_t *)line + 10, strlen(line) - 10, [](const Record &) { ++recordCount; });
+  CHECK(0 == recordCount);
+  CHECK(1 == d.getStats().overlong);
+  const char *const next = "=F0%@18C0;\n";
+  d.feed((const uint8_t *)next, strlen(next), [](const Record &r) { lastRecord = r; ++recordCount; });
+  CHECK(1 == recordCount);
+  CHECK((RK_STATUS == lastRecord.kind) && (18*16 == lastRecord.tempC16));
+  }
+
+  puts("OK");
+  return(0);
+  }
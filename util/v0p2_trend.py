@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+#
+# The OpenTRV project licenses this file to you
+# under the Apache Licence, Version 2.0 (the "Licence");
+# you may not use this file except in compliance
+# with the Licence. You may obtain a copy of the Licence at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the Licence is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied. See the Licence for the
+# specific language governing permissions and limitations
+# under the Licence.
+#
+# Author(s) / Copyright (s): Damon Hart-Davis 2017
+
+"""Compare per-day behaviour of V0p2 builds from their serial captures.
+
+Each argument is label=capture-file, a text serial log from a unit running
+that build (a snapshot or current V0p2_Main), ideally all on the same rig
+over the same days so that the figures are comparable.  Every V0p2 build
+since 2014 prints the same '=' status line and echoes each JSON stats frame
+it transmits, so these work across snapshots:
+  travel     sum of valve % changes between successive status lines
+  reversals  changes of valve direction
+  tx         JSON stats frames transmitted ('{' lines)
+Builds with the 'SH' stack headroom line (current V0p2_Main) also report
+the lowest headroom seen; older ones show '-'.  Loop cycles are only
+available from current builds via +PRF/+BEN, and flash/RAM for all builds
+from V0p2_snapshot_trend.sh.
+
+Days are counted from the ';T HH MM' section of the status lines, a new day
+starting when the time goes backwards; a capture without it is one day.
+
+Prints one line per build in argument order:
+  label days travel/d reversals/d tx/d minSH
+
+Usage: v0p2_trend.py label=capture [label=capture ...]
+  eg: v0p2_trend.py r4191=jittery.log main=main.log
+"""
+
+import re
+import sys
+
+STATUS_RE = re.compile(r'^=[A-Z](\d+)%')
+TIME_RE = re.compile(r';T(\d+) (\d+)')
+SH_RE = re.compile(r'^SH (-?\d+)')
+
+
+def summarise(path):
+    """Return (days, travel, reversals, tx, minSH or None) for one capture."""
+    days = 1
+    travel = 0
+    reversals = 0
+    tx = 0
+    min_sh = None
+    last_pc = None
+    last_dir = 0
+    last_min = None
+    with open(path, errors='replace') as f:
+        for line in f:
+            line = line.strip()
+            if line.startswith('{'):
+                tx += 1
+                continue
+            m = SH_RE.match(line)
+            if m:
+                sh = int(m.group(1))
+                min_sh = sh if min_sh is None else min(min_sh, sh)
+                continue
+            m = STATUS_RE.match(line)
+            if not m:
+                continue
+            pc = int(m.group(1))
+            if last_pc is not None and pc != last_pc:
+                travel += abs(pc - last_pc)
+                d = 1 if pc > last_pc else -1
+                if last_dir and d != last_dir:
+                    reversals += 1
+                last_dir = d
+            last_pc = pc
+            t = TIME_RE.search(line)
+            if t:
+                minute = 60 * int(t.group(1)) + int(t.group(2))
+                if last_min is not None and minute < last_min:
+                    days += 1
+                last_min = minute
+    return days, travel, reversals, tx, min_sh
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write(__doc__)
+        return 2
+    for arg in argv[1:]:
+        label, sep, path = arg.partition('=')
+        if not sep:
+            sys.stderr.write('expected label=capture: %s\n' % arg)
+            return 2
+        days, travel, reversals, tx, min_sh = summarise(path)
+        print('%s %d %.1f %.1f %.1f %s' % (label, days, travel / days, reversals / days, tx / days,
+                                          '-' if min_sh is None else min_sh))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))